@@ -0,0 +1,450 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Persistent cache of the bodies built from the named shapes of a STEP file.
+//
+// Building a ChBodyEasyCascade from a STEP sub-shape requires parsing the STEP
+// file, computing the volume properties of the shape, and tessellating it for
+// visualization and collision. For large assemblies this takes far longer than
+// a short simulation. CascadePartCache stores, for each named shape:
+//   - the shape location (the body reference frame),
+//   - the mass, center of mass, and inertia for the given density,
+//   - the tessellated mesh (vertices, normals, and triangles), which is used
+//     both as visualization asset and as collision shape,
+// and marker frames (shape locations) looked up by name.
+//
+// The key of an entry is a 64-bit FNV-1a hash of the STEP file content, the
+// shape name, the density, and the tessellation parameters, and is saved in
+// the entry (as in hull_cache.h), so that an edited file or changed parameters
+// never use a stale entry. The STEP file is parsed only if some entry is
+// missing. GetBodies reads the cached entries of several shapes in parallel
+// (with OpenMP, if enabled); the missing shapes are then computed serially from
+// the loaded document.
+//
+// Entry file (native endianness):
+//   header: magic "CHCC", uint32 version, uint64 key size (bytes), key
+//   frame:  7 doubles (position, rotation quaternion)
+//   part:   frame, 10 doubles (mass, COG, inertia XX, inertia XY), then for
+//           vertices, normals, vertex indices, and normal indices: uint64 count
+//           and the data (3 doubles or 3 int32 each)
+//
+// The cached bodies are ChBodyAuxRef objects set up as ChBodyEasyCascade does,
+// with a ChTriangleMeshShape asset instead of a ChCascadeShapeAsset.
+//
+// =============================================================================
+
+#ifndef CASCADE_CACHE_H
+#define CASCADE_CACHE_H
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define CASCADE_CACHE_GETPID _getpid
+#else
+#include <unistd.h>
+#define CASCADE_CACHE_GETPID getpid
+#endif
+
+#include "chrono/assets/ChTriangleMeshShape.h"
+#include "chrono/geometry/ChTriangleMeshConnected.h"
+#include "chrono/physics/ChBodyAuxRef.h"
+#include "chrono_cascade/ChCascadeDoc.h"
+#include "chrono_cascade/ChCascadeMeshTools.h"
+#include "chrono_thirdparty/filesystem/path.h"
+
+#include <TopoDS_Shape.hxx>
+
+/// Tessellation parameters (see ChCascadeMeshTools::fillTriangleMeshFromCascade).
+struct CascadeMeshParams {
+    double deflection = 1;
+    bool relative_deflection = false;
+    double angular_deflection = 0.5;
+};
+
+class CascadePartCache {
+  public:
+    CascadePartCache(const std::string& step_file,
+                     const CascadeMeshParams& params = CascadeMeshParams(),
+                     const std::string& cache_dir = "../CASCADE_CACHE")
+        : m_step_file(step_file),
+          m_params(params),
+          m_dir(cache_dir),
+          m_file_ok(false),
+          m_file_hash(0),
+          m_file_size(0),
+          m_hits(0),
+          m_misses(0) {
+        m_file_ok = HashFile(step_file, m_file_hash, m_file_size);
+        if (!m_file_ok)
+            std::cout << "Could not read STEP file " << step_file << std::endl;
+    }
+
+    /// Return a body made of the named shape, or an empty pointer if the shape is not found.
+    std::shared_ptr<chrono::ChBodyAuxRef> GetBody(const std::string& name,
+                                                  double density,
+                                                  bool visualize = true,
+                                                  bool collide = false,
+                                                  std::shared_ptr<chrono::ChMaterialSurface> mat = nullptr) {
+        return GetBodies({name}, density, visualize, collide, mat)[0];
+    }
+
+    /// Return bodies made of the named shapes (empty pointers for the shapes not found).
+    /// The cached entries are read in parallel.
+    std::vector<std::shared_ptr<chrono::ChBodyAuxRef>> GetBodies(
+        const std::vector<std::string>& names,
+        double density,
+        bool visualize = true,
+        bool collide = false,
+        std::shared_ptr<chrono::ChMaterialSurface> mat = nullptr) {
+        int n = (int)names.size();
+        std::vector<std::string> keys(n);
+        std::vector<std::shared_ptr<Entry>> entries(n);
+        for (int i = 0; i < n; i++) {
+            keys[i] = PartKey(names[i], density);
+            auto it = m_entries.find(keys[i]);
+            if (it != m_entries.end())
+                entries[i] = it->second;
+        }
+
+        // Read the entries not in memory (independent files)
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < n; i++) {
+            if (entries[i])
+                continue;
+            auto entry = std::make_shared<Entry>();
+            if (Read(GetEntryFile(GetHash(keys[i])), keys[i], true, *entry))
+                entries[i] = entry;
+        }
+
+        // Compute the missing entries from the STEP document
+        std::vector<std::shared_ptr<chrono::ChBodyAuxRef>> bodies(n);
+        for (int i = 0; i < n; i++) {
+            if (entries[i]) {
+                m_hits++;
+            } else {
+                m_misses++;
+                entries[i] = ComputePart(names[i], density);
+                if (!entries[i])
+                    continue;
+                Insert(keys[i], *entries[i], true);
+            }
+            m_entries[keys[i]] = entries[i];
+            bodies[i] = CreateBody(*entries[i], visualize, collide, mat);
+        }
+        return bodies;
+    }
+
+    /// Return the location of the named shape (e.g., a marker); return false if not found.
+    bool GetFrame(const std::string& name, chrono::ChFrame<>& frame) {
+        std::string key = FrameKey(name);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            frame = it->second->frame;
+            m_hits++;
+            return true;
+        }
+        auto entry = std::make_shared<Entry>();
+        if (Read(GetEntryFile(GetHash(key)), key, false, *entry)) {
+            m_hits++;
+        } else {
+            m_misses++;
+            TopoDS_Shape shape;
+            if (!LoadDocument() || !m_doc->GetNamedShape(shape, (char*)name.c_str()))
+                return false;
+            chrono::cascade::ChCascadeDoc::FromCascadeToChrono(shape.Location(), entry->frame);
+            Insert(key, *entry, false);
+        }
+        m_entries[key] = entry;
+        frame = entry->frame;
+        return true;
+    }
+
+    /// Return true if the STEP file had to be parsed.
+    bool IsDocumentLoaded() const { return (bool)m_doc; }
+
+    /// Return the number of lookups found in memory or on disk.
+    int GetNumHits() const { return m_hits; }
+
+    /// Return the number of lookups which required the STEP document.
+    int GetNumMisses() const { return m_misses; }
+
+  private:
+    static const uint32_t version = 1;
+
+    struct Entry {
+        chrono::ChFrame<> frame;  // shape location (body reference frame)
+        double mass = 0;
+        chrono::ChVector<> cog;
+        chrono::ChVector<> inertiaXX;
+        chrono::ChVector<> inertiaXY;
+        std::shared_ptr<chrono::geometry::ChTriangleMeshConnected> mesh;  // in the reference frame
+    };
+
+    template <typename T>
+    static void Append(std::string& key, const T& value) {
+        key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static void Append(std::string& key, const std::string& str) {
+        Append(key, (uint64_t)str.size());
+        key.append(str);
+    }
+
+    std::string FileKey(uint32_t type, const std::string& name) const {
+        std::string key;
+        Append(key, type);
+        Append(key, m_file_hash);
+        Append(key, m_file_size);
+        Append(key, name);
+        return key;
+    }
+
+    std::string PartKey(const std::string& name, double density) const {
+        std::string key = FileKey(1, name);
+        Append(key, density);
+        Append(key, m_params.deflection);
+        Append(key, (uint8_t)m_params.relative_deflection);
+        Append(key, m_params.angular_deflection);
+        return key;
+    }
+
+    std::string FrameKey(const std::string& name) const { return FileKey(2, name); }
+
+    static uint64_t Hash(const char* data, size_t size, uint64_t hash = 14695981039346656037ULL) {
+        // 64-bit FNV-1a
+        for (size_t i = 0; i < size; i++) {
+            hash ^= (unsigned char)data[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    static bool HashFile(const std::string& filename, uint64_t& hash, uint64_t& size) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.good())
+            return false;
+        hash = 14695981039346656037ULL;
+        size = 0;
+        std::vector<char> buf(1 << 20);
+        while (file) {
+            file.read(buf.data(), buf.size());
+            size_t count = (size_t)file.gcount();
+            hash = Hash(buf.data(), count, hash);
+            size += count;
+        }
+        return true;
+    }
+
+    static std::string GetHash(const std::string& key) {
+        char buf[17];
+        sprintf(buf, "%016llx", (unsigned long long)Hash(key.data(), key.size()));
+        return std::string(buf);
+    }
+
+    std::string GetEntryFile(const std::string& hash) const { return m_dir + "/" + hash + ".part"; }
+
+    bool LoadDocument() {
+        if (m_doc)
+            return true;
+        if (!m_file_ok)
+            return false;
+        m_doc = std::unique_ptr<chrono::cascade::ChCascadeDoc>(new chrono::cascade::ChCascadeDoc);
+        if (!m_doc->Load_STEP(m_step_file.c_str())) {
+            std::cout << "Could not load STEP file " << m_step_file << std::endl;
+            m_file_ok = false;
+            return false;
+        }
+        return true;
+    }
+
+    // Volume properties and tessellation of the named shape, as in the ChBodyEasyCascade constructor.
+    std::shared_ptr<Entry> ComputePart(const std::string& name, double density) {
+        TopoDS_Shape shape;
+        if (!LoadDocument() || !m_doc->GetNamedShape(shape, (char*)name.c_str()))
+            return nullptr;
+        auto entry = std::make_shared<Entry>();
+        chrono::cascade::ChCascadeDoc::FromCascadeToChrono(shape.Location(), entry->frame);
+        shape.Location(TopLoc_Location());
+        double volume;
+        chrono::cascade::ChCascadeDoc::GetVolumeProperties(shape, density, entry->cog, entry->inertiaXX,
+                                                           entry->inertiaXY, volume, entry->mass);
+        entry->mesh = chrono_types::make_shared<chrono::geometry::ChTriangleMeshConnected>();
+        chrono::cascade::ChCascadeMeshTools::fillTriangleMeshFromCascade(
+            *entry->mesh, shape, m_params.deflection, m_params.relative_deflection, m_params.angular_deflection);
+        return entry;
+    }
+
+    static std::shared_ptr<chrono::ChBodyAuxRef> CreateBody(const Entry& entry,
+                                                            bool visualize,
+                                                            bool collide,
+                                                            std::shared_ptr<chrono::ChMaterialSurface> mat) {
+        auto body = chrono_types::make_shared<chrono::ChBodyAuxRef>();
+        body->SetMass(entry.mass);
+        body->SetInertiaXX(entry.inertiaXX);
+        body->SetInertiaXY(entry.inertiaXY);
+        body->SetFrame_REF_to_abs(entry.frame);
+        body->SetFrame_COG_to_REF(chrono::ChFrame<>(entry.cog, chrono::QUNIT));
+
+        if (collide) {
+            assert(mat);
+            body->GetCollisionModel()->ClearModel();
+            body->GetCollisionModel()->AddTriangleMesh(mat, entry.mesh, false, false, chrono::VNULL,
+                                                       chrono::ChMatrix33<>(1), 0.005);
+            body->GetCollisionModel()->BuildModel();
+            body->SetCollide(true);
+        }
+        if (visualize) {
+            auto vshape = chrono_types::make_shared<chrono::ChTriangleMeshShape>();
+            vshape->SetMesh(entry.mesh);
+            body->AddAsset(vshape);
+        }
+        return body;
+    }
+
+    // Add an entry on disk.
+    void Insert(const std::string& key, const Entry& entry, bool is_part) {
+        filesystem::create_directory(filesystem::path(m_dir));
+        std::string filename = GetEntryFile(GetHash(key));
+        if (!Write(filename, key, is_part, entry))
+            std::cout << "Could not write STEP cache entry " << filename << std::endl;
+    }
+
+    template <typename T>
+    static bool ReadValue(std::ifstream& file, T& value) {
+        return (bool)file.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+
+    template <typename T, typename S>
+    static bool ReadArray(std::ifstream& file, std::vector<chrono::ChVector<T>>& values) {
+        uint64_t count;
+        if (!ReadValue(file, count))
+            return false;
+        std::vector<S> c(3 * count);
+        if (!file.read(reinterpret_cast<char*>(c.data()), c.size() * sizeof(S)))
+            return false;
+        values.resize(count);
+        for (uint64_t k = 0; k < count; k++)
+            values[k] = chrono::ChVector<T>((T)c[3 * k], (T)c[3 * k + 1], (T)c[3 * k + 2]);
+        return true;
+    }
+
+    template <typename T, typename S>
+    static void WriteArray(std::ofstream& file, const std::vector<chrono::ChVector<T>>& values) {
+        uint64_t count = values.size();
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        for (const auto& v : values) {
+            S c[3] = {(S)v.x(), (S)v.y(), (S)v.z()};
+            file.write(reinterpret_cast<const char*>(c), sizeof(c));
+        }
+    }
+
+    static bool Read(const std::string& filename, const std::string& key, bool is_part, Entry& entry) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.good())
+            return false;
+
+        // Messages are not printed here (this function runs in parallel); a rejected entry is recomputed
+        char magic[4];
+        uint32_t file_version;
+        uint64_t key_size;
+        if (!file.read(magic, 4) || std::memcmp(magic, "CHCC", 4) != 0 || !ReadValue(file, file_version) ||
+            file_version != version || !ReadValue(file, key_size) || key_size != key.size())
+            return false;
+        std::string file_key(key_size, '\0');
+        if (!file.read(&file_key[0], key_size) || file_key != key)
+            return false;
+
+        double f[7];
+        if (!file.read(reinterpret_cast<char*>(f), sizeof(f)))
+            return false;
+        entry.frame = chrono::ChFrame<>(chrono::ChVector<>(f[0], f[1], f[2]),
+                                        chrono::ChQuaternion<>(f[3], f[4], f[5], f[6]));
+        if (!is_part)
+            return true;
+
+        double p[10];
+        if (!file.read(reinterpret_cast<char*>(p), sizeof(p)))
+            return false;
+        entry.mass = p[0];
+        entry.cog = chrono::ChVector<>(p[1], p[2], p[3]);
+        entry.inertiaXX = chrono::ChVector<>(p[4], p[5], p[6]);
+        entry.inertiaXY = chrono::ChVector<>(p[7], p[8], p[9]);
+
+        entry.mesh = chrono_types::make_shared<chrono::geometry::ChTriangleMeshConnected>();
+        return ReadArray<double, double>(file, entry.mesh->getCoordsVertices()) &&
+               ReadArray<double, double>(file, entry.mesh->getCoordsNormals()) &&
+               ReadArray<int, int32_t>(file, entry.mesh->getIndicesVertexes()) &&
+               ReadArray<int, int32_t>(file, entry.mesh->getIndicesNormals());
+    }
+
+    // Write to a temporary file, renamed when complete, so that concurrent programs never read a partial entry.
+    static bool Write(const std::string& filename, const std::string& key, bool is_part, const Entry& entry) {
+        std::string tmpname = filename + ".tmp" + std::to_string(CASCADE_CACHE_GETPID());
+        {
+            std::ofstream file(tmpname, std::ios::binary);
+            uint32_t file_version = version;
+            uint64_t key_size = key.size();
+            file.write("CHCC", 4);
+            file.write(reinterpret_cast<const char*>(&file_version), sizeof(file_version));
+            file.write(reinterpret_cast<const char*>(&key_size), sizeof(key_size));
+            file.write(key.data(), key.size());
+
+            const auto& pos = entry.frame.GetPos();
+            const auto& rot = entry.frame.GetRot();
+            double f[7] = {pos.x(), pos.y(), pos.z(), rot.e0(), rot.e1(), rot.e2(), rot.e3()};
+            file.write(reinterpret_cast<const char*>(f), sizeof(f));
+            if (is_part) {
+                double p[10] = {entry.mass,          entry.cog.x(),       entry.cog.y(),       entry.cog.z(),
+                                entry.inertiaXX.x(), entry.inertiaXX.y(), entry.inertiaXX.z(), entry.inertiaXY.x(),
+                                entry.inertiaXY.y(), entry.inertiaXY.z()};
+                file.write(reinterpret_cast<const char*>(p), sizeof(p));
+                WriteArray<double, double>(file, entry.mesh->getCoordsVertices());
+                WriteArray<double, double>(file, entry.mesh->getCoordsNormals());
+                WriteArray<int, int32_t>(file, entry.mesh->getIndicesVertexes());
+                WriteArray<int, int32_t>(file, entry.mesh->getIndicesNormals());
+            }
+            if (!file.good()) {
+                file.close();
+                remove(tmpname.c_str());
+                return false;
+            }
+        }
+        if (rename(tmpname.c_str(), filename.c_str()) != 0) {
+            remove(tmpname.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    std::string m_step_file;
+    CascadeMeshParams m_params;
+    std::string m_dir;
+    bool m_file_ok;
+    uint64_t m_file_hash;
+    uint64_t m_file_size;
+    std::unique_ptr<chrono::cascade::ChCascadeDoc> m_doc;
+    std::map<std::string, std::shared_ptr<Entry>> m_entries;
+    int m_hits;
+    int m_misses;
+};
+
+#endif
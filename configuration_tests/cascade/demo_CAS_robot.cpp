@@ -15,9 +15,17 @@
 //   - load a 3D model saved in STEP format from a CAD
 //   - select some sub assemblies from the STEP model
 //   - make Chrono::Engine objects out of those parts
+//
+//   The bodies (mass properties and tessellated meshes) and the marker frames
+//   are cached on disk (see cascade_cache.h), so that the STEP file is parsed
+//   and tessellated only on the first run.
 // =============================================================================
 
+#include <string>
+#include <vector>
+
 #include "chrono/core/ChRealtimeStep.h"
+#include "chrono/core/ChTimer.h"
 #include "chrono/physics/ChSystemNSC.h"
 #include "chrono/physics/ChBodyEasy.h"
 #include "chrono_cascade/ChBodyEasyCascade.h"
@@ -25,6 +33,8 @@
 #include "chrono_cascade/ChCascadeShapeAsset.h"
 #include "chrono_irrlicht/ChIrrApp.h"
 
+#include "cascade_cache.h"
+
 // Use the namespace of Chrono
 using namespace chrono;
 using namespace chrono::irrlicht;
@@ -61,35 +71,22 @@ int main(int argc, char* argv[]) {
     // created using a 3D CAD (in this case, SolidEdge v.18).
     //
 
-    // Create the ChCascadeDoc, a container that loads the STEP model
-    // and manages its subassemblies
-    ChCascadeDoc mydoc;
-
-    // load the STEP model using this command:
-    bool load_ok = mydoc.Load_STEP(GetChronoDataFile("/cascade/IRB7600_23_500_m2000_rev1_01_decorated.stp").c_str());
-
-    // print the contained shapes
-    mydoc.Dump(GetLog());
+    // Create the cache of the parts of the STEP model (the ChCascadeDoc, which
+    // loads the STEP model and manages its subassemblies, is used only when
+    // some part or marker is not in the cache)
+    ChTimer<double> timer_load;
+    timer_load.start();
+    CascadePartCache cache(GetChronoDataFile("/cascade/IRB7600_23_500_m2000_rev1_01_decorated.stp"));
 
     collision::ChCollisionModel::SetDefaultSuggestedEnvelope(0.002);
     collision::ChCollisionModel::SetDefaultSuggestedMargin(0.001);
 
     //
     // Retrieve some sub shapes from the loaded model, using
-    // the GetNamedShape() function, that can use path/subpath/subsubpath/part
-    // syntax and * or ? wldcards, etc.
+    // the GetNamedShape() path/subpath/subsubpath/part syntax, with
+    // * or ? wldcards, etc. The cached parts are loaded in parallel.
     //
 
-    std::shared_ptr<ChBodyEasyCascade> mrigidBody_base;
-    std::shared_ptr<ChBodyEasyCascade> mrigidBody_turret;
-    std::shared_ptr<ChBodyEasyCascade> mrigidBody_bicep;
-    std::shared_ptr<ChBodyEasyCascade> mrigidBody_elbow;
-    std::shared_ptr<ChBodyEasyCascade> mrigidBody_forearm;
-    std::shared_ptr<ChBodyEasyCascade> mrigidBody_wrist;
-    std::shared_ptr<ChBodyEasyCascade> mrigidBody_hand;
-    std::shared_ptr<ChBodyEasyCascade> mrigidBody_cylinder;
-    std::shared_ptr<ChBodyEasyCascade> mrigidBody_rod;
-
     // Note, In most CADs the Y axis is horizontal, but we want it vertical.
     // So define a root transformation for rotating all the imported objects.
     ChQuaternion<> rotation1;
@@ -99,103 +96,34 @@ int main(int argc, char* argv[]) {
     ChQuaternion<> tot_rotation = rotation2 % rotation1;  // rotate on 1 then on 2, using quaternion product
     ChFrameMoving<> root_frame(ChVector<>(0, 0, 0), tot_rotation);
 
-    if (load_ok) {
-        TopoDS_Shape shape_base;
-        if (mydoc.GetNamedShape(shape_base, "Assem10/Assem8")) {
-            auto mbody = chrono_types::make_shared<ChBodyEasyCascade>(shape_base, 1000, true, false);
-            mrigidBody_base = mbody;
-
-            my_system.Add(mrigidBody_base);
-
-            // The base is fixed to the ground
-            mrigidBody_base->SetBodyFixed(true);
-
-            mrigidBody_base->ConcatenatePreTransformation(root_frame);
-        } else
-            GetLog() << "Warning. Desired object not found in document \n";
-
-        TopoDS_Shape shape_turret;
-        if (mydoc.GetNamedShape(shape_turret, "Assem10/Assem4")) {
-            auto mbody = chrono_types::make_shared<ChBodyEasyCascade>(shape_turret, 1000, true, false);
-            mrigidBody_turret = mbody;
-            my_system.Add(mrigidBody_turret);
-            // Move the body as for global displacement/rotation
-            mrigidBody_turret->ConcatenatePreTransformation(root_frame);
-        } else
-            GetLog() << "Warning. Desired object not found in document \n";
-
-        TopoDS_Shape shape_bicep;
-        if (mydoc.GetNamedShape(shape_bicep, "Assem10/Assem1")) {
-            auto mbody = chrono_types::make_shared<ChBodyEasyCascade>(shape_bicep, 1000, true, false);
-            mrigidBody_bicep = mbody;
-            my_system.Add(mrigidBody_bicep);
-            // Move the body as for global displacement/rotation
-            mrigidBody_bicep->ConcatenatePreTransformation(root_frame);
-        } else
-            GetLog() << "Warning. Desired object not found in document \n";
-
-        TopoDS_Shape shape_elbow;
-        if (mydoc.GetNamedShape(shape_elbow, "Assem10/Assem5")) {
-            auto mbody = chrono_types::make_shared<ChBodyEasyCascade>(shape_elbow, 1000, true, false);
-            mrigidBody_elbow = mbody;
-            my_system.Add(mrigidBody_elbow);
-            // Move the body as for global displacement/rotation
-            mrigidBody_elbow->ConcatenatePreTransformation(root_frame);
-        } else
-            GetLog() << "Warning. Desired object not found in document \n";
-
-        TopoDS_Shape shape_forearm;
-        if (mydoc.GetNamedShape(shape_forearm, "Assem10/Assem7")) {
-            auto mbody = chrono_types::make_shared<ChBodyEasyCascade>(shape_forearm, 1000, true, false);
-            mrigidBody_forearm = mbody;
-            my_system.Add(mrigidBody_forearm);
-            // Move the body as for global displacement/rotation
-            mrigidBody_forearm->ConcatenatePreTransformation(root_frame);
-        } else
-            GetLog() << "Warning. Desired object not found in document \n";
-
-        TopoDS_Shape shape_wrist;
-        if (mydoc.GetNamedShape(shape_wrist, "Assem10/Assem6")) {
-            auto mbody = chrono_types::make_shared<ChBodyEasyCascade>(shape_wrist, 1000, true, false);
-            mrigidBody_wrist = mbody;
-            my_system.Add(mrigidBody_wrist);
-            // Move the body as for global displacement/rotation
-            mrigidBody_wrist->ConcatenatePreTransformation(root_frame);
-        } else
-            GetLog() << "Warning. Desired object not found in document \n";
-
-        TopoDS_Shape shape_hand;
-        if (mydoc.GetNamedShape(shape_hand, "Assem10/Assem9")) {
-            auto mbody = chrono_types::make_shared<ChBodyEasyCascade>(shape_hand, 1000, true, false);
-            mrigidBody_hand = mbody;
-            my_system.Add(mrigidBody_hand);
-            // Move the body as for global displacement/rotation
-            mrigidBody_hand->ConcatenatePreTransformation(root_frame);
-        } else
-            GetLog() << "Warning. Desired object not found in document \n";
-
-        TopoDS_Shape shape_cylinder;
-        if (mydoc.GetNamedShape(shape_cylinder, "Assem10/Assem3")) {
-            auto mbody = chrono_types::make_shared<ChBodyEasyCascade>(shape_cylinder, 1000, true, false);
-            mrigidBody_cylinder = mbody;
-            my_system.Add(mrigidBody_cylinder);
-            // Move the body as for global displacement/rotation
-            mrigidBody_cylinder->ConcatenatePreTransformation(root_frame);
-        } else
-            GetLog() << "Warning. Desired object not found in document \n";
-
-        TopoDS_Shape shape_rod;
-        if (mydoc.GetNamedShape(shape_rod, "Assem10/Assem2")) {
-            auto mbody = chrono_types::make_shared<ChBodyEasyCascade>(shape_rod, 1000, true, false);
-            mrigidBody_rod = mbody;
-            my_system.Add(mrigidBody_rod);
-            // Move the body as for global displacement/rotation
-            mrigidBody_rod->ConcatenatePreTransformation(root_frame);
-        } else
-            GetLog() << "Warning. Desired object not found in document \n";
-
-    } else
-        GetLog() << "Warning. Desired STEP file could not be opened/parsed \n";
+    std::vector<std::string> part_names = {"Assem10/Assem8", "Assem10/Assem4", "Assem10/Assem1",
+                                           "Assem10/Assem5", "Assem10/Assem7", "Assem10/Assem6",
+                                           "Assem10/Assem9", "Assem10/Assem3", "Assem10/Assem2"};
+    auto parts = cache.GetBodies(part_names, 1000, true, false);
+
+    for (size_t i = 0; i < parts.size(); i++) {
+        if (!parts[i]) {
+            GetLog() << "Warning. Desired object " << part_names[i].c_str() << " not found in document \n";
+            continue;
+        }
+        my_system.Add(parts[i]);
+        // Move the body as for global displacement/rotation
+        parts[i]->ConcatenatePreTransformation(root_frame);
+    }
+
+    std::shared_ptr<ChBodyAuxRef> mrigidBody_base = parts[0];
+    std::shared_ptr<ChBodyAuxRef> mrigidBody_turret = parts[1];
+    std::shared_ptr<ChBodyAuxRef> mrigidBody_bicep = parts[2];
+    std::shared_ptr<ChBodyAuxRef> mrigidBody_elbow = parts[3];
+    std::shared_ptr<ChBodyAuxRef> mrigidBody_forearm = parts[4];
+    std::shared_ptr<ChBodyAuxRef> mrigidBody_wrist = parts[5];
+    std::shared_ptr<ChBodyAuxRef> mrigidBody_hand = parts[6];
+    std::shared_ptr<ChBodyAuxRef> mrigidBody_cylinder = parts[7];
+    std::shared_ptr<ChBodyAuxRef> mrigidBody_rod = parts[8];
+
+    // The base is fixed to the ground
+    if (mrigidBody_base)
+        mrigidBody_base->SetBodyFixed(true);
 
     if (!mrigidBody_base || !mrigidBody_turret || !mrigidBody_bicep || !mrigidBody_elbow || !mrigidBody_forearm ||
         !mrigidBody_wrist || !mrigidBody_hand) {
@@ -208,12 +136,8 @@ int main(int argc, char* argv[]) {
     // objects called 'marker' and we placed them aligned to the shafts, so now
     // we can fetch them and get their position/rotation.
 
-    TopoDS_Shape shape_marker;
-
     ChFrame<> frame_marker_base_turret;
-    if (mydoc.GetNamedShape(shape_marker, "Assem10/Assem8/marker#1"))
-        ChCascadeDoc::FromCascadeToChrono(shape_marker.Location(), frame_marker_base_turret);
-    else
+    if (!cache.GetFrame("Assem10/Assem8/marker#1", frame_marker_base_turret))
         GetLog() << "Warning. Desired marker not found in document \n";
     // Transform the abs coordinates of the marker because everything was rotated/moved by 'root_frame' :
     frame_marker_base_turret %= root_frame;
@@ -223,9 +147,7 @@ int main(int argc, char* argv[]) {
     my_system.AddLink(my_link1);
 
     ChFrame<> frame_marker_turret_bicep;
-    if (mydoc.GetNamedShape(shape_marker, "Assem10/Assem4/marker#2"))
-        ChCascadeDoc::FromCascadeToChrono(shape_marker.Location(), frame_marker_turret_bicep);
-    else
+    if (!cache.GetFrame("Assem10/Assem4/marker#2", frame_marker_turret_bicep))
         GetLog() << "Warning. Desired marker not found in document \n";
     frame_marker_turret_bicep %= root_frame;
 
@@ -234,9 +156,7 @@ int main(int argc, char* argv[]) {
     my_system.AddLink(my_link2);
 
     ChFrame<> frame_marker_bicep_elbow;
-    if (mydoc.GetNamedShape(shape_marker, "Assem10/Assem1/marker#2"))
-        ChCascadeDoc::FromCascadeToChrono(shape_marker.Location(), frame_marker_bicep_elbow);
-    else
+    if (!cache.GetFrame("Assem10/Assem1/marker#2", frame_marker_bicep_elbow))
         GetLog() << "Warning. Desired marker not found in document \n";
     frame_marker_bicep_elbow %= root_frame;
 
@@ -245,9 +165,7 @@ int main(int argc, char* argv[]) {
     my_system.AddLink(my_link3);
 
     ChFrame<> frame_marker_elbow_forearm;
-    if (mydoc.GetNamedShape(shape_marker, "Assem10/Assem5/marker#2"))
-        ChCascadeDoc::FromCascadeToChrono(shape_marker.Location(), frame_marker_elbow_forearm);
-    else
+    if (!cache.GetFrame("Assem10/Assem5/marker#2", frame_marker_elbow_forearm))
         GetLog() << "Warning. Desired marker not found in document \n";
     frame_marker_elbow_forearm %= root_frame;
 
@@ -256,9 +174,7 @@ int main(int argc, char* argv[]) {
     my_system.AddLink(my_link4);
 
     ChFrame<> frame_marker_forearm_wrist;
-    if (mydoc.GetNamedShape(shape_marker, "Assem10/Assem7/marker#2"))
-        ChCascadeDoc::FromCascadeToChrono(shape_marker.Location(), frame_marker_forearm_wrist);
-    else
+    if (!cache.GetFrame("Assem10/Assem7/marker#2", frame_marker_forearm_wrist))
         GetLog() << "Warning. Desired marker not found in document \n";
     frame_marker_forearm_wrist %= root_frame;
 
@@ -267,9 +183,7 @@ int main(int argc, char* argv[]) {
     my_system.AddLink(my_link5);
 
     ChFrame<> frame_marker_wrist_hand;
-    if (mydoc.GetNamedShape(shape_marker, "Assem10/Assem6/marker#2"))
-        ChCascadeDoc::FromCascadeToChrono(shape_marker.Location(), frame_marker_wrist_hand);
-    else
+    if (!cache.GetFrame("Assem10/Assem6/marker#2", frame_marker_wrist_hand))
         GetLog() << "Warning. Desired marker not found in document \n";
     frame_marker_wrist_hand %= root_frame;
 
@@ -278,9 +192,7 @@ int main(int argc, char* argv[]) {
     my_system.AddLink(my_link6);
 
     ChFrame<> frame_marker_turret_cylinder;
-    if (mydoc.GetNamedShape(shape_marker, "Assem10/Assem4/marker#3"))
-        ChCascadeDoc::FromCascadeToChrono(shape_marker.Location(), frame_marker_turret_cylinder);
-    else
+    if (!cache.GetFrame("Assem10/Assem4/marker#3", frame_marker_turret_cylinder))
         GetLog() << "Warning. Desired marker not found in document \n";
     frame_marker_turret_cylinder %= root_frame;
 
@@ -289,9 +201,7 @@ int main(int argc, char* argv[]) {
     my_system.AddLink(my_link7);
 
     ChFrame<> frame_marker_cylinder_rod;
-    if (mydoc.GetNamedShape(shape_marker, "Assem10/Assem3/marker#2"))
-        ChCascadeDoc::FromCascadeToChrono(shape_marker.Location(), frame_marker_cylinder_rod);
-    else
+    if (!cache.GetFrame("Assem10/Assem3/marker#2", frame_marker_cylinder_rod))
         GetLog() << "Warning. Desired marker not found in document \n";
     frame_marker_cylinder_rod %= root_frame;
 
@@ -300,9 +210,7 @@ int main(int argc, char* argv[]) {
     my_system.AddLink(my_link8);
 
     ChFrame<> frame_marker_rod_bicep;
-    if (mydoc.GetNamedShape(shape_marker, "Assem10/Assem2/marker#2"))
-        ChCascadeDoc::FromCascadeToChrono(shape_marker.Location(), frame_marker_rod_bicep);
-    else
+    if (!cache.GetFrame("Assem10/Assem2/marker#2", frame_marker_rod_bicep))
         GetLog() << "Warning. Desired marker not found in document \n";
     frame_marker_rod_bicep %= root_frame;
 
@@ -310,6 +218,11 @@ int main(int argc, char* argv[]) {
     my_link9->Initialize(mrigidBody_rod, mrigidBody_bicep, frame_marker_rod_bicep.GetCoord());
     my_system.AddLink(my_link9);
 
+    timer_load.stop();
+    GetLog() << "Robot loaded in " << timer_load() << " s (" << cache.GetNumHits() << " cached parts and markers, "
+             << cache.GetNumMisses() << " computed; STEP file " << (cache.IsDocumentLoaded() ? "parsed" : "not parsed")
+             << ")\n";
+
     // Add a couple of markers for the 'lock' constraint between the hand and the
     // absolute reference: when we will move the marker in absolute reference, the
     // hand will follow it.
@@ -13,8 +13,19 @@
 // =============================================================================
 //
 // ChronoFEA demo program for thermal analysis (uses Irrlicht for visualization)
+//
+// Command line options:
+//   -lu      use a sparse LU solver which keeps its factorization while the
+//            (constant) conductivity matrix does not change (the default is
+//            MINRES); see sparse_lu_reuse.h
+//   -lock    with -lu, reuse the first factorization for all steps, without
+//            reassembling the matrix
+//   -static  solve for the steady-state solution (DoStaticLinear), then only
+//            display it
 // =============================================================================
 
+#include <cstring>
+
 #include "chrono/physics/ChSystemNSC.h"
 #include "chrono/solver/ChIterativeSolverLS.h"
 
@@ -34,6 +45,8 @@
 
 #include "chrono_irrlicht/ChIrrApp.h"
 
+#include "sparse_lu_reuse.h"
+
 using namespace chrono;
 using namespace chrono::irrlicht;
 using namespace chrono::fea;
@@ -44,6 +57,18 @@ int main(int argc, char* argv[]) {
     // Set path to Chrono data directory
     SetChronoDataPath(CHRONO_DATA_DIR);
 
+    bool use_lu = false;
+    bool lock = false;
+    bool static_solve = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-lu") == 0)
+            use_lu = true;
+        else if (std::strcmp(argv[i], "-lock") == 0)
+            lock = true;
+        else if (std::strcmp(argv[i], "-static") == 0)
+            static_solve = true;
+    }
+
     // Create a Chrono::Engine physical system
     ChSystemNSC my_system;
 
@@ -164,34 +189,61 @@ int main(int argc, char* argv[]) {
     // THE SOFT-REAL-TIME CYCLE
     //
 
-    auto solver = chrono_types::make_shared<ChSolverMINRES>();
-    solver->EnableWarmStart(true);
-    solver->SetMaxIterations(160);
-    my_system.SetSolver(solver);
+    std::shared_ptr<ChSolverSparseLUReuse> lu_solver;
+    if (use_lu) {
+        // The conductivity (and capacity) matrix is constant: factorize once and reuse
+        lu_solver = chrono_types::make_shared<ChSolverSparseLUReuse>();
+        lu_solver->SetMatrixLock(lock);
+        my_system.SetSolver(lu_solver);
+    } else {
+        auto solver = chrono_types::make_shared<ChSolverMINRES>();
+        solver->EnableWarmStart(true);
+        solver->SetMaxIterations(160);
+        my_system.SetSolver(solver);
+    }
 
     my_system.SetTimestepperType(ChTimestepper::Type::EULER_IMPLICIT_LINEARIZED);  // fast, less precise
 
     // Note: if you are interested only in a single LINEAR STATIC solution
     // (not a transient thermal solution, but rather the steady-state solution),
-    // at this point you can uncomment the following line:
-    //
-    //	 my_system.DoStaticLinear();
-    //
-    // Also, in the following while() loop, remove  application.DoStep();
-    // so you can spin the 3D view and look at the solution.
+    // use the -static option: the system is solved with DoStaticLinear() and
+    // the loop does not step, so you can spin the 3D view and look at the solution.
+
+    if (static_solve) {
+        my_system.DoStaticLinear();
+        GetLog() << "Static solution: setup " << my_system.GetTimerSetup() << " s, solve "
+                 << my_system.GetTimerSolver() << " s\n";
+    }
 
     application.SetTimestep(0.01);
 
+    int num_steps = 0;
+    double time_setup = 0;
+    double time_solve = 0;
+
     while (application.GetDevice()->run()) {
         application.BeginScene();
 
         application.DrawAll();
 
-        application.DoStep();
+        if (!static_solve) {
+            application.DoStep();
+            num_steps++;
+            time_setup += my_system.GetTimerSetup();
+            time_solve += my_system.GetTimerSolver();
+        }
 
         application.EndScene();
     }
 
+    if (num_steps > 0) {
+        GetLog() << num_steps << " steps: setup " << time_setup << " s, solve " << time_solve << " s\n";
+    }
+    if (lu_solver) {
+        GetLog() << "LU factorizations: " << lu_solver->GetNumFactorizations()
+                 << ", reused: " << lu_solver->GetNumReuses() << "\n";
+    }
+
     // Print some node temperatures..
     for (unsigned int inode = 0; inode < my_mesh->GetNnodes(); ++inode) {
         if (auto mnode = std::dynamic_pointer_cast<ChNodeFEAxyzP>(my_mesh->GetNode(inode))) {
@@ -0,0 +1,137 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Sparse LU direct solver reusing its factorization while the system matrix
+// does not change.
+//
+// For linear problems (e.g., linear thermal or electrostatic FEA, statics or
+// transient with a fixed step) the matrix assembled at each Setup call is the
+// same, yet a direct solver refactorizes it every time. ChSolverSparseLUReuse
+// compares the assembled matrix with the factorized one (sparsity pattern and
+// values, bit for bit) and factorizes only if it changed; the symbolic analysis
+// is repeated only if the sparsity pattern changed. Solve assembles only the
+// right-hand side.
+//
+// With SetMatrixLock(true), the matrix is assumed constant after the first
+// factorization: later Setup calls return immediately, skipping the matrix
+// assembly as well (use only when nothing that enters the matrix changes,
+// i.e. constant material properties, constant step, and no change in the
+// fixed nodes or constraints).
+//
+// =============================================================================
+
+#ifndef SPARSE_LU_REUSE_H
+#define SPARSE_LU_REUSE_H
+
+#include <algorithm>
+#include <iostream>
+
+#include <Eigen/SparseLU>
+
+#include "chrono/core/ChSparseMatrix.h"
+#include "chrono/solver/ChSolverLS.h"
+#include "chrono/solver/ChSystemDescriptor.h"
+
+namespace chrono {
+
+class ChSolverSparseLUReuse : public ChSolverLS {
+  public:
+    ChSolverSparseLUReuse() : m_lock(false), m_factorized(false), m_num_factorizations(0), m_num_reuses(0) {}
+
+    virtual bool IsIterative() const override { return false; }
+    virtual bool IsDirect() const override { return true; }
+    virtual bool SolveRequiresMatrix() const override { return true; }
+
+    /// Assume the matrix constant after the first factorization (default: false).
+    void SetMatrixLock(bool lock) { m_lock = lock; }
+
+    /// Discard the factorization; the next Setup assembles and factorizes again.
+    void Reset() { m_factorized = false; }
+
+    /// Return the number of numerical factorizations.
+    int GetNumFactorizations() const { return m_num_factorizations; }
+
+    /// Return the number of Setup calls which reused the factorization.
+    int GetNumReuses() const { return m_num_reuses; }
+
+    virtual bool Setup(ChSystemDescriptor& sysd) override {
+        sysd.UpdateCountsAndOffsets();
+        int dim = sysd.CountActiveVariables() + sysd.CountActiveConstraints();
+
+        if (m_factorized && m_lock && dim == m_mat.rows()) {
+            m_num_reuses++;
+            return true;
+        }
+
+        // Assemble in the work matrix (which keeps the sparsity pattern of the previous assembly)
+        sysd.ConvertToMatrixForm(&m_work, nullptr);
+        m_work.makeCompressed();
+
+        if (m_factorized && SamePattern(m_work, m_mat) && SameValues(m_work, m_mat)) {
+            m_num_reuses++;
+            return true;
+        }
+
+        bool analyze = !m_factorized || !SamePattern(m_work, m_mat);
+        m_mat = m_work;
+        Eigen::SparseMatrix<double, Eigen::ColMajor> lu_mat = m_mat;  // SparseLU requires a column-major matrix
+        if (analyze)
+            m_lu.analyzePattern(lu_mat);
+        m_lu.factorize(lu_mat);
+        m_num_factorizations++;
+
+        m_factorized = (m_lu.info() == Eigen::Success);
+        if (!m_factorized) {
+            if (verbose)
+                std::cout << "ChSolverSparseLUReuse: factorization failed: " << m_lu.lastErrorMessage() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    virtual double Solve(ChSystemDescriptor& sysd) override {
+        if (!m_factorized)
+            return -1;
+        sysd.UpdateCountsAndOffsets();
+        sysd.ConvertToMatrixForm(nullptr, &m_rhs);
+        m_sol = m_lu.solve(m_rhs);
+        sysd.FromVectorToUnknowns(m_sol);
+        return 0;
+    }
+
+  private:
+    static bool SamePattern(const ChSparseMatrix& A, const ChSparseMatrix& B) {
+        if (A.rows() != B.rows() || A.cols() != B.cols() || A.nonZeros() != B.nonZeros())
+            return false;
+        return std::equal(A.outerIndexPtr(), A.outerIndexPtr() + A.outerSize() + 1, B.outerIndexPtr()) &&
+               std::equal(A.innerIndexPtr(), A.innerIndexPtr() + A.nonZeros(), B.innerIndexPtr());
+    }
+
+    static bool SameValues(const ChSparseMatrix& A, const ChSparseMatrix& B) {
+        return std::equal(A.valuePtr(), A.valuePtr() + A.nonZeros(), B.valuePtr());
+    }
+
+    bool m_lock;
+    bool m_factorized;
+    int m_num_factorizations;
+    int m_num_reuses;
+
+    ChSparseMatrix m_work;  // matrix assembled at the last Setup
+    ChSparseMatrix m_mat;   // factorized matrix
+    Eigen::SparseLU<Eigen::SparseMatrix<double, Eigen::ColMajor>, Eigen::COLAMDOrdering<int>> m_lu;
+    ChVectorDynamic<double> m_rhs;
+    ChVectorDynamic<double> m_sol;
+};
+
+}  // end namespace chrono
+
+#endif
@@ -30,6 +30,8 @@
 #include "chrono_fsi/utils/ChUtilsJSON.h"
 #include "chrono_fsi/utils/ChUtilsPrintSph.cuh"
 
+#include "sph_frame_writer.h"
+
 #define AddBoundaries
 
 // Chrono namespaces
@@ -44,6 +46,11 @@ std::ofstream simParams;
 const std::string out_dir = GetChronoOutputPath() + "FSI_CYLINDER_DROP/";
 std::string demo_dir;
 bool pv_output = true;
+/// Write the SPH markers with SphFrameWriter (binary VTK, asynchronous) instead of fsi::utils::PrintToFile (CSV)
+bool sph_binary_output = true;
+int sph_output_stride = 1;
+int sph_output_fields = SphFrameWriter::VELOCITY | SphFrameWriter::DENSITY | SphFrameWriter::PRESSURE |
+                        SphFrameWriter::MARKER_TYPE;
 typedef fsi::Real Real;
 
 /// Dimensions of the cylinder, fluid and boundary
@@ -67,7 +74,8 @@ void SaveParaViewFiles(fsi::ChSystemFsi& myFsiSystem,
                        std::shared_ptr<fsi::SimParams> paramsH,
                        int tStep,
                        double mTime,
-                       std::shared_ptr<ChBody> Cylinder);
+                       std::shared_ptr<ChBody> Cylinder,
+                       SphFrameWriter* sph_writer);
 
 //------------------------------------------------------------------
 // Create the objects of the MBD system. Rigid bodies, and if fsi, their
@@ -260,7 +268,11 @@ int main(int argc, char* argv[]) {
     /// Get the body from the FSI system
     std::vector<std::shared_ptr<ChBody>>& FSI_Bodies = myFsiSystem.GetFsiBodies();
     auto Cylinder = FSI_Bodies[0];
-    SaveParaViewFiles(myFsiSystem, mphysicalSystem, paramsH, 0, 0, Cylinder);
+
+    std::unique_ptr<SphFrameWriter> sph_writer;
+    if (sph_binary_output)
+        sph_writer = std::unique_ptr<SphFrameWriter>(new SphFrameWriter(sph_output_fields, sph_output_stride));
+    SaveParaViewFiles(myFsiSystem, mphysicalSystem, paramsH, 0, 0, Cylinder, sph_writer.get());
 
     Real time = 0;
     Real Global_max_dT = paramsH->dT_Max;
@@ -277,7 +289,7 @@ int main(int argc, char* argv[]) {
 
         myFsiSystem.DoStepDynamics_FSI();
         time += paramsH->dT;
-        SaveParaViewFiles(myFsiSystem, mphysicalSystem, paramsH, next_frame, time, Cylinder);
+        SaveParaViewFiles(myFsiSystem, mphysicalSystem, paramsH, next_frame, time, Cylinder, sph_writer.get());
 
         auto bin = mphysicalSystem.Get_bodylist()[0];
         auto cyl = mphysicalSystem.Get_bodylist()[1];
@@ -289,6 +301,12 @@ int main(int argc, char* argv[]) {
             break;
     }
 
+    if (sph_writer) {
+        double enqueue_time = sph_writer->GetEnqueueTime();
+        sph_writer.reset();  // wait for the pending frames
+        cout << "SPH output: " << enqueue_time << " s on the simulation thread" << endl;
+    }
+
     return 0;
 }
 
@@ -300,19 +318,28 @@ void SaveParaViewFiles(fsi::ChSystemFsi& myFsiSystem,
                        std::shared_ptr<fsi::SimParams> paramsH,
                        int next_frame,
                        double mTime,
-                       std::shared_ptr<ChBody> Cylinder) {
+                       std::shared_ptr<ChBody> Cylinder,
+                       SphFrameWriter* sph_writer) {
     int out_steps = (int)ceil((1.0 / paramsH->dT) / paramsH->out_fps);
     int num_contacts = mphysicalSystem.GetNcontacts();
     double frame_time = 1.0 / paramsH->out_fps;
     static int out_frame = 0;
 
     if (pv_output && std::abs(mTime - (next_frame)*frame_time) < 1e-7) {
-        fsi::utils::PrintToFile(myFsiSystem.GetDataManager()->sphMarkersD2->posRadD,
-                                myFsiSystem.GetDataManager()->sphMarkersD2->velMasD,
-                                myFsiSystem.GetDataManager()->sphMarkersD2->rhoPresMuD,
-                                myFsiSystem.GetDataManager()->fsiGeneralData->sr_tau_I_mu_i,
-                                myFsiSystem.GetDataManager()->fsiGeneralData->referenceArray,
-                                myFsiSystem.GetDataManager()->fsiGeneralData->referenceArray_FEA, demo_dir, true);
+        if (sph_writer) {
+            char SaveAsMarkersVTK[256];
+            snprintf(SaveAsMarkersVTK, sizeof(char) * 256, (demo_dir + "/markers.%d.vtk").c_str(), out_frame);
+            sph_writer->Write(myFsiSystem.GetDataManager()->sphMarkersD2->posRadD,
+                              myFsiSystem.GetDataManager()->sphMarkersD2->velMasD,
+                              myFsiSystem.GetDataManager()->sphMarkersD2->rhoPresMuD, mTime, SaveAsMarkersVTK);
+        } else {
+            fsi::utils::PrintToFile(myFsiSystem.GetDataManager()->sphMarkersD2->posRadD,
+                                    myFsiSystem.GetDataManager()->sphMarkersD2->velMasD,
+                                    myFsiSystem.GetDataManager()->sphMarkersD2->rhoPresMuD,
+                                    myFsiSystem.GetDataManager()->fsiGeneralData->sr_tau_I_mu_i,
+                                    myFsiSystem.GetDataManager()->fsiGeneralData->referenceArray,
+                                    myFsiSystem.GetDataManager()->fsiGeneralData->referenceArray_FEA, demo_dir, true);
+        }
         char SaveAsRigidObjVTK[256];  // The filename buffer.
         static int RigidCounter = 0;
 
@@ -0,0 +1,354 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Asynchronous binary output of the SPH markers of a Chrono::FSI system, as a
+// fast alternative to fsi::utils::PrintToFile (synchronous device-to-host copy
+// of all markers and CSV text output at each frame).
+//
+// SphFrameWriter::Write only enqueues asynchronous copies of the selected
+// marker arrays (device vectors of the FSI data manager) into pinned host
+// staging buffers, on a dedicated CUDA stream. The copies are ordered after
+// the kernels already launched on the default stream, and the next kernels
+// wait for them (legacy default stream semantics), so the marker data cannot
+// change while being copied. A background thread waits for the copies of each
+// frame and writes the file. The simulation thread blocks only if all staging
+// buffers are waiting to be written.
+//
+// The output can be restricted to a range of markers (e.g. the fluid markers),
+// subsampled (every n-th marker, gathered by the copy engine with a strided
+// 2D copy), and limited to the selected fields. Positions are always written.
+//
+// Each frame is a legacy VTK binary POLYDATA file (big-endian, readable by
+// ParaView and VisIt) with one vertex per marker and one named point data array
+// per field: "h" (kernel length), "velocity", "density", "pressure",
+// "viscosity", "type".
+//
+// =============================================================================
+
+#ifndef SPH_FRAME_WRITER_H
+#define SPH_FRAME_WRITER_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cuda_runtime.h>
+#include <thrust/device_vector.h>
+
+class SphFrameWriter {
+  public:
+    /// Marker fields that can be written (in addition to the positions).
+    enum Field {
+        KERNEL_LENGTH = 1 << 0,
+        VELOCITY = 1 << 1,
+        DENSITY = 1 << 2,
+        PRESSURE = 1 << 3,
+        VISCOSITY = 1 << 4,
+        MARKER_TYPE = 1 << 5,
+        ALL_FIELDS = (1 << 6) - 1
+    };
+
+    /// Create the staging buffers and start the writer thread. Write the given fields of every stride-th marker.
+    SphFrameWriter(int fields = VELOCITY | DENSITY | PRESSURE, int stride = 1, int num_buffers = 2)
+        : m_fields(fields),
+          m_stride(std::max(stride, 1)),
+          m_first(0),
+          m_count(-1),
+          m_exit(false),
+          m_num_frames(0),
+          m_enqueue_time(0),
+          m_write_time(0) {
+        cudaStreamCreate(&m_stream);
+        m_free.resize(std::max(num_buffers, 1));
+        for (auto& frame : m_free)
+            frame = std::unique_ptr<Frame>(new Frame);
+        m_thread = std::thread(&SphFrameWriter::Loop, this);
+    }
+
+    /// Write all pending frames, stop the writer thread, and release the staging buffers.
+    ~SphFrameWriter() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_exit = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+        cudaStreamDestroy(m_stream);
+    }
+
+    /// Write only the markers in [first, first + count) (default: all markers).
+    void SetMarkerRange(size_t first, size_t count) {
+        m_first = first;
+        m_count = (long long)count;
+    }
+
+    /// Enqueue the output of the markers (positions and kernel lengths, velocities, densities, pressures,
+    /// viscosities, and types, as in the FSI data manager) to the given file.
+    template <typename Real4, typename Real3>
+    void Write(const thrust::device_vector<Real4>& posRad,
+               const thrust::device_vector<Real3>& velMas,
+               const thrust::device_vector<Real4>& rhoPresMu,
+               double time,
+               const std::string& filename) {
+        auto start = std::chrono::steady_clock::now();
+
+        size_t first = std::min(m_first, posRad.size());
+        size_t count = m_count < 0 ? posRad.size() - first : std::min((size_t)m_count, posRad.size() - first);
+        size_t n = (count + m_stride - 1) / m_stride;
+
+        // Get a free staging buffer (waiting for the writer thread if none is available)
+        std::unique_ptr<Frame> frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return !m_free.empty(); });
+            frame = std::move(m_free.back());
+            m_free.pop_back();
+        }
+
+        frame->filename = filename;
+        frame->time = time;
+        frame->num_markers = n;
+        frame->real_size = sizeof(Real4) / 4;
+        frame->fields = m_fields;
+        bool need_vel = (m_fields & VELOCITY) != 0;
+        bool need_rpm = (m_fields & (DENSITY | PRESSURE | VISCOSITY | MARKER_TYPE)) != 0;
+        frame->pos.Reserve(n * sizeof(Real4));
+        if (need_vel)
+            frame->vel.Reserve(n * sizeof(Real3));
+        if (need_rpm)
+            frame->rpm.Reserve(n * sizeof(Real4));
+
+        if (n > 0) {
+            Copy(frame->pos.data, thrust::raw_pointer_cast(posRad.data()) + first, n);
+            if (need_vel)
+                Copy(frame->vel.data, thrust::raw_pointer_cast(velMas.data()) + first, n);
+            if (need_rpm)
+                Copy(frame->rpm.data, thrust::raw_pointer_cast(rhoPresMu.data()) + first, n);
+        }
+        cudaEventRecord(frame->copied, m_stream);
+
+        // Hand the buffer over to the writer thread
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(std::move(frame));
+        }
+        m_cv.notify_all();
+        m_num_frames++;
+        m_enqueue_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /// Return the number of frames queued so far.
+    int GetNumFrames() const { return m_num_frames; }
+
+    /// Return the time spent by the simulation thread in Write so far (in seconds).
+    double GetEnqueueTime() const { return m_enqueue_time; }
+
+    /// Return the time spent by the writer thread waiting for the copies and writing files so far (in seconds).
+    double GetWriteTime() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_write_time;
+    }
+
+  private:
+    // Pinned host buffer
+    struct Buffer {
+        void* data;
+        size_t capacity;
+        Buffer() : data(nullptr), capacity(0) {}
+        ~Buffer() {
+            if (data)
+                cudaFreeHost(data);
+        }
+        void Reserve(size_t bytes) {
+            if (bytes <= capacity)
+                return;
+            if (data)
+                cudaFreeHost(data);
+            capacity = std::max(bytes, capacity + capacity / 2);
+            if (cudaMallocHost(&data, capacity) != cudaSuccess) {
+                data = nullptr;
+                capacity = 0;
+            }
+        }
+    };
+
+    struct Frame {
+        std::string filename;
+        double time;
+        size_t num_markers;
+        size_t real_size;  // sizeof(Real)
+        int fields;
+        Buffer pos;  // Real4 (x, y, z, h)
+        Buffer vel;  // Real3
+        Buffer rpm;  // Real4 (density, pressure, viscosity, type)
+        cudaEvent_t copied;
+        Frame() { cudaEventCreateWithFlags(&copied, cudaEventDisableTiming); }
+        ~Frame() { cudaEventDestroy(copied); }
+    };
+
+    // Asynchronous copy of every stride-th element of a device array
+    template <typename T>
+    void Copy(void* dst, const T* src, size_t n) {
+        if (!dst)
+            return;
+        if (m_stride == 1)
+            cudaMemcpyAsync(dst, src, n * sizeof(T), cudaMemcpyDeviceToHost, m_stream);
+        else
+            cudaMemcpy2DAsync(dst, sizeof(T), src, m_stride * sizeof(T), sizeof(T), n, cudaMemcpyDeviceToHost,
+                              m_stream);
+    }
+
+    void Loop() {
+        while (true) {
+            std::unique_ptr<Frame> frame;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]() { return !m_queue.empty() || m_exit; });
+                if (m_queue.empty())
+                    return;
+                frame = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            auto start = std::chrono::steady_clock::now();
+            cudaEventSynchronize(frame->copied);
+            if (frame->real_size == sizeof(double))
+                WriteFile<double>(*frame);
+            else
+                WriteFile<float>(*frame);
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_free.push_back(std::move(frame));
+                m_write_time += elapsed;
+            }
+            m_cv.notify_all();
+        }
+    }
+
+    // Big-endian copy of a value (legacy VTK binary files are big-endian)
+    template <typename T>
+    static void PutBigEndian(T value, unsigned char* out) {
+        unsigned char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        const uint16_t probe = 1;
+        bool little = *(const unsigned char*)&probe == 1;
+        for (size_t k = 0; k < sizeof(T); k++)
+            out[k] = little ? bytes[sizeof(T) - 1 - k] : bytes[k];
+    }
+
+    // Write the given components of n records of stride values of type Real, converted to big-endian
+    template <typename Real>
+    static void WriteComponents(FILE* file,
+                                const void* data,
+                                size_t n,
+                                size_t stride,
+                                size_t first_component,
+                                size_t num_components) {
+        const Real* values = (const Real*)data;
+        std::vector<unsigned char> buffer((size_t)1 << 16);
+        size_t used = 0;
+        for (size_t i = 0; i < n; i++) {
+            for (size_t k = 0; k < num_components; k++) {
+                if (used + sizeof(Real) > buffer.size()) {
+                    fwrite(buffer.data(), 1, used, file);
+                    used = 0;
+                }
+                PutBigEndian(values[i * stride + first_component + k], &buffer[used]);
+                used += sizeof(Real);
+            }
+        }
+        fwrite(buffer.data(), 1, used, file);
+    }
+
+    template <typename Real>
+    void WriteFile(const Frame& frame) {
+        FILE* file = fopen(frame.filename.c_str(), "wb");
+        if (!file) {
+            std::cout << "Error opening output file " << frame.filename << std::endl;
+            return;
+        }
+        if (frame.num_markers > 0 && !frame.pos.data) {
+            std::cout << "Error allocating pinned staging buffers for " << frame.filename << std::endl;
+            fclose(file);
+            return;
+        }
+
+        const char* type = sizeof(Real) == sizeof(double) ? "double" : "float";
+        size_t n = frame.num_markers;
+        fprintf(file, "# vtk DataFile Version 3.0\nSPH markers, time %.9g\nBINARY\nDATASET POLYDATA\n", frame.time);
+        fprintf(file, "POINTS %zu %s\n", n, type);
+        WriteComponents<Real>(file, frame.pos.data, n, 4, 0, 3);
+
+        // One vertex cell per marker
+        fprintf(file, "\nVERTICES %zu %zu\n", n, 2 * n);
+        std::vector<unsigned char> cells(8 * std::min(n, (size_t)8192));
+        for (size_t i = 0; i < n;) {
+            size_t m = std::min(n - i, cells.size() / 8);
+            for (size_t j = 0; j < m; j++) {
+                PutBigEndian((int32_t)1, &cells[8 * j]);
+                PutBigEndian((int32_t)(i + j), &cells[8 * j + 4]);
+            }
+            fwrite(cells.data(), 1, 8 * m, file);
+            i += m;
+        }
+
+        fprintf(file, "\nPOINT_DATA %zu\n", n);
+        if (frame.fields & KERNEL_LENGTH) {
+            fprintf(file, "SCALARS h %s 1\nLOOKUP_TABLE default\n", type);
+            WriteComponents<Real>(file, frame.pos.data, n, 4, 3, 1);
+            fprintf(file, "\n");
+        }
+        if ((frame.fields & VELOCITY) && frame.vel.data) {
+            fprintf(file, "VECTORS velocity %s\n", type);
+            WriteComponents<Real>(file, frame.vel.data, n, 3, 0, 3);
+            fprintf(file, "\n");
+        }
+        const char* names[4] = {"density", "pressure", "viscosity", "type"};
+        const int flags[4] = {DENSITY, PRESSURE, VISCOSITY, MARKER_TYPE};
+        for (int k = 0; k < 4; k++) {
+            if (!(frame.fields & flags[k]) || !frame.rpm.data)
+                continue;
+            fprintf(file, "SCALARS %s %s 1\nLOOKUP_TABLE default\n", names[k], type);
+            WriteComponents<Real>(file, frame.rpm.data, n, 4, k, 1);
+            fprintf(file, "\n");
+        }
+        fclose(file);
+    }
+
+    int m_fields;
+    size_t m_stride;
+    size_t m_first;
+    long long m_count;  // negative: all markers from m_first
+    cudaStream_t m_stream;
+
+    std::vector<std::unique_ptr<Frame>> m_free;  // staging buffers available to the simulation thread
+    std::deque<std::unique_ptr<Frame>> m_queue;  // staging buffers waiting to be written
+    bool m_exit;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+    int m_num_frames;
+    double m_enqueue_time;
+    double m_write_time;
+};
+
+#endif
@@ -16,6 +16,7 @@
 // in Chrono::Gpu via the co-simulation framework.
 // =============================================================================
 
+#include <chrono>
 #include <iostream>
 #include <vector>
 #include <string>
@@ -36,6 +37,8 @@
 
 #include "chrono_thirdparty/filesystem/path.h"
 
+#include "projects/gpu_tests/GpuDemoUtils.h"
+
 using namespace chrono;
 using namespace chrono::gpu;
 
@@ -46,6 +49,10 @@ float out_fps = 50;
 bool render = true;
 float render_fps = 2000;
 
+// Advance the ball while the granular step runs on the GPU (the ball step of an interval uses the contact forces of
+// the previous interval in both modes)
+bool async_advance = true;
+
 void writeMeshFrames(std::ostringstream& outstream, ChBody& body, std::string obj_name, float mesh_scaling) {
     outstream << obj_name << ",";
 
@@ -214,7 +221,8 @@ int main(int argc, char* argv[]) {
     int currframe = 0;
     unsigned int curr_step = 0;
 
-    clock_t start = std::clock();
+    GpuAsyncAdvance<ChSystemGpuMesh> gpu_advance(gpu_sys);
+    auto start = std::chrono::steady_clock::now();
     for (double t = 0; t < (double)params.time_end; t += iteration_step, curr_step++) {
         gpu_sys.ApplyMeshMotion(0, ball_body->GetPos(), ball_body->GetRot(), ball_body->GetPos_dt(),
                                 ball_body->GetWvel_par());
@@ -249,14 +257,22 @@ int main(int argc, char* argv[]) {
                 break;
         }
 
-        gpu_sys.AdvanceSimulation(iteration_step);
-        sys_ball.DoStepDynamics(iteration_step);
+        if (async_advance) {
+            // The granular system can only be accessed again once the step completes
+            auto gpu_step = gpu_advance.AdvanceSimulationAsync(iteration_step);
+            sys_ball.DoStepDynamics(iteration_step);
+            gpu_advance.Wait(gpu_step);
+        } else {
+            gpu_sys.AdvanceSimulation(iteration_step);
+            sys_ball.DoStepDynamics(iteration_step);
+        }
     }
 
-    clock_t end = std::clock();
-    double total_time = ((double)(end - start)) / CLOCKS_PER_SEC;
+    double total_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
     std::cout << "Time: " << total_time << " seconds" << std::endl;
+    if (async_advance)
+        std::cout << "Waiting for GPU: " << gpu_advance.GetWaitTime() << " seconds" << std::endl;
 
     return 0;
 }
@@ -0,0 +1,240 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Irrlicht rendering decoupled from the physics rate.
+//
+// In the usual DrawAll/DoStep/EndScene loop every physics step waits for a
+// frame to be drawn (and for vsync), and every frame waits for a step. With a
+// DecoupledRenderer, the physics system is advanced freely on a separate
+// thread, while the main thread draws at a target frame rate.
+//
+// The renderer keeps its own (never integrated) system with one fixed proxy
+// body per physics body, sharing the visual assets of that body. The Irrlicht
+// application is bound to this render system, so drawing never reads the
+// physics system. After each step, the physics thread checks whether the
+// render thread asked for a new snapshot and, if so, copies the body poses
+// under a mutex (one copy per drawn frame, not per step). Before each frame,
+// the render thread moves the proxies to the latest snapshot.
+//
+// Frames can be captured to an image sequence (one BMP per frame, read back
+// with createScreenShot). On machines without a display, run the program under
+// a virtual frame buffer (e.g., xvfb-run). At the end of a run, the physics
+// rate (steps/s and real-time factor) and the render rate are reported.
+//
+// Only the visual assets of bodies are rendered (assets of links and other
+// physics items are not mirrored). The visual assets must not be modified
+// while the physics thread runs.
+//
+// Typical use:
+//   DecoupledRenderer renderer;
+//   renderer.Initialize(system);                      // after creating the bodies
+//   ChIrrApp application(&renderer.GetRenderSystem(), ...);
+//   application.AssetBindAll();
+//   application.AssetUpdateAll();
+//   renderer.Run(application, [&]() { system.DoStepDynamics(step); });
+//
+// =============================================================================
+
+#ifndef DECOUPLED_RENDER_H
+#define DECOUPLED_RENDER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chrono/core/ChTimer.h"
+#include "chrono/physics/ChSystemNSC.h"
+
+#include "chrono_irrlicht/ChIrrApp.h"
+
+#include "chrono_thirdparty/filesystem/path.h"
+
+class DecoupledRenderer {
+  public:
+    DecoupledRenderer()
+        : m_system(nullptr), m_request(true), m_fresh(false), m_time(0), m_fps(60), m_duration(0), m_num_steps(0) {}
+
+    /// Create the render proxies of all bodies of the physics system.
+    /// Must be called after all bodies were created, and before binding the Irrlicht assets.
+    void Initialize(chrono::ChSystem& system) {
+        m_system = &system;
+        for (auto body : system.Get_bodylist()) {
+            auto proxy = chrono_types::make_shared<chrono::ChBody>();
+            proxy->SetIdentifier(body->GetIdentifier());
+            proxy->SetBodyFixed(true);
+            proxy->SetCollide(false);
+            proxy->SetCoord(body->GetCoord());
+            for (auto asset : body->GetAssets())
+                proxy->AddAsset(asset);
+            m_render_sys.AddBody(proxy);
+            m_bodies.push_back(body);
+            m_proxies.push_back(proxy);
+        }
+        m_poses.resize(m_bodies.size());
+        m_time = system.GetChTime();
+        m_render_sys.SetChTime(m_time);
+    }
+
+    /// Return the system to bind the Irrlicht application to.
+    chrono::ChSystem& GetRenderSystem() { return m_render_sys; }
+
+    /// Set the target render frame rate (default: 60).
+    void SetFPS(double fps) { m_fps = fps; }
+
+    /// Stop the run when the physics system reaches the given time (default: 0, run until the window is closed).
+    void SetDuration(double duration) { m_duration = duration; }
+
+    /// Capture the frames to an image sequence in the given directory (default: no capture).
+    void SetCaptureDir(const std::string& dir) { m_capture_dir = dir; }
+
+    /// Called by the physics thread after each step: copy the body poses if the render thread requested them.
+    void Publish() {
+        if (!m_request.load(std::memory_order_acquire))
+            return;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < m_bodies.size(); i++)
+            m_poses[i] = m_bodies[i]->GetCoord();
+        m_time = m_system->GetChTime();
+        m_fresh = true;
+        m_request.store(false, std::memory_order_release);
+    }
+
+    /// Called by the render thread before drawing: move the proxies to the latest snapshot, and request the next one.
+    /// Return false if no new snapshot was published since the last call.
+    bool Update() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        bool fresh = m_fresh;
+        if (fresh) {
+            for (size_t i = 0; i < m_proxies.size(); i++)
+                m_proxies[i]->SetCoord(m_poses[i]);
+            m_render_sys.SetChTime(m_time);
+            m_fresh = false;
+        }
+        m_request.store(true, std::memory_order_release);
+        return fresh;
+    }
+
+    /// Return the physics time of the snapshot currently rendered.
+    double GetTime() const { return m_render_sys.GetChTime(); }
+
+    /// Advance the physics system with the given step function on a separate thread, and draw at the target frame rate
+    /// until the window is closed or the duration is reached. The optional draw function is called after DrawAll, with
+    /// the physics time of the rendered snapshot, for overlays (grids, text).
+    void Run(chrono::irrlicht::ChIrrApp& application,
+             std::function<void()> step,
+             std::function<void(double time)> draw = nullptr) {
+        if (!m_capture_dir.empty() && !filesystem::create_directory(filesystem::path(m_capture_dir))) {
+            std::cout << "Error creating directory " << m_capture_dir << "; frames are not captured" << std::endl;
+            m_capture_dir.clear();
+        }
+
+        std::atomic<bool> stop(false);
+        std::atomic<bool> physics_done(false);
+        double time_start = m_system->GetChTime();
+        m_num_steps = 0;
+
+        chrono::ChTimer<double> timer_physics;
+        std::thread physics([&]() {
+            timer_physics.start();
+            while (!stop.load(std::memory_order_relaxed)) {
+                step();
+                m_num_steps++;
+                Publish();
+                if (m_duration > 0 && m_system->GetChTime() >= m_duration)
+                    break;
+            }
+            timer_physics.stop();
+            physics_done = true;
+        });
+
+        typedef std::chrono::steady_clock clock;
+        auto frame_period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1 / m_fps));
+        auto next_frame = clock::now();
+        int num_frames = 0;
+        int num_stale = 0;
+
+        chrono::ChTimer<double> timer_render;
+        timer_render.start();
+        while (!physics_done && application.GetDevice()->run()) {
+            if (!Update())
+                num_stale++;
+
+            application.BeginScene(true, true, irr::video::SColor(255, 140, 161, 192));
+            application.DrawAll();
+            if (draw)
+                draw(GetTime());
+            application.EndScene();
+
+            if (!m_capture_dir.empty())
+                Capture(application.GetVideoDriver(), num_frames);
+            num_frames++;
+
+            // Wait for the next frame; if late, restart the schedule instead of drawing a burst of frames
+            next_frame += frame_period;
+            auto now = clock::now();
+            if (now < next_frame)
+                std::this_thread::sleep_until(next_frame);
+            else
+                next_frame = now;
+        }
+        timer_render.stop();
+
+        stop = true;
+        physics.join();
+
+        double sim_time = m_system->GetChTime() - time_start;
+        double wall_physics = timer_physics();
+        double wall_render = timer_render();
+        printf("Physics: %lld steps, %.3f s simulated in %.3f s (%.1f steps/s, real-time factor %.3f)\n", m_num_steps,
+               sim_time, wall_physics, m_num_steps / wall_physics, wall_physics / sim_time);
+        printf("Render:  %d frames in %.3f s (%.1f fps, target %.1f), %d without a new snapshot\n", num_frames,
+               wall_render, num_frames / wall_render, m_fps, num_stale);
+        if (!m_capture_dir.empty())
+            printf("Frames captured in %s\n", m_capture_dir.c_str());
+    }
+
+  private:
+    void Capture(irr::video::IVideoDriver* driver, int frame) {
+        irr::video::IImage* image = driver->createScreenShot();
+        if (!image)
+            return;
+        char filename[300];
+        sprintf(filename, "%s/img_%05d.bmp", m_capture_dir.c_str(), frame);
+        driver->writeImageToFile(image, filename);
+        image->drop();
+    }
+
+    chrono::ChSystem* m_system;                              // physics system (physics thread only)
+    chrono::ChSystemNSC m_render_sys;                        // render system (render thread only)
+    std::vector<std::shared_ptr<chrono::ChBody>> m_bodies;   // physics bodies
+    std::vector<std::shared_ptr<chrono::ChBody>> m_proxies;  // render proxies
+
+    std::mutex m_mutex;                         // guards the snapshot
+    std::atomic<bool> m_request;                // render thread is waiting for a snapshot
+    bool m_fresh;                               // snapshot not yet applied
+    std::vector<chrono::ChCoordsys<>> m_poses;  // snapshot body poses
+    double m_time;                              // snapshot physics time
+
+    double m_fps;
+    double m_duration;
+    std::string m_capture_dir;
+    long long m_num_steps;
+};
+
+#endif
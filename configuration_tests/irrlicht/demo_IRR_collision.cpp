@@ -16,8 +16,17 @@
 //     - collisions and contacts
 //     - using Irrlicht to display objects.
 //
+// With "-decoupled [fps]", the physics runs free on a separate thread while the
+// scene is drawn at the given frame rate (see decoupled_render.h); further
+// options in this mode are "-duration <t>" (stop at simulation time t) and
+// "-capture <dir>" (save the frames to an image sequence).
+//
 // =============================================================================
 
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
 #include "chrono/physics/ChSystemNSC.h"
 #include "chrono/physics/ChBodyEasy.h"
 #include "chrono/physics/ChLinkMotorRotationSpeed.h"
@@ -25,6 +34,8 @@
 
 #include "chrono_irrlicht/ChIrrApp.h"
 
+#include "decoupled_render.h"
+
 // Use the namespaces of Chrono
 using namespace chrono;
 using namespace chrono::irrlicht;
@@ -184,11 +195,31 @@ int main(int argc, char* argv[]) {
     // Set path to Chrono data directories
     SetChronoDataPath(CHRONO_DATA_DIR);
 
+    // Command line options
+    bool decoupled = false;
+    double fps = 60;
+    double duration = 0;
+    std::string capture_dir;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-decoupled") == 0) {
+            decoupled = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                fps = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "-duration") == 0 && i + 1 < argc) {
+            duration = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "-capture") == 0 && i + 1 < argc) {
+            capture_dir = argv[++i];
+        }
+    }
+
     // Create a ChronoENGINE physical system
     ChSystemNSC mphysicalSystem;
 
     // Create the Irrlicht visualization
-    ChIrrApp application(&mphysicalSystem, L"Collisions between objects", core::dimension2d<u32>(800, 600));
+    // (in decoupled mode, the application draws the render proxies of the bodies)
+    DecoupledRenderer renderer;
+    ChIrrApp application(decoupled ? &renderer.GetRenderSystem() : &mphysicalSystem, L"Collisions between objects",
+                         core::dimension2d<u32>(800, 600));
     application.AddTypicalLogo();
     application.AddTypicalSky();
     application.AddTypicalLights();
@@ -198,6 +229,9 @@ int main(int argc, char* argv[]) {
 
     create_some_falling_items(mphysicalSystem, application.GetSceneManager(), application.GetVideoDriver());
 
+    if (decoupled)
+        renderer.Initialize(mphysicalSystem);
+
     // Use this function for adding a ChIrrNodeAsset to all items
     // Otherwise use application.AssetBind(myitem); on a per-item basis.
     application.AssetBindAll();
@@ -211,6 +245,18 @@ int main(int argc, char* argv[]) {
 
     // mphysicalSystem.SetUseSleeping(true);
 
+    //
+    // THE DECOUPLED CYCLE: free-running physics, rendering at the target FPS
+    //
+
+    if (decoupled) {
+        renderer.SetFPS(fps);
+        renderer.SetDuration(duration);
+        renderer.SetCaptureDir(capture_dir);
+        renderer.Run(application, [&]() { mphysicalSystem.DoStepDynamics(0.02); });
+        return 0;
+    }
+
     //
     // THE SOFT-REAL-TIME CYCLE
     //
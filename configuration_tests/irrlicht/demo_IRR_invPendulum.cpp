@@ -21,11 +21,18 @@
 //
 // The mechanical system eveolves in the X-Y plane (Y up).
 //
-// This version uses Irrlicht for visualization.
+// This version uses Irrlicht for visualization. With "-decoupled [fps]", the
+// physics runs free on a separate thread while the scene is drawn at the given
+// frame rate (see decoupled_render.h); further options in this mode are
+// "-duration <t>" (stop at simulation time t) and "-capture <dir>" (save the
+// frames to an image sequence).
 //
 // =============================================================================
 
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 
 #include "chrono/physics/ChSystemNSC.h"
 #include "chrono/core/ChRealtimeStep.h"
@@ -35,6 +42,8 @@
 
 #include "chrono_irrlicht/ChIrrApp.h"
 
+#include "decoupled_render.h"
+
 using namespace chrono;
 using namespace chrono::irrlicht;
 using namespace irr;
@@ -173,6 +182,24 @@ int main(int argc, char* argv[]) {
     // ---------------------------------
     SetChronoDataPath(CHRONO_DATA_DIR);
 
+    // Command line options
+    // --------------------
+    bool decoupled = false;
+    double fps = 60;
+    double duration = 0;
+    std::string capture_dir;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-decoupled") == 0) {
+            decoupled = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                fps = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "-duration") == 0 && i + 1 < argc) {
+            duration = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "-capture") == 0 && i + 1 < argc) {
+            capture_dir = argv[++i];
+        }
+    }
+
     // Problem parameters
     // ------------------
     double mass_cart = 1.0;    // mass of the cart
@@ -269,7 +296,13 @@ int main(int argc, char* argv[]) {
 
     // Create Irrlicht window and camera
     // ---------------------------------
-    ChIrrApp application(&system, L"Inverted Pendulum", core::dimension2d<u32>(800, 600));
+    // In decoupled mode, the application draws the render proxies of the bodies.
+    DecoupledRenderer renderer;
+    if (decoupled)
+        renderer.Initialize(system);
+
+    ChIrrApp application(decoupled ? &renderer.GetRenderSystem() : &system, L"Inverted Pendulum",
+                         core::dimension2d<u32>(800, 600));
     application.AddTypicalLogo();
     application.AddTypicalSky();
     application.AddTypicalLights();
@@ -278,29 +311,15 @@ int main(int argc, char* argv[]) {
     application.AssetBindAll();
     application.AssetUpdateAll();
 
-    // Simulation loop
-    // ---------------
-    ChRealtimeStepTimer m_realtime_timer;
+    // Simulation step and scene overlay
+    // ---------------------------------
     double step = 1e-3;
 
     // Initialize cart location target switching
     int target_id = 0;
     double switch_time = 0;
 
-    while (application.GetDevice()->run()) {
-        application.BeginScene();
-        application.DrawAll();
-
-        // Render a grid
-        tools::drawGrid(application.GetVideoDriver(), 0.5, 0.5, 40, 40, CSYSNORM, video::SColor(0, 204, 204, 0), true);
-
-        // Render text with current time
-        char msg[40];
-        sprintf(msg, "Time = %6.2f s", system.GetChTime());
-        gui::IGUIFont* font =
-            application.GetIGUIEnvironment()->getFont(chrono::GetChronoDataFile("fonts/arial8.xml").c_str());
-        font->draw(msg, irr::core::rect<s32>(720, 20, 780, 40), irr::video::SColor(255, 20, 20, 20));
-
+    auto step_physics = [&]() {
         // At a switch time, flip target for cart location
         if (system.GetChTime() > switch_time) {
             controller.SetTargetCartLocation(travel_dist * (1 - 2 * target_id));
@@ -313,7 +332,36 @@ int main(int argc, char* argv[]) {
         // Advance system and controller states
         system.DoStepDynamics(step);
         controller.Advance(step);
+    };
+
+    gui::IGUIFont* font =
+        application.GetIGUIEnvironment()->getFont(chrono::GetChronoDataFile("fonts/arial8.xml").c_str());
 
+    auto draw_overlay = [&](double time) {
+        // Render a grid
+        tools::drawGrid(application.GetVideoDriver(), 0.5, 0.5, 40, 40, CSYSNORM, video::SColor(0, 204, 204, 0), true);
+
+        // Render text with current time
+        char msg[40];
+        sprintf(msg, "Time = %6.2f s", time);
+        font->draw(msg, irr::core::rect<s32>(720, 20, 780, 40), irr::video::SColor(255, 20, 20, 20));
+    };
+
+    // Simulation loop
+    // ---------------
+    if (decoupled) {
+        renderer.SetFPS(fps);
+        renderer.SetDuration(duration);
+        renderer.SetCaptureDir(capture_dir);
+        renderer.Run(application, step_physics, draw_overlay);
+        return 0;
+    }
+
+    while (application.GetDevice()->run()) {
+        application.BeginScene();
+        application.DrawAll();
+        draw_overlay(system.GetChTime());
+        step_physics();
         application.EndScene();
     }
 
@@ -16,6 +16,8 @@
 //
 // The model simulated here consists of a number of spherical objects falling
 // onto a mixer blade attached through a revolute joint to the ground.
+// Optionally, more spheres are poured continuously into the bin from a
+// preallocated pool (see particle_emitter.h).
 //
 // The global reference frame has Z up.
 //
@@ -27,6 +29,7 @@
 #include <cstdio>
 #include <vector>
 #include <cmath>
+#include <memory>
 
 #include "chrono_multicore/physics/ChSystemMulticore.h"
 
@@ -35,6 +38,8 @@
 #include "chrono/utils/ChUtilsCreators.h"
 #include "chrono/utils/ChUtilsInputOutput.h"
 
+#include "particle_emitter.h"
+
 #ifdef CHRONO_OPENGL
 #include "chrono_opengl/ChOpenGLWindow.h"
 #endif
@@ -167,6 +172,11 @@ int main(int argc, char* argv[]) {
 
     double out_fps = 50;
 
+    // Continuous inflow of spheres from above the bin
+    bool use_emitter = true;
+    int emitter_capacity = 400;
+    double emitter_rate = 400;  // particles per second
+
     uint max_iteration = 50;
     real tolerance = 1e-3;
 
@@ -197,6 +207,23 @@ int main(int argc, char* argv[]) {
     AddContainer(&msystem);
     AddFallingBalls(&msystem);
 
+    // Pool of spheres for the continuous inflow, parked under the bin floor. Spheres that escape the bin (only
+    // possible through excessive penetration) are returned to the pool.
+    std::unique_ptr<ParticleEmitter> emitter;
+    if (use_emitter) {
+        auto mat = chrono_types::make_shared<ChMaterialSurfaceSMC>();
+        mat->SetYoungModulus(2e5f);
+        mat->SetFriction(0.4f);
+        mat->SetRestitution(0.1f);
+        double radius = 0.05;
+        double mass = 1000 * (4.0 / 3.0) * CH_C_PI * radius * radius * radius;
+        emitter = std::unique_ptr<ParticleEmitter>(new ParticleEmitter(
+            &msystem, mat, radius, mass, emitter_capacity, 100, ChVector<>(-0.9, -0.9, -0.4), ChVector<>(0.9, 0.9, 0)));
+        emitter->SetRate(emitter_rate);
+        emitter->SetInlet(ChVector<>(0, 0, 1.2), ChVector<>(0.6, 0.6, 0.1), ChVector<>(0, 0, -1));
+        emitter->SetOutlet([](const ChVector<>& pos) { return pos.z() < -0.3; });
+    }
+
 // Perform the simulation
 // ----------------------
 
@@ -215,6 +242,8 @@ int main(int argc, char* argv[]) {
         if (gl_window.Active()) {
             gl_window.DoStepDynamics(time_step);
             gl_window.Render();
+            if (emitter)
+                emitter->Update(time_step);
         } else {
             break;
         }
@@ -225,9 +254,17 @@ int main(int argc, char* argv[]) {
     double time = 0;
     for (int i = 0; i < num_steps; i++) {
         msystem.DoStepDynamics(time_step);
+        if (emitter)
+            emitter->Update(time_step);
         time += time_step;
     }
 #endif
 
+    if (emitter) {
+        GetLog() << "Emitter: " << emitter->GetNumActive() << " active, " << emitter->GetNumFree() << " free of "
+                 << emitter->GetCapacity() << " (" << (int)emitter->GetNumEmitted() << " emitted, "
+                 << (int)emitter->GetNumRecycled() << " recycled)\n";
+    }
+
     return 0;
 }
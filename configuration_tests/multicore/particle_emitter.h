@@ -0,0 +1,228 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Continuous-inflow emitter of spherical particles for Chrono::Multicore, with
+// a preallocated pool of bodies.
+//
+// Creating particles in batches during a simulation appends bodies and shapes
+// to the data manager arrays (with reallocations and an insertion spike at each
+// batch). ParticleEmitter adds all the bodies it will ever use at construction
+// (one insertion, before the simulation) and keeps the unused ones in a free
+// pool: pooled particles are fixed, hence inactive for the multicore system
+// (excluded from the solver, and contacts between two inactive bodies are
+// discarded in the broadphase), and parked on a lattice with a spacing larger
+// than a diameter, so that they do not touch each other. Place the parking box
+// next to the simulation domain, out of reach of the other bodies (e.g. under
+// the container floor), so that it does not extend the broadphase grid much.
+//
+// Update, called after each step, returns to the pool the particles found in
+// the outlet region, then activates particles from the pool at the emission
+// rate: each one is placed at a random position in the inlet box, at least a
+// diameter away from the other particles in the inlet, with the inflow
+// velocity. If the inlet is too crowded or the pool is empty, the emission is
+// deferred to the next call. The number of bodies in the system, and therefore
+// the memory, stays constant.
+//
+// =============================================================================
+
+#ifndef PARTICLE_EMITTER_H
+#define PARTICLE_EMITTER_H
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "chrono/utils/ChUtilsCreators.h"
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+
+class ParticleEmitter {
+  public:
+    /// Add a pool of capacity spheres with given radius, mass, and contact material to the system, parked on a
+    /// lattice starting at the park_min corner and extending in +x and +y up to park_max, and then in -z.
+    /// Body identifiers are assigned consecutively, starting at first_id.
+    ParticleEmitter(chrono::ChSystemMulticore* system,
+                    std::shared_ptr<chrono::ChMaterialSurface> material,
+                    double radius,
+                    double mass,
+                    int capacity,
+                    int first_id,
+                    const chrono::ChVector<>& park_min,
+                    const chrono::ChVector<>& park_max)
+        : m_radius(radius),
+          m_rate(0),
+          m_inlet_center(0, 0, 0),
+          m_inlet_hdims(0, 0, 0),
+          m_inlet_vel(0, 0, 0),
+          m_pending(0),
+          m_num_emitted(0),
+          m_num_recycled(0),
+          m_rng(1) {
+        using namespace chrono;
+
+        // Parking lattice
+        double spacing = 2.5 * radius;
+        int nx = std::max(1, (int)std::floor((park_max.x() - park_min.x()) / spacing) + 1);
+        int ny = std::max(1, (int)std::floor((park_max.y() - park_min.y()) / spacing) + 1);
+        m_park.resize(capacity);
+        for (int i = 0; i < capacity; i++)
+            m_park[i] = park_min + spacing * ChVector<>(i % nx, (i / nx) % ny, -(i / (nx * ny)));
+
+        // Create all bodies, parked, and add them to the system
+        m_bodies.resize(capacity);
+        for (int i = 0; i < capacity; i++) {
+            auto body = std::shared_ptr<ChBody>(system->NewBody());
+            body->SetIdentifier(first_id + i);
+            body->SetMass(mass);
+            body->SetInertiaXX(ChVector<>(0.4 * mass * radius * radius));
+            body->SetCollide(true);
+            body->GetCollisionModel()->ClearModel();
+            utils::AddSphereGeometry(body.get(), material, radius);
+            body->GetCollisionModel()->BuildModel();
+            Park(body, i);
+            system->AddBody(body);
+            m_bodies[i] = body;
+        }
+
+        m_active.assign(capacity, 0);
+        m_free.resize(capacity);
+        for (int i = 0; i < capacity; i++)
+            m_free[i] = capacity - 1 - i;  // first lattice positions are taken first
+    }
+
+    /// Set the emission rate (particles per unit time).
+    void SetRate(double rate) { m_rate = rate; }
+
+    /// Set the inlet box (center and half-dimensions) and the inflow velocity.
+    void SetInlet(const chrono::ChVector<>& center, const chrono::ChVector<>& hdims, const chrono::ChVector<>& vel) {
+        m_inlet_center = center;
+        m_inlet_hdims = hdims;
+        m_inlet_vel = vel;
+    }
+
+    /// Set the outlet region, as an indicator function of the particle position (default: none).
+    void SetOutlet(std::function<bool(const chrono::ChVector<>&)> outlet) { m_outlet = outlet; }
+
+    /// Set the seed of the random inlet positions.
+    void SetSeed(unsigned int seed) { m_rng.seed(seed); }
+
+    /// Recycle the particles in the outlet and emit new ones. Must be called after each step.
+    void Update(double step) {
+        using namespace chrono;
+
+        // Return particles in the outlet region to the pool, and collect the particles in the inlet
+        int capacity = (int)m_bodies.size();
+        ChVector<> inlet_min = m_inlet_center - m_inlet_hdims - ChVector<>(2 * m_radius);
+        ChVector<> inlet_max = m_inlet_center + m_inlet_hdims + ChVector<>(2 * m_radius);
+        m_inlet_pos.clear();
+        for (int i = 0; i < capacity; i++) {
+            if (!m_active[i])
+                continue;
+            const ChVector<>& pos = m_bodies[i]->GetPos();
+            if (m_outlet && m_outlet(pos)) {
+                Park(m_bodies[i], i);
+                m_active[i] = 0;
+                m_free.push_back(i);
+                m_num_recycled++;
+                continue;
+            }
+            if (pos.x() > inlet_min.x() && pos.y() > inlet_min.y() && pos.z() > inlet_min.z() &&
+                pos.x() < inlet_max.x() && pos.y() < inlet_max.y() && pos.z() < inlet_max.z())
+                m_inlet_pos.push_back(pos);
+        }
+
+        // Emit at the given rate (a deferred emission is retried at the next call)
+        m_pending += m_rate * step;
+        std::uniform_real_distribution<double> u(-1, 1);
+        double min_dist2 = 4 * m_radius * m_radius;
+        while (m_pending >= 1 && !m_free.empty()) {
+            ChVector<> pos;
+            bool found = false;
+            for (int attempt = 0; attempt < 10 && !found; attempt++) {
+                pos = m_inlet_center + ChVector<>(u(m_rng) * m_inlet_hdims.x(), u(m_rng) * m_inlet_hdims.y(),
+                                                  u(m_rng) * m_inlet_hdims.z());
+                found = std::none_of(m_inlet_pos.begin(), m_inlet_pos.end(),
+                                     [&](const ChVector<>& p) { return (p - pos).Length2() < min_dist2; });
+            }
+            if (!found)
+                break;
+
+            int i = m_free.back();
+            m_free.pop_back();
+            auto& body = m_bodies[i];
+            body->SetPos(pos);
+            body->SetRot(ChQuaternion<>(1, 0, 0, 0));
+            body->SetPos_dt(m_inlet_vel);
+            body->SetWvel_loc(ChVector<>(0, 0, 0));
+            body->SetBodyFixed(false);
+            m_active[i] = 1;
+            m_inlet_pos.push_back(pos);
+            m_pending -= 1;
+            m_num_emitted++;
+        }
+
+        // Do not accumulate a backlog while the pool is empty or the inlet is crowded
+        m_pending = std::min(m_pending, std::max(1.0, m_rate * step));
+    }
+
+    /// Return the total number of particles (active and pooled).
+    int GetCapacity() const { return (int)m_bodies.size(); }
+
+    /// Return the number of particles in the simulation.
+    int GetNumActive() const { return (int)(m_bodies.size() - m_free.size()); }
+
+    /// Return the number of particles in the free pool.
+    int GetNumFree() const { return (int)m_free.size(); }
+
+    /// Return the total number of emitted particles.
+    long long GetNumEmitted() const { return m_num_emitted; }
+
+    /// Return the total number of particles returned to the pool.
+    long long GetNumRecycled() const { return m_num_recycled; }
+
+    /// Return true if the body is a particle of this emitter which is in the simulation.
+    bool IsActive(const chrono::ChBody& body) const {
+        int i = body.GetIdentifier() - m_bodies.front()->GetIdentifier();
+        return i >= 0 && i < (int)m_bodies.size() && m_bodies[i].get() == &body && m_active[i];
+    }
+
+  private:
+    void Park(const std::shared_ptr<chrono::ChBody>& body, int i) {
+        body->SetBodyFixed(true);
+        body->SetPos(m_park[i]);
+        body->SetRot(chrono::ChQuaternion<>(1, 0, 0, 0));
+        body->SetPos_dt(chrono::ChVector<>(0, 0, 0));
+        body->SetWvel_loc(chrono::ChVector<>(0, 0, 0));
+    }
+
+    double m_radius;
+    double m_rate;
+    chrono::ChVector<> m_inlet_center;
+    chrono::ChVector<> m_inlet_hdims;
+    chrono::ChVector<> m_inlet_vel;
+    std::function<bool(const chrono::ChVector<>&)> m_outlet;
+
+    std::vector<std::shared_ptr<chrono::ChBody>> m_bodies;  // all particles of the emitter
+    std::vector<chrono::ChVector<>> m_park;                 // parking position of each particle
+    std::vector<char> m_active;                             // particle is in the simulation
+    std::vector<int> m_free;                                // free pool (stack of particle indices)
+    std::vector<chrono::ChVector<>> m_inlet_pos;            // positions of the particles in the inlet
+
+    double m_pending;  // number of particles due for emission
+    long long m_num_emitted;
+    long long m_num_recycled;
+    std::mt19937 m_rng;
+};
+
+#endif
@@ -17,7 +17,8 @@
 //       some Python program or formula
 //     - using the unit_PYPARSER for loading a
 //       .py scene description saved from the
-//       SolidWorks add-in
+//       SolidWorks add-in (archived in binary form after
+//       the first import, see system_archive_cache.h)
 //
 //
 //	 CHRONO
@@ -35,6 +36,8 @@
 #include <iostream>
 #include <sstream>
 
+#include "system_archive_cache.h"
+
 using namespace chrono;
 
 int main(int argc, char* argv[]) {
@@ -101,9 +104,21 @@ int main(int argc, char* argv[]) {
 
     try {
         // This is the instruction that loads the .py (as saved from SolidWorks) and
-        // fills the system:
-
-        my_python.ImportSolidWorksSystem("test_brick1", my_system);  // note, don't type the .py suffic in filename..
+        // fills the system. The cache runs the Python import only if there is no
+        // valid binary archive of the system yet (and then writes the archive).
+
+        SolidWorksSystemCache system_cache;
+        system_cache.Load(my_python, "test_brick1", my_system);  // note, don't type the .py suffic in filename..
+
+        if (system_cache.IsFromArchive()) {
+            GetLog() << "System read from archive in " << system_cache.GetArchiveReadTime()
+                     << " s (Python import: " << system_cache.GetImportTime() << " s)\n";
+        } else {
+            GetLog() << "System imported with Python in " << system_cache.GetImportTime() << " s";
+            if (system_cache.GetArchiveWriteTime() > 0)
+                GetLog() << " (archive written in " << system_cache.GetArchiveWriteTime() << " s)";
+            GetLog() << "\n";
+        }
 
         my_system.ShowHierarchy(GetLog());
 
@@ -0,0 +1,197 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Binary archive cache of systems imported from SolidWorks-exported Python
+// files.
+//
+// ChPythonEngine::ImportSolidWorksSystem executes the exported .py module,
+// which for large assemblies takes seconds. SolidWorksSystemCache imports the
+// system once with the Python engine, serializes it with ChArchiveOutBinary,
+// and on later runs deserializes the archive directly, without the
+// interpreter.
+//
+// The key of an archive is a 64-bit FNV-1a hash of the .py file content, its
+// size, and the Chrono version; it is saved at the start of the archive
+// (together with the time taken by the Python import), so that an edited
+// export or a different Chrono build never uses a stale archive. If reading
+// the archive fails, the system is cleared and imported with Python.
+//
+// Collision shapes are not part of the Chrono archive format, so a system with
+// collision enabled on some body is never archived (it is always imported with
+// Python).
+//
+// =============================================================================
+
+#ifndef SYSTEM_ARCHIVE_CACHE_H
+#define SYSTEM_ARCHIVE_CACHE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define ARCHIVE_CACHE_GETPID _getpid
+#else
+#include <unistd.h>
+#define ARCHIVE_CACHE_GETPID getpid
+#endif
+
+#include "chrono/ChVersion.h"
+#include "chrono/core/ChStream.h"
+#include "chrono/core/ChTimer.h"
+#include "chrono/physics/ChSystemNSC.h"
+#include "chrono/serialization/ChArchiveBinary.h"
+#include "chrono_python/ChPython.h"
+#include "chrono_thirdparty/filesystem/path.h"
+
+class SolidWorksSystemCache {
+  public:
+    SolidWorksSystemCache(const std::string& cache_dir = "../PYTHON_SYSTEM_CACHE")
+        : m_dir(cache_dir), m_from_archive(false), m_time_import(0), m_time_read(0), m_time_write(0) {}
+
+    /// Fill the system with the SolidWorks export of the given name (the .py module name, without suffix): from the
+    /// archive if it is valid, otherwise with the Python engine (and archive the result).
+    void Load(chrono::ChPythonEngine& engine, const std::string& name, chrono::ChSystemNSC& system) {
+        m_from_archive = false;
+        m_time_import = 0;
+        m_time_read = 0;
+        m_time_write = 0;
+
+        std::string key = GetKey(name + ".py");
+        std::string filename = m_dir + "/" + name + ".chsys";
+
+        if (!key.empty() && Read(filename, key, system)) {
+            m_from_archive = true;
+            return;
+        }
+
+        chrono::ChTimer<double> timer;
+        timer.start();
+        engine.ImportSolidWorksSystem(name.c_str(), system);
+        timer.stop();
+        m_time_import = timer();
+
+        if (key.empty())
+            return;
+        for (auto body : system.Get_bodylist()) {
+            if (body->GetCollide()) {
+                std::cout << "System " << name << " has collision shapes (not archived); not cached" << std::endl;
+                return;
+            }
+        }
+        filesystem::create_directory(filesystem::path(m_dir));
+        if (!Write(filename, key, system))
+            std::cout << "Could not write system archive " << filename << std::endl;
+    }
+
+    /// Return true if the last loaded system was read from its archive.
+    bool IsFromArchive() const { return m_from_archive; }
+
+    /// Return the time of the Python import (measured, or recorded in the archive when it was created).
+    double GetImportTime() const { return m_time_import; }
+
+    /// Return the time to read the archive (0 if the system was imported with Python).
+    double GetArchiveReadTime() const { return m_time_read; }
+
+    /// Return the time to write the archive (0 if no archive was written).
+    double GetArchiveWriteTime() const { return m_time_write; }
+
+  private:
+    // Key of the exported file: content hash and size, and Chrono version; empty if the file cannot be read.
+    static std::string GetKey(const std::string& filename) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.good())
+            return "";
+        // 64-bit FNV-1a
+        uint64_t hash = 14695981039346656037ULL;
+        uint64_t size = 0;
+        std::vector<char> buf(1 << 16);
+        while (file) {
+            file.read(buf.data(), buf.size());
+            size_t count = (size_t)file.gcount();
+            for (size_t i = 0; i < count; i++) {
+                hash ^= (unsigned char)buf[i];
+                hash *= 1099511628211ULL;
+            }
+            size += count;
+        }
+        char key[64];
+        sprintf(key, "%016llx-%llu-", (unsigned long long)hash, (unsigned long long)size);
+        return std::string(key) + CHRONO_VERSION;
+    }
+
+    bool Read(const std::string& filename, const std::string& key, chrono::ChSystemNSC& system) {
+        if (!std::ifstream(filename).good())
+            return false;
+
+        chrono::ChTimer<double> timer;
+        timer.start();
+        try {
+            chrono::ChStreamInBinaryFile stream(filename.c_str());
+            chrono::ChArchiveInBinary archive(stream);
+            std::string file_key;
+            archive >> CHNVP(file_key, "key");
+            if (file_key != key) {
+                std::cout << "System archive " << filename << " is stale; ignored" << std::endl;
+                return false;
+            }
+            archive >> CHNVP(m_time_import, "import_time");
+            archive >> CHNVP(system, "system");
+        } catch (chrono::ChException& e) {
+            std::cout << "Could not read system archive " << filename << ": " << e.what() << std::endl;
+            system.Clear();
+            m_time_import = 0;
+            return false;
+        }
+        timer.stop();
+        m_time_read = timer();
+        return true;
+    }
+
+    // Write to a temporary file, renamed when complete, so that concurrent programs never read a partial archive.
+    bool Write(const std::string& filename, const std::string& key, chrono::ChSystemNSC& system) {
+        std::string tmpname = filename + ".tmp" + std::to_string(ARCHIVE_CACHE_GETPID());
+        chrono::ChTimer<double> timer;
+        timer.start();
+        try {
+            chrono::ChStreamOutBinaryFile stream(tmpname.c_str());
+            chrono::ChArchiveOutBinary archive(stream);
+            std::string file_key = key;
+            archive << CHNVP(file_key, "key");
+            archive << CHNVP(m_time_import, "import_time");
+            archive << CHNVP(system, "system");
+        } catch (chrono::ChException& e) {
+            std::cout << e.what() << std::endl;
+            remove(tmpname.c_str());
+            return false;
+        }
+        if (rename(tmpname.c_str(), filename.c_str()) != 0) {
+            remove(tmpname.c_str());
+            return false;
+        }
+        timer.stop();
+        m_time_write = timer();
+        return true;
+    }
+
+    std::string m_dir;
+    bool m_from_archive;
+    double m_time_import;
+    double m_time_read;
+    double m_time_write;
+};
+
+#endif
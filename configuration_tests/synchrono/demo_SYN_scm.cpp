@@ -22,7 +22,12 @@
 //
 // =============================================================================
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <unordered_map>
+
+#include <mpi.h>
 
 #include "chrono/core/ChRealtimeStep.h"
 
@@ -87,6 +92,9 @@ double render_step_size = 1.0 / 100;  // FPS = 50
 // How often SynChrono state messages are interchanged
 double heartbeat = 1e-2;  // 100[Hz]
 
+// Resolution of the node heights exchanged by SCMDeltaSync
+double height_resolution = 1e-4;
+
 // Forward declares for straight forward helper functions
 void LogCopyright(bool show);
 void AddCommandLineOptions(ChCLI& cli);
@@ -95,6 +103,180 @@ ChContactMethod ContactMethodFromString(std::string str);
 
 // =============================================================================
 
+// Exchange of the SCM nodes modified since the last heartbeat between all ranks.
+//
+// Each rank collects the nodes modified by its own vehicle at every step and, at each heartbeat, sends those whose
+// quantized height differs from the last synchronized one. The nodes are sorted by row and sent as runs of adjacent
+// nodes: varint number of runs, then per run the zigzag varint offsets of its row and first column (from the previous
+// run), its varint length minus one, and the zigzag varint differences of the quantized heights of its nodes (from the
+// previous node). Received nodes are merged into the map of synchronized heights, so they are not sent back, and
+// applied to the local terrain.
+class SCMDeltaSync {
+  public:
+    SCMDeltaSync(std::shared_ptr<SCMDeformableTerrain> terrain, double resolution)
+        : m_terrain(terrain), m_resolution(resolution), m_num_heartbeats(0), m_num_nodes(0), m_num_bytes(0) {
+        MPI_Comm_dup(MPI_COMM_WORLD, &m_comm);
+        MPI_Comm_rank(m_comm, &m_rank);
+        MPI_Comm_size(m_comm, &m_num_ranks);
+    }
+
+    ~SCMDeltaSync() { MPI_Comm_free(&m_comm); }
+
+    /// Collect the nodes modified over the last step.
+    void Accumulate() {
+        for (const auto& node : m_terrain->GetModifiedNodes())
+            m_pending[Key(node.first.x(), node.first.y())] = node.second;
+    }
+
+    /// Send the nodes modified since the last heartbeat and apply those of the other ranks (collective).
+    void Exchange() {
+        std::vector<uint8_t> message = Encode();
+        int size = (int)message.size();
+        std::vector<int> sizes(m_num_ranks);
+        MPI_Allgather(&size, 1, MPI_INT, sizes.data(), 1, MPI_INT, m_comm);
+
+        std::vector<int> offsets(m_num_ranks, 0);
+        for (int r = 1; r < m_num_ranks; r++)
+            offsets[r] = offsets[r - 1] + sizes[r - 1];
+        std::vector<uint8_t> all(offsets.back() + sizes.back());
+        MPI_Allgatherv(message.data(), size, MPI_BYTE, all.data(), sizes.data(), offsets.data(), MPI_BYTE, m_comm);
+
+        std::vector<SCMDeformableTerrain::NodeLevel> nodes;
+        for (int r = 0; r < m_num_ranks; r++) {
+            if (r != m_rank && !Decode(all.data() + offsets[r], sizes[r], nodes))
+                SynLog() << "SCMDeltaSync: malformed message from rank " << r << "\n";
+        }
+        if (!nodes.empty())
+            m_terrain->SetModifiedNodes(nodes);
+    }
+
+    /// Return the bytes sent per heartbeat, and the bytes of the same nodes sent as two int32 indices and a double.
+    double GetBytesPerHeartbeat() const { return m_num_heartbeats ? (double)m_num_bytes / m_num_heartbeats : 0; }
+    double GetRawBytesPerHeartbeat() const { return m_num_heartbeats ? 16.0 * m_num_nodes / m_num_heartbeats : 0; }
+
+  private:
+    // Node key ordered by row then column (indices offset to be unsigned, so adjacent columns have adjacent keys)
+    static uint64_t Key(int i, int j) {
+        return ((uint64_t)((uint32_t)j ^ 0x80000000u) << 32) | ((uint32_t)i ^ 0x80000000u);
+    }
+    static int Row(uint64_t key) { return (int32_t)((uint32_t)(key >> 32) ^ 0x80000000u); }
+    static int Col(uint64_t key) { return (int32_t)((uint32_t)key ^ 0x80000000u); }
+
+    static void WriteVarint(std::vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back((uint8_t)value);
+    }
+
+    static void WriteZigzag(std::vector<uint8_t>& out, int64_t value) {
+        WriteVarint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+    }
+
+    std::vector<uint8_t> Encode() {
+        // modified nodes whose quantized height changed, sorted by row then column (the order of the keys)
+        std::vector<std::pair<uint64_t, int64_t>> delta;
+        for (const auto& node : m_pending) {
+            int64_t height = std::llround(node.second / m_resolution);
+            auto known = m_known.find(node.first);
+            if (known == m_known.end() || known->second != height) {
+                delta.push_back({node.first, height});
+                m_known[node.first] = height;
+            }
+        }
+        m_pending.clear();
+        std::sort(delta.begin(), delta.end());
+
+        std::vector<uint8_t> runs;
+        size_t num_runs = 0;
+        int64_t prev_row = 0;
+        int64_t prev_end = 0;
+        int64_t prev_height = 0;
+        for (size_t k = 0; k < delta.size();) {
+            size_t len = 1;
+            while (k + len < delta.size() && delta[k + len].first == delta[k].first + len)
+                len++;
+            int64_t row = Row(delta[k].first);
+            int64_t col = Col(delta[k].first);
+            WriteZigzag(runs, row - prev_row);
+            WriteZigzag(runs, col - prev_end);
+            WriteVarint(runs, len - 1);
+            for (size_t n = k; n < k + len; n++) {
+                WriteZigzag(runs, delta[n].second - prev_height);
+                prev_height = delta[n].second;
+            }
+            prev_row = row;
+            prev_end = col + len;
+            num_runs++;
+            k += len;
+        }
+
+        std::vector<uint8_t> message;
+        WriteVarint(message, num_runs);
+        message.insert(message.end(), runs.begin(), runs.end());
+
+        m_num_heartbeats++;
+        m_num_nodes += delta.size();
+        m_num_bytes += message.size();
+        return message;
+    }
+
+    bool Decode(const uint8_t* data, size_t size, std::vector<SCMDeformableTerrain::NodeLevel>& nodes) {
+        size_t pos = 0;
+        bool ok = true;
+        auto read_varint = [&]() {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64 && pos < size; shift += 7) {
+                uint8_t byte = data[pos++];
+                value |= (uint64_t)(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    return value;
+            }
+            ok = false;
+            return (uint64_t)0;
+        };
+        auto read_zigzag = [&]() {
+            uint64_t value = read_varint();
+            return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+        };
+
+        uint64_t num_runs = read_varint();
+        int64_t row = 0;
+        int64_t end = 0;
+        int64_t height = 0;
+        for (uint64_t r = 0; ok && r < num_runs; r++) {
+            row += read_zigzag();
+            int64_t col = end + read_zigzag();
+            uint64_t len = read_varint() + 1;
+            if (len > size)
+                return false;
+            for (uint64_t n = 0; ok && n < len; n++) {
+                height += read_zigzag();
+                m_known[Key((int)(col + n), (int)row)] = height;
+                nodes.push_back({ChVector2<int>((int)(col + n), (int)row), height * m_resolution});
+            }
+            end = col + len;
+        }
+        return ok;
+    }
+
+    std::shared_ptr<SCMDeformableTerrain> m_terrain;
+    double m_resolution;
+    MPI_Comm m_comm;
+    int m_rank;
+    int m_num_ranks;
+
+    std::unordered_map<uint64_t, double> m_pending;  ///< local nodes modified since the last heartbeat
+    std::unordered_map<uint64_t, int64_t> m_known;   ///< last synchronized quantized height of each node
+
+    unsigned int m_num_heartbeats;
+    uint64_t m_num_nodes;
+    uint64_t m_num_bytes;
+};
+
+// =============================================================================
+
 int main(int argc, char* argv[]) {
     // Set path to Chrono and Chrono::Vehicle data directories
     SetChronoDataPath(CHRONO_DATA_DIR);
@@ -135,6 +317,10 @@ int main(int argc, char* argv[]) {
     const int cam_res_width = cli.GetAsType<std::vector<int>>("res")[0];
     const int cam_res_height = cli.GetAsType<std::vector<int>>("res")[1];
     const bool use_scm = cli.Matches<std::string>("terrain_type", "SCM");
+    const bool delta_sync = cli.Matches<std::string>("scm_sync", "delta");
+    const bool wheel_patches = cli.Matches<std::string>("patch", "wheels");
+    const int num_threads = cli.GetAsType<int>("threads");
+    height_resolution = cli.GetAsType<double>("height_res");
 
     // Change SynChronoManager settings
     syn_manager.SetHeartbeat(heartbeat);
@@ -178,7 +364,7 @@ int main(int argc, char* argv[]) {
     hmmwv.SetTireVisualizationType(VisualizationType::PRIMITIVES);
 
     // Solver settings.
-    hmmwv.GetSystem()->SetNumThreads(std::min(8, ChOMP::GetNumProcs()));
+    hmmwv.GetSystem()->SetNumThreads(num_threads);
     hmmwv.GetSystem()->SetSolverMaxIterations(50);
 
     // Add vehicle as an agent
@@ -192,6 +378,7 @@ int main(int argc, char* argv[]) {
     // Terrain specific setup
     // ----------------------
     std::shared_ptr<ChTerrain> terrain;
+    std::unique_ptr<SCMDeltaSync> scm_sync;
     if (use_scm) {
         auto scm = chrono_types::make_shared<SCMDeformableTerrain>(hmmwv.GetSystem());
 
@@ -210,19 +397,34 @@ int main(int argc, char* argv[]) {
         scm->GetMesh()->SetWireframe(true);
 
         // The physics do not change when you add a moving patch, you just make it much easier for the SCM
-        // implementation to do its job by restricting where it has to look for contacts
-        scm->AddMovingPatch(hmmwv.GetVehicle().GetChassisBody(), ChVector<>(0, 0, 0), ChVector<>(5, 3, 1));
+        // implementation to do its job by restricting where it has to look for contacts. One patch per wheel (box
+        // around the tire, in the spindle frame) casts rays only under the tire footprints, instead of under the
+        // whole chassis; the wheels are independent, so the rays of each patch can be cast in parallel.
+        if (wheel_patches) {
+            for (auto& axle : hmmwv.GetVehicle().GetAxles()) {
+                for (auto& wheel : axle->GetWheels())
+                    scm->AddMovingPatch(wheel->GetSpindle(), ChVector<>(0, 0, 0), ChVector<>(1.0, 0.6, 1.0));
+            }
+        } else {
+            scm->AddMovingPatch(hmmwv.GetVehicle().GetChassisBody(), ChVector<>(0, 0, 0), ChVector<>(5, 3, 1));
+        }
 
         scm->Initialize(size_x, size_y, 1. / dpu);
 
-        // Create an SCMTerrainAgent and add it to the SynChrono manager
-        auto terrain_agent = chrono_types::make_shared<SynSCMTerrainAgent>(scm);
-        syn_manager.AddAgent(terrain_agent);
-
         // Choice of soft parameters is arbitrary
         SCMParameters params;
         params.InitializeParametersAsSoft();
-        terrain_agent->SetSoilParametersFromStruct(&params);
+
+        if (delta_sync) {
+            // Exchange the modified nodes directly between the ranks
+            params.SetParameters(scm);
+            scm_sync = std::unique_ptr<SCMDeltaSync>(new SCMDeltaSync(scm, height_resolution));
+        } else {
+            // Create an SCMTerrainAgent and add it to the SynChrono manager
+            auto terrain_agent = chrono_types::make_shared<SynSCMTerrainAgent>(scm);
+            syn_manager.AddAgent(terrain_agent);
+            terrain_agent->SetSoilParametersFromStruct(&params);
+        }
 
         // Add texture for the terrain
         auto vis_mat = chrono_types::make_shared<ChVisualMaterial>();
@@ -351,6 +553,7 @@ int main(int argc, char* argv[]) {
     // ---------------
     // Number of simulation steps between miscellaneous events
     int render_steps = (int)std::ceil(render_step_size / step_size);
+    int heartbeat_steps = std::max(1, (int)std::round(heartbeat / step_size));
 
     // Initialize simulation frame counters
     int step_number = 0;
@@ -395,6 +598,11 @@ int main(int argc, char* argv[]) {
         driver.Advance(step_size);
         terrain->Advance(step_size);
         hmmwv.Advance(step_size);
+        if (scm_sync) {
+            scm_sync->Accumulate();
+            if ((step_number + 1) % heartbeat_steps == 0)
+                scm_sync->Exchange();
+        }
 #ifdef CHRONO_IRRLICHT
         if (app)
             app->Advance(step_size);
@@ -415,6 +623,10 @@ int main(int argc, char* argv[]) {
             auto time_span = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 
             SynLog() << (time_span.count() / 1e3) / time << "\n";
+            if (scm_sync) {
+                SynLog() << "SCM sync: " << scm_sync->GetBytesPerHeartbeat() << " bytes per heartbeat ("
+                         << scm_sync->GetRawBytesPerHeartbeat() << " as raw nodes)\n";
+            }
         }
     }
 
@@ -434,12 +646,20 @@ void AddCommandLineOptions(ChCLI& cli) {
     cli.AddOption<double>("Simulation", "s,step_size", "Step size", std::to_string(step_size));
     cli.AddOption<double>("Simulation", "e,end_time", "End time", std::to_string(end_time));
     cli.AddOption<double>("Simulation", "b,heartbeat", "Heartbeat", std::to_string(heartbeat));
+    cli.AddOption<int>("Simulation", "n,threads", "Number of threads",
+                       std::to_string(std::min(8, ChOMP::GetNumProcs())));
     cli.AddOption<std::string>("Simulation", "c,contact_method", "Contact Method",
                                StringFromContactMethod(contact_method), "NSC/SMC");
 
     // SCM specific options
     cli.AddOption<double>("Demo", "d,dpu", "Divisions per unit", "20");
     cli.AddOption<std::string>("Demo", "t,terrain_type", "Terrain Type", "SCM", "Rigid,SCM");
+    cli.AddOption<std::string>("Demo", "scm_sync", "SCM synchronization (modified node deltas or SynSCMTerrainAgent)",
+                               "delta", "delta,agent");
+    cli.AddOption<std::string>("Demo", "patch", "SCM moving patches (one per wheel or one under the chassis)",
+                               "wheels", "wheels,chassis");
+    cli.AddOption<double>("Demo", "height_res", "Resolution of the synchronized SCM heights",
+                          std::to_string(height_resolution));
 
     // Visualization is the only reason you should be shy about terrain size. The implementation can easily handle a
     // practically infinite terrain (provided you don't need to visualize it)
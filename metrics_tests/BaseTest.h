@@ -15,66 +15,476 @@
 #ifndef BASE_TEST_H
 #define BASE_TEST_H
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "MemoryStats.h"
+#include "PerfCounters.h"
+
+/// Incremental JSON writer.
+/// Values are written to the output stream as soon as they are added, so that arbitrarily long arrays can be
+/// encoded without buffering the document in memory. Non-finite floating point values are written as null.
+class JsonWriter {
+  public:
+    JsonWriter(std::ostream& os) : m_os(os), m_afterKey(false) { m_os.precision(12); }
+
+    void BeginObject() { Open('{', true); }
+    void EndObject() { Close('}'); }
+    void BeginArray() { Open('[', false); }
+    void EndArray() { Close(']'); }
+
+    void Key(const std::string& key) {
+        Separate();
+        WriteString(key);
+        m_os << ": ";
+        m_afterKey = true;
+    }
+
+    void Value(double value) {
+        Separate();
+        if (std::isfinite(value))
+            m_os << value;
+        else
+            m_os << "null";
+    }
+
+    void Value(int value) {
+        Separate();
+        m_os << value;
+    }
+
+    void Value(uint64_t value) {
+        Separate();
+        m_os << value;
+    }
+
+    void Value(const std::string& value) {
+        Separate();
+        WriteString(value);
+    }
+
+  private:
+    struct Scope {
+        bool is_object;  ///< object or array
+        bool empty;      ///< no elements written yet
+    };
+
+    void Open(char c, bool is_object) {
+        Separate();
+        m_os << c;
+        m_scopes.push_back({is_object, true});
+    }
+
+    void Close(char c) {
+        bool empty = m_scopes.back().empty;
+        bool is_object = m_scopes.back().is_object;
+        m_scopes.pop_back();
+        if (!empty && is_object)
+            Indent();
+        m_os << c;
+        if (m_scopes.empty())
+            m_os << "\n";
+    }
+
+    // Emit the separator (comma, newline, indentation) required before a new element.
+    void Separate() {
+        if (m_afterKey) {
+            m_afterKey = false;
+            return;
+        }
+        if (m_scopes.empty())
+            return;
+        Scope& scope = m_scopes.back();
+        if (!scope.empty)
+            m_os << (scope.is_object ? "," : ", ");
+        if (scope.is_object)
+            Indent();
+        scope.empty = false;
+    }
+
+    void Indent() { m_os << "\n" << std::string(4 * m_scopes.size(), ' '); }
+
+    void WriteString(const std::string& str) {
+        m_os << '"';
+        for (char c : str) {
+            switch (c) {
+                case '"':
+                    m_os << "\\\"";
+                    break;
+                case '\\':
+                    m_os << "\\\\";
+                    break;
+                case '\n':
+                    m_os << "\\n";
+                    break;
+                case '\t':
+                    m_os << "\\t";
+                    break;
+                default:
+                    m_os << c;
+            }
+        }
+        m_os << '"';
+    }
+
+    std::ostream& m_os;
+    std::vector<Scope> m_scopes;
+    bool m_afterKey;
+};
+
+/// In-memory JSON object with scalar, array, and nested object members.
 class Object {
   public:
-    Object() { m_content << "{"; }
+    Object() {}
     ~Object() {}
 
     void AddMember(const std::string& key, double value, bool verbose) {
         if (verbose)
             std::cout << "Adding entry " << key << " (type double)" << std::endl;
-        m_content << "\n    \"" << key << "\": " << value << ",";
+        Member m(key, Member::DOUBLE);
+        m.d = value;
+        m_members.push_back(m);
     }
 
-    void AddMember(const std::string& key, Object& value, bool verbose) {
+    void AddMember(const std::string& key, const Object& value, bool verbose) {
         if (verbose)
             std::cout << "Adding entry " << key << " (type Object)" << std::endl;
-        m_content << "\n    \"" << key << "\": " << value.GetContent() << ",";
+        Member m(key, Member::OBJECT);
+        m.obj = std::make_shared<Object>(value);
+        m_members.push_back(m);
     }
 
     void AddMember(const std::string& key, uint64_t value, bool verbose) {
         if (verbose)
             std::cout << "Adding entry " << key << " (type uint64)" << std::endl;
-        m_content << "\n    \"" << key << "\": " << value << ",";
+        Member m(key, Member::UINT64);
+        m.u = value;
+        m_members.push_back(m);
     }
 
     void AddMember(const std::string& key, int value, bool verbose) {
         if (verbose)
             std::cout << "Adding entry " << key << " (type int)" << std::endl;
-        m_content << "\n    \"" << key << "\": " << value << ",";
+        Member m(key, Member::INT);
+        m.i = value;
+        m_members.push_back(m);
     }
 
     void AddMember(const std::string& key, const std::string& value, bool verbose) {
         if (verbose)
             std::cout << "Adding entry " << key << " (type string)" << std::endl;
-        m_content << "\n    \"" << key << "\": \"" << value << "\",";
+        Member m(key, Member::STRING);
+        m.s = value;
+        m_members.push_back(m);
+    }
+
+    void AddMember(const std::string& key, const std::vector<double>& value, bool verbose) {
+        if (verbose)
+            std::cout << "Adding entry " << key << " (type array)" << std::endl;
+        Member m(key, Member::ARRAY);
+        m.v = value;
+        m_members.push_back(m);
+    }
+
+    /// Write the members of this object (without enclosing braces) to the given writer.
+    void WriteMembers(JsonWriter& writer) const {
+        for (const auto& m : m_members) {
+            writer.Key(m.key);
+            switch (m.type) {
+                case Member::DOUBLE:
+                    writer.Value(m.d);
+                    break;
+                case Member::INT:
+                    writer.Value(m.i);
+                    break;
+                case Member::UINT64:
+                    writer.Value(m.u);
+                    break;
+                case Member::STRING:
+                    writer.Value(m.s);
+                    break;
+                case Member::ARRAY:
+                    writer.BeginArray();
+                    for (auto x : m.v)
+                        writer.Value(x);
+                    writer.EndArray();
+                    break;
+                case Member::OBJECT:
+                    m.obj->Write(writer);
+                    break;
+            }
+        }
+    }
+
+    /// Write this object to the given writer.
+    void Write(JsonWriter& writer) const {
+        writer.BeginObject();
+        WriteMembers(writer);
+        writer.EndObject();
     }
 
     std::string GetContent() const {
-        if (m_content.str().length() == 1) {
-            return m_content.str() + "}\n";
+        std::stringstream content;
+        JsonWriter writer(content);
+        Write(writer);
+        return content.str();
+    }
+
+    /// Remove all members from this object.
+    void Clear() { m_members.clear(); }
+
+  private:
+    struct Member {
+        enum Type { DOUBLE, INT, UINT64, STRING, ARRAY, OBJECT };
+        Member(const std::string& k, Type t) : key(k), type(t), d(0), i(0), u(0) {}
+        std::string key;
+        Type type;
+        double d;
+        int i;
+        uint64_t u;
+        std::string s;
+        std::vector<double> v;
+        std::shared_ptr<Object> obj;
+    };
+
+    std::vector<Member> m_members;  // object members, in insertion order
+};
+
+/// Series metric (e.g., one value per simulation step).
+/// Values are buffered in fixed-size chunks which are spilled to a binary file (raw float64) as they fill up,
+/// so memory use does not grow with the length of the series. When the test output is written, the series is
+/// either copied inline into the JSON file or left in place as a binary sidecar file.
+class Series {
+  public:
+    Series(const std::string& name, const std::string& filename)
+        : m_name(name), m_filename(filename), m_size(0), m_min(0), m_max(0), m_sum(0) {
+        m_buffer.reserve(kChunkSize);
+        m_file.open(m_filename, std::ios::binary | std::ios::trunc);
+    }
+
+    ~Series() {
+        if (m_file.is_open()) {
+            m_file.close();
+            std::remove(m_filename.c_str());
+        }
+    }
+
+    /// Append a value to this series.
+    void push_back(double value) {
+        if (m_size == 0) {
+            m_min = value;
+            m_max = value;
+        } else {
+            m_min = std::min(m_min, value);
+            m_max = std::max(m_max, value);
+        }
+        m_sum += value;
+        m_size++;
+        m_buffer.push_back(value);
+        if (m_buffer.size() == kChunkSize)
+            Flush();
+    }
+
+    const std::string& GetName() const { return m_name; }
+    size_t GetSize() const { return m_size; }
+
+    /// Add summary information for this series (length, min, max, mean) to the given JSON object.
+    void AddSummary(Object& obj) const {
+        obj.AddMember("length", static_cast<uint64_t>(m_size), false);
+        obj.AddMember("min", m_min, false);
+        obj.AddMember("max", m_max, false);
+        obj.AddMember("mean", m_size > 0 ? m_sum / m_size : 0.0, false);
+    }
+
+    /// Finalize the series and write it to the given writer, either inline (as an array of values) or as a
+    /// reference to the binary sidecar file. In the former case, the spill file is removed.
+    void Write(JsonWriter& writer, bool sidecar) {
+        Flush();
+        m_file.close();
+
+        writer.BeginObject();
+        Object summary;
+        AddSummary(summary);
+        summary.WriteMembers(writer);
+
+        if (sidecar) {
+            writer.Key("sidecar");
+            writer.Value(m_filename.substr(m_filename.find_last_of('/') + 1));
+            writer.Key("format");
+            writer.Value(std::string("float64"));
+        } else {
+            writer.Key("values");
+            writer.BeginArray();
+            std::ifstream in(m_filename, std::ios::binary);
+            std::vector<double> chunk(kChunkSize);
+            while (in) {
+                in.read(reinterpret_cast<char*>(chunk.data()), kChunkSize * sizeof(double));
+                size_t n = static_cast<size_t>(in.gcount()) / sizeof(double);
+                for (size_t i = 0; i < n; i++)
+                    writer.Value(chunk[i]);
+            }
+            writer.EndArray();
+            in.close();
+            std::remove(m_filename.c_str());
         }
 
-        // Remove last comma and close the JSON object.
-        return m_content.str().substr(0, m_content.str().length() - 1) + "\n}\n";
+        writer.EndObject();
     }
 
   private:
-    std::stringstream m_content;  // object content (JSON format)
+    static const size_t kChunkSize = 4096;
+
+    void Flush() {
+        if (m_buffer.empty())
+            return;
+        m_file.write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size() * sizeof(double));
+        m_buffer.clear();
+    }
+
+    std::string m_name;
+    std::string m_filename;
+    std::ofstream m_file;
+    std::vector<double> m_buffer;
+    size_t m_size;
+    double m_min;
+    double m_max;
+    double m_sum;
+};
+
+/// Summary statistics over a set of samples (e.g., the execution times of repeated runs).
+struct SampleStatistics {
+    SampleStatistics(std::vector<double> samples)
+        : num(static_cast<int>(samples.size())), min(0), max(0), mean(0), median(0), p95(0), stddev(0) {
+        if (samples.empty())
+            return;
+
+        std::sort(samples.begin(), samples.end());
+        min = samples.front();
+        max = samples.back();
+
+        size_t n = samples.size();
+        median = (n % 2 == 1) ? samples[n / 2] : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+        p95 = samples[static_cast<size_t>(std::ceil(0.95 * n)) - 1];  // nearest-rank percentile
+
+        for (auto s : samples)
+            mean += s;
+        mean /= n;
+
+        if (n > 1) {
+            double var = 0;
+            for (auto s : samples)
+                var += (s - mean) * (s - mean);
+            stddev = std::sqrt(var / (n - 1));
+        }
+    }
+
+    /// Add these statistics as members of the given JSON object.
+    void AddTo(Object& obj) const {
+        obj.AddMember("num_samples", num, false);
+        obj.AddMember("min", min, false);
+        obj.AddMember("max", max, false);
+        obj.AddMember("mean", mean, false);
+        obj.AddMember("median", median, false);
+        obj.AddMember("p95", p95, false);
+        obj.AddMember("stddev", stddev, false);
+    }
+
+    int num;
+    double min;
+    double max;
+    double mean;
+    double median;
+    double p95;
+    double stddev;
+};
+
+/// Least-squares fit of a power law y = coefficient * x^exponent (linear regression in log-log space).
+/// Points with non-positive x or y are ignored. With fewer than two usable points (or a single distinct x value),
+/// the exponent and coefficient are NaN.
+struct PowerLawFit {
+    PowerLawFit(const std::vector<double>& x, const std::vector<double>& y)
+        : exponent(std::nan("")), coefficient(std::nan("")) {
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        int n = 0;
+        for (size_t i = 0; i < std::min(x.size(), y.size()); i++) {
+            if (x[i] <= 0 || y[i] <= 0)
+                continue;
+            double lx = std::log(x[i]);
+            double ly = std::log(y[i]);
+            sx += lx;
+            sy += ly;
+            sxx += lx * lx;
+            sxy += lx * ly;
+            n++;
+        }
+        double det = n * sxx - sx * sx;
+        if (n < 2 || det <= 0)
+            return;
+        exponent = (n * sxy - sx * sy) / det;
+        coefficient = std::exp((sy - exponent * sx) / n);
+    }
+
+    double exponent;
+    double coefficient;
 };
 
 class BaseTest {
   public:
+    /// Scoped timer for a named phase of a test (e.g., "setup", "settle", "measure").
+    /// Wall-clock time between construction and destruction (or an explicit call to stop()) is accumulated
+    /// under the given phase name. A phase may be timed several times during one execution. If hardware
+    /// counters are enabled, the counter values over the phase are accumulated as well.
+    class PhaseTimer {
+      public:
+        PhaseTimer(BaseTest& test, const std::string& name)
+            : m_test(test),
+              m_name(name),
+              m_running(true),
+              m_counters(test.m_counters.Read()),
+              m_start(std::chrono::steady_clock::now()) {}
+        ~PhaseTimer() { stop(); }
+
+        /// Stop the timer and record the elapsed time (no-op if already stopped).
+        void stop() {
+            if (!m_running)
+                return;
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_start;
+            m_test.addPhase(m_name, elapsed.count(), m_test.m_counters.Read() - m_counters);
+            m_running = false;
+        }
+
+      private:
+        PhaseTimer(const PhaseTimer&) = delete;
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+        BaseTest& m_test;
+        std::string m_name;
+        bool m_running;
+        PerfCounters::Values m_counters;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
     /// Constructor: Every test has to have a name and an associated project to it.
     BaseTest(const std::string& testName, const std::string& testProjectName)
-        : m_name(testName), m_projectName(testProjectName), m_outDir("."), m_verbose(false) {}
+        : m_name(testName),
+          m_projectName(testProjectName),
+          m_outDir("."),
+          m_verbose(false),
+          m_numWarmup(0),
+          m_numRuns(1),
+          m_sidecarThreshold(0),
+          m_useCounters(false) {}
 
     virtual ~BaseTest() {}
 
@@ -93,29 +503,134 @@ class BaseTest {
     /// Set output directory (default: current directory).
     void setOutDir(const std::string& outDir) { m_outDir = outDir; }
 
+    /// Set the number of warm-up and measured executions (default: no warm-up, one measured run).
+    /// Warm-up runs are executed but not recorded. With more than one measured run, the reported
+    /// execution time (and the time of each phase) is the median over all measured runs; the metrics
+    /// recorded through addMetric() are those of the last measured run.
+    /// Tests which run other tests (e.g., scaling tests) may override this to apply the repetitions to those tests.
+    virtual void setRepetitions(int num_warmup, int num_runs) {
+        m_numWarmup = std::max(num_warmup, 0);
+        m_numRuns = std::max(num_runs, 1);
+    }
+
+    /// Enable/disable collection of hardware performance counters (cycles, instructions, LLC misses, branch
+    /// misses) around each execution and each timed phase (default: disabled). If the counters are not
+    /// supported or not accessible on this system, only timing information is reported.
+    void enableHardwareCounters(bool val) { m_useCounters = val; }
+
     /// Main function for running the test.
     bool run() {
-        // Execute the actual test and collect metrics
-        bool passed = execute();
+        bool passed = true;
+
+        if (m_useCounters && !m_counters.Open())
+            std::cout << "Hardware performance counters not available" << std::endl;
+
+        // Warm-up executions (results discarded)
+        for (int i = 0; i < m_numWarmup; i++) {
+            resetRun();
+            passed &= execute();
+        }
+
+        // Measured executions
+        PhaseSamples exec_samples("execution");
+        std::vector<PhaseSamples> phase_samples;
+        std::vector<double> peak_rss;
+        std::vector<double> num_allocs;
+        std::vector<double> alloc_bytes;
+        for (int i = 0; i < m_numRuns; i++) {
+            resetRun();
+            MemoryStats::ResetPeakRSS();
+            uint64_t allocs_start = MemoryStats::GetAllocationCount();
+            uint64_t bytes_start = MemoryStats::GetAllocatedBytes();
+            PerfCounters::Values start = m_counters.Read();
+            passed &= execute();
+            exec_samples.Add(getExecutionTime(), m_counters.Read() - start);
+            peak_rss.push_back(static_cast<double>(MemoryStats::GetPeakRSS()));
+            num_allocs.push_back(static_cast<double>(MemoryStats::GetAllocationCount() - allocs_start));
+            alloc_bytes.push_back(static_cast<double>(MemoryStats::GetAllocatedBytes() - bytes_start));
+            for (const auto& phase : m_phases) {
+                auto p = std::find_if(phase_samples.begin(), phase_samples.end(),
+                                      [&phase](const PhaseSamples& ps) { return ps.name == phase.name; });
+                if (p == phase_samples.end()) {
+                    phase_samples.push_back(PhaseSamples(phase.name));
+                    p = phase_samples.end() - 1;
+                }
+                p->Add(phase.time, phase.counters);
+            }
+        }
 
-        // Populate output JSON string
+        SampleStatistics exec_stats(exec_samples.times);
+        Object json_exec_stats;
+        exec_stats.AddTo(json_exec_stats);
+        json_exec_stats.AddMember("num_warmup", m_numWarmup, false);
+
+        Object json_phases;
+        m_phaseMedians.clear();
+        for (const auto& ps : phase_samples) {
+            Object json_phase;
+            SampleStatistics phase_stats(ps.times);
+            phase_stats.AddTo(json_phase);
+            m_phaseMedians.push_back(std::make_pair(ps.name, phase_stats.median));
+            if (m_counters.IsAvailable()) {
+                Object json_phase_counters;
+                ps.AddCounters(json_phase_counters, m_counters);
+                json_phase.AddMember("counters", json_phase_counters, false);
+            }
+            json_phases.AddMember(ps.name, json_phase, false);
+        }
+
+        // Populate output JSON object (everything except the series data)
+        m_jsonTest.Clear();
         m_jsonTest.AddMember("name", m_name, false);
         m_jsonTest.AddMember("project_name", m_projectName, false);
         m_jsonTest.AddMember("passed", passed, false);
-        m_jsonTest.AddMember("execution_time", getExecutionTime(), false);
+        m_jsonTest.AddMember("execution_time", exec_stats.median, false);
+        m_jsonTest.AddMember("execution_stats", json_exec_stats, false);
+        m_jsonTest.AddMember("phases", json_phases, false);
+        Object json_memory;
+        json_memory.AddMember("peak_rss_bytes", static_cast<uint64_t>(SampleStatistics(peak_rss).max), false);
+        if (MemoryStats::CountingAllocations()) {
+            json_memory.AddMember("allocations", static_cast<uint64_t>(SampleStatistics(num_allocs).median), false);
+            json_memory.AddMember("allocated_bytes", static_cast<uint64_t>(SampleStatistics(alloc_bytes).median),
+                                  false);
+        }
+        m_jsonTest.AddMember("memory", json_memory, false);
+        if (m_counters.IsAvailable()) {
+            Object json_counters;
+            exec_samples.AddCounters(json_counters, m_counters);
+            m_jsonTest.AddMember("counters", json_counters, false);
+        }
         m_jsonTest.AddMember("metrics", m_jsonMetrics, false);
 
-        // Write output file
+        m_jsonSeries.Clear();
+        for (const auto& series : m_series) {
+            Object json_summary;
+            series->AddSummary(json_summary);
+            m_jsonSeries.AddMember(series->GetName(), json_summary, false);
+        }
+
+        // Write output file, streaming the series data from their spill files
         std::string fname = m_outDir + "/" + m_name + ".json";
         if (m_verbose)
             std::cout << "Write output file: " << fname << std::endl;
         m_jsonfile.open(fname);
         if (m_jsonfile.is_open()) {
-            m_jsonfile << m_jsonTest.GetContent();
+            JsonWriter writer(m_jsonfile);
+            writer.BeginObject();
+            m_jsonTest.WriteMembers(writer);
+            writer.Key("series");
+            writer.BeginObject();
+            for (const auto& series : m_series) {
+                writer.Key(series->GetName());
+                series->Write(writer, m_sidecarThreshold > 0 && series->GetSize() > m_sidecarThreshold);
+            }
+            writer.EndObject();
+            writer.EndObject();
             m_jsonfile.close();
         } else {
             std::cerr << "UNABLE to open file." << std::endl;
         }
+        m_series.clear();
 
         return passed;
     }
@@ -137,27 +652,136 @@ class BaseTest {
         m_jsonMetrics.AddMember(metricName, metricValue, m_verbose);
     }
 
-    // void addMetric(const std::string&   metricName,
-    //                std::vector<double>& metricValue) {
-    //   m_jsonMetrics.AddMember(metricName, metricValue, m_verbose);
-    // }
+    void addMetric(const std::string& metricName, const std::vector<double>& metricValue) {
+        m_jsonMetrics.AddMember(metricName, metricValue, m_verbose);
+    }
+
+    /// Get the series metric with specified name, creating it if necessary.
+    /// Use this for per-step data (e.g., step time, solver iterations, number of contacts) which is appended
+    /// with Series::push_back during execution of the test. The returned reference is valid until the end
+    /// of the current execution.
+    Series& addSeries(const std::string& seriesName) {
+        for (auto& series : m_series) {
+            if (series->GetName() == seriesName)
+                return *series;
+        }
+        // Sanitized name, made unique by the index of the series (names such as "a b" and "a_b" would collide)
+        std::string fname = seriesName;
+        std::replace_if(fname.begin(), fname.end(), [](char c) { return !std::isalnum(c); }, '_');
+        fname = m_outDir + "/" + m_name + "." + fname + "." + std::to_string(m_series.size()) + ".bin";
+        if (m_verbose)
+            std::cout << "Adding series " << seriesName << std::endl;
+        m_series.push_back(std::unique_ptr<Series>(new Series(seriesName, fname)));
+        return *m_series.back();
+    }
+
+    /// Set the length above which a series is kept as a binary sidecar file (raw float64 values, named
+    /// <test name>.<series name>.<series index>.bin in the output directory) instead of being written inline in
+    /// the JSON output. Default: 0 (always write series inline).
+    void setSeriesSidecarThreshold(size_t length) { m_sidecarThreshold = length; }
+
+    /// Accumulate time (in seconds) for the named phase during the current execution.
+    /// Tests can call this directly to report phase times measured with their own timers; otherwise, use a
+    /// PhaseTimer object to time a scope.
+    void addPhaseTime(const std::string& phaseName, double seconds) {
+        PerfCounters::Values none;
+        for (int i = 0; i < PerfCounters::NUM_COUNTERS; i++)
+            none.v[i] = -1;
+        addPhase(phaseName, seconds, none);
+    }
+
+    /// Return the median time (over the measured executions of the last call to run()) of the named phase.
+    /// Return 0 if the phase was not timed.
+    double getPhaseTime(const std::string& phaseName) const {
+        for (const auto& phase : m_phaseMedians) {
+            if (phase.first == phaseName)
+                return phase.second;
+        }
+        return 0;
+    }
 
     /// Execute the actual test.
     /// A derived class must implement this function to return true if the test passes
     /// and false otherwise. During execution of the test, various performance metrics
-    /// can be cached by calling the addMetric() methods.
+    /// can be cached by calling the addMetric() methods and per-step data recorded with addSeries().
     virtual bool execute() = 0;
 
     /// Return total execution time for this test.
     virtual double getExecutionTime() const = 0;
 
-    /// Print the content of the JSON string.
-    void print() {
+    /// Write the results of the last call to run() as a JSON object (series are summarized, not listed).
+    void write(JsonWriter& writer) const {
+        writer.BeginObject();
+        m_jsonTest.WriteMembers(writer);
+        writer.Key("series");
+        m_jsonSeries.Write(writer);
+        writer.EndObject();
+    }
+
+    /// Print the content of the JSON output (series are summarized, not listed).
+    void print() const {
         std::cout << "Test Information: " << std::endl;
-        std::cout << m_jsonTest.GetContent();
+        JsonWriter writer(std::cout);
+        write(writer);
     }
 
   private:
+    /// Data collected for a phase during one execution.
+    struct PhaseData {
+        std::string name;
+        double time;
+        PerfCounters::Values counters;
+    };
+
+    /// Samples collected for a phase over all measured executions.
+    struct PhaseSamples {
+        PhaseSamples(const std::string& phase_name) : name(phase_name) {}
+
+        void Add(double time, const PerfCounters::Values& values) {
+            times.push_back(time);
+            for (int i = 0; i < PerfCounters::NUM_COUNTERS; i++)
+                counters[i].push_back(values.v[i]);
+        }
+
+        // Add median counter values (and derived IPC) for all available counters.
+        void AddCounters(Object& obj, const PerfCounters& perf) const {
+            double median[PerfCounters::NUM_COUNTERS];
+            for (int i = 0; i < PerfCounters::NUM_COUNTERS; i++) {
+                median[i] = -1;
+                if (!perf.IsAvailable(i) || std::count_if(counters[i].begin(), counters[i].end(),
+                                                          [](double v) { return v < 0; }) > 0)
+                    continue;
+                median[i] = SampleStatistics(counters[i]).median;
+                obj.AddMember(PerfCounters::GetName(i), median[i], false);
+            }
+            if (median[0] > 0 && median[1] >= 0)
+                obj.AddMember("ipc", median[1] / median[0], false);
+        }
+
+        std::string name;
+        std::vector<double> times;
+        std::vector<double> counters[PerfCounters::NUM_COUNTERS];
+    };
+
+    /// Accumulate time and counter values for the named phase during the current execution.
+    void addPhase(const std::string& phaseName, double seconds, const PerfCounters::Values& counters) {
+        for (auto& phase : m_phases) {
+            if (phase.name == phaseName) {
+                phase.time += seconds;
+                phase.counters += counters;
+                return;
+            }
+        }
+        m_phases.push_back({phaseName, seconds, counters});
+    }
+
+    /// Reset per-execution data before a new call to execute().
+    void resetRun() {
+        m_jsonMetrics.Clear();
+        m_phases.clear();
+        m_series.clear();
+    }
+
     std::ofstream m_jsonfile;   ///< Output JSON file
     std::string m_name;         ///< Name of test
     std::string m_projectName;  ///< Name of the project
@@ -165,6 +789,18 @@ class BaseTest {
     bool m_verbose;             ///< Verbose output
     Object m_jsonMetrics;       ///< collected metrics
     Object m_jsonTest;          ///< JSON output of the test
+    Object m_jsonSeries;        ///< summaries of the series metrics
+    int m_numWarmup;            ///< number of warm-up executions
+    int m_numRuns;              ///< number of measured executions
+
+    size_t m_sidecarThreshold;  ///< series length above which a binary sidecar is used
+    bool m_useCounters;         ///< collect hardware performance counters
+    PerfCounters m_counters;    ///< hardware performance counters
+
+    std::vector<PhaseData> m_phases;                ///< phase data for the current execution
+    std::vector<std::unique_ptr<Series>> m_series;  ///< series metrics for the current execution
+
+    std::vector<std::pair<std::string, double>> m_phaseMedians;  ///< median phase times from last run()
 };
 
 #endif
@@ -0,0 +1,102 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Bulk contact report into contiguous arrays, for per-step contact
+// post-processing.
+//
+// ContactArrays holds the data of all contacts as structure-of-arrays: contact
+// points on the two objects, contact normal (from A to B), signed distance
+// (negative for penetration), contact force on B (absolute frame), and the two
+// contactables. The arrays are owned by the caller and reused from step to
+// step: they are resized to the number of contacts, which does not reallocate
+// once their capacity covers the largest contact count seen.
+//
+// ContactArrayReporter fills the arrays from a ChContactContainer (e.g., of a
+// ChSystemSMC) in one pass of ReportAllContacts(), writing each contact at its
+// index. See multicore/ContactArraysMulticore.h for the Chrono::Multicore
+// version, which copies the data manager arrays directly.
+//
+// =============================================================================
+
+#ifndef CONTACT_ARRAYS_H
+#define CONTACT_ARRAYS_H
+
+#include <memory>
+#include <vector>
+
+#include "chrono/physics/ChContactContainer.h"
+
+struct ContactArrays {
+    int num_contacts = 0;
+    std::vector<chrono::ChVector<>> pointA;  // contact point on object A
+    std::vector<chrono::ChVector<>> pointB;  // contact point on object B
+    std::vector<chrono::ChVector<>> normal;  // contact normal, from A to B
+    std::vector<double> distance;            // signed distance (negative for penetration)
+    std::vector<chrono::ChVector<>> force;   // contact force on B, in the absolute frame (opposite on A)
+    std::vector<chrono::ChContactable*> objA;
+    std::vector<chrono::ChContactable*> objB;
+
+    /// Set the number of contacts (without reallocation if the capacity of the arrays is sufficient).
+    void Resize(int n) {
+        num_contacts = n;
+        pointA.resize(n);
+        pointB.resize(n);
+        normal.resize(n);
+        distance.resize(n);
+        force.resize(n);
+        objA.resize(n);
+        objB.resize(n);
+    }
+};
+
+class ContactArrayReporter : public chrono::ChContactContainer::ReportContactCallback,
+                             public std::enable_shared_from_this<ContactArrayReporter> {
+  public:
+    ContactArrayReporter(ContactArrays& arrays) : m_arrays(arrays), m_index(0) {}
+
+    /// Fill the arrays with all contacts in the given container. Return the number of contacts.
+    int Fill(chrono::ChContactContainer& container) {
+        m_arrays.Resize(container.GetNcontacts());
+        m_index = 0;
+        container.ReportAllContacts(shared_from_this());
+        m_arrays.Resize(m_index);
+        return m_index;
+    }
+
+  private:
+    virtual bool OnReportContact(const chrono::ChVector<>& pA,
+                                 const chrono::ChVector<>& pB,
+                                 const chrono::ChMatrix33<>& plane_coord,
+                                 const double& distance,
+                                 const double& eff_radius,
+                                 const chrono::ChVector<>& react_forces,
+                                 const chrono::ChVector<>& react_torques,
+                                 chrono::ChContactable* objA,
+                                 chrono::ChContactable* objB) override {
+        int i = m_index++;
+        if (i >= m_arrays.num_contacts)
+            m_arrays.Resize(i + 1);
+        m_arrays.pointA[i] = pA;
+        m_arrays.pointB[i] = pB;
+        m_arrays.normal[i] = plane_coord.Get_A_Xaxis();
+        m_arrays.distance[i] = distance;
+        m_arrays.force[i] = plane_coord * react_forces;
+        m_arrays.objA[i] = objA;
+        m_arrays.objB[i] = objB;
+        return true;
+    }
+
+    ContactArrays& m_arrays;
+    int m_index;  // index of the next reported contact
+};
+
+#endif
@@ -0,0 +1,178 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Dense contact-force accumulator, an alternative to
+// ChContactContainer::ComputeContactForces() for force output.
+//
+// ComputeContactForces() rebuilds an unordered_map keyed by contactable at each
+// call. Here, the contactables of interest (bodies and node-cloud contact
+// surfaces) are registered once and receive a dense index; at each call to
+// Compute(), the accumulators are zeroed (no reallocation) and all contacts are
+// processed through ReportAllContacts(). Contactables are located by binary
+// search in a sorted array (no hashing); contacts involving unregistered
+// contactables are ignored. For a node cloud, the resultant on the surface and
+// (optionally) the force on each contact node are accumulated.
+//
+// As in ComputeContactForces(), the contact force (expressed in the contact
+// plane) is applied with a negative sign to the first object and torques of
+// bodies are taken about the body reference frame origin.
+//
+// =============================================================================
+
+#ifndef CONTACT_FORCE_MAP_H
+#define CONTACT_FORCE_MAP_H
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChContactContainer.h"
+#include "chrono/fea/ChContactSurfaceNodeCloud.h"
+
+class ContactForceMap : public chrono::ChContactContainer::ReportContactCallback,
+                        public std::enable_shared_from_this<ContactForceMap> {
+  public:
+    ContactForceMap() : m_sorted(true) {}
+
+    /// Register a body. Return its index.
+    int AddBody(std::shared_ptr<chrono::ChBody> body) {
+        int index = NewEntry(body.get());
+        Register(body.get(), index, -1);
+        return index;
+    }
+
+    /// Register all nodes of a node-cloud contact surface. Return the index of the surface.
+    /// If per_node is true, the force on each contact node is also available through GetNodeForce().
+    int AddNodeCloud(std::shared_ptr<chrono::fea::ChContactSurfaceNodeCloud> surface, bool per_node = false) {
+        int index = NewEntry(nullptr);
+        unsigned int num_nodes = surface->GetNnodes();
+        m_entries[index].node_start = (int)m_node_forces.size();
+        m_entries[index].num_nodes = per_node ? (int)num_nodes : 0;
+        for (unsigned int in = 0; in < num_nodes; in++) {
+            chrono::ChContactable* node = surface->GetNode(in).get();
+            Register(node, index, per_node ? m_entries[index].node_start + (int)in : -1);
+        }
+        if (per_node)
+            m_node_forces.resize(m_node_forces.size() + num_nodes);
+        return index;
+    }
+
+    /// Accumulate the forces of all contacts in the given container.
+    void Compute(chrono::ChContactContainer& container) {
+        if (!m_sorted) {
+            std::sort(m_lookup.begin(), m_lookup.end(),
+                      [](const Item& a, const Item& b) { return a.contactable < b.contactable; });
+            m_sorted = true;
+        }
+        for (auto& entry : m_entries) {
+            entry.force = chrono::VNULL;
+            entry.torque = chrono::VNULL;
+            entry.num_contacts = 0;
+        }
+        std::fill(m_node_forces.begin(), m_node_forces.end(), chrono::VNULL);
+
+        container.ReportAllContacts(shared_from_this());
+    }
+
+    /// Resultant contact force (absolute frame) on the registered item with given index.
+    const chrono::ChVector<>& GetForce(int index) const { return m_entries[index].force; }
+
+    /// Resultant contact torque (absolute frame, about the body origin) on the registered body with given index.
+    const chrono::ChVector<>& GetTorque(int index) const { return m_entries[index].torque; }
+
+    /// Number of contacts of the registered item with given index.
+    int GetNumContacts(int index) const { return m_entries[index].num_contacts; }
+
+    /// Contact force on the specified node of the node cloud with given index (if registered with per_node).
+    const chrono::ChVector<>& GetNodeForce(int index, unsigned int node) const {
+        return m_node_forces[m_entries[index].node_start + node];
+    }
+
+    /// Number of nodes with a force breakdown for the node cloud with given index (0 if not registered per node).
+    int GetNumNodes(int index) const { return m_entries[index].num_nodes; }
+
+  private:
+    struct Entry {
+        chrono::ChBody* body;     // body (nullptr for node clouds)
+        chrono::ChVector<> force;
+        chrono::ChVector<> torque;
+        int num_contacts;
+        int node_start;           // offset of the first node in m_node_forces
+        int num_nodes;            // number of nodes with force breakdown
+    };
+
+    struct Item {
+        chrono::ChContactable* contactable;
+        int index;  // entry index
+        int node;   // node force index (-1 if none)
+    };
+
+    int NewEntry(chrono::ChBody* body) {
+        Entry entry;
+        entry.body = body;
+        entry.num_contacts = 0;
+        entry.node_start = 0;
+        entry.num_nodes = 0;
+        m_entries.push_back(entry);
+        return (int)m_entries.size() - 1;
+    }
+
+    void Register(chrono::ChContactable* contactable, int index, int node) {
+        m_lookup.push_back({contactable, index, node});
+        m_sorted = false;
+    }
+
+    const Item* Find(chrono::ChContactable* contactable) const {
+        auto item = std::lower_bound(m_lookup.begin(), m_lookup.end(), contactable,
+                                     [](const Item& a, chrono::ChContactable* b) { return a.contactable < b; });
+        if (item == m_lookup.end() || item->contactable != contactable)
+            return nullptr;
+        return &(*item);
+    }
+
+    void Accumulate(chrono::ChContactable* contactable, const chrono::ChVector<>& point, const chrono::ChVector<>& force) {
+        const Item* item = Find(contactable);
+        if (!item)
+            return;
+        Entry& entry = m_entries[item->index];
+        entry.force += force;
+        if (entry.body)
+            entry.torque += chrono::Vcross(point - entry.body->GetPos(), force);
+        entry.num_contacts++;
+        if (item->node >= 0)
+            m_node_forces[item->node] += force;
+    }
+
+    virtual bool OnReportContact(const chrono::ChVector<>& pA,
+                                 const chrono::ChVector<>& pB,
+                                 const chrono::ChMatrix33<>& plane_coord,
+                                 const double& distance,
+                                 const double& eff_radius,
+                                 const chrono::ChVector<>& react_forces,
+                                 const chrono::ChVector<>& react_torques,
+                                 chrono::ChContactable* objA,
+                                 chrono::ChContactable* objB) override {
+        chrono::ChVector<> force = plane_coord * react_forces;
+        Accumulate(objA, pA, -force);
+        Accumulate(objB, pB, force);
+        return true;
+    }
+
+    std::vector<Entry> m_entries;
+    std::vector<Item> m_lookup;  // registered contactables, sorted by address
+    std::vector<chrono::ChVector<>> m_node_forces;
+    bool m_sorted;
+};
+
+#endif
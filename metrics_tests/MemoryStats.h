@@ -0,0 +1,177 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Memory statistics for metrics tests: peak resident set size and (optionally)
+// heap allocation counts.
+//
+// Allocation counting replaces the global operator new/delete and is enabled
+// only if METRICS_COUNT_ALLOCATIONS is defined (see the CMake option of the
+// same name). Since the replacement operators are defined here, this header
+// must be included in a single translation unit of a given program (which is
+// the case for all stand-alone metrics tests). In metrics_runner, which links
+// several tests together (METRICS_RUNNER defined), the operators are defined
+// only in the translation unit that also defines METRICS_RUNNER_MAIN.
+//
+// =============================================================================
+
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+class MemoryStats {
+  public:
+    /// Return true if heap allocations are being counted.
+    static bool CountingAllocations() {
+#ifdef METRICS_COUNT_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /// Number of heap allocations (through operator new) since program start.
+    static uint64_t GetAllocationCount() { return AllocationCount().load(std::memory_order_relaxed); }
+
+    /// Number of bytes allocated on the heap (through operator new) since program start.
+    static uint64_t GetAllocatedBytes() { return AllocatedBytes().load(std::memory_order_relaxed); }
+
+    /// Record an allocation of the given size (called by the replacement operator new).
+    static void RecordAllocation(std::size_t size) {
+        AllocationCount().fetch_add(1, std::memory_order_relaxed);
+        AllocatedBytes().fetch_add(size, std::memory_order_relaxed);
+    }
+
+    /// Peak resident set size of the process, in bytes (0 if not available).
+    /// On Linux, this is the high-water mark since the last call to ResetPeakRSS().
+    static uint64_t GetPeakRSS() {
+#if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS info;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &info, sizeof(info)))
+            return static_cast<uint64_t>(info.PeakWorkingSetSize);
+        return 0;
+#else
+#if defined(__linux__)
+        // VmHWM can be reset (unlike the getrusage maximum)
+        if (FILE* f = std::fopen("/proc/self/status", "r")) {
+            char line[256];
+            unsigned long long kb = 0;
+            bool found = false;
+            while (std::fgets(line, sizeof(line), f)) {
+                if (std::strncmp(line, "VmHWM:", 6) == 0) {
+                    found = (std::sscanf(line + 6, "%llu", &kb) == 1);
+                    break;
+                }
+            }
+            std::fclose(f);
+            if (found)
+                return static_cast<uint64_t>(kb) * 1024;
+        }
+#endif
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+#if defined(__APPLE__)
+        return static_cast<uint64_t>(usage.ru_maxrss);  // bytes
+#else
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024;  // kilobytes
+#endif
+#endif
+    }
+
+    /// Reset the peak resident set size to the current RSS (Linux only; no-op elsewhere).
+    /// Return false if the reset is not supported.
+    static bool ResetPeakRSS() {
+#if defined(__linux__)
+        if (FILE* f = std::fopen("/proc/self/clear_refs", "w")) {
+            bool ok = (std::fputs("5", f) >= 0);
+            ok &= (std::fclose(f) == 0);
+            return ok;
+        }
+#endif
+        return false;
+    }
+
+  private:
+    static std::atomic<uint64_t>& AllocationCount() {
+        static std::atomic<uint64_t> count(0);
+        return count;
+    }
+    static std::atomic<uint64_t>& AllocatedBytes() {
+        static std::atomic<uint64_t> bytes(0);
+        return bytes;
+    }
+};
+
+#if defined(METRICS_COUNT_ALLOCATIONS) && (!defined(METRICS_RUNNER) || defined(METRICS_RUNNER_MAIN))
+
+// Replacement global allocation functions (non-aligned versions only).
+
+void* operator new(std::size_t size) {
+    MemoryStats::RecordAllocation(size);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    MemoryStats::RecordAllocation(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+#endif
+
+#endif
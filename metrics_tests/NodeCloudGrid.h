@@ -0,0 +1,210 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Uniform-grid spatial hash for FEA node clouds, used as a broadphase for
+// node-body collision detection.
+//
+// Nodes are binned in cubic cells of given size, stored in a hash map keyed by
+// the packed integer cell coordinates. The grid is updated incrementally: at
+// each call to Update(), only nodes which moved to a different cell are
+// relocated (constant time per node). A query returns the nodes in all cells
+// overlapping a given axis-aligned box; these are the candidate pairs which
+// must then be checked by the narrow phase. Counters of candidates and of
+// actual contacts (reported by the caller) are accumulated.
+//
+// =============================================================================
+
+#ifndef NODE_CLOUD_GRID_H
+#define NODE_CLOUD_GRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "chrono/core/ChVector.h"
+
+class NodeCloudGrid {
+  public:
+    /// Create a grid with the given cell size (typically a few times the contact node radius).
+    NodeCloudGrid(double cell_size)
+        : m_inv_size(1 / cell_size),
+          m_num_updates(0),
+          m_num_moved(0),
+          m_num_queries(0),
+          m_num_candidates(0),
+          m_num_contacts(0) {
+        for (int k = 0; k < 3; k++) {
+            m_lo[k] = INT32_MAX;
+            m_hi[k] = INT32_MIN;
+        }
+    }
+
+    /// Update the grid for the current node positions. pos(i) must return the position of the i-th node.
+    /// The grid is rebuilt from scratch if the number of nodes changed; otherwise nodes are relocated as needed.
+    template <typename PositionFunction>
+    void Update(unsigned int num_nodes, PositionFunction pos) {
+        if (num_nodes != m_node_cell.size())
+            Clear(num_nodes);
+
+        for (int k = 0; k < 3; k++) {
+            m_lo[k] = INT32_MAX;
+            m_hi[k] = INT32_MIN;
+        }
+
+        for (unsigned int in = 0; in < num_nodes; in++) {
+            int c[3];
+            GetCell(pos(in), c);
+            for (int k = 0; k < 3; k++) {
+                m_lo[k] = std::min(m_lo[k], c[k]);
+                m_hi[k] = std::max(m_hi[k], c[k]);
+            }
+            uint64_t key = PackKey(c);
+            if (key == m_node_cell[in])
+                continue;
+            Remove(in);
+            Insert(in, key);
+            m_num_moved++;
+        }
+
+        m_num_updates++;
+    }
+
+    /// Collect the nodes in all cells overlapping the box [min, max] (the box is clipped to the occupied cells).
+    /// The candidate nodes are appended to the given list, in no particular order.
+    void Query(const chrono::ChVector<>& min, const chrono::ChVector<>& max, std::vector<unsigned int>& nodes) const {
+        int lo[3];
+        int hi[3];
+        for (int k = 0; k < 3; k++) {
+            lo[k] = std::max(m_lo[k], ClampedCell(min[k]));
+            hi[k] = std::min(m_hi[k], ClampedCell(max[k]));
+            if (lo[k] > hi[k])
+                return;
+        }
+
+        size_t start = nodes.size();
+        double num_cells = (double)(hi[0] - lo[0] + 1) * (hi[1] - lo[1] + 1) * (hi[2] - lo[2] + 1);
+        if (num_cells <= m_cells.size()) {
+            // Visit the cells in the box
+            int c[3];
+            for (c[0] = lo[0]; c[0] <= hi[0]; c[0]++) {
+                for (c[1] = lo[1]; c[1] <= hi[1]; c[1]++) {
+                    for (c[2] = lo[2]; c[2] <= hi[2]; c[2]++) {
+                        auto cell = m_cells.find(PackKey(c));
+                        if (cell != m_cells.end())
+                            nodes.insert(nodes.end(), cell->second.begin(), cell->second.end());
+                    }
+                }
+            }
+        } else {
+            // Fewer occupied cells than cells in the box: visit the occupied cells
+            for (const auto& cell : m_cells) {
+                int c[3];
+                UnpackKey(cell.first, c);
+                if (c[0] >= lo[0] && c[0] <= hi[0] && c[1] >= lo[1] && c[1] <= hi[1] && c[2] >= lo[2] && c[2] <= hi[2])
+                    nodes.insert(nodes.end(), cell.second.begin(), cell.second.end());
+            }
+        }
+
+        m_num_queries++;
+        m_num_candidates += nodes.size() - start;
+    }
+
+    /// Record the number of actual contacts found by the narrow phase among the candidates of the last query.
+    void AddContacts(unsigned int num_contacts) { m_num_contacts += num_contacts; }
+
+    /// Reset the counters.
+    void ResetStats() {
+        m_num_updates = 0;
+        m_num_moved = 0;
+        m_num_queries = 0;
+        m_num_candidates = 0;
+        m_num_contacts = 0;
+    }
+
+    unsigned int GetNumCells() const { return (unsigned int)m_cells.size(); }
+    unsigned long long GetNumUpdates() const { return m_num_updates; }
+    unsigned long long GetNumMoved() const { return m_num_moved; }
+    unsigned long long GetNumQueries() const { return m_num_queries; }
+    unsigned long long GetNumCandidates() const { return m_num_candidates; }
+    unsigned long long GetNumContacts() const { return m_num_contacts; }
+
+  private:
+    static const uint64_t NO_CELL = ~uint64_t(0);
+    static const int BIAS = 1 << 20;  // cell coordinates are limited to [-2^20, 2^20)
+
+    void Clear(unsigned int num_nodes) {
+        m_cells.clear();
+        m_node_cell.assign(num_nodes, uint64_t(NO_CELL));
+        m_node_slot.assign(num_nodes, 0);
+    }
+
+    int ClampedCell(double x) const {
+        double c = std::floor(x * m_inv_size);
+        return (int)std::max(std::min(c, (double)(BIAS - 1)), (double)(-BIAS));
+    }
+
+    void GetCell(const chrono::ChVector<>& p, int* c) const {
+        for (int k = 0; k < 3; k++)
+            c[k] = ClampedCell(p[k]);
+    }
+
+    static uint64_t PackKey(const int* c) {
+        return ((uint64_t)(c[0] + BIAS) << 42) | ((uint64_t)(c[1] + BIAS) << 21) | (uint64_t)(c[2] + BIAS);
+    }
+
+    static void UnpackKey(uint64_t key, int* c) {
+        const uint64_t mask = (uint64_t(1) << 21) - 1;
+        c[0] = (int)((key >> 42) & mask) - BIAS;
+        c[1] = (int)((key >> 21) & mask) - BIAS;
+        c[2] = (int)(key & mask) - BIAS;
+    }
+
+    // Remove a node from its current cell (swap with the last node of the cell).
+    void Remove(unsigned int node) {
+        if (m_node_cell[node] == NO_CELL)
+            return;
+        auto cell = m_cells.find(m_node_cell[node]);
+        auto& list = cell->second;
+        unsigned int slot = m_node_slot[node];
+        unsigned int last = list.back();
+        list[slot] = last;
+        m_node_slot[last] = slot;
+        list.pop_back();
+        if (list.empty())
+            m_cells.erase(cell);
+        m_node_cell[node] = NO_CELL;
+    }
+
+    void Insert(unsigned int node, uint64_t key) {
+        auto& list = m_cells[key];
+        m_node_slot[node] = (unsigned int)list.size();
+        list.push_back(node);
+        m_node_cell[node] = key;
+    }
+
+    double m_inv_size;
+    std::unordered_map<uint64_t, std::vector<unsigned int>> m_cells;  // occupied cells
+    std::vector<uint64_t> m_node_cell;                                // current cell of each node
+    std::vector<unsigned int> m_node_slot;                            // position of each node in its cell list
+    int m_lo[3];                                                      // bounds of the occupied cells
+    int m_hi[3];
+
+    unsigned long long m_num_updates;
+    unsigned long long m_num_moved;
+    mutable unsigned long long m_num_queries;
+    mutable unsigned long long m_num_candidates;
+    unsigned long long m_num_contacts;
+};
+
+#endif
@@ -0,0 +1,141 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Hardware performance counters for metrics tests (Linux perf_event).
+// On other platforms, or if the kernel does not allow access to the counters
+// (e.g., restrictive perf_event_paranoid setting), no counters are available
+// and tests fall back to timing only.
+//
+// =============================================================================
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define METRICS_HAVE_PERF_EVENT
+#endif
+
+/// Set of hardware performance counters: cycles, instructions, last-level cache misses, and branch misses.
+/// The counters are opened for the calling thread and inherited by threads created afterwards (e.g., an OpenMP
+/// thread pool started during the test). They run continuously once opened; use Read() before and after a code
+/// region and take the difference.
+class PerfCounters {
+  public:
+    static const int NUM_COUNTERS = 4;
+
+    /// Counter values (scaled to account for multiplexing). A negative value indicates an unavailable counter.
+    struct Values {
+        Values() {
+            for (int i = 0; i < NUM_COUNTERS; i++)
+                v[i] = 0;
+        }
+        Values operator-(const Values& other) const {
+            Values res;
+            for (int i = 0; i < NUM_COUNTERS; i++)
+                res.v[i] = (v[i] < 0 || other.v[i] < 0) ? -1 : v[i] - other.v[i];
+            return res;
+        }
+        Values& operator+=(const Values& other) {
+            for (int i = 0; i < NUM_COUNTERS; i++)
+                v[i] = (v[i] < 0 || other.v[i] < 0) ? -1 : v[i] + other.v[i];
+            return *this;
+        }
+        double v[NUM_COUNTERS];
+    };
+
+    PerfCounters() : m_available(false) {
+        for (int i = 0; i < NUM_COUNTERS; i++)
+            m_fd[i] = -1;
+    }
+
+    ~PerfCounters() { Close(); }
+
+    /// Name of the specified counter (as used in the JSON output).
+    static const char* GetName(int i) {
+        static const char* names[NUM_COUNTERS] = {"cycles", "instructions", "llc_misses", "branch_misses"};
+        return names[i];
+    }
+
+    /// Open the counters. Return false if none of them is available.
+    bool Open() {
+        if (m_available)
+            return true;
+#ifdef METRICS_HAVE_PERF_EVENT
+        static const uint64_t configs[NUM_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                       PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            struct perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = configs[i];
+            attr.inherit = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            m_fd[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+            if (m_fd[i] >= 0)
+                m_available = true;
+        }
+#endif
+        return m_available;
+    }
+
+    /// Close all counters.
+    void Close() {
+#ifdef METRICS_HAVE_PERF_EVENT
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            if (m_fd[i] >= 0)
+                close(m_fd[i]);
+            m_fd[i] = -1;
+        }
+#endif
+        m_available = false;
+    }
+
+    /// Return true if at least one counter is available.
+    bool IsAvailable() const { return m_available; }
+
+    /// Return true if the specified counter is available.
+    bool IsAvailable(int i) const { return m_fd[i] >= 0; }
+
+    /// Read the current counter values.
+    Values Read() const {
+        Values res;
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            res.v[i] = -1;
+#ifdef METRICS_HAVE_PERF_EVENT
+            if (m_fd[i] < 0)
+                continue;
+            uint64_t data[3];  // value, time enabled, time running
+            if (read(m_fd[i], data, sizeof(data)) != sizeof(data))
+                continue;
+            double scale = (data[2] > 0) ? static_cast<double>(data[1]) / data[2] : 1.0;
+            res.v[i] = static_cast<double>(data[0]) * scale;
+#endif
+        }
+        return res;
+    }
+
+  private:
+    int m_fd[NUM_COUNTERS];
+    bool m_available;
+};
+
+#endif
@@ -0,0 +1,83 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Registry of metrics tests.
+//
+// Each metrics program registers its tests (at static initialization time) with
+// a TestRegistrar object. Stand-alone programs run their tests from their own
+// main(); when compiled into metrics_runner (METRICS_RUNNER defined), main() is
+// omitted and the runner creates and runs any subset of the registered tests.
+//
+// =============================================================================
+
+#ifndef TEST_REGISTRY_H
+#define TEST_REGISTRY_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BaseTest.h"
+
+class TestRegistry {
+  public:
+    /// Function creating a test with given name and project name.
+    typedef std::function<std::unique_ptr<BaseTest>(const std::string&, const std::string&)> Factory;
+
+    /// Registered test.
+    struct Entry {
+        std::string name;     ///< test name
+        std::string project;  ///< project name
+        Factory factory;      ///< test factory
+    };
+
+    /// Access the global registry.
+    static TestRegistry& Get() {
+        static TestRegistry registry;
+        return registry;
+    }
+
+    /// Register a test.
+    void Add(const std::string& name, const std::string& project, Factory factory) {
+        m_entries.push_back({name, project, factory});
+    }
+
+    /// Return all registered tests, in registration order.
+    const std::vector<Entry>& GetEntries() const { return m_entries; }
+
+    /// Create a factory for a test of type T, constructed as T(name, project, args...).
+    template <typename T, typename... Args>
+    static Factory MakeFactory(Args... args) {
+        return [=](const std::string& name, const std::string& project) {
+            return std::unique_ptr<BaseTest>(new T(name, project, args...));
+        };
+    }
+
+  private:
+    TestRegistry() {}
+
+    std::vector<Entry> m_entries;
+};
+
+/// Helper for registering a test at static initialization time. For example:
+/// <pre>
+///   TestRegistrar reg_beam("metrics_FEA_ANCFBeam", "Chrono::FEA", TestRegistry::MakeFactory<ANCFBeamTest>());
+/// </pre>
+class TestRegistrar {
+  public:
+    TestRegistrar(const std::string& name, const std::string& project, TestRegistry::Factory factory) {
+        TestRegistry::Get().Add(name, project, factory);
+    }
+};
+
+#endif
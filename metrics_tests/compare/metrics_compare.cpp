@@ -0,0 +1,412 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Comparison of metrics test outputs against a stored baseline.
+//
+// Usage:
+//    metrics_compare <results_dir> <baseline_file>
+//    metrics_compare --update <results_dir> <baseline_file> [test_name ...]
+//
+// In comparison mode, the JSON output <results_dir>/<test_name>.json of every
+// test listed in the baseline is checked against the baseline values. The
+// program returns a nonzero value if any test failed, is missing, or if its
+// execution time or one of its metrics regressed beyond the allowed band.
+//
+// In update mode, the baseline entries for all tests already in the baseline
+// (plus any tests named on the command line) are overwritten with the current
+// results. Tolerances (global and per test) are preserved. A baseline file that
+// exists but cannot be parsed is not overwritten.
+//
+// Baseline file format:
+//    {
+//      "tolerances": {
+//        "default":        { "rel": 0.1, "abs": 0, "sigma": 3 },
+//        "execution_time": { "rel": 0.15, "sigma": 3, "direction": "lower" },
+//        "metrics": {
+//          "number_iterations": { "abs": 2, "direction": "lower" }
+//        }
+//      },
+//      "tests": {
+//        "metrics_FEA_shellANCF_MINRES_full": {
+//          "execution_time": 1.25,
+//          "execution_stddev": 0.02,
+//          "metrics": { "number_iterations": 40, ... },
+//          "tolerances": { "metrics": { "number_iterations": { "abs": 5 } } }
+//        }
+//      }
+//    }
+//
+// The optional "tolerances" of a test ("execution_time" and "metrics") override
+// the global ones for that test. A baseline or result field which is present
+// but not a number is reported as INVALID (and counts as a failure).
+//
+// The allowed band for a quantity is max(rel * |baseline|, abs, sigma * noise),
+// where the noise is the larger of the baseline and current standard deviations
+// of the execution time over repeated runs (see BaseTest::setRepetitions). The
+// "direction" ("lower", "higher", or "both") specifies which deviations count as
+// regressions; by default, execution time regresses only if it increases and
+// metrics regress if they deviate in either direction.
+//
+// =============================================================================
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "chrono_thirdparty/rapidjson/document.h"
+#include "chrono_thirdparty/rapidjson/prettywriter.h"
+#include "chrono_thirdparty/rapidjson/stringbuffer.h"
+
+using namespace rapidjson;
+
+// -----------------------------------------------------------------------------
+
+// Read a numeric member of a JSON object. Return false if the member is absent or not a number.
+bool GetNumber(const Value& obj, const char* key, double& value) {
+    if (!obj.IsObject() || !obj.HasMember(key) || !obj[key].IsNumber())
+        return false;
+    value = obj[key].GetDouble();
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+struct Tolerance {
+    enum Direction { LOWER, HIGHER, BOTH };
+
+    Tolerance() : rel(0.1), abs(0), sigma(3), direction(BOTH) {}
+
+    // Override default values with those present in the given JSON object.
+    void Read(const Value& v) {
+        if (!v.IsObject())
+            return;
+        GetNumber(v, "rel", rel);
+        GetNumber(v, "abs", abs);
+        GetNumber(v, "sigma", sigma);
+        if (v.HasMember("direction") && v["direction"].IsString()) {
+            std::string dir = v["direction"].GetString();
+            if (dir == "lower")
+                direction = LOWER;
+            else if (dir == "higher")
+                direction = HIGHER;
+            else
+                direction = BOTH;
+        }
+    }
+
+    // Allowed band around the baseline value, given the measurement noise.
+    double Band(double baseline, double noise) const {
+        return std::max(std::max(rel * std::abs(baseline), abs), sigma * noise);
+    }
+
+    // Check whether the current value is acceptable relative to the baseline value.
+    bool Check(double baseline, double current, double band) const {
+        switch (direction) {
+            case LOWER:
+                return current <= baseline + band;
+            case HIGHER:
+                return current >= baseline - band;
+            default:
+                return std::abs(current - baseline) <= band;
+        }
+    }
+
+    double rel;           // relative tolerance
+    double abs;           // absolute tolerance
+    double sigma;         // number of standard deviations of measured noise
+    Direction direction;  // which deviations are regressions
+};
+
+// -----------------------------------------------------------------------------
+
+bool ReadJSON(const std::string& filename, Document& d) {
+    std::ifstream ifs(filename);
+    if (!ifs.good())
+        return false;
+    std::stringstream buffer;
+    buffer << ifs.rdbuf();
+    d.Parse(buffer.str().c_str());
+    if (d.HasParseError() || !d.IsObject()) {
+        std::cerr << "Invalid JSON file: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool WriteJSON(const std::string& filename, const Document& d) {
+    std::ofstream ofs(filename);
+    if (!ofs.good())
+        return false;
+    StringBuffer buffer;
+    PrettyWriter<StringBuffer> writer(buffer);
+    d.Accept(writer);
+    ofs << buffer.GetString() << std::endl;
+    return true;
+}
+
+// Standard deviation of the execution time over repeated runs (0 if not available).
+double GetExecutionStddev(const Value& test) {
+    double stddev = 0;
+    if (test.HasMember("execution_stats") && GetNumber(test["execution_stats"], "stddev", stddev))
+        return stddev;
+    GetNumber(test, "execution_stddev", stddev);
+    return stddev;
+}
+
+void PrintRow(const std::string& test,
+              const std::string& quantity,
+              double baseline,
+              double current,
+              double band,
+              bool ok) {
+    printf("%-45s %-35s %12.5g %12.5g %10.3g  %s\n", test.c_str(), quantity.c_str(), baseline, current, band,
+           ok ? "ok" : "REGRESSION");
+}
+
+void PrintStatus(const std::string& test, const std::string& quantity, const char* status) {
+    printf("%-45s %-35s %12s %12s %10s  %s\n", test.c_str(), quantity.c_str(), "-", "-", "-", status);
+}
+
+// -----------------------------------------------------------------------------
+
+int Compare(const std::string& results_dir, const Document& baseline) {
+    Tolerance tol_default;
+    Tolerance tol_exec;
+    tol_exec.direction = Tolerance::LOWER;
+    const Value* tol_metrics = nullptr;
+
+    if (baseline.HasMember("tolerances")) {
+        const Value& tol = baseline["tolerances"];
+        if (tol.HasMember("default"))
+            tol_default.Read(tol["default"]);
+        tol_exec.rel = tol_default.rel;
+        tol_exec.abs = tol_default.abs;
+        tol_exec.sigma = tol_default.sigma;
+        if (tol.HasMember("execution_time"))
+            tol_exec.Read(tol["execution_time"]);
+        if (tol.HasMember("metrics") && tol["metrics"].IsObject())
+            tol_metrics = &tol["metrics"];
+    }
+
+    if (!baseline.HasMember("tests") || !baseline["tests"].IsObject()) {
+        std::cerr << "Baseline has no tests" << std::endl;
+        return 1;
+    }
+
+    printf("%-45s %-35s %12s %12s %10s  %s\n", "TEST", "QUANTITY", "BASELINE", "CURRENT", "BAND", "STATUS");
+
+    int num_failed = 0;
+
+    for (auto t = baseline["tests"].MemberBegin(); t != baseline["tests"].MemberEnd(); ++t) {
+        std::string name = t->name.GetString();
+        const Value& base = t->value;
+        if (!base.IsObject()) {
+            PrintStatus(name, "-", "INVALID");
+            num_failed++;
+            continue;
+        }
+
+        Document result;
+        if (!ReadJSON(results_dir + "/" + name + ".json", result)) {
+            PrintStatus(name, "-", "MISSING");
+            num_failed++;
+            continue;
+        }
+
+        if (result.HasMember("passed") && result["passed"].IsInt() && result["passed"].GetInt() == 0) {
+            PrintStatus(name, "passed", "FAILED");
+            num_failed++;
+        }
+
+        // Per-test tolerances
+        Tolerance test_exec = tol_exec;
+        const Value* test_tol_metrics = nullptr;
+        if (base.HasMember("tolerances") && base["tolerances"].IsObject()) {
+            const Value& tol = base["tolerances"];
+            if (tol.HasMember("execution_time"))
+                test_exec.Read(tol["execution_time"]);
+            if (tol.HasMember("metrics") && tol["metrics"].IsObject())
+                test_tol_metrics = &tol["metrics"];
+        }
+
+        double noise = std::max(GetExecutionStddev(base), GetExecutionStddev(result));
+
+        // Execution time
+        if (base.HasMember("execution_time")) {
+            double b, c;
+            if (!GetNumber(base, "execution_time", b) || !GetNumber(result, "execution_time", c)) {
+                PrintStatus(name, "execution_time", "INVALID");
+                num_failed++;
+            } else {
+                double band = test_exec.Band(b, noise);
+                bool ok = test_exec.Check(b, c, band);
+                PrintRow(name, "execution_time", b, c, band, ok);
+                num_failed += ok ? 0 : 1;
+            }
+        }
+
+        // Named metrics (all metrics in the baseline must be numbers)
+        if (!base.HasMember("metrics"))
+            continue;
+        const Value& base_metrics = base["metrics"];
+        if (!base_metrics.IsObject()) {
+            PrintStatus(name, "metrics", "INVALID");
+            num_failed++;
+            continue;
+        }
+        const Value* result_metrics =
+            (result.HasMember("metrics") && result["metrics"].IsObject()) ? &result["metrics"] : nullptr;
+        for (auto m = base_metrics.MemberBegin(); m != base_metrics.MemberEnd(); ++m) {
+            std::string metric = m->name.GetString();
+            if (!m->value.IsNumber()) {
+                PrintStatus(name, metric, "INVALID");
+                num_failed++;
+                continue;
+            }
+            double c;
+            if (!result_metrics || !result_metrics->HasMember(metric.c_str())) {
+                PrintStatus(name, metric, "MISSING");
+                num_failed++;
+                continue;
+            }
+            if (!GetNumber(*result_metrics, metric.c_str(), c)) {
+                PrintStatus(name, metric, "INVALID");
+                num_failed++;
+                continue;
+            }
+
+            Tolerance tol = tol_default;
+            if (tol_metrics && tol_metrics->HasMember(metric.c_str()))
+                tol.Read((*tol_metrics)[metric.c_str()]);
+            if (test_tol_metrics && test_tol_metrics->HasMember(metric.c_str()))
+                tol.Read((*test_tol_metrics)[metric.c_str()]);
+
+            double b = m->value.GetDouble();
+            double band = tol.Band(b, 0);
+            bool ok = tol.Check(b, c, band);
+            PrintRow(name, metric, b, c, band, ok);
+            num_failed += ok ? 0 : 1;
+        }
+    }
+
+    printf("\n%d regression(s)\n", num_failed);
+    return num_failed > 0 ? 1 : 0;
+}
+
+// -----------------------------------------------------------------------------
+
+int Update(const std::string& results_dir, Document& baseline, const std::vector<std::string>& extra_tests) {
+    auto& alloc = baseline.GetAllocator();
+
+    if (!baseline.IsObject())
+        baseline.SetObject();
+    if (!baseline.HasMember("tests")) {
+        Value tests_obj(kObjectType);
+        baseline.AddMember("tests", tests_obj, alloc);
+    }
+    if (!baseline["tests"].IsObject()) {
+        std::cerr << "Baseline \"tests\" is not an object" << std::endl;
+        return 1;
+    }
+    Value& tests = baseline["tests"];
+
+    std::vector<std::string> names;
+    for (auto t = tests.MemberBegin(); t != tests.MemberEnd(); ++t)
+        names.push_back(t->name.GetString());
+    for (const auto& name : extra_tests) {
+        if (std::find(names.begin(), names.end(), name) == names.end())
+            names.push_back(name);
+    }
+
+    int num_missing = 0;
+
+    for (const auto& name : names) {
+        Document result;
+        if (!ReadJSON(results_dir + "/" + name + ".json", result)) {
+            std::cerr << "Missing results for " << name << std::endl;
+            num_missing++;
+            continue;
+        }
+
+        Value entry(kObjectType);
+        double exec_time;
+        if (GetNumber(result, "execution_time", exec_time))
+            entry.AddMember("execution_time", exec_time, alloc);
+        entry.AddMember("execution_stddev", GetExecutionStddev(result), alloc);
+
+        Value metrics(kObjectType);
+        if (result.HasMember("metrics") && result["metrics"].IsObject()) {
+            for (auto m = result["metrics"].MemberBegin(); m != result["metrics"].MemberEnd(); ++m) {
+                if (!m->value.IsNumber())
+                    continue;
+                metrics.AddMember(Value(m->name.GetString(), alloc).Move(), m->value.GetDouble(), alloc);
+            }
+        }
+        entry.AddMember("metrics", metrics, alloc);
+
+        // Keep the tolerances of the test
+        if (tests.HasMember(name.c_str()) && tests[name.c_str()].IsObject() &&
+            tests[name.c_str()].HasMember("tolerances"))
+            entry.AddMember("tolerances", Value(tests[name.c_str()]["tolerances"], alloc).Move(), alloc);
+
+        if (tests.HasMember(name.c_str()))
+            tests[name.c_str()] = entry;
+        else
+            tests.AddMember(Value(name.c_str(), alloc).Move(), entry, alloc);
+
+        std::cout << "Updated baseline for " << name << std::endl;
+    }
+
+    return num_missing > 0 ? 1 : 0;
+}
+
+// -----------------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+    bool update = (argc > 1 && std::string(argv[1]) == "--update");
+    int first = update ? 2 : 1;
+
+    if (argc < first + 2) {
+        std::cout << "Usage: " << argv[0] << " <results_dir> <baseline_file>" << std::endl;
+        std::cout << "       " << argv[0] << " --update <results_dir> <baseline_file> [test_name ...]" << std::endl;
+        return 1;
+    }
+
+    std::string results_dir = argv[first];
+    std::string baseline_file = argv[first + 1];
+
+    // In update mode, start a new baseline only if there is none (an unreadable baseline would lose its tolerances)
+    Document baseline;
+    if (!ReadJSON(baseline_file, baseline)) {
+        if (!update || std::ifstream(baseline_file).good()) {
+            std::cerr << "Cannot read baseline file " << baseline_file << std::endl;
+            return 1;
+        }
+        baseline.SetObject();
+    }
+
+    if (!update)
+        return Compare(results_dir, baseline);
+
+    std::vector<std::string> extra_tests(argv + first + 2, argv + argc);
+    int ret = Update(results_dir, baseline, extra_tests);
+    if (!WriteJSON(baseline_file, baseline)) {
+        std::cerr << "Cannot write baseline file " << baseline_file << std::endl;
+        return 1;
+    }
+    return ret;
+}
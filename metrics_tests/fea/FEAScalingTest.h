@@ -0,0 +1,207 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Problem-size scaling of FEA metrics tests.
+//
+// An FEA test parameterized by mesh size is run for a series of sizes. For each
+// size, the time per element per step is reported separately for internal force
+// evaluation, Jacobian assembly, and linear solve, together with the exponent
+// of a power-law fit of the time per step versus the number of elements (an
+// exponent of 1 indicates linear scaling).
+//
+// Thread scaling of FEA metrics tests.
+//
+// An FEA test parameterized by the number of threads is run for a series of
+// thread counts. For each count, the time per step and the speedup relative to
+// the first count are reported for each phase and for the entire step.
+//
+// =============================================================================
+
+#ifndef FEA_SCALING_TEST_H
+#define FEA_SCALING_TEST_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../BaseTest.h"
+
+/// Base class for FEA tests which can be run at different mesh sizes.
+/// Derived classes must report the times of the "internal_forces", "jacobian", and "step_solve" phases (accumulated
+/// over all steps) through addPhaseTime().
+class FEASizedTest : public BaseTest {
+  public:
+    FEASizedTest(const std::string& testName, const std::string& testProjectName)
+        : BaseTest(testName, testProjectName) {}
+
+    /// Return the number of elements in the mesh.
+    virtual int getNumElements() const = 0;
+
+    /// Return the number of simulation steps.
+    virtual int getNumSteps() const = 0;
+};
+
+/// Scaling test: runs an FEASizedTest for each of the specified mesh sizes.
+/// Each run writes its own output file (named <test name>_<size>) in the output directory of the scaling test.
+/// The repetitions set on the scaling test apply to each run (the scaling test itself is executed once), so the
+/// reported times are the medians over the measured runs of each size.
+class FEAScalingTest : public BaseTest {
+  public:
+    /// Function creating the test with given name for a given mesh size.
+    typedef std::function<std::unique_ptr<FEASizedTest>(const std::string&, int)> Factory;
+
+    FEAScalingTest(const std::string& testName,
+                   const std::string& testProjectName,
+                   const std::vector<int>& sizes,
+                   Factory factory)
+        : BaseTest(testName, testProjectName),
+          m_sizes(sizes),
+          m_factory(factory),
+          m_execTime(0),
+          m_numWarmup(0),
+          m_numRuns(1) {}
+
+    /// Set the number of warm-up and measured executions of each run.
+    virtual void setRepetitions(int num_warmup, int num_runs) override {
+        m_numWarmup = num_warmup;
+        m_numRuns = num_runs;
+    }
+
+    /// Return the phases for which scaling is reported.
+    static const std::vector<std::string>& GetPhases() {
+        static const std::vector<std::string> phases = {"internal_forces", "jacobian", "step_solve"};
+        return phases;
+    }
+
+    virtual bool execute() override {
+        bool passed = true;
+        m_execTime = 0;
+
+        std::vector<double> num_elements;
+        std::vector<std::vector<double>> step_times(GetPhases().size());
+        for (auto size : m_sizes) {
+            auto test = m_factory(getTestName() + "_" + std::to_string(size), size);
+            test->setOutDir(getOutDir());
+            test->setRepetitions(m_numWarmup, m_numRuns);
+            passed &= test->run();
+            m_execTime += test->getExecutionTime();
+
+            num_elements.push_back(test->getNumElements());
+            for (size_t i = 0; i < GetPhases().size(); i++)
+                step_times[i].push_back(test->getPhaseTime(GetPhases()[i]) / test->getNumSteps());
+        }
+
+        addMetric("num_elements", num_elements);
+        for (size_t i = 0; i < GetPhases().size(); i++) {
+            std::vector<double> element_times;
+            for (size_t j = 0; j < num_elements.size(); j++)
+                element_times.push_back(step_times[i][j] / num_elements[j]);
+            addMetric(GetPhases()[i] + "_time_per_element_step", element_times);
+            addMetric(GetPhases()[i] + "_exponent", PowerLawFit(num_elements, step_times[i]).exponent);
+        }
+
+        return passed;
+    }
+
+    virtual double getExecutionTime() const override { return m_execTime; }
+
+  private:
+    std::vector<int> m_sizes;
+    Factory m_factory;
+    double m_execTime;
+    int m_numWarmup;  // warm-up executions of each run
+    int m_numRuns;    // measured executions of each run
+};
+
+/// Thread scaling test: runs a test for each of the specified numbers of threads.
+/// The test must report the times of the phases returned by GetPhases() (accumulated over all steps) through
+/// addPhaseTime(). Each run writes its own output file (named <test name>_<threads>t).
+/// As for FEAScalingTest, the repetitions set on the scaling test apply to each run.
+class FEAThreadScalingTest : public BaseTest {
+  public:
+    /// Function creating the test with given name for a given number of threads.
+    typedef std::function<std::unique_ptr<FEASizedTest>(const std::string&, int)> Factory;
+
+    FEAThreadScalingTest(const std::string& testName,
+                         const std::string& testProjectName,
+                         const std::vector<int>& num_threads,
+                         Factory factory)
+        : BaseTest(testName, testProjectName),
+          m_num_threads(num_threads),
+          m_factory(factory),
+          m_execTime(0),
+          m_numWarmup(0),
+          m_numRuns(1) {}
+
+    /// Set the number of warm-up and measured executions of each run.
+    virtual void setRepetitions(int num_warmup, int num_runs) override {
+        m_numWarmup = num_warmup;
+        m_numRuns = num_runs;
+    }
+
+    /// Return the phases for which thread scaling is reported.
+    static const std::vector<std::string>& GetPhases() {
+        static const std::vector<std::string> phases = {"internal_forces", "jacobian", "assembly", "step_solve"};
+        return phases;
+    }
+
+    virtual bool execute() override {
+        bool passed = true;
+        m_execTime = 0;
+
+        std::vector<double> threads;
+        std::vector<double> total_times;
+        std::vector<std::vector<double>> step_times(GetPhases().size());
+        for (auto n : m_num_threads) {
+            auto test = m_factory(getTestName() + "_" + std::to_string(n) + "t", n);
+            test->setOutDir(getOutDir());
+            test->setRepetitions(m_numWarmup, m_numRuns);
+            passed &= test->run();
+            m_execTime += test->getExecutionTime();
+
+            threads.push_back(n);
+            total_times.push_back(test->getExecutionTime() / test->getNumSteps());
+            for (size_t i = 0; i < GetPhases().size(); i++)
+                step_times[i].push_back(test->getPhaseTime(GetPhases()[i]) / test->getNumSteps());
+        }
+
+        addMetric("num_threads", threads);
+        addMetric("time_per_step", total_times);
+        addMetric("speedup", Speedup(total_times));
+        for (size_t i = 0; i < GetPhases().size(); i++) {
+            addMetric(GetPhases()[i] + "_time_per_step", step_times[i]);
+            addMetric(GetPhases()[i] + "_speedup", Speedup(step_times[i]));
+        }
+
+        return passed;
+    }
+
+    virtual double getExecutionTime() const override { return m_execTime; }
+
+  private:
+    // Speedup of each entry relative to the first one (0 if not timed).
+    static std::vector<double> Speedup(const std::vector<double>& times) {
+        std::vector<double> speedup;
+        for (auto t : times)
+            speedup.push_back(t > 0 ? times[0] / t : 0);
+        return speedup;
+    }
+
+    std::vector<int> m_num_threads;
+    Factory m_factory;
+    double m_execTime;
+    int m_numWarmup;  // warm-up executions of each run
+    int m_numRuns;    // measured executions of each run
+};
+
+#endif
@@ -0,0 +1,225 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// System descriptor with parallel assembly of the element stiffness blocks.
+//
+// The default descriptor pastes the KRM blocks of all FEA elements one after
+// the other into the system matrix. Here, the first assembly inserts the
+// structure of all blocks into the matrix (as explicit zeros) and records, for
+// each nonzero of the matrix, the block entries which contribute to it. Later
+// assemblies (as long as the sparsity pattern of the matrix and the variable
+// offsets of the blocks are unchanged, e.g. with a solver which locks the
+// pattern) distribute the nonzeros over the OpenMP threads, and each thread
+// sums the contributions to its nonzeros in place, after the variable masses
+// and the constraint Jacobians are assembled (serially). No entry is inserted
+// and no block is copied.
+//
+// The contributions to a nonzero are summed in a fixed order, so the result is
+// deterministic (and independent of the number of threads); it differs from
+// the serial assembly only by round-off.
+//
+// =============================================================================
+
+#ifndef PARALLEL_ASSEMBLY_H
+#define PARALLEL_ASSEMBLY_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "chrono/core/ChTimer.h"
+#include "chrono/parallel/ChOpenMP.h"
+#include "chrono/solver/ChKblockGeneric.h"
+#include "chrono/solver/ChSystemDescriptor.h"
+
+class ChSystemDescriptorParallel : public chrono::ChSystemDescriptor {
+  public:
+    ChSystemDescriptorParallel(bool parallel = true) : m_parallel(parallel) {}
+
+    /// Enable/disable the parallel assembly of the stiffness blocks (if disabled, use the default assembly).
+    void SetParallelAssembly(bool parallel) { m_parallel = parallel; }
+
+    /// Reset the assembly timer.
+    void ResetTimers() { m_timer.reset(); }
+
+    /// Return the time (in seconds) spent in assembling the system matrix since the last call to ResetTimers().
+    double GetTimeAssembly() const { return m_timer.GetTimeSeconds(); }
+
+    virtual void ConvertToMatrixForm(chrono::ChSparseMatrix* Z, chrono::ChVectorDynamic<>* rhs) override {
+        m_timer.start();
+
+        if (!Z || !m_parallel) {
+            chrono::ChSystemDescriptor::ConvertToMatrixForm(Z, rhs);
+            m_timer.stop();
+            return;
+        }
+
+        // Assemble masses, constraints, and right-hand side with the stiffness blocks detached
+        std::vector<chrono::ChKblock*> kblocks = GetKblocksList();
+        GetKblocksList().clear();
+        chrono::ChSystemDescriptor::ConvertToMatrixForm(Z, rhs);
+        GetKblocksList() = kblocks;
+
+        // Record the pattern at the first assembly (or if the matrix or the blocks changed)
+        if (!PatternValid(*Z, kblocks))
+            BuildPattern(*Z, kblocks);
+
+        // Sum the block entries contributing to each nonzero, in place
+        double* values = Z->valuePtr();
+        int num_targets = (int)m_targets.size();
+#pragma omp parallel for schedule(static)
+        for (int it = 0; it < num_targets; it++) {
+            double sum = 0;
+            for (int is = m_start[it]; is < m_start[it + 1]; is++) {
+                const Source& src = m_sources[is];
+                const auto& K = m_blocks[src.block]->Get_K();
+                sum += K(src.row, src.col);
+            }
+            values[m_targets[it]] += sum;
+        }
+
+        // Blocks of other types are pasted directly
+        for (auto kblock : kblocks) {
+            if (!dynamic_cast<chrono::ChKblockGeneric*>(kblock))
+                kblock->Build_K(*Z, true);
+        }
+
+        m_timer.stop();
+    }
+
+  private:
+    // Entry of an element stiffness block
+    struct Source {
+        int block;
+        int row;
+        int col;
+    };
+
+    // Return the offsets of the variables of the generic blocks (-1 for inactive variables), in block order.
+    static std::vector<int> VariableOffsets(const std::vector<chrono::ChKblock*>& kblocks) {
+        std::vector<int> offsets;
+        for (auto kblock : kblocks) {
+            auto generic = dynamic_cast<chrono::ChKblockGeneric*>(kblock);
+            if (!generic)
+                continue;
+            for (unsigned int iv = 0; iv < generic->GetNvars(); iv++) {
+                auto var = generic->GetVariableN(iv);
+                offsets.push_back(var->IsActive() ? var->GetOffset() : -1);
+            }
+        }
+        return offsets;
+    }
+
+    // Check whether the recorded pattern applies to the given matrix and blocks.
+    bool PatternValid(const chrono::ChSparseMatrix& Z, const std::vector<chrono::ChKblock*>& kblocks) const {
+        return !m_start.empty() && Z.isCompressed() && Z.rows() == m_rows && Z.nonZeros() == m_nnz &&
+               Z.outerIndexPtr() == m_outer && Z.innerIndexPtr() == m_inner && VariableOffsets(kblocks) == m_offsets;
+    }
+
+    // Insert the structure of the generic blocks into the matrix (as explicit zeros) and record the contributions of
+    // the block entries to the nonzeros of the matrix.
+    void BuildPattern(chrono::ChSparseMatrix& Z, const std::vector<chrono::ChKblock*>& kblocks) {
+        m_blocks.clear();
+        for (auto kblock : kblocks) {
+            auto generic = dynamic_cast<chrono::ChKblockGeneric*>(kblock);
+            if (generic)
+                m_blocks.push_back(generic);
+        }
+
+        // Block entries (for active variables only) with their row and column in the matrix
+        std::vector<Source> sources;
+        std::vector<Eigen::Triplet<double, int>> triplets;
+        for (int ib = 0; ib < (int)m_blocks.size(); ib++) {
+            auto kblock = m_blocks[ib];
+            int kio = 0;
+            for (unsigned int iv = 0; iv < kblock->GetNvars(); iv++) {
+                auto ivar = kblock->GetVariableN(iv);
+                int in = ivar->Get_ndof();
+                if (ivar->IsActive()) {
+                    int io = ivar->GetOffset();
+                    int kjo = 0;
+                    for (unsigned int jv = 0; jv < kblock->GetNvars(); jv++) {
+                        auto jvar = kblock->GetVariableN(jv);
+                        int jn = jvar->Get_ndof();
+                        if (jvar->IsActive()) {
+                            int jo = jvar->GetOffset();
+                            for (int r = 0; r < in; r++) {
+                                for (int c = 0; c < jn; c++) {
+                                    sources.push_back({ib, kio + r, kjo + c});
+                                    triplets.emplace_back(io + r, jo + c, 0.0);
+                                }
+                            }
+                        }
+                        kjo += jn;
+                    }
+                }
+                kio += in;
+            }
+        }
+
+        // Add the missing nonzeros (the union of the patterns keeps the explicit zeros)
+        chrono::ChSparseMatrix K(Z.rows(), Z.cols());
+        K.setFromTriplets(triplets.begin(), triplets.end());
+        Z += K;
+        Z.makeCompressed();
+
+        // Index of each block entry in the nonzeros of the matrix
+        std::vector<std::pair<int, int>> entries(sources.size());  // (nonzero index, source index)
+        const int* outer = Z.outerIndexPtr();
+        const int* inner = Z.innerIndexPtr();
+        bool row_major = chrono::ChSparseMatrix::IsRowMajor;
+        for (size_t i = 0; i < sources.size(); i++) {
+            int o = row_major ? triplets[i].row() : triplets[i].col();
+            int n = row_major ? triplets[i].col() : triplets[i].row();
+            const int* pos = std::lower_bound(inner + outer[o], inner + outer[o + 1], n);
+            entries[i] = std::make_pair((int)(pos - inner), (int)i);
+        }
+        std::stable_sort(entries.begin(), entries.end(),
+                         [](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a.first < b.first; });
+
+        // Contributions grouped by nonzero
+        m_targets.clear();
+        m_start.clear();
+        m_sources.clear();
+        m_sources.reserve(entries.size());
+        for (const auto& entry : entries) {
+            if (m_targets.empty() || m_targets.back() != entry.first) {
+                m_targets.push_back(entry.first);
+                m_start.push_back((int)m_sources.size());
+            }
+            m_sources.push_back(sources[entry.second]);
+        }
+        m_start.push_back((int)m_sources.size());
+
+        m_rows = Z.rows();
+        m_nnz = Z.nonZeros();
+        m_outer = Z.outerIndexPtr();
+        m_inner = Z.innerIndexPtr();
+        m_offsets = VariableOffsets(kblocks);
+    }
+
+    bool m_parallel;
+    chrono::ChTimer<double> m_timer;
+
+    // Recorded pattern
+    std::vector<chrono::ChKblockGeneric*> m_blocks;  ///< generic stiffness blocks
+    std::vector<int> m_targets;                      ///< nonzero index (in the matrix values) of each target
+    std::vector<int> m_start;                        ///< first contribution of each target (plus end)
+    std::vector<Source> m_sources;                   ///< contributions, grouped by target
+    std::vector<int> m_offsets;                      ///< variable offsets of the blocks
+    Eigen::Index m_rows = 0;                         ///< dimensions of the matrix
+    Eigen::Index m_nnz = 0;                          ///< number of nonzeros of the matrix
+    const int* m_outer = nullptr;                    ///< outer index array of the matrix
+    const int* m_inner = nullptr;                    ///< inner index array of the matrix
+};
+
+#endif
@@ -22,7 +22,9 @@
 // =============================================================================
 #include <cstdio>
 #include <cmath>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "chrono/core/ChMathematics.h"
 #include "chrono/core/ChVector.h"
@@ -40,18 +42,21 @@
 
 #include "chrono_thirdparty/filesystem/path.h"
 
-#include "../BaseTest.h"
+#include "../TestRegistry.h"
+#include "FEAScalingTest.h"
 
 using namespace chrono;
 using namespace chrono::fea;
 
+namespace {
+
 // ====================================================================================
 
 // Test class
-class ANCFBeamTest : public BaseTest {
+class ANCFBeamTest : public FEASizedTest {
   public:
-    ANCFBeamTest(const std::string& testName, const std::string& testProjectName)
-        : BaseTest(testName, testProjectName), m_execTime(0) {}
+    ANCFBeamTest(const std::string& testName, const std::string& testProjectName, int num_elements = 4)
+        : FEASizedTest(testName, testProjectName), m_num_elements(num_elements), m_execTime(0) {}
 
     ~ANCFBeamTest() {}
 
@@ -59,14 +64,19 @@ class ANCFBeamTest : public BaseTest {
     virtual bool execute() override;
     virtual double getExecutionTime() const override { return m_execTime; }
 
+    // Override corresponding functions in FEASizedTest
+    virtual int getNumElements() const override { return m_num_elements; }
+    virtual int getNumSteps() const override { return m_num_steps; }
+
   private:
+    int m_num_elements;
     double m_execTime;
+    static const int m_num_steps = 5000;
 };
 
 bool ANCFBeamTest::execute() {
     // Create a Chrono::Engine physical system
     ChSystemNSC my_system;
-    unsigned int num_steps = 5000;
 
     // Create a mesh, that is a container for groups of elements and
     // their referenced nodes.
@@ -76,7 +86,7 @@ bool ANCFBeamTest::execute() {
     double diam = 0.0;
     const double Ang_VelY = 4.0;
     const double beam_length = 1.0;
-    unsigned int NElem = 4;
+    int NElem = m_num_elements;
     double rho = 0.0;
 
     auto msection_cable = chrono_types::make_shared<ChBeamSectionCable>();
@@ -89,47 +99,29 @@ bool ANCFBeamTest::execute() {
     msection_cable->SetDensity(rho);
 
     // Create the nodes
-    auto hnodeancf1 = chrono_types::make_shared<ChNodeFEAxyzD>(ChVector<>(0, 0, 0.0), ChVector<>(1, 0, 0));
-    auto hnodeancf2 = chrono_types::make_shared<ChNodeFEAxyzD>(ChVector<>(beam_length / 4, 0, 0), ChVector<>(1, 0, 0));
-    auto hnodeancf3 = chrono_types::make_shared<ChNodeFEAxyzD>(ChVector<>(beam_length / 2, 0, 0), ChVector<>(1, 0, 0));
-    auto hnodeancf4 = chrono_types::make_shared<ChNodeFEAxyzD>(ChVector<>(3.0 * beam_length / 4, 0, 0), ChVector<>(1, 0, 0));
-    auto hnodeancf5 = chrono_types::make_shared<ChNodeFEAxyzD>(ChVector<>(beam_length, 0, 0), ChVector<>(1, 0, 0));
-
-    my_mesh->AddNode(hnodeancf1);
-    my_mesh->AddNode(hnodeancf2);
-    my_mesh->AddNode(hnodeancf3);
-    my_mesh->AddNode(hnodeancf4);
-    my_mesh->AddNode(hnodeancf5);
-
-    // Create the element 1
-    auto belementancf1 = chrono_types::make_shared<ChElementCableANCF>();
-    belementancf1->SetNodes(hnodeancf1, hnodeancf2);
-    belementancf1->SetSection(msection_cable);
-    my_mesh->AddElement(belementancf1);
-
-    // Create the element 2
-    auto belementancf2 = chrono_types::make_shared<ChElementCableANCF>();
-    belementancf2->SetNodes(hnodeancf2, hnodeancf3);
-    belementancf2->SetSection(msection_cable);
-    my_mesh->AddElement(belementancf2);
-
-    // Create the element 3
-    auto belementancf3 = chrono_types::make_shared<ChElementCableANCF>();
-    belementancf3->SetNodes(hnodeancf3, hnodeancf4);
-    belementancf3->SetSection(msection_cable);
-    my_mesh->AddElement(belementancf3);
-
-    // Create the element 4
-    auto belementancf4 = chrono_types::make_shared<ChElementCableANCF>();
-    belementancf4->SetNodes(hnodeancf4, hnodeancf5);
-    belementancf4->SetSection(msection_cable);
-    my_mesh->AddElement(belementancf4);
+    std::vector<std::shared_ptr<ChNodeFEAxyzD>> nodes;
+    for (int i = 0; i <= NElem; i++) {
+        auto node = chrono_types::make_shared<ChNodeFEAxyzD>(ChVector<>(i * beam_length / NElem, 0, 0.0),
+                                                             ChVector<>(1, 0, 0));
+        my_mesh->AddNode(node);
+        nodes.push_back(node);
+    }
+
+    // Create the elements
+    std::vector<std::shared_ptr<ChElementCableANCF>> elements;
+    for (int i = 0; i < NElem; i++) {
+        auto belementancf = chrono_types::make_shared<ChElementCableANCF>();
+        belementancf->SetNodes(nodes[i], nodes[i + 1]);
+        belementancf->SetSection(msection_cable);
+        my_mesh->AddElement(belementancf);
+        elements.push_back(belementancf);
+    }
 
     auto mtruss = chrono_types::make_shared<ChBody>();
     mtruss->SetBodyFixed(true);
 
     auto constraint_hinge = chrono_types::make_shared<ChLinkPointFrame>();
-    constraint_hinge->Initialize(hnodeancf1, mtruss);
+    constraint_hinge->Initialize(nodes[0], mtruss);
     my_system.Add(constraint_hinge);
 
     // Cancel automatic gravity
@@ -140,11 +132,8 @@ bool ANCFBeamTest::execute() {
 
     // Add external forces and initial conditions
     // Angular velocity initial condition
-    hnodeancf1->SetPos_dt(ChVector<>(0, 0, -Ang_VelY * beam_length / NElem * 0.0));
-    hnodeancf2->SetPos_dt(ChVector<>(0, 0, -Ang_VelY * beam_length / NElem * 1.0));
-    hnodeancf3->SetPos_dt(ChVector<>(0, 0, -Ang_VelY * beam_length / NElem * 2.0));
-    hnodeancf4->SetPos_dt(ChVector<>(0, 0, -Ang_VelY * beam_length / NElem * 3.0));
-    hnodeancf5->SetPos_dt(ChVector<>(0, 0, -Ang_VelY * beam_length / NElem * 4.0));
+    for (int i = 0; i <= NElem; i++)
+        nodes[i]->SetPos_dt(ChVector<>(0, 0, -Ang_VelY * beam_length / NElem * i));
 
     // First: loads must be added to "load containers",
     // and load containers must be added to your ChSystem
@@ -152,22 +141,11 @@ bool ANCFBeamTest::execute() {
     my_system.Add(mloadcontainer);
 
     // Add gravity (constant volumetric load): Use 2 Gauss integration points
-
-    auto mgravity1 = chrono_types::make_shared<ChLoad<ChLoaderGravity>>(belementancf1);
-    mgravity1->loader.SetNumIntPoints(2);
-    mloadcontainer->Add(mgravity1);
-
-    auto mgravity2 = chrono_types::make_shared<ChLoad<ChLoaderGravity>>(belementancf2);
-    mgravity2->loader.SetNumIntPoints(2);
-    mloadcontainer->Add(mgravity2);
-
-    auto mgravity3 = chrono_types::make_shared<ChLoad<ChLoaderGravity>>(belementancf3);
-    mgravity3->loader.SetNumIntPoints(2);
-    mloadcontainer->Add(mgravity3);
-
-    auto mgravity4 = chrono_types::make_shared<ChLoad<ChLoaderGravity>>(belementancf4);
-    mgravity4->loader.SetNumIntPoints(2);
-    mloadcontainer->Add(mgravity4);
+    for (auto& element : elements) {
+        auto mgravity = chrono_types::make_shared<ChLoad<ChLoaderGravity>>(element);
+        mgravity->loader.SetNumIntPoints(2);
+        mloadcontainer->Add(mgravity);
+    }
 
     // Change solver settings
     auto solver = chrono_types::make_shared<ChSolverMINRES>();
@@ -191,33 +169,75 @@ bool ANCFBeamTest::execute() {
 
     ChTimer<> timer;
     ChVector<> displ;
-    for (unsigned int it = 0; it < num_steps; it++) {
+    double time_force = 0;
+    double time_jacobian = 0;
+    double time_solve = 0;
+    for (int it = 0; it < m_num_steps; it++) {
+        my_mesh->ResetTimers();
         timer.start();
         my_system.DoStepDynamics(0.0001);
-        displ = hnodeancf5->GetPos() - ChVector<>(beam_length, 0, 0);
+        displ = nodes.back()->GetPos() - ChVector<>(beam_length, 0, 0);
         ////std::cout << "t = " << my_system.GetChTime();
         ////std::cout << " [" << displ.x() << "," << displ.y() << "," << displ.z() << "]" << std::endl;
         timer.stop();
+        time_force += my_mesh->GetTimeInternalForces();
+        time_jacobian += my_mesh->GetTimeJacobianLoad();
+        time_solve += my_system.GetTimerLSsolve();
     }
 
     m_execTime = timer.GetTimeSeconds();
+    addMetric("num_elements", NElem);
     addMetric("tip_displ_x", displ.x());
     addMetric("tip_displ_y", displ.y());
     addMetric("tip_displ_z", displ.z());
-    addMetric("avg_time_per_step (ms)", 1000 * m_execTime / num_steps);
+    addMetric("avg_time_per_step (ms)", 1000 * m_execTime / m_num_steps);
+
+    addPhaseTime("internal_forces", time_force);
+    addPhaseTime("jacobian", time_jacobian);
+    addPhaseTime("step_solve", time_solve);
 
     return true;
 }
 
+// Tests run by this program (or by metrics_runner)
+TestRegistrar reg_beam("metrics_FEA_ANCFBeam", "Chrono::FEA", TestRegistry::MakeFactory<ANCFBeamTest>());
+
+// Scaling with the number of beam elements (4, 8, ..., 128)
+std::unique_ptr<BaseTest> CreateScalingTest(const std::string& name, const std::string& project) {
+    std::vector<int> sizes = {4, 8, 16, 32, 64, 128};
+    auto factory = [project](const std::string& test_name, int size) {
+        return std::unique_ptr<FEASizedTest>(new ANCFBeamTest(test_name, project, size));
+    };
+    return std::unique_ptr<BaseTest>(new FEAScalingTest(name, project, sizes, factory));
+}
+
+TestRegistrar reg_beam_scaling("metrics_FEA_ANCFBeam_scaling", "Chrono::FEA", CreateScalingTest);
+
+}  // end anonymous namespace
+
+#ifndef METRICS_RUNNER
+
 // ====================================================================================
 
 int main(int argc, char* argv[]) {
+    // Usage: metrics_FEA_ANCFBeam [--scaling]
+    // With --scaling, run the test for a series of mesh sizes.
+    bool scaling = (argc > 1 && std::string(argv[1]) == "--scaling");
+
     std::string out_dir = "../METRICS";
     if (!filesystem::create_directory(filesystem::path(out_dir))) {
         std::cout << "Error creating directory " << out_dir << std::endl;
         return 1;
     }
 
+    if (scaling) {
+        auto test = CreateScalingTest("metrics_FEA_ANCFBeam_scaling", "Chrono::FEA");
+        test->setOutDir(out_dir);
+        bool passed = test->run();
+        test->print();
+        return !passed;
+    }
+
     ANCFBeamTest test("metrics_FEA_ANCFBeam", "Chrono::FEA");
     test.setOutDir(out_dir);
     test.setVerbose(true);
@@ -226,3 +246,5 @@ int main(int argc, char* argv[]) {
 
     return 0;
 }
+
+#endif
@@ -26,7 +26,9 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "chrono/physics/ChSystemNSC.h"
 #include "chrono/solver/ChIterativeSolverLS.h"
@@ -38,11 +40,15 @@
 
 #include "chrono_thirdparty/filesystem/path.h"
 
-#include "../BaseTest.h"
+#include "../TestRegistry.h"
+#include "FEAScalingTest.h"
+#include "ParallelAssembly.h"
 
 using namespace chrono;
 using namespace chrono::fea;
 
+namespace {
+
 // ====================================================================================
 
 double step_size = 1e-3;  // Integration step size
@@ -51,10 +57,18 @@ int num_steps = 500;      // Number of steps used in testing
 // ====================================================================================
 
 // Test class
-class BrickIsoTest : public BaseTest {
+class BrickIsoTest : public FEASizedTest {
   public:
-    BrickIsoTest(const std::string& testName, const std::string& testProjectName)
-        : BaseTest(testName, testProjectName), m_execTime(0) {}
+    BrickIsoTest(const std::string& testName,
+                 const std::string& testProjectName,
+                 int num_div = 4,
+                 int num_threads = 1,
+                 bool parallel_assembly = false)
+        : FEASizedTest(testName, testProjectName),
+          m_num_div(num_div),
+          m_num_threads(num_threads),
+          m_parallel_assembly(parallel_assembly),
+          m_execTime(0) {}
 
     ~BrickIsoTest() {}
 
@@ -62,7 +76,14 @@ class BrickIsoTest : public BaseTest {
     virtual bool execute() override;
     virtual double getExecutionTime() const override { return m_execTime; }
 
+    // Override corresponding functions in FEASizedTest
+    virtual int getNumElements() const override { return m_num_div * m_num_div; }
+    virtual int getNumSteps() const override { return num_steps; }
+
   private:
+    int m_num_div;             // number of mesh divisions in X and Y directions
+    int m_num_threads;         // number of OpenMP threads
+    bool m_parallel_assembly;  // assemble element stiffness blocks in parallel
     double m_execTime;
     static const double m_TF;
 
@@ -78,6 +99,15 @@ const double BrickIsoTest::m_TF = 10;
 bool BrickIsoTest::execute() {
     // Create the physical system
     ChSystemNSC my_system;
+    my_system.SetNumThreads(m_num_threads);
+
+    // System descriptor with parallel assembly of the element stiffness blocks, if enabled (otherwise, keep the
+    // default descriptor; the assembly time is then not reported)
+    std::shared_ptr<ChSystemDescriptorParallel> descriptor;
+    if (m_parallel_assembly) {
+        descriptor = chrono_types::make_shared<ChSystemDescriptorParallel>();
+        my_system.SetSystemDescriptor(descriptor);
+    }
 
     // Create a mesh, a container for groups of elements and their referenced nodes.
     auto my_mesh = chrono_types::make_shared<ChMesh>();
@@ -87,8 +117,8 @@ bool BrickIsoTest::execute() {
     double plate_lenght_y = 1;
     double plate_lenght_z = 0.01;  // small thickness
     // Specification of the mesh
-    int numDiv_x = 4;
-    int numDiv_y = 4;
+    int numDiv_x = m_num_div;
+    int numDiv_y = m_num_div;
     int numDiv_z = 1;
     int N_x = numDiv_x + 1;
     int N_y = numDiv_y + 1;
@@ -244,15 +274,27 @@ bool BrickIsoTest::execute() {
     // Simulate for the specified number of steps, while accumulating number of iterations.
     ChTimer<> timer;
     int num_iterations = 0;
+    double time_force = 0;
+    double time_jacobian = 0;
+    double time_assembly = 0;
+    double time_solve = 0;
 
     for (int is = 0; is < num_steps; is++) {
         nodetip->SetForce(GetTipForce(my_system.GetChTime()));
 
+        my_mesh->ResetTimers();
+        if (descriptor)
+            descriptor->ResetTimers();
         timer.start();
         my_system.DoStepDynamics(step_size);
         timer.stop();
 
         num_iterations += mystepper->GetNumIterations();
+        time_force += my_mesh->GetTimeInternalForces();
+        time_jacobian += my_mesh->GetTimeJacobianLoad();
+        if (descriptor)
+            time_assembly += descriptor->GetTimeAssembly();
+        time_solve += my_system.GetTimerLSsolve();
         std::cout << "time = " << my_system.GetChTime() << "\t" << nodetip->GetPos().z() << std::endl;
     }
 
@@ -263,19 +305,98 @@ bool BrickIsoTest::execute() {
     addMetric("tip_y_position (mm)", 1000 * nodetip->GetPos().z());
     addMetric("avg_num_iterations", (double)num_iterations / num_steps);
     addMetric("avg_time_per_step (ms)", 1000 * m_execTime / num_steps);
+    addMetric("num_elements", TotalNumElements);
+    addMetric("num_threads", m_num_threads);
+
+    addPhaseTime("internal_forces", time_force);
+    addPhaseTime("jacobian", time_jacobian);
+    if (descriptor)
+        addPhaseTime("assembly", time_assembly);
+    addPhaseTime("step_solve", time_solve);
 
     return true;
 }
 
+// Tests run by this program (or by metrics_runner)
+TestRegistrar reg_brick("metrics_FEA_EASBrickIso", "Chrono::FEA", TestRegistry::MakeFactory<BrickIsoTest>());
+
+// Scaling with the number of brick elements (4x4, 6x6, ..., 23x23 meshes)
+std::unique_ptr<BaseTest> CreateScalingTest(const std::string& name, const std::string& project) {
+    std::vector<int> sizes = {4, 6, 8, 11, 16, 23};
+    auto factory = [project](const std::string& test_name, int size) {
+        return std::unique_ptr<FEASizedTest>(new BrickIsoTest(test_name, project, size));
+    };
+    return std::unique_ptr<BaseTest>(new FEAScalingTest(name, project, sizes, factory));
+}
+
+TestRegistrar reg_brick_scaling("metrics_FEA_EASBrickIso_scaling", "Chrono::FEA", CreateScalingTest);
+
+// Scaling with the number of threads (1, 2, 4, ... up to the number of processors) on a 23x23 mesh, with the default
+// assembly or with parallel assembly of the element stiffness blocks
+std::unique_ptr<BaseTest> CreateThreadScalingTest(const std::string& name,
+                                                  const std::string& project,
+                                                  bool parallel_assembly) {
+    std::vector<int> num_threads;
+    for (int n = 1; n < ChOMP::GetNumProcs(); n *= 2)
+        num_threads.push_back(n);
+    num_threads.push_back(ChOMP::GetNumProcs());
+    auto factory = [project, parallel_assembly](const std::string& test_name, int threads) {
+        return std::unique_ptr<FEASizedTest>(new BrickIsoTest(test_name, project, 23, threads, parallel_assembly));
+    };
+    return std::unique_ptr<BaseTest>(new FEAThreadScalingTest(name, project, num_threads, factory));
+}
+
+TestRegistrar reg_brick_threads("metrics_FEA_EASBrickIso_threads",
+                                "Chrono::FEA",
+                                [](const std::string& name, const std::string& project) {
+                                    return CreateThreadScalingTest(name, project, false);
+                                });
+TestRegistrar reg_brick_threads_parallel("metrics_FEA_EASBrickIso_threads_parallel",
+                                         "Chrono::FEA",
+                                         [](const std::string& name, const std::string& project) {
+                                             return CreateThreadScalingTest(name, project, true);
+                                         });
+
+}  // end anonymous namespace
+
+#ifndef METRICS_RUNNER
+
 // ====================================================================================
 
 int main(int argc, char* argv[]) {
+    // Usage: metrics_FEA_EASBrickIso [--scaling | --threads]
+    // With --scaling, run the test for a series of mesh sizes.
+    // With --threads, run the test for a series of thread counts, with the default and with parallel assembly.
+    bool scaling = (argc > 1 && std::string(argv[1]) == "--scaling");
+    bool threads = (argc > 1 && std::string(argv[1]) == "--threads");
+
     std::string out_dir = "../METRICS";
     if (!filesystem::create_directory(filesystem::path(out_dir))) {
         std::cout << "Error creating directory " << out_dir << std::endl;
         return 1;
     }
 
+    if (scaling) {
+        auto test = CreateScalingTest("metrics_FEA_EASBrickIso_scaling", "Chrono::FEA");
+        test->setOutDir(out_dir);
+        bool passed = test->run();
+        test->print();
+        return !passed;
+    }
+
+    if (threads) {
+        bool passed = true;
+        for (bool parallel_assembly : {false, true}) {
+            auto test = CreateThreadScalingTest(
+                parallel_assembly ? "metrics_FEA_EASBrickIso_threads_parallel" : "metrics_FEA_EASBrickIso_threads",
+                "Chrono::FEA", parallel_assembly);
+            test->setOutDir(out_dir);
+            passed &= test->run();
+            test->print();
+        }
+        return !passed;
+    }
+
     BrickIsoTest test("metrics_FEA_EASBrickIso", "Chrono::FEA");
     test.setOutDir(out_dir);
     test.setVerbose(true);
@@ -284,3 +405,5 @@ int main(int argc, char* argv[]) {
 
     return 0;
 }
+
+#endif
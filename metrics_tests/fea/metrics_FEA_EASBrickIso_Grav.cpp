@@ -38,7 +38,8 @@
 
 #include "chrono_thirdparty/filesystem/path.h"
 
-#include "../BaseTest.h"
+#include "../TestRegistry.h"
+#include "ParallelAssembly.h"
 
 #undef CHRONO_PARDISO_MKL
 
@@ -49,6 +50,8 @@
 using namespace chrono;
 using namespace fea;
 
+namespace {
+
 bool use_mkl = true;            // Use the PardisoMKL solver (if available)
 const double step_size = 1e-3;  // Step size
 const int num_steps = 500;      // Number of time steps for test
@@ -58,8 +61,14 @@ const int num_steps = 500;      // Number of time steps for test
 // Test class
 class BrickIso_GravTest : public BaseTest {
   public:
-    BrickIso_GravTest(const std::string& testName, const std::string& testProjectName)
-        : BaseTest(testName, testProjectName), m_execTime(0) {}
+    BrickIso_GravTest(const std::string& testName,
+                      const std::string& testProjectName,
+                      int num_threads = 1,
+                      bool parallel_assembly = false)
+        : BaseTest(testName, testProjectName),
+          m_num_threads(num_threads),
+          m_parallel_assembly(parallel_assembly),
+          m_execTime(0) {}
 
     ~BrickIso_GravTest() {}
 
@@ -68,6 +77,8 @@ class BrickIso_GravTest : public BaseTest {
     virtual double getExecutionTime() const override { return m_execTime; }
 
   private:
+    int m_num_threads;         // number of OpenMP threads
+    bool m_parallel_assembly;  // assemble element stiffness blocks in parallel
     double m_execTime;
 };
 
@@ -75,6 +86,15 @@ bool BrickIso_GravTest::execute() {
     // Create the physical system
     ChSystemNSC my_system;
     my_system.Set_G_acc(ChVector<>(0, 0, -9.81));
+    my_system.SetNumThreads(m_num_threads);
+
+    // System descriptor with parallel assembly of the element stiffness blocks, if enabled (otherwise, keep the
+    // default descriptor; the assembly time is then not reported)
+    std::shared_ptr<ChSystemDescriptorParallel> descriptor;
+    if (m_parallel_assembly) {
+        descriptor = chrono_types::make_shared<ChSystemDescriptorParallel>();
+        my_system.SetSystemDescriptor(descriptor);
+    }
 
     auto my_mesh = chrono_types::make_shared<ChMesh>();
 
@@ -255,14 +275,26 @@ bool BrickIso_GravTest::execute() {
 
     ChTimer<> timer;
     int num_iterations = 0;
+    double time_force = 0;
+    double time_jacobian = 0;
+    double time_assembly = 0;
+    double time_solve = 0;
 
     // Simulation loop
     for (unsigned int it = 0; it < num_steps; it++) {
+        my_mesh->ResetTimers();
+        if (descriptor)
+            descriptor->ResetTimers();
         timer.start();
         my_system.DoStepDynamics(step_size);
         timer.stop();
 
         num_iterations += mystepper->GetNumIterations();
+        time_force += my_mesh->GetTimeInternalForces();
+        time_jacobian += my_mesh->GetTimeJacobianLoad();
+        if (descriptor)
+            time_assembly += descriptor->GetTimeAssembly();
+        time_solve += my_system.GetTimerLSsolve();
         std::cout << "time = " << my_system.GetChTime() << "\t" << nodetip->GetPos().z() << std::endl;
     }
 
@@ -273,10 +305,29 @@ bool BrickIso_GravTest::execute() {
     addMetric("tip_y_position (mm)", 1000 * nodetip->GetPos().z());
     addMetric("avg_num_iterations", (double)num_iterations / num_steps);
     addMetric("avg_time_per_step (ms)", 1000 * m_execTime / num_steps);
+    addMetric("num_threads", m_num_threads);
+
+    addPhaseTime("internal_forces", time_force);
+    addPhaseTime("jacobian", time_jacobian);
+    if (descriptor)
+        addPhaseTime("assembly", time_assembly);
+    addPhaseTime("step_solve", time_solve);
 
     return true;
 }
 
+// Tests run by this program (or by metrics_runner)
+TestRegistrar reg_brick_grav("metrics_FEA_EASBrickIso_Grav",
+                             "Chrono::FEA",
+                             TestRegistry::MakeFactory<BrickIso_GravTest>());
+TestRegistrar reg_brick_grav_parallel("metrics_FEA_EASBrickIso_Grav_parallel",
+                                      "Chrono::FEA",
+                                      TestRegistry::MakeFactory<BrickIso_GravTest>(1, true));
+
+}  // end anonymous namespace
+
+#ifndef METRICS_RUNNER
+
 // ====================================================================================
 
 int main(int argc, char* argv[]) {
@@ -294,3 +345,5 @@ int main(int argc, char* argv[]) {
 
     return 0;
 }
+
+#endif
@@ -19,9 +19,13 @@
 // of all (!) contact forces acting on the body from the NodeCloud SMC contact.
 // In this unit test, the overall contact force applied to a box (from mesh) is compared
 // to the total weight of the ANCF shell mesh.
+// The resultant is also computed with a dense, index-addressed accumulator
+// (ContactForceMap), with per-node breakdown of the mesh contact forces; both
+// methods are timed and their results compared.
 //
 // =============================================================================
 
+#include <algorithm>
 #include <vector>
 #include <string>
 
@@ -36,11 +40,14 @@
 
 #include "chrono_thirdparty/filesystem/path.h"
 
-#include "../BaseTest.h"
+#include "../ContactForceMap.h"
+#include "../TestRegistry.h"
 
 using namespace chrono;
 using namespace chrono::fea;
 
+namespace {
+
 // ====================================================================================
 
 // ---------------------
@@ -306,21 +313,43 @@ bool MeshContactTest::execute() {
     double total_weight = rho * plate_length_x * plate_length_y * plate_length_z * std::abs(gravity);
     GetLog() << "Total Weight of Shell: " << total_weight << "\n";
 
+    // Dense contact force accumulator for the container box and the mesh nodes
+    auto force_map = chrono_types::make_shared<ContactForceMap>();
+    int ground_index = force_map->AddBody(ground);
+    int mesh_index = force_map->AddNodeCloud(contact_surf, true);
+
     // ---------------
     // Simulation loop
     // ---------------
     ChTimer<> timer;
+    ChTimer<> timer_map;
+    ChTimer<> timer_forces;
     ChVector<> contact_force;
+    double max_map_error = 0;
+    double max_node_error = 0;
     int num_steps = 0;
     bool passed = true;
     while (system->GetChTime() < end_time) {
         timer.start();
         system->DoStepDynamics(time_step);
+        timer_forces.start();
         system->GetContactContainer()->ComputeContactForces();
+        timer_forces.stop();
         timer.stop();
 
+        timer_map.start();
+        force_map->Compute(*system->GetContactContainer());
+        timer_map.stop();
+
         num_steps++;
         contact_force = ground->GetContactForce();
+
+        // Compare with the dense accumulator; the node forces must balance the force on the box
+        ChVector<> node_force = VNULL;
+        for (int in = 0; in < force_map->GetNumNodes(mesh_index); in++)
+            node_force += force_map->GetNodeForce(mesh_index, in);
+        max_map_error = std::max(max_map_error, (force_map->GetForce(ground_index) - contact_force).Length());
+        max_node_error = std::max(max_node_error, (node_force + force_map->GetForce(ground_index)).Length());
         GetLog() << "t = " << system->GetChTime()
                  << "  num contacts = " << system->GetContactContainer()->GetNcontacts()
                  << "  force =  " << contact_force.y() << "  node y displacement = " << nodeRef->GetPos().y() << "\n";
@@ -339,6 +368,15 @@ bool MeshContactTest::execute() {
     addMetric("contact_force", contact_force.y());
     addMetric("node displacement (mm)", 1000 * nodeRef->GetPos().y());
     addMetric("avg_time_per_step (ms)", 1000 * m_execTime / num_steps);
+    addMetric("avg_compute_contact_forces_time (us)", 1e6 * timer_forces.GetTimeSeconds() / num_steps);
+    addMetric("avg_contact_force_map_time (us)", 1e6 * timer_map.GetTimeSeconds() / num_steps);
+    addMetric("contact_force_map_error", max_map_error);
+    addMetric("contact_force_node_balance_error", max_node_error);
+
+    if (max_map_error > rtol * total_weight || max_node_error > rtol * total_weight) {
+        GetLog() << "Contact force map mismatch: " << max_map_error << "  node balance: " << max_node_error << "\n";
+        passed = false;
+    }
 
     GetLog() << "Test " << (passed ? "PASSED" : "FAILED") << "\n\n\n";
 
@@ -346,6 +384,15 @@ bool MeshContactTest::execute() {
     return passed;
 }
 
+// Tests run by this program (or by metrics_runner)
+TestRegistrar reg_contact_DEM("metrics_FEA_compute_contact_mesh_DEM",
+                               "Chrono::FEA",
+                               TestRegistry::MakeFactory<MeshContactTest>(ChContactMethod::SMC));
+
+}  // end anonymous namespace
+
+#ifndef METRICS_RUNNER
+
 // ====================================================================================
 
 int main(int argc, char* argv[]) {
@@ -373,3 +420,5 @@ int main(int argc, char* argv[]) {
     // Return 0 if all tests passed.
     return !passed;
 }
+
+#endif
@@ -11,7 +11,9 @@
 
 #include <algorithm>
 #include <iomanip>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "chrono/ChConfig.h"
 #include "chrono/core/ChTimer.h"
@@ -27,7 +29,10 @@
 
 #include "chrono_thirdparty/filesystem/path.h"
 
-#include "../BaseTest.h"
+#include "projects/MeshSnapshot.h"
+
+#include "../TestRegistry.h"
+#include "FEAScalingTest.h"
 
 #ifdef CHRONO_PARDISO_MKL
 #include "chrono_pardisomkl/ChSolverPardisoMKL.h"
@@ -47,28 +52,33 @@ using namespace chrono::fea;
 using std::cout;
 using std::endl;
 
+namespace {
+
 // -----------------------------------------------------------------------------
 
 int num_threads = 4;      // default number of threads
 double step_size = 1e-3;  // integration step size
 int num_steps = 10;       // number of integration steps
+int num_warmup = 0;       // number of warm-up runs for each test
+int num_runs = 1;         // number of measured runs for each test
 
-int numDiv_x = 30;  // mesh divisions in X direction
-int numDiv_y = 30;  // mesh divisions in Y direction
+int numDiv_xy = 30;  // default mesh divisions in X and Y directions
 int numDiv_z = 1;    // mesh divisions in Z direction
 
 // -----------------------------------------------------------------------------
 
 // Test class
-class FEAShellTest : public BaseTest {
+class FEAShellTest : public FEASizedTest {
   public:
     FEAShellTest(const std::string& testName,
                  const std::string& testProjectName,
                  int nthreads,
                  ChSolver::Type solver,
                  bool use_modifiedNewton,
-                 bool verbose_solver)
-        : BaseTest(testName, testProjectName),
+                 bool verbose_solver,
+                 int num_div = numDiv_xy)
+        : FEASizedTest(testName, testProjectName),
+          m_num_div(num_div),
           m_nthreads(nthreads),
           m_execTime(0),
           m_solver(solver),
@@ -82,7 +92,12 @@ class FEAShellTest : public BaseTest {
     virtual bool execute() override;
     virtual double getExecutionTime() const override { return m_execTime; }
 
+    // Override corresponding functions in FEASizedTest
+    virtual int getNumElements() const override { return m_num_div * m_num_div; }
+    virtual int getNumSteps() const override { return num_steps; }
+
   private:
+    int m_num_div;              // number of mesh divisions in X and Y directions
     int m_nthreads;             // number of OpenMP threads
     double m_execTime;          // execution time
     ChSolver::Type m_solver;    // linear solver type
@@ -112,9 +127,14 @@ bool FEAShellTest::execute() {
     cout << "Adaptive step:   " << (m_use_adaptiveStep ? "Yes" : "No") << endl;
     cout << "Modified Newton: " << (m_use_modifiedNewton ? "Yes" : "No") << endl;
     cout << endl;
-    cout << "Mesh divisions:  " << numDiv_x << " x " << numDiv_y << endl;
+    cout << "Mesh divisions:  " << m_num_div << " x " << m_num_div << endl;
     cout << endl;
 
+    int numDiv_x = m_num_div;
+    int numDiv_y = m_num_div;
+
+    PhaseTimer setup_timer(*this, "setup");
+
     // Create the physical system
     ChSystemNSC my_system;
     my_system.SetNumThreads(m_nthreads);
@@ -260,7 +280,11 @@ bool FEAShellTest::execute() {
     // Get handle to tracked node.
     auto nodetip = std::dynamic_pointer_cast<ChNodeFEAxyzD>(my_mesh->GetNode(TotalNumNodes - 1));
 
+    setup_timer.stop();
+
     // Simulation loop
+    PhaseTimer simulate_timer(*this, "simulate");
+
     double time_total = 0;
     double time_setup = 0;
     double time_solve = 0;
@@ -274,6 +298,13 @@ bool FEAShellTest::execute() {
     int num_force_calls = 0;
     int num_jacobian_calls = 0;
 
+    // Per-step series
+    Series& step_series = addSeries("step_time");
+    Series& iterations_series = addSeries("newton_iterations");
+    Series& force_series = addSeries("time_force");
+    Series& jacobian_series = addSeries("time_jacobian");
+    Series* allocs_series = MemoryStats::CountingAllocations() ? &addSeries("allocations") : nullptr;
+
     for (int istep = 0; istep < num_steps; istep++) {
         if (m_verbose_solver) {
             cout << "-------------------------------------------------------------------" << endl;
@@ -293,7 +324,9 @@ bool FEAShellTest::execute() {
             mumps_solver->ResetTimers();
 #endif
 
+        uint64_t num_allocs = MemoryStats::GetAllocationCount();
         my_system.DoStepDynamics(step_size);
+        num_allocs = MemoryStats::GetAllocationCount() - num_allocs;
 
         if (istep == 3 && m_solver == ChSolver::Type::PARDISO_MKL) {
 #ifdef CHRONO_PARDISO_MKL
@@ -316,6 +349,13 @@ bool FEAShellTest::execute() {
         num_force_calls += my_mesh->GetNumCallsInternalForces();
         num_jacobian_calls += my_mesh->GetNumCallsJacobianLoad();
 
+        step_series.push_back(my_system.GetTimerStep());
+        iterations_series.push_back(mystepper->GetNumIterations());
+        force_series.push_back(my_mesh->GetTimeInternalForces());
+        jacobian_series.push_back(my_mesh->GetTimeJacobianLoad());
+        if (allocs_series)
+            allocs_series->push_back(static_cast<double>(num_allocs));
+
         const ChVector<>& p = nodetip->GetPos();
 
         if (m_verbose_solver) {
@@ -328,6 +368,17 @@ bool FEAShellTest::execute() {
         }
     }
 
+    simulate_timer.stop();
+
+    // Cost of a restart snapshot of the final state (as written periodically by test_FEA_shellANCF)
+    std::string snapshot_file = getOutDir() + "/" + getTestName() + ".snapshot.bin";
+    ChTimer<double> snapshot_timer;
+    snapshot_timer.start();
+    bool snapshot_written = WriteMeshSnapshot(my_system, num_steps, snapshot_file);
+    snapshot_timer.stop();
+    double snapshot_size = snapshot_written ? (double)filesystem::path(snapshot_file).file_size() : 0;
+    std::remove(snapshot_file.c_str());
+
     double time_other = time_total - time_setup - time_solve - time_update - time_force - time_jacobian;
 
     cout << "-------------------------------------------------------------------" << endl;
@@ -355,11 +406,67 @@ bool FEAShellTest::execute() {
     addMetric("time_solve", time_solve);
     addMetric("time_jacobian", time_jacobian);
     addMetric("time_force", time_force);
+    if (snapshot_written) {
+        addMetric("snapshot_write_time", snapshot_timer());
+        addMetric("snapshot_size (MB)", snapshot_size / (1024 * 1024));
+    }
+
+    addPhaseTime("step_setup", time_setup);
+    addPhaseTime("step_solve", time_solve);
+    addPhaseTime("step_update", time_update);
+    addPhaseTime("internal_forces", time_force);
+    addPhaseTime("jacobian", time_jacobian);
 
     return true;
 }
 
+// Tests run by this program (or by metrics_runner)
+TestRegistrar reg_minres_full("metrics_FEA_shellANCF_MINRES_full",
+                              "Chrono::FEA",
+                              TestRegistry::MakeFactory<FEAShellTest>(num_threads,
+                                                                      ChSolver::Type::MINRES,
+                                                                      false,
+                                                                      false));
+TestRegistrar reg_minres_mod("metrics_FEA_shellANCF_MINRES_modified",
+                             "Chrono::FEA",
+                             TestRegistry::MakeFactory<FEAShellTest>(num_threads, ChSolver::Type::MINRES, true, false));
+#ifdef CHRONO_PARDISO_MKL
+TestRegistrar reg_mkl_full("metrics_FEA_shellANCF_MKL_full",
+                           "Chrono::FEA",
+                           TestRegistry::MakeFactory<FEAShellTest>(num_threads,
+                                                                   ChSolver::Type::PARDISO_MKL,
+                                                                   false,
+                                                                   false));
+TestRegistrar reg_mkl_mod("metrics_FEA_shellANCF_MKL_modified",
+                          "Chrono::FEA",
+                          TestRegistry::MakeFactory<FEAShellTest>(num_threads,
+                                                                  ChSolver::Type::PARDISO_MKL,
+                                                                  true,
+                                                                  false));
+#endif
+
+// Scaling with the number of shell elements (8x8, 11x11, ..., 45x45 meshes), using MINRES and full Newton
+std::unique_ptr<BaseTest> CreateScalingTest(const std::string& name, const std::string& project) {
+    std::vector<int> sizes = {8, 11, 16, 23, 32, 45};
+    auto factory = [project](const std::string& test_name, int size) {
+        return std::unique_ptr<FEASizedTest>(
+            new FEAShellTest(test_name, project, num_threads, ChSolver::Type::MINRES, false, false, size));
+    };
+    return std::unique_ptr<BaseTest>(new FEAScalingTest(name, project, sizes, factory));
+}
+
+TestRegistrar reg_scaling("metrics_FEA_shellANCF_scaling", "Chrono::FEA", CreateScalingTest);
+
+}  // end anonymous namespace
+
+#ifndef METRICS_RUNNER
+
 int main(int argc, char* argv[]) {
+    // Usage: metrics_FEA_shellANCF [--scaling] [num_threads [num_warmup num_runs]]
+    // With --scaling, run the MINRES test for a series of mesh sizes.
+    bool scaling = (argc > 1 && std::string(argv[1]) == "--scaling");
+    int arg0 = scaling ? 2 : 1;
+
     std::string out_dir = "../METRICS";
     if (!filesystem::create_directory(filesystem::path(out_dir))) {
         std::cout << "Error creating directory " << out_dir << std::endl;
@@ -367,14 +474,29 @@ int main(int argc, char* argv[]) {
     }
 #ifdef CHRONO_OPENMP_ENABLED
     // Set number of threads
-    if (argc > 1)
-        num_threads = std::stoi(argv[1]);
+    if (argc > arg0)
+        num_threads = std::stoi(argv[arg0]);
     num_threads = std::min(num_threads, ChOMP::GetNumProcs());
     GetLog() << "Using " << num_threads << " thread(s)\n";
 #else
     GetLog() << "No OpenMP\n";
 #endif
 
+    // Set number of warm-up and measured runs
+    if (argc > arg0 + 2) {
+        num_warmup = std::stoi(argv[arg0 + 1]);
+        num_runs = std::stoi(argv[arg0 + 2]);
+    }
+
+    if (scaling) {
+        auto test = CreateScalingTest("metrics_FEA_shellANCF_scaling", "Chrono::FEA");
+        test->setOutDir(out_dir);
+        test->setRepetitions(num_warmup, num_runs);
+        bool passed = test->run();
+        test->print();
+        return !passed;
+    }
+
     bool verbose_solver = false;
     bool verbose_test = false;
 
@@ -382,6 +504,8 @@ int main(int argc, char* argv[]) {
                                   ChSolver::Type::MINRES,
                                   false, verbose_solver);
     test_minres_full.setOutDir(out_dir);
+    test_minres_full.setRepetitions(num_warmup, num_runs);
+    test_minres_full.enableHardwareCounters(true);
     test_minres_full.setVerbose(verbose_test);
     test_minres_full.run();
     test_minres_full.print();
@@ -389,6 +513,8 @@ int main(int argc, char* argv[]) {
     FEAShellTest test_minres_mod("metrics_FEA_shellANCF_MINRES_modified", "Chrono::FEA", num_threads,
                                  ChSolver::Type::MINRES, true, verbose_solver);
     test_minres_mod.setOutDir(out_dir);
+    test_minres_mod.setRepetitions(num_warmup, num_runs);
+    test_minres_mod.enableHardwareCounters(true);
     test_minres_mod.setVerbose(verbose_test);
     test_minres_mod.run();
     test_minres_mod.print();
@@ -397,6 +523,8 @@ int main(int argc, char* argv[]) {
     FEAShellTest test_mkl_full("metrics_FEA_shellANCF_MKL_full", "Chrono::FEA", num_threads,
                                ChSolver::Type::PARDISO_MKL, false, verbose_solver);
     test_mkl_full.setOutDir(out_dir);
+    test_mkl_full.setRepetitions(num_warmup, num_runs);
+    test_mkl_full.enableHardwareCounters(true);
     test_mkl_full.setVerbose(verbose_test);
     test_mkl_full.run();
     test_mkl_full.print();
@@ -404,6 +532,8 @@ int main(int argc, char* argv[]) {
     FEAShellTest test_mkl_mod("metrics_FEA_shellANCF_MKL_modified", "Chrono::FEA", num_threads,
                               ChSolver::Type::PARDISO_MKL, true, verbose_solver);
     test_mkl_mod.setOutDir(out_dir);
+    test_mkl_mod.setRepetitions(num_warmup, num_runs);
+    test_mkl_mod.enableHardwareCounters(true);
     test_mkl_mod.setVerbose(verbose_test);
     test_mkl_mod.run();
     test_mkl_mod.print();
@@ -411,3 +541,5 @@ int main(int argc, char* argv[]) {
 
     return 0;
 }
+
+#endif
@@ -0,0 +1,347 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Chrono::Gpu settling benchmark: monodisperse spheres settling in a cubic box
+// (the setup of projects/gpu_tests/test_GPU_milsettle.cpp), with the box sized
+// for a requested number of particles.
+//
+// Each test reports the simulation throughput (particles x steps per second,
+// the metric also reported by metrics_MCORE_settling, for a CPU vs GPU choice
+// at a given problem size), the device memory used by the system (difference
+// of the free device memory before the system is created and after it is
+// initialized) and the device and host memory per particle.
+//
+// Chrono::Gpu stores positions as integers in the units of a length scale
+// derived from the particle radius and the psi_L factor (with float
+// velocities and forces); the precision variants change psi_L, i.e. the
+// resolution of the positions (16 is the default; 8 is coarser, 32 finer).
+//
+// Run as metrics_GPU_milsettle --scaling [--max n] [--psiL l] for the scaling
+// test over 10^4, 10^5, ... particles (up to 10^6 by default, e.g. --max 1e7).
+//
+// =============================================================================
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <cuda_runtime.h>
+
+#include "chrono/core/ChTimer.h"
+#include "chrono/utils/ChUtilsSamplers.h"
+
+#include "chrono_gpu/ChGpuData.h"
+#include "chrono_gpu/physics/ChSystemGpu.h"
+
+#include "chrono_thirdparty/filesystem/path.h"
+
+#include "../TestRegistry.h"
+
+using namespace chrono;
+using namespace chrono::gpu;
+
+namespace {
+
+// =============================================================================
+// Problem parameters (same as in test_GPU_milsettle)
+// =============================================================================
+
+constexpr float ballRadius = 1.f;
+constexpr float ballDensity = 2.50f;
+constexpr float grav_acceleration = -980.f;
+constexpr float normStiffness_S2S = 1e7f;
+constexpr float normStiffness_S2W = 1e7f;
+constexpr float normalDampS2S = 1000;
+constexpr float normalDampS2W = 1000;
+constexpr float timestep = 1e-4f;
+constexpr float spacing = 2.4f * ballRadius;
+
+constexpr unsigned int psi_T = 32;
+
+constexpr int fps = 100;
+constexpr float frame_step = 1.f / fps;
+
+// Simulated time of each test
+double duration = 0.1;
+
+// Number of warm-up and measured runs for each test
+int num_warmup = 0;
+int num_runs = 1;
+
+// Used device memory (bytes)
+size_t GetUsedDeviceMemory() {
+    size_t free_bytes = 0;
+    size_t total_bytes = 0;
+    if (cudaMemGetInfo(&free_bytes, &total_bytes) != cudaSuccess)
+        return 0;
+    return total_bytes - free_bytes;
+}
+
+// =============================================================================
+
+// Test class
+class GPUSettlingTest : public BaseTest {
+  public:
+    GPUSettlingTest(const std::string& testName,
+                    const std::string& testProjectName,
+                    double num_particles,
+                    unsigned int psi_L)
+        : BaseTest(testName, testProjectName),
+          m_target(num_particles),
+          m_psi_L(psi_L),
+          m_execTime(0),
+          m_num_particles(0),
+          m_throughput(0),
+          m_device_bytes(0),
+          m_time_per_step(0) {}
+
+    ~GPUSettlingTest() {}
+
+    // Override corresponding functions in BaseTest
+    virtual bool execute() override;
+    virtual double getExecutionTime() const override { return m_execTime; }
+
+    size_t GetNumParticles() const { return m_num_particles; }
+    double GetThroughput() const { return m_throughput; }
+    double GetDeviceBytesPerParticle() const { return m_num_particles ? (double)m_device_bytes / m_num_particles : 0; }
+    double GetTimePerStep() const { return m_time_per_step; }
+
+  private:
+    double m_target;
+    unsigned int m_psi_L;
+    double m_execTime;
+    size_t m_num_particles;
+    double m_throughput;
+    size_t m_device_bytes;
+    double m_time_per_step;
+};
+
+bool GPUSettlingTest::execute() {
+    PhaseTimer setup_timer(*this, "setup");
+
+    // Cubic box, with its bottom quarter filled with material on a HCP lattice (sqrt(2) particles per spacing^3)
+    float box_size = (float)std::cbrt(4 * m_target * spacing * spacing * spacing / std::sqrt(2.0)) + 2 * ballRadius;
+    std::cout << "Box size: " << box_size << std::endl;
+
+    size_t device_start = GetUsedDeviceMemory();
+
+    ChSystemGpu gpu_system(ballRadius, ballDensity, ChVector<float>(box_size, box_size, box_size));
+    gpu_system.SetPsiFactors(psi_T, m_psi_L);
+    gpu_system.SetKn_SPH2SPH(normStiffness_S2S);
+    gpu_system.SetKn_SPH2WALL(normStiffness_S2W);
+    gpu_system.SetGn_SPH2SPH(normalDampS2S);
+    gpu_system.SetGn_SPH2WALL(normalDampS2W);
+    gpu_system.SetCohesionRatio(0);
+    gpu_system.SetAdhesionRatio_SPH2WALL(0);
+    gpu_system.SetGravitationalAcceleration(ChVector<>(0.f, 0.f, grav_acceleration));
+    gpu_system.SetParticleOutputMode(CHGPU_OUTPUT_MODE::NONE);
+
+    utils::HCPSampler<float> sampler(spacing);
+    ChVector<float> center(0, 0, -0.25f * box_size);
+    ChVector<float> hdims(box_size / 2 - ballRadius, box_size / 2 - ballRadius, box_size / 4 - ballRadius);
+    gpu_system.SetParticles(sampler.SampleBox(center, hdims));
+
+    gpu_system.SetBDFixed(true);
+    gpu_system.SetFrictionMode(CHGPU_FRICTION_MODE::FRICTIONLESS);
+    gpu_system.SetTimeIntegrator(CHGPU_TIME_INTEGRATOR::EXTENDED_TAYLOR);
+    gpu_system.SetVerbosity(CHGPU_VERBOSITY::QUIET);
+    gpu_system.SetFixedStepSize(timestep);
+
+    gpu_system.Initialize();
+    cudaDeviceSynchronize();
+    size_t device_end = GetUsedDeviceMemory();
+    m_device_bytes = device_end > device_start ? device_end - device_start : 0;
+
+    setup_timer.stop();
+
+    m_num_particles = gpu_system.GetNumParticles();
+    std::cout << "Number of particles: " << m_num_particles << std::endl;
+
+    // Simulation loop
+    // ---------------
+
+    PhaseTimer settle_timer(*this, "settle");
+
+    ChTimer<double> timer;
+    timer.start();
+    int num_frames = 0;
+    for (double t = 0; t < duration; t += frame_step) {
+        gpu_system.AdvanceSimulation(frame_step);
+        num_frames++;
+    }
+    cudaDeviceSynchronize();
+    timer.stop();
+
+    settle_timer.stop();
+
+    m_execTime = timer.GetTimeSeconds();
+
+    // Check that the bed did not blow up
+    bool passed = true;
+    for (size_t i = 0; i < m_num_particles; i += 1 + m_num_particles / 1000) {
+        ChVector<float> pos = gpu_system.GetParticlePosition((int)i);
+        passed &= std::isfinite(pos.z()) && std::abs(pos.z()) <= box_size / 2 + ballRadius;
+    }
+
+    double num_steps = num_frames * std::round(frame_step / timestep);
+    double particle_steps = m_num_particles * num_steps;
+    m_throughput = m_execTime > 0 ? particle_steps / m_execTime : 0;
+    m_time_per_step = num_steps > 0 ? m_execTime / num_steps : 0;
+
+    addMetric("num_particles", static_cast<int>(m_num_particles));
+    addMetric("num_steps", num_steps);
+    addMetric("psi_L", static_cast<int>(m_psi_L));
+    addMetric("avg_sim_time_per_step (ms)", 1000 * m_time_per_step);
+    addMetric("particle_steps_per_second", m_throughput);
+    addMetric("device_bytes", static_cast<uint64_t>(m_device_bytes));
+    addMetric("device_bytes_per_particle", GetDeviceBytesPerParticle());
+    addMetric("host_bytes_per_particle",
+              m_num_particles ? (double)MemoryStats::GetPeakRSS() / m_num_particles : 0.0);
+
+    return passed;
+}
+
+// =============================================================================
+
+// Summary of a particle-count sweep: throughput and memory per particle for each size, and the exponent of a
+// power-law fit of the time per step versus the number of particles (1 for linear scaling).
+class GPUSettlingScaling : public BaseTest {
+  public:
+    GPUSettlingScaling(const std::string& testName,
+                       const std::string& testProjectName,
+                       double max_particles,
+                       unsigned int psi_L)
+        : BaseTest(testName, testProjectName), m_max_particles(max_particles), m_psi_L(psi_L), m_execTime(0) {}
+
+    virtual bool execute() override {
+        std::vector<double> particles, throughput, bytes, step_time;
+        bool passed = true;
+        m_execTime = 0;
+        for (double n = 1e4; n <= m_max_particles * 1.001; n *= 10) {
+            std::string name = getTestName() + "_" + std::to_string((long long)std::round(n));
+            GPUSettlingTest test(name, getProjectName(), n, m_psi_L);
+            test.setOutDir(getOutDir());
+            test.setRepetitions(num_warmup, num_runs);
+            passed &= test.run();
+            m_execTime += test.getExecutionTime();
+
+            particles.push_back((double)test.GetNumParticles());
+            throughput.push_back(test.GetThroughput());
+            bytes.push_back(test.GetDeviceBytesPerParticle());
+            step_time.push_back(test.GetTimePerStep());
+        }
+
+        printf("\n%12s | %18s | %14s\n", "particles", "particle-steps/s", "device B/part");
+        for (size_t i = 0; i < particles.size(); i++)
+            printf("%12.0f | %18.4e | %14.1f\n", particles[i], throughput[i], bytes[i]);
+
+        addMetric("num_particles", particles);
+        addMetric("particle_steps_per_second", throughput);
+        addMetric("device_bytes_per_particle", bytes);
+        addMetric("time_per_step", step_time);
+        if (particles.size() > 1)
+            addMetric("time_per_step_exponent", PowerLawFit(particles, step_time).exponent);
+
+        return passed;
+    }
+
+    virtual double getExecutionTime() const override { return m_execTime; }
+
+  private:
+    double m_max_particles;
+    unsigned int m_psi_L;
+    double m_execTime;
+};
+
+// Tests run by this program (or by metrics_runner)
+TestRegistrar reg_1e4("metrics_GPU_milsettle_1e4",
+                      "Chrono::Gpu",
+                      TestRegistry::MakeFactory<GPUSettlingTest>(1e4, 16u));
+TestRegistrar reg_1e5("metrics_GPU_milsettle_1e5",
+                      "Chrono::Gpu",
+                      TestRegistry::MakeFactory<GPUSettlingTest>(1e5, 16u));
+TestRegistrar reg_1e6("metrics_GPU_milsettle_1e6",
+                      "Chrono::Gpu",
+                      TestRegistry::MakeFactory<GPUSettlingTest>(1e6, 16u));
+TestRegistrar reg_1e5_L8("metrics_GPU_milsettle_1e5_psiL8",
+                         "Chrono::Gpu",
+                         TestRegistry::MakeFactory<GPUSettlingTest>(1e5, 8u));
+TestRegistrar reg_1e5_L32("metrics_GPU_milsettle_1e5_psiL32",
+                          "Chrono::Gpu",
+                          TestRegistry::MakeFactory<GPUSettlingTest>(1e5, 32u));
+
+}  // end anonymous namespace
+
+#ifndef METRICS_RUNNER
+
+// =============================================================================
+// Main driver program
+// =============================================================================
+
+int main(int argc, char* argv[]) {
+    // Usage: metrics_GPU_milsettle [--scaling] [--max num_particles] [--psiL psi_L] [num_warmup num_runs]
+    bool scaling = false;
+    double max_particles = 1e6;
+    unsigned int psi_L = 16;
+    std::vector<int> counts;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--scaling") == 0)
+            scaling = true;
+        else if (std::strcmp(argv[i], "--max") == 0 && i + 1 < argc)
+            max_particles = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--psiL") == 0 && i + 1 < argc)
+            psi_L = (unsigned int)std::atoi(argv[++i]);
+        else
+            counts.push_back(std::atoi(argv[i]));
+    }
+    if (counts.size() == 2) {
+        num_warmup = counts[0];
+        num_runs = counts[1];
+    }
+
+    std::string out_dir = "../METRICS";
+    if (!filesystem::create_directory(filesystem::path(out_dir))) {
+        std::cout << "Error creating directory " << out_dir << std::endl;
+        return 1;
+    }
+
+    bool passed = true;
+
+    if (scaling) {
+        GPUSettlingScaling test("metrics_GPU_milsettle_scaling_psiL" + std::to_string(psi_L), "Chrono::Gpu",
+                                max_particles, psi_L);
+        test.setOutDir(out_dir);
+        test.setVerbose(true);
+        passed &= test.run();
+        test.print();
+        return !passed;
+    }
+
+    for (const auto& entry : TestRegistry::Get().GetEntries()) {
+        auto test = entry.factory(entry.name, entry.project);
+        test->setOutDir(out_dir);
+        test->setVerbose(true);
+        test->setRepetitions(num_warmup, num_runs);
+        test->setSeriesSidecarThreshold(1000);
+        passed &= test->run();
+        test->print();
+    }
+
+    return !passed;
+}
+
+#endif
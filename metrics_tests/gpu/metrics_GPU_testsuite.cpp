@@ -0,0 +1,435 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Chrono::Gpu metrics for the scenarios of the GPU test suite
+// (projects/gpu_tests/test_GPU_testsuite.cpp): ROTF, PYRAMID, MESH_STEP, and
+// MESH_FORCE.
+//
+// Device-side phases are timed with CUDA events. Each test reports the
+// simulation throughput (particles x steps per second) and the volume of data
+// exchanged between host and device through the ChSystemGpu API.
+//
+// =============================================================================
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <cuda_runtime.h>
+
+#include "chrono/core/ChGlobal.h"
+#include "chrono/core/ChTimer.h"
+#include "chrono/utils/ChUtilsSamplers.h"
+
+#include "chrono_gpu/ChGpuData.h"
+#include "chrono_gpu/physics/ChSystemGpu.h"
+
+#include "chrono_thirdparty/filesystem/path.h"
+
+#include "../TestRegistry.h"
+
+using namespace chrono;
+using namespace chrono::gpu;
+
+namespace {
+
+// =============================================================================
+// Problem parameters (same as in the GPU test suite)
+// =============================================================================
+
+constexpr float sphere_radius = 1.f;
+constexpr float sphere_density = 2.50f;
+constexpr float grav_Z = -980.f;
+constexpr float normalStiffness_S2S = 1e8;
+constexpr float normalStiffness_S2W = 1e8;
+constexpr float normalStiffness_S2M = 1e8;
+constexpr float normalDampS2S = 10000;
+constexpr float normalDampS2W = 10000;
+constexpr float normalDampS2M = 10000;
+
+constexpr float tangentStiffness_S2S = 3e7;
+constexpr float tangentStiffness_S2W = 3e7;
+constexpr float tangentStiffness_S2M = 3e7;
+constexpr float tangentDampS2S = 500;
+constexpr float tangentDampS2W = 500;
+constexpr float tangentDampS2M = 500;
+
+constexpr float static_friction_coeff = 0.5f;
+
+constexpr float cohes = 0;
+
+constexpr float timestep = 2e-5f;
+
+constexpr unsigned int psi_T = 16;
+constexpr unsigned int psi_L = 16;
+
+float box_X = 400.f;
+float box_Y = 100.f;
+float box_Z = 50.f;
+
+double step_mass = 1;
+double step_height = -1;
+
+constexpr int fps = 100;
+constexpr float frame_step = 1.f / fps;
+
+enum TEST_TYPE { ROTF = 0, PYRAMID = 1, MESH_STEP = 2, MESH_FORCE = 3 };
+
+// Number of warm-up and measured runs for each test
+int num_warmup = 0;
+int num_runs = 1;
+
+// =============================================================================
+
+// Timer for device work, based on CUDA events recorded in the default stream.
+// Since the legacy default stream synchronizes with all blocking streams, the measured interval covers all device
+// work launched between start() and stop().
+class CudaEventTimer {
+  public:
+    CudaEventTimer() : m_total(0) {
+        cudaEventCreate(&m_start);
+        cudaEventCreate(&m_stop);
+    }
+
+    ~CudaEventTimer() {
+        cudaEventDestroy(m_start);
+        cudaEventDestroy(m_stop);
+    }
+
+    void start() { cudaEventRecord(m_start, 0); }
+
+    /// Stop the timer and return the duration (in seconds) of the last interval.
+    double stop() {
+        cudaEventRecord(m_stop, 0);
+        cudaEventSynchronize(m_stop);
+        float ms = 0;
+        if (cudaEventElapsedTime(&ms, m_start, m_stop) != cudaSuccess)
+            ms = 0;
+        m_total += 1e-3 * ms;
+        return 1e-3 * ms;
+    }
+
+    /// Accumulated duration (in seconds) of all intervals.
+    double GetTimeSeconds() const { return m_total; }
+
+  private:
+    cudaEvent_t m_start;
+    cudaEvent_t m_stop;
+    double m_total;
+};
+
+// =============================================================================
+
+// Test class
+class GPUTestsuiteTest : public BaseTest {
+  public:
+    GPUTestsuiteTest(const std::string& testName, const std::string& testProjectName, TEST_TYPE type, double duration)
+        : BaseTest(testName, testProjectName),
+          m_type(type),
+          m_duration(duration),
+          m_execTime(0),
+          m_bytes_h2d(0),
+          m_bytes_d2h(0) {}
+
+    ~GPUTestsuiteTest() {}
+
+    // Override corresponding functions in BaseTest
+    virtual bool execute() override;
+    virtual double getExecutionTime() const override { return m_execTime; }
+
+  private:
+    void SetCommonParameters(ChSystemGpuMesh& gpu_sys);
+    bool CheckParticles(ChSystemGpuMesh& gpu_sys, const ChVector<float>& box);
+
+    TEST_TYPE m_type;
+    double m_duration;
+    double m_execTime;
+    uint64_t m_bytes_h2d;  // bytes transferred from host to device
+    uint64_t m_bytes_d2h;  // bytes transferred from device to host
+};
+
+// Set common set of parameters for all tests
+void GPUTestsuiteTest::SetCommonParameters(ChSystemGpuMesh& gpu_sys) {
+    gpu_sys.SetPsiFactors(psi_T, psi_L);
+    gpu_sys.SetKn_SPH2SPH(normalStiffness_S2S);
+    gpu_sys.SetKn_SPH2WALL(normalStiffness_S2W);
+    gpu_sys.SetGn_SPH2SPH(normalDampS2S);
+    gpu_sys.SetGn_SPH2WALL(normalDampS2W);
+
+    gpu_sys.SetKt_SPH2SPH(tangentStiffness_S2S);
+    gpu_sys.SetKt_SPH2WALL(tangentStiffness_S2W);
+    gpu_sys.SetGt_SPH2SPH(tangentDampS2S);
+    gpu_sys.SetGt_SPH2WALL(tangentDampS2W);
+
+    gpu_sys.SetKn_SPH2MESH(normalStiffness_S2M);
+    gpu_sys.SetGn_SPH2MESH(normalDampS2M);
+    gpu_sys.SetKt_SPH2MESH(tangentStiffness_S2M);
+    gpu_sys.SetGt_SPH2MESH(tangentDampS2M);
+
+    gpu_sys.SetCohesionRatio(cohes);
+    gpu_sys.SetAdhesionRatio_SPH2WALL(cohes);
+    gpu_sys.SetGravitationalAcceleration(ChVector<>(0, 0, grav_Z));
+    gpu_sys.SetStaticFrictionCoeff_SPH2SPH(static_friction_coeff);
+    gpu_sys.SetStaticFrictionCoeff_SPH2WALL(static_friction_coeff);
+
+    gpu_sys.SetRollingCoeff_SPH2SPH(static_friction_coeff / 2.);
+    gpu_sys.SetRollingCoeff_SPH2WALL(static_friction_coeff / 2.);
+
+    gpu_sys.SetTimeIntegrator(CHGPU_TIME_INTEGRATOR::CENTERED_DIFFERENCE);
+    gpu_sys.SetFixedStepSize(timestep);
+    gpu_sys.SetBDFixed(true);
+
+    gpu_sys.SetFrictionMode(CHGPU_FRICTION_MODE::MULTI_STEP);
+    gpu_sys.SetRollingMode(CHGPU_ROLLING_MODE::NO_RESISTANCE);
+}
+
+// Read back the final particle positions and check that they are valid and inside the (slightly inflated) domain
+bool GPUTestsuiteTest::CheckParticles(ChSystemGpuMesh& gpu_sys, const ChVector<float>& box) {
+    size_t num_particles = gpu_sys.GetNumParticles();
+    m_bytes_d2h += num_particles * sizeof(ChVector<float>);
+
+    for (size_t i = 0; i < num_particles; i++) {
+        ChVector<float> pos = gpu_sys.GetParticlePosition((int)i);
+        if (!std::isfinite(pos.x()) || !std::isfinite(pos.y()) || !std::isfinite(pos.z()))
+            return false;
+        if (std::abs(pos.x()) > box.x() / 2 + sphere_radius || std::abs(pos.y()) > box.y() / 2 + sphere_radius ||
+            std::abs(pos.z()) > box.z() / 2 + sphere_radius)
+            return false;
+    }
+
+    return true;
+}
+
+bool GPUTestsuiteTest::execute() {
+    gpu::SetDataPath(std::string(PROJECTS_DATA_DIR) + "gpu/");
+
+    m_bytes_h2d = 0;
+    m_bytes_d2h = 0;
+
+    PhaseTimer setup_timer(*this, "setup");
+
+    // The MESH_FORCE particle bed does not fit in the default domain
+    ChVector<float> box =
+        (m_type == MESH_FORCE) ? ChVector<float>(100, 100, 100) : ChVector<float>(box_X, box_Y, box_Z);
+
+    ChSystemGpuMesh gpu_sys(sphere_radius, sphere_density, box);
+    SetCommonParameters(gpu_sys);
+
+    // Per-frame host-device exchange (mesh motion, reaction forces)
+    std::function<void()> frame_callback;
+
+    // Size of a mesh motion update (position, orientation, linear and angular velocity)
+    const size_t mesh_motion_bytes = 13 * sizeof(double);
+
+    std::vector<ChVector<float>> points;
+    size_t slope_plane_id = 0;
+    size_t bottom_plane_id = 0;
+    ChVector<float> reaction_forces;
+    ChVector<> mesh_pos;
+    ChQuaternion<> mesh_rot = Q_from_AngY(0);
+    ChVector<> mesh_force;
+    ChVector<> mesh_torque;
+
+    switch (m_type) {
+        case ROTF: {
+            // Single sphere rolling down a 45 degree ramp
+            float ramp_angle = (float)CH_C_PI / 4;
+            ChVector<> plane_normal(std::cos(ramp_angle), 0.f, std::sin(ramp_angle));
+            ChVector<> plane_pos(-box_X / 2.f, 0.f, 0.);
+            points.push_back(ChVector<float>(-box_X / 2.f + 2.f * sphere_radius, 0, 2 * sphere_radius));
+
+            slope_plane_id = gpu_sys.CreateBCPlane(plane_pos, plane_normal, true);
+            bottom_plane_id =
+                gpu_sys.CreateBCPlane(ChVector<>(0, 0, -box_Z / 2 + 2 * sphere_radius), ChVector<>(0, 0, 1), true);
+
+            frame_callback = [&]() {
+                gpu_sys.GetBCReactionForces(slope_plane_id, reaction_forces);
+                gpu_sys.GetBCReactionForces(bottom_plane_id, reaction_forces);
+                m_bytes_d2h += 2 * sizeof(ChVector<float>);
+            };
+            break;
+        }
+        case PYRAMID: {
+            // Four spheres stacked in a pyramid on a plane
+            float diam_delta = 2.01f;
+            gpu_sys.CreateBCPlane(ChVector<>(0, 0, -1.02 * sphere_radius), ChVector<>(0, 0, 1), true);
+
+            ChVector<> base_sphere_1(0, 0, 0);
+            ChVector<> base_sphere_2(diam_delta * sphere_radius, 0, 0);
+            ChVector<> base_sphere_3(diam_delta * sphere_radius * std::cos(CH_C_PI / 3),
+                                     diam_delta * sphere_radius * std::sin(CH_C_PI / 3), 0);
+            ChVector<> top_sphere((base_sphere_1.x() + base_sphere_2.x() + base_sphere_3.x()) / 3.,
+                                  (base_sphere_1.y() + base_sphere_2.y() + base_sphere_3.y()) / 3.,
+                                  2.0 * sphere_radius * std::sin(CH_C_PI / 3));
+
+            points.push_back(base_sphere_1);
+            points.push_back(base_sphere_2);
+            points.push_back(base_sphere_3);
+            points.push_back(top_sphere);
+            break;
+        }
+        case MESH_STEP: {
+            // Granular bed settling on a step mesh
+            gpu_sys.AddMesh(gpu::GetDataFile("meshes/testsuite/step.obj"), ChVector<float>(0),
+                            ChMatrix33<float>(ChVector<float>(box_X / 2, box_Y / 2, step_height)), step_mass);
+
+            double epsilon = 0.2 * sphere_radius;
+            double spacing = 2 * sphere_radius + epsilon;
+            utils::PDSampler<float> sampler(spacing);
+            double fill_bottom = -box_Z / 2 + step_height + 2 * spacing;
+            double fill_top = box_Z / 2 - sphere_radius - epsilon;
+            ChVector<> hdims(box_X / 2 - sphere_radius - epsilon, box_Y / 2 - sphere_radius - epsilon, 0);
+            for (double z = fill_bottom; z < fill_top; z += spacing) {
+                auto layer = sampler.SampleBox(ChVector<>(0, 0, z), hdims);
+                points.insert(points.end(), layer.begin(), layer.end());
+            }
+
+            mesh_pos = ChVector<>(0, 0, -box_Z / 2 + 2 * sphere_radius);
+            frame_callback = [&]() {
+                gpu_sys.ApplyMeshMotion(0, mesh_pos, mesh_rot, ChVector<>(0, 0, 0), ChVector<>(0, 0, 0));
+                m_bytes_h2d += mesh_motion_bytes;
+            };
+            break;
+        }
+        case MESH_FORCE: {
+            // Granular bed resting in a box mesh, with contact forces collected at each frame
+            utils::HCPSampler<float> sampler(2.1f * sphere_radius);
+            points = sampler.SampleBox(ChVector<>(0, 0, 26), ChVector<>(38, 38, 10));
+
+            gpu_sys.AddMesh(gpu::GetDataFile("meshes/testsuite/square_box.obj"), ChVector<float>(0),
+                            ChMatrix33<float>(ChVector<float>(40, 40, 40)), 1.0f);
+
+            mesh_pos = ChVector<>(0, 0, 0);
+            frame_callback = [&]() {
+                gpu_sys.ApplyMeshMotion(0, mesh_pos, mesh_rot, ChVector<>(0, 0, 0), ChVector<>(0, 0, 0));
+                gpu_sys.CollectMeshContactForces(0, mesh_force, mesh_torque);
+                m_bytes_h2d += mesh_motion_bytes;
+                m_bytes_d2h += 6 * sizeof(double);
+            };
+            break;
+        }
+    }
+
+    gpu_sys.SetParticles(points);
+    m_bytes_h2d += points.size() * sizeof(ChVector<float>);
+
+    // Finalize settings and initialize for runtime (device allocation and upload)
+    CudaEventTimer init_timer;
+    init_timer.start();
+    gpu_sys.Initialize();
+    addPhaseTime("initialize_device", init_timer.stop());
+
+    setup_timer.stop();
+
+    // Simulation loop
+    // ---------------
+
+    size_t num_particles = gpu_sys.GetNumParticles();
+    std::cout << "Number of particles: " << num_particles << std::endl;
+
+    PhaseTimer simulate_timer(*this, "simulate");
+
+    CudaEventTimer device_timer;
+    Series& frame_series = addSeries("frame_device_time (ms)");
+
+    ChTimer<double> timer;
+    timer.start();
+    int num_frames = 0;
+    for (double t = 0; t < m_duration; t += frame_step) {
+        if (frame_callback)
+            frame_callback();
+        device_timer.start();
+        gpu_sys.AdvanceSimulation(frame_step);
+        frame_series.push_back(1000 * device_timer.stop());
+        num_frames++;
+    }
+    timer.stop();
+
+    simulate_timer.stop();
+    addPhaseTime("advance_device", device_timer.GetTimeSeconds());
+
+    m_execTime = timer.GetTimeSeconds();
+
+    bool passed = CheckParticles(gpu_sys, box);
+    if (m_type == PYRAMID) {
+        // The top sphere must remain supported by the base spheres
+        passed &= gpu_sys.GetParticlePosition(3).z() > sphere_radius;
+    }
+
+    double num_steps = num_frames * std::round(frame_step / timestep);
+    double particle_steps = num_particles * num_steps;
+
+    addMetric("num_particles", static_cast<int>(num_particles));
+    addMetric("num_steps", num_steps);
+    addMetric("particle_steps_per_second", m_execTime > 0 ? particle_steps / m_execTime : 0.0);
+    addMetric("device_particle_steps_per_second",
+              device_timer.GetTimeSeconds() > 0 ? particle_steps / device_timer.GetTimeSeconds() : 0.0);
+    addMetric("device_time_fraction", m_execTime > 0 ? device_timer.GetTimeSeconds() / m_execTime : 0.0);
+    addMetric("bytes_host_to_device", m_bytes_h2d);
+    addMetric("bytes_device_to_host", m_bytes_d2h);
+    addMetric("bytes_per_frame", num_frames > 0 ? (double)(m_bytes_h2d + m_bytes_d2h) / num_frames : 0.0);
+
+    return passed;
+}
+
+// Tests run by this program (or by metrics_runner)
+TestRegistrar reg_ROTF("metrics_GPU_ROTF", "Chrono::Gpu", TestRegistry::MakeFactory<GPUTestsuiteTest>(ROTF, 1.0));
+TestRegistrar reg_PYRAMID("metrics_GPU_PYRAMID",
+                          "Chrono::Gpu",
+                          TestRegistry::MakeFactory<GPUTestsuiteTest>(PYRAMID, 1.0));
+TestRegistrar reg_MESH_STEP("metrics_GPU_MESH_STEP",
+                            "Chrono::Gpu",
+                            TestRegistry::MakeFactory<GPUTestsuiteTest>(MESH_STEP, 0.25));
+TestRegistrar reg_MESH_FORCE("metrics_GPU_MESH_FORCE",
+                             "Chrono::Gpu",
+                             TestRegistry::MakeFactory<GPUTestsuiteTest>(MESH_FORCE, 0.25));
+
+}  // end anonymous namespace
+
+#ifndef METRICS_RUNNER
+
+// =============================================================================
+// Main driver program
+// =============================================================================
+
+int main(int argc, char* argv[]) {
+    if (argc > 2) {
+        num_warmup = std::atoi(argv[1]);
+        num_runs = std::atoi(argv[2]);
+    }
+
+    std::string out_dir = "../METRICS";
+    if (!filesystem::create_directory(filesystem::path(out_dir))) {
+        std::cout << "Error creating directory " << out_dir << std::endl;
+        return 1;
+    }
+
+    bool passed = true;
+    for (const auto& entry : TestRegistry::Get().GetEntries()) {
+        auto test = entry.factory(entry.name, entry.project);
+        test->setOutDir(out_dir);
+        test->setVerbose(true);
+        test->setRepetitions(num_warmup, num_runs);
+        test->enableHardwareCounters(true);
+        test->setSeriesSidecarThreshold(1000);
+        passed &= test->run();
+        test->print();
+    }
+
+    return !passed;
+}
+
+#endif
@@ -0,0 +1,76 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Bulk contact report of a Chrono::Multicore system into ContactArrays (see
+// ContactArrays.h), copied in parallel from the rigid-rigid contact arrays of
+// the data manager (no per-contact callback).
+//
+// The contact forces are obtained from the contact impulses of an NSC system
+// (normal and, with SLIDING or SPINNING solver mode, tangential components in
+// the tangent basis used by the solver), divided by the step size. An SMC
+// system only keeps the resultant contact force on each body, so the force
+// arrays are set to zero.
+//
+// =============================================================================
+
+#ifndef CONTACT_ARRAYS_MULTICORE_H
+#define CONTACT_ARRAYS_MULTICORE_H
+
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+
+#include "../ContactArrays.h"
+
+/// Fill the arrays with all rigid-rigid contacts of the given system. Return the number of contacts.
+inline int FillContactArrays(chrono::ChSystemMulticore* system, ContactArrays& arrays) {
+    using namespace chrono;
+
+    auto data_manager = system->data_manager;
+    const auto& cd = *data_manager->cd_data;
+    const auto& gamma = data_manager->host_data.gamma;
+    const auto& bodies = system->Get_bodylist();
+    int num_contacts = (int)cd.num_rigid_contacts;
+    arrays.Resize(num_contacts);
+
+    bool nsc = system->GetContactMethod() == ChContactMethod::NSC && gamma.size() >= (size_t)num_contacts;
+    bool tangential = nsc && data_manager->settings.solver.solver_mode != SolverMode::NORMAL &&
+                      gamma.size() >= (size_t)(3 * num_contacts);
+    double inv_step = 1 / data_manager->settings.step_size;
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < num_contacts; i++) {
+        const real3& pA = cd.cpta_rigid_rigid[i];
+        const real3& pB = cd.cptb_rigid_rigid[i];
+        const real3& n = cd.norm_rigid_rigid[i];
+        arrays.pointA[i] = ChVector<>(pA.x, pA.y, pA.z);
+        arrays.pointB[i] = ChVector<>(pB.x, pB.y, pB.z);
+        arrays.normal[i] = ChVector<>(n.x, n.y, n.z);
+        arrays.distance[i] = cd.dpth_rigid_rigid[i];
+        arrays.objA[i] = bodies[cd.bids_rigid_rigid[i].x].get();
+        arrays.objB[i] = bodies[cd.bids_rigid_rigid[i].y].get();
+
+        // Layout of the impulses: normal [0, n), sliding [n, 3n)
+        real3 f(0);
+        if (nsc) {
+            f = gamma[i] * n;
+            if (tangential) {
+                real3 u, v;
+                Orthogonalize(n, u, v);
+                f += gamma[num_contacts + 2 * i] * u + gamma[num_contacts + 2 * i + 1] * v;
+            }
+        }
+        arrays.force[i] = inv_step * ChVector<>(f.x, f.y, f.z);
+    }
+
+    return num_contacts;
+}
+
+#endif
@@ -0,0 +1,352 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Micro-benchmark of the Chrono::Multicore narrowphase.
+//
+// Each supported pair of shapes (sphere, box, capsule, convex hull, and mesh
+// triangle) is tested in isolation, with the MPR algorithm and with the
+// analytic (R) algorithm where available (the HYBRID narrowphase uses the
+// analytic algorithm when it supports the pair, MPR otherwise). For each pair,
+// a large batch of randomized relative poses (about half of them in contact)
+// is generated once; the batch is then processed repeatedly by all threads and
+// the number of pairs tested per second per thread is reported, together with
+// the fraction of pairs found in contact (which must not change between runs).
+//
+// Generalizes the correctness checks of misc/multicore_tests/test_collision,
+// test_contact, and test_mesh into timings of each collision path.
+//
+// =============================================================================
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "chrono/ChConfig.h"
+#include "chrono/core/ChMathematics.h"
+#include "chrono/parallel/ChOpenMP.h"
+
+#include "chrono_multicore/collision/ChDataStructures.h"
+#include "chrono_multicore/collision/ChNarrowphaseMPR.h"
+#include "chrono_multicore/collision/ChNarrowphaseR.h"
+
+#include "chrono_thirdparty/filesystem/path.h"
+
+#include "../TestRegistry.h"
+
+using namespace chrono;
+using namespace chrono::collision;
+
+namespace {
+
+// ====================================================================================
+
+// Convex hull shape (the multicore custom shapes do not carry hull vertices).
+class ConvexShapeHull : public ConvexBase {
+  public:
+    ConvexShapeHull(const real3& pos, const quaternion& rot, const std::vector<real3>& points)
+        : position(pos), rotation(rot), vertices(points) {}
+    virtual int Type() const override { return ChCollisionShape::Type::CONVEX; }
+    virtual real3 A() const override { return position; }
+    virtual quaternion R() const override { return rotation; }
+    virtual int Size() const override { return (int)vertices.size(); }
+    virtual const real3* Convex() const override { return vertices.data(); }
+    virtual real Radius() const override { return 0; }
+
+    real3 position;
+    quaternion rotation;
+    std::vector<real3> vertices;
+};
+
+// Shape kinds in the benchmark.
+enum ShapeKind { SPHERE, BOX, CAPSULE, HULL, TRIANGLE };
+
+const char* GetKindName(ShapeKind kind) {
+    switch (kind) {
+        case SPHERE:
+            return "sphere";
+        case BOX:
+            return "box";
+        case CAPSULE:
+            return "capsule";
+        case HULL:
+            return "hull";
+        default:
+            return "triangle";
+    }
+}
+
+// Bounding radius of each shape kind (shapes have unit size).
+double GetBoundingRadius(ShapeKind kind) {
+    switch (kind) {
+        case SPHERE:
+            return 0.5;
+        case BOX:
+            return 0.5 * std::sqrt(3.0);
+        case CAPSULE:
+            return 0.75;
+        case HULL:
+            return 0.5;
+        default:
+            return 0.6;
+    }
+}
+
+// Random unit quaternion.
+quaternion RandomRotation(std::mt19937& rng) {
+    std::normal_distribution<double> n(0, 1);
+    double q[4] = {n(rng), n(rng), n(rng), n(rng)};
+    double len = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    return quaternion(q[0] / len, q[1] / len, q[2] / len, q[3] / len);
+}
+
+// Vertices of a convex hull (icosahedron of circumradius 0.5).
+std::vector<real3> HullVertices() {
+    double t = (1 + std::sqrt(5.0)) / 2;
+    double s = 0.5 / std::sqrt(1 + t * t);
+    std::vector<real3> v;
+    for (int i = -1; i <= 1; i += 2) {
+        for (int j = -1; j <= 1; j += 2) {
+            v.push_back(real3(0, i * s, j * t * s));
+            v.push_back(real3(i * s, j * t * s, 0));
+            v.push_back(real3(j * t * s, 0, i * s));
+        }
+    }
+    return v;
+}
+
+// Create a shape of given kind, with given pose.
+std::unique_ptr<ConvexBase> CreateShape(ShapeKind kind, const real3& pos, const quaternion& rot) {
+    switch (kind) {
+        case SPHERE:
+            return std::unique_ptr<ConvexBase>(
+                new ConvexShapeCustom(ChCollisionShape::Type::SPHERE, pos, rot, real3(0.5, 0, 0)));
+        case BOX:
+            return std::unique_ptr<ConvexBase>(
+                new ConvexShapeCustom(ChCollisionShape::Type::BOX, pos, rot, real3(0.5, 0.5, 0.5)));
+        case CAPSULE:
+            return std::unique_ptr<ConvexBase>(
+                new ConvexShapeCustom(ChCollisionShape::Type::CAPSULE, pos, rot, real3(0.25, 0.5, 0.25)));
+        case HULL:
+            return std::unique_ptr<ConvexBase>(new ConvexShapeHull(pos, rot, HullVertices()));
+        default: {
+            // Triangle vertices are expressed in the absolute frame
+            real3 v[3];
+            for (int k = 0; k < 3; k++) {
+                double a = 2 * CH_C_PI * k / 3;
+                v[k] = pos + Rotate(real3(0.6 * std::cos(a), 0.6 * std::sin(a), 0), rot);
+            }
+            return std::unique_ptr<ConvexBase>(new ConvexShapeTriangle(v[0], v[1], v[2]));
+        }
+    }
+}
+
+// ====================================================================================
+
+// Benchmark of all shape pairs, with given number of threads and batch size.
+class MCNarrowphaseTest : public BaseTest {
+  public:
+    MCNarrowphaseTest(const std::string& testName,
+                      const std::string& testProjectName,
+                      int num_threads,
+                      int batch_size = 1 << 16,
+                      double min_time = 0.2)
+        : BaseTest(testName, testProjectName),
+          m_num_threads(num_threads),
+          m_batch_size(batch_size),
+          m_min_time(min_time),
+          m_execTime(0) {}
+
+    virtual bool execute() override;
+    virtual double getExecutionTime() const override { return m_execTime; }
+
+  private:
+    struct Batch {
+        std::vector<std::unique_ptr<ConvexBase>> a;
+        std::vector<std::unique_ptr<ConvexBase>> b;
+    };
+
+    void CreateBatch(ShapeKind kindA, ShapeKind kindB, Batch& batch) const;
+    bool Time(const Batch& batch, bool use_mpr, double& rate, double& contact_fraction);
+
+    int m_num_threads;
+    int m_batch_size;
+    double m_min_time;  // minimum timed duration for each pair and algorithm
+    double m_execTime;
+};
+
+// Randomized relative poses: A at the origin, B at a random direction and distance (between 0.5 and 1.25 times the
+// sum of the bounding radii). A triangle is always the first shape, with B above or below its plane.
+void MCNarrowphaseTest::CreateBatch(ShapeKind kindA, ShapeKind kindB, Batch& batch) const {
+    std::mt19937 rng(12345 + 10 * kindA + kindB);
+    std::uniform_real_distribution<double> u(-1, 1);
+    std::uniform_real_distribution<double> f(0.5, 1.25);
+    double rA = GetBoundingRadius(kindA);
+    double rB = GetBoundingRadius(kindB);
+
+    batch.a.resize(m_batch_size);
+    batch.b.resize(m_batch_size);
+    for (int i = 0; i < m_batch_size; i++) {
+        quaternion rotA = RandomRotation(rng);
+        quaternion rotB = RandomRotation(rng);
+        real3 dir;
+        if (kindA == TRIANGLE) {
+            // Offset along the triangle normal, within the triangle footprint
+            real3 offset(0.3 * u(rng), 0.3 * u(rng), (u(rng) > 0 ? 1 : -1) * f(rng) * rB);
+            dir = Rotate(offset, rotA);
+        } else {
+            real3 d(u(rng), u(rng), u(rng));
+            while (Length2(d) < 1e-4 || Length2(d) > 1)
+                d = real3(u(rng), u(rng), u(rng));
+            dir = Normalize(d) * (f(rng) * (rA + rB));
+        }
+        batch.a[i] = CreateShape(kindA, real3(0, 0, 0), rotA);
+        batch.b[i] = CreateShape(kindB, dir, rotB);
+    }
+}
+
+// Process the batch repeatedly for at least the minimum time. Return false if the algorithm does not support the
+// pair (analytic algorithm only).
+bool MCNarrowphaseTest::Time(const Batch& batch, bool use_mpr, double& rate, double& contact_fraction) {
+    const real envelope = 0.01;
+    int n = m_batch_size;
+    std::vector<char> supported(n, 1);
+    std::vector<char> in_contact(n, 0);
+
+    auto process = [&](int i) {
+        const ConvexBase* a = batch.a[i].get();
+        const ConvexBase* b = batch.b[i].get();
+        if (use_mpr) {
+            real3 norm, ptA, ptB;
+            real depth;
+            in_contact[i] = MPRCollision(a, b, envelope, norm, ptA, ptB, depth) ? 1 : 0;
+        } else {
+            real3 norm[8], ptA[8], ptB[8];
+            real depth[8], eff_rad[8];
+            int nC = 0;
+            supported[i] = RCollision(a, b, 2 * envelope, norm, ptA, ptB, depth, eff_rad, nC) ? 1 : 0;
+            in_contact[i] = nC > 0 ? 1 : 0;
+        }
+    };
+
+    // Check support on the first pair
+    process(0);
+    if (!supported[0])
+        return false;
+
+    int reps = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    while (elapsed < m_min_time) {
+#pragma omp parallel for schedule(static) num_threads(m_num_threads)
+        for (int i = 0; i < n; i++)
+            process(i);
+        reps++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    rate = ((double)n * reps) / (elapsed * m_num_threads);
+    contact_fraction = (double)std::count(in_contact.begin(), in_contact.end(), 1) / n;
+    return true;
+}
+
+bool MCNarrowphaseTest::execute() {
+    std::cout << "Test: " << getTestName() << "  (" << m_num_threads << " threads, " << m_batch_size
+              << " pairs per batch)" << std::endl;
+
+    const std::vector<std::pair<ShapeKind, ShapeKind>> pairs = {
+        {SPHERE, SPHERE},  {SPHERE, BOX},    {SPHERE, CAPSULE}, {BOX, BOX},
+        {BOX, CAPSULE},    {CAPSULE, CAPSULE}, {HULL, SPHERE},  {HULL, BOX},
+        {HULL, HULL},      {TRIANGLE, SPHERE}, {TRIANGLE, BOX}, {TRIANGLE, CAPSULE}};
+
+    auto start = std::chrono::steady_clock::now();
+
+    printf("\n%-18s %-6s %18s %10s\n", "pair", "algo", "pairs/s/thread", "contact");
+    for (const auto& pair : pairs) {
+        std::string name = std::string(GetKindName(pair.first)) + "_" + GetKindName(pair.second);
+
+        Batch batch;
+        CreateBatch(pair.first, pair.second, batch);
+
+        for (int algo = 0; algo < 2; algo++) {
+            bool use_mpr = (algo == 0);
+            const char* algo_name = use_mpr ? "mpr" : "r";
+            double rate = 0;
+            double contact_fraction = 0;
+            PhaseTimer timer(*this, name + "_" + algo_name);
+            bool supported = Time(batch, use_mpr, rate, contact_fraction);
+            timer.stop();
+            if (!supported)
+                continue;
+            printf("%-18s %-6s %18.4g %10.3f\n", name.c_str(), algo_name, rate, contact_fraction);
+            addMetric(name + "_" + algo_name + "_pairs_per_second_per_thread", rate);
+            addMetric(name + "_" + algo_name + "_contact_fraction", contact_fraction);
+        }
+    }
+
+    m_execTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    addMetric("num_threads", m_num_threads);
+    addMetric("batch_size", m_batch_size);
+
+    return true;
+}
+
+// Tests run by this program (or by metrics_runner)
+TestRegistrar reg_1("metrics_MCORE_narrowphase_1",
+                    "Chrono::Multicore",
+                    TestRegistry::MakeFactory<MCNarrowphaseTest>(1));
+TestRegistrar reg_4("metrics_MCORE_narrowphase_4",
+                    "Chrono::Multicore",
+                    TestRegistry::MakeFactory<MCNarrowphaseTest>(4));
+
+}  // end anonymous namespace
+
+#ifndef METRICS_RUNNER
+
+// ====================================================================================
+
+int main(int argc, char** argv) {
+    // Usage: metrics_MCORE_narrowphase [num_threads [batch_size]]
+    // By default, run the registered tests (1 and 4 threads).
+    std::string out_dir = "../METRICS";
+    if (!filesystem::create_directory(filesystem::path(out_dir))) {
+        std::cout << "Error creating directory " << out_dir << std::endl;
+        return 1;
+    }
+
+    bool passed = true;
+    if (argc > 1) {
+        int num_threads = std::min(std::stoi(argv[1]), ChOMP::GetNumProcs());
+        int batch_size = argc > 2 ? std::stoi(argv[2]) : 1 << 16;
+        MCNarrowphaseTest test("metrics_MCORE_narrowphase_" + std::to_string(num_threads), "Chrono::Multicore",
+                               num_threads, batch_size);
+        test.setOutDir(out_dir);
+        passed &= test.run();
+        test.print();
+        return passed ? 0 : 1;
+    }
+
+    for (const auto& entry : TestRegistry::Get().GetEntries()) {
+        auto test = entry.factory(entry.name, entry.project);
+        test->setOutDir(out_dir);
+        passed &= test->run();
+        test->print();
+    }
+
+    return passed ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,395 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Strong and weak thread scaling of Chrono::Multicore granular dynamics.
+//
+// A bed of spheres, initially on a regular lattice (1 particle diameter apart)
+// in a box with fixed width and number of layers, is dropped and simulated for
+// a fixed number of steps; the length of the box follows the number of
+// particles. After a number of unrecorded steps (to let contacts develop), the
+// step, broad phase, narrow phase, update, and solve times are accumulated.
+//
+//   - strong scaling: fixed number of particles, 1, 2, 4, ... threads
+//   - weak scaling:   number of particles proportional to the number of threads
+//
+// For each contact method (SMC and NSC), the scaling tests report, at each
+// thread count, the time per step of each phase, the contacts processed per
+// second (contacts per step / step time), and the speedup (strong scaling) or
+// efficiency (weak scaling, ideal time per step constant) relative to the
+// smallest thread count. Each run writes its own output file
+// (<test name>_<threads>t.json).
+//
+// Generalizes the chrono_parallel test misc/multicore_tests/test_scaling.
+//
+// The global reference frame has Z up. All units SI.
+//
+// =============================================================================
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "chrono/ChConfig.h"
+#include "chrono/parallel/ChOpenMP.h"
+#include "chrono/utils/ChUtilsCreators.h"
+
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+#include "chrono_multicore/solver/ChIterativeSolverMulticore.h"
+
+#include "chrono_thirdparty/filesystem/path.h"
+
+#include "../TestRegistry.h"
+
+using namespace chrono;
+
+namespace {
+
+// Phases timed by each run
+const std::vector<std::string>& GetPhases() {
+    static const std::vector<std::string> phases = {"step", "broad", "narrow", "update", "solve"};
+    return phases;
+}
+
+// ====================================================================================
+
+// Single run: given contact method, number of threads, and number of particles.
+class MCScalingRun : public BaseTest {
+  public:
+    MCScalingRun(const std::string& testName,
+                 const std::string& testProjectName,
+                 ChContactMethod method,
+                 int num_threads,
+                 int num_particles)
+        : BaseTest(testName, testProjectName),
+          m_method(method),
+          m_num_threads(num_threads),
+          m_num_particles(num_particles),
+          m_num_steps(200),
+          m_num_skip(100),
+          m_execTime(0),
+          m_contacts(0) {}
+
+    virtual bool execute() override;
+    virtual double getExecutionTime() const override { return m_execTime; }
+
+    int getNumSteps() const { return m_num_steps; }
+    int getNumParticles() const { return m_num_particles; }
+
+    /// Average number of contacts per recorded step.
+    double getAverageContacts() const { return m_contacts; }
+
+  private:
+    ChContactMethod m_method;
+    int m_num_threads;
+    int m_num_particles;
+    int m_num_steps;  // recorded steps
+    int m_num_skip;   // unrecorded steps (before the recorded ones)
+    double m_execTime;
+    double m_contacts;
+};
+
+bool MCScalingRun::execute() {
+    std::cout << "Test: " << getTestName() << "  (" << m_num_particles << " particles, " << m_num_threads
+              << " threads)" << std::endl;
+
+    PhaseTimer setup_timer(*this, "setup");
+
+    // Lattice of particles: fixed width and number of layers, length following the number of particles
+    double radius = 0.05;
+    double rho = 2500;
+    double spacing = 4 * radius;
+    int ny = 10;
+    int nz = 5;
+    int nx = (m_num_particles + ny * nz - 1) / (ny * nz);
+    double hdimX = nx * spacing / 2;
+    double hdimY = ny * spacing / 2;
+    double hdimZ = (nz + 1) * spacing;
+    double hthick = 0.1;
+
+    // Create system and set method-specific solver settings
+    ChSystemMulticore* system;
+    double time_step;
+    std::shared_ptr<ChMaterialSurface> material;
+
+    switch (m_method) {
+        case ChContactMethod::SMC: {
+            time_step = 1e-4;
+            ChSystemMulticoreSMC* sys = new ChSystemMulticoreSMC;
+            sys->GetSettings()->solver.contact_force_model = ChSystemSMC::Hertz;
+            sys->GetSettings()->solver.tangential_displ_mode = ChSystemSMC::TangentialDisplacementModel::OneStep;
+            system = sys;
+
+            auto mat = chrono_types::make_shared<ChMaterialSurfaceSMC>();
+            mat->SetYoungModulus(2e6f);
+            mat->SetFriction(0.4f);
+            mat->SetRestitution(0.1f);
+            material = mat;
+
+            break;
+        }
+        case ChContactMethod::NSC: {
+            time_step = 1e-3;
+            ChSystemMulticoreNSC* sys = new ChSystemMulticoreNSC;
+            sys->GetSettings()->solver.solver_mode = SolverMode::SLIDING;
+            sys->GetSettings()->solver.max_iteration_normal = 0;
+            sys->GetSettings()->solver.max_iteration_sliding = 50;
+            sys->GetSettings()->solver.max_iteration_spinning = 0;
+            sys->GetSettings()->solver.alpha = 0;
+            sys->GetSettings()->solver.contact_recovery_speed = 0.1;
+            sys->GetSettings()->collision.collision_envelope = 0.05 * radius;
+            sys->ChangeSolverType(SolverType::APGD);
+            system = sys;
+
+            auto mat = chrono_types::make_shared<ChMaterialSurfaceNSC>();
+            mat->SetFriction(0.4f);
+            material = mat;
+
+            break;
+        }
+    }
+
+    system->Set_G_acc(ChVector<>(0, 0, -9.81));
+    system->GetSettings()->solver.use_full_inertia_tensor = false;
+    system->GetSettings()->solver.tolerance = 1e-3;
+    system->GetSettings()->collision.narrowphase_algorithm = collision::ChNarrowphase::Algorithm::HYBRID;
+    system->GetSettings()->collision.bins_per_axis = vec3(std::max(nx / 2, 1), std::max(ny / 2, 1), nz);
+    system->SetNumThreads(m_num_threads);
+
+    // Container
+    utils::CreateBoxContainer(system, -1, material, ChVector<>(hdimX, hdimY, hdimZ), hthick);
+
+    // Particles
+    double mass = rho * (4.0 / 3) * CH_C_PI * radius * radius * radius;
+    ChVector<> inertia = 0.4 * mass * radius * radius * ChVector<>(1, 1, 1);
+    int count = 0;
+    for (int iz = 0; iz < nz && count < m_num_particles; iz++) {
+        for (int ix = 0; ix < nx && count < m_num_particles; ix++) {
+            for (int iy = 0; iy < ny && count < m_num_particles; iy++) {
+                // Alternate offsets between layers, so that the particles do not stack vertically
+                double offset = (iz % 2) * spacing / 4;
+                ChVector<> pos(-hdimX + (ix + 0.5) * spacing + offset, -hdimY + (iy + 0.5) * spacing + offset,
+                               (iz + 1) * spacing);
+
+                auto body = std::shared_ptr<ChBody>(system->NewBody());
+                body->SetIdentifier(count++);
+                body->SetMass(mass);
+                body->SetInertiaXX(inertia);
+                body->SetPos(pos);
+                body->SetCollide(true);
+                body->GetCollisionModel()->ClearModel();
+                utils::AddSphereGeometry(body.get(), material, radius);
+                body->GetCollisionModel()->BuildModel();
+                system->AddBody(body);
+            }
+        }
+    }
+
+    setup_timer.stop();
+
+    // Simulate (recording phase times only after the initial steps)
+    PhaseTimer simulate_timer(*this, "simulate");
+
+    double times[5] = {0, 0, 0, 0, 0};
+    double contacts = 0;
+    Series& step_series = addSeries("step_time (ms)");
+    Series& contacts_series = addSeries("number_contacts");
+    for (int i = 0; i < m_num_skip + m_num_steps; i++) {
+        system->DoStepDynamics(time_step);
+        if (i < m_num_skip)
+            continue;
+        times[0] += system->GetTimerStep();
+        times[1] += system->GetTimerCollisionBroad();
+        times[2] += system->GetTimerCollisionNarrow();
+        times[3] += system->GetTimerUpdate();
+        times[4] += system->GetTimerAdvance();
+        contacts += system->GetNcontacts();
+        step_series.push_back(1000 * system->GetTimerStep());
+        contacts_series.push_back(system->GetNcontacts());
+    }
+
+    simulate_timer.stop();
+
+    for (size_t i = 0; i < GetPhases().size(); i++)
+        addPhaseTime(GetPhases()[i], times[i]);
+
+    m_execTime = times[0];
+    m_contacts = contacts / m_num_steps;
+    addMetric("num_threads", m_num_threads);
+    addMetric("num_particles", m_num_particles);
+    addMetric("avg_contacts", m_contacts);
+    addMetric("avg_step_time (ms)", 1000 * times[0] / m_num_steps);
+    addMetric("contacts_per_second", times[0] > 0 ? contacts / times[0] : 0.0);
+
+    delete system;
+    return true;
+}
+
+// ====================================================================================
+
+// Scaling test: runs MCScalingRun for each thread count, with a fixed number of particles (strong scaling) or with
+// a number of particles proportional to the number of threads (weak scaling). The repetitions set on the scaling test
+// apply to each run (the scaling test itself is executed once).
+class MCScalingTest : public BaseTest {
+  public:
+    MCScalingTest(const std::string& testName,
+                  const std::string& testProjectName,
+                  ChContactMethod method,
+                  bool weak,
+                  int num_particles)
+        : BaseTest(testName, testProjectName),
+          m_method(method),
+          m_weak(weak),
+          m_num_particles(num_particles),
+          m_execTime(0),
+          m_numWarmup(0),
+          m_numRuns(1) {
+        int num_procs = ChOMP::GetNumProcs();
+        for (int n = 1; n < num_procs; n *= 2)
+            m_threads.push_back(n);
+        m_threads.push_back(num_procs);
+    }
+
+    virtual void setRepetitions(int num_warmup, int num_runs) override {
+        m_numWarmup = num_warmup;
+        m_numRuns = num_runs;
+    }
+
+    virtual bool execute() override;
+    virtual double getExecutionTime() const override { return m_execTime; }
+
+  private:
+    ChContactMethod m_method;
+    bool m_weak;          // weak scaling (particles proportional to threads)?
+    int m_num_particles;  // number of particles (strong) or particles per thread (weak)
+    std::vector<int> m_threads;
+    double m_execTime;
+    int m_numWarmup;  // warm-up executions of each run
+    int m_numRuns;    // measured executions of each run
+};
+
+bool MCScalingTest::execute() {
+    bool passed = true;
+    m_execTime = 0;
+
+    std::vector<double> threads;
+    std::vector<double> particles;
+    std::vector<double> contacts_per_second;
+    std::vector<std::vector<double>> step_times(GetPhases().size());
+    for (auto n : m_threads) {
+        int num_particles = m_weak ? n * m_num_particles : m_num_particles;
+        MCScalingRun run(getTestName() + "_" + std::to_string(n) + "t", getProjectName(), m_method, n, num_particles);
+        run.setOutDir(getOutDir());
+        run.setSeriesSidecarThreshold(1000);
+        run.setRepetitions(m_numWarmup, m_numRuns);
+        passed &= run.run();
+        m_execTime += run.getExecutionTime();
+
+        threads.push_back(n);
+        particles.push_back(num_particles);
+        double step_time = run.getPhaseTime("step") / run.getNumSteps();
+        contacts_per_second.push_back(step_time > 0 ? run.getAverageContacts() / step_time : 0);
+        for (size_t i = 0; i < GetPhases().size(); i++)
+            step_times[i].push_back(run.getPhaseTime(GetPhases()[i]) / run.getNumSteps());
+    }
+
+    // Speedup (strong) or efficiency (weak) relative to the smallest thread count
+    printf("\n%-8s %-10s %12s", "threads", "particles", "contacts/s");
+    for (const auto& phase : GetPhases())
+        printf(" | %8s %7s", phase.c_str(), m_weak ? "eff." : "speedup");
+    printf("\n");
+    std::vector<std::vector<double>> ratio(GetPhases().size());
+    for (size_t it = 0; it < threads.size(); it++) {
+        printf("%-8d %-10d %12.4g", (int)threads[it], (int)particles[it], contacts_per_second[it]);
+        for (size_t ip = 0; ip < GetPhases().size(); ip++) {
+            double t0 = step_times[ip][0];
+            double t = step_times[ip][it];
+            double r = (t > 0) ? t0 / t : 0;
+            ratio[ip].push_back(r);
+            printf(" | %8.5f %7.2f", t, r);
+        }
+        printf("\n");
+    }
+
+    addMetric("num_threads", threads);
+    addMetric("num_particles", particles);
+    addMetric("contacts_per_second", contacts_per_second);
+    for (size_t ip = 0; ip < GetPhases().size(); ip++) {
+        addMetric(GetPhases()[ip] + "_time_per_step", step_times[ip]);
+        addMetric(GetPhases()[ip] + (m_weak ? "_efficiency" : "_speedup"), ratio[ip]);
+    }
+
+    return passed;
+}
+
+// Tests run by this program (or by metrics_runner)
+TestRegistrar reg_strong_SMC("metrics_MCORE_scaling_strong_SMC",
+                             "Chrono::Multicore",
+                             TestRegistry::MakeFactory<MCScalingTest>(ChContactMethod::SMC, false, 16000));
+TestRegistrar reg_strong_NSC("metrics_MCORE_scaling_strong_NSC",
+                             "Chrono::Multicore",
+                             TestRegistry::MakeFactory<MCScalingTest>(ChContactMethod::NSC, false, 16000));
+TestRegistrar reg_weak_SMC("metrics_MCORE_scaling_weak_SMC",
+                           "Chrono::Multicore",
+                           TestRegistry::MakeFactory<MCScalingTest>(ChContactMethod::SMC, true, 4000));
+TestRegistrar reg_weak_NSC("metrics_MCORE_scaling_weak_NSC",
+                           "Chrono::Multicore",
+                           TestRegistry::MakeFactory<MCScalingTest>(ChContactMethod::NSC, true, 4000));
+
+}  // end anonymous namespace
+
+#ifndef METRICS_RUNNER
+
+// ====================================================================================
+
+int main(int argc, char** argv) {
+    // Usage: metrics_MCORE_scaling [strong|weak] [SMC|NSC] [num_warmup num_runs]
+    // By default, run strong and weak scaling for both contact methods.
+    std::vector<std::string> patterns;
+    std::vector<int> numbers;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (!arg.empty() && std::isdigit((unsigned char)arg[0]))
+            numbers.push_back(std::stoi(arg));
+        else
+            patterns.push_back(arg);
+    }
+    int num_warmup = numbers.size() > 1 ? numbers[0] : 0;
+    int num_runs = numbers.size() > 1 ? numbers[1] : 1;
+
+    std::string out_dir = "../METRICS";
+    if (!filesystem::create_directory(filesystem::path(out_dir))) {
+        std::cout << "Error creating directory " << out_dir << std::endl;
+        return 1;
+    }
+
+    bool passed = true;
+    for (const auto& entry : TestRegistry::Get().GetEntries()) {
+        bool selected = std::all_of(patterns.begin(), patterns.end(), [&entry](const std::string& p) {
+            return entry.name.find("_" + p) != std::string::npos;
+        });
+        if (!selected)
+            continue;
+        auto test = entry.factory(entry.name, entry.project);
+        test->setOutDir(out_dir);
+        test->setRepetitions(num_warmup, num_runs);
+        passed &= test->run();
+        test->print();
+    }
+
+    return passed ? 0 : 1;
+}
+
+#endif
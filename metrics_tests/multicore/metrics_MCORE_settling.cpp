@@ -29,6 +29,7 @@
 
 #include "chrono/ChConfig.h"
 #include "chrono/core/ChTimer.h"
+#include "chrono/parallel/ChOpenMP.h"
 #include "chrono/utils/ChUtilsCreators.h"
 #include "chrono/utils/ChUtilsGenerators.h"
 #include "chrono/utils/ChUtilsInputOutput.h"
@@ -42,47 +43,12 @@
 #include "chrono_opengl/ChOpenGLWindow.h"
 #endif
 
-#include "../BaseTest.h"
+#include "../TestRegistry.h"
+#include "ContactArraysMulticore.h"
 
 using namespace chrono;
 
-// --------------------------------------------------------------------------
-
-void TimingHeader() {
-    printf("    TIME    |");
-    printf("    STEP |");
-    printf("   BROAD |");
-    printf("  NARROW |");
-    printf("  SOLVER |");
-    printf("  UPDATE |");
-    printf("# BODIES |");
-    printf("# CONTACT|");
-    printf(" # ITERS |");
-    printf("   RESID |");
-    printf("\n\n");
-}
-
-void TimingOutput(chrono::ChSystem* mSys) {
-    double TIME = mSys->GetChTime();
-    double STEP = mSys->GetTimerStep();
-    double BROD = mSys->GetTimerCollisionBroad();
-    double NARR = mSys->GetTimerCollisionNarrow();
-    double SOLVER = mSys->GetTimerAdvance();
-    double UPDT = mSys->GetTimerUpdate();
-    double RESID = 0;
-    int REQ_ITS = 0;
-    int BODS = mSys->GetNbodies();
-    int CNTC = mSys->GetNcontacts();
-    if (chrono::ChSystemMulticore* mc_sys = dynamic_cast<chrono::ChSystemMulticore*>(mSys)) {
-        RESID = std::static_pointer_cast<chrono::ChIterativeSolverMulticore>(mSys->GetSolver())->GetResidual();
-        REQ_ITS = std::static_pointer_cast<chrono::ChIterativeSolverMulticore>(mSys->GetSolver())->GetIterations();
-        BODS = mc_sys->GetNbodies();
-        CNTC = mc_sys->GetNcontacts();
-    }
-
-    printf("   %8.5f | %7.4f | %7.4f | %7.4f | %7.4f | %7.4f | %7d | %7d | %7d | %7.4f |\n", TIME, STEP, BROD, NARR,
-           SOLVER, UPDT, BODS, CNTC, REQ_ITS, RESID);
-}
+namespace {
 
 // ====================================================================================
 
@@ -109,6 +75,74 @@ class PARSettlingTest : public BaseTest {
 
 // ====================================================================================
 
+// Summary of a thread-scaling sweep.
+// Reports, for each phase timed by PARSettlingTest, the speedup and parallel efficiency at each thread count,
+// relative to the run with the smallest number of threads.
+class PARScalingSummary : public BaseTest {
+  public:
+    PARScalingSummary(const std::string& testName,
+                      const std::string& testProjectName,
+                      const std::vector<int>& threads,
+                      const std::vector<std::vector<double>>& phase_times)
+        : BaseTest(testName, testProjectName), m_threads(threads), m_phase_times(phase_times), m_execTime(0) {}
+
+    static const std::vector<std::string>& GetPhases() {
+        static const std::vector<std::string> phases = {"step", "broad", "narrow", "update", "solve"};
+        return phases;
+    }
+
+    virtual bool execute() override;
+    virtual double getExecutionTime() const override { return m_execTime; }
+
+  private:
+    std::vector<int> m_threads;                     // thread counts
+    std::vector<std::vector<double>> m_phase_times;  // phase times, for each thread count
+    double m_execTime;
+};
+
+bool PARScalingSummary::execute() {
+    std::vector<double> threads(m_threads.begin(), m_threads.end());
+    addMetric("threads", threads);
+
+    printf("\n%-8s", "threads");
+    for (const auto& phase : GetPhases())
+        printf(" | %8s speedup  eff.", phase.c_str());
+    printf("\n");
+
+    std::vector<std::vector<double>> speedup(GetPhases().size());
+    std::vector<std::vector<double>> efficiency(GetPhases().size());
+    for (size_t it = 0; it < m_threads.size(); it++) {
+        printf("%-8d", m_threads[it]);
+        for (size_t ip = 0; ip < GetPhases().size(); ip++) {
+            double t0 = m_phase_times[0][ip];
+            double t = m_phase_times[it][ip];
+            double s = (t > 0) ? t0 / t : 0;
+            double e = s * m_threads[0] / m_threads[it];
+            speedup[ip].push_back(s);
+            efficiency[ip].push_back(e);
+            printf(" | %8.4f %7.2f %5.2f", t, s, e);
+        }
+        printf("\n");
+    }
+
+    for (size_t ip = 0; ip < GetPhases().size(); ip++) {
+        std::vector<double> times;
+        for (size_t it = 0; it < m_threads.size(); it++)
+            times.push_back(m_phase_times[it][ip]);
+        addMetric("time_" + GetPhases()[ip], times);
+        addMetric("speedup_" + GetPhases()[ip], speedup[ip]);
+        addMetric("efficiency_" + GetPhases()[ip], efficiency[ip]);
+    }
+
+    m_execTime = 0;
+    for (size_t it = 0; it < m_threads.size(); it++)
+        m_execTime += m_phase_times[it][0];
+
+    return true;
+}
+
+// ====================================================================================
+
 bool PARSettlingTest::execute() {
     bool use_mat_properties = true;
     bool render = false;
@@ -116,6 +150,8 @@ bool PARSettlingTest::execute() {
     std::cout << "Test: " << getTestName() << std::endl;
     std::cout << "Requested number of threads: " << m_num_threads << std::endl;
 
+    PhaseTimer setup_timer(*this, "setup");
+
     // ----------------
     // Model parameters
     // ----------------
@@ -302,10 +338,14 @@ bool PARSettlingTest::execute() {
     }
 #endif
 
+    setup_timer.stop();
+
     // ---------------
     // Simulate system
     // ---------------
 
+    PhaseTimer settle_timer(*this, "settle");
+
     double sim_time = 0;
     double broad_time = 0;
     double narrow_time = 0;
@@ -313,10 +353,18 @@ bool PARSettlingTest::execute() {
     double solve_time = 0;
     int num_steps = 0;
 
-    ////TimingHeader();
+    // Per-step series
+    Series& step_series = addSeries("step_time (ms)");
+    Series& contacts_series = addSeries("number_contacts");
+    Series& iterations_series = addSeries("solver_iterations");
+    Series* allocs_series = MemoryStats::CountingAllocations() ? &addSeries("allocations") : nullptr;
+    auto solver = std::static_pointer_cast<ChIterativeSolverMulticore>(system->GetSolver());
+
     double time_end = 0.5;
     while (system->GetChTime() < time_end) {
+        uint64_t num_allocs = MemoryStats::GetAllocationCount();
         system->DoStepDynamics(time_step);
+        num_allocs = MemoryStats::GetAllocationCount() - num_allocs;
 
         sim_time += system->GetTimerStep();
         broad_time += system->GetTimerCollisionBroad();
@@ -325,7 +373,11 @@ bool PARSettlingTest::execute() {
         solve_time += system->GetTimerAdvance();
         num_steps++;
 
-        ////TimingOutput(system);
+        step_series.push_back(1000 * system->GetTimerStep());
+        contacts_series.push_back(system->GetNcontacts());
+        iterations_series.push_back(solver->GetIterations());
+        if (allocs_series)
+            allocs_series->push_back(static_cast<double>(num_allocs));
 
 #ifdef CHRONO_OPENGL
         if (render) {
@@ -339,9 +391,19 @@ bool PARSettlingTest::execute() {
 #endif
     }
 
+    settle_timer.stop();
+
     system->CalculateContactForces();
     real3 cforce = system->GetBodyContactForce(container);
     int ncontacts = system->GetNcontacts();
+
+    // Bulk report of the contacts at the end of the settling
+    ContactArrays contacts;
+    ChTimer<double> report_timer;
+    report_timer.start();
+    FillContactArrays(system, contacts);
+    report_timer.stop();
+
     std::cout << "Number of contacts:         " << ncontacts << std::endl;
     std::cout << "Contact force on container: " << cforce.x << "  " << cforce.y << "  " << cforce.z << std::endl;
     std::cout << "Total simulation time: " << sim_time << std::endl;
@@ -352,6 +414,7 @@ bool PARSettlingTest::execute() {
 
     m_execTime = sim_time;
     addMetric("number_contacts", ncontacts);
+    addMetric("contact_report_time (ms)", 1000 * report_timer.GetTimeSeconds());
     addMetric("vertical_force", cforce.z);
     addMetric("avg_sim_time_per_step (ms)", 1000 * sim_time / num_steps);
     addMetric("avg_broad_time_per_step (ms)", 1000 * broad_time / num_steps);
@@ -359,10 +422,89 @@ bool PARSettlingTest::execute() {
     addMetric("avg_update_time_per_step (ms)", 1000 * update_time / num_steps);
     addMetric("avg_solve_time_per_step (ms)", 1000 * solve_time / num_steps);
 
+    // Throughput and memory per particle (same metrics as metrics_GPU_milsettle)
+    addMetric("num_particles", static_cast<int>(num_particles));
+    addMetric("particle_steps_per_second", sim_time > 0 ? (double)num_particles * num_steps / sim_time : 0.0);
+    addMetric("host_bytes_per_particle", (double)MemoryStats::GetPeakRSS() / num_particles);
+
+    addPhaseTime("step", sim_time);
+    addPhaseTime("broad", broad_time);
+    addPhaseTime("narrow", narrow_time);
+    addPhaseTime("update", update_time);
+    addPhaseTime("solve", solve_time);
+
+    delete system;
     return true;
 }
 
+// Tests run by this program (or by metrics_runner)
+TestRegistrar reg_DEM2("metrics_PAR_settling_DEM_2",
+                       "Chrono::Multicore",
+                       TestRegistry::MakeFactory<PARSettlingTest>(ChContactMethod::SMC, 2));
+TestRegistrar reg_DEM4("metrics_PAR_settling_DEM_4",
+                       "Chrono::Multicore",
+                       TestRegistry::MakeFactory<PARSettlingTest>(ChContactMethod::SMC, 4));
+TestRegistrar reg_DVI2("metrics_PAR_settling_DVI_2",
+                       "Chrono::Multicore",
+                       TestRegistry::MakeFactory<PARSettlingTest>(ChContactMethod::NSC, 2));
+TestRegistrar reg_DVI4("metrics_PAR_settling_DVI_4",
+                       "Chrono::Multicore",
+                       TestRegistry::MakeFactory<PARSettlingTest>(ChContactMethod::NSC, 4));
+
+}  // end anonymous namespace
+
+#ifndef METRICS_RUNNER
+
+// Run the settling test at 1, 2, 4, ... threads (up to the number of processors) and report the scaling of each
+// phase for the specified contact method.
+bool RunThreadSweep(ChContactMethod method, const std::string& out_dir, int num_warmup, int num_runs) {
+    std::string prefix = (method == ChContactMethod::SMC) ? "metrics_PAR_settling_DEM" : "metrics_PAR_settling_DVI";
+
+    std::vector<int> threads;
+    int num_procs = ChOMP::GetNumProcs();
+    for (int n = 1; n < num_procs; n *= 2)
+        threads.push_back(n);
+    threads.push_back(num_procs);
+
+    bool passed = true;
+    std::vector<std::vector<double>> phase_times;
+    for (auto n : threads) {
+        PARSettlingTest test(prefix + "_" + std::to_string(n), "Chrono::Multicore", method, n);
+        test.setOutDir(out_dir);
+        test.setRepetitions(num_warmup, num_runs);
+        test.setSeriesSidecarThreshold(1000);
+        passed &= test.run();
+
+        std::vector<double> times;
+        for (const auto& phase : PARScalingSummary::GetPhases())
+            times.push_back(test.getPhaseTime(phase));
+        phase_times.push_back(times);
+    }
+
+    PARScalingSummary summary(prefix + "_scaling", "Chrono::Multicore", threads, phase_times);
+    summary.setOutDir(out_dir);
+    passed &= summary.run();
+    summary.print();
+
+    return passed;
+}
+
+// ====================================================================================
+
 int main(int argc, char** argv) {
+    // Usage: metrics_MCORE_settling [--sweep] [num_warmup num_runs]
+    // With --sweep, run a thread-scaling sweep for both contact methods.
+    bool sweep = (argc > 1 && std::string(argv[1]) == "--sweep");
+    int arg0 = sweep ? 2 : 1;
+
+    // Number of warm-up and measured runs for each test
+    int num_warmup = 0;
+    int num_runs = 1;
+    if (argc > arg0 + 1) {
+        num_warmup = std::stoi(argv[arg0]);
+        num_runs = std::stoi(argv[arg0 + 1]);
+    }
+
     std::string out_dir = "../METRICS";
     if (!filesystem::create_directory(filesystem::path(out_dir))) {
         std::cout << "Error creating directory " << out_dir << std::endl;
@@ -371,30 +513,49 @@ int main(int argc, char** argv) {
 
     bool passed = true;
 
+    if (sweep) {
+        passed &= RunThreadSweep(ChContactMethod::SMC, out_dir, num_warmup, num_runs);
+        passed &= RunThreadSweep(ChContactMethod::NSC, out_dir, num_warmup, num_runs);
+        return passed ? 0 : 1;
+    }
     PARSettlingTest testDEM2("metrics_PAR_settling_DEM_2", "Chrono::Multicore", ChContactMethod::SMC, 2);
     PARSettlingTest testDEM4("metrics_PAR_settling_DEM_4", "Chrono::Multicore", ChContactMethod::SMC, 4);
     PARSettlingTest testDVI2("metrics_PAR_settling_DVI_2", "Chrono::Multicore", ChContactMethod::NSC, 2);
     PARSettlingTest testDVI4("metrics_PAR_settling_DVI_4", "Chrono::Multicore", ChContactMethod::NSC, 4);
 
     testDEM2.setOutDir(out_dir);
+    testDEM2.setRepetitions(num_warmup, num_runs);
+    testDEM2.enableHardwareCounters(true);
+    testDEM2.setSeriesSidecarThreshold(1000);
     testDEM2.setVerbose(true);
     passed &= testDEM2.run();
     testDEM2.print();
 
     testDEM4.setOutDir(out_dir);
+    testDEM4.setRepetitions(num_warmup, num_runs);
+    testDEM4.enableHardwareCounters(true);
+    testDEM4.setSeriesSidecarThreshold(1000);
     testDEM4.setVerbose(true);
     passed &= testDEM4.run();
     testDEM4.print();
 
     testDVI2.setOutDir(out_dir);
+    testDVI2.setRepetitions(num_warmup, num_runs);
+    testDVI2.enableHardwareCounters(true);
+    testDVI2.setSeriesSidecarThreshold(1000);
     testDVI2.setVerbose(true);
     passed &= testDVI2.run();
     testDVI2.print();
 
     testDVI4.setOutDir(out_dir);
+    testDVI4.setRepetitions(num_warmup, num_runs);
+    testDVI4.enableHardwareCounters(true);
+    testDVI4.setSeriesSidecarThreshold(1000);
     testDVI4.setVerbose(true);
     passed &= testDVI4.run();
     testDVI4.print();
 
-    return 0;
+    return passed ? 0 : 1;
 }
+
+#endif
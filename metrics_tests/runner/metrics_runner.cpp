@@ -0,0 +1,265 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Run any subset of the registered metrics tests in a single process.
+//
+// Usage:
+//   metrics_runner [options] [pattern ...]
+//
+// Only tests whose name contains one of the given patterns are run (all tests
+// if no pattern is given). Options:
+//   --list                      list the selected tests and exit
+//   --project <name>            select tests of projects containing <name> (may be repeated)
+//   --out <dir>                 output directory (default: ../METRICS)
+//   --report <file>             combined report (default: <dir>/metrics_runner.json)
+//   --repetitions <warmup> <n>  number of warm-up and measured runs of each test
+//   --cpus <list>               pin the process to the given cores (e.g., 0-3,8)
+//   --counters                  collect hardware performance counters
+//   --sidecar <length>          series length above which a binary sidecar file is used
+//   --verbose                   verbose test output
+//
+// Each test still writes its own <test name>.json file in the output directory.
+// The combined report collects the results of all tests that were run (with
+// series summarized) and the runner configuration.
+//
+// =============================================================================
+
+#define METRICS_RUNNER_MAIN
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "chrono_thirdparty/filesystem/path.h"
+
+#include "../TestRegistry.h"
+
+// =============================================================================
+
+void ShowUsage(const std::string& name) {
+    std::cout << "Usage: " << name << " [options] [pattern ...]\n"
+              << "  --list                      list the selected tests and exit\n"
+              << "  --project <name>            select tests of projects containing <name> (may be repeated)\n"
+              << "  --out <dir>                 output directory (default: ../METRICS)\n"
+              << "  --report <file>             combined report (default: <dir>/metrics_runner.json)\n"
+              << "  --repetitions <warmup> <n>  number of warm-up and measured runs of each test\n"
+              << "  --cpus <list>               pin the process to the given cores (e.g., 0-3,8)\n"
+              << "  --counters                  collect hardware performance counters\n"
+              << "  --sidecar <length>          series length above which a binary sidecar file is used\n"
+              << "  --verbose                   verbose test output" << std::endl;
+}
+
+// Parse a list of cores of the form "0-3,8,10-11".
+bool ParseCpuList(const std::string& list, std::vector<int>& cpus) {
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t dash = item.find('-');
+        char* end = nullptr;
+        long first = std::strtol(item.c_str(), &end, 10);
+        if (end == item.c_str())
+            return false;
+        long last = first;
+        if (dash != std::string::npos) {
+            const char* start = item.c_str() + dash + 1;
+            last = std::strtol(start, &end, 10);
+            if (end == start)
+                return false;
+        }
+        if (first < 0 || last < first)
+            return false;
+        for (long i = first; i <= last; i++)
+            cpus.push_back(static_cast<int>(i));
+    }
+    return !cpus.empty();
+}
+
+// Pin the process to the specified cores. Threads created afterwards (e.g., the OpenMP thread pool) inherit
+// this affinity. Return false if pinning failed or is not supported on this platform.
+bool PinToCpus(const std::vector<int>& cpus) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto cpu : cpus) {
+        if (cpu >= CPU_SETSIZE)
+            return false;
+        CPU_SET(cpu, &set);
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    DWORD_PTR mask = 0;
+    for (auto cpu : cpus) {
+        if (cpu >= 8 * (int)sizeof(DWORD_PTR))
+            return false;
+        mask |= DWORD_PTR(1) << cpu;
+    }
+    return SetProcessAffinityMask(GetCurrentProcess(), mask) != 0;
+#else
+    return false;
+#endif
+}
+
+// Check whether the given string contains any of the specified patterns (true if no patterns).
+bool Matches(const std::string& str, const std::vector<std::string>& patterns) {
+    if (patterns.empty())
+        return true;
+    for (const auto& pattern : patterns) {
+        if (str.find(pattern) != std::string::npos)
+            return true;
+    }
+    return false;
+}
+
+// =============================================================================
+
+int main(int argc, char* argv[]) {
+    bool list = false;
+    bool counters = false;
+    bool verbose = false;
+    int num_warmup = 0;
+    int num_runs = 1;
+    size_t sidecar = 0;
+    std::string out_dir = "../METRICS";
+    std::string report;
+    std::vector<int> cpus;
+    std::vector<std::string> projects;
+    std::vector<std::string> patterns;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--list") {
+            list = true;
+        } else if (arg == "--counters") {
+            counters = true;
+        } else if (arg == "--verbose") {
+            verbose = true;
+        } else if (arg == "--project" && i + 1 < argc) {
+            projects.push_back(argv[++i]);
+        } else if (arg == "--out" && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else if (arg == "--report" && i + 1 < argc) {
+            report = argv[++i];
+        } else if (arg == "--repetitions" && i + 2 < argc) {
+            num_warmup = std::atoi(argv[++i]);
+            num_runs = std::atoi(argv[++i]);
+        } else if (arg == "--sidecar" && i + 1 < argc) {
+            sidecar = static_cast<size_t>(std::atol(argv[++i]));
+        } else if (arg == "--cpus" && i + 1 < argc) {
+            if (!ParseCpuList(argv[++i], cpus)) {
+                std::cout << "Invalid core list " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--help" || arg == "-h") {
+            ShowUsage(argv[0]);
+            return 0;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cout << "Invalid option " << arg << std::endl;
+            ShowUsage(argv[0]);
+            return 1;
+        } else {
+            patterns.push_back(arg);
+        }
+    }
+
+    // Select tests
+    std::vector<const TestRegistry::Entry*> selected;
+    for (const auto& entry : TestRegistry::Get().GetEntries()) {
+        if (Matches(entry.project, projects) && Matches(entry.name, patterns))
+            selected.push_back(&entry);
+    }
+
+    if (list) {
+        for (const auto entry : selected)
+            std::cout << entry->name << "  (" << entry->project << ")" << std::endl;
+        return 0;
+    }
+
+    if (selected.empty()) {
+        std::cout << "No tests selected" << std::endl;
+        return 1;
+    }
+
+    if (!cpus.empty() && !PinToCpus(cpus)) {
+        std::cout << "Unable to pin process to the specified cores" << std::endl;
+        return 1;
+    }
+
+    if (!filesystem::create_directory(filesystem::path(out_dir))) {
+        std::cout << "Error creating directory " << out_dir << std::endl;
+        return 1;
+    }
+    if (report.empty())
+        report = out_dir + "/metrics_runner.json";
+
+    std::ofstream report_file(report);
+    if (!report_file.is_open()) {
+        std::cout << "Error opening report file " << report << std::endl;
+        return 1;
+    }
+
+    JsonWriter writer(report_file);
+    writer.BeginObject();
+    writer.Key("runner");
+    writer.BeginObject();
+    writer.Key("num_warmup");
+    writer.Value(num_warmup);
+    writer.Key("num_runs");
+    writer.Value(num_runs);
+    writer.Key("cpus");
+    writer.BeginArray();
+    for (auto cpu : cpus)
+        writer.Value(cpu);
+    writer.EndArray();
+    writer.EndObject();
+
+    // Run the selected tests, in registration order
+    int num_failed = 0;
+    writer.Key("tests");
+    writer.BeginObject();
+    for (const auto entry : selected) {
+        std::cout << "Running " << entry->name << std::endl;
+        auto test = entry->factory(entry->name, entry->project);
+        test->setOutDir(out_dir);
+        test->setVerbose(verbose);
+        test->setRepetitions(num_warmup, num_runs);
+        test->enableHardwareCounters(counters);
+        test->setSeriesSidecarThreshold(sidecar);
+        bool passed = test->run();
+        if (!passed)
+            num_failed++;
+        std::cout << "  " << (passed ? "passed" : "FAILED") << "  execution time: " << test->getExecutionTime()
+                  << " s" << std::endl;
+        writer.Key(entry->name);
+        test->write(writer);
+    }
+    writer.EndObject();
+
+    writer.Key("num_tests");
+    writer.Value(static_cast<int>(selected.size()));
+    writer.Key("num_failed");
+    writer.Value(num_failed);
+    writer.EndObject();
+
+    std::cout << selected.size() - num_failed << " of " << selected.size() << " tests passed" << std::endl;
+    std::cout << "Combined report: " << report << std::endl;
+
+    return num_failed > 0;
+}
@@ -0,0 +1,319 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Thread scaling of a HMMWV driving on SCM deformable soil, compared with the
+// same vehicle on rigid terrain (setup of configuration_tests/synchrono's
+// demo_SYN_scm, without SynChrono).
+//
+// The vehicle follows a straight line at constant speed. The SCM terrain uses
+// one moving patch per wheel, so rays are cast only under the four tire
+// footprints. After a number of unrecorded steps (to let the vehicle settle
+// and sink), the step times are accumulated at 1, 2, 4, ... threads, for rigid
+// terrain (RIGID tires on a rigid patch, as reference) and for SCM at the given
+// grid resolution. The test reports, at each thread count, the time per step
+// on both terrains, the SCM overhead (ratio of the two), the speedup relative
+// to one thread, and the number of SCM nodes modified per step. Each run writes
+// its own output file (<test name>_<terrain>_<threads>t.json).
+//
+// The coordinate frame respects the ISO standard adopted in Chrono::Vehicle:
+// right-handed frame with X pointing towards the front, Y to the left, and Z up
+//
+// =============================================================================
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "chrono/core/ChBezierCurve.h"
+#include "chrono/parallel/ChOpenMP.h"
+
+#include "chrono_vehicle/driver/ChPathFollowerDriver.h"
+#include "chrono_vehicle/terrain/RigidTerrain.h"
+#include "chrono_vehicle/terrain/SCMDeformableTerrain.h"
+
+#include "chrono_models/vehicle/hmmwv/HMMWV.h"
+
+#include "chrono_thirdparty/filesystem/path.h"
+
+#include "../TestRegistry.h"
+
+using namespace chrono;
+using namespace chrono::vehicle;
+using namespace chrono::vehicle::hmmwv;
+
+namespace {
+
+// Terrain dimensions
+double terrain_length = 60.0;  // size in X direction
+double terrain_width = 10.0;   // size in Y direction
+
+// Simulation steps
+double step_size = 3e-3;
+int num_skip = 300;   // unrecorded steps
+int num_steps = 500;  // recorded steps
+
+// Vehicle speed
+double target_speed = 5.0;
+
+// =============================================================================
+
+// Single run: given terrain type, number of threads, and SCM grid resolution.
+class SCMScalingRun : public BaseTest {
+  public:
+    SCMScalingRun(const std::string& testName,
+                  const std::string& testProjectName,
+                  bool use_scm,
+                  int num_threads,
+                  double dpu)
+        : BaseTest(testName, testProjectName),
+          m_use_scm(use_scm),
+          m_num_threads(num_threads),
+          m_dpu(dpu),
+          m_execTime(0),
+          m_modified(0) {}
+
+    virtual bool execute() override;
+    virtual double getExecutionTime() const override { return m_execTime; }
+
+    /// Average number of SCM nodes modified per recorded step.
+    double getAverageModifiedNodes() const { return m_modified; }
+
+  private:
+    bool m_use_scm;
+    int m_num_threads;
+    double m_dpu;
+    double m_execTime;
+    double m_modified;
+};
+
+bool SCMScalingRun::execute() {
+    std::cout << "Test: " << getTestName() << "  (" << (m_use_scm ? "SCM" : "rigid") << ", " << m_num_threads
+              << " threads)" << std::endl;
+
+    PhaseTimer setup_timer(*this, "setup");
+
+    // Create the HMMWV, near the start of the terrain
+    ChVector<> init_loc(-terrain_length / 2 + 5, 0, 0.5);
+    HMMWV_Full hmmwv;
+    hmmwv.SetContactMethod(ChContactMethod::SMC);
+    hmmwv.SetChassisFixed(false);
+    hmmwv.SetInitPosition(ChCoordsys<>(init_loc, QUNIT));
+    hmmwv.SetPowertrainType(PowertrainModelType::SHAFTS);
+    hmmwv.SetDriveType(DrivelineTypeWV::AWD);
+    hmmwv.SetTireType(TireModelType::RIGID);
+    hmmwv.Initialize();
+
+    hmmwv.SetChassisVisualizationType(VisualizationType::NONE);
+    hmmwv.SetSuspensionVisualizationType(VisualizationType::NONE);
+    hmmwv.SetSteeringVisualizationType(VisualizationType::NONE);
+    hmmwv.SetWheelVisualizationType(VisualizationType::NONE);
+    hmmwv.SetTireVisualizationType(VisualizationType::NONE);
+
+    ChSystem* system = hmmwv.GetSystem();
+    system->SetNumThreads(m_num_threads);
+    system->SetSolverMaxIterations(50);
+
+    // Create the terrain
+    std::shared_ptr<ChTerrain> terrain;
+    std::shared_ptr<SCMDeformableTerrain> scm;
+    if (m_use_scm) {
+        scm = chrono_types::make_shared<SCMDeformableTerrain>(system);
+        scm->SetSoilParameters(0.2e6,  // Bekker Kphi
+                               0,      // Bekker Kc
+                               1.1,    // Bekker n exponent
+                               0,      // Mohr cohesive limit (Pa)
+                               30,     // Mohr friction limit (degrees)
+                               0.01,   // Janosi shear coefficient (m)
+                               4e7,    // Elastic stiffness (Pa/m), before plastic yield
+                               3e4     // Damping (Pa s/m), proportional to negative vertical speed (optional)
+        );
+        for (auto& axle : hmmwv.GetVehicle().GetAxles()) {
+            for (auto& wheel : axle->GetWheels())
+                scm->AddMovingPatch(wheel->GetSpindle(), ChVector<>(0, 0, 0), ChVector<>(1.0, 0.6, 1.0));
+        }
+        scm->Initialize(terrain_length, terrain_width, 1 / m_dpu);
+        terrain = scm;
+    } else {
+        auto patch_mat = chrono_types::make_shared<ChMaterialSurfaceSMC>();
+        patch_mat->SetFriction(0.9f);
+        patch_mat->SetRestitution(0.01f);
+        patch_mat->SetYoungModulus(2e7f);
+        auto rigid = chrono_types::make_shared<RigidTerrain>(system);
+        rigid->AddPatch(patch_mat, ChVector<>(0, 0, 0), ChVector<>(0, 0, 1), terrain_length, terrain_width);
+        rigid->Initialize();
+        terrain = rigid;
+    }
+
+    // Straight line path
+    auto path = chrono_types::make_shared<ChBezierCurve>(
+        std::vector<ChVector<>>{init_loc, init_loc + ChVector<>(terrain_length, 0, 0)});
+    ChPathFollowerDriver driver(hmmwv.GetVehicle(), path, "straight", target_speed);
+    driver.GetSpeedController().SetGains(0.4, 0, 0);
+    driver.GetSteeringController().SetGains(0.4, 0.1, 0.2);
+    driver.GetSteeringController().SetLookAheadDistance(5);
+    driver.Initialize();
+
+    setup_timer.stop();
+
+    // Simulate (recording step times only after the initial steps)
+    PhaseTimer simulate_timer(*this, "simulate");
+
+    double time_step = 0;
+    double modified = 0;
+    Series& step_series = addSeries("step_time (ms)");
+    for (int i = 0; i < num_skip + num_steps; i++) {
+        double time = system->GetChTime();
+        ChDriver::Inputs driver_inputs = driver.GetInputs();
+        driver.Synchronize(time);
+        terrain->Synchronize(time);
+        hmmwv.Synchronize(time, driver_inputs, *terrain);
+        driver.Advance(step_size);
+        terrain->Advance(step_size);
+        hmmwv.Advance(step_size);
+        if (i < num_skip)
+            continue;
+        time_step += system->GetTimerStep();
+        if (scm)
+            modified += scm->GetModifiedNodes().size();
+        step_series.push_back(1000 * system->GetTimerStep());
+    }
+
+    simulate_timer.stop();
+    addPhaseTime("step", time_step);
+
+    m_execTime = time_step;
+    m_modified = modified / num_steps;
+    addMetric("num_threads", m_num_threads);
+    addMetric("avg_step_time (ms)", 1000 * time_step / num_steps);
+    addMetric("vehicle_speed", hmmwv.GetVehicle().GetVehicleSpeed());
+    if (scm) {
+        addMetric("dpu", m_dpu);
+        addMetric("avg_modified_nodes", m_modified);
+    }
+
+    return true;
+}
+
+// =============================================================================
+
+// Scaling test: runs SCMScalingRun on rigid and SCM terrain for each thread count.
+class SCMScalingTest : public BaseTest {
+  public:
+    SCMScalingTest(const std::string& testName, const std::string& testProjectName, double dpu)
+        : BaseTest(testName, testProjectName), m_dpu(dpu), m_execTime(0) {
+        int num_procs = ChOMP::GetNumProcs();
+        for (int n = 1; n < num_procs; n *= 2)
+            m_threads.push_back(n);
+        m_threads.push_back(num_procs);
+    }
+
+    virtual bool execute() override;
+    virtual double getExecutionTime() const override { return m_execTime; }
+
+  private:
+    double m_dpu;
+    std::vector<int> m_threads;
+    double m_execTime;
+};
+
+bool SCMScalingTest::execute() {
+    bool passed = true;
+    m_execTime = 0;
+
+    std::vector<double> threads;
+    std::vector<double> rigid_times;
+    std::vector<double> scm_times;
+    std::vector<double> modified;
+    for (auto n : m_threads) {
+        SCMScalingRun rigid(getTestName() + "_rigid_" + std::to_string(n) + "t", getProjectName(), false, n, m_dpu);
+        SCMScalingRun scm(getTestName() + "_SCM_" + std::to_string(n) + "t", getProjectName(), true, n, m_dpu);
+        for (auto run : {&rigid, &scm}) {
+            run->setOutDir(getOutDir());
+            run->setSeriesSidecarThreshold(1000);
+            passed &= run->run();
+            m_execTime += run->getExecutionTime();
+        }
+
+        threads.push_back(n);
+        rigid_times.push_back(rigid.getPhaseTime("step") / num_steps);
+        scm_times.push_back(scm.getPhaseTime("step") / num_steps);
+        modified.push_back(scm.getAverageModifiedNodes());
+    }
+
+    // SCM overhead and speedups relative to one thread
+    std::vector<double> overhead;
+    std::vector<double> rigid_speedup;
+    std::vector<double> scm_speedup;
+    printf("\n%-8s | %10s %7s | %10s %7s | %8s %10s\n", "threads", "rigid (ms)", "speedup", "SCM (ms)", "speedup",
+           "SCM/rigid", "nodes/step");
+    for (size_t it = 0; it < threads.size(); it++) {
+        overhead.push_back(rigid_times[it] > 0 ? scm_times[it] / rigid_times[it] : 0);
+        rigid_speedup.push_back(rigid_times[it] > 0 ? rigid_times[0] / rigid_times[it] : 0);
+        scm_speedup.push_back(scm_times[it] > 0 ? scm_times[0] / scm_times[it] : 0);
+        printf("%-8d | %10.4f %7.2f | %10.4f %7.2f | %8.2f %10.0f\n", (int)threads[it], 1000 * rigid_times[it],
+               rigid_speedup[it], 1000 * scm_times[it], scm_speedup[it], overhead[it], modified[it]);
+    }
+
+    addMetric("dpu", m_dpu);
+    addMetric("num_threads", threads);
+    addMetric("rigid_time_per_step", rigid_times);
+    addMetric("SCM_time_per_step", scm_times);
+    addMetric("SCM_overhead", overhead);
+    addMetric("rigid_speedup", rigid_speedup);
+    addMetric("SCM_speedup", scm_speedup);
+    addMetric("SCM_modified_nodes_per_step", modified);
+
+    return passed;
+}
+
+// Tests run by this program (or by metrics_runner), for two SCM grid resolutions
+TestRegistrar reg_20dpu("metrics_VEH_SCMScaling_20dpu",
+                        "Chrono::Vehicle",
+                        TestRegistry::MakeFactory<SCMScalingTest>(20.0));
+TestRegistrar reg_50dpu("metrics_VEH_SCMScaling_50dpu",
+                        "Chrono::Vehicle",
+                        TestRegistry::MakeFactory<SCMScalingTest>(50.0));
+
+}  // end anonymous namespace
+
+#ifndef METRICS_RUNNER
+
+// =============================================================================
+// Main driver program
+// =============================================================================
+
+int main(int argc, char* argv[]) {
+    // Usage: metrics_VEH_SCMScaling [20dpu|50dpu]
+    // By default, run both resolutions.
+    std::string out_dir = "../METRICS";
+    if (!filesystem::create_directory(filesystem::path(out_dir))) {
+        std::cout << "Error creating directory " << out_dir << std::endl;
+        return 1;
+    }
+
+    bool passed = true;
+    for (const auto& entry : TestRegistry::Get().GetEntries()) {
+        if (argc > 1 && entry.name.find("_" + std::string(argv[1])) == std::string::npos)
+            continue;
+        auto test = entry.factory(entry.name, entry.project);
+        test->setOutDir(out_dir);
+        passed &= test->run();
+        test->print();
+    }
+
+    return passed ? 0 : 1;
+}
+
+#endif
@@ -13,19 +13,26 @@
 // =============================================================================
 //
 // Test for mesh-box collision detection, using a single ANCF toroidal tire.
+// The custom node-cloud collision detection is benchmarked at several tire mesh
+// resolutions, reporting collision tests per second and contacts per step.
+// The "_grid" variants use a uniform-grid spatial hash of the contact nodes as
+// broadphase and also report candidate pairs versus actual contacts. The
+// contacts of the system are reported after each step into contiguous arrays
+// (ContactArrayReporter).
 //
 // The coordinate frame respects the ISO standard adopted in Chrono::Vehicle:
 // right-handed frame with X pointing towards the front, Y to the left, and Z up
 //
 // =============================================================================
-////#include <float.h>
-////unsigned int fp_control_state = _controlfp(_EM_INEXACT, _MCW_EM);
 
 #include <cmath>
 #include <cstdio>
+#include <string>
 #include <vector>
 
-#include "chrono/assets/ChGlyphs.h"
+#include "chrono/core/ChTimer.h"
+#include "chrono/physics/ChSystemSMC.h"
+#include "chrono/solver/ChIterativeSolverLS.h"
 #include "chrono/utils/ChUtilsInputOutput.h"
 
 #include "chrono/fea/ChContactSurfaceNodeCloud.h"
@@ -33,15 +40,20 @@
 #include "chrono_vehicle/ChConfigVehicle.h"
 #include "chrono_vehicle/ChVehicleModelData.h"
 #include "chrono_vehicle/terrain/RigidTerrain.h"
+#include "chrono_vehicle/wheeled_vehicle/ChWheel.h"
 #include "chrono_vehicle/wheeled_vehicle/tire/ANCFToroidalTire.h"
 
 #include "chrono_thirdparty/filesystem/path.h"
 
-#include "../BaseTest.h"
+#include "../ContactArrays.h"
+#include "../NodeCloudGrid.h"
+#include "../TestRegistry.h"
 
 using namespace chrono;
 using namespace chrono::vehicle;
 
+namespace {
+
 // =============================================================================
 // Global definitions
 // =============================================================================
@@ -63,21 +75,31 @@ double node_radius = 0.01;
 double terrain_length = 100.0;  // size in X direction
 double terrain_width = 2.0;     // size in Y direction
 
-// Render contact points (from default collider or from custom collider)
-enum ColliderType { DEFAULT_COLLIDER, CUSTOM_COLLIDER };
-ColliderType render_which = CUSTOM_COLLIDER;
-double point_size = 0.003;
+// Cell size of the node-cloud spatial hash (used in the "_grid" tests)
+double grid_cell_size = 0.04;
+
+// Print information on each contact?
+bool print_contacts = false;
 
-// Tire mesh wireframe only?
-bool tire_mesh_wireframe = false;
+// Simulation steps
+int num_steps = 100;
+double step_size = 1e-3;
 
 // =============================================================================
 
 // Test class
 class toroidalTireTest : public BaseTest {
   public:
-    toroidalTireTest(const std::string& testName, const std::string& testProjectName)
-        : BaseTest(testName, testProjectName), m_execTime(0) {}
+    toroidalTireTest(const std::string& testName,
+                     const std::string& testProjectName,
+                     int div_circumference,
+                     int div_width,
+                     bool use_grid = false)
+        : BaseTest(testName, testProjectName),
+          m_div_circumference(div_circumference),
+          m_div_width(div_width),
+          m_use_grid(use_grid),
+          m_execTime(0) {}
 
     ~toroidalTireTest() {}
 
@@ -86,80 +108,97 @@ class toroidalTireTest : public BaseTest {
     virtual double getExecutionTime() const override { return m_execTime; }
 
   private:
+    int m_div_circumference;  // number of tire mesh divisions in circumferential direction
+    int m_div_width;          // number of tire mesh divisions across the tire width
+    bool m_use_grid;          // use the node-cloud spatial hash as broadphase
     double m_execTime;
 };
 
 // =============================================================================
-// Contact reporter class
+// Wheel for the tire test (massless, attached to the test body)
 // =============================================================================
 
-class MyContactReporter : public ChReportContactCallback {
+class TestWheel : public ChWheel {
   public:
-    MyContactReporter(std::shared_ptr<ChBody> ground) : m_ground(ground), m_num_contacts(0) {}
-
-    unsigned int GetNumAddedContacts() const { return m_num_contacts; }
-    const std::vector<ChVector<>>& GetTerrainPoints() const { return m_terrain_points; }
-    const std::vector<ChVector<>>& GetNodePoints() const { return m_node_points; }
-
-  private:
-    virtual bool ReportContactCallback(const ChVector<>& pA,
-                                       const ChVector<>& pB,
-                                       const ChMatrix33<>& plane_coord,
-                                       const double& distance,
-                                       const ChVector<>& react_forces,
-                                       const ChVector<>& react_torques,
-                                       ChContactable* objA,
-                                       ChContactable* objB) override {
-        m_num_contacts++;
-        ChVector<> normal = plane_coord.Get_A_Xaxis();
-        ChVector<> pointT = (objA == m_ground.get()) ? pA : pB;
-        ChVector<> pointN = (objA == m_ground.get()) ? pB : pA;
-        printf("%3d | ", m_num_contacts);
-        printf("%+10.5e | ", distance);
-        printf("%+10.5e  %+10.5e  %+10.5e | ", pointT.x, pointT.y, pointT.z);
-        printf("%+10.5e  %+10.5e  %+10.5e | ", pointN.x, pointN.y, pointN.z);
-        printf("%+10.5e  %+10.5e  %+10.5e \n", normal.x, normal.y, normal.z);
-
-        // Cache the contact points
-        m_terrain_points.push_back(pointT);
-        m_node_points.push_back(pointN);
-
-        return true;
-    }
-
-    std::shared_ptr<ChBody> m_ground;
-    int m_num_contacts;
-    std::vector<ChVector<>> m_node_points;
-    std::vector<ChVector<>> m_terrain_points;
+    TestWheel() : ChWheel("test_wheel") {}
+    virtual double GetMass() const override { return 0; }
+    virtual ChVector<> GetInertia() const override { return ChVector<>(0); }
 };
 
 // =============================================================================
 // Custom collision detection class
 // =============================================================================
 
-class TireTestCollisionManager : public ChSystem::ChCustomComputeCollisionCallback {
+class TireTestCollisionManager : public ChSystem::CustomCollisionCallback {
   public:
     TireTestCollisionManager(std::shared_ptr<fea::ChContactSurfaceNodeCloud> surface,
                              std::shared_ptr<RigidTerrain> terrain,
-                             double radius)
-        : m_surface(surface), m_terrain(terrain), m_radius(radius), m_num_contacts(0) {}
+                             std::shared_ptr<ChBody> ground,
+                             double radius,
+                             std::shared_ptr<NodeCloudGrid> grid = nullptr,
+                             double max_height = 0)
+        : m_surface(surface),
+          m_terrain(terrain),
+          m_ground(ground),
+          m_radius(radius),
+          m_grid(grid),
+          m_max_height(max_height),
+          m_num_contacts(0),
+          m_cached(false),
+          m_num_calls(0),
+          m_num_tests(0),
+          m_num_step_contacts(0) {}
 
     unsigned int GetNumAddedContacts() const { return m_num_contacts; }
     const std::vector<ChVector<>>& GetTerrainPoints() const { return m_terrain_points; }
     const std::vector<ChVector<>>& GetNodePoints() const { return m_node_points; }
 
+    /// Reset the collision statistics (but not the cached contact points).
+    void ResetStats() {
+        m_num_calls = 0;
+        m_num_tests = 0;
+        m_num_step_contacts = 0;
+        m_timer.reset();
+        if (m_grid)
+            m_grid->ResetStats();
+    }
+
+    unsigned int GetNumCalls() const { return m_num_calls; }
+    unsigned long long GetNumTests() const { return m_num_tests; }
+    unsigned long long GetNumStepContacts() const { return m_num_step_contacts; }
+    double GetTime() const { return m_timer.GetTimeSeconds(); }
+
   private:
-    virtual void PerformCustomCollision(ChSystem* system) override {
-        printf("\n>>>> Custom collision detection <<<\n\n");
+    virtual void OnCustomCollision(ChSystem* system) override {
+        m_timer.start();
+
+        unsigned int num_contacts = 0;
+        unsigned int num_nodes = m_surface->GetNnodes();
+
+        // Broadphase: with the spatial hash, test only the nodes in cells below the highest terrain point
+        unsigned int num_tests = num_nodes;
+        if (m_grid) {
+            m_grid->Update(num_nodes, [this](unsigned int in) {
+                return std::static_pointer_cast<fea::ChContactNodeXYZsphere>(m_surface->GetNode(in))
+                    ->GetNode()
+                    ->GetPos();
+            });
+            m_candidates.clear();
+            m_grid->Query(ChVector<>(-1e30, -1e30, -1e30), ChVector<>(1e30, 1e30, m_max_height + m_radius),
+                          m_candidates);
+            num_tests = (unsigned int)m_candidates.size();
+        }
+
+        for (unsigned int it = 0; it < num_tests; it++) {
+            unsigned int in = m_grid ? m_candidates[it] : it;
 
-        for (unsigned int in = 0; in < m_surface->GetNnodes(); in++) {
             // Represent the contact node as a sphere (P, m_radius)
             auto contact_node = std::static_pointer_cast<fea::ChContactNodeXYZsphere>(m_surface->GetNode(in));
             const ChVector<>& P = contact_node->GetNode()->GetPos();
 
             // Represent the terrain as a plane (Q, normal)
-            ChVector<> normal = m_terrain->GetNormal(P.x, P.y);
-            ChVector<> Q(P.x, P.y, m_terrain->GetHeight(P.x, P.y));
+            ChVector<> normal = m_terrain->GetNormal(P);
+            ChVector<> Q(P.x(), P.y(), m_terrain->GetHeight(P));
 
             // Calculate signed height of sphere center above plane
             double height = Vdot(normal, P - Q);
@@ -168,7 +207,7 @@ class TireTestCollisionManager : public ChSystem::ChCustomComputeCollisionCallba
             if (height >= m_radius)
                 continue;
 
-            m_num_contacts++;
+            num_contacts++;
 
             // Create a collision info structure:
             //    modelA: terrain collision model
@@ -178,97 +217,141 @@ class TireTestCollisionManager : public ChSystem::ChCustomComputeCollisionCallba
             //    vpB: contact point on node
             //    distance: penetration (negative)
             collision::ChCollisionInfo contact;
-            contact.modelA = m_terrain->GetGroundBody()->GetCollisionModel();
+            contact.modelA = m_ground->GetCollisionModel().get();
             contact.modelB = contact_node->GetCollisionModel();
             contact.vN = normal;
             contact.vpA = P - height * normal;
             contact.vpB = P - m_radius * normal;
             contact.distance = height - m_radius;
 
-            printf("%3d | ", m_num_contacts);
-            printf("%+10.5e | ", contact.distance);
-            printf("%+10.5e  %+10.5e  %+10.5e | ", contact.vpA.x, contact.vpA.y, contact.vpA.z);
-            printf("%+10.5e  %+10.5e  %+10.5e | ", contact.vpB.x, contact.vpB.y, contact.vpB.z);
-            printf("%+10.5e  %+10.5e  %+10.5e \n", contact.vN.x, contact.vN.y, contact.vN.z);
-
             // Note: do not register the new contact
             ////system->GetContactContainer()->AddContact(contact);
 
-            // Cache the contact points (on terrain and nodes)
+            // Cache the contact points (on terrain and nodes) at the first call only
+            if (m_cached)
+                continue;
+
+            if (print_contacts) {
+                printf("%3d | ", num_contacts);
+                printf("%+10.5e | ", contact.distance);
+                printf("%+10.5e  %+10.5e  %+10.5e | ", contact.vpA.x(), contact.vpA.y(), contact.vpA.z());
+                printf("%+10.5e  %+10.5e  %+10.5e | ", contact.vpB.x(), contact.vpB.y(), contact.vpB.z());
+                printf("%+10.5e  %+10.5e  %+10.5e \n", contact.vN.x(), contact.vN.y(), contact.vN.z());
+            }
+
             m_terrain_points.push_back(contact.vpA);
             m_node_points.push_back(contact.vpB);
         }
 
-        printf("\nFound: %d\n\n", m_num_contacts);
+        m_timer.stop();
+
+        if (m_grid)
+            m_grid->AddContacts(num_contacts);
+        if (!m_cached) {
+            m_num_contacts = num_contacts;
+            m_cached = true;
+        }
+        m_num_calls++;
+        m_num_tests += num_tests;
+        m_num_step_contacts += num_contacts;
     }
 
     std::shared_ptr<fea::ChContactSurfaceNodeCloud> m_surface;
     std::shared_ptr<RigidTerrain> m_terrain;
+    std::shared_ptr<ChBody> m_ground;
     double m_radius;
-    unsigned int m_num_contacts;
+    std::shared_ptr<NodeCloudGrid> m_grid;   // optional spatial hash of the contact nodes
+    double m_max_height;                     // upper bound of the terrain height (for the broadphase query)
+    std::vector<unsigned int> m_candidates;  // candidate nodes returned by the broadphase
+    unsigned int m_num_contacts;             // contacts found at first invocation
+    bool m_cached;                           // contact points of the first invocation cached (kept by ResetStats)
+    unsigned int m_num_calls;                // number of invocations
+    unsigned long long m_num_tests;          // number of node-terrain tests
+    unsigned long long m_num_step_contacts;  // total number of contacts over all invocations
+    ChTimer<double> m_timer;                 // time spent in custom collision detection
     std::vector<ChVector<>> m_node_points;
     std::vector<ChVector<>> m_terrain_points;
 };
 
 bool toroidalTireTest::execute() {
+    PhaseTimer setup_timer(*this, "setup");
+
     // Create the mechanical system
     // ----------------------------
 
-    ChSystemDEM system;
+    ChSystemSMC system;
     system.Set_G_acc(ChVector<>(0.0, 0.0, 0.0));
 
+    auto solver = chrono_types::make_shared<ChSolverMINRES>();
+    solver->SetMaxIterations(100);
+    solver->EnableDiagonalPreconditioner(true);
+    solver->SetVerbose(false);
+    system.SetSolver(solver);
+    system.SetSolverForceTolerance(1e-10);
+    system.SetTimestepperType(ChTimestepper::Type::EULER_IMPLICIT_LINEARIZED);
+
     // Create the wheel (rim)
     // ----------------------
 
-    auto wheel = std::make_shared<ChBody>(ChMaterialSurfaceBase::DEM);
-    system.AddBody(wheel);
-    wheel->SetIdentifier(2);
-    wheel->SetName("wheel");
-    wheel->SetBodyFixed(false);
-    wheel->SetCollide(false);
-    wheel->SetMass(10);
-    wheel->SetInertiaXX(ChVector<>(1, 1, 1));
-    wheel->SetPos(wheel_pos);
-    wheel->SetRot(wheeel_rot);
+    auto spindle = chrono_types::make_shared<ChBody>();
+    system.AddBody(spindle);
+    spindle->SetIdentifier(2);
+    spindle->SetName("wheel");
+    spindle->SetBodyFixed(false);
+    spindle->SetCollide(false);
+    spindle->SetMass(10);
+    spindle->SetInertiaXX(ChVector<>(1, 1, 1));
+    spindle->SetPos(wheel_pos);
+    spindle->SetRot(wheeel_rot);
+
+    auto wheel = chrono_types::make_shared<TestWheel>();
+    wheel->Initialize(spindle, LEFT);
 
     // Create the tire
     // ---------------
 
-    auto tire = std::make_shared<ANCFToroidalTire>("ANCF_Tire");
+    auto tire = chrono_types::make_shared<ANCFToroidalTire>("ANCF_Tire");
+
+    tire->SetDivCircumference(m_div_circumference);
+    tire->SetDivWidth(m_div_width);
 
     tire->EnablePressure(true);
     tire->EnableRimConnection(true);
     tire->EnableContact(true);
 
-    tire->SetContactSurfaceType(ChANCFTire::NODE_CLOUD);
+    tire->SetContactSurfaceType(ChDeformableTire::ContactSurfaceType::NODE_CLOUD);
     tire->SetContactNodeRadius(node_radius);
 
-    tire->Initialize(wheel, LEFT);
+    tire->Initialize(wheel);
 
     tire->SetVisualizationType(VisualizationType::NONE);
 
-    double tire_radius = tire->GetRadius();
-    double rim_radius = tire->GetRimRadius();
-    double tire_width = tire->GetWidth();
-
     // Find lowest mesh node
     auto tire_mesh = tire->GetMesh();
+    unsigned int num_nodes = tire_mesh->GetNnodes();
     double z_min = 0;
-    for (unsigned int in = 0; in < tire_mesh->GetNnodes(); in++) {
+    for (unsigned int in = 0; in < num_nodes; in++) {
         auto node = std::dynamic_pointer_cast<fea::ChNodeFEAxyz>(tire_mesh->GetNode(in));
-        if (node->GetPos().z < z_min)
-            z_min = node->GetPos().z;
+        if (node->GetPos().z() < z_min)
+            z_min = node->GetPos().z();
     }
 
+    std::cout << "Tire mesh: " << m_div_circumference << " x " << m_div_width << " divisions, " << num_nodes
+              << " nodes" << std::endl;
+
     // Create the terrain
     // ------------------
 
-    auto terrain = std::make_shared<RigidTerrain>(&system);
-    terrain->SetContactFrictionCoefficient(0.9f);
-    terrain->SetContactRestitutionCoefficient(0.01f);
-    terrain->SetContactMaterialProperties(2e7f, 0.3f);
-    ////terrain->SetTexture(vehicle::GetDataFile("terrain/textures/tile4.jpg"), 200, 4);
-    terrain->Initialize(z_min - tire_offset, terrain_length, terrain_width);
+    auto patch_mat = chrono_types::make_shared<ChMaterialSurfaceSMC>();
+    patch_mat->SetFriction(0.9f);
+    patch_mat->SetRestitution(0.01f);
+    patch_mat->SetYoungModulus(2e7f);
+    patch_mat->SetPoissonRatio(0.3f);
+
+    auto terrain = chrono_types::make_shared<RigidTerrain>(&system);
+    auto patch = terrain->AddPatch(patch_mat, ChVector<>(0, 0, z_min - tire_offset), ChVector<>(0, 0, 1),
+                                   terrain_length, terrain_width);
+    terrain->Initialize();
 
     // Create the custom collision detector
     // ------------------------------------
@@ -276,14 +359,17 @@ bool toroidalTireTest::execute() {
     // Extract the contact surface from the tire mesh
     auto surface = std::dynamic_pointer_cast<fea::ChContactSurfaceNodeCloud>(tire_mesh->GetContactSurface(0));
 
-    // Add custom collision callback
-    TireTestCollisionManager collider(surface, terrain, tire->GetContactNodeRadius());
-    system.SetCustomComputeCollisionCallback(&collider);
+    // Optional broadphase (the terrain patch is flat, so its height bounds the terrain height)
+    std::shared_ptr<NodeCloudGrid> grid;
+    if (m_use_grid)
+        grid = chrono_types::make_shared<NodeCloudGrid>(grid_cell_size);
 
-    // Complete system setup
-    // ---------------------
+    // Add custom collision callback
+    auto collider = chrono_types::make_shared<TireTestCollisionManager>(
+        surface, terrain, patch->GetGroundBody(), tire->GetContactNodeRadius(), grid, z_min - tire_offset);
+    system.RegisterCustomCollisionCallback(collider);
 
-    system.SetupInitial();
+    setup_timer.stop();
 
     // Perform collision detection
     // ---------------------------
@@ -291,52 +377,112 @@ bool toroidalTireTest::execute() {
     system.ComputeCollisions();
 
     // Report tire-terrain contacts
-    MyContactReporter reporter(terrain->GetGroundBody());
-    printf("\n>>>> Default collision detection <<<\n\n");
-    system.GetContactContainer()->ReportAllContacts(&reporter);
-    printf("\nFound: %d\n\n", system.GetContactContainer()->GetNcontacts());
-
-    // Asset for rendering contact points
-    unsigned int npoints = collider.GetNumAddedContacts();
-    std::vector<ChVector<>> terrain_points;
-    std::vector<ChVector<>> node_points;
-
-    switch (render_which) {
-        case DEFAULT_COLLIDER:
-            printf("\nRender contact points from DEFAULT COLLIDER (Bullet)\n");
-            terrain_points = reporter.GetTerrainPoints();
-            node_points = reporter.GetNodePoints();
-            break;
-        case CUSTOM_COLLIDER:
-            printf("\nRender contact points from CUSTOM COLLIDER (exact)\n");
-            terrain_points = collider.GetTerrainPoints();
-            node_points = collider.GetNodePoints();
-            break;
+    ContactArrays contacts;
+    auto reporter = chrono_types::make_shared<ContactArrayReporter>(contacts);
+    reporter->Fill(*system.GetContactContainer());
+    if (print_contacts) {
+        auto ground = patch->GetGroundBody().get();
+        for (int i = 0; i < contacts.num_contacts; i++) {
+            bool terrain_first = contacts.objA[i] == ground;
+            const ChVector<>& pointT = terrain_first ? contacts.pointA[i] : contacts.pointB[i];
+            const ChVector<>& pointN = terrain_first ? contacts.pointB[i] : contacts.pointA[i];
+            const ChVector<>& normal = contacts.normal[i];
+            printf("%3d | ", i + 1);
+            printf("%+10.5e | ", contacts.distance[i]);
+            printf("%+10.5e  %+10.5e  %+10.5e | ", pointT.x(), pointT.y(), pointT.z());
+            printf("%+10.5e  %+10.5e  %+10.5e | ", pointN.x(), pointN.y(), pointN.z());
+            printf("%+10.5e  %+10.5e  %+10.5e \n", normal.x(), normal.y(), normal.z());
+        }
     }
+    printf("Default collision detection: %d contacts\n", system.GetContactContainer()->GetNcontacts());
+    printf("Custom collision detection:  %d contacts\n", collider->GetNumAddedContacts());
 
-    auto glyph_points = std::make_shared<ChGlyphs>();
-    glyph_points->Reserve(2 * npoints);
-    glyph_points->SetGlyphsSize(point_size);
-    for (unsigned int ip = 0; ip < npoints; ip++) {
-        glyph_points->SetGlyphPoint(ip, wheel->TransformPointParentToLocal(terrain_points[ip]), ChColor(1, 0, 0));
-        glyph_points->SetGlyphPoint(npoints + ip, wheel->TransformPointParentToLocal(node_points[ip]),
-                                    ChColor(0, 1, 0));
-    }
+    addMetric("number_nodes", static_cast<int>(num_nodes));
+    addMetric("default_contacts", contacts.num_contacts);
+    addMetric("custom_contacts", static_cast<int>(collider->GetNumAddedContacts()));
 
-    wheel->AddAsset(glyph_points);
+    // Simulation loop
+    // ---------------
+    PhaseTimer simulate_timer(*this, "simulate");
 
-    // Rendering loop
-    // --------------
-    int num_steps = 100;  // Is this enough?
-    double step_size = 1e-3;
+    collider->ResetStats();
+    Series& contacts_series = addSeries("contacts_per_step");
     double time_total = 0;
+    ChTimer<double> report_timer;
     for (int istep = 0; istep < num_steps; istep++) {
+        unsigned long long num_contacts = collider->GetNumStepContacts();
         system.DoStepDynamics(step_size);
         time_total += system.GetTimerStep();
+        contacts_series.push_back(static_cast<double>(collider->GetNumStepContacts() - num_contacts));
+
+        report_timer.start();
+        reporter->Fill(*system.GetContactContainer());
+        report_timer.stop();
     }
+
+    simulate_timer.stop();
+    addPhaseTime("custom_collision", collider->GetTime());
+
+    double time_collision = collider->GetTime();
+    unsigned int num_calls = collider->GetNumCalls();
+    double tests_per_second = (time_collision > 0) ? collider->GetNumTests() / time_collision : 0;
+
+    printf("Custom collision: %u calls, %llu node tests, %.3e s (%.3e tests/s)\n", num_calls, collider->GetNumTests(),
+           time_collision, tests_per_second);
+
     m_execTime = time_total;
+    addMetric("collision_tests_per_second", tests_per_second);
+    addMetric("avg_contacts_per_step", num_calls > 0 ? (double)collider->GetNumStepContacts() / num_calls : 0.0);
+    addMetric("avg_collision_time_per_step (ms)", num_calls > 0 ? 1000 * time_collision / num_calls : 0.0);
+    addMetric("avg_time_per_step (ms)", 1000 * time_total / num_steps);
+    addMetric("avg_contact_report_time_per_step (ms)", 1000 * report_timer.GetTimeSeconds() / num_steps);
+
+    if (grid && grid->GetNumQueries() > 0) {
+        double candidates = (double)grid->GetNumCandidates() / grid->GetNumQueries();
+        printf("Broadphase: %.1f candidates, %.1f contacts, %.1f relocated nodes per call (%u cells)\n", candidates,
+               (double)grid->GetNumContacts() / grid->GetNumQueries(),
+               (double)grid->GetNumMoved() / grid->GetNumUpdates(), grid->GetNumCells());
+        addMetric("avg_candidate_pairs_per_step", candidates);
+        addMetric("contacts_per_candidate",
+                  grid->GetNumCandidates() > 0 ? (double)grid->GetNumContacts() / grid->GetNumCandidates() : 0.0);
+        addMetric("avg_relocated_nodes_per_step", (double)grid->GetNumMoved() / grid->GetNumUpdates());
+    }
+
     return true;
 }
+
+// Tests run by this program (or by metrics_runner), for several tire mesh resolutions
+TestRegistrar reg_30x6("metrics_VEH_collisionToroidalTire_30x6",
+                       "Chrono::Vehicle",
+                       TestRegistry::MakeFactory<toroidalTireTest>(30, 6));
+TestRegistrar reg_60x12("metrics_VEH_collisionToroidalTire_60x12",
+                        "Chrono::Vehicle",
+                        TestRegistry::MakeFactory<toroidalTireTest>(60, 12));
+TestRegistrar reg_120x24("metrics_VEH_collisionToroidalTire_120x24",
+                         "Chrono::Vehicle",
+                         TestRegistry::MakeFactory<toroidalTireTest>(120, 24));
+TestRegistrar reg_240x48("metrics_VEH_collisionToroidalTire_240x48",
+                         "Chrono::Vehicle",
+                         TestRegistry::MakeFactory<toroidalTireTest>(240, 48));
+
+// Same resolutions, with the node-cloud spatial hash as broadphase
+TestRegistrar reg_30x6_grid("metrics_VEH_collisionToroidalTire_30x6_grid",
+                            "Chrono::Vehicle",
+                            TestRegistry::MakeFactory<toroidalTireTest>(30, 6, true));
+TestRegistrar reg_60x12_grid("metrics_VEH_collisionToroidalTire_60x12_grid",
+                             "Chrono::Vehicle",
+                             TestRegistry::MakeFactory<toroidalTireTest>(60, 12, true));
+TestRegistrar reg_120x24_grid("metrics_VEH_collisionToroidalTire_120x24_grid",
+                              "Chrono::Vehicle",
+                              TestRegistry::MakeFactory<toroidalTireTest>(120, 24, true));
+TestRegistrar reg_240x48_grid("metrics_VEH_collisionToroidalTire_240x48_grid",
+                              "Chrono::Vehicle",
+                              TestRegistry::MakeFactory<toroidalTireTest>(240, 48, true));
+
+}  // end anonymous namespace
+
+#ifndef METRICS_RUNNER
+
 // =============================================================================
 // Main driver program
 // =============================================================================
@@ -348,10 +494,16 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    toroidalTireTest test("metrics_VEH_collisionToroidalTire", "Chrono::VEH");
-    test.setOutDir(out_dir);
-    test.setVerbose(true);
-    bool passed = test.run();
-    test.print();
-    return 0;
+    bool passed = true;
+    for (const auto& entry : TestRegistry::Get().GetEntries()) {
+        auto test = entry.factory(entry.name, entry.project);
+        test->setOutDir(out_dir);
+        test->setVerbose(true);
+        passed &= test->run();
+        test->print();
+    }
+
+    return !passed;
 }
+
+#endif
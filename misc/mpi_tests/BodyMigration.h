@@ -0,0 +1,375 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Migration of ChBodyDEMMPI bodies between domains with packed POD buffers.
+//
+// Instead of serializing each body through the stream archive, a migrating
+// body is sent as one fixed-size record (BodyStateRecord, inertia, and the
+// indices of its collision shape and material in tables known to all ranks).
+// The receiving rank rebuilds the collision model from the shape table, or
+// just updates the state if it already holds a copy of the body (ghost).
+//
+// Bodies are registered with their shape and material when created. The
+// tables (and the body-to-index map) are exchanged once, then again only if a
+// rank registered a shape or material unknown to the others; registering more
+// bodies of known shapes only exchanges their 12-byte map entries.
+//
+// Migrate is collective: each rank sends the bodies it owned under the old
+// partitioning and that fall outside its new domain, one buffer per receiving
+// rank (point-to-point, only to the ranks that receive bodies), and removes
+// its copies of the sent bodies. The default inter-domain update that follows
+// (ChSystemMPI::CustomEndOfStep) then only sees the bodies on their new
+// owners, and sends ghost copies back as usual where the bodies still overlap
+// the old domain.
+//
+// =============================================================================
+
+#ifndef BODY_MIGRATION_H
+#define BODY_MIGRATION_H
+
+#include <map>
+#include <vector>
+
+#include <mpi.h>
+
+#include "unit_MPI/ChSystemMPI.h"
+#include "unit_MPI/ChBodyDEMMPI.h"
+
+#include "BodyStateIO.h"
+
+class DEMBodyMigrator {
+  public:
+    enum ShapeType { SPHERE, BOX };
+
+    /// Collision shape of a body (sphere radius, or box half dimensions).
+    struct Shape {
+        int type;
+        double size[3];
+        bool operator==(const Shape& other) const {
+            return type == other.type && size[0] == other.size[0] && size[1] == other.size[1] &&
+                   size[2] == other.size[2];
+        }
+    };
+
+    /// Contact material of a body.
+    struct Material {
+        double spring;   ///< normal spring coefficient
+        double damping;  ///< normal damping coefficient
+        bool operator==(const Material& other) const {
+            return spring == other.spring && damping == other.damping;
+        }
+    };
+
+    static Shape Sphere(double radius) {
+        Shape s = {SPHERE, {radius, radius, radius}};
+        return s;
+    }
+    static Shape Box(double hx, double hy, double hz) {
+        Shape s = {BOX, {hx, hy, hz}};
+        return s;
+    }
+
+    DEMBodyMigrator() : m_tables_dirty(false), m_bytes_sent(0), m_num_sent(0) {}
+
+    /// Register a body, created on this rank, with its collision shape (its material is read from the body).
+    void Register(chrono::ChBodyDEMMPI& body, const Shape& shape) {
+        Material material = {body.GetSpringCoefficient(), body.GetDampingCoefficient()};
+        Entry entry = {body.GetIdentifier(), FindOrAdd(m_shapes, shape), FindOrAdd(m_materials, material)};
+        m_pending.push_back(entry);
+        m_index[entry.id] = entry;
+    }
+
+    /// Send the bodies owned under the old domain box of this rank and outside its new one (the current domain of
+    /// the node, already set up) to their new owners. Collective. Return the number of bodies received.
+    int Migrate(chrono::ChSystemMPI& mySys,
+                const chrono::ChVector<>& old_min,
+                const chrono::ChVector<>& old_max,
+                const chrono::ChVector<>& new_min,
+                const chrono::ChVector<>& new_max,
+                MPI_Comm comm = MPI_COMM_WORLD) {
+        int rank, num_ranks;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &num_ranks);
+        ExchangeTables(comm);
+
+        double box[6] = {new_min.x, new_min.y, new_min.z, new_max.x, new_max.y, new_max.z};
+        std::vector<double> boxes(6 * num_ranks);
+        MPI_Allgather(box, 6, MPI_DOUBLE, &boxes[0], 6, MPI_DOUBLE, comm);
+
+        // Pack the leaving bodies per destination, and index the local bodies (to update ghosts in place)
+        std::vector<std::vector<Record> > outgoing(num_ranks);
+        std::vector<chrono::ChBodyDEMMPI*> leaving;
+        std::map<int, chrono::ChBodyDEMMPI*> local;
+        for (unsigned int i = 0; i < mySys.Get_otherphysicslist()->size(); i++) {
+            chrono::ChBodyDEMMPI* body = dynamic_cast<chrono::ChBodyDEMMPI*>(&(*(*mySys.Get_otherphysicslist())[i]));
+            if (!body)
+                continue;
+            local[body->GetIdentifier()] = body;
+            chrono::ChVector<> pos = body->GetPos();
+            if (body->GetBodyFixed() || !Inside(pos, old_min, old_max) || Inside(pos, new_min, new_max))
+                continue;
+            std::map<int, Entry>::const_iterator entry = m_index.find(body->GetIdentifier());
+            if (entry == m_index.end())
+                continue;  // not registered, left to the default migration
+            int owner = Owner(boxes, pos);
+            if (owner < 0 || owner == rank)
+                continue;
+            Record r;
+            FillBodyState(*body, r.state);
+            chrono::ChVector<> inertia = body->GetInertiaXX();
+            r.inertia[0] = inertia.x;
+            r.inertia[1] = inertia.y;
+            r.inertia[2] = inertia.z;
+            r.shape = entry->second.shape;
+            r.material = entry->second.material;
+            outgoing[owner].push_back(r);
+            leaving.push_back(body);
+        }
+
+        // Number of records from each rank, then one message per non-empty buffer
+        std::vector<int> send_counts(num_ranks), recv_counts(num_ranks);
+        for (int r = 0; r < num_ranks; r++)
+            send_counts[r] = (int)outgoing[r].size();
+        MPI_Alltoall(&send_counts[0], 1, MPI_INT, &recv_counts[0], 1, MPI_INT, comm);
+
+        std::vector<std::vector<Record> > incoming(num_ranks);
+        std::vector<MPI_Request> requests;
+        for (int r = 0; r < num_ranks; r++) {
+            if (recv_counts[r] == 0)
+                continue;
+            incoming[r].resize(recv_counts[r]);
+            requests.push_back(MPI_Request());
+            MPI_Irecv(&incoming[r][0], (int)(recv_counts[r] * sizeof(Record)), MPI_BYTE, r, 0, comm,
+                      &requests.back());
+        }
+        for (int r = 0; r < num_ranks; r++) {
+            if (send_counts[r] == 0)
+                continue;
+            requests.push_back(MPI_Request());
+            MPI_Isend(&outgoing[r][0], (int)(send_counts[r] * sizeof(Record)), MPI_BYTE, r, 0, comm,
+                      &requests.back());
+            m_bytes_sent += send_counts[r] * sizeof(Record);
+            m_num_sent += send_counts[r];
+        }
+        if (!requests.empty())
+            MPI_Waitall((int)requests.size(), &requests[0], MPI_STATUSES_IGNORE);
+
+        // Remove the sent bodies (the shared pointer takes its own reference on the item)
+        for (size_t i = 0; i < leaving.size(); i++) {
+            local.erase(leaving[i]->GetIdentifier());
+            leaving[i]->AddRef();
+            mySys.Remove(chrono::ChSharedPtr<chrono::ChPhysicsItem>(leaving[i]));
+        }
+
+        // Update the local copies, or create the bodies
+        int received = 0;
+        for (int r = 0; r < num_ranks; r++) {
+            for (size_t i = 0; i < incoming[r].size(); i++) {
+                const Record& rec = incoming[r][i];
+                std::map<int, chrono::ChBodyDEMMPI*>::iterator it = local.find(rec.state.id);
+                if (it != local.end()) {
+                    ApplyBodyState(rec.state, *it->second);
+                } else {
+                    chrono::ChSharedPtr<chrono::ChBodyDEMMPI> mybody(new chrono::ChBodyDEMMPI);
+                    Create(rec, *mybody);
+                    mySys.Add(mybody);
+                    ApplyBodyState(rec.state, *mybody);
+                    mybody->GetCollisionModel()->SyncPosition();
+                    mybody->Update();
+                }
+                received++;
+            }
+        }
+        return received;
+    }
+
+    /// Set the collision shape of the records of the registered bodies (the others keep an unknown shape). Collective,
+    /// since the registrations of all ranks are exchanged first (a body may have been created on another rank).
+    void SetShapes(std::vector<BodyStateRecord>& records, MPI_Comm comm = MPI_COMM_WORLD) {
+        ExchangeTables(comm);
+        for (size_t i = 0; i < records.size(); i++) {
+            std::map<int, Entry>::const_iterator entry = m_index.find(records[i].id);
+            if (entry == m_index.end())
+                continue;
+            const Shape& shape = m_shapes[entry->second.shape];
+            records[i].shape = shape.type == SPHERE ? BODY_SHAPE_SPHERE : BODY_SHAPE_BOX;
+            for (int k = 0; k < 3; k++)
+                records[i].size[k] = shape.size[k];
+        }
+    }
+
+    /// Return the number of bodies (not fixed) with their center inside the domain of the given node, summed over all
+    /// ranks. Collective. Each body is owned by exactly one rank, so the count must not change when migrating.
+    static int CountOwned(chrono::ChSystemMPI& mySys, chrono::ChDomainNodeMPI* node, MPI_Comm comm = MPI_COMM_WORLD) {
+        int owned = 0;
+        for (unsigned int i = 0; i < mySys.Get_otherphysicslist()->size(); i++) {
+            chrono::ChBodyDEMMPI* body = dynamic_cast<chrono::ChBodyDEMMPI*>(&(*(*mySys.Get_otherphysicslist())[i]));
+            if (body && !body->GetBodyFixed() && node->IsInto(body->GetPos()))
+                owned++;
+        }
+        int total = 0;
+        MPI_Allreduce(&owned, &total, 1, MPI_INT, MPI_SUM, comm);
+        return total;
+    }
+
+    /// Total size of the migration buffers sent by this rank so far, in bytes.
+    unsigned long long GetBytesSent() const { return m_bytes_sent; }
+
+    /// Total number of bodies sent by this rank so far.
+    unsigned long long GetNumSent() const { return m_num_sent; }
+
+    /// Size of the record of one migrating body, in bytes.
+    static size_t GetRecordSize() { return sizeof(Record); }
+
+  private:
+    struct Entry {
+        int id;
+        int shape;
+        int material;
+    };
+
+    struct Record {
+        BodyStateRecord state;
+        double inertia[3];
+        int shape;
+        int material;
+    };
+
+    template <class T>
+    int FindOrAdd(std::vector<T>& table, const T& value) {
+        for (size_t i = 0; i < table.size(); i++) {
+            if (table[i] == value)
+                return (int)i;
+        }
+        table.push_back(value);
+        m_tables_dirty = true;
+        return (int)table.size() - 1;
+    }
+
+    // Merge the tables of all ranks (in rank order, so all ranks build the same global tables) if any rank added a
+    // shape or material, then share the pending registrations with their global indices.
+    void ExchangeTables(MPI_Comm comm) {
+        int dirty = m_tables_dirty ? 1 : 0;
+        int any_dirty = 0;
+        int pending = (int)m_pending.size();
+        int any_pending = 0;
+        MPI_Allreduce(&dirty, &any_dirty, 1, MPI_INT, MPI_MAX, comm);
+        MPI_Allreduce(&pending, &any_pending, 1, MPI_INT, MPI_MAX, comm);
+
+        if (any_dirty) {
+            std::vector<int> shape_map, material_map;
+            MergeTable(m_shapes, shape_map, comm);
+            MergeTable(m_materials, material_map, comm);
+            for (size_t i = 0; i < m_pending.size(); i++) {
+                m_pending[i].shape = shape_map[m_pending[i].shape];
+                m_pending[i].material = material_map[m_pending[i].material];
+            }
+            m_tables_dirty = false;
+        }
+
+        if (any_pending) {
+            std::vector<Entry> all;
+            AllGather(m_pending, all, comm);
+            for (size_t i = 0; i < all.size(); i++)
+                m_index[all[i].id] = all[i];
+            m_pending.clear();
+        }
+    }
+
+    // Replace the local table with the union of the tables of all ranks, and return the map from the local to the
+    // global indices.
+    template <class T>
+    void MergeTable(std::vector<T>& table, std::vector<int>& local_to_global, MPI_Comm comm) {
+        int rank;
+        MPI_Comm_rank(comm, &rank);
+        int num_ranks;
+        MPI_Comm_size(comm, &num_ranks);
+
+        std::vector<int> counts(num_ranks);
+        int count = (int)table.size();
+        MPI_Allgather(&count, 1, MPI_INT, &counts[0], 1, MPI_INT, comm);
+        std::vector<T> all;
+        AllGather(table, all, comm);
+
+        std::vector<T> merged;
+        local_to_global.clear();
+        size_t k = 0;
+        for (int r = 0; r < num_ranks; r++) {
+            for (int i = 0; i < counts[r]; i++, k++) {
+                size_t j = 0;
+                while (j < merged.size() && !(merged[j] == all[k]))
+                    j++;
+                if (j == merged.size())
+                    merged.push_back(all[k]);
+                if (r == rank)
+                    local_to_global.push_back((int)j);
+            }
+        }
+        table.swap(merged);
+    }
+
+    template <class T>
+    static void AllGather(const std::vector<T>& local, std::vector<T>& all, MPI_Comm comm) {
+        int num_ranks;
+        MPI_Comm_size(comm, &num_ranks);
+        int bytes = (int)(local.size() * sizeof(T));
+        std::vector<int> counts(num_ranks), offsets(num_ranks, 0);
+        MPI_Allgather(&bytes, 1, MPI_INT, &counts[0], 1, MPI_INT, comm);
+        int total = 0;
+        for (int r = 0; r < num_ranks; r++) {
+            offsets[r] = total;
+            total += counts[r];
+        }
+        all.resize(total / sizeof(T));
+        MPI_Allgatherv(local.empty() ? NULL : (void*)&local[0], bytes, MPI_BYTE, all.empty() ? NULL : (void*)&all[0],
+                       &counts[0], &offsets[0], MPI_BYTE, comm);
+    }
+
+    static bool Inside(const chrono::ChVector<>& p, const chrono::ChVector<>& lo, const chrono::ChVector<>& hi) {
+        return p.x >= lo.x && p.x < hi.x && p.y >= lo.y && p.y < hi.y && p.z >= lo.z && p.z < hi.z;
+    }
+
+    static int Owner(const std::vector<double>& boxes, const chrono::ChVector<>& p) {
+        int num_ranks = (int)boxes.size() / 6;
+        for (int r = 0; r < num_ranks; r++) {
+            const double* b = &boxes[6 * r];
+            if (Inside(p, chrono::ChVector<>(b[0], b[1], b[2]), chrono::ChVector<>(b[3], b[4], b[5])))
+                return r;
+        }
+        return -1;
+    }
+
+    void Create(const Record& rec, chrono::ChBodyDEMMPI& body) const {
+        const Shape& shape = m_shapes[rec.shape];
+        const Material& material = m_materials[rec.material];
+        body.SetCollide(true);
+        body.GetCollisionModel()->ClearModel();
+        if (shape.type == SPHERE)
+            body.GetCollisionModel()->AddSphere(shape.size[0]);
+        else
+            body.GetCollisionModel()->AddBox(shape.size[0], shape.size[1], shape.size[2]);
+        body.GetCollisionModel()->BuildModel();
+        body.SetInertiaXX(chrono::ChVector<>(rec.inertia[0], rec.inertia[1], rec.inertia[2]));
+        body.SetSpringCoefficient((float)material.spring);
+        body.SetDampingCoefficient((float)material.damping);
+    }
+
+    std::vector<Shape> m_shapes;
+    std::vector<Material> m_materials;
+    std::map<int, Entry> m_index;  ///< shape and material of the registered bodies of all ranks
+    std::vector<Entry> m_pending;  ///< registrations not yet sent to the other ranks
+    bool m_tables_dirty;
+    unsigned long long m_bytes_sent;
+    unsigned long long m_num_sent;
+};
+
+#endif
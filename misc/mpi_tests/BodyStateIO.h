@@ -0,0 +1,294 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Collective binary output of the body states of a domain-decomposed
+// ChSystemMPI, and the matching parallel restart reader.
+//
+// Each rank collects the bodies it owns (center inside its domain, so shared
+// copies in the neighbor domains are written once) as fixed-size records. The
+// file offset of each rank follows from an exclusive scan of the record
+// counts, and all ranks write their records at once with MPI-IO, so the output
+// time depends on the file system bandwidth rather than on the number of
+// ranks (unlike CHMPIfile::WriteOrdered, which serializes the ranks).
+//
+// The reader splits the records of a file evenly among the ranks (each reads
+// one contiguous slice), then sends each record to the rank whose domain box
+// contains its position (or the nearest domain), so a file can be read back
+// with any number of ranks and any partitioning.
+//
+// The records also hold the collision shape of the bodies (sphere or box) and
+// their inertia, so that a restart can rebuild the bodies as they were. The
+// shape cannot be read back from a body, so it is set by the writer (e.g. with
+// DEMBodyMigrator::SetShapes) and is BODY_SHAPE_UNKNOWN otherwise.
+//
+// File layout (native byte order):
+//   header: magic "CHBS", uint32 version, uint32 record size, uint32 number of
+//           ranks that wrote the file, double time, uint64 number of records
+//   records: BodyStateRecord, ordered by writing rank
+//
+// =============================================================================
+
+#ifndef BODY_STATE_IO_H
+#define BODY_STATE_IO_H
+
+#include <cstring>
+#include <vector>
+
+#include <mpi.h>
+
+#include "unit_MPI/ChSystemMPI.h"
+
+/// Collision shape of a body in a record.
+enum BodyShape { BODY_SHAPE_UNKNOWN, BODY_SHAPE_SPHERE, BODY_SHAPE_BOX };
+
+/// Version of the file layout.
+const unsigned int kBodyStateVersion = 2;
+
+/// State of one body.
+struct BodyStateRecord {
+    int id;             ///< body identifier
+    int fixed;          ///< 1 if the body is fixed
+    int shape;          ///< collision shape (BodyShape)
+    int padding;
+    double size[3];     ///< sphere radius, or box half dimensions
+    double mass;        ///< mass
+    double inertia[3];  ///< moments of inertia
+    double pos[3];      ///< position
+    double rot[4];      ///< rotation quaternion (e0, e1, e2, e3)
+    double pos_dt[3];   ///< linear velocity
+    double wvel[3];     ///< angular velocity (absolute frame)
+};
+
+struct BodyStateHeader {
+    char magic[4];
+    unsigned int version;
+    unsigned int record_size;
+    unsigned int num_ranks;
+    double time;
+    unsigned long long num_records;
+};
+
+/// Fill the record of a body (with an unknown shape).
+template <class BODY>
+void FillBodyState(BODY& body, BodyStateRecord& r) {
+    r.id = body.GetIdentifier();
+    r.fixed = body.GetBodyFixed() ? 1 : 0;
+    r.shape = BODY_SHAPE_UNKNOWN;
+    r.padding = 0;
+    r.size[0] = r.size[1] = r.size[2] = 0;
+    r.mass = body.GetMass();
+    chrono::ChVector<> inertia = body.GetInertiaXX();
+    r.inertia[0] = inertia.x;
+    r.inertia[1] = inertia.y;
+    r.inertia[2] = inertia.z;
+    chrono::ChVector<> pos = body.GetPos();
+    chrono::ChQuaternion<> rot = body.GetRot();
+    chrono::ChVector<> pos_dt = body.GetPos_dt();
+    chrono::ChVector<> wvel = body.GetWvel_par();
+    r.pos[0] = pos.x;
+    r.pos[1] = pos.y;
+    r.pos[2] = pos.z;
+    r.rot[0] = rot.e0;
+    r.rot[1] = rot.e1;
+    r.rot[2] = rot.e2;
+    r.rot[3] = rot.e3;
+    r.pos_dt[0] = pos_dt.x;
+    r.pos_dt[1] = pos_dt.y;
+    r.pos_dt[2] = pos_dt.z;
+    r.wvel[0] = wvel.x;
+    r.wvel[1] = wvel.y;
+    r.wvel[2] = wvel.z;
+}
+
+/// Append the states of the bodies of type BODY in the given list (of pointers or shared pointers to physics items)
+/// whose center is inside the domain of the given node.
+template <class BODY, class LIST>
+void CollectBodyStates(LIST& list, chrono::ChDomainNodeMPI* node, std::vector<BodyStateRecord>& records) {
+    for (unsigned int i = 0; i < list.size(); i++) {
+        BODY* body = dynamic_cast<BODY*>(&(*list[i]));
+        if (!body || !node->IsInto(body->GetPos()))
+            continue;
+        BodyStateRecord r;
+        FillBodyState(*body, r);
+        records.push_back(r);
+    }
+}
+
+/// Set the position, rotation, velocities, mass and inertia of a body from its record.
+template <class BODY>
+void ApplyBodyState(const BodyStateRecord& r, BODY& body) {
+    body.SetIdentifier(r.id);
+    body.SetBodyFixed(r.fixed != 0);
+    body.SetMass(r.mass);
+    body.SetInertiaXX(chrono::ChVector<>(r.inertia[0], r.inertia[1], r.inertia[2]));
+    body.SetPos(chrono::ChVector<>(r.pos[0], r.pos[1], r.pos[2]));
+    body.SetRot(chrono::ChQuaternion<>(r.rot[0], r.rot[1], r.rot[2], r.rot[3]));
+    body.SetPos_dt(chrono::ChVector<>(r.pos_dt[0], r.pos_dt[1], r.pos_dt[2]));
+    body.SetWvel_par(chrono::ChVector<>(r.wvel[0], r.wvel[1], r.wvel[2]));
+}
+
+/// Write the records of all ranks to the given file. Collective. Return false on all ranks if the file could not be
+/// written.
+inline bool WriteBodyStates(const char* filename,
+                            double time,
+                            const std::vector<BodyStateRecord>& records,
+                            MPI_Comm comm = MPI_COMM_WORLD) {
+    int rank, num_ranks;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &num_ranks);
+
+    // Offset of the records of this rank, and total number of records
+    unsigned long long count = records.size();
+    unsigned long long first = 0;
+    unsigned long long total = 0;
+    MPI_Exscan(&count, &first, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm);
+    if (rank == 0)
+        first = 0;
+    MPI_Allreduce(&count, &total, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm);
+
+    MPI_File file;
+    int ok = MPI_File_open(comm, const_cast<char*>(filename), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+                           &file) == MPI_SUCCESS;
+    int all_ok = 0;
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, comm);
+    if (!all_ok) {
+        if (ok)
+            MPI_File_close(&file);
+        return false;
+    }
+
+    MPI_Offset size = sizeof(BodyStateHeader) + total * sizeof(BodyStateRecord);
+    ok = MPI_File_set_size(file, size) == MPI_SUCCESS;
+    if (rank == 0) {
+        BodyStateHeader header;
+        std::memcpy(header.magic, "CHBS", 4);
+        header.version = kBodyStateVersion;
+        header.record_size = sizeof(BodyStateRecord);
+        header.num_ranks = num_ranks;
+        header.time = time;
+        header.num_records = total;
+        ok &= MPI_File_write_at(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+    }
+    MPI_Offset offset = sizeof(BodyStateHeader) + first * sizeof(BodyStateRecord);
+    ok &= MPI_File_write_at_all(file, offset, records.empty() ? NULL : (void*)&records[0],
+                                (int)(records.size() * sizeof(BodyStateRecord)), MPI_BYTE,
+                                MPI_STATUS_IGNORE) == MPI_SUCCESS;
+    ok &= MPI_File_close(&file) == MPI_SUCCESS;
+
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, comm);
+    return all_ok != 0;
+}
+
+/// Read a file written by WriteBodyStates and return, on each rank, the records whose position is inside the given
+/// domain box of this rank (records outside all domains go to the nearest one). Collective. Return false on all ranks
+/// if the file could not be read or has an invalid header.
+inline bool ReadBodyStates(const char* filename,
+                           const chrono::ChVector<>& min_box,
+                           const chrono::ChVector<>& max_box,
+                           double& time,
+                           std::vector<BodyStateRecord>& records,
+                           MPI_Comm comm = MPI_COMM_WORLD) {
+    int rank, num_ranks;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &num_ranks);
+    records.clear();
+
+    MPI_File file;
+    int ok = MPI_File_open(comm, const_cast<char*>(filename), MPI_MODE_RDONLY, MPI_INFO_NULL, &file) == MPI_SUCCESS;
+    int all_ok = 0;
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, comm);
+    if (!all_ok) {
+        if (ok)
+            MPI_File_close(&file);
+        return false;
+    }
+
+    // Header (read by all ranks)
+    BodyStateHeader header;
+    ok = MPI_File_read_at_all(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS &&
+         std::memcmp(header.magic, "CHBS", 4) == 0 && header.version == kBodyStateVersion &&
+         header.record_size == sizeof(BodyStateRecord);
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, comm);
+    if (!all_ok) {
+        MPI_File_close(&file);
+        return false;
+    }
+    time = header.time;
+
+    // Contiguous slice of the records read by this rank
+    unsigned long long first = header.num_records * rank / num_ranks;
+    unsigned long long last = header.num_records * (rank + 1) / num_ranks;
+    std::vector<BodyStateRecord> slice((size_t)(last - first));
+    MPI_Offset offset = sizeof(BodyStateHeader) + first * sizeof(BodyStateRecord);
+    ok = MPI_File_read_at_all(file, offset, slice.empty() ? NULL : (void*)&slice[0],
+                              (int)(slice.size() * sizeof(BodyStateRecord)), MPI_BYTE,
+                              MPI_STATUS_IGNORE) == MPI_SUCCESS;
+    ok &= MPI_File_close(&file) == MPI_SUCCESS;
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, comm);
+    if (!all_ok)
+        return false;
+
+    // Domain boxes of all ranks
+    double box[6] = {min_box.x, min_box.y, min_box.z, max_box.x, max_box.y, max_box.z};
+    std::vector<double> boxes(6 * num_ranks);
+    MPI_Allgather(box, 6, MPI_DOUBLE, &boxes[0], 6, MPI_DOUBLE, comm);
+
+    // Owner of each record: the rank whose box contains it, or else the nearest box
+    std::vector<std::vector<BodyStateRecord> > outgoing(num_ranks);
+    for (size_t i = 0; i < slice.size(); i++) {
+        int owner = -1;
+        int nearest = 0;
+        double best = -1;
+        for (int r = 0; r < num_ranks && owner < 0; r++) {
+            const double* b = &boxes[6 * r];
+            const double* p = slice[i].pos;
+            if (p[0] >= b[0] && p[0] < b[3] && p[1] >= b[1] && p[1] < b[4] && p[2] >= b[2] && p[2] < b[5]) {
+                owner = r;
+                continue;
+            }
+            double d2 = 0;
+            for (int k = 0; k < 3; k++) {
+                double d = p[k] < b[k] ? b[k] - p[k] : (p[k] > b[3 + k] ? p[k] - b[3 + k] : 0);
+                d2 += d * d;
+            }
+            if (best < 0 || d2 < best) {
+                best = d2;
+                nearest = r;
+            }
+        }
+        if (owner < 0)
+            owner = nearest;
+        outgoing[owner].push_back(slice[i]);
+    }
+
+    // Exchange the records with their owners
+    std::vector<int> send_counts(num_ranks), recv_counts(num_ranks);
+    std::vector<int> send_offsets(num_ranks, 0), recv_offsets(num_ranks, 0);
+    std::vector<BodyStateRecord> send;
+    for (int r = 0; r < num_ranks; r++) {
+        send_offsets[r] = (int)(send.size() * sizeof(BodyStateRecord));
+        send_counts[r] = (int)(outgoing[r].size() * sizeof(BodyStateRecord));
+        send.insert(send.end(), outgoing[r].begin(), outgoing[r].end());
+    }
+    MPI_Alltoall(&send_counts[0], 1, MPI_INT, &recv_counts[0], 1, MPI_INT, comm);
+    int recv_bytes = 0;
+    for (int r = 0; r < num_ranks; r++) {
+        recv_offsets[r] = recv_bytes;
+        recv_bytes += recv_counts[r];
+    }
+    records.resize(recv_bytes / sizeof(BodyStateRecord));
+    MPI_Alltoallv(send.empty() ? NULL : (void*)&send[0], &send_counts[0], &send_offsets[0], MPI_BYTE,
+                  records.empty() ? NULL : (void*)&records[0], &recv_counts[0], &recv_offsets[0], MPI_BYTE, comm);
+    return true;
+}
+
+#endif
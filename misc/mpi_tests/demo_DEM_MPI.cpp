@@ -15,6 +15,10 @@
 //     - DEM3 and MPI
 // =============================================================================
 
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
 #include "unit_MPI/ChContactContainerDEMMPI.h"
 
 #include "lcp/ChVariablesGeneric.h"
@@ -28,6 +32,11 @@
 #include "unit_MPI/ChDomainGridPartitioning.h"
 #include "unit_MPI/ChSolverDEMMPI.h"
 
+#include <mpi.h>
+
+#include "BodyStateIO.h"
+#include "BodyMigration.h"
+
 // Use the namespace of Chrono
 
 using namespace chrono;
@@ -289,7 +298,50 @@ void add_falling_item(ChSystemMPI& mySys, double prad, double box_dim, double pm
     }
 }
 
-void add_batch(ChSystemMPI& mySys, double prad, double box_dim, double pmass, int n_batch, int n_curr_spheres) {
+// Recreate the particles (the non-fixed bodies) of a restart file assigned to this domain, with their saved shapes.
+// Return their number, or -1 (without creating any body) if the shape of a particle was not saved.
+int add_restart_particles(ChSystemMPI& mySys,
+                          const std::vector<BodyStateRecord>& records,
+                          DEMBodyMigrator* migrator = 0) {
+    for (size_t i = 0; i < records.size(); i++) {
+        if (!records[i].fixed && records[i].shape != BODY_SHAPE_SPHERE && records[i].shape != BODY_SHAPE_BOX)
+            return -1;
+    }
+
+    int n = 0;
+    for (size_t i = 0; i < records.size(); i++) {
+        if (records[i].fixed)
+            continue;
+        const double* size = records[i].size;
+        ChSharedPtr<ChBodyDEMMPI> mybody(new ChBodyDEMMPI);
+        mybody->SetCollide(true);
+        mybody->GetCollisionModel()->ClearModel();
+        if (records[i].shape == BODY_SHAPE_SPHERE)
+            mybody->GetCollisionModel()->AddSphere(size[0]);
+        else
+            mybody->GetCollisionModel()->AddBox(size[0], size[1], size[2]);
+        mybody->GetCollisionModel()->BuildModel();
+        mySys.Add(mybody);
+        ApplyBodyState(records[i], *mybody);
+        if (migrator) {
+            migrator->Register(*mybody, records[i].shape == BODY_SHAPE_SPHERE
+                                            ? DEMBodyMigrator::Sphere(size[0])
+                                            : DEMBodyMigrator::Box(size[0], size[1], size[2]));
+        }
+        mybody->GetCollisionModel()->SyncPosition();
+        mybody->Update();
+        n++;
+    }
+    return n;
+}
+
+void add_batch(ChSystemMPI& mySys,
+               double prad,
+               double box_dim,
+               double pmass,
+               int n_batch,
+               int n_curr_spheres,
+               DEMBodyMigrator* migrator = 0) {
     int id_offset = 10;
     double particle_mass = 4.0;
     if (pmass > 0.0) {
@@ -316,6 +368,8 @@ void add_batch(ChSystemMPI& mySys, double prad, double box_dim, double pmass, in
             mybody->SetPos(particle_pos);
             mybody->SetInertiaXX((2.0 / 5.0) * particle_mass * pow(prad, 2) * ChVector<>(1, 1, 1));
             mybody->SetMass(particle_mass);
+            if (migrator)
+                migrator->Register(*mybody, DEMBodyMigrator::Sphere(prad));
             mybody->GetCollisionModel()->SyncPosition();  // really necessary?
             mybody->Update();                             // really necessary?
         }
@@ -335,6 +389,8 @@ void add_batch(ChSystemMPI& mySys, double prad, double box_dim, double pmass, in
             mybody->SetPos(particle_pos);
             mybody->SetInertiaXX((2.0 / 5.0) * particle_mass * pow(prad, 2) * ChVector<>(1, 1, 1));
             mybody->SetMass(particle_mass);
+            if (migrator)
+                migrator->Register(*mybody, DEMBodyMigrator::Sphere(prad));
             mybody->GetCollisionModel()->SyncPosition();  // really necessary?
             mybody->Update();                             // really necessary?
         }
@@ -355,6 +411,8 @@ void add_batch(ChSystemMPI& mySys, double prad, double box_dim, double pmass, in
             mybody->SetPos(particle_pos);
             mybody->SetInertiaXX((2.0 / 5.0) * particle_mass * pow(prad, 2) * ChVector<>(1, 1, 1));
             mybody->SetMass(particle_mass);
+            if (migrator)
+                migrator->Register(*mybody, DEMBodyMigrator::Sphere(prad));
             mybody->GetCollisionModel()->SyncPosition();  // really necessary?
             mybody->Update();                             // really necessary?
         }
@@ -374,6 +432,8 @@ void add_batch(ChSystemMPI& mySys, double prad, double box_dim, double pmass, in
             mybody->SetPos(particle_pos);
             mybody->SetInertiaXX((2.0 / 5.0) * particle_mass * pow(prad, 2) * ChVector<>(1, 1, 1));
             mybody->SetMass(particle_mass);
+            if (migrator)
+                migrator->Register(*mybody, DEMBodyMigrator::Sphere(prad));
             mybody->GetCollisionModel()->SyncPosition();  // really necessary?
             mybody->Update();                             // really necessary?
         }
@@ -882,6 +942,173 @@ void add_fancy_items(ChSystemMPI& mySys,
     }
 }
 
+// Write the aabb of the domain of each rank (one line per rank, in rank order) to the given file, replacing any
+// previous version of it. Collective.
+void write_domain_boxes(ChSystemMPI& mySys, const char* filename) {
+    // Delete the previous file, if any (otherwise it might only be partially overwritten)
+    if (CHMPI::CommRank() == 0)
+        MPI_File_delete(const_cast<char*>(filename), MPI_INFO_NULL);
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    ChDomainNodeMPIgrid3D* node = (ChDomainNodeMPIgrid3D*)mySys.nodeMPI;
+    CHMPIfile* domainfile = new CHMPIfile(filename, CHMPIfile::CHMPI_MODE_WRONLY | CHMPIfile::CHMPI_MODE_CREATE);
+    char buffer[100];
+    sprintf(buffer, "%d, %g, %g, %g, %g, %g, %g ,\n", node->id_MPI, node->min_box.x, node->min_box.y, node->min_box.z,
+            node->max_box.x, node->max_box.y, node->max_box.z);
+    domainfile->WriteOrdered((char*)buffer, strlen(buffer));
+    delete domainfile;
+}
+
+// Dynamic load balancing of a ChDomainGridPartitioning with one domain per rank along X (a single cut in Y and Z).
+//
+// Every rebalancing interval, each rank measures its load: the moving bodies it owns (center inside its domain), the
+// contacts it processes, and its wall time in DoStepDynamics. The step time includes the waits in the inter-domain
+// exchanges, so all ranks measure about the same value; the work of a domain is instead estimated as its number of
+// bodies plus its number of contacts, spread over its bodies. The bodies of all ranks are binned along X, weighted by
+// the work per body of their owner, and the interior cut planes are moved to the quantiles of the cumulative work when
+// the imbalance (maximum over mean work) exceeds a threshold. Each cut moves by at most a fraction of the smaller of
+// its two adjacent domains, so a body can only migrate to a neighbor domain. All ranks compute the same cuts from the
+// same reduced data.
+class GridRebalancer {
+  public:
+    struct Record {
+        int step;
+        double imbalance;  // maximum over mean work
+        int min_bodies;
+        int max_bodies;
+        int max_contacts;
+        double max_step_time;  // wall time per step of the slowest rank
+        bool rebalanced;
+    };
+
+    GridRebalancer(const std::vector<double>& x_s,  // widths of the domains along X
+                   double x_min,                    // lower bound of the first domain
+                   double threshold = 1.1,          // imbalance that triggers a rebalancing
+                   double max_shift = 0.5,          // maximum move of a cut, relative to its adjacent domains
+                   int bins_per_domain = 32         // resolution of the work histogram
+                   )
+        : m_x_min(x_min),
+          m_threshold(threshold),
+          m_max_shift(max_shift),
+          m_num_bins(bins_per_domain * (int)x_s.size()) {
+        m_x_max = x_min;
+        for (size_t i = 0; i < x_s.size(); i++)
+            m_x_max += x_s[i];
+        m_step_time = 0;
+        m_num_steps = 0;
+    }
+
+    /// Add the wall time of one step of this rank.
+    void AddStepTime(double time) {
+        m_step_time += time;
+        m_num_steps++;
+    }
+
+    /// Measure the loads of all ranks and update the domain widths if needed. Collective: must be called by all ranks
+    /// at the same step. Return true if the widths were changed (the node must then be set up again).
+    bool Rebalance(ChSystemMPI& mySys, int step, std::vector<double>& x_s) {
+        int numprocs = (int)x_s.size();
+        std::vector<ChVector<> > positions;
+        for (unsigned int i = 0; i < mySys.Get_otherphysicslist()->size(); i++) {
+            ChBodyDEMMPI* body = dynamic_cast<ChBodyDEMMPI*>(&(*(*mySys.Get_otherphysicslist())[i]));
+            if (body && !body->GetBodyFixed() && mySys.nodeMPI->IsInto(body->GetPos()))
+                positions.push_back(body->GetPos());
+        }
+
+        // Loads of all ranks: bodies, contacts, step time
+        double local[3] = {(double)positions.size(), (double)mySys.GetNcontacts(),
+                           m_num_steps > 0 ? m_step_time / m_num_steps : 0};
+        std::vector<double> loads(3 * numprocs);
+        MPI_Allgather(local, 3, MPI_DOUBLE, &loads[0], 3, MPI_DOUBLE, MPI_COMM_WORLD);
+        m_step_time = 0;
+        m_num_steps = 0;
+
+        // Work histogram along X
+        double work_per_body = positions.empty() ? 0 : (local[0] + local[1]) / positions.size();
+        std::vector<double> bins(m_num_bins, 0.0);
+        double bin_size = (m_x_max - m_x_min) / m_num_bins;
+        for (size_t i = 0; i < positions.size(); i++) {
+            int b = (int)((positions[i].x - m_x_min) / bin_size);
+            bins[std::max(0, std::min(m_num_bins - 1, b))] += work_per_body;
+        }
+        std::vector<double> work(m_num_bins);
+        MPI_Allreduce(&bins[0], &work[0], m_num_bins, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+        Record rec;
+        rec.step = step;
+        rec.min_bodies = (int)loads[0];
+        rec.max_bodies = 0;
+        rec.max_contacts = 0;
+        rec.max_step_time = 0;
+        double total = 0;
+        double max_work = 0;
+        for (int r = 0; r < numprocs; r++) {
+            double w = loads[3 * r] + loads[3 * r + 1];
+            total += w;
+            max_work = std::max(max_work, w);
+            rec.min_bodies = std::min(rec.min_bodies, (int)loads[3 * r]);
+            rec.max_bodies = std::max(rec.max_bodies, (int)loads[3 * r]);
+            rec.max_contacts = std::max(rec.max_contacts, (int)loads[3 * r + 1]);
+            rec.max_step_time = std::max(rec.max_step_time, loads[3 * r + 2]);
+        }
+        rec.imbalance = total > 0 ? max_work * numprocs / total : 1;
+        rec.rebalanced = rec.imbalance > m_threshold && numprocs > 1;
+
+        if (rec.rebalanced) {
+            // Current cuts, then cuts at the quantiles of the cumulative work (interpolated within the bins)
+            std::vector<double> cuts(numprocs + 1, m_x_min);
+            for (int i = 0; i < numprocs; i++)
+                cuts[i + 1] = cuts[i] + x_s[i];
+            std::vector<double> new_cuts(cuts);
+            double cumulative = 0;
+            int k = 1;
+            for (int b = 0; b < m_num_bins && k < numprocs; b++) {
+                while (k < numprocs && cumulative + work[b] >= total * k / numprocs) {
+                    double f = work[b] > 0 ? (total * k / numprocs - cumulative) / work[b] : 0;
+                    new_cuts[k] = m_x_min + (b + f) * bin_size;
+                    k++;
+                }
+                cumulative += work[b];
+            }
+            for (int i = 1; i < numprocs; i++) {
+                double shift = m_max_shift * std::min(cuts[i] - cuts[i - 1], cuts[i + 1] - cuts[i]);
+                new_cuts[i] = std::max(cuts[i] - shift, std::min(cuts[i] + shift, new_cuts[i]));
+            }
+            for (int i = 0; i < numprocs; i++)
+                x_s[i] = new_cuts[i + 1] - new_cuts[i];
+        }
+
+        m_history.push_back(rec);
+        return rec.rebalanced;
+    }
+
+    const std::vector<Record>& GetHistory() const { return m_history; }
+
+    /// Write the imbalance history (one line per rebalancing interval) to the given file.
+    void WriteHistory(const char* filename) const {
+        FILE* file = fopen(filename, "w");
+        if (!file)
+            return;
+        fprintf(file, "step, imbalance, min_bodies, max_bodies, max_contacts, max_step_time, rebalanced\n");
+        for (size_t i = 0; i < m_history.size(); i++) {
+            const Record& r = m_history[i];
+            fprintf(file, "%d, %g, %d, %d, %d, %g, %d\n", r.step, r.imbalance, r.min_bodies, r.max_bodies,
+                    r.max_contacts, r.max_step_time, r.rebalanced ? 1 : 0);
+        }
+        fclose(file);
+    }
+
+  private:
+    double m_x_min;
+    double m_x_max;
+    double m_threshold;
+    double m_max_shift;
+    int m_num_bins;
+    double m_step_time;
+    int m_num_steps;
+    std::vector<Record> m_history;
+};
+
 int main(int argc, char* argv[]) {
     double particle_radius = 0.1;
     int num_particles = 160;
@@ -903,9 +1130,12 @@ int main(int argc, char* argv[]) {
     double end_time = 4.0;
     int outMult = 3000;
     int addMult = 30000;
+    int balanceMult = 3000;
     int frame_number = 0;
     int fOuts = outMult;
     int fAdds = addMult;
+    int fBalance = 0;
+    int step_number = 0;
 
     GetLog() << "\n\n\n ----------------------------------------------\n";
 
@@ -920,6 +1150,9 @@ int main(int argc, char* argv[]) {
     int numprocs = CHMPI::CommSize();
     int myid = CHMPI::CommRank();
 
+    // Optionally restart from a body state file written by a previous run (e.g. output_DEM_MPI/state0042.bin)
+    const char* restart_file = argc > 1 ? argv[1] : 0;
+
     // Instead of using the usual ChSystem, rather use ChSystemMPI. It is
     // a specialized class for physical systems that can be used
     // for domain decomposition with MPI communication.
@@ -942,9 +1175,17 @@ int main(int argc, char* argv[]) {
     std::vector<double> x_s(4, 1.0);
     std::vector<double> y_s(1, 60.0);
     std::vector<double> z_s(1, 200.0);
-    ChDomainGridPartitioning mypartitioner(x_s, y_s, z_s, ChVector<>(-2, -10, -100));
+    ChVector<> grid_origin(-2, -10, -100);
+    ChDomainGridPartitioning mypartitioner(x_s, y_s, z_s, grid_origin);
     mypartitioner.SetupNode(mysystem.nodeMPI, myid);  // btw: please take care that must be numprocs=nx*ny*nz
 
+    // Move the X cut planes of the grid to equalize the work of the domains
+    bool rebalance = true;
+    GridRebalancer rebalancer(x_s, grid_origin.x);
+
+    // Send the particles changing domain at a rebalance as packed records
+    DEMBodyMigrator migrator;
+
     mysystem.SetSolverType(ChSystem::SOLVER_DEM);
     // Prepare the system with a special 'system descriptor'
     // that is necessary when doing simulations with MPI.
@@ -956,29 +1197,12 @@ int main(int argc, char* argv[]) {
     mysystem.ChangeSolverSpeed(&mysolver);
 
     GetLog() << "1\n";
-    // Save on file the aabb of the boundaries of each domain, for debugging/visualization
+    // Save on file the aabb of the boundaries of each domain, for debugging/visualization (written again after each
+    // rebalance)
     bool save_domain_boxes_on_file = false;
-    CHMPIfile* domainfile = 0;
-    if (save_domain_boxes_on_file) {
-        // CHMPIfile::FileDelete("output\\domains.dat"); // delete prev.file, if any. Otherwise might partially
-        // overwrite
-        // domainfile = new
-        // CHMPIfile("E:\\cygwin\\home\\heyn\\SVN_italy\\code\\code\\ChronoEngine\\bin\\data\\mpi\\output_DEM3_pills\\domains.dat",
-        // CHMPIfile::CHMPI_MODE_WRONLY | CHMPIfile::CHMPI_MODE_CREATE);
-        domainfile =
-            new CHMPIfile("output_DEM_MPI/domains.dat", CHMPIfile::CHMPI_MODE_WRONLY | CHMPIfile::CHMPI_MODE_CREATE);
-        GetLog() << "2\n";
-        char buffer[100];
-        sprintf(buffer, "%d, %g, %g, %g, %g, %g, %g ,\n", mysystem.nodeMPI->id_MPI,
-                ((ChDomainNodeMPIgrid3D*)mysystem.nodeMPI)->min_box.x,
-                ((ChDomainNodeMPIgrid3D*)mysystem.nodeMPI)->min_box.y,
-                ((ChDomainNodeMPIgrid3D*)mysystem.nodeMPI)->min_box.z,
-                ((ChDomainNodeMPIgrid3D*)mysystem.nodeMPI)->max_box.x,
-                ((ChDomainNodeMPIgrid3D*)mysystem.nodeMPI)->max_box.y,
-                ((ChDomainNodeMPIgrid3D*)mysystem.nodeMPI)->max_box.z);
-        domainfile->WriteOrdered((char*)buffer, strlen(buffer));
-        delete domainfile;
-    }
+    const char* domain_file = "output_DEM_MPI/domains.dat";
+    if (save_domain_boxes_on_file)
+        write_domain_boxes(mysystem, domain_file);
 
     // add some boundary boxes
     // create_boundary_boxes(mysystem, box, num_particles);
@@ -1029,13 +1253,42 @@ int main(int argc, char* argv[]) {
     bool save_positions_on_file = true;
     bool save_debug_files = false;
 
+    // Recreate the particles of the restart file in the domains containing them
+    if (restart_file) {
+        double restart_time = 0;
+        std::vector<BodyStateRecord> records;
+        ChDomainNodeMPIgrid3D* node = (ChDomainNodeMPIgrid3D*)mysystem.nodeMPI;
+        if (!ReadBodyStates(restart_file, node->min_box, node->max_box, restart_time, records)) {
+            if (myid == 0)
+                GetLog() << "ERROR: cannot read restart file " << restart_file << "\n";
+            CHMPI::Finalize();
+            return 1;
+        }
+        int local_particles = add_restart_particles(mysystem, records, &migrator);
+        int min_particles = 0;
+        MPI_Allreduce(&local_particles, &min_particles, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+        if (min_particles < 0) {
+            if (myid == 0)
+                GetLog() << "ERROR: restart file " << restart_file << " has particles without a saved shape\n";
+            CHMPI::Finalize();
+            return 1;
+        }
+        MPI_Allreduce(&local_particles, &curr_particles, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+        mysystem.SetChTime(restart_time);
+        frame_number = (int)(restart_time / (outMult * time_step) + 0.5);
+        fAdds = 0;
+        if (myid == 0)
+            GetLog() << "Restarted from " << restart_file << " at time " << restart_time << " with " << curr_particles
+                     << " particles\n";
+    }
+
     // Initial setup
     mysystem.CustomEndOfStep();  // some prob here
 
     while (mysystem.GetChTime() < end_time) {
         if (curr_particles < num_particles && fAdds == addMult) {
             // add_falling_item(mysystem, particle_radius, box, 0.0, curr_particles);
-            add_batch(mysystem, particle_radius, box, 0.0, num_batch, curr_particles);  // best
+            add_batch(mysystem, particle_radius, box, 0.0, num_batch, curr_particles, &migrator);  // best
             // add_fancy_items(mysystem, particle_radius, 0.0, width, gg, hh, 30, curr_particles);
             mysystem
                 .CustomEndOfStep();  //?????????????????????????????????????????????????????????????????????????????????????????
@@ -1052,13 +1305,14 @@ int main(int argc, char* argv[]) {
             // sprintf(filename,
             // "E:\\cygwin\\home\\heyn\\SVN_italy\\code\\code\\ChronoEngine\\bin\\data\\mpi\\output_DEM3_pills\\pos%s.dat",
             // padnumber+1);
-            sprintf(filename, "output_DEM_MPI/pos%s.dat", padnumber + 1);
+            sprintf(filename, "output_DEM_MPI/state%s.bin", padnumber + 1);
 
-            // CHMPIfile::FileDelete(filename); // Delete prev.,if any. Otherwise might partially overwrite
-            CHMPIfile* posfile = new CHMPIfile(filename, CHMPIfile::CHMPI_MODE_WRONLY | CHMPIfile::CHMPI_MODE_CREATE);
-            // mysystem.WriteOrderedDumpAABB(*posfile); //old, dump state instead
-            mysystem.WriteOrderedDumpState(*posfile);
-            delete posfile;
+            // Binary body states of all domains, written collectively (also usable as restart file)
+            std::vector<BodyStateRecord> records;
+            CollectBodyStates<ChBodyDEMMPI>(*mysystem.Get_otherphysicslist(), mysystem.nodeMPI, records);
+            migrator.SetShapes(records);
+            if (!WriteBodyStates(filename, mysystem.GetChTime(), records) && myid == 0)
+                GetLog() << "ERROR: cannot write " << filename << "\n";
 
             if (save_debug_files) {
                 // sprintf(filename,
@@ -1077,11 +1331,62 @@ int main(int argc, char* argv[]) {
         }
 
         // Advance the simulation time step
+        double step_start = MPI_Wtime();
         mysystem.DoStepDynamics(time_step);
+        rebalancer.AddStepTime(MPI_Wtime() - step_start);
+        step_number++;
         fOuts++;
         fAdds++;
+        fBalance++;
+
+        // Repartition and migrate the bodies to their new owners
+        if (rebalance && fBalance == balanceMult) {
+            if (rebalancer.Rebalance(mysystem, step_number, x_s)) {
+                ChDomainNodeMPIgrid3D* node = (ChDomainNodeMPIgrid3D*)mysystem.nodeMPI;
+                ChVector<> old_min = node->min_box;
+                ChVector<> old_max = node->max_box;
+                int num_owned = DEMBodyMigrator::CountOwned(mysystem, node);
+                ChDomainGridPartitioning newpartitioner(x_s, y_s, z_s, grid_origin);
+                newpartitioner.SetupNode(mysystem.nodeMPI, myid);
+                migrator.Migrate(mysystem, old_min, old_max, node->min_box, node->max_box);
+                mysystem.CustomEndOfStep();
+                int num_owned_new = DEMBodyMigrator::CountOwned(mysystem, node);
+                if (num_owned_new != num_owned) {
+                    if (myid == 0)
+                        GetLog() << "ERROR: " << num_owned << " bodies before the rebalance, " << num_owned_new
+                                 << " after\n";
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                if (save_domain_boxes_on_file)
+                    write_domain_boxes(mysystem, domain_file);
+            }
+            const GridRebalancer::Record& rec = rebalancer.GetHistory().back();
+            if (myid == 0) {
+                GetLog() << "step " << step_number << ": imbalance " << rec.imbalance << ", bodies " << rec.min_bodies
+                         << "-" << rec.max_bodies << ", max contacts " << rec.max_contacts << ", max step time "
+                         << rec.max_step_time << (rec.rebalanced ? " -> cuts at" : "");
+                double cut = grid_origin.x;
+                for (size_t i = 0; rec.rebalanced && i + 1 < x_s.size(); i++) {
+                    cut += x_s[i];
+                    GetLog() << " " << cut;
+                }
+                GetLog() << "\n";
+            }
+            fBalance = 0;
+        }
     }
 
+    if (myid == 0)
+        rebalancer.WriteHistory("output_DEM_MPI/imbalance.dat");
+
+    // Packed migration traffic of all ranks
+    unsigned long long local_migrated[2] = {migrator.GetNumSent(), migrator.GetBytesSent()};
+    unsigned long long migrated[2] = {0, 0};
+    MPI_Reduce(local_migrated, migrated, 2, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (myid == 0)
+        GetLog() << "Migrated " << (double)migrated[0] << " bodies in " << (double)migrated[1] << " bytes ("
+                 << (int)DEMBodyMigrator::GetRecordSize() << " bytes per body)\n";
+
     // Terminate the MPI functionality.
     CHMPI::Finalize();
     return 0;
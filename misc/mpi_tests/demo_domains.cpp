@@ -28,6 +28,8 @@
 #include "unit_MPI/ChDomainLatticePartitioning.h"
 #include "unit_MPI/ChIterativeSchwarzMPI.h"
 
+#include "BodyStateIO.h"
+
 // Remember to use the namespace 'chrono' because all classes
 // of Chrono::Engine belong to this namespace and its children...
 
@@ -206,12 +208,21 @@ int main(int argc, char* argv[]) {
             char filename[100];
 
             GetLog() << "\nID=" << myid << " frame=" << padnumber << "\n";
-            sprintf(filename, "output/pos%s.dat", padnumber + 1);
-
-            // CHMPIfile::FileDelete(filename); // Delete prev.,if any. Otherwise might partially overwrite
-            CHMPIfile* posfile = new CHMPIfile(filename, CHMPIfile::CHMPI_MODE_WRONLY | CHMPIfile::CHMPI_MODE_CREATE);
-            mysystem.WriteOrderedDumpAABB(*posfile);
-            delete posfile;
+            sprintf(filename, "output/state%s.bin", padnumber + 1);
+
+            // Binary body states of all domains, written collectively
+            std::vector<BodyStateRecord> records;
+            CollectBodyStates<ChBodyMPI>(*mysystem.Get_bodylist(), mysystem.nodeMPI, records);
+            for (size_t i = 0; i < records.size(); i++) {
+                // The ground is the only fixed body
+                BodyStateRecord& r = records[i];
+                r.shape = r.fixed ? BODY_SHAPE_BOX : BODY_SHAPE_SPHERE;
+                r.size[0] = r.fixed ? 2 : 0.1;
+                r.size[1] = 0.1;
+                r.size[2] = r.fixed ? 2 : 0.1;
+            }
+            if (!WriteBodyStates(filename, mysystem.GetChTime(), records) && myid == 0)
+                GetLog() << "ERROR: cannot write " << filename << "\n";
 
             sprintf(filename, "output/debug%s.dat", padnumber + 1);
             // CHMPIfile::FileDelete(filename); // Delete prev.,if any. Otherwise might partially overwrite
@@ -0,0 +1,288 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//   Demo code about
+//     - overlapping the Schwarz halo exchange with the local LCP iteration
+// =============================================================================
+//
+// The chain of demo_lcp_schwarz (monodimensional masses linked by bilateral
+// constraints, the first one fixed), extended to any number of domains: the
+// last mass of each domain is shared with the first mass of the next one.
+//
+// Each outer Schwarz iteration exchanges with the neighbor domains the impulse
+// that the local constraints apply to the shared masses (and their velocity,
+// to measure the mismatch of the copies), then runs the inner Gauss-Seidel
+// sweeps of the local constraints. The copy of a shared mass in each domain
+// feels the impulses of both domains, the remote one being the value of the
+// last exchange.
+//
+// Two variants are compared on the same problem:
+//  - blocking: MPI_Sendrecv with each neighbor, then the sweeps;
+//  - async: MPI_Isend/MPI_Irecv posted, the interior constraints (not touching
+//    a shared mass) of the first sweep done while the messages are in flight,
+//    then MPI_Waitall, the boundary constraints and the remaining sweeps.
+// For each variant the root rank prints the largest residual (constraint
+// violation or velocity mismatch of the copies of a shared mass) after each
+// outer iteration and the wall time per outer iteration (slowest rank).
+//
+// Usage: mpiexec -n <2..16> demo_lcp_schwarz_async [masses per domain] [outer iterations] [inner iterations]
+//
+// =============================================================================
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include <mpi.h>
+
+#include "lcp/ChVariablesGeneric.h"
+#include "lcp/ChConstraintTwoGeneric.h"
+#include "core/ChLinearAlgebra.h"
+#include "unit_MPI/ChMpi.h"
+
+using namespace chrono;
+
+class ChainSchwarz {
+  public:
+    ChainSchwarz(int n_masses, int myid, int numprocs) : m_myid(myid), m_numprocs(numprocs) {
+        for (int im = 0; im < n_masses; im++) {
+            m_vars.push_back(new ChVariablesGeneric(1));
+            m_vars[im]->GetMass()(0) = 10;
+            m_vars[im]->GetInvMass()(0) = 1. / m_vars[im]->GetMass()(0);
+            m_vars[im]->Get_fb()(0) = -9.8 * m_vars[im]->GetMass()(0) * 0.01;
+            if (im > 0) {
+                m_constraints.push_back(new ChConstraintTwoGeneric(m_vars[im], m_vars[im - 1]));
+                m_constraints[im - 1]->Set_b_i(0);
+                m_constraints[im - 1]->Get_Cq_a()->ElementN(0) = 1;
+                m_constraints[im - 1]->Get_Cq_b()->ElementN(0) = -1;
+            }
+        }
+
+        // First variable of 1st domain is 'fixed'
+        if (myid == 0)
+            m_vars[0]->SetDisabled(true);
+
+        for (unsigned int ic = 0; ic < m_constraints.size(); ic++)
+            m_constraints[ic]->Update_auxiliary();
+    }
+
+    ~ChainSchwarz() {
+        for (unsigned int ic = 0; ic < m_constraints.size(); ic++)
+            delete m_constraints[ic];
+        for (unsigned int im = 0; im < m_vars.size(); im++)
+            delete m_vars[im];
+    }
+
+    /// Solve from zero multipliers with the given number of outer (exchanges) and inner (local sweeps) iterations.
+    /// Collective. Fill the largest residual over all domains after each outer iteration, and return the wall time
+    /// per outer iteration of the slowest domain.
+    double Solve(int outer, int inner, bool async, std::vector<double>& residuals) {
+        Reset();
+        residuals.clear();
+
+        int nc = (int)m_constraints.size();
+        int first_interior = HasPrev() ? 1 : 0;
+        int last_interior = HasNext() ? nc - 1 : nc;
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        double start = MPI_Wtime();
+        double solve_time = 0;
+        for (int io = 0; io < outer; io++) {
+            if (async) {
+                MPI_Request requests[4];
+                int n_requests = PostHalo(requests);
+                Sweep(first_interior, last_interior);
+                MPI_Waitall(n_requests, requests, MPI_STATUSES_IGNORE);
+                ApplyHalo();
+                Sweep(0, first_interior);
+                Sweep(last_interior, nc);
+            } else {
+                ExchangeHalo();
+                Sweep(0, nc);
+            }
+            for (int ii = 1; ii < inner; ii++)
+                Sweep(0, nc);
+
+            // The residual reduction is not part of the timed iteration
+            solve_time += MPI_Wtime() - start;
+            double local = Residual();
+            double global = 0;
+            MPI_Allreduce(&local, &global, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+            residuals.push_back(global);
+            start = MPI_Wtime();
+        }
+
+        double max_time = 0;
+        MPI_Allreduce(&solve_time, &max_time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        return outer > 0 ? max_time / outer : 0;
+    }
+
+    std::vector<ChVariablesGeneric*>& GetVariables() { return m_vars; }
+    std::vector<ChConstraintTwoGeneric*>& GetConstraints() { return m_constraints; }
+
+  private:
+    bool HasPrev() const { return m_myid > 0; }
+    bool HasNext() const { return m_myid < m_numprocs - 1; }
+
+    // Impulses of the local constraints on the shared masses (first and last)
+    double ImpulseOnFirst() const {
+        return m_constraints.front()->Get_Cq_b()->ElementN(0) * m_constraints.front()->Get_l_i();
+    }
+    double ImpulseOnLast() const {
+        return m_constraints.back()->Get_Cq_a()->ElementN(0) * m_constraints.back()->Get_l_i();
+    }
+
+    void Reset() {
+        for (unsigned int ic = 0; ic < m_constraints.size(); ic++)
+            m_constraints[ic]->Set_l_i(0);
+        for (unsigned int im = 0; im < m_vars.size(); im++) {
+            ChVariablesGeneric* v = m_vars[im];
+            v->Get_qb()(0) = v->IsActive() ? v->GetInvMass()(0) * v->Get_fb()(0) : 0;
+        }
+        for (int k = 0; k < 2; k++) {
+            m_send[k][0] = m_send[k][1] = 0;
+            m_recv[k][0] = m_recv[k][1] = 0;
+            m_applied[k] = 0;
+        }
+    }
+
+    // Gauss-Seidel sweep of the constraints in [first, last)
+    void Sweep(int first, int last) {
+        for (int ic = first; ic < last; ic++) {
+            ChConstraintTwoGeneric* c = m_constraints[ic];
+            double residual = c->Compute_Cq_q() + c->Get_b_i();
+            double deltal = -residual / c->Get_g_i();
+            c->Set_l_i(c->Get_l_i() + deltal);
+            c->Increment_q(deltal);
+        }
+    }
+
+    // Impulses of the local constraints on the shared masses and their velocities, sent to the neighbors
+    void PackHalo() {
+        m_send[0][0] = HasPrev() ? ImpulseOnFirst() : 0;
+        m_send[0][1] = m_vars.front()->Get_qb()(0);
+        m_send[1][0] = HasNext() ? ImpulseOnLast() : 0;
+        m_send[1][1] = m_vars.back()->Get_qb()(0);
+    }
+
+    // Post the receives and sends of the halo. Return the number of requests.
+    int PostHalo(MPI_Request* requests) {
+        int n = 0;
+        PackHalo();
+        if (HasPrev()) {
+            MPI_Irecv(m_recv[0], 2, MPI_DOUBLE, m_myid - 1, 0, MPI_COMM_WORLD, &requests[n++]);
+            MPI_Isend(m_send[0], 2, MPI_DOUBLE, m_myid - 1, 0, MPI_COMM_WORLD, &requests[n++]);
+        }
+        if (HasNext()) {
+            MPI_Irecv(m_recv[1], 2, MPI_DOUBLE, m_myid + 1, 0, MPI_COMM_WORLD, &requests[n++]);
+            MPI_Isend(m_send[1], 2, MPI_DOUBLE, m_myid + 1, 0, MPI_COMM_WORLD, &requests[n++]);
+        }
+        return n;
+    }
+
+    void ExchangeHalo() {
+        PackHalo();
+        if (HasPrev())
+            MPI_Sendrecv(m_send[0], 2, MPI_DOUBLE, m_myid - 1, 0, m_recv[0], 2, MPI_DOUBLE, m_myid - 1, 0,
+                         MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        if (HasNext())
+            MPI_Sendrecv(m_send[1], 2, MPI_DOUBLE, m_myid + 1, 0, m_recv[1], 2, MPI_DOUBLE, m_myid + 1, 0,
+                         MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        ApplyHalo();
+    }
+
+    // Add to the shared masses the change of the impulses of the neighbor domains
+    void ApplyHalo() {
+        ChVariablesGeneric* shared[2] = {m_vars.front(), m_vars.back()};
+        for (int k = 0; k < 2; k++) {
+            if (shared[k]->IsActive())
+                shared[k]->Get_qb()(0) += shared[k]->GetInvMass()(0) * (m_recv[k][0] - m_applied[k]);
+            m_applied[k] = m_recv[k][0];
+        }
+    }
+
+    // Largest constraint residual, and difference of the shared masses with the last received neighbor copies
+    double Residual() const {
+        double max_res = 0;
+        for (unsigned int ic = 0; ic < m_constraints.size(); ic++)
+            max_res = ChMax(max_res, fabs(m_constraints[ic]->Compute_Cq_q() + m_constraints[ic]->Get_b_i()));
+        if (HasPrev())
+            max_res = ChMax(max_res, fabs(m_vars.front()->Get_qb()(0) - m_recv[0][1]));
+        if (HasNext())
+            max_res = ChMax(max_res, fabs(m_vars.back()->Get_qb()(0) - m_recv[1][1]));
+        return max_res;
+    }
+
+    int m_myid;
+    int m_numprocs;
+    std::vector<ChVariablesGeneric*> m_vars;
+    std::vector<ChConstraintTwoGeneric*> m_constraints;
+    double m_send[2][2];  ///< impulse on and velocity of the first and last masses, sent to the neighbors
+    double m_recv[2][2];  ///< impulse on and velocity of the shared masses in the previous and next domains
+    double m_applied[2];  ///< remote impulses already added to the shared masses
+};
+
+int main(int argc, char* argv[]) {
+    // Initialize the MPI functionality. Use the CHMPI static functions.
+    CHMPI::Init(argc, argv);
+
+    int numprocs = CHMPI::CommSize();
+    int myid = CHMPI::CommRank();
+
+    int n_masses = argc > 1 ? atoi(argv[1]) : 11;
+    int n_outer = argc > 2 ? atoi(argv[2]) : 20;
+    int n_inner = argc > 3 ? atoi(argv[3]) : 480;
+
+    if (numprocs < 2 || n_masses < 3) {
+        if (myid == 0) {
+            GetLog() << "ERROR: you must use at least 2 processes and 3 masses per domain! \n";
+            GetLog() << "       Note that this demo must be launched only \n"
+                     << "       using the 'mpiexec', from the MPI toolset! \n";
+        }
+        CHMPI::Finalize();
+        return 0;
+    }
+
+    if (myid == 0)
+        GetLog() << " Example: blocking vs overlapped halo exchange in a Schwarz LCP solver \n"
+                 << " " << numprocs << " domains, " << n_masses << " masses per domain, " << n_outer << " x "
+                 << n_inner << " iterations \n\n";
+
+    ChainSchwarz chain(n_masses, myid, numprocs);
+
+    std::vector<double> res_blocking, res_async;
+    double t_blocking = chain.Solve(n_outer, n_inner, false, res_blocking);
+    double t_async = chain.Solve(n_outer, n_inner, true, res_async);
+
+    if (myid == 0) {
+        GetLog() << "  outer   residual (blocking)   residual (async) \n";
+        for (int io = 0; io < n_outer; io++)
+            GetLog() << "  " << io + 1 << "   " << res_blocking[io] << "   " << res_async[io] << "\n";
+        GetLog() << "\n METRICS: ranks " << numprocs << "  time per outer iteration: blocking " << 1e6 * t_blocking
+                 << " us, async " << 1e6 * t_async << " us  (speedup " << (t_async > 0 ? t_blocking / t_async : 0)
+                 << ")\n";
+    }
+
+    // Tension in the first constraint of each domain, from the async solve
+    double lambda = chain.GetConstraints().front()->Get_l_i();
+    std::vector<double> lambdas(numprocs);
+    MPI_Gather(&lambda, 1, MPI_DOUBLE, &lambdas[0], 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    if (myid == 0) {
+        GetLog() << " Dual vars of the first constraint of each domain: \n";
+        for (int r = 0; r < numprocs; r++)
+            GetLog() << "   " << lambdas[r] << "\n";
+    }
+
+    // Terminate the MPI functionality.
+    CHMPI::Finalize();
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Binary restart snapshots of FEA simulations (e.g., ANCF shell meshes), for
+// long runs that must survive the interruption of a batch job.
+//
+// A snapshot holds the state vectors of the system: the positions and
+// directions (gradients) of all nodes, their time derivatives, the
+// accelerations, and the constraint reactions. The accelerations and reactions
+// are the history of the HHT integrator, which gathers them from the system at
+// the beginning of each step, so that a continued run takes the same steps as
+// an uninterrupted one. The step counter of the run, the simulation time, and
+// the number of nodes and elements of each mesh are stored as well.
+//
+// The elements of the shell tests have no internal variables beyond the node
+// state: the ANCF shell element with an elastic material only keeps its
+// reference configuration, computed again at the initial setup of the system.
+// A snapshot must therefore be read into a system constructed exactly as the
+// one it was written from (same meshes, nodes, and elements, in the same order)
+// and not yet advanced. A mismatch of the mesh sizes or of the state vectors
+// throws a ChException.
+//
+// WriteMeshSnapshot writes to a temporary file which then replaces the previous
+// snapshot, so that an interruption during a write leaves the last complete
+// snapshot in place.
+//
+// Shared by test_FEA_shellANCF and metrics_FEA_shellANCF (which includes it
+// from the top of the source tree, as "projects/MeshSnapshot.h").
+//
+// =============================================================================
+
+#ifndef MESH_SNAPSHOT_H
+#define MESH_SNAPSHOT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "chrono/core/ChException.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/fea/ChMesh.h"
+
+namespace chrono {
+namespace fea {
+
+namespace mesh_snapshot {
+
+const char kMagic[4] = {'C', 'H', 'M', 'S'};
+const uint32_t kVersion = 1;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    int64_t step;        // step counter of the run
+    double time;         // simulation time
+    int64_t num_meshes;  // followed by (num_nodes, num_elements) per mesh
+    int64_t num_x;       // size of the position state vector
+    int64_t num_v;       // size of the velocity (and acceleration) state vector
+    int64_t num_L;       // number of constraint reactions
+};
+
+inline std::vector<int64_t> MeshSizes(ChSystem& system) {
+    std::vector<int64_t> sizes;
+    for (const auto& mesh : system.Get_meshlist()) {
+        sizes.push_back(mesh->GetNnodes());
+        sizes.push_back(mesh->GetNelements());
+    }
+    return sizes;
+}
+
+}  // end namespace mesh_snapshot
+
+/// Write a snapshot of the system state, with the given step counter, to the specified file.
+/// Return false if the file cannot be written (in which case the previous snapshot is left unchanged).
+inline bool WriteMeshSnapshot(ChSystem& system, int step, const std::string& filename) {
+    using namespace mesh_snapshot;
+
+    system.Setup();
+    ChState x;
+    ChStateDelta v;
+    ChStateDelta a;
+    double time;
+    system.StateSetup(x, v, a);
+    system.StateGather(x, v, time);
+    system.StateGatherAcceleration(a);
+    ChVectorDynamic<> L;
+    L.setZero(system.GetNconstr());
+    system.StateGatherReactions(L);
+    std::vector<int64_t> sizes = MeshSizes(system);
+
+    Header header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.step = step;
+    header.time = time;
+    header.num_meshes = (int64_t)sizes.size() / 2;
+    header.num_x = x.size();
+    header.num_v = v.size();
+    header.num_L = L.size();
+
+    std::string tmp_filename = filename + ".tmp";
+    std::FILE* fp = std::fopen(tmp_filename.c_str(), "wb");
+    if (!fp)
+        return false;
+    bool ok = std::fwrite(&header, sizeof(header), 1, fp) == 1;
+    ok = ok && std::fwrite(sizes.data(), sizeof(int64_t), sizes.size(), fp) == sizes.size();
+    ok = ok && std::fwrite(x.data(), sizeof(double), x.size(), fp) == (size_t)x.size();
+    ok = ok && std::fwrite(v.data(), sizeof(double), v.size(), fp) == (size_t)v.size();
+    ok = ok && std::fwrite(a.data(), sizeof(double), a.size(), fp) == (size_t)a.size();
+    ok = ok && std::fwrite(L.data(), sizeof(double), L.size(), fp) == (size_t)L.size();
+    ok = (std::fclose(fp) == 0) && ok;
+    if (!ok) {
+        std::remove(tmp_filename.c_str());
+        return false;
+    }
+
+#if defined(_WIN32)
+    std::remove(filename.c_str());  // rename does not replace an existing file
+#endif
+    return std::rename(tmp_filename.c_str(), filename.c_str()) == 0;
+}
+
+/// Set the system to the state in the specified snapshot file, and return the step counter stored with it.
+/// Return false if the file does not exist or is not a snapshot; throw a ChException if the snapshot was
+/// written from a different system.
+inline bool ReadMeshSnapshot(ChSystem& system, int& step, const std::string& filename) {
+    using namespace mesh_snapshot;
+
+    std::FILE* fp = std::fopen(filename.c_str(), "rb");
+    if (!fp)
+        return false;
+    Header header;
+    if (std::fread(&header, sizeof(header), 1, fp) != 1 || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.version != kVersion) {
+        std::fclose(fp);
+        return false;
+    }
+
+    // Initial setup of the meshes (reference configuration of the elements) before the state is changed
+    system.SetupInitial();
+    system.Setup();
+
+    std::vector<int64_t> sizes(2 * header.num_meshes);
+    bool ok = std::fread(sizes.data(), sizeof(int64_t), sizes.size(), fp) == sizes.size();
+    if (!ok || sizes != MeshSizes(system) || header.num_x != system.GetNcoords_x() ||
+        header.num_v != system.GetNcoords_w() || header.num_L != system.GetNconstr()) {
+        std::fclose(fp);
+        throw ChException("ReadMeshSnapshot: the system does not match the snapshot " + filename);
+    }
+
+    ChState x;
+    ChStateDelta v;
+    ChStateDelta a;
+    system.StateSetup(x, v, a);
+    ChVectorDynamic<> L(header.num_L);
+    ok = std::fread(x.data(), sizeof(double), x.size(), fp) == (size_t)x.size();
+    ok = ok && std::fread(v.data(), sizeof(double), v.size(), fp) == (size_t)v.size();
+    ok = ok && std::fread(a.data(), sizeof(double), a.size(), fp) == (size_t)a.size();
+    ok = ok && std::fread(L.data(), sizeof(double), L.size(), fp) == (size_t)L.size();
+    std::fclose(fp);
+    if (!ok)
+        throw ChException("ReadMeshSnapshot: truncated snapshot " + filename);
+
+    system.StateScatter(x, v, header.time, true);
+    system.StateScatterAcceleration(a);
+    system.StateScatterReactions(L);
+    step = (int)header.step;
+    return true;
+}
+
+}  // end namespace fea
+}  // end namespace chrono
+
+#endif
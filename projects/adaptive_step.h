@@ -0,0 +1,282 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Adaptive step size control for Chrono::Multicore SMC granular simulations.
+//
+// After each step, the controller measures the maximum linear speed of all
+// bodies and the maximum contact overlap, both relative to the particle radius.
+// The next step is chosen so that no body travels more than a given fraction
+// of the radius in one step and the maximum overlap stays below a target
+// fraction of the radius; the step grows by at most a given factor per step
+// and is kept within [step_min, step_max]. step_max must not exceed the stable
+// step of the contact model (e.g., the fixed step previously used for quiet
+// phases).
+//
+// With rollback enabled, a step with an overlap above the (larger) maximum
+// allowed fraction is rejected: the body states and the SMC contact history
+// are restored and the step is repeated with a reduced step size. The contact
+// data left by a step describe the state before that step, so with rollback
+// the collision detection is run again on the new state before measuring the
+// overlap (one extra collision pass per step). Without rollback, the overlap
+// found at the beginning of the step is used to choose the next step.
+//
+// Rollback is only valid if the bodies carry the entire state of the system
+// (no shafts, motors with internal states, or external modules such as vehicle
+// drivers); otherwise use GetStep() and Update() around the caller's own step.
+//
+// The evolution of the step size (time, step, speed, overlap, rejected flag)
+// is recorded and can be written to a CSV file.
+//
+// =============================================================================
+
+#ifndef ADAPTIVE_STEP_H
+#define ADAPTIVE_STEP_H
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+
+class AdaptiveStepController {
+  public:
+    /// Create a controller for particles of given radius, with given step bounds and initial step.
+    AdaptiveStepController(double radius, double step_min, double step_max, double step_init)
+        : m_radius(radius),
+          m_step_min(step_min),
+          m_step_max(step_max),
+          m_step(std::min(std::max(step_init, step_min), step_max)),
+          m_max_travel(0.1),
+          m_target_overlap(0.02),
+          m_max_overlap(0.1),
+          m_growth(1.05),
+          m_shrink(0.5),
+          m_rollback(true),
+          m_num_steps(0),
+          m_num_rejected(0),
+          m_max_speed(0),
+          m_overlap(0) {}
+
+    /// Set the maximum distance traveled by any body in one step, as a fraction of the radius (default: 0.1).
+    void SetMaxTravel(double fraction) { m_max_travel = fraction; }
+
+    /// Set the target and maximum (rejection) contact overlaps, as fractions of the radius (default: 0.02 and 0.1).
+    void SetOverlap(double target, double max) {
+        m_target_overlap = target;
+        m_max_overlap = max;
+    }
+
+    /// Set the maximum growth factor of the step per step (default: 1.05) and the factor applied to the step after a
+    /// rejected step (default: 0.5).
+    void SetFactors(double growth, double shrink) {
+        m_growth = growth;
+        m_shrink = shrink;
+    }
+
+    /// Enable or disable rollback of rejected steps in DoStep (default: true).
+    void EnableRollback(bool rollback) { m_rollback = rollback; }
+
+    /// Return the step size to use for the next step.
+    double GetStep() const { return m_step; }
+
+    /// Advance the system by one (accepted) step. Return the step size taken.
+    double DoStep(chrono::ChSystemMulticore* system) {
+        while (true) {
+            if (m_rollback)
+                Save(system);
+            double step = m_step;
+            system->DoStepDynamics(step);
+            if (Update(system, step))
+                return step;
+            Restore(system);
+        }
+    }
+
+    /// Update the controller after a step of given size taken by the caller. Return false if the step should be
+    /// rejected (possible only with rollback enabled; the caller must then restore the state before the step and
+    /// repeat it with GetStep()).
+    bool Update(chrono::ChSystemMulticore* system, double step) {
+        if (m_rollback)
+            DetectContacts(system);
+        Measure(system);
+        double overlap = m_overlap / m_radius;
+        bool rejected = m_rollback && overlap > m_max_overlap && step > m_step_min;
+        m_history.push_back({system->GetChTime(), step, m_max_speed, overlap, rejected});
+
+        if (rejected) {
+            m_num_rejected++;
+            m_step = std::max(m_step_min, m_shrink * step);
+            return false;
+        }
+
+        m_num_steps++;
+        double factor = m_growth;
+        if (m_max_speed > 0)
+            factor = std::min(factor, m_max_travel * m_radius / (m_max_speed * step));
+        if (overlap > 0)
+            factor = std::min(factor, m_target_overlap / overlap);
+        factor = std::max(factor, m_shrink);
+        m_step = std::min(std::max(factor * step, m_step_min), m_step_max);
+        return true;
+    }
+
+    /// Return the number of accepted steps.
+    int GetNumSteps() const { return m_num_steps; }
+
+    /// Return the number of rejected steps.
+    int GetNumRejected() const { return m_num_rejected; }
+
+    /// Return the maximum body speed and maximum contact overlap (absolute) after the last step.
+    double GetMaxSpeed() const { return m_max_speed; }
+    double GetMaxOverlap() const { return m_overlap; }
+
+    /// Print a summary of the step sizes taken.
+    void PrintSummary() const {
+        double step_min = m_step_max;
+        double step_max = 0;
+        double sum = 0;
+        for (const auto& entry : m_history) {
+            if (entry.rejected)
+                continue;
+            step_min = std::min(step_min, entry.step);
+            step_max = std::max(step_max, entry.step);
+            sum += entry.step;
+        }
+        std::cout << "Adaptive step: " << m_num_steps << " steps, " << m_num_rejected << " rejected" << std::endl;
+        if (m_num_steps > 0) {
+            std::cout << "  step min / avg / max: " << step_min << " / " << sum / m_num_steps << " / " << step_max
+                      << std::endl;
+        }
+    }
+
+    /// Write the step history as CSV (time, step, max_speed, overlap / radius, rejected).
+    bool WriteHistory(const std::string& filename) const {
+        std::ofstream file(filename);
+        if (!file.good())
+            return false;
+        file << "time,step,max_speed,overlap,rejected\n";
+        for (const auto& entry : m_history) {
+            file << entry.time << "," << entry.step << "," << entry.max_speed << "," << entry.overlap << ","
+                 << (entry.rejected ? 1 : 0) << "\n";
+        }
+        return file.good();
+    }
+
+  private:
+    struct Entry {
+        double time;
+        double step;
+        double max_speed;
+        double overlap;
+        bool rejected;
+    };
+
+    // Run the collision detection on the current state (as at the beginning of a step).
+    void DetectContacts(chrono::ChSystemMulticore* system) {
+        system->Setup();
+        system->Update();
+        system->GetCollisionSystem()->Run();
+    }
+
+    // Maximum body speed and contact overlap (contact depths are negative for penetration).
+    void Measure(chrono::ChSystemMulticore* system) {
+        const auto& bodies = system->Get_bodylist();
+        int num_bodies = (int)bodies.size();
+        double max_speed2 = 0;
+#pragma omp parallel for schedule(static) reduction(max : max_speed2)
+        for (int i = 0; i < num_bodies; i++) {
+            if (!bodies[i]->GetBodyFixed())
+                max_speed2 = std::max(max_speed2, bodies[i]->GetPos_dt().Length2());
+        }
+
+        const auto& depth = system->data_manager->cd_data->dpth_rigid_rigid;
+        int num_contacts = (int)system->data_manager->cd_data->num_rigid_contacts;
+        double overlap = 0;
+#pragma omp parallel for schedule(static) reduction(max : overlap)
+        for (int ic = 0; ic < num_contacts; ic++)
+            overlap = std::max(overlap, (double)-depth[ic]);
+
+        m_max_speed = std::sqrt(max_speed2);
+        m_overlap = overlap;
+    }
+
+    // Save the body states and the SMC contact history.
+    void Save(chrono::ChSystemMulticore* system) {
+        const auto& bodies = system->Get_bodylist();
+        int num_bodies = (int)bodies.size();
+        m_saved.resize(num_bodies);
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_bodies; i++) {
+            m_saved[i].coord = bodies[i]->GetCoord();
+            m_saved[i].coord_dt = bodies[i]->GetCoord_dt();
+        }
+        m_saved_time = system->GetChTime();
+
+        const auto& host = system->data_manager->host_data;
+        m_shear_neigh = host.shear_neigh;
+        m_shear_disp = host.shear_disp;
+        m_contact_relvel_init = host.contact_relvel_init;
+        m_contact_duration = host.contact_duration;
+    }
+
+    // Restore the state saved before the rejected step.
+    void Restore(chrono::ChSystemMulticore* system) {
+        const auto& bodies = system->Get_bodylist();
+        int num_bodies = (int)std::min(bodies.size(), m_saved.size());
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_bodies; i++) {
+            bodies[i]->SetCoord(m_saved[i].coord);
+            bodies[i]->SetCoord_dt(m_saved[i].coord_dt);
+        }
+        system->SetChTime(m_saved_time);
+
+        auto& host = system->data_manager->host_data;
+        host.shear_neigh = m_shear_neigh;
+        host.shear_disp = m_shear_disp;
+        host.contact_relvel_init = m_contact_relvel_init;
+        host.contact_duration = m_contact_duration;
+    }
+
+    struct BodyState {
+        chrono::ChCoordsys<> coord;
+        chrono::ChCoordsys<> coord_dt;
+    };
+
+    double m_radius;
+    double m_step_min;
+    double m_step_max;
+    double m_step;
+    double m_max_travel;
+    double m_target_overlap;
+    double m_max_overlap;
+    double m_growth;
+    double m_shrink;
+    bool m_rollback;
+
+    int m_num_steps;
+    int m_num_rejected;
+    double m_max_speed;
+    double m_overlap;
+    std::vector<Entry> m_history;
+
+    std::vector<BodyState> m_saved;
+    double m_saved_time;
+    decltype(chrono::host_container::shear_neigh) m_shear_neigh;
+    decltype(chrono::host_container::shear_disp) m_shear_disp;
+    decltype(chrono::host_container::contact_relvel_init) m_contact_relvel_init;
+    decltype(chrono::host_container::contact_duration) m_contact_duration;
+};
+
+#endif
@@ -0,0 +1,619 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Versioned binary checkpoints of Chrono::Multicore systems (e.g., settled
+// granular beds), as a fast alternative to utils::WriteCheckpoint and
+// utils::ReadCheckpoint.
+//
+// The file consists of a header with a table of sections, followed by the
+// sections (8-byte aligned). All data is stored as structure-of-arrays:
+//   - body state (identifier, flags, mass, inertia, position, orientation, and
+//     their time derivatives) and the number of collision shapes per body,
+//   - collision shapes (type, material index, relative position and rotation,
+//     dimensions), obtained from the visualization assets of the bodies as in
+//     utils::WriteCheckpoint,
+//   - contact materials (identical materials are stored only once),
+//   - SMC contact history (shear neighbors and displacements, initial relative
+//     velocity and duration), if tangential displacement history is enabled.
+// The file is memory-mapped for reading, the materials are created once and
+// shared by all shapes that use them, and the bodies are created in bulk as in
+// bulk_particles.h: all bodies are allocated first, then configured (with
+// their collision models built) in parallel, and finally added to the system
+// after space for all of them is reserved in the data manager arrays.
+//
+// Supported shapes are spheres, ellipsoids, boxes, capsules, and cylinders;
+// WriteBinaryCheckpoint() returns false if any other shape is encountered (in
+// which case the text checkpoint can be used instead). WriteSystemCheckpoint()
+// and ReadSystemCheckpoint() implement this fallback.
+//
+// =============================================================================
+
+#ifndef BINARY_CHECKPOINT_H
+#define BINARY_CHECKPOINT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <process.h>
+#define BINARY_CHECKPOINT_GETPID _getpid
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BINARY_CHECKPOINT_GETPID getpid
+#endif
+
+#include "chrono/assets/ChBoxShape.h"
+#include "chrono/assets/ChCapsuleShape.h"
+#include "chrono/assets/ChCylinderShape.h"
+#include "chrono/assets/ChEllipsoidShape.h"
+#include "chrono/assets/ChSphereShape.h"
+#include "chrono/utils/ChUtilsCreators.h"
+#include "chrono/utils/ChUtilsInputOutput.h"
+
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+
+#include "bulk_particles.h"
+
+namespace binary_checkpoint {
+
+const char kMagic[4] = {'C', 'H', 'B', 'C'};
+const uint32_t kVersion = 1;
+const int kMaterialProps = 11;
+
+enum Section {
+    BODY_ID,           // int32
+    BODY_FLAGS,        // int32 (bit 0: fixed, bit 1: collide)
+    BODY_MASS,         // double
+    BODY_INERTIA,      // 6 x double (XX, XY)
+    BODY_POS,          // 3 x double
+    BODY_ROT,          // 4 x double
+    BODY_POS_DT,       // 3 x double
+    BODY_ROT_DT,       // 4 x double
+    BODY_NUM_SHAPES,   // int32
+    SHAPE_TYPE,        // int32 (collision::ChCollisionShape::Type)
+    SHAPE_MATERIAL,    // int32
+    SHAPE_POS,         // 3 x double
+    SHAPE_ROT,         // 4 x double
+    SHAPE_DIMS,        // 3 x double
+    MATERIAL,          // kMaterialProps x double
+    HISTORY_NEIGH,     // shear neighbors (raw)
+    HISTORY_DISP,      // shear displacements (raw)
+    HISTORY_RELVEL,    // initial relative velocities (raw)
+    HISTORY_DURATION,  // contact durations (raw)
+    NUM_SECTIONS
+};
+
+struct SectionInfo {
+    uint64_t offset;     // from the start of the file
+    uint64_t count;      // number of elements
+    uint64_t elem_size;  // bytes per element
+};
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t contact_method;  // 0: NSC, 1: SMC
+    uint32_t num_sections;
+    SectionInfo sections[NUM_SECTIONS];
+};
+
+// Contact material properties, in a fixed order.
+inline void GetMaterialProps(std::shared_ptr<chrono::ChMaterialSurface> mat, double* props) {
+    using namespace chrono;
+    if (auto smc = std::dynamic_pointer_cast<ChMaterialSurfaceSMC>(mat)) {
+        double p[kMaterialProps] = {smc->GetYoungModulus(), smc->GetPoissonRatio(), smc->GetSfriction(),
+                                    smc->GetKfriction(),    smc->GetRestitution(),  smc->GetAdhesion(),
+                                    smc->GetAdhesionMultDMT(), smc->GetKn(),       smc->GetGn(),
+                                    smc->GetKt(),           smc->GetGt()};
+        std::memcpy(props, p, sizeof(p));
+    } else if (auto nsc = std::dynamic_pointer_cast<ChMaterialSurfaceNSC>(mat)) {
+        double p[kMaterialProps] = {nsc->GetSfriction(),       nsc->GetKfriction(),           nsc->GetRollingFriction(),
+                                    nsc->GetSpinningFriction(), nsc->GetRestitution(),        nsc->GetCohesion(),
+                                    nsc->GetDampingF(),        nsc->GetCompliance(),          nsc->GetComplianceT(),
+                                    nsc->GetComplianceRolling(), nsc->GetComplianceSpinning()};
+        std::memcpy(props, p, sizeof(p));
+    } else {
+        std::memset(props, 0, kMaterialProps * sizeof(double));
+    }
+}
+
+inline std::shared_ptr<chrono::ChMaterialSurface> CreateMaterial(uint32_t contact_method, const double* p) {
+    using namespace chrono;
+    if (contact_method == 1) {
+        auto smc = chrono_types::make_shared<ChMaterialSurfaceSMC>();
+        smc->SetYoungModulus((float)p[0]);
+        smc->SetPoissonRatio((float)p[1]);
+        smc->SetSfriction((float)p[2]);
+        smc->SetKfriction((float)p[3]);
+        smc->SetRestitution((float)p[4]);
+        smc->SetAdhesion((float)p[5]);
+        smc->SetAdhesionMultDMT((float)p[6]);
+        smc->SetKn((float)p[7]);
+        smc->SetGn((float)p[8]);
+        smc->SetKt((float)p[9]);
+        smc->SetGt((float)p[10]);
+        return smc;
+    }
+    auto nsc = chrono_types::make_shared<ChMaterialSurfaceNSC>();
+    nsc->SetSfriction((float)p[0]);
+    nsc->SetKfriction((float)p[1]);
+    nsc->SetRollingFriction((float)p[2]);
+    nsc->SetSpinningFriction((float)p[3]);
+    nsc->SetRestitution((float)p[4]);
+    nsc->SetCohesion((float)p[5]);
+    nsc->SetDampingF((float)p[6]);
+    nsc->SetCompliance((float)p[7]);
+    nsc->SetComplianceT((float)p[8]);
+    nsc->SetComplianceRolling((float)p[9]);
+    nsc->SetComplianceSpinning((float)p[10]);
+    return nsc;
+}
+
+// Extract type and dimensions of a visualization asset. Return false for unsupported shapes.
+inline bool GetShape(std::shared_ptr<chrono::ChVisualization> asset, int& type, double* dims) {
+    using namespace chrono;
+    using namespace chrono::collision;
+    dims[0] = dims[1] = dims[2] = 0;
+    if (auto sphere = std::dynamic_pointer_cast<ChSphereShape>(asset)) {
+        type = ChCollisionShape::Type::SPHERE;
+        dims[0] = sphere->GetSphereGeometry().rad;
+    } else if (auto ellipsoid = std::dynamic_pointer_cast<ChEllipsoidShape>(asset)) {
+        type = ChCollisionShape::Type::ELLIPSOID;
+        const ChVector<>& rad = ellipsoid->GetEllipsoidGeometry().rad;
+        dims[0] = rad.x();
+        dims[1] = rad.y();
+        dims[2] = rad.z();
+    } else if (auto box = std::dynamic_pointer_cast<ChBoxShape>(asset)) {
+        type = ChCollisionShape::Type::BOX;
+        const ChVector<>& size = box->GetBoxGeometry().Size;
+        dims[0] = size.x();
+        dims[1] = size.y();
+        dims[2] = size.z();
+    } else if (auto capsule = std::dynamic_pointer_cast<ChCapsuleShape>(asset)) {
+        type = ChCollisionShape::Type::CAPSULE;
+        dims[0] = capsule->GetCapsuleGeometry().rad;
+        dims[1] = capsule->GetCapsuleGeometry().hlen;
+    } else if (auto cylinder = std::dynamic_pointer_cast<ChCylinderShape>(asset)) {
+        type = ChCollisionShape::Type::CYLINDER;
+        const auto& geometry = cylinder->GetCylinderGeometry();
+        dims[0] = geometry.rad;
+        dims[1] = (geometry.p1 - geometry.p2).Length() / 2;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Add a collision shape (and its visualization asset) to a body.
+inline void AddShape(chrono::ChBody* body,
+                     std::shared_ptr<chrono::ChMaterialSurface> mat,
+                     int type,
+                     const double* dims,
+                     const chrono::ChVector<>& pos,
+                     const chrono::ChQuaternion<>& rot) {
+    using namespace chrono;
+    using namespace chrono::collision;
+    switch (type) {
+        case ChCollisionShape::Type::SPHERE:
+            utils::AddSphereGeometry(body, mat, dims[0], pos, rot);
+            break;
+        case ChCollisionShape::Type::ELLIPSOID:
+            utils::AddEllipsoidGeometry(body, mat, ChVector<>(dims[0], dims[1], dims[2]), pos, rot);
+            break;
+        case ChCollisionShape::Type::BOX:
+            utils::AddBoxGeometry(body, mat, ChVector<>(dims[0], dims[1], dims[2]), pos, rot);
+            break;
+        case ChCollisionShape::Type::CAPSULE:
+            utils::AddCapsuleGeometry(body, mat, dims[0], dims[1], pos, rot);
+            break;
+        case ChCollisionShape::Type::CYLINDER:
+            utils::AddCylinderGeometry(body, mat, dims[0], dims[1], pos, rot);
+            break;
+    }
+}
+
+}  // end namespace binary_checkpoint
+
+/// Write a binary checkpoint of all bodies in the system.
+/// The file is written under a temporary name and then renamed. Return false if the file cannot be written or if a
+/// body has an unsupported shape.
+inline bool WriteBinaryCheckpoint(chrono::ChSystemMulticore* system, const std::string& filename) {
+    using namespace chrono;
+    using namespace binary_checkpoint;
+
+    const auto& bodies = system->Get_bodylist();
+    size_t num_bodies = bodies.size();
+
+    std::vector<int32_t> body_id(num_bodies);
+    std::vector<int32_t> body_flags(num_bodies);
+    std::vector<double> body_mass(num_bodies);
+    std::vector<double> body_inertia(6 * num_bodies);
+    std::vector<double> body_pos(3 * num_bodies);
+    std::vector<double> body_rot(4 * num_bodies);
+    std::vector<double> body_pos_dt(3 * num_bodies);
+    std::vector<double> body_rot_dt(4 * num_bodies);
+    std::vector<int32_t> body_num_shapes(num_bodies);
+    std::vector<int32_t> shape_type;
+    std::vector<int32_t> shape_material;
+    std::vector<double> shape_pos;
+    std::vector<double> shape_rot;
+    std::vector<double> shape_dims;
+    std::vector<double> materials;
+    std::map<std::vector<double>, int32_t> material_index;
+    std::map<ChMaterialSurface*, int32_t> material_cache;
+
+    for (size_t ib = 0; ib < num_bodies; ib++) {
+        const auto& body = bodies[ib];
+        body_id[ib] = body->GetIdentifier();
+        body_flags[ib] = (body->GetBodyFixed() ? 1 : 0) | (body->GetCollide() ? 2 : 0);
+        body_mass[ib] = body->GetMass();
+        ChVector<> inertia_xx = body->GetInertiaXX();
+        ChVector<> inertia_xy = body->GetInertiaXY();
+        const ChVector<>& pos = body->GetPos();
+        const ChQuaternion<>& rot = body->GetRot();
+        const ChVector<>& pos_dt = body->GetPos_dt();
+        const ChQuaternion<>& rot_dt = body->GetRot_dt();
+        for (int k = 0; k < 3; k++) {
+            body_inertia[6 * ib + k] = inertia_xx[k];
+            body_inertia[6 * ib + 3 + k] = inertia_xy[k];
+            body_pos[3 * ib + k] = pos[k];
+            body_pos_dt[3 * ib + k] = pos_dt[k];
+        }
+        for (int k = 0; k < 4; k++) {
+            body_rot[4 * ib + k] = rot[k];
+            body_rot_dt[4 * ib + k] = rot_dt[k];
+        }
+
+        // Shapes (from the visualization assets, matched in order with the collision shapes for their materials)
+        auto model = body->GetCollisionModel();
+        int num_collision_shapes = model ? model->GetNumShapes() : 0;
+        int num_shapes = 0;
+        for (const auto& asset : body->GetAssets()) {
+            auto visual = std::dynamic_pointer_cast<ChVisualization>(asset);
+            if (!visual)
+                continue;
+            int type;
+            double dims[3];
+            if (!GetShape(visual, type, dims))
+                return false;
+
+            int32_t mat_index = -1;
+            if (num_collision_shapes > 0) {
+                auto mat = model->GetShape(std::min(num_shapes, num_collision_shapes - 1))->GetMaterial();
+                auto cached = material_cache.find(mat.get());
+                if (cached != material_cache.end()) {
+                    mat_index = cached->second;
+                } else {
+                    std::vector<double> props(kMaterialProps);
+                    GetMaterialProps(mat, props.data());
+                    auto found = material_index.find(props);
+                    if (found != material_index.end()) {
+                        mat_index = found->second;
+                    } else {
+                        mat_index = (int32_t)material_index.size();
+                        material_index[props] = mat_index;
+                        materials.insert(materials.end(), props.begin(), props.end());
+                    }
+                    material_cache[mat.get()] = mat_index;
+                }
+            }
+
+            ChQuaternion<> srot = visual->Rot.Get_A_quaternion();
+            shape_type.push_back(type);
+            shape_material.push_back(mat_index);
+            shape_pos.insert(shape_pos.end(), {visual->Pos.x(), visual->Pos.y(), visual->Pos.z()});
+            shape_rot.insert(shape_rot.end(), {srot.e0(), srot.e1(), srot.e2(), srot.e3()});
+            shape_dims.insert(shape_dims.end(), dims, dims + 3);
+            num_shapes++;
+        }
+        body_num_shapes[ib] = num_shapes;
+    }
+
+    // Sections (with the SMC contact history, if present)
+    struct Data {
+        const void* ptr;
+        uint64_t count;
+        uint64_t elem_size;
+    };
+    Data data[NUM_SECTIONS] = {
+        {body_id.data(), num_bodies, sizeof(int32_t)},
+        {body_flags.data(), num_bodies, sizeof(int32_t)},
+        {body_mass.data(), num_bodies, sizeof(double)},
+        {body_inertia.data(), num_bodies, 6 * sizeof(double)},
+        {body_pos.data(), num_bodies, 3 * sizeof(double)},
+        {body_rot.data(), num_bodies, 4 * sizeof(double)},
+        {body_pos_dt.data(), num_bodies, 3 * sizeof(double)},
+        {body_rot_dt.data(), num_bodies, 4 * sizeof(double)},
+        {body_num_shapes.data(), num_bodies, sizeof(int32_t)},
+        {shape_type.data(), shape_type.size(), sizeof(int32_t)},
+        {shape_material.data(), shape_material.size(), sizeof(int32_t)},
+        {shape_pos.data(), shape_type.size(), 3 * sizeof(double)},
+        {shape_rot.data(), shape_type.size(), 4 * sizeof(double)},
+        {shape_dims.data(), shape_type.size(), 3 * sizeof(double)},
+        {materials.data(), material_index.size(), kMaterialProps * sizeof(double)},
+        {nullptr, 0, 0},
+        {nullptr, 0, 0},
+        {nullptr, 0, 0},
+        {nullptr, 0, 0},
+    };
+
+    uint32_t contact_method = (system->GetContactMethod() == ChContactMethod::SMC) ? 1 : 0;
+    if (contact_method == 1) {
+        auto& host = system->data_manager->host_data;
+        data[HISTORY_NEIGH] = {host.shear_neigh.data(), host.shear_neigh.size(), sizeof(host.shear_neigh[0])};
+        data[HISTORY_DISP] = {host.shear_disp.data(), host.shear_disp.size(), sizeof(host.shear_disp[0])};
+        data[HISTORY_RELVEL] = {host.contact_relvel_init.data(), host.contact_relvel_init.size(),
+                                sizeof(host.contact_relvel_init[0])};
+        data[HISTORY_DURATION] = {host.contact_duration.data(), host.contact_duration.size(),
+                                  sizeof(host.contact_duration[0])};
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, 4);
+    header.version = kVersion;
+    header.contact_method = contact_method;
+    header.num_sections = NUM_SECTIONS;
+    uint64_t offset = (sizeof(header) + 7) & ~uint64_t(7);
+    for (int i = 0; i < NUM_SECTIONS; i++) {
+        header.sections[i].offset = offset;
+        header.sections[i].count = data[i].count;
+        header.sections[i].elem_size = data[i].elem_size;
+        offset = (offset + data[i].count * data[i].elem_size + 7) & ~uint64_t(7);
+    }
+
+    std::string tmpname = filename + ".tmp" + std::to_string(BINARY_CHECKPOINT_GETPID());
+    FILE* file = fopen(tmpname.c_str(), "wb");
+    if (!file)
+        return false;
+    const char zeros[8] = {0};
+    uint64_t written = 0;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    written += sizeof(header);
+    for (int i = 0; i < NUM_SECTIONS && ok; i++) {
+        ok = fwrite(zeros, 1, header.sections[i].offset - written, file) == header.sections[i].offset - written;
+        written = header.sections[i].offset;
+        size_t bytes = data[i].count * data[i].elem_size;
+        ok = ok && (bytes == 0 || fwrite(data[i].ptr, 1, bytes, file) == bytes);
+        written += bytes;
+    }
+    ok = (fclose(file) == 0) && ok;
+#if defined(_WIN32)
+    remove(filename.c_str());
+#endif
+    if (!ok || rename(tmpname.c_str(), filename.c_str()) != 0) {
+        remove(tmpname.c_str());
+        return false;
+    }
+    return true;
+}
+
+/// Create the bodies stored in a binary checkpoint and add them to the system.
+/// Return false (without modifying the system) if the file is missing or invalid.
+inline bool ReadBinaryCheckpoint(chrono::ChSystemMulticore* system, const std::string& filename) {
+    using namespace chrono;
+    using namespace binary_checkpoint;
+
+    // Map the file
+#if defined(_WIN32)
+    std::vector<char> contents;
+    {
+        FILE* file = fopen(filename.c_str(), "rb");
+        if (!file)
+            return false;
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        contents.resize(size > 0 ? size : 0);
+        bool ok = fread(contents.data(), 1, contents.size(), file) == contents.size();
+        fclose(file);
+        if (!ok)
+            return false;
+    }
+    const char* buffer = contents.data();
+    size_t size = contents.size();
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+        return false;
+    const char* buffer = static_cast<const char*>(mapped);
+    struct Unmap {
+        void* ptr;
+        size_t size;
+        ~Unmap() { munmap(ptr, size); }
+    } unmap{mapped, size};
+#endif
+
+    // Validate the header and the section table
+    Header header;
+    if (size < sizeof(header))
+        return false;
+    std::memcpy(&header, buffer, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, 4) != 0 || header.version != kVersion ||
+        header.num_sections != NUM_SECTIONS)
+        return false;
+    uint32_t contact_method = (system->GetContactMethod() == ChContactMethod::SMC) ? 1 : 0;
+    if (header.contact_method != contact_method)
+        return false;
+
+    const uint64_t elem_size[MATERIAL + 1] = {sizeof(int32_t),     sizeof(int32_t),     sizeof(double),
+                                              6 * sizeof(double),  3 * sizeof(double),  4 * sizeof(double),
+                                              3 * sizeof(double),  4 * sizeof(double),  sizeof(int32_t),
+                                              sizeof(int32_t),     sizeof(int32_t),     3 * sizeof(double),
+                                              4 * sizeof(double),  3 * sizeof(double),  kMaterialProps * sizeof(double)};
+    for (int i = 0; i < NUM_SECTIONS; i++) {
+        const auto& s = header.sections[i];
+        if (i <= MATERIAL && s.count > 0 && s.elem_size != elem_size[i])
+            return false;
+        if (s.offset + s.count * s.elem_size > size)
+            return false;
+    }
+    size_t num_bodies = header.sections[BODY_ID].count;
+    size_t num_shapes = header.sections[SHAPE_TYPE].count;
+    size_t num_materials = header.sections[MATERIAL].count;
+    for (int i = BODY_ID; i <= BODY_NUM_SHAPES; i++) {
+        if (header.sections[i].count != num_bodies)
+            return false;
+    }
+    for (int i = SHAPE_TYPE; i <= SHAPE_DIMS; i++) {
+        if (header.sections[i].count != num_shapes)
+            return false;
+    }
+
+    auto section = [&](int i) { return buffer + header.sections[i].offset; };
+    const int32_t* body_id = reinterpret_cast<const int32_t*>(section(BODY_ID));
+    const int32_t* body_flags = reinterpret_cast<const int32_t*>(section(BODY_FLAGS));
+    const double* body_mass = reinterpret_cast<const double*>(section(BODY_MASS));
+    const double* body_inertia = reinterpret_cast<const double*>(section(BODY_INERTIA));
+    const double* body_pos = reinterpret_cast<const double*>(section(BODY_POS));
+    const double* body_rot = reinterpret_cast<const double*>(section(BODY_ROT));
+    const double* body_pos_dt = reinterpret_cast<const double*>(section(BODY_POS_DT));
+    const double* body_rot_dt = reinterpret_cast<const double*>(section(BODY_ROT_DT));
+    const int32_t* body_num_shapes = reinterpret_cast<const int32_t*>(section(BODY_NUM_SHAPES));
+    const int32_t* shape_type = reinterpret_cast<const int32_t*>(section(SHAPE_TYPE));
+    const int32_t* shape_material = reinterpret_cast<const int32_t*>(section(SHAPE_MATERIAL));
+    const double* shape_pos = reinterpret_cast<const double*>(section(SHAPE_POS));
+    const double* shape_rot = reinterpret_cast<const double*>(section(SHAPE_ROT));
+    const double* shape_dims = reinterpret_cast<const double*>(section(SHAPE_DIMS));
+    const double* material_props = reinterpret_cast<const double*>(section(MATERIAL));
+
+    size_t total_shapes = 0;
+    for (size_t ib = 0; ib < num_bodies; ib++)
+        total_shapes += body_num_shapes[ib];
+    if (total_shapes != num_shapes)
+        return false;
+    for (size_t is = 0; is < num_shapes; is++) {
+        if (shape_material[is] < -1 || shape_material[is] >= (int32_t)num_materials)
+            return false;
+    }
+
+    // Create the materials (shared by all shapes referencing them)
+    std::vector<std::shared_ptr<ChMaterialSurface>> materials(num_materials);
+    for (size_t im = 0; im < num_materials; im++)
+        materials[im] = CreateMaterial(contact_method, material_props + kMaterialProps * im);
+    auto default_material = ChMaterialSurface::DefaultMaterial(system->GetContactMethod());
+
+    // First shape of each body
+    std::vector<size_t> first_shape(num_bodies + 1, 0);
+    for (size_t ib = 0; ib < num_bodies; ib++)
+        first_shape[ib + 1] = first_shape[ib] + body_num_shapes[ib];
+
+    // Allocate the bodies (serially, see bulk_particles.h)
+    std::vector<std::shared_ptr<ChBody>> bodies(num_bodies);
+    for (size_t ib = 0; ib < num_bodies; ib++)
+        bodies[ib] = std::shared_ptr<ChBody>(system->NewBody());
+
+    // Configure the bodies and build their collision models
+    int num_bodies_i = (int)num_bodies;
+#pragma omp parallel for schedule(static)
+    for (int ib = 0; ib < num_bodies_i; ib++) {
+        auto& body = bodies[ib];
+        body->SetIdentifier(body_id[ib]);
+        body->SetBodyFixed((body_flags[ib] & 1) != 0);
+        body->SetCollide((body_flags[ib] & 2) != 0);
+        body->SetMass(body_mass[ib]);
+        const double* inertia = body_inertia + 6 * ib;
+        body->SetInertiaXX(ChVector<>(inertia[0], inertia[1], inertia[2]));
+        body->SetInertiaXY(ChVector<>(inertia[3], inertia[4], inertia[5]));
+        const double* pos = body_pos + 3 * ib;
+        const double* rot = body_rot + 4 * ib;
+        const double* pos_dt = body_pos_dt + 3 * ib;
+        const double* rot_dt = body_rot_dt + 4 * ib;
+        body->SetPos(ChVector<>(pos[0], pos[1], pos[2]));
+        body->SetRot(ChQuaternion<>(rot[0], rot[1], rot[2], rot[3]));
+        body->SetPos_dt(ChVector<>(pos_dt[0], pos_dt[1], pos_dt[2]));
+        body->SetRot_dt(ChQuaternion<>(rot_dt[0], rot_dt[1], rot_dt[2], rot_dt[3]));
+
+        body->GetCollisionModel()->ClearModel();
+        for (size_t is = first_shape[ib]; is < first_shape[ib + 1]; is++) {
+            const double* spos = shape_pos + 3 * is;
+            const double* srot = shape_rot + 4 * is;
+            auto mat = shape_material[is] >= 0 ? materials[shape_material[is]] : default_material;
+            AddShape(body.get(), mat, shape_type[is], shape_dims + 3 * is, ChVector<>(spos[0], spos[1], spos[2]),
+                     ChQuaternion<>(srot[0], srot[1], srot[2], srot[3]));
+        }
+        body->GetCollisionModel()->BuildModel();
+    }
+
+    // Add the bodies
+    ReserveBodies(system, num_bodies, num_shapes);
+    for (const auto& body : bodies)
+        system->AddBody(body);
+
+    // Restore the SMC contact history (only if its layout matches the one of the system)
+    if (contact_method == 1) {
+        auto& host = system->data_manager->host_data;
+        auto restore = [&](int i, void* dst, size_t count, size_t elem) {
+            const auto& s = header.sections[i];
+            if (s.count == 0)
+                return true;
+            if (s.count != count || s.elem_size != elem)
+                return false;
+            std::memcpy(dst, section(i), count * elem);
+            return true;
+        };
+        bool ok = restore(HISTORY_NEIGH, host.shear_neigh.data(), host.shear_neigh.size(), sizeof(host.shear_neigh[0]));
+        ok = ok && restore(HISTORY_DISP, host.shear_disp.data(), host.shear_disp.size(), sizeof(host.shear_disp[0]));
+        ok = ok && restore(HISTORY_RELVEL, host.contact_relvel_init.data(), host.contact_relvel_init.size(),
+                           sizeof(host.contact_relvel_init[0]));
+        ok = ok && restore(HISTORY_DURATION, host.contact_duration.data(), host.contact_duration.size(),
+                           sizeof(host.contact_duration[0]));
+        if (!ok)
+            printf("Contact history in %s does not match the system; not restored\n", filename.c_str());
+    }
+
+    return true;
+}
+
+/// Write a binary checkpoint if possible; otherwise, write a text checkpoint with utils::WriteCheckpoint and remove
+/// any stale binary checkpoint. Return true if the binary checkpoint was written.
+inline bool WriteSystemCheckpoint(chrono::ChSystemMulticore* system,
+                                  const std::string& binary_file,
+                                  const std::string& text_file) {
+    if (WriteBinaryCheckpoint(system, binary_file))
+        return true;
+    remove(binary_file.c_str());
+    chrono::utils::WriteCheckpoint(system, text_file);
+    return false;
+}
+
+/// Read a binary checkpoint if available; otherwise, read a text checkpoint with utils::ReadCheckpoint.
+/// Return true if the binary checkpoint was read.
+inline bool ReadSystemCheckpoint(chrono::ChSystemMulticore* system,
+                                 const std::string& binary_file,
+                                 const std::string& text_file) {
+    if (ReadBinaryCheckpoint(system, binary_file))
+        return true;
+    chrono::utils::ReadCheckpoint(system, text_file);
+    return false;
+}
+
+#endif
@@ -0,0 +1,127 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Bulk insertion of spherical particles in a Chrono::Multicore system.
+//
+// utils::Generator creates, configures, and adds the particle bodies one at a
+// time. Here, the particles are given as arrays (positions, radii, masses) with
+// a single shared contact material, and they are inserted in three passes:
+//   - the body objects are allocated (serially, since the unique object
+//     identifiers are not generated in a thread-safe way; for the same
+//     reason, systems built from several threads, e.g. the members of an
+//     EnsemblePool, must call AddSpheres under a common lock, see
+//     ensemble_pool.h);
+//   - the bodies are configured (mass, inertia, state, collision shape, visual
+//     asset) and their collision models built, in parallel;
+//   - the bodies are added to the system, which appends them to the data
+//     manager arrays (serially, as required by ChSystemMulticore::AddBody),
+//     after space for all of them is reserved in these arrays.
+//
+// The visual assets are kept since the checkpoint functions (utils and
+// binary_checkpoint.h) recover the shapes from them.
+//
+// =============================================================================
+
+#ifndef BULK_PARTICLES_H
+#define BULK_PARTICLES_H
+
+#include <memory>
+#include <vector>
+
+#include "chrono/utils/ChUtilsCreators.h"
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+
+/// Reserve space in the data manager arrays for the given numbers of additional bodies and collision shapes, so that
+/// adding the bodies one at a time does not reallocate these arrays.
+inline void ReserveBodies(chrono::ChSystemMulticore* system, size_t num_bodies, size_t num_shapes) {
+    auto& host = system->data_manager->host_data;
+    size_t nb = host.pos_rigid.size() + num_bodies;
+    host.pos_rigid.reserve(nb);
+    host.rot_rigid.reserve(nb);
+    host.active_rigid.reserve(nb);
+    host.collide_rigid.reserve(nb);
+    host.mass_rigid.reserve(nb);
+
+    auto& shapes = system->data_manager->cd_data->shape_data;
+    size_t ns = shapes.id_rigid.size() + num_shapes;
+    shapes.id_rigid.reserve(ns);
+    shapes.typ_rigid.reserve(ns);
+    shapes.local_rigid.reserve(ns);
+    shapes.start_rigid.reserve(ns);
+    shapes.length_rigid.reserve(ns);
+    shapes.ObA_rigid.reserve(ns);
+    shapes.ObR_rigid.reserve(ns);
+    shapes.fam_rigid.reserve(ns);
+}
+
+/// Add spheres with given positions, radii, and masses to the system, all with the same contact material and initial
+/// velocity. Body identifiers are assigned consecutively, starting at first_id. Return the number of added bodies.
+inline int AddSpheres(chrono::ChSystemMulticore* system,
+                      std::shared_ptr<chrono::ChMaterialSurface> material,
+                      const std::vector<chrono::ChVector<>>& pos,
+                      const std::vector<double>& radius,
+                      const std::vector<double>& mass,
+                      int first_id,
+                      const chrono::ChVector<>& vel = chrono::ChVector<>(0, 0, 0)) {
+    using namespace chrono;
+
+    int num_bodies = (int)pos.size();
+    if (num_bodies == 0)
+        return 0;
+
+    std::vector<std::shared_ptr<ChBody>> bodies(num_bodies);
+    for (int i = 0; i < num_bodies; i++)
+        bodies[i] = std::shared_ptr<ChBody>(system->NewBody());
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < num_bodies; i++) {
+        auto& body = bodies[i];
+        double r = radius[i];
+        double m = mass[i];
+        body->SetIdentifier(first_id + i);
+        body->SetMass(m);
+        body->SetInertiaXX(ChVector<>(0.4 * m * r * r));
+        body->SetPos(pos[i]);
+        body->SetRot(ChQuaternion<>(1, 0, 0, 0));
+        body->SetPos_dt(vel);
+        body->SetBodyFixed(false);
+        body->SetCollide(true);
+
+        body->GetCollisionModel()->ClearModel();
+        utils::AddSphereGeometry(body.get(), material, r);
+        body->GetCollisionModel()->BuildModel();
+    }
+
+    auto& sphere_rigid = system->data_manager->cd_data->shape_data.sphere_rigid;
+    ReserveBodies(system, num_bodies, num_bodies);
+    sphere_rigid.reserve(sphere_rigid.size() + num_bodies);
+    for (int i = 0; i < num_bodies; i++)
+        system->AddBody(bodies[i]);
+
+    return num_bodies;
+}
+
+/// Add identical spheres (given radius and density) at the given positions.
+inline int AddSpheres(chrono::ChSystemMulticore* system,
+                      std::shared_ptr<chrono::ChMaterialSurface> material,
+                      const std::vector<chrono::ChVector<>>& pos,
+                      double radius,
+                      double density,
+                      int first_id,
+                      const chrono::ChVector<>& vel = chrono::ChVector<>(0, 0, 0)) {
+    double mass = density * (4.0 / 3.0) * chrono::CH_C_PI * radius * radius * radius;
+    std::vector<double> radii(pos.size(), radius);
+    std::vector<double> masses(pos.size(), mass);
+    return AddSpheres(system, material, pos, radii, masses, first_id, vel);
+}
+
+#endif
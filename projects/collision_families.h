@@ -0,0 +1,395 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Declarative collision groups and broadphase culling statistics for
+// Chrono::Multicore.
+//
+// CollisionGroups replaces hand-written collision family settings: groups of
+// bodies are declared with a body filter and pairs of groups (possibly a group
+// with itself) are marked as mutually non-colliding. Apply assigns one
+// collision family per group (families 14, 13, ..., leaving the low families to
+// hand-written settings; family 15 is not in the default family mask) and sets
+// the family masks of the collision models. It can be called before or after
+// the bodies are added to the system; in the latter case the family data of the
+// shapes already in the collision system is updated as well.
+//
+// CollisionFamilyStats re-runs the AABB overlap test of the broadphase on the
+// shape AABBs of the last collision detection (uniform grid with a cell size
+// of twice the median shape extent; shapes much larger than a cell are tested
+// against all others) and classifies each candidate pair as discarded because
+// both shapes belong to the same body, because both bodies are inactive, or
+// because of the collision families, or as passed to the narrowphase. The
+// culled and passed pairs are also counted per pair of collision groups.
+//
+// =============================================================================
+
+#ifndef COLLISION_FAMILIES_H
+#define COLLISION_FAMILIES_H
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+
+class CollisionGroups {
+  public:
+    /// Maximum number of groups (one collision family each).
+    static const int kMaxGroups = 14;
+
+    /// Declare a group of bodies; a body belongs to the first group whose filter accepts it.
+    /// Return the group index, or -1 if the maximum number of groups is reached.
+    int AddGroup(const std::string& name, std::function<bool(const chrono::ChBody&)> filter) {
+        if ((int)m_groups.size() >= kMaxGroups)
+            return -1;
+        m_groups.push_back({name, filter, std::vector<int>()});
+        return (int)m_groups.size() - 1;
+    }
+
+    /// Mark the bodies of the two given groups as non-colliding (g1 == g2 for bodies of the same group).
+    void SetNoCollision(int g1, int g2) {
+        auto add = [](std::vector<int>& list, int g) {
+            if (std::find(list.begin(), list.end(), g) == list.end())
+                list.push_back(g);
+        };
+        add(m_groups[g1].no_collision, g2);
+        add(m_groups[g2].no_collision, g1);
+    }
+
+    int GetNumGroups() const { return (int)m_groups.size(); }
+    const std::string& GetName(int g) const { return m_groups[g].name; }
+
+    /// Return the collision family assigned to the given group.
+    static int GetFamily(int g) { return 14 - g; }
+
+    /// Return the group of the given body (-1 if none).
+    int GetGroup(const chrono::ChBody& body) const {
+        for (int g = 0; g < (int)m_groups.size(); g++) {
+            if (m_groups[g].filter(body))
+                return g;
+        }
+        return -1;
+    }
+
+    /// Set the collision families of the bodies of the system which belong to a group.
+    /// Return the number of such bodies.
+    int Apply(chrono::ChSystemMulticore* system) const {
+        const auto& bodies = system->Get_bodylist();
+        std::vector<char> assigned(bodies.size(), 0);
+        int num_assigned = 0;
+        for (size_t i = 0; i < bodies.size(); i++) {
+            int g = GetGroup(*bodies[i]);
+            if (g < 0)
+                continue;
+            auto model = bodies[i]->GetCollisionModel();
+            model->SetFamily(GetFamily(g));
+            for (int g2 : m_groups[g].no_collision)
+                model->SetFamilyMaskNoCollisionWithFamily(GetFamily(g2));
+            assigned[i] = 1;
+            num_assigned++;
+        }
+
+        // Shapes already in the collision system
+        auto& shape_data = system->data_manager->cd_data->shape_data;
+        for (size_t s = 0; s < shape_data.id_rigid.size(); s++) {
+            auto id = shape_data.id_rigid[s];
+            if (id >= bodies.size() || !assigned[id])
+                continue;
+            auto model = bodies[id]->GetCollisionModel();
+            shape_data.fam_rigid[s].x = model->GetFamilyGroup();
+            shape_data.fam_rigid[s].y = model->GetFamilyMask();
+        }
+        return num_assigned;
+    }
+
+  private:
+    struct Group {
+        std::string name;
+        std::function<bool(const chrono::ChBody&)> filter;
+        std::vector<int> no_collision;
+    };
+
+    std::vector<Group> m_groups;
+};
+
+class CollisionFamilyStats {
+  public:
+    /// Create the statistics, optionally per pair of groups of the given collision groups.
+    CollisionFamilyStats(const CollisionGroups* groups = nullptr)
+        : m_groups(groups),
+          m_num_candidates(0),
+          m_num_same_body(0),
+          m_num_inactive(0),
+          m_num_culled(0),
+          m_num_passed(0) {}
+
+    /// Classify the broadphase candidate pairs of the last collision detection of the system.
+    void Measure(chrono::ChSystemMulticore* system) {
+        using namespace chrono;
+
+        const auto& cd_data = *system->data_manager->cd_data;
+        const auto& host = system->data_manager->host_data;
+        const auto& shape_data = cd_data.shape_data;
+        const auto& aabb_min = cd_data.aabb_min;
+        const auto& aabb_max = cd_data.aabb_max;
+        const auto& bodies = system->Get_bodylist();
+
+        int num_groups = (m_groups ? m_groups->GetNumGroups() : 0) + 1;
+        m_culled.assign(num_groups * num_groups, 0);
+        m_passed.assign(num_groups * num_groups, 0);
+        m_num_candidates = m_num_same_body = m_num_inactive = m_num_culled = m_num_passed = 0;
+
+        int num_shapes = (int)std::min(shape_data.id_rigid.size(), aabb_min.size());
+        if (num_shapes == 0 || aabb_max.size() < (size_t)num_shapes)
+            return;
+
+        // Group index of each body (0 for bodies in no group)
+        std::vector<int> body_group(bodies.size(), 0);
+        if (m_groups) {
+            for (size_t i = 0; i < bodies.size(); i++)
+                body_group[i] = m_groups->GetGroup(*bodies[i]) + 1;
+        }
+
+        // Shapes taking part in collision detection
+        std::vector<int> shapes;
+        std::vector<real> extent;
+        for (int s = 0; s < num_shapes; s++) {
+            auto id = shape_data.id_rigid[s];
+            if (id >= host.collide_rigid.size() || !host.collide_rigid[id])
+                continue;
+            real3 d = aabb_max[s] - aabb_min[s];
+            shapes.push_back(s);
+            extent.push_back(std::max(d.x, std::max(d.y, d.z)));
+        }
+        if (shapes.empty())
+            return;
+
+        // Uniform grid over the small shapes; large shapes are tested against all others
+        std::vector<real> sorted_extent(extent);
+        std::nth_element(sorted_extent.begin(), sorted_extent.begin() + sorted_extent.size() / 2,
+                         sorted_extent.end());
+        real cell = std::max(2 * sorted_extent[sorted_extent.size() / 2], (real)1e-6);
+        std::vector<int> small, large;
+        real3 lo(C_LARGE_REAL);
+        real3 hi(-C_LARGE_REAL);
+        for (size_t k = 0; k < shapes.size(); k++) {
+            if (extent[k] > 4 * cell) {
+                large.push_back(shapes[k]);
+            } else {
+                small.push_back(shapes[k]);
+                lo = Min(lo, aabb_min[shapes[k]]);
+                hi = Max(hi, aabb_max[shapes[k]]);
+            }
+        }
+        vec3 n(1, 1, 1);
+        if (!small.empty()) {
+            n.x = std::max(1, (int)std::ceil((hi.x - lo.x) / cell));
+            n.y = std::max(1, (int)std::ceil((hi.y - lo.y) / cell));
+            n.z = std::max(1, (int)std::ceil((hi.z - lo.z) / cell));
+        }
+        auto cell_index = [&](const real3& p) {
+            int ix = std::min(std::max((int)((p.x - lo.x) / cell), 0), n.x - 1);
+            int iy = std::min(std::max((int)((p.y - lo.y) / cell), 0), n.y - 1);
+            int iz = std::min(std::max((int)((p.z - lo.z) / cell), 0), n.z - 1);
+            return ((long long)ix * n.y + iy) * n.z + iz;
+        };
+
+        // (cell, shape) entries for all cells overlapped by each small shape, sorted by cell
+        std::vector<std::pair<long long, int>> entries;
+        for (int s : small) {
+            long long c0 = cell_index(aabb_min[s]);
+            long long c1 = cell_index(aabb_max[s]);
+            int ix0 = (int)(c0 / ((long long)n.y * n.z)), ix1 = (int)(c1 / ((long long)n.y * n.z));
+            int iy0 = (int)(c0 / n.z % n.y), iy1 = (int)(c1 / n.z % n.y);
+            int iz0 = (int)(c0 % n.z), iz1 = (int)(c1 % n.z);
+            for (int ix = ix0; ix <= ix1; ix++)
+                for (int iy = iy0; iy <= iy1; iy++)
+                    for (int iz = iz0; iz <= iz1; iz++)
+                        entries.push_back(std::make_pair(((long long)ix * n.y + iy) * n.z + iz, s));
+        }
+        std::sort(entries.begin(), entries.end());
+        std::vector<size_t> cell_start;
+        for (size_t e = 0; e < entries.size(); e++) {
+            if (e == 0 || entries[e].first != entries[e - 1].first)
+                cell_start.push_back(e);
+        }
+        cell_start.push_back(entries.size());
+
+        auto overlap = [&](int a, int b) {
+            const real3& amin = aabb_min[a];
+            const real3& amax = aabb_max[a];
+            const real3& bmin = aabb_min[b];
+            const real3& bmax = aabb_max[b];
+            return amin.x <= bmax.x && bmin.x <= amax.x && amin.y <= bmax.y && bmin.y <= amax.y &&
+                   amin.z <= bmax.z && bmin.z <= amax.z;
+        };
+
+        int num_cells = (int)cell_start.size() - 1;
+        int num_large = (int)large.size();
+        int num_tasks = num_cells + num_large;
+#pragma omp parallel
+        {
+            Counts counts(num_groups);
+#pragma omp for schedule(dynamic, 64)
+            for (int t = 0; t < num_tasks; t++) {
+                if (t < num_cells) {
+                    // Pairs of small shapes, counted in the cell containing the min corner of their AABB intersection
+                    for (size_t i = cell_start[t]; i < cell_start[t + 1]; i++) {
+                        for (size_t j = i + 1; j < cell_start[t + 1]; j++) {
+                            int a = entries[i].second;
+                            int b = entries[j].second;
+                            if (!overlap(a, b) || cell_index(Max(aabb_min[a], aabb_min[b])) != entries[i].first)
+                                continue;
+                            Classify(a, b, shape_data, host, body_group, counts);
+                        }
+                    }
+                } else {
+                    // Pairs of a large shape with all small shapes and all following large shapes
+                    int l = t - num_cells;
+                    int a = large[l];
+                    for (int b : small) {
+                        if (overlap(a, b))
+                            Classify(a, b, shape_data, host, body_group, counts);
+                    }
+                    for (int k = l + 1; k < num_large; k++) {
+                        if (overlap(a, large[k]))
+                            Classify(a, large[k], shape_data, host, body_group, counts);
+                    }
+                }
+            }
+#pragma omp critical
+            {
+                m_num_candidates += counts.candidates;
+                m_num_same_body += counts.same_body;
+                m_num_inactive += counts.inactive;
+                m_num_culled += counts.culled;
+                m_num_passed += counts.passed;
+                for (size_t k = 0; k < m_culled.size(); k++) {
+                    m_culled[k] += counts.group_culled[k];
+                    m_passed[k] += counts.group_passed[k];
+                }
+            }
+        }
+    }
+
+    /// Return the number of AABB overlapping shape pairs at the last measure.
+    long long GetNumCandidates() const { return m_num_candidates; }
+
+    /// Return the number of candidate pairs discarded because both shapes belong to the same body, because both
+    /// bodies are inactive, and because of the collision families, at the last measure.
+    long long GetNumSameBody() const { return m_num_same_body; }
+    long long GetNumInactive() const { return m_num_inactive; }
+    long long GetNumCulled() const { return m_num_culled; }
+
+    /// Return the number of candidate pairs passed to the narrowphase at the last measure.
+    long long GetNumPassed() const { return m_num_passed; }
+
+    /// Return the number of pairs culled by the collision families / passed between the given groups (-1 for bodies in
+    /// no group).
+    long long GetNumCulled(int g1, int g2) const { return m_culled[Index(g1, g2)]; }
+    long long GetNumPassed(int g1, int g2) const { return m_passed[Index(g1, g2)]; }
+
+    /// Print the statistics of the last measure.
+    void Print(std::ostream& os) const {
+        os << "Broadphase pairs: " << m_num_candidates << "  same body: " << m_num_same_body
+           << "  inactive: " << m_num_inactive << "  family culled: " << m_num_culled << "  passed: " << m_num_passed
+           << std::endl;
+        if (!m_groups || m_culled.empty())
+            return;
+        int num_groups = m_groups->GetNumGroups();
+        for (int g1 = -1; g1 < num_groups; g1++) {
+            for (int g2 = g1; g2 < num_groups; g2++) {
+                long long culled = GetNumCulled(g1, g2);
+                long long passed = GetNumPassed(g1, g2);
+                if (culled == 0 && passed == 0)
+                    continue;
+                os << "  " << std::setw(20) << (g1 < 0 ? "other" : m_groups->GetName(g1)) << " - " << std::setw(20)
+                   << std::left << (g2 < 0 ? "other" : m_groups->GetName(g2)) << std::right << "  culled: " << culled
+                   << "  passed: " << passed << std::endl;
+            }
+        }
+    }
+
+  private:
+    struct Counts {
+        Counts(int num_groups)
+            : candidates(0),
+              same_body(0),
+              inactive(0),
+              culled(0),
+              passed(0),
+              group_culled(num_groups * num_groups, 0),
+              group_passed(num_groups * num_groups, 0),
+              num_groups(num_groups) {}
+        long long candidates;
+        long long same_body;
+        long long inactive;
+        long long culled;
+        long long passed;
+        std::vector<long long> group_culled;
+        std::vector<long long> group_passed;
+        int num_groups;
+    };
+
+    // Classify a candidate pair in the same order as the multicore broadphase / narrowphase filters
+    static void Classify(int a,
+                         int b,
+                         const chrono::shape_container& shape_data,
+                         const chrono::host_container& host,
+                         const std::vector<int>& body_group,
+                         Counts& counts) {
+        counts.candidates++;
+        auto ida = shape_data.id_rigid[a];
+        auto idb = shape_data.id_rigid[b];
+        if (ida == idb) {
+            counts.same_body++;
+            return;
+        }
+        if (!host.active_rigid[ida] && !host.active_rigid[idb]) {
+            counts.inactive++;
+            return;
+        }
+        const auto& fa = shape_data.fam_rigid[a];
+        const auto& fb = shape_data.fam_rigid[b];
+        int ga = body_group[ida];
+        int gb = body_group[idb];
+        int index = std::min(ga, gb) * counts.num_groups + std::max(ga, gb);
+        if (!((fa.x & fb.y) && (fb.x & fa.y))) {
+            counts.culled++;
+            counts.group_culled[index]++;
+        } else {
+            counts.passed++;
+            counts.group_passed[index]++;
+        }
+    }
+
+    int Index(int g1, int g2) const {
+        int num_groups = (m_groups ? m_groups->GetNumGroups() : 0) + 1;
+        return std::min(g1, g2) * num_groups + std::max(g1, g2) + num_groups + 1;
+    }
+
+    const CollisionGroups* m_groups;
+    long long m_num_candidates;
+    long long m_num_same_body;
+    long long m_num_inactive;
+    long long m_num_culled;
+    long long m_num_passed;
+    std::vector<long long> m_culled;
+    std::vector<long long> m_passed;
+};
+
+#endif
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+
+using namespace chrono;
+
+// Spatial (Morton) ordering of the fluid particles of a 3DOF container.
+// The collision detection bins the particles and gathers them into sorted
+// arrays at every step, but the density and viscosity constraint assembly
+// still reads and scatters through the particle arrays in their storage order.
+// Particles generated by the samplers are ordered row by row, and the order
+// decays further as the fluid mixes, so neighbors end up far apart in memory.
+// Sorting the particles by the Morton code of their cell (side about the
+// kernel radius) keeps neighbors close in memory in all three directions.
+//
+// FluidReorder keeps the layout sorted during the simulation: the particles
+// are re-sorted once any of them has moved farther than the skin distance since
+// the last sort, so the cost of a sort is paid only when the order has decayed.
+// The state of the particles is permuted in place between two steps (the warm
+// start of the fluid constraints is not permuted and is slightly off after a sort).
+
+// Spread the lower 21 bits of x so that there are two zero bits between each.
+inline uint64_t MortonSpread(uint64_t x) {
+	x &= 0x1fffff;
+	x = (x | x << 32) & 0x1f00000000ffff;
+	x = (x | x << 16) & 0x1f0000ff0000ff;
+	x = (x | x << 8) & 0x100f00f00f00f00f;
+	x = (x | x << 4) & 0x10c30c30c30c30c3;
+	x = (x | x << 2) & 0x1249249249249249;
+	return x;
+}
+
+// Return the permutation sorting the given positions by the Morton code of their cell.
+template <typename VECTOR>
+std::vector<uint32_t> MortonOrder(const VECTOR& pos, real cell) {
+	std::vector<uint32_t> order(pos.size());
+	if (pos.empty())
+		return order;
+	real3 lo = pos[0];
+	for (size_t i = 1; i < pos.size(); i++) {
+		lo.x = std::min(lo.x, pos[i].x);
+		lo.y = std::min(lo.y, pos[i].y);
+		lo.z = std::min(lo.z, pos[i].z);
+	}
+	std::vector<uint64_t> codes(pos.size());
+	for (size_t i = 0; i < pos.size(); i++) {
+		uint64_t cx = (uint64_t)((pos[i].x - lo.x) / cell);
+		uint64_t cy = (uint64_t)((pos[i].y - lo.y) / cell);
+		uint64_t cz = (uint64_t)((pos[i].z - lo.z) / cell);
+		codes[i] = MortonSpread(cx) | MortonSpread(cy) << 1 | MortonSpread(cz) << 2;
+		order[i] = (uint32_t)i;
+	}
+	std::sort(order.begin(), order.end(), [&codes](uint32_t a, uint32_t b) { return codes[a] < codes[b]; });
+	return order;
+}
+
+// Apply the permutation to the given array (element i of the result is element order[i]).
+template <typename VECTOR>
+void ApplyOrder(const std::vector<uint32_t>& order, VECTOR& data) {
+	VECTOR sorted(data.size());
+	for (size_t i = 0; i < order.size(); i++)
+		sorted[i] = data[order[i]];
+	data.swap(sorted);
+}
+
+// Sort the initial fluid particles in Morton order before adding them to the container.
+inline void SortFluidMorton(std::vector<real3>& pos, std::vector<real3>& vel, real cell) {
+	std::vector<uint32_t> order = MortonOrder(pos, cell);
+	ApplyOrder(order, pos);
+	ApplyOrder(order, vel);
+}
+
+class FluidReorder {
+public:
+	// Sort with cells of the given side, whenever a particle has moved farther than skin.
+	FluidReorder(real cell, real skin) : cell(cell), skin(skin), num_sorts(0), num_updates(0) {}
+
+	// Check the displacements of the particles after a step and re-sort them if needed.
+	// Return true if the particles were sorted.
+	bool Update(ChSystemMulticore* system) {
+		custom_vector<real3>& pos = system->data_manager->host_data.pos_3dof;
+		custom_vector<real3>& vel = system->data_manager->host_data.vel_3dof;
+		num_updates++;
+		if (ref_pos.size() == pos.size()) {
+			real max_d2 = 0;
+			for (size_t i = 0; i < pos.size(); i++)
+				max_d2 = std::max(max_d2, Length2(pos[i] - ref_pos[i]));
+			if (max_d2 <= skin * skin)
+				return false;
+		}
+		std::vector<uint32_t> order = MortonOrder(pos, cell);
+		ApplyOrder(order, pos);
+		ApplyOrder(order, vel);
+		ref_pos.assign(pos.begin(), pos.end());
+		num_sorts++;
+		return true;
+	}
+
+	// Number of sorts (including the first one) and of updates so far.
+	int GetNumSorts() const { return num_sorts; }
+	int GetNumUpdates() const { return num_updates; }
+
+private:
+	real cell;
+	real skin;
+	std::vector<real3> ref_pos;  // positions at the last sort
+	int num_sorts;
+	int num_updates;
+};
@@ -8,6 +8,8 @@
 #include "chrono_multicore/physics/ChSystemMulticore.h"
 #include "chrono_multicore/solver/ChSystemDescriptorMulticore.h"
 
+#include "fluid_ordering.h"
+
 using namespace chrono;
 using namespace chrono::collision;
 using namespace chrono::utils;
@@ -265,6 +267,7 @@ void CreateFluid(ChSystemMulticoreNSC* system) {
     real vol = dist * dist * dist * .8;
     mass = rho * vol;
     std::cout << "fluid_mass: " << mass << " " << pos_fluid.size() << std::endl;
+    SortFluidMorton(pos_fluid, vel_fluid, dof_container->kernel_radius);
     if (ChFluidContainer* fluid_container = dynamic_cast<ChFluidContainer*>(dof_container)) {
         fluid_container->mass = mass;
         fluid_container->AddBodies(pos_fluid, vel_fluid);
@@ -4,6 +4,11 @@
 #include <sstream>
 #include <cstring>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <cstdint>
+#include <algorithm>
 #include <zlib.h>
 
 #include "chrono/assets/ChVisualization.h"
@@ -25,35 +30,56 @@ using namespace chrono::collision;
 using std::cout;
 using std::endl;
 
+// Streaming writer for comma-separated output, optionally gzip-compressed.
+// Tokens are formatted into a buffer which is handed over, in chunks of bounded
+// size, to a background thread writing (and deflating) them incrementally; at
+// most a few chunks are queued, so memory use does not grow with the output.
+// In typed mode, tokens are written in binary form (a one-byte type tag followed
+// by the raw values; strings are length-prefixed) instead of decimal text.
 class CSVGen {
 public:
-	CSVGen() {
+	enum Tag : char { TAG_REAL = 'r', TAG_REAL2 = '2', TAG_REAL3 = '3', TAG_REAL4 = '4', TAG_QUAT = 'q', TAG_STRING = 's', TAG_ENDLINE = 'n' };
+
+	CSVGen(size_t chunk_size = 1 << 20, size_t max_chunks = 4) {
 		delim = ",";
 		binary = false;
+		typed = false;
 		gz_file = 0;
+		chunk = chunk_size;
+		max_queued = max_chunks;
+		stop = false;
 	}
-	~CSVGen() {}
+	~CSVGen() { CloseFile(); }
 
-	void OpenFile(std::string filename, bool bin = false) {
-		if (bin) {
-			binary = true;
+	// Open the output file (gzip-compressed if bin is true; binary tokens if typed is true).
+	void OpenFile(std::string filename, bool bin = false, bool typed_tokens = false) {
+		binary = bin;
+		typed = typed_tokens;
+		if (binary) {
 			gz_file = gzopen(filename.c_str(), "wb");
 		}
 		else {
-			ofile.open(filename.c_str(), std::ios::out);
+			ofile.open(filename.c_str(), typed ? std::ios::out | std::ios::binary : std::ios::out);
 		}
+		stop = false;
+		writer = std::thread(&CSVGen::Drain, this);
 	}
 
 	void CloseFile() {
+		if (!writer.joinable())
+			return;
+		Flush();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		cv.notify_all();
+		writer.join();
 		if (binary) {
-			unsigned long int file_size = sizeof(char) * ss.str().size();
-
-			gzwrite(gz_file, (void*)&file_size, sizeof(file_size));  // writing size of file
-			gzwrite(gz_file, (void*)(ss.str().data()), file_size);
 			gzclose(gz_file);
+			gz_file = 0;
 		}
 		else {
-			ofile << ss.str();
 			ofile.close();
 		}
 	}
@@ -61,25 +87,127 @@ public:
 	void operator<<(const T& token) {
 		WriteToken(token);
 	}
-	void WriteToken(real token) { ss << token << delim; }
-	void WriteToken(real2 token) { ss << token.x << delim << token.y << delim; }
-	void WriteToken(real3 token) { ss << token.x << delim << token.y << delim << token.z << delim; }
-	void WriteToken(real4 token) { ss << token.x << delim << token.y << delim << token.z << delim << token.w << delim; }
+	void WriteToken(real token) {
+		if (typed)
+			Raw(TAG_REAL, &token, 1);
+		else
+			ss << token << delim;
+		Check();
+	}
+	void WriteToken(real2 token) {
+		if (typed) {
+			real v[2] = { token.x, token.y };
+			Raw(TAG_REAL2, v, 2);
+		}
+		else
+			ss << token.x << delim << token.y << delim;
+		Check();
+	}
+	void WriteToken(real3 token) {
+		if (typed) {
+			real v[3] = { token.x, token.y, token.z };
+			Raw(TAG_REAL3, v, 3);
+		}
+		else
+			ss << token.x << delim << token.y << delim << token.z << delim;
+		Check();
+	}
+	void WriteToken(real4 token) {
+		if (typed) {
+			real v[4] = { token.x, token.y, token.z, token.w };
+			Raw(TAG_REAL4, v, 4);
+		}
+		else
+			ss << token.x << delim << token.y << delim << token.z << delim << token.w << delim;
+		Check();
+	}
 	void WriteToken(quaternion token) {
-		ss << token.w << delim << token.x << delim << token.y << delim << token.z << delim;
+		if (typed) {
+			real v[4] = { token.w, token.x, token.y, token.z };
+			Raw(TAG_QUAT, v, 4);
+		}
+		else
+			ss << token.w << delim << token.x << delim << token.y << delim << token.z << delim;
+		Check();
 	}
-	void WriteToken(ChVector<> token) { ss << token.x() << delim << token.y() << delim << token.z() << delim; }
-	void WriteToken(ChQuaternion<> token) {
-		ss << token.e0() << delim << token.e1() << delim << token.e2() << delim << token.e3() << delim;
+	void WriteToken(ChVector<> token) { WriteToken(real3(token.x(), token.y(), token.z())); }
+	void WriteToken(ChQuaternion<> token) { WriteToken(quaternion(token.e0(), token.e1(), token.e2(), token.e3())); }
+	void WriteToken(std::string token) {
+		if (typed) {
+			uint32_t size = (uint32_t)token.size();
+			ss.put(TAG_STRING);
+			ss.write(reinterpret_cast<const char*>(&size), sizeof(size));
+			ss.write(token.data(), size);
+		}
+		else
+			ss << token << delim;
+		Check();
+	}
+	void endline() {
+		if (typed)
+			ss.put(TAG_ENDLINE);
+		else
+			ss << std::endl;
+		Check();
 	}
-	void WriteToken(std::string token) { ss << token << delim; }
-	void endline() { ss << std::endl; }
 
 	std::string delim;
 	std::ofstream ofile;
 	std::stringstream ss;
 	gzFile gz_file;
 	bool binary;
+	bool typed;
+
+private:
+	void Raw(char tag, const real* values, int count) {
+		ss.put(tag);
+		ss.write(reinterpret_cast<const char*>(values), count * sizeof(real));
+	}
+
+	// Hand over the buffer to the writer thread once it reaches the chunk size.
+	void Check() {
+		if ((size_t)ss.tellp() >= chunk)
+			Flush();
+	}
+
+	void Flush() {
+		std::string data = ss.str();
+		ss.str("");
+		ss.clear();
+		if (data.empty())
+			return;
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [this]() { return queue.size() < max_queued; });
+		queue.push_back(std::move(data));
+		cv.notify_all();
+	}
+
+	void Drain() {
+		while (true) {
+			std::string data;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait(lock, [this]() { return stop || !queue.empty(); });
+				if (queue.empty())
+					break;
+				data = std::move(queue.front());
+				queue.pop_front();
+				cv.notify_all();
+			}
+			if (binary)
+				gzwrite(gz_file, (void*)data.data(), (unsigned int)data.size());
+			else
+				ofile.write(data.data(), data.size());
+		}
+	}
+
+	size_t chunk;
+	size_t max_queued;
+	std::deque<std::string> queue;
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool stop;
 };
 
 
@@ -104,6 +232,66 @@ public:
 	std::ofstream bin_file;
 };
 
+// Fixed-size records of doubles appended to a single binary file, e.g. one
+// record per output frame instead of one text file per frame. Writes go
+// through a large stream buffer, so a record costs about a memcpy.
+// File layout: magic "CHRB", uint32 number of doubles per record, records.
+class RecordGen {
+public:
+	RecordGen() : record_size(0) {}
+	~RecordGen() { CloseFile(); }
+	void OpenFile(std::string filename, uint32_t size) {
+		buffer.resize(1 << 20);
+		rec_file.rdbuf()->pubsetbuf(&buffer[0], buffer.size());
+		rec_file.open(filename.c_str(), std::ios::out | std::ofstream::binary);
+		record_size = size;
+		rec_file.write("CHRB", 4);
+		rec_file.write(reinterpret_cast<const char*>(&record_size), sizeof(record_size));
+	}
+	void CloseFile() {
+		if (rec_file.is_open())
+			rec_file.close();
+	}
+	// Append one record (shorter records are padded with zeros, longer ones truncated).
+	void Write(const std::vector<double>& record) {
+		scratch.assign(record.begin(), record.begin() + std::min(record.size(), (size_t)record_size));
+		scratch.resize(record_size, 0.0);
+		if (record_size > 0)
+			rec_file.write(reinterpret_cast<const char*>(&scratch[0]), record_size * sizeof(double));
+	}
+	uint32_t GetRecordSize() const { return record_size; }
+
+private:
+	std::ofstream rec_file;
+	std::vector<char> buffer;
+	std::vector<double> scratch;
+	uint32_t record_size;
+};
+
+// Contact force and torque resultants of a fixed set of bodies, gathered in one
+// contiguous array (force of body i at 2 * i, torque at 2 * i + 1) with a
+// single call to CalculateContactForces. The body identifiers are cached when
+// the bodies are added, so an update does not walk the vehicle subsystems.
+class BodyContactResultants {
+public:
+	void AddBody(std::shared_ptr<ChBody> body) { ids.push_back(body->GetId()); }
+	size_t GetNumBodies() const { return ids.size(); }
+	const std::vector<real3>& Update(chrono::ChSystemMulticoreNSC* system) {
+		system->CalculateContactForces();
+		resultants.resize(2 * ids.size());
+		for (size_t i = 0; i < ids.size(); i++) {
+			resultants[2 * i] = system->GetBodyContactForce(ids[i]);
+			resultants[2 * i + 1] = system->GetBodyContactTorque(ids[i]);
+		}
+		return resultants;
+	}
+	const std::vector<real3>& GetResultants() const { return resultants; }
+
+private:
+	std::vector<uint> ids;
+	std::vector<real3> resultants;
+};
+
 static std::vector<std::thread> writethreads;
 
 void static WriteLocalData(const std::string&& filename,
@@ -37,6 +37,7 @@
 #include "chrono_multicore/solver/ChSystemDescriptorMulticore.h"
 #include "chrono_vehicle/driver/ChPathFollowerDriver.h"
 #include "input_output.h"
+#include "fluid_ordering.h"
 
 #undef CHRONO_OPENGL
 #ifdef CHRONO_OPENGL
@@ -341,6 +342,7 @@ void CreateFluid(ChSystemMulticoreNSC* system) {
         pos_fluid.push_back(real3(points[i].x(), points[i].y(), points[i].z()));
         vel_fluid.push_back(real3(0));
     }
+    SortFluidMorton(pos_fluid, vel_fluid, fluid_container->kernel_radius);
     fluid_container->AddBodies(pos_fluid, vel_fluid);
 
     real vol = dist * dist * dist * .8;
@@ -577,6 +579,8 @@ int main(int argc, char* argv[]) {
 
     ChVector<> driver_pos = my_hmmwv.GetVehicle().GetChassis()->GetLocalDriverCoordsys().pos;
 
+    FluidReorder fluid_reorder(fluid_r, fluid_r);
+
     while (time < time_end) {
         if (simulation_mode != GRAVEL) {
             bottom_plate->SetPos(ChVector<>(my_hmmwv.GetChassis()->GetBody()->GetPos().x(),
@@ -613,6 +617,7 @@ int main(int argc, char* argv[]) {
                 time += time_step;
                 sim_frame++;
                 exec_time += system->GetTimerStep();
+                fluid_reorder.Update(system);
             }
             gl_window.Render();
         } else {
@@ -642,10 +647,13 @@ int main(int argc, char* argv[]) {
         time += time_step;
         sim_frame++;
         exec_time += system->GetTimerStep();
+        fluid_reorder.Update(system);
 
 #endif
     }
     cout << "==================================" << endl;
     cout << "Simulation time:   " << exec_time << endl;
+    cout << "Fluid sorts:       " << fluid_reorder.GetNumSorts() << " in " << fluid_reorder.GetNumUpdates() << " steps"
+         << endl;
     return 0;
 }
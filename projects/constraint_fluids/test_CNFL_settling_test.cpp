@@ -12,6 +12,8 @@
 
 #include "chrono_multicore/physics/Ch3DOFContainer.h"
 
+#include "fluid_ordering.h"
+
 #ifdef CHRONO_OPENGL
 #include "chrono_opengl/ChOpenGLWindow.h"
 #endif
@@ -179,6 +181,7 @@ void AddFluid(ChSystemMulticoreNSC* sys) {
 	fluid_container->mass = (fluid_container->rho + 400) * vol;
 	std::cout << "fluid_mass: " << fluid_container->mass << std::endl;
 	fluid_container->UpdatePosition(0);
+	SortFluidMorton(pos_fluid, vel_fluid, kernel_radius);
 	fluid_container->AddBodies(pos_fluid, vel_fluid);
 }
 
@@ -278,14 +281,18 @@ int main(int argc, char* argv[]) {
 	double exec_time = 0;
 	int num_steps = time_end / timestep;
 
+	FluidReorder fluid_reorder(kernel_radius, kernel_radius);
+
 	//=========================================================================================================
 	for (int i = 0; i < num_steps; i++) {
 		msystem.DoStepDynamics(timestep);
 		WriteData(&msystem, i);
 		exec_time += msystem.GetTimerStep();
+		fluid_reorder.Update(&msystem);
 	}
 	ofile << exec_time << std::endl;
 	printf("Execution Time: %f \n", exec_time);
+	printf("Fluid sorts: %d in %d steps\n", fluid_reorder.GetNumSorts(), fluid_reorder.GetNumUpdates());
 #endif
 	ofile.close();
 	return 0;
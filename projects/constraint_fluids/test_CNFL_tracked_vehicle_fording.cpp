@@ -131,6 +131,11 @@ int bilateral_frame_interval = 100;
 
 int out_fps = 60;
 
+// Vehicle and track shoe force statistics: one binary record per stats frame in a single file (stats.bin, see
+// WriteTrackedVehicleRecord), or one text file per stats frame
+bool binary_stats = true;
+int stats_fps = 60;
+
 double target_speed = 2;
 // =============================================================================
 
@@ -174,6 +179,46 @@ void static WriteTrackedVehicleData(M113_Vehicle_Custom& vehicle,
     csv_output.CloseFile();
 }
 
+// Number of doubles in a record of WriteTrackedVehicleRecord for the given number of bodies with force resultants.
+uint32_t TrackedVehicleRecordSize(size_t num_bodies) {
+    return (uint32_t)(13 + 6 * num_bodies);
+}
+
+// Append the vehicle state and the contact force resultants (chassis, then left and right track shoes) to the stats
+// file. Record: time, chassis position (3), vehicle speed, driveshaft speed, motor torque, motor speed, output torque,
+// throttle, braking, left and right sprocket torques, then force (3) and torque (3) per body.
+void static WriteTrackedVehicleRecord(M113_Vehicle_Custom& vehicle,
+                                      const ChDriver::Inputs& driver_inputs,
+                                      double time,
+                                      const std::vector<real3>& resultants,
+                                      std::vector<double>& record,
+                                      RecordGen& stats_output) {
+    auto m_driveline = vehicle.GetDriveline();
+    auto m_powertrain = vehicle.GetPowertrain();
+    ChVector<> pos = vehicle.GetChassisBody()->GetPos();
+
+    record.clear();
+    record.push_back(time);
+    record.push_back(pos.x());
+    record.push_back(pos.y());
+    record.push_back(pos.z());
+    record.push_back(vehicle.GetVehicleSpeed());
+    record.push_back(m_driveline->GetDriveshaftSpeed());
+    record.push_back(m_powertrain->GetMotorTorque());
+    record.push_back(m_powertrain->GetMotorSpeed());
+    record.push_back(m_powertrain->GetOutputTorque());
+    record.push_back(driver_inputs.m_throttle);
+    record.push_back(driver_inputs.m_braking);
+    record.push_back(m_driveline->GetSprocketTorque(LEFT));
+    record.push_back(m_driveline->GetSprocketTorque(RIGHT));
+    for (size_t i = 0; i < resultants.size(); i++) {
+        record.push_back(resultants[i].x);
+        record.push_back(resultants[i].y);
+        record.push_back(resultants[i].z);
+    }
+    stats_output.Write(record);
+}
+
 double CreateParticles(ChSystemMulticoreNSC* system) {
     // Create a material
     auto mat_g = chrono_types::make_shared<ChMaterialSurfaceNSC>();
@@ -291,6 +336,19 @@ int main(int argc, char* argv[]) {
     auto powertrain = chrono_types::make_shared<M113_SimpleCVTPowertrain>("powertrain");
     vehicle.InitializePowertrain(powertrain);
 
+    // Bodies whose contact force resultants are recorded: chassis, left and right track shoes
+    BodyContactResultants shoe_resultants;
+    shoe_resultants.AddBody(vehicle.GetChassisBody());
+    for (int i = 0; i < vehicle.GetNumTrackShoes(LEFT); i++)
+        shoe_resultants.AddBody(vehicle.GetTrackShoe(LEFT, i)->GetShoeBody());
+    for (int i = 0; i < vehicle.GetNumTrackShoes(RIGHT); i++)
+        shoe_resultants.AddBody(vehicle.GetTrackShoe(RIGHT, i)->GetShoeBody());
+
+    RecordGen stats_output;
+    std::vector<double> stats_record;
+    if (binary_stats)
+        stats_output.OpenFile(data_output_path + "stats.bin", TrackedVehicleRecordSize(shoe_resultants.GetNumBodies()));
+
     // ---------------
     // Simulation loop
     // ---------------
@@ -305,12 +363,15 @@ int main(int argc, char* argv[]) {
 
     // Number of simulation steps between two 3D view render frames
     int out_steps = (int)std::ceil((1.0 / time_step) / out_fps);
+    int stats_steps = (int)std::ceil((1.0 / time_step) / stats_fps);
 
     // Run simulation for specified time.
     double time = 0;
     int sim_frame = 0;
     int out_frame = 0;
     int next_out_frame = 0;
+    int stats_frame = 0;
+    int next_stats_frame = 0;
     double exec_time = 0;
     int num_contacts = 0;
 
@@ -322,6 +383,8 @@ int main(int argc, char* argv[]) {
 
     bool set_time = true;
 
+    FluidReorder fluid_reorder(dof_container->kernel_radius, dof_container->kernel_radius);
+
     while (time < time_end) {
         // Driver inputs
         ChDriver::Inputs driver_inputs = {0, 0, 0};
@@ -358,32 +421,32 @@ int main(int argc, char* argv[]) {
         vehicle.GetTrackShoeStates(LEFT, shoe_states_left);
         vehicle.GetTrackShoeStates(RIGHT, shoe_states_right);
 
+        // Force statistics (total force and torques on tracks and chassis)
+        if (sim_frame == next_stats_frame) {
+            const std::vector<real3>& resultants = shoe_resultants.Update(system);
+            if (binary_stats) {
+                WriteTrackedVehicleRecord(vehicle, driver_inputs, time, resultants, stats_record, stats_output);
+            } else {
+                forces.resize(0);
+                torques.resize(0);
+                for (size_t i = 0; i < shoe_resultants.GetNumBodies(); i++) {
+                    forces.push_back(resultants[2 * i]);
+                    torques.push_back(resultants[2 * i + 1]);
+                }
+                WriteTrackedVehicleData(vehicle, driver_inputs, forces, torques,
+                                        data_output_path + "stats_" + std::to_string(stats_frame) + ".dat");
+            }
+            stats_frame++;
+            next_stats_frame += stats_steps;
+        }
+
         // Output
         if (sim_frame == next_out_frame) {
             std::cout << "write: " << out_frame << std::endl;
-            forces.resize(0);
-            torques.resize(0);
-
-            system->CalculateContactForces();
-
-            // get total force and torques on tracks and chassis
-            forces.push_back(system->GetBodyContactForce(vehicle.GetChassisBody()->GetId()));
-            torques.push_back(system->GetBodyContactTorque(vehicle.GetChassisBody()->GetId()));
-
-            for (int i = 0; i < vehicle.GetNumTrackShoes(LEFT); i++) {
-                forces.push_back(system->GetBodyContactForce(vehicle.GetTrackShoe(LEFT, i)->GetShoeBody()->GetId()));
-                torques.push_back(system->GetBodyContactTorque(vehicle.GetTrackShoe(LEFT, i)->GetShoeBody()->GetId()));
-            }
-            for (int i = 0; i < vehicle.GetNumTrackShoes(RIGHT); i++) {
-                forces.push_back(system->GetBodyContactForce(vehicle.GetTrackShoe(RIGHT, i)->GetShoeBody()->GetId()));
-                torques.push_back(system->GetBodyContactTorque(vehicle.GetTrackShoe(RIGHT, i)->GetShoeBody()->GetId()));
-            }
 
             DumpFluidData(system, data_output_path + "data_" + std::to_string(out_frame) + ".dat", true);
             DumpAllObjectsWithGeometryPovray(system, data_output_path + "vehicle_" + std::to_string(out_frame) + ".dat",
                                              true);
-            WriteTrackedVehicleData(vehicle, driver_inputs, forces, torques,
-                                    data_output_path + "stats_" + std::to_string(out_frame) + ".dat");
 
             out_frame++;
             next_out_frame += out_steps;
@@ -408,6 +471,7 @@ int main(int argc, char* argv[]) {
                 sim_frame++;
                 exec_time += system->GetTimerStep();
                 num_contacts += system->GetNcontacts();
+                fluid_reorder.Update(system);
             }
             gl_window.Render();
         } else {
@@ -419,6 +483,7 @@ int main(int argc, char* argv[]) {
         sim_frame++;
         exec_time += system->GetTimerStep();
         num_contacts += system->GetNcontacts();
+        fluid_reorder.Update(system);
 
 #endif
     }
@@ -426,6 +491,8 @@ int main(int argc, char* argv[]) {
     // Final stats
     std::cout << "==================================" << std::endl;
     std::cout << "Simulation time:   " << exec_time << std::endl;
+    std::cout << "Fluid sorts:       " << fluid_reorder.GetNumSorts() << " in " << fluid_reorder.GetNumUpdates()
+              << " steps" << std::endl;
 
     return 0;
 }
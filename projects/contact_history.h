@@ -0,0 +1,201 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Compaction and statistics of the Chrono::Multicore SMC contact history
+// (tangential displacement model MultiStep).
+//
+// The multicore SMC solver keeps the contact history in fixed-size slot arrays
+// per body (shear neighbors, shear displacements, initial relative velocities,
+// and contact durations), searched linearly for each contact at each step.
+// ContactHistory::Update, called after each step:
+//   - compacts the slots of each body, so that the valid entries are
+//     contiguous at the front of the body's slots, sorted by key (neighbor
+//     body, shape on the owner body, shape on the neighbor body), and the free
+//     slots are cleared;
+//   - collects the entries into a store sorted by (owner body, neighbor body,
+//     shapes) key;
+//   - merges this store with the one of the previous step in a single linear
+//     pass, counting the entries found again (history lookups which hit), the
+//     new entries (contacts without history), and the stale entries (contacts
+//     which ended and whose history was dropped).
+// The time spent in Update is accumulated, to be compared with the narrowphase
+// timer (see TimingOutput in utils.h). Systems with more than 64 history slots
+// per body are left unchanged (and no statistics are collected).
+//
+// =============================================================================
+
+#ifndef CONTACT_HISTORY_H
+#define CONTACT_HISTORY_H
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+#include "chrono/core/ChTimer.h"
+
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+
+class ContactHistory {
+  public:
+    ContactHistory()
+        : m_num_hits(0), m_num_new(0), m_num_stale(0), m_total_hits(0), m_total_lookups(0), m_num_moved(0) {}
+
+    /// Compact the contact history of the system and update the statistics. Must be called after each step.
+    void Update(chrono::ChSystemMulticore* system) {
+        using namespace chrono;
+
+        m_timer.start();
+
+        auto& host = system->data_manager->host_data;
+        int num_bodies = (int)system->data_manager->num_rigid_bodies;
+        int max_shear = num_bodies > 0 ? (int)(host.shear_neigh.size() / num_bodies) : 0;
+        size_t num_slots = host.shear_neigh.size();
+        if (max_shear == 0 || max_shear > kMaxSlots || host.shear_disp.size() != num_slots ||
+            host.contact_relvel_init.size() != num_slots || host.contact_duration.size() != num_slots) {
+            m_timer.stop();
+            return;
+        }
+
+        // Compact and sort the slots of each body; count the valid entries
+        std::vector<int> count(num_bodies + 1, 0);
+        int num_moved = 0;
+#pragma omp parallel for schedule(dynamic, 256) reduction(+ : num_moved)
+        for (int ib = 0; ib < num_bodies; ib++)
+            count[ib + 1] = CompactBody(host, ib, max_shear, num_moved);
+        for (int ib = 0; ib < num_bodies; ib++)
+            count[ib + 1] += count[ib];
+        m_num_moved = num_moved;
+
+        // Collect the sorted store (bodies in increasing order, slots sorted within each body)
+        std::vector<Key> keys(count[num_bodies]);
+#pragma omp parallel for schedule(static)
+        for (int ib = 0; ib < num_bodies; ib++) {
+            for (int k = 0; k < count[ib + 1] - count[ib]; k++) {
+                const auto& neigh = host.shear_neigh[max_shear * ib + k];
+                keys[count[ib] + k] = Key(ib, neigh.x, neigh.y, neigh.z);
+            }
+        }
+
+        // Merge with the store of the previous step
+        int hits = 0;
+        size_t i = 0;
+        size_t j = 0;
+        while (i < m_keys.size() && j < keys.size()) {
+            if (m_keys[i] < keys[j]) {
+                i++;
+            } else if (keys[j] < m_keys[i]) {
+                j++;
+            } else {
+                hits++;
+                i++;
+                j++;
+            }
+        }
+        m_num_hits = hits;
+        m_num_new = (int)keys.size() - hits;
+        m_num_stale = (int)m_keys.size() - hits;
+        m_total_hits += m_num_hits;
+        m_total_lookups += (long long)keys.size();
+        m_keys.swap(keys);
+
+        m_timer.stop();
+    }
+
+    /// Return the number of history entries after the last update.
+    int GetNumEntries() const { return (int)m_keys.size(); }
+
+    /// Return the number of entries found again, new, and dropped (stale) at the last update.
+    int GetNumHits() const { return m_num_hits; }
+    int GetNumNew() const { return m_num_new; }
+    int GetNumStale() const { return m_num_stale; }
+
+    /// Return the fraction of history lookups which hit, over all updates.
+    double GetHitRate() const { return m_total_lookups > 0 ? (double)m_total_hits / m_total_lookups : 0; }
+
+    /// Return the number of slots moved by the compaction at the last update.
+    int GetNumMoved() const { return m_num_moved; }
+
+    /// Return the cumulative time spent in Update (s).
+    double GetTime() const { return m_timer.GetTimeSeconds(); }
+
+  private:
+    // (owner body, neighbor body, shape on owner, shape on neighbor)
+    typedef std::tuple<int, int, int, int> Key;
+
+    // Maximum number of history slots per body supported by the compaction
+    static const int kMaxSlots = 64;
+
+    // Move the valid slots of the given body to the front, in key order, and clear the free slots.
+    // Return the number of valid slots.
+    static int CompactBody(chrono::host_container& host, int ib, int max_shear, int& num_moved) {
+        using namespace chrono;
+
+        int start = max_shear * ib;
+        int valid[kMaxSlots];
+        int n = 0;
+        for (int k = 0; k < max_shear; k++) {
+            if (host.shear_neigh[start + k].x != -1)
+                valid[n++] = k;
+        }
+        auto key = [&](int k) {
+            const auto& neigh = host.shear_neigh[start + k];
+            return std::make_tuple(neigh.x, neigh.y, neigh.z);
+        };
+        std::sort(valid, valid + n, [&](int a, int b) { return key(a) < key(b); });
+
+        bool ordered = true;
+        for (int k = 0; k < n; k++)
+            ordered = ordered && valid[k] == k;
+        if (ordered)
+            return n;
+
+        // Permute through temporary copies of the valid slots
+        decltype(host.shear_neigh)::value_type neigh[kMaxSlots];
+        decltype(host.shear_disp)::value_type disp[kMaxSlots];
+        decltype(host.contact_relvel_init)::value_type relvel[kMaxSlots];
+        decltype(host.contact_duration)::value_type duration[kMaxSlots];
+        for (int k = 0; k < n; k++) {
+            neigh[k] = host.shear_neigh[start + valid[k]];
+            disp[k] = host.shear_disp[start + valid[k]];
+            relvel[k] = host.contact_relvel_init[start + valid[k]];
+            duration[k] = host.contact_duration[start + valid[k]];
+            if (valid[k] != k)
+                num_moved++;
+        }
+        for (int k = 0; k < n; k++) {
+            host.shear_neigh[start + k] = neigh[k];
+            host.shear_disp[start + k] = disp[k];
+            host.contact_relvel_init[start + k] = relvel[k];
+            host.contact_duration[start + k] = duration[k];
+        }
+        for (int k = n; k < max_shear; k++) {
+            host.shear_neigh[start + k].x = -1;
+            host.shear_neigh[start + k].y = -1;
+            host.shear_neigh[start + k].z = -1;
+            host.shear_disp[start + k] = real3(0);
+            host.contact_relvel_init[start + k] = 0;
+            host.contact_duration[start + k] = 0;
+        }
+        return n;
+    }
+
+    std::vector<Key> m_keys;
+    int m_num_hits;
+    int m_num_new;
+    int m_num_stale;
+    long long m_total_hits;
+    long long m_total_lookups;
+    int m_num_moved;
+    chrono::ChTimer<double> m_timer;
+};
+
+#endif
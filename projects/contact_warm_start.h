@@ -0,0 +1,213 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Warm starting of the Chrono::Multicore NSC contact solver across steps.
+//
+// The multicore NSC solvers (APGD, BB, ...) start each step from zero contact
+// impulses. ContactWarmStart wraps the solver selected for the system: at the
+// end of each solve, the contact impulses (normal, sliding, and spinning
+// components, depending on the solver mode) are stored together with the
+// identification of their contact, i.e., the pair of body indices and the rank
+// of the contact within the pair (for shapes with multiple contacts). At the
+// first solve of the next step, the impulses of contacts persisting from the
+// previous step are copied in the initial guess; new contacts start from zero.
+//
+// The number of solver iterations of each step is recorded, so that runs with
+// and without warm start (see SetEnabled) can be compared.
+//
+// Typical use (after selecting the solver type):
+//   system->ChangeSolverType(SolverType::APGD);
+//   ContactWarmStart* warm_start = EnableContactWarmStart(system);
+//
+// Note that ChangeSolverType replaces (and deletes) the wrapper.
+//
+// =============================================================================
+
+#ifndef CONTACT_WARM_START_H
+#define CONTACT_WARM_START_H
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+#include "chrono_multicore/solver/ChIterativeSolverMulticore.h"
+#include "chrono_multicore/solver/ChSolverMulticore.h"
+
+class ContactWarmStart : public chrono::ChSolverMulticore {
+  public:
+    /// Wrap the given solver (which is then owned by the wrapper).
+    ContactWarmStart(chrono::ChSystemMulticore* system, chrono::ChSolverMulticore* solver)
+        : m_system(system),
+          m_solver(solver),
+          m_enabled(true),
+          m_time(-1),
+          m_prev_nc(0),
+          m_num_warm(0),
+          m_step_iterations(0),
+          m_total_iterations(0),
+          m_num_steps(0) {}
+
+    ~ContactWarmStart() { delete m_solver; }
+
+    /// Enable/disable warm starting (iterations are still recorded when disabled).
+    void SetEnabled(bool enabled) { m_enabled = enabled; }
+
+    virtual chrono::uint Solve(chrono::ChShurProduct& SchurProduct,
+                               chrono::ChProjectConstraints& Project,
+                               const chrono::uint max_iter,
+                               const chrono::uint size,
+                               const chrono::DynamicVector<chrono::real>& b,
+                               chrono::DynamicVector<chrono::real>& x) override {
+        bool first = m_system->GetChTime() != m_time;
+        if (first) {
+            if (m_time >= 0) {
+                m_total_iterations += m_step_iterations;
+                m_num_steps++;
+            }
+            m_time = m_system->GetChTime();
+            m_step_iterations = 0;
+            m_num_warm = m_enabled ? Apply(x) : 0;
+        }
+
+        m_solver->Setup(data_manager);
+        chrono::uint iterations = m_solver->Solve(SchurProduct, Project, max_iter, size, b, x);
+        current_iteration = m_solver->current_iteration;
+        m_step_iterations += iterations;
+
+        Record(x);
+        return iterations;
+    }
+
+    /// Return the number of contacts warm started at the last step.
+    int GetNumWarmStarted() const { return m_num_warm; }
+
+    /// Return the number of solver iterations at the last step.
+    int GetStepIterations() const { return m_step_iterations; }
+
+    /// Return the average number of solver iterations per step.
+    double GetAverageIterations() const {
+        long total = m_total_iterations + m_step_iterations;
+        int steps = m_num_steps + (m_time >= 0 ? 1 : 0);
+        return steps > 0 ? (double)total / steps : 0;
+    }
+
+  private:
+    struct Entry {
+        uint64_t key;  // body pair
+        int rank;      // rank of the contact within the pair
+        int index;     // contact index in the stored impulses
+        bool operator<(const Entry& other) const {
+            return key < other.key || (key == other.key && rank < other.rank);
+        }
+    };
+
+    // Number of impulse components per contact, for the solver mode.
+    int GetNumComponents() const {
+        switch (data_manager->settings.solver.solver_mode) {
+            case chrono::SolverMode::NORMAL:
+                return 1;
+            case chrono::SolverMode::SLIDING:
+                return 3;
+            default:
+                return 6;
+        }
+    }
+
+    // Identify the current contacts (body pair and rank within pair).
+    void Identify(std::vector<Entry>& entries) const {
+        const auto& bids = data_manager->cd_data->bids_rigid_rigid;
+        int num_contacts = (int)data_manager->cd_data->num_rigid_contacts;
+        entries.resize(num_contacts);
+        std::unordered_map<uint64_t, int> count;
+        for (int i = 0; i < num_contacts; i++) {
+            uint64_t key = ((uint64_t)(uint32_t)bids[i].x << 32) | (uint32_t)bids[i].y;
+            entries[i].key = key;
+            entries[i].rank = count[key]++;
+            entries[i].index = i;
+        }
+    }
+
+    // Copy the impulses of the persisting contacts in the initial guess. Return the number of warm-started contacts.
+    int Apply(chrono::DynamicVector<chrono::real>& x) {
+        int num_contacts = (int)data_manager->cd_data->num_rigid_contacts;
+        int nc = GetNumComponents();
+        if (m_prev.empty() || num_contacts == 0 || m_prev_nc != nc || x.size() < (size_t)(nc * num_contacts))
+            return 0;
+
+        std::vector<Entry> current;
+        Identify(current);
+        int prev_contacts = (int)m_prev.size();
+        int num_warm = 0;
+#pragma omp parallel for schedule(static) reduction(+ : num_warm)
+        for (int i = 0; i < num_contacts; i++) {
+            auto it = std::lower_bound(m_prev.begin(), m_prev.end(), current[i]);
+            if (it == m_prev.end() || it->key != current[i].key || it->rank != current[i].rank)
+                continue;
+            int j = it->index;
+            // Layout: normal [0, n), sliding [n, 3n), spinning [3n, 6n)
+            x[i] = m_gamma[j];
+            if (nc >= 3) {
+                x[num_contacts + 2 * i + 0] = m_gamma[prev_contacts + 2 * j + 0];
+                x[num_contacts + 2 * i + 1] = m_gamma[prev_contacts + 2 * j + 1];
+            }
+            if (nc >= 6) {
+                for (int k = 0; k < 3; k++)
+                    x[3 * num_contacts + 3 * i + k] = m_gamma[3 * prev_contacts + 3 * j + k];
+            }
+            num_warm++;
+        }
+        return num_warm;
+    }
+
+    // Store the contact impulses of the last solve.
+    void Record(const chrono::DynamicVector<chrono::real>& x) {
+        int num_contacts = (int)data_manager->cd_data->num_rigid_contacts;
+        int nc = GetNumComponents();
+        m_prev_nc = nc;
+        if (x.size() < (size_t)(nc * num_contacts)) {
+            m_prev.clear();
+            return;
+        }
+        Identify(m_prev);
+        std::sort(m_prev.begin(), m_prev.end());
+        m_gamma.resize(nc * num_contacts);
+        for (int i = 0; i < nc * num_contacts; i++)
+            m_gamma[i] = x[i];
+    }
+
+    chrono::ChSystemMulticore* m_system;
+    chrono::ChSolverMulticore* m_solver;
+    bool m_enabled;
+    double m_time;  // time of the step being solved
+
+    std::vector<Entry> m_prev;          // contacts at the previous step (sorted)
+    std::vector<chrono::real> m_gamma;  // contact impulses at the previous step
+    int m_prev_nc;                      // number of components per contact at the previous step
+
+    int m_num_warm;
+    int m_step_iterations;
+    long m_total_iterations;
+    int m_num_steps;
+};
+
+/// Wrap the current solver of a multicore NSC system for warm starting. Must be called after ChangeSolverType.
+inline ContactWarmStart* EnableContactWarmStart(chrono::ChSystemMulticoreNSC* system) {
+    auto iterative = std::static_pointer_cast<chrono::ChIterativeSolverMulticore>(system->GetSolver());
+    auto warm_start = new ContactWarmStart(system, iterative->solver);
+    warm_start->Setup(iterative->data_manager);
+    iterative->solver = warm_start;
+    return warm_start;
+}
+
+#endif
@@ -11,7 +11,8 @@
 // =============================================================================
 // Authors: Radu Serban
 // =============================================================================
-// Test for ChFunction_Recorder
+// Test for ChFunction_Recorder, and comparison with ChFunction_SortedRecorder
+// (accuracy on the same data, and timing on a large table)
 // =============================================================================
 
 #include <algorithm>
@@ -20,8 +21,11 @@
 #include <random>
 #include <vector>
 
+#include "chrono/core/ChTimer.h"
 #include "chrono/motion_functions/ChFunction_Recorder.h"
 
+#include "sorted_recorder.h"
+
 using namespace chrono;
 
 double Reference(double x) {
@@ -90,4 +94,92 @@ int main(int argc, char* argv[]) {
     for (int i = 0; i < n; i++) {
         Evaluate(fun, dist(gen));
     }
+
+    // Sorted recorder, loaded with the same (shuffled) data
+    ChFunction_SortedRecorder sorted;
+    for (int i = 0; i < x.size(); i++) {
+        sorted.AddPoint(x[i], Reference(x[i]));
+    }
+    sorted.AddPoint(xx, Reference(xx));
+
+    double max_diff = 0;
+    for (int i = -10; i <= 10 * n + 10; i++) {
+        double xi = (i * 0.1) / n;
+        max_diff = std::max(max_diff, std::abs(fun.Get_y(xi) - sorted.Get_y(xi)));
+        max_diff = std::max(max_diff, std::abs(fun.Get_y_dx(xi) - sorted.Get_y_dx(xi)));
+    }
+    for (int i = 0; i < n; i++) {
+        double xi = dist(gen);
+        max_diff = std::max(max_diff, std::abs(fun.Get_y(xi) - sorted.Get_y(xi)));
+    }
+    std::cout << "Sorted recorder: max difference " << max_diff << std::endl;
+
+    // Timing on a large table
+    int num_points = 1000000;
+    int num_queries = 1000000;
+    std::vector<double> tx(num_points), ty(num_points);
+    for (int i = 0; i < num_points; i++) {
+        tx[i] = (i * 1.0) / num_points;
+        ty[i] = Reference(tx[i]);
+    }
+    std::vector<double> qx_inc(num_queries), qx_rnd(num_queries), qy(num_queries);
+    for (int i = 0; i < num_queries; i++) {
+        qx_inc[i] = (i * 1.0) / num_queries;
+        qx_rnd[i] = dist(gen);
+    }
+
+    ChTimer<double> timer;
+    std::cout << "Large table (" << num_points << " points, " << num_queries << " queries)\n";
+
+    ChFunction_Recorder large;
+    timer.start();
+    for (int i = 0; i < num_points; i++)
+        large.AddPoint(tx[i], ty[i]);
+    timer.stop();
+    std::cout << "  ChFunction_Recorder        load " << timer() << " s";
+    timer.reset();
+    timer.start();
+    for (int i = 0; i < num_queries; i++)
+        qy[i] = large.Get_y(qx_inc[i]);
+    timer.stop();
+    std::cout << "  increasing " << timer() << " s";
+    timer.reset();
+    timer.start();
+    for (int i = 0; i < num_queries / 1000; i++)
+        qy[i] = large.Get_y(qx_rnd[i]);
+    timer.stop();
+    std::cout << "  random " << 1000 * timer() << " s (extrapolated)" << std::endl;
+
+    ChFunction_SortedRecorder large_sorted;
+    std::vector<double> sx = tx, sy = ty;
+    std::random_shuffle(sx.begin(), sx.end());
+    for (int i = 0; i < num_points; i++)
+        sy[i] = Reference(sx[i]);
+    timer.reset();
+    timer.start();
+    large_sorted.SetPoints(sx, sy);
+    timer.stop();
+    std::cout << "  ChFunction_SortedRecorder  load " << timer() << " s";
+    timer.reset();
+    timer.start();
+    for (int i = 0; i < num_queries; i++)
+        qy[i] = large_sorted.Get_y(qx_inc[i]);
+    timer.stop();
+    std::cout << "  increasing " << timer() << " s";
+    timer.reset();
+    timer.start();
+    for (int i = 0; i < num_queries; i++)
+        qy[i] = large_sorted.Get_y(qx_rnd[i]);
+    timer.stop();
+    std::cout << "  random " << timer() << " s";
+    timer.reset();
+    timer.start();
+    large_sorted.Get_y(qx_inc, qy);
+    timer.stop();
+    std::cout << "  batch " << timer() << " s" << std::endl;
+
+    double max_err = 0;
+    for (int i = 0; i < num_queries; i++)
+        max_err = std::max(max_err, std::abs(qy[i] - large.Get_y(qx_inc[i])));
+    std::cout << "  max difference " << max_err << std::endl;
 }
@@ -1,13 +1,20 @@
+#include <atomic>
 #include <cmath>
 #include <stdio.h>
+#include <string>
+#include <vector>
 
 #include "chrono/ChConfig.h"
 #include "chrono/core/ChLog.h"
+#include "chrono/core/ChTimer.h"
 #include "chrono/physics/ChSystemNSC.h"
 #include "chrono/timestepper/ChTimestepper.h"
 
+#include "../ensemble_pool.h"
+
 #ifdef CHRONO_PARDISO_MKL
 #include "chrono_pardisomkl/ChSolverPardisoMKL.h"
+#include "../pardiso_reuse.h"
 #endif
 
 using namespace chrono;
@@ -35,6 +42,9 @@ class OscillatorProblem : public ChIntegrableIIorder {
         mv = 0.6;
     }
 
+    /// Set the spring stiffness
+    void SetStiffness(double k) { K = k; }
+
     /// the number of coordinates in the state, x position part:
     virtual int GetNcoords_x() override { return 1; }
 
@@ -358,26 +368,45 @@ void Pendulum() {
 
 // ==========================================================================================================
 
-void RigidPendulums() {
-    printf("\nRigid pendulums\n");
+// Matrix factorization policies for the HHT Newton iterations
+enum class FactorizationPolicy {
+    NEWTON,           // full Newton: factorization at each iteration
+    MODIFIED_NEWTON,  // modified Newton: factorization at the first iteration of each step
+    ADAPTIVE          // modified Newton, with factorization reused across steps while convergence is fast
+};
 
-    bool double_pend = false;
+// HHT integration mode for the rigid pendulums
+const ChTimestepperHHT::HHT_Mode hht_mode = ChTimestepperHHT::ACCELERATION;
 
-    double m1 = 1;
-    double l1 = 1;
+// Rigid pendulum model (one or two bodies connected by revolute joints), with its HHT integrator and solver.
+// The solver is created with the model and reused for all its steps.
+struct RigidPendulumModel {
+    ChSystemNSC system;
+    std::shared_ptr<ChBody> pend1;
+    std::shared_ptr<ChBody> pend2;
+    std::shared_ptr<ChTimestepperHHT> integrator;
+#ifdef CHRONO_PARDISO_MKL
+    std::shared_ptr<ChSolverPardisoMKLReuse> reuse_solver;
+#endif
+};
+
+// Create the pendulum model in the given (empty) model object. Return false if the policy is not available.
+bool CreateRigidPendulums(RigidPendulumModel& model,
+                          FactorizationPolicy policy,
+                          double m1,
+                          double l1,
+                          bool double_pend,
+                          bool verbose) {
     double J1 = 1;
     double m2 = 1;
     double l2 = 1;
     double J2 = 1;
     double g = 10;
 
-    double step = 1e-3;
-    int num_steps = 100;
-    auto mode = ChTimestepperHHT::ACCELERATION;
     bool step_control = true;
-    bool modified_Newton = true;
+    bool modified_Newton = (policy != FactorizationPolicy::NEWTON);
 
-    ChSystemNSC system;
+    ChSystemNSC& system = model.system;
     system.Set_G_acc(ChVector<>(0, -g, 0));
 
     // Bodies
@@ -392,6 +421,7 @@ void RigidPendulums() {
     pend1->SetInertiaXX(ChVector<>(1, 1, J1));
     pend1->SetPos(ChVector<>(l1 / 2, 0, 0));
     system.AddBody(pend1);
+    model.pend1 = pend1;
 
     auto pend2 = chrono_types::make_shared<ChBody>();
     if (double_pend) {
@@ -401,6 +431,7 @@ void RigidPendulums() {
         pend2->SetPos(ChVector<>(l1 + l2 / 2, 0, 0));
         system.AddBody(pend2);
     }
+    model.pend2 = pend2;
 
     // Joints
     auto revolute1 = chrono_types::make_shared<ChLinkLockRevolute>();
@@ -415,28 +446,87 @@ void RigidPendulums() {
 
 // Set PardisoMKL solver
 #ifdef CHRONO_PARDISO_MKL
-    auto mkl_solver = chrono_types::make_shared<ChSolverPardisoMKL>();
-    mkl_solver->LockSparsityPattern(true);
-    system.SetSolver(mkl_solver);
+    if (policy == FactorizationPolicy::ADAPTIVE) {
+        model.reuse_solver = chrono_types::make_shared<ChSolverPardisoMKLReuse>(3);
+        system.SetSolver(model.reuse_solver);
+    } else {
+        auto mkl_solver = chrono_types::make_shared<ChSolverPardisoMKL>();
+        mkl_solver->LockSparsityPattern(true);
+        system.SetSolver(mkl_solver);
+    }
+#else
+    if (policy == FactorizationPolicy::ADAPTIVE)
+        return false;
 #endif
 
     // Set integrator and modify parameters.
     system.SetTimestepperType(ChTimestepper::Type::HHT);
     auto integrator = std::static_pointer_cast<ChTimestepperHHT>(system.GetTimestepper());
-    integrator->SetMode(mode);
+    integrator->SetMode(hht_mode);
     integrator->SetStepControl(step_control);
     integrator->SetModifiedNewton(modified_Newton);
-    integrator->SetVerbose(true);
+    integrator->SetVerbose(verbose);
     integrator->SetAlpha(-0.2);
     integrator->SetMaxiters(20);
     integrator->SetRelTolerance(1e-4);
-    switch (mode) {
+    switch (hht_mode) {
         case ChTimestepperHHT::ACCELERATION:
             integrator->SetAbsTolerances(1e-3, 1e-6);
-            printf("ACCELERATION mode\n\n");
             break;
         case ChTimestepperHHT::POSITION:
             integrator->SetAbsTolerances(1e-6, 1e-6);
+            break;
+    }
+    model.integrator = integrator;
+
+    return true;
+}
+
+// Advance the pendulum model by one step; return the number of Newton iterations.
+int AdvanceRigidPendulums(RigidPendulumModel& model, double step) {
+    model.system.DoStepDynamics(step);
+    int num_iterations = model.integrator->GetNumIterations();
+#ifdef CHRONO_PARDISO_MKL
+    if (model.reuse_solver)
+        model.reuse_solver->StepCompleted(num_iterations);
+#endif
+    return num_iterations;
+}
+
+// Number of factorizations so far, given the number of setup calls (without factorization reuse, each setup call is
+// a factorization)
+int GetNumFactorizations(const RigidPendulumModel& model, int num_setup_calls) {
+#ifdef CHRONO_PARDISO_MKL
+    if (model.reuse_solver)
+        return model.reuse_solver->GetNumFactorizations();
+#endif
+    return num_setup_calls;
+}
+
+void RigidPendulums(FactorizationPolicy policy, bool verbose) {
+    const char* policy_names[] = {"full Newton", "modified Newton", "adaptive reuse"};
+    printf("\nRigid pendulums (%s)\n", policy_names[static_cast<int>(policy)]);
+
+    double m1 = 1;
+    double l1 = 1;
+    bool double_pend = false;
+
+    double step = 1e-3;
+    int num_steps = 100;
+
+    RigidPendulumModel model;
+    if (!CreateRigidPendulums(model, policy, m1, l1, double_pend, verbose)) {
+        printf("Factorization reuse requires Chrono::PardisoMKL\n");
+        return;
+    }
+    auto integrator = model.integrator;
+    auto pend1 = model.pend1;
+    auto pend2 = model.pend2;
+    switch (hht_mode) {
+        case ChTimestepperHHT::ACCELERATION:
+            printf("ACCELERATION mode\n\n");
+            break;
+        case ChTimestepperHHT::POSITION:
             printf("POSITION mode\n\n");
             break;
     }
@@ -445,11 +535,14 @@ void RigidPendulums() {
     int num_setup_calls = 0;
     int num_solver_calls = 0;
 
+    ChTimer<double> timer;
+    timer.start();
     for (int it = 0; it < num_steps; it++) {
-        system.DoStepDynamics(step);
-        num_iterations += integrator->GetNumIterations();
+        num_iterations += AdvanceRigidPendulums(model, step);
         num_setup_calls += integrator->GetNumSetupCalls();
         num_solver_calls += integrator->GetNumSolveCalls();
+        if (!verbose)
+            continue;
         printf("    %7.4f  %4d", integrator->GetTime(), integrator->GetNumIterations());
         printf("    %12.8f  %12.8f  %12.8f  %12.8f  %12.8f  %12.8f", pend1->GetPos().x(), pend1->GetPos().y(),
                pend1->GetPos_dt().x(), pend1->GetPos_dt().y(), pend1->GetPos_dtdt().x(), pend1->GetPos_dtdt().y());
@@ -461,10 +554,151 @@ void RigidPendulums() {
         }
     }
 
+    timer.stop();
+
+    int num_factorizations = GetNumFactorizations(model, num_setup_calls);
+
     printf("\n\n");
     printf("Total number of setup calls:  %d\n", num_setup_calls);
     printf("Total number of solver calls: %d\n", num_solver_calls);
     printf("Total number of iterations: %d\n", num_iterations);
+    printf("Factorizations:               %d\n", num_factorizations);
+    printf("Factorization reuses:         %d\n", num_solver_calls - num_factorizations);
+    printf("Newton iterations per step:   %.2f\n", num_iterations / (double)num_steps);
+    printf("Simulation time:              %.4f s\n", timer());
+}
+
+// ==========================================================================================================
+// Ensembles of independent problem instances with varied parameters, integrated in parallel (one instance per
+// task, each with its own integrator and solver, reused over all its steps).
+
+// Statistics of one ensemble member
+struct MemberStats {
+    int steps = 0;
+    int iterations = 0;
+    int setup_calls = 0;
+    int solver_calls = 0;
+    int factorizations = 0;
+    double result = 0;  // final value of a state variable (for regression checks)
+};
+
+void ReportEnsemble(const char* name,
+                    const std::vector<MemberStats>& stats,
+                    double wall_time,
+                    const EnsemblePool& pool) {
+    MemberStats total;
+    double checksum = 0;
+    for (const auto& s : stats) {
+        total.steps += s.steps;
+        total.iterations += s.iterations;
+        total.setup_calls += s.setup_calls;
+        total.solver_calls += s.solver_calls;
+        total.factorizations += s.factorizations;
+        checksum += s.result;
+    }
+    double member_time = 0;
+    for (auto t : pool.GetMemberTimes())
+        member_time += t;
+    printf("%-18s %8d %10.4f %10.4f %12.0f %10.2f %10.2f %12d %12.8f\n", name, (int)stats.size(), wall_time,
+           member_time, total.steps / wall_time, total.iterations / (double)total.steps,
+           total.factorizations / (double)total.steps, total.factorizations, checksum);
+}
+
+// Set the HHT parameters for a ChIntegrableIIorder problem (as in Oscillator() and Pendulum(), without output)
+void ConfigureStepper(ChTimestepperHHT& stepper, double alpha, double abs_tol, int max_iters) {
+    stepper.SetAlpha(alpha);
+    stepper.SetAbsTolerances(abs_tol);
+    stepper.SetMaxiters(max_iters);
+    stepper.SetMaxItersSuccess(3);
+    stepper.SetRequiredSuccessfulSteps(5);
+    stepper.SetStepIncreaseFactor(2);
+    stepper.SetStepDecreaseFactor(0.5);
+    stepper.SetVerbose(false);
+}
+
+void Ensemble(int num_members, int num_workers, FactorizationPolicy policy) {
+    const char* policy_names[] = {"full Newton", "modified Newton", "adaptive reuse"};
+    EnsemblePool pool(num_workers);
+    printf("\nEnsembles of %d members on %d workers (rigid pendulums: %s)\n\n", num_members, pool.GetNumWorkers(),
+           policy_names[static_cast<int>(policy)]);
+    printf("%-18s %8s %10s %10s %12s %10s %10s %12s %12s\n", "problem", "members", "wall [s]", "sum [s]", "steps/s",
+           "iter/step", "fact/step", "factorize", "checksum");
+
+    // Parameter of member i, uniformly distributed in [lo, hi]
+    auto param = [num_members](int i, double lo, double hi) {
+        return num_members > 1 ? lo + (hi - lo) * i / (num_members - 1.0) : lo;
+    };
+
+    std::vector<MemberStats> stats(num_members);
+    double wall_time;
+
+    // Oscillators with stiffness in [10, 50]
+    wall_time = pool.Run(num_members, [&](int i, int) {
+        OscillatorProblem problem;
+        problem.SetStiffness(param(i, 10, 50));
+        ChTimestepperHHT stepper(&problem);
+        ConfigureStepper(stepper, 0, 1e-10, 6);
+        MemberStats& s = stats[i];
+        s = MemberStats();
+        for (int k = 0; k < 1000; k++) {
+            stepper.Advance(0.05);
+            s.steps++;
+            s.iterations += stepper.GetNumIterations();
+            s.setup_calls += stepper.GetNumSetupCalls();
+            s.solver_calls += stepper.GetNumSolveCalls();
+        }
+        s.factorizations = s.setup_calls;
+        s.result = stepper.get_X()(0);
+    });
+    ReportEnsemble("oscillator", stats, wall_time, pool);
+
+    // Pendulum DAEs with length in [0.5, 2]
+    wall_time = pool.Run(num_members, [&](int i, int) {
+        double length = param(i, 0.5, 2);
+        PendulumProblem problem;
+        problem.SetLength(length);
+        problem.SetInitialConditions(0, -length, 0.2, 0);
+        ChTimestepperHHT stepper(&problem);
+        ConfigureStepper(stepper, -0.2, 1e-6, 10);
+        MemberStats& s = stats[i];
+        s = MemberStats();
+        for (int k = 0; k < 200; k++) {
+            stepper.Advance(0.05);
+            s.steps++;
+            s.iterations += stepper.GetNumIterations();
+            s.setup_calls += stepper.GetNumSetupCalls();
+            s.solver_calls += stepper.GetNumSolveCalls();
+        }
+        s.factorizations = s.setup_calls;
+        s.result = stepper.get_X()(0);
+    });
+    ReportEnsemble("pendulum DAE", stats, wall_time, pool);
+
+    // Rigid pendulums with mass in [0.5, 2] and length in [0.5, 1.5]
+    std::atomic<bool> available(true);
+    wall_time = pool.Run(num_members, [&](int i, int) {
+        RigidPendulumModel model;
+        if (!CreateRigidPendulums(model, policy, param(i, 0.5, 2), param(num_members - 1 - i, 0.5, 1.5), false,
+                                  false)) {
+            available = false;
+            return;
+        }
+        model.system.SetNumThreads(1);
+        MemberStats& s = stats[i];
+        s = MemberStats();
+        for (int k = 0; k < 1000; k++) {
+            s.iterations += AdvanceRigidPendulums(model, 1e-3);
+            s.steps++;
+            s.setup_calls += model.integrator->GetNumSetupCalls();
+            s.solver_calls += model.integrator->GetNumSolveCalls();
+        }
+        s.factorizations = GetNumFactorizations(model, s.setup_calls);
+        s.result = model.pend1->GetPos().x();
+    });
+    if (available)
+        ReportEnsemble("rigid pendulums", stats, wall_time, pool);
+    else
+        printf("rigid pendulums: factorization reuse requires Chrono::PardisoMKL\n");
 }
 
 // ==========================================================================================================
@@ -472,6 +706,22 @@ void RigidPendulums() {
 int main(int argc, char* argv[]) {
     // Oscillator();
     // Pendulum();
-    RigidPendulums();
+
+    // Ensemble mode: -ensemble [num_members] [num_workers] (default: 64 members, one worker per hardware thread)
+    if (argc > 1 && std::string(argv[1]) == "-ensemble") {
+        int num_members = (argc > 2) ? std::stoi(argv[2]) : 64;
+        int num_workers = (argc > 3) ? std::stoi(argv[3]) : 0;
+        Ensemble(num_members, num_workers, FactorizationPolicy::MODIFIED_NEWTON);
+#ifdef CHRONO_PARDISO_MKL
+        Ensemble(num_members, num_workers, FactorizationPolicy::ADAPTIVE);
+#endif
+        return 0;
+    }
+
+    // Benchmark of the factorization policies (pass -v for the step-by-step output)
+    bool verbose = (argc > 1 && std::string(argv[1]) == "-v");
+    RigidPendulums(FactorizationPolicy::NEWTON, verbose);
+    RigidPendulums(FactorizationPolicy::MODIFIED_NEWTON, verbose);
+    RigidPendulums(FactorizationPolicy::ADAPTIVE, verbose);
     return 0;
 }
@@ -12,16 +12,203 @@
 // Authors: Radu Serban
 // =============================================================================
 // Access test ChVector
+// Bulk operations on an array of ChVector (AoS) vs ChVectorSoA
 // =============================================================================
 
+#include <algorithm>
+#include <cmath>
 #include <random>
 #include <vector>
 
 #include "chrono/core/ChVector.h"
+#include "chrono/core/ChQuaternion.h"
 #include "chrono/core/ChTimer.h"
 
+#include "vector_soa.h"
+
 using namespace chrono;
 
+// Compiler barrier between timed passes, so that the passes over the same (unchanged) data are not folded into one
+inline void ClobberMemory() {
+#if defined(_MSC_VER)
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : : "memory");
+#endif
+}
+
+// Maximum difference between the AoS and SoA results
+double MaxDiff(const std::vector<double>& a, const std::vector<double>& b) {
+    double d = 0;
+    for (size_t i = 0; i < a.size(); i++)
+        d = std::max(d, std::abs(a[i] - b[i]));
+    return d;
+}
+
+double MaxDiff(const std::vector<ChVector<>>& a, const ChVectorSoA& b) {
+    double d = 0;
+    for (size_t i = 0; i < a.size(); i++)
+        d = std::max(d, (a[i] - b.Get(i)).LengthInf());
+    return d;
+}
+
+void Report(const char* op, double time_aos, double time_soa, double diff) {
+    printf("%-8s %10.4f %10.4f %8.2f %12.2e\n", op, time_aos, time_soa, time_aos / time_soa, diff);
+}
+
+// Time bulk operations (num_reps passes over num_vec vectors) on both layouts.
+void BulkTest(size_t num_vec, int num_reps, std::mt19937& mt) {
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    std::vector<ChVector<>> a(num_vec), b(num_vec);
+    for (size_t i = 0; i < num_vec; i++) {
+        a[i] = ChVector<>(dist(mt), dist(mt), dist(mt));
+        b[i] = ChVector<>(dist(mt), dist(mt), dist(mt));
+    }
+    ChVectorSoA sa(a);
+    ChVectorSoA sb(b);
+    ChQuaternion<> q(dist(mt), dist(mt), dist(mt), dist(mt));
+    q.Normalize();
+
+    ChTimer<> timer;
+    double time_aos, time_soa;
+
+    std::cout << "bulk operations: " << num_vec << " vectors, " << num_reps << " passes" << std::endl;
+    printf("%-8s %10s %10s %8s %12s\n", "op", "AoS [s]", "SoA [s]", "speedup", "max diff");
+
+    // Sum
+    ChVector<> sum_aos, sum_soa;
+    timer.reset();
+    timer.start();
+    for (int r = 0; r < num_reps; r++) {
+        sum_aos = VNULL;
+        for (const auto& v : a)
+            sum_aos += v;
+        ClobberMemory();
+    }
+    timer.stop();
+    time_aos = timer();
+    timer.reset();
+    timer.start();
+    for (int r = 0; r < num_reps; r++) {
+        sum_soa = sa.Sum();
+        ClobberMemory();
+    }
+    timer.stop();
+    time_soa = timer();
+    Report("sum", time_aos, time_soa, (sum_aos - sum_soa).LengthInf());
+
+    // Dot
+    std::vector<double> dot_aos(num_vec), dot_soa;
+    timer.reset();
+    timer.start();
+    for (int r = 0; r < num_reps; r++) {
+        for (size_t i = 0; i < num_vec; i++)
+            dot_aos[i] = a[i].Dot(b[i]);
+        ClobberMemory();
+    }
+    timer.stop();
+    time_aos = timer();
+    timer.reset();
+    timer.start();
+    for (int r = 0; r < num_reps; r++) {
+        ChVectorSoA::Dot(sa, sb, dot_soa);
+        ClobberMemory();
+    }
+    timer.stop();
+    time_soa = timer();
+    Report("dot", time_aos, time_soa, MaxDiff(dot_aos, dot_soa));
+
+    // Cross
+    std::vector<ChVector<>> cross_aos(num_vec);
+    ChVectorSoA cross_soa;
+    timer.reset();
+    timer.start();
+    for (int r = 0; r < num_reps; r++) {
+        for (size_t i = 0; i < num_vec; i++)
+            cross_aos[i] = a[i].Cross(b[i]);
+        ClobberMemory();
+    }
+    timer.stop();
+    time_aos = timer();
+    timer.reset();
+    timer.start();
+    for (int r = 0; r < num_reps; r++) {
+        ChVectorSoA::Cross(sa, sb, cross_soa);
+        ClobberMemory();
+    }
+    timer.stop();
+    time_soa = timer();
+    Report("cross", time_aos, time_soa, MaxDiff(cross_aos, cross_soa));
+
+    // Norm
+    std::vector<double> norm_aos(num_vec), norm_soa;
+    timer.reset();
+    timer.start();
+    for (int r = 0; r < num_reps; r++) {
+        for (size_t i = 0; i < num_vec; i++)
+            norm_aos[i] = a[i].Length();
+        ClobberMemory();
+    }
+    timer.stop();
+    time_aos = timer();
+    timer.reset();
+    timer.start();
+    for (int r = 0; r < num_reps; r++) {
+        ChVectorSoA::Norm(sa, norm_soa);
+        ClobberMemory();
+    }
+    timer.stop();
+    time_soa = timer();
+    Report("norm", time_aos, time_soa, MaxDiff(norm_aos, norm_soa));
+
+    // Rotation by a quaternion
+    std::vector<ChVector<>> rot_aos(num_vec);
+    ChVectorSoA rot_soa;
+    timer.reset();
+    timer.start();
+    for (int r = 0; r < num_reps; r++) {
+        for (size_t i = 0; i < num_vec; i++)
+            rot_aos[i] = q.Rotate(a[i]);
+        ClobberMemory();
+    }
+    timer.stop();
+    time_aos = timer();
+    timer.reset();
+    timer.start();
+    for (int r = 0; r < num_reps; r++) {
+        ChVectorSoA::Rotate(q, sa, rot_soa);
+        ClobberMemory();
+    }
+    timer.stop();
+    time_soa = timer();
+    Report("rotate", time_aos, time_soa, MaxDiff(rot_aos, rot_soa));
+
+    // Axpy (alternating signs, so that the result is the initial array after an even number of passes)
+    std::vector<ChVector<>> axpy_aos = b;
+    ChVectorSoA axpy_soa = sb;
+    timer.reset();
+    timer.start();
+    for (int r = 0; r < num_reps; r++) {
+        double alpha = (r % 2) ? -0.5 : 0.5;
+        for (size_t i = 0; i < num_vec; i++)
+            axpy_aos[i] += alpha * a[i];
+        ClobberMemory();
+    }
+    timer.stop();
+    time_aos = timer();
+    timer.reset();
+    timer.start();
+    for (int r = 0; r < num_reps; r++) {
+        axpy_soa.Axpy((r % 2) ? -0.5 : 0.5, sa);
+        ClobberMemory();
+    }
+    timer.stop();
+    time_soa = timer();
+    Report("axpy", time_aos, time_soa, MaxDiff(axpy_aos, axpy_soa));
+
+    std::cout << std::endl;
+}
+
 int main(int argc, char* argv[]) {
     ChTimer<> timer;
 
@@ -91,4 +278,12 @@ int main(int argc, char* argv[]) {
 
     ////std::cout << "sums using direct access: " << xsum << "  " << ysum << "  " << zsum << std::endl;
     ////std::cout << "time using direct access: " << timer() << std::endl << std::endl;
+
+    // Free the AoS array before the bulk tests
+    std::vector<ChVector<>>().swap(v);
+
+    // In-cache and out-of-cache arrays (sizes that are not multiples of 4 KB per component, to avoid 4K aliasing
+    // between the input and output arrays)
+    BulkTest(4000, 20000, mt);
+    BulkTest(4000000, 20, mt);
 }
@@ -17,13 +17,30 @@
 //
 // =============================================================================
 
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#ifdef COSIM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #include "chrono/geometry/ChTriangleMeshConnected.h"
 #include "chrono/physics/ChLoadBodyMesh.h"
 #include "chrono/physics/ChLoadContainer.h"
 #include "chrono/physics/ChLoaderUV.h"
+#include "chrono/physics/ChLoadsXYZnode.h"
 #include "chrono/physics/ChSystemSMC.h"
 #include "chrono/solver/ChIterativeSolverLS.h"
 
+#include "chrono/fea/ChContactSurfaceMesh.h"
 #include "chrono/fea/ChElementTetra_4.h"
 #include "chrono/fea/ChLoadContactSurfaceMesh.h"
 #include "chrono/fea/ChMesh.h"
@@ -34,10 +51,13 @@
 #include "chrono_multicore/physics/ChSystemMulticore.h"
 
 #include "chrono/ChConfig.h"
+#include "chrono/core/ChTimer.h"
 #include "chrono/utils/ChUtilsCreators.h"
 #include "chrono/utils/ChUtilsGenerators.h"
 #include "chrono/utils/ChUtilsInputOutput.h"
 
+#include "../../collision_families.h"
+
 // comment the following line out to see opengl view
 #undef CHRONO_OPENGL
 
@@ -56,10 +76,10 @@ using namespace irr;
 // Also plot forces as vectors.
 // Mostly for debugging.
 void draw_affected_triangles(ChIrrApp& application,
-                             std::vector<ChVector<>>& vert_pos,
-                             std::vector<ChVector<int>>& triangles,
-                             std::vector<int>& vert_indexes,
-                             std::vector<ChVector<>>& vert_forces,
+                             const std::vector<ChVector<>>& vert_pos,
+                             const std::vector<ChVector<int>>& triangles,
+                             const std::vector<int>& vert_indexes,
+                             const std::vector<ChVector<>>& vert_forces,
                              double forcescale = 0.01) {
     for (int it = 0; it < triangles.size(); ++it) {
         bool vert_hit = false;
@@ -82,6 +102,649 @@ void draw_affected_triangles(ChIrrApp& application,
         }
 }
 
+// Height field of the granular bed, used to cull the tire triangles sent to the granular system.
+// The bed height (along the Y axis, opposite to gravity) is the maximum height of the granular particles (active
+// bodies) over each cell of a regular grid in the horizontal plane. A triangle is in the contact band if its AABB
+// reaches below the bed height (plus the band width) over any of the cells it overlaps. Cells without particles
+// never report contact.
+class ContactBandCuller {
+  public:
+    ContactBandCuller(const ChVector<>& min, const ChVector<>& max, int nx, int nz, double band)
+        : m_min(min), m_nx(nx), m_nz(nz), m_band(band), m_height(nx * nz) {
+        m_dx = (max.x() - min.x()) / nx;
+        m_dz = (max.z() - min.z()) / nz;
+    }
+
+    /// Update the bed height field from the current state of the granular system.
+    void UpdateHeightField(ChSystemMulticore* system) {
+        std::fill(m_height.begin(), m_height.end(), -std::numeric_limits<double>::infinity());
+        const auto& pos = system->data_manager->host_data.pos_rigid;
+        const auto& active = system->data_manager->host_data.active_rigid;
+        for (size_t i = 0; i < system->data_manager->num_rigid_bodies; i++) {
+            if (!active[i])
+                continue;
+            int cell = Cell(CellX(pos[i].x), CellZ(pos[i].z));
+            m_height[cell] = std::max(m_height[cell], (double)pos[i].y);
+        }
+    }
+
+    /// Check whether the given AABB is within the contact band of the granular bed.
+    bool InBand(const ChVector<>& aabb_min, const ChVector<>& aabb_max) const {
+        int ix2 = CellX(aabb_max.x());
+        int iz2 = CellZ(aabb_max.z());
+        for (int ix = CellX(aabb_min.x()); ix <= ix2; ix++) {
+            for (int iz = CellZ(aabb_min.z()); iz <= iz2; iz++) {
+                if (aabb_min.y() <= m_height[Cell(ix, iz)] + m_band)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+  private:
+    int CellX(double x) const { return std::min(std::max((int)std::floor((x - m_min.x()) / m_dx), 0), m_nx - 1); }
+    int CellZ(double z) const { return std::min(std::max((int)std::floor((z - m_min.z()) / m_dz), 0), m_nz - 1); }
+    int Cell(int ix, int iz) const { return ix * m_nz + iz; }
+
+    ChVector<> m_min;
+    int m_nx;
+    int m_nz;
+    double m_dx;
+    double m_dz;
+    double m_band;
+    std::vector<double> m_height;
+};
+
+// Persistent buffer for exchanging the tire contact mesh with the granular system.
+// The mesh connectivity, the FEA nodes, the nodal loads, and the triangle bodies in the granular system are cached
+// once; at each step the vertex states, the triangle bodies, and their collision shapes are updated in place (no
+// reallocation, no rebuilding of the indexed mesh, and no shared_ptr traversal of the body list).
+// With granular substepping, the mesh seen by the granular system is moved from the gathered state with the vertex
+// velocities (see AdvanceMesh). With contact-band culling, only the triangles close to the granular bed are active
+// (collide and are updated) in the granular system; the others are parked (see Cull).
+// Both assume that the triangle bodies are the first bodies in the granular system, each with one triangle shape.
+class TireMeshExchange {
+  public:
+    /// Index the contact surface mesh and create one (persistent) nodal load per vertex in the given container.
+    TireMeshExchange(std::shared_ptr<ChContactSurfaceMesh> surface, std::shared_ptr<ChLoadContainer> container)
+        : m_shape_data(nullptr) {
+        std::map<ChNodeFEAxyz*, int> node_index;
+        auto vertex = [&](std::shared_ptr<ChNodeFEAxyz> node) {
+            auto res = node_index.insert(std::make_pair(node.get(), (int)m_nodes.size()));
+            if (res.second) {
+                m_nodes.push_back(node.get());
+                auto load = chrono_types::make_shared<ChLoadXYZnode>(node);
+                container->Add(load);
+                m_loads.push_back(load.get());
+            }
+            return res.first->second;
+        };
+        for (const auto& tri : surface->GetTriangleList())
+            m_triangles.push_back(
+                ChVector<int>(vertex(tri->GetNode1()), vertex(tri->GetNode2()), vertex(tri->GetNode3())));
+
+        size_t num_vertices = m_nodes.size();
+        m_vert_pos0.resize(num_vertices);
+        m_vert_pos.resize(num_vertices);
+        m_vert_vel.resize(num_vertices);
+        m_vert_forces.resize(num_vertices, VNULL);
+        m_vert_indexes.resize(num_vertices);
+        for (size_t i = 0; i < num_vertices; i++)
+            m_vert_indexes[i] = (int)i;
+        m_tri_pos.resize(m_triangles.size());
+        m_tri_vel.resize(m_triangles.size());
+        m_active.resize(m_triangles.size(), true);
+        m_num_active = m_triangles.size();
+
+        GatherMesh();
+    }
+
+    /// Bind to the granular system. The triangle bodies must have been added to the system (in the order of the
+    /// triangles in this buffer) before any other body.
+    void Bind(ChSystemMulticore* system) {
+        m_bodies.resize(m_triangles.size());
+        for (size_t i = 0; i < m_triangles.size(); i++)
+            m_bodies[i] = system->Get_bodylist()[i].get();
+        m_shape_data = &system->data_manager->cd_data->shape_data;
+        m_family.assign(m_shape_data->fam_rigid.begin(), m_shape_data->fam_rigid.begin() + m_triangles.size());
+    }
+
+    /// Load the current vertex states from the FEA nodes and update the triangle centroids.
+    void GatherMesh() {
+        for (size_t i = 0; i < m_nodes.size(); i++) {
+            m_vert_pos0[i] = m_nodes[i]->GetPos();
+            m_vert_pos[i] = m_vert_pos0[i];
+            m_vert_vel[i] = m_nodes[i]->GetPos_dt();
+        }
+        UpdateCentroids();
+    }
+
+    /// Move the vertices linearly, with their gathered velocities, to the given time after the last GatherMesh.
+    void AdvanceMesh(double dt) {
+        for (size_t i = 0; i < m_nodes.size(); i++)
+            m_vert_pos[i] = m_vert_pos0[i] + dt * m_vert_vel[i];
+        UpdateCentroids();
+    }
+
+    /// Activate the triangles in the contact band of the granular bed and park all others.
+    /// Parked triangles are not updated in the granular system and their collision family mask is cleared (so that
+    /// they are discarded from the broadphase pairs).
+    void Cull(const ContactBandCuller& culler) {
+        m_num_active = 0;
+        for (size_t i = 0; i < m_triangles.size(); i++) {
+            const auto& t = m_triangles[i];
+            const ChVector<>& v0 = m_vert_pos[t.x()];
+            const ChVector<>& v1 = m_vert_pos[t.y()];
+            const ChVector<>& v2 = m_vert_pos[t.z()];
+            ChVector<> aabb_min(std::min({v0.x(), v1.x(), v2.x()}), std::min({v0.y(), v1.y(), v2.y()}),
+                                std::min({v0.z(), v1.z(), v2.z()}));
+            ChVector<> aabb_max(std::max({v0.x(), v1.x(), v2.x()}), std::max({v0.y(), v1.y(), v2.y()}),
+                                std::max({v0.z(), v1.z(), v2.z()}));
+            bool active = culler.InBand(aabb_min, aabb_max);
+            if (active != (bool)m_active[i]) {
+                m_shape_data->fam_rigid[i] = active ? m_family[i] : short2(m_family[i].x, 0);
+                m_active[i] = active;
+            }
+            m_num_active += active;
+        }
+    }
+
+    /// Update the active triangle bodies and their collision shapes in the granular system.
+    void UpdateGranular() {
+        real3* tri_rigid = m_shape_data->triangle_rigid.data();
+        for (size_t i = 0; i < m_triangles.size(); i++) {
+            if (!m_active[i])
+                continue;
+            const auto& t = m_triangles[i];
+            const ChVector<>& pos = m_tri_pos[i];
+            m_bodies[i]->SetPos(pos);
+            m_bodies[i]->SetPos_dt(m_tri_vel[i]);
+            for (int j = 0; j < 3; j++) {
+                ChVector<> v = m_vert_pos[t[j]] - pos;
+                tri_rigid[3 * i + j] = real3(v.x(), v.y(), v.z());
+            }
+        }
+    }
+
+    /// Apply the current vertex forces to the FEA nodes.
+    void ApplyForces() {
+        for (size_t i = 0; i < m_loads.size(); i++)
+            m_loads[i]->loader.SetForce(m_vert_forces[i]);
+    }
+
+    /// Reset all vertex forces to zero.
+    void ClearForces() { std::fill(m_vert_forces.begin(), m_vert_forces.end(), VNULL); }
+
+    size_t GetNumVertices() const { return m_nodes.size(); }
+    size_t GetNumTriangles() const { return m_triangles.size(); }
+    size_t GetNumActiveTriangles() const { return m_num_active; }
+
+    const std::vector<ChVector<>>& GetVertexPositions() const { return m_vert_pos; }
+    const std::vector<ChVector<>>& GetVertexVelocities() const { return m_vert_vel; }
+    const std::vector<ChVector<int>>& GetTriangles() const { return m_triangles; }
+    const std::vector<int>& GetVertexIndexes() const { return m_vert_indexes; }
+    const std::vector<ChVector<>>& GetTrianglePositions() const { return m_tri_pos; }
+    const std::vector<ChVector<>>& GetTriangleVelocities() const { return m_tri_vel; }
+    const std::vector<ChVector<>>& GetVertexForces() const { return m_vert_forces; }
+    std::vector<ChVector<>>& GetVertexForces() { return m_vert_forces; }
+
+  private:
+    void UpdateCentroids() {
+        for (size_t i = 0; i < m_triangles.size(); i++) {
+            const auto& t = m_triangles[i];
+            m_tri_pos[i] = (m_vert_pos[t.x()] + m_vert_pos[t.y()] + m_vert_pos[t.z()]) / 3.0;
+            m_tri_vel[i] = (m_vert_vel[t.x()] + m_vert_vel[t.y()] + m_vert_vel[t.z()]) / 3.0;
+        }
+    }
+
+    std::vector<ChNodeFEAxyz*> m_nodes;   ///< FEA nodes, in vertex order
+    std::vector<ChLoadXYZnode*> m_loads;  ///< nodal loads, in vertex order
+    std::vector<ChBody*> m_bodies;        ///< triangle bodies in the granular system
+    shape_container* m_shape_data;        ///< collision shape data of the granular system
+    std::vector<short2> m_family;         ///< collision family of the triangle shapes
+
+    std::vector<ChVector<int>> m_triangles;  ///< mesh connectivity (fixed)
+    std::vector<ChVector<>> m_vert_pos0;     ///< gathered vertex positions
+    std::vector<ChVector<>> m_vert_pos;      ///< vertex positions (as seen by the granular system)
+    std::vector<ChVector<>> m_vert_vel;      ///< vertex velocities
+    std::vector<ChVector<>> m_vert_forces;   ///< vertex forces
+    std::vector<int> m_vert_indexes;         ///< vertex indexes (identity)
+    std::vector<ChVector<>> m_tri_pos;       ///< triangle centroid positions
+    std::vector<ChVector<>> m_tri_vel;       ///< triangle centroid velocities
+    std::vector<char> m_active;              ///< active (non-parked) triangles
+    size_t m_num_active;                     ///< number of active triangles
+};
+
+// Scatter of the granular contact forces on the triangle bodies to the tire mesh vertices.
+// The total contact force on each triangle is distributed over its vertices with the barycentric coordinates of the
+// contact point (the centroid of the triangle's contact points weighted by their normal impulses). Both stages run in
+// parallel with per-thread accumulation buffers which are then reduced in thread order, so that the result does not
+// depend on thread scheduling.
+class ContactForceScatter {
+  public:
+    ContactForceScatter(const TireMeshExchange& exchange) : m_exchange(exchange) {}
+
+    /// Compute the vertex forces from the current contact forces in the granular system.
+    /// Contact forces must have been calculated (ChSystemMulticore::CalculateContactForces).
+    void Scatter(ChSystemMulticore* system, std::vector<ChVector<>>& vert_forces) {
+        const auto& vert_pos = m_exchange.GetVertexPositions();
+        const auto& triangles = m_exchange.GetTriangles();
+        int num_tri = (int)triangles.size();
+        int num_vert = (int)vert_pos.size();
+        int num_threads = omp_get_max_threads();
+
+        const auto& cd_data = *system->data_manager->cd_data;
+        const auto& gamma = system->data_manager->host_data.gamma;
+        int num_contacts = (int)cd_data.num_rigid_contacts;
+
+        // Accumulate the impulse-weighted contact points on each triangle
+        m_tri_point.assign(num_threads * num_tri, VNULL);
+        m_tri_weight.assign(num_threads * num_tri, 0);
+#pragma omp parallel num_threads(num_threads)
+        {
+            int tid = omp_get_thread_num();
+            ChVector<>* point = m_tri_point.data() + tid * num_tri;
+            double* weight = m_tri_weight.data() + tid * num_tri;
+#pragma omp for schedule(static)
+            for (int i = 0; i < num_contacts; i++) {
+                const vec2& bids = cd_data.bids_rigid_rigid[i];
+                double w = gamma[i];
+                if (bids.x < num_tri) {
+                    const real3& pt = cd_data.cpta_rigid_rigid[i];
+                    point[bids.x] += w * ChVector<>(pt.x, pt.y, pt.z);
+                    weight[bids.x] += w;
+                }
+                if (bids.y < num_tri) {
+                    const real3& pt = cd_data.cptb_rigid_rigid[i];
+                    point[bids.y] += w * ChVector<>(pt.x, pt.y, pt.z);
+                    weight[bids.y] += w;
+                }
+            }
+        }
+
+        // Distribute the triangle forces to the vertices
+        m_vert_force.assign(num_threads * num_vert, VNULL);
+#pragma omp parallel num_threads(num_threads)
+        {
+            int tid = omp_get_thread_num();
+            ChVector<>* force = m_vert_force.data() + tid * num_vert;
+#pragma omp for schedule(static)
+            for (int i = 0; i < num_tri; i++) {
+                ChVector<> point = VNULL;
+                double weight = 0;
+                for (int t = 0; t < num_threads; t++) {
+                    point += m_tri_point[t * num_tri + i];
+                    weight += m_tri_weight[t * num_tri + i];
+                }
+                const auto& tri = triangles[i];
+                ChVector<> bary(1.0 / 3, 1.0 / 3, 1.0 / 3);
+                if (weight > 0)
+                    bary = Barycentric(point / weight, vert_pos[tri.x()], vert_pos[tri.y()], vert_pos[tri.z()]);
+                real3 f = system->GetBodyContactForce(i);
+                ChVector<> tri_force(f.x, f.y, f.z);
+                force[tri.x()] += bary.x() * tri_force;
+                force[tri.y()] += bary.y() * tri_force;
+                force[tri.z()] += bary.z() * tri_force;
+            }
+        }
+
+        // Reduce the per-thread vertex forces
+        vert_forces.resize(num_vert);
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+        for (int i = 0; i < num_vert; i++) {
+            ChVector<> f = VNULL;
+            for (int t = 0; t < num_threads; t++)
+                f += m_vert_force[t * num_vert + i];
+            vert_forces[i] = f;
+        }
+    }
+
+  private:
+    // Barycentric coordinates of the projection of p onto the triangle (a,b,c), clamped to the triangle.
+    static ChVector<> Barycentric(const ChVector<>& p, const ChVector<>& a, const ChVector<>& b, const ChVector<>& c) {
+        ChVector<> v0 = b - a;
+        ChVector<> v1 = c - a;
+        ChVector<> v2 = p - a;
+        double d00 = v0 ^ v0;
+        double d01 = v0 ^ v1;
+        double d11 = v1 ^ v1;
+        double d20 = v2 ^ v0;
+        double d21 = v2 ^ v1;
+        double denom = d00 * d11 - d01 * d01;
+        if (denom <= 0)
+            return ChVector<>(1.0 / 3, 1.0 / 3, 1.0 / 3);
+        double v = (d11 * d20 - d01 * d21) / denom;
+        double w = (d00 * d21 - d01 * d20) / denom;
+        ChVector<> bary(std::max(1 - v - w, 0.0), std::max(v, 0.0), std::max(w, 0.0));
+        return bary / (bary.x() + bary.y() + bary.z());
+    }
+
+    const TireMeshExchange& m_exchange;
+    std::vector<ChVector<>> m_tri_point;   ///< per-thread weighted contact points on triangles
+    std::vector<double> m_tri_weight;      ///< per-thread contact weights on triangles
+    std::vector<ChVector<>> m_vert_force;  ///< per-thread vertex forces
+};
+
+// Asynchronous writer of binary output frames.
+// The state of all granular bodies and the tire mesh is copied into one of two staging buffers on the simulation
+// thread; the buffer is then written (optionally compressed with zlib) on a background thread while the simulation
+// proceeds with the other buffer. The simulation thread blocks only if the previous frame has not been written yet.
+//
+// Each file contains a header followed by the frame data:
+//   header:  magic "CHFR", uint32 version, uint32 compressed flag, int32 frame, double time,
+//            uint32 number of bodies, uint32 number of vertices, uint32 number of triangles
+//   data:    per body: position (3 doubles) and orientation quaternion (4 doubles, e0..e3)
+//            per vertex: position (3 doubles)
+//            per triangle: vertex indices (3 int32)
+// With compression, the data is a gzip stream (the header is not compressed).
+class FrameWriter {
+  public:
+    FrameWriter(const std::string& prefix, bool compress)
+        : m_prefix(prefix), m_compress(compress), m_fill(0), m_pending(false), m_exit(false) {
+#ifndef COSIM_HAVE_ZLIB
+        if (m_compress) {
+            std::cout << "Compressed output not available (no zlib), writing uncompressed frames" << std::endl;
+            m_compress = false;
+        }
+#endif
+        m_thread = std::thread(&FrameWriter::Loop, this);
+    }
+
+    ~FrameWriter() {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return !m_pending; });
+            m_exit = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+
+    /// Take a snapshot of the granular system and of the tire mesh and queue it for writing.
+    void WriteFrame(int frame, double time, ChSystemMulticore* system, const TireMeshExchange& exchange) {
+        // Fill the staging buffer not in use by the writer thread
+        Frame& buffer = m_buffers[m_fill];
+        buffer.index = frame;
+        buffer.time = time;
+
+        const auto& pos = system->data_manager->host_data.pos_rigid;
+        const auto& rot = system->data_manager->host_data.rot_rigid;
+        const auto& vert_pos = exchange.GetVertexPositions();
+        const auto& triangles = exchange.GetTriangles();
+        buffer.num_bodies = system->data_manager->num_rigid_bodies;
+        buffer.num_vertices = (uint32_t)vert_pos.size();
+        buffer.num_triangles = (uint32_t)triangles.size();
+
+        buffer.data.resize(7 * buffer.num_bodies + 3 * buffer.num_vertices);
+        double* data = buffer.data.data();
+        for (uint32_t i = 0; i < buffer.num_bodies; i++) {
+            *data++ = pos[i].x;
+            *data++ = pos[i].y;
+            *data++ = pos[i].z;
+            *data++ = rot[i].w;
+            *data++ = rot[i].x;
+            *data++ = rot[i].y;
+            *data++ = rot[i].z;
+        }
+        for (const auto& v : vert_pos) {
+            *data++ = v.x();
+            *data++ = v.y();
+            *data++ = v.z();
+        }
+        buffer.connectivity.resize(3 * buffer.num_triangles);
+        for (uint32_t i = 0; i < buffer.num_triangles; i++) {
+            buffer.connectivity[3 * i + 0] = triangles[i].x();
+            buffer.connectivity[3 * i + 1] = triangles[i].y();
+            buffer.connectivity[3 * i + 2] = triangles[i].z();
+        }
+
+        // Hand the buffer over to the writer thread (once it finished the previous frame)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return !m_pending; });
+            m_write = m_fill;
+            m_pending = true;
+        }
+        m_cv.notify_all();
+        m_fill = 1 - m_fill;
+    }
+
+  private:
+    struct Frame {
+        int index;
+        double time;
+        uint32_t num_bodies;
+        uint32_t num_vertices;
+        uint32_t num_triangles;
+        std::vector<double> data;
+        std::vector<int32_t> connectivity;
+    };
+
+    void Loop() {
+        while (true) {
+            int write;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]() { return m_pending || m_exit; });
+                if (!m_pending)
+                    return;
+                write = m_write;
+            }
+            Write(m_buffers[write]);
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_pending = false;
+            }
+            m_cv.notify_all();
+        }
+    }
+
+    void Write(const Frame& frame) {
+        std::string filename = m_prefix + std::to_string(frame.index) + ".bin";
+        std::ofstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            std::cout << "Error opening output file " << filename << std::endl;
+            return;
+        }
+        const uint32_t version = 1;
+        const uint32_t compressed = m_compress ? 1 : 0;
+        file.write("CHFR", 4);
+        file.write((const char*)&version, sizeof(version));
+        file.write((const char*)&compressed, sizeof(compressed));
+        file.write((const char*)&frame.index, sizeof(frame.index));
+        file.write((const char*)&frame.time, sizeof(frame.time));
+        file.write((const char*)&frame.num_bodies, sizeof(frame.num_bodies));
+        file.write((const char*)&frame.num_vertices, sizeof(frame.num_vertices));
+        file.write((const char*)&frame.num_triangles, sizeof(frame.num_triangles));
+
+        const char* data = (const char*)frame.data.data();
+        size_t data_size = frame.data.size() * sizeof(double);
+        const char* conn = (const char*)frame.connectivity.data();
+        size_t conn_size = frame.connectivity.size() * sizeof(int32_t);
+
+        if (!m_compress) {
+            file.write(data, data_size);
+            file.write(conn, conn_size);
+            return;
+        }
+
+#ifdef COSIM_HAVE_ZLIB
+        file.close();
+        gzFile gz_file = gzopen(filename.c_str(), "ab1");
+        gzwrite(gz_file, data, (unsigned int)data_size);
+        gzwrite(gz_file, conn, (unsigned int)conn_size);
+        gzclose(gz_file);
+#endif
+    }
+
+    std::string m_prefix;
+    bool m_compress;
+    Frame m_buffers[2];
+    int m_fill;   ///< staging buffer filled by the simulation thread
+    int m_write;  ///< staging buffer written by the writer thread
+    bool m_pending;
+    bool m_exit;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+};
+
+// Worker thread for advancing the granular system concurrently with the tire system (pipelined mode).
+// The thread is persistent, so that it keeps its own OpenMP thread pool (with its own number of threads) over the
+// entire simulation.
+class PipelineWorker {
+  public:
+    PipelineWorker() : m_pending(false), m_done(true), m_exit(false), m_thread(&PipelineWorker::Loop, this) {}
+
+    ~PipelineWorker() {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_exit = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+
+    /// Start execution of the given task on the worker thread.
+    void Launch(std::function<void()> task) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_task = task;
+            m_pending = true;
+            m_done = false;
+        }
+        m_cv.notify_all();
+    }
+
+    /// Wait for completion of the current task.
+    void Wait() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]() { return m_done; });
+    }
+
+    /// Execute the given task on the worker thread and wait for its completion.
+    void Run(std::function<void()> task) {
+        Launch(task);
+        Wait();
+    }
+
+  private:
+    void Loop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]() { return m_pending || m_exit; });
+                if (m_exit)
+                    return;
+                task = m_task;
+                m_pending = false;
+            }
+            task();
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_done = true;
+            }
+            m_cv.notify_all();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::function<void()> m_task;
+    bool m_pending;
+    bool m_done;
+    bool m_exit;
+    std::thread m_thread;
+};
+
+// Monitor of the coupling lag in pipelined mode.
+// In a lagged step, the tire is advanced with the vertex forces from the previous granular step. The lag error of a
+// step is the relative difference between the forces used and the forces from the current granular step. If it
+// exceeds the specified threshold (stability guard), the following steps are run sequentially (without lag).
+class CouplingLagMonitor {
+  public:
+    CouplingLagMonitor(double threshold, int num_sequential_steps)
+        : m_threshold(threshold),
+          m_num_sequential_steps(num_sequential_steps),
+          m_sequential(0),
+          m_num_lagged(0),
+          m_num_unlagged(0),
+          m_num_trips(0),
+          m_error_sum(0),
+          m_error_max(0),
+          m_time_lagged(0),
+          m_time_unlagged(0) {}
+
+    /// Return true if the next step can be run with lagged exchange.
+    bool AllowLagged() const { return m_sequential == 0; }
+
+    /// Record a coupled step, given the forces used to advance the tire, the new forces from the granular system,
+    /// and the wall time of the step.
+    void Record(bool lagged,
+                const std::vector<ChVector<>>& used_forces,
+                const std::vector<ChVector<>>& new_forces,
+                double step_time) {
+        if (!lagged) {
+            m_num_unlagged++;
+            m_time_unlagged += step_time;
+            if (m_sequential > 0)
+                m_sequential--;
+            return;
+        }
+
+        double diff2 = 0;
+        double norm2 = 0;
+        for (size_t i = 0; i < new_forces.size(); i++) {
+            diff2 += (new_forces[i] - used_forces[i]).Length2();
+            norm2 += new_forces[i].Length2();
+        }
+        double error = norm2 > 0 ? std::sqrt(diff2 / norm2) : 0;
+
+        m_num_lagged++;
+        m_time_lagged += step_time;
+        m_error_sum += error;
+        m_error_max = std::max(m_error_max, error);
+        if (error > m_threshold) {
+            m_sequential = m_num_sequential_steps;
+            m_num_trips++;
+        }
+    }
+
+    /// Print the coupling lag report.
+    void Report(std::ostream& os) const {
+        os << "Coupling lag report" << std::endl;
+        os << "  lagged steps:             " << m_num_lagged << std::endl;
+        os << "  sequential steps:         " << m_num_unlagged << std::endl;
+        os << "  stability guard trips:    " << m_num_trips << " (threshold " << m_threshold << ")" << std::endl;
+        if (m_num_lagged > 0) {
+            os << "  force lag error (mean):   " << m_error_sum / m_num_lagged << std::endl;
+            os << "  force lag error (max):    " << m_error_max << std::endl;
+            os << "  time per lagged step:     " << 1e3 * m_time_lagged / m_num_lagged << " ms" << std::endl;
+        }
+        if (m_num_unlagged > 0)
+            os << "  time per sequential step: " << 1e3 * m_time_unlagged / m_num_unlagged << " ms" << std::endl;
+    }
+
+  private:
+    double m_threshold;
+    int m_num_sequential_steps;
+    int m_sequential;  ///< number of remaining steps to run sequentially
+    int m_num_lagged;
+    int m_num_unlagged;
+    int m_num_trips;
+    double m_error_sum;
+    double m_error_max;
+    double m_time_lagged;
+    double m_time_unlagged;
+};
+
+void ShowUsage(const std::string& name) {
+    std::cout << "Usage: " << name
+              << " [--pipelined [num_threads_granular num_threads_tire]] [--substeps K] [--band width]"
+              << " [--binary [--compress]] [--family-stats]" << std::endl;
+}
+
 int main(int argc, char* argv[]) {
     // Set path to Chrono data directory
     SetChronoDataPath(CHRONO_DATA_DIR);
@@ -91,6 +754,65 @@ int main(int argc, char* argv[]) {
     double tolerance = 1e-3;
     double time_end = 2.0;
 
+    // Pipelined mode: advance the granular and tire systems concurrently, with a one-step lagged exchange of forces
+    bool pipelined = false;
+    int num_threads_granular = std::max(omp_get_num_procs() / 2, 1);
+    int num_threads_tire = std::max(omp_get_num_procs() - num_threads_granular, 1);
+    double lag_threshold = 0.5;    // stability guard threshold on the force lag error
+    int num_sequential_steps = 20;  // number of sequential steps after the stability guard trips
+
+    // Multi-rate coupling: the tire is advanced with a macro step of K granular steps. Over a macro step, the tire
+    // mesh seen by the granular system moves with the vertex velocities at the beginning of the step, and the tire
+    // is advanced with the vertex forces averaged over the K granular steps.
+    int num_substeps = 1;
+
+    // Contact-band culling: only tire triangles within the given distance above the granular bed are active in the
+    // granular system (a negative value disables culling)
+    double contact_band = -1;
+    int band_grid = 20;  // number of height field cells in each horizontal direction
+
+    // Binary output frames, written asynchronously (instead of the POV-Ray and CSV text files)
+    bool binary_output = false;
+    bool compress_output = false;
+
+    // Broadphase pair statistics (pairs culled by the collision families) at the output frames
+    bool print_family_stats = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--pipelined") {
+            pipelined = true;
+            if (i + 2 < argc && std::isdigit(argv[i + 1][0])) {
+                num_threads_granular = std::atoi(argv[++i]);
+                num_threads_tire = std::atoi(argv[++i]);
+            }
+        } else if (arg == "--substeps" && i + 1 < argc) {
+            num_substeps = std::atoi(argv[++i]);
+        } else if (arg == "--band" && i + 1 < argc) {
+            contact_band = std::atof(argv[++i]);
+        } else if (arg == "--binary") {
+            binary_output = true;
+        } else if (arg == "--compress") {
+            compress_output = true;
+        } else if (arg == "--family-stats") {
+            print_family_stats = true;
+        } else {
+            ShowUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (num_substeps < 1 || num_threads_granular < 1 || num_threads_tire < 1) {
+        ShowUsage(argv[0]);
+        return 1;
+    }
+    double macro_step = num_substeps * time_step;
+#ifdef CHRONO_OPENGL
+    if (pipelined) {
+        std::cout << "Pipelined mode not available with OpenGL visualization" << std::endl;
+        pipelined = false;
+    }
+#endif
+
     // Frequency for visualization output
     bool saveData = true;
     int out_fps = 60;
@@ -161,12 +883,11 @@ int main(int argc, char* argv[]) {
     my_mesh->AddContactSurface(mcontactsurf);
     mcontactsurf->AddFacesFromBoundary();
 
-    /// Create a mesh load for cosimulation, acting on the contact surface above
+    /// Create the nodal loads for cosimulation, acting on the vertices of the contact surface above
     /// (forces on nodes will be computed by an external procedure)
     auto mloadcontainer = chrono_types::make_shared<ChLoadContainer>();
     my_system.Add(mloadcontainer);
-    auto mrigidmeshload = chrono_types::make_shared<ChLoadContactSurfaceMesh>(mcontactsurf);
-    mloadcontainer->Add(mrigidmeshload);
+    TireMeshExchange exchange(mcontactsurf, mloadcontainer);
 
     // ==Asset== attach a visualization of the FEM mesh.
     // This will automatically update a triangle mesh (a ChTriangleMeshShape
@@ -250,7 +971,7 @@ int main(int argc, char* argv[]) {
     my_system.SetTimestepperType(ChTimestepper::Type::EULER_IMPLICIT_LINEARIZED);  // fast, less precise
 
 #ifndef CHRONO_OPENGL
-    application.SetTimestep(time_step);
+    application.SetTimestep(macro_step);
 #endif
 
     // BEGIN MULTICORE SYSTEM INITIALIZATION
@@ -278,25 +999,14 @@ int main(int argc, char* argv[]) {
     triMat->SetFriction(0.4f);
 
     // Create the triangles for the tire geometry
-    ChVector<> pos(0, 0, 0);
-    ChVector<> vel(0, 0, 0);
-
-    std::vector<ChVector<>> vert_pos;
-    std::vector<ChVector<>> vert_vel;
-    std::vector<ChVector<int>> triangles;
-    std::vector<ChVector<>> vert_forces;
-    std::vector<int> vert_indexes;
-    vert_forces.clear();
-    vert_indexes.clear();
+    const auto& vert_pos = exchange.GetVertexPositions();
+    const auto& triangles = exchange.GetTriangles();
+    const auto& tri_pos = exchange.GetTrianglePositions();
+    const auto& tri_vel = exchange.GetTriangleVelocities();
+    auto& vert_forces = exchange.GetVertexForces();
+    const auto& vert_indexes = exchange.GetVertexIndexes();
     std::vector<ChVector<>> vert_forcesVisualization;
     std::vector<int> vert_indexesVisualization;
-    vert_forcesVisualization.clear();
-    vert_indexesVisualization.clear();
-    mrigidmeshload->OutputSimpleMesh(vert_pos, vert_vel, triangles);
-    for (int i = 0; i < vert_pos.size(); i++) {
-        vert_forces.push_back(ChVector<>(0, 0, 0));
-        vert_indexes.push_back(i);
-    }
 
     double mass = 2;  // mrigidbody->GetMass()/((double) triangles.size());
     double radius = 0.005;
@@ -308,10 +1018,9 @@ int main(int argc, char* argv[]) {
         triangle->SetIdentifier(triId++);
         triangle->SetMass(mass);
         triangle->SetInertiaXX(inertia);
-        pos = (vert_pos[triangles[i].x()] + vert_pos[triangles[i].y()] + vert_pos[triangles[i].z()]) / 3.0;
-        vel = (vert_vel[triangles[i].x()] + vert_vel[triangles[i].y()] + vert_vel[triangles[i].z()]) / 3.0;
+        const ChVector<>& pos = tri_pos[i];
         triangle->SetPos(pos);
-        triangle->SetPos_dt(vel);
+        triangle->SetPos_dt(tri_vel[i]);
         triangle->SetRot(ChQuaternion<>(1, 0, 0, 0));
         triangle->SetCollide(true);
         triangle->SetBodyFixed(true);
@@ -320,13 +1029,24 @@ int main(int argc, char* argv[]) {
         std::string name = "tri" + std::to_string(triId);
         chrono::utils::AddTriangleGeometry(triangle.get(), triMat, vert_pos[triangles[i].x()] - pos,
                                            vert_pos[triangles[i].y()] - pos, vert_pos[triangles[i].z()] - pos, name);
-        triangle->GetCollisionModel()->SetFamily(1);
-        triangle->GetCollisionModel()->SetFamilyMaskNoCollisionWithFamily(1);
         triangle->GetCollisionModel()->BuildModel();
 
         systemG->AddBody(triangle);
     }
 
+    // The tire triangles do not collide with each other
+    int num_triangles = triId;
+    CollisionGroups groups;
+    int tire_group = groups.AddGroup("tire triangles", [num_triangles](const ChBody& body) {
+        return body.GetIdentifier() >= 0 && body.GetIdentifier() < num_triangles;
+    });
+    groups.SetNoCollision(tire_group, tire_group);
+    groups.Apply(systemG);
+    CollisionFamilyStats family_stats(&groups);
+
+    exchange.Bind(systemG);
+    ContactForceScatter scatter(exchange);
+
     // Add the terrain, MUST BE ADDED AFTER TIRE GEOMETRY (for index assumptions)
     chrono::utils::CreateBoxContainer(systemG, -2, triMat, ChVector<>(1, 1, 1), 0.1, ChVector<>(0, -1, 0), QUNIT, true,
                                       true, true, false);
@@ -345,6 +1065,15 @@ int main(int argc, char* argv[]) {
     ChVector<> center(0, 0, 0);
     gen.CreateObjectsBox(sampler, center, hdims);
 
+    // Height field of the granular bed (over the container) for contact-band culling
+    std::unique_ptr<ContactBandCuller> culler;
+    if (contact_band >= 0) {
+        culler = std::unique_ptr<ContactBandCuller>(
+            new ContactBandCuller(ChVector<>(-1, 0, -1), ChVector<>(1, 0, 1), band_grid, band_grid, contact_band + r));
+        culler->UpdateHeightField(systemG);
+        exchange.Cull(*culler);
+    }
+
 #ifdef CHRONO_OPENGL
     // Initialize OpenGL
     opengl::ChOpenGLWindow& gl_window = opengl::ChOpenGLWindow::getInstance();
@@ -354,128 +1083,151 @@ int main(int argc, char* argv[]) {
 #endif
     // END MULTICORE SYSTEM INITIALIZATION
 
+    // Granular stage: advance the granular system over a macro step and calculate the resulting vertex forces
+    // (averaged over the substeps)
+    std::vector<ChVector<>> new_forces(vert_forces.size(), VNULL);
+    std::vector<ChVector<>> substep_forces(vert_forces.size(), VNULL);
+    auto granular_stage = [&]() {
+        std::fill(new_forces.begin(), new_forces.end(), VNULL);
+        for (int k = 0; k < num_substeps; k++) {
+            if (k > 0) {
+                exchange.AdvanceMesh(k * time_step);
+                exchange.UpdateGranular();
+            }
+#ifdef CHRONO_OPENGL
+            gl_window.DoStepDynamics(time_step);
+#else
+            systemG->DoStepDynamics(time_step);
+#endif
+            systemG->CalculateContactForces();
+            scatter.Scatter(systemG, substep_forces);
+            for (size_t i = 0; i < new_forces.size(); i++)
+                new_forces[i] += substep_forces[i] / num_substeps;
+        }
+    };
+
+    // In pipelined mode, the granular system is advanced on a separate thread (with its own thread pool)
+    std::unique_ptr<PipelineWorker> worker;
+    CouplingLagMonitor lag_monitor(lag_threshold, num_sequential_steps);
+    if (pipelined) {
+        std::cout << "Pipelined mode: " << num_threads_granular << " granular threads, " << num_threads_tire
+                  << " tire threads" << std::endl;
+        worker = std::unique_ptr<PipelineWorker>(new PipelineWorker);
+        worker->Run([&]() { systemG->SetNumThreads(num_threads_granular); });
+        my_system.SetNumThreads(num_threads_tire);
+        omp_set_num_threads(num_threads_tire);
+    }
+
+    std::unique_ptr<FrameWriter> frame_writer;
+    if (saveData && binary_output)
+        frame_writer = std::unique_ptr<FrameWriter>(new FrameWriter("../POVRAY/frame_", compress_output));
+
+    if (num_substeps > 1)
+        std::cout << "Multi-rate coupling: " << num_substeps << " granular steps per tire step" << std::endl;
+
     // Begin time loop
-    int out_steps = (int)std::ceil((1.0 / time_step) / out_fps);
+    int out_steps = (int)std::ceil((1.0 / macro_step) / out_fps);
     int timeIndex = 0;
     double time = 0;
     int frameIndex = 0;
+    ChTimer<double> step_timer;
 #ifdef CHRONO_OPENGL
     while (true) {
 #else
     while (application.GetDevice()->run()) {
 #endif
-// while (time<time_end) {
+        // while (time<time_end) {
+        step_timer.reset();
+        step_timer.start();
+
+        // With lagged exchange, STEP 1 runs concurrently with STEP 3 and STEP 2 is performed after both completed
+        bool lagged = pipelined && lag_monitor.AllowLagged();
 
 // STEP 1: ADVANCE DYNAMICS OF GRANULAR SYSTEM
 #ifdef CHRONO_OPENGL
         if (gl_window.Active()) {
-            gl_window.DoStepDynamics(time_step);
+            granular_stage();
             gl_window.Render();
         } else
             break;
 #else
-        systemG->DoStepDynamics(time_step);
-
-        if (timeIndex % out_steps == 0 && saveData) {
-            char filename[100];
-            sprintf(filename, "../POVRAY/data_%d.dat", frameIndex);
-
-            chrono::utils::WriteShapesPovray(systemG, filename, false);
-            std::string delim = ",";
-            chrono::utils::CSV_writer csv(delim);
-            csv << triangles.size() << std::endl;
-            for (int i = 0; i < triangles.size(); i++) {
-                csv << systemG->Get_bodylist().at(i)->GetPos() << vert_pos[triangles[i].x()]
-                    << vert_pos[triangles[i].y()] << vert_pos[triangles[i].z()] << std::endl;
-            }
-            sprintf(filename, "../POVRAY/triangles_%d.dat", frameIndex);
-            csv.write_to_file(filename);
-        }
+        if (lagged)
+            worker->Launch(granular_stage);
+        else if (pipelined)
+            worker->Run(granular_stage);
+        else
+            granular_stage();
 #endif
         // END STEP 1
 
         // STEP 2: APPLY CONTACT FORCES FROM GRANULAR TO TIRE SYSTEM
-        real3 force(0, 0, 0);
-        real3 torque(0, 0, 0);
-        systemG->CalculateContactForces();
-
-        vert_forces.clear();
-        for (int i = 0; i < vert_pos.size(); i++) {
-            vert_forces.push_back(ChVector<>(0, 0, 0));
-        }
-
-        for (int i = 0; i < triangles.size(); i++) {
-            force = systemG->GetBodyContactForce(i);
-            torque = systemG->GetBodyContactTorque(i);
-
-            // TODO: Calculate force based on the position in the triangle
-            vert_forces[triangles[i].x()] += ChVector<>(force.x, force.y, force.z) / 3;
-            vert_forces[triangles[i].y()] += ChVector<>(force.x, force.y, force.z) / 3;
-            vert_forces[triangles[i].z()] += ChVector<>(force.x, force.y, force.z) / 3;
+        if (!lagged) {
+            std::swap(vert_forces, new_forces);
+            exchange.ApplyForces();
         }
-        mrigidmeshload->InputSimpleForces(vert_forces, vert_indexes);
-// END STEP 2
+        // END STEP 2
 
 // STEP 3: ADVANCE DYNAMICS OF TIRE SYSTEM
 #ifdef CHRONO_OPENGL
-        my_system.DoStepDynamics(time_step);
+        my_system.DoStepDynamics(macro_step);
 #else
         application.BeginScene();
 
         application.DrawAll();
 
         application.DoStep();
+#endif
+        // END STEP 3
+
+        // Complete the lagged exchange: the forces from this granular step are used in the next tire step
+        if (lagged) {
+            worker->Wait();
+            std::swap(vert_forces, new_forces);
+            exchange.ApplyForces();
+        }
+
+        if (timeIndex % out_steps == 0 && print_family_stats) {
+            family_stats.Measure(systemG);
+            family_stats.Print(std::cout);
+        }
+
+#ifndef CHRONO_OPENGL
+        if (timeIndex % out_steps == 0 && saveData && frame_writer) {
+            frame_writer->WriteFrame(frameIndex, time, systemG, exchange);
+            frameIndex++;
+        } else if (timeIndex % out_steps == 0 && saveData) {
+            char filename[100];
+            sprintf(filename, "../POVRAY/data_%d.dat", frameIndex);
+
+            chrono::utils::WriteShapesPovray(systemG, filename, false);
+            std::string delim = ",";
+            chrono::utils::CSV_writer csv(delim);
+            csv << triangles.size() << std::endl;
+            for (int i = 0; i < triangles.size(); i++) {
+                csv << tri_pos[i] << vert_pos[triangles[i].x()] << vert_pos[triangles[i].y()]
+                    << vert_pos[triangles[i].z()] << std::endl;
+            }
+            sprintf(filename, "../POVRAY/triangles_%d.dat", frameIndex);
+            csv.write_to_file(filename);
 
-        if (timeIndex % out_steps == 0 && saveData) {
             // takeScreenshot(application.GetDevice(),frameIndex);
             frameIndex++;
         }
 #endif
-        // END STEP 3
 
         // STEP 4: UPDATE THE POSITION/VELOCITY OF THE TIRE GEOMETRY IN GRANULAR SYSTEM
-        vert_pos.clear();
-        vert_vel.clear();
-        triangles.clear();
-
-        mrigidmeshload->OutputSimpleMesh(vert_pos, vert_vel, triangles);
-
-        for (int i = 0; i < triangles.size(); i++) {
-            std::shared_ptr<ChBody> triBody = systemG->Get_bodylist().at(i);
-            pos = (vert_pos[triangles[i].x()] + vert_pos[triangles[i].y()] + vert_pos[triangles[i].z()]) / 3.0;
-            triBody->SetPos(pos);
-            vel = (vert_vel[triangles[i].x()] + vert_vel[triangles[i].y()] + vert_vel[triangles[i].z()]) / 3.0;
-            triBody->SetPos_dt(vel);
-
-            //            // Update visual assets TODO: chrono_opengl cannot handle dynamic meshes yet
-            //            for (int j = 0; j < triBody->GetAssets().size(); j++) {
-            //              std::shared_ptr<ChAsset> asset = triBody->GetAssets()[j];
-            //              if (std::dynamic_pointer_cast<ChTriangleMeshShape>(asset)) {
-            //                //std::cout << j << std::endl;
-            //                //std::cout << vert_pos[triangles[i].x()].x() << " " << vert_pos[triangles[i].x()].y() <<
-            //                " " << vert_pos[triangles[i].x()].z() << std::endl;
-            //                ((ChTriangleMeshShape*)(asset.get()))->GetMesh().m_vertices[0] =
-            //                vert_pos[triangles[i].x()];
-            //                ((ChTriangleMeshShape*)(asset.get()))->GetMesh().m_vertices[1] =
-            //                vert_pos[triangles[i].y()];
-            //                ((ChTriangleMeshShape*)(asset.get()))->GetMesh().m_vertices[2] =
-            //                ChVector<>(0);//vert_pos[triangles[i].z()];
-            //              }
-            //            }
-
-            // Update collision information
-            systemG->data_manager->cd_data->shape_data.triangle_rigid[3 * i + 0] =
-                real3(vert_pos[triangles[i].x()].x() - pos.x(), vert_pos[triangles[i].x()].y() - pos.y(),
-                      vert_pos[triangles[i].x()].z() - pos.z());
-            systemG->data_manager->cd_data->shape_data.triangle_rigid[3 * i + 1] =
-                real3(vert_pos[triangles[i].y()].x() - pos.x(), vert_pos[triangles[i].y()].y() - pos.y(),
-                      vert_pos[triangles[i].y()].z() - pos.z());
-            systemG->data_manager->cd_data->shape_data.triangle_rigid[3 * i + 2] =
-                real3(vert_pos[triangles[i].z()].x() - pos.x(), vert_pos[triangles[i].z()].y() - pos.y(),
-                      vert_pos[triangles[i].z()].z() - pos.z());
+        // (visual assets are not updated, chrono_opengl cannot handle dynamic meshes yet)
+        exchange.GatherMesh();
+        if (culler) {
+            culler->UpdateHeightField(systemG);
+            exchange.Cull(*culler);
         }
+        exchange.UpdateGranular();
         // END STEP 4
 
+        step_timer.stop();
+        lag_monitor.Record(lagged, new_forces, vert_forces, step_timer());
+
 #ifndef CHRONO_OPENGL
         // now, just for debugging and some fun, draw some triangles
         // (only those that have a vertex that has a force applied):
@@ -499,9 +1251,14 @@ int main(int argc, char* argv[]) {
         application.EndScene();
 #endif
         timeIndex++;
-        time += time_step;
-        std::cout << time << std::endl;
+        time += macro_step;
+        std::cout << time;
+        if (culler)
+            std::cout << "  active triangles: " << exchange.GetNumActiveTriangles() << "/" << triangles.size();
+        std::cout << std::endl;
     }
 
+    lag_monitor.Report(std::cout);
+
     return 0;
 }
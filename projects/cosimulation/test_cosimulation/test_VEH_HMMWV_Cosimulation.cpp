@@ -19,6 +19,7 @@
 //
 // =============================================================================
 
+#include <algorithm>
 #include <array>
 
 #include "chrono/core/ChRealtimeStep.h"
@@ -75,6 +76,12 @@ const std::string pov_dir = out_dir + "/POVRAY";
 // POV-Ray output
 bool povray_output = false;
 
+// Batched tire exchange on the terrain node.
+// If enabled, the data received for the individual tires is staged in a single packed buffer and applied to the
+// proxy bodies of all tires in one pass (once data for all tires was received), and the contact forces on all proxy
+// bodies are calculated and packed once per terrain step (the per-tire requests are served from the packed buffer).
+bool batched_exchange = true;
+
 // =============================================================================
 
 class MyDriver : public ChDriver {
@@ -147,6 +154,22 @@ class MyCosimManager : public ChCosimManager {
         std::shared_ptr<ChBody> m_body;
         int m_index;
     };
+
+    // Packed exchange data for all tires (batched exchange).
+    // Data for tire 'which' is stored in the range [offset[which], offset[which+1]) of the packed arrays.
+    struct TireBatch {
+        std::array<size_t, 5> offset;         ///< start of each tire's data in the packed arrays
+        std::vector<ChBody*> proxies;         ///< proxy bodies (all tires)
+        std::vector<ChVector<>> vert_pos;     ///< vertex positions (all tires)
+        std::vector<ChVector<>> vert_vel;     ///< vertex velocities (all tires)
+        std::vector<ChVector<>> vert_forces;  ///< contact forces on proxy bodies (all tires)
+        std::array<bool, 4> received;         ///< tire data received in current step?
+        bool forces_valid;                    ///< contact forces up to date?
+    };
+
+    void ApplyTireBatch();
+    void PackTireForces();
+
     HMMWV_Vehicle* m_vehicle;
     HMMWV_Powertrain* m_powertrain;
     MyDriver* m_driver;
@@ -156,10 +179,21 @@ class MyCosimManager : public ChCosimManager {
     ChCoordsys<> m_init_pos;
 
     std::array<std::vector<ProxyBody>, 4> m_proxies;
+    TireBatch m_batch;
 };
 
 MyCosimManager::MyCosimManager()
-    : ChCosimManager(4), m_vehicle(NULL), m_powertrain(NULL), m_driver(NULL), m_terrain(NULL), m_tire(NULL), m_system(NULL) {}
+    : ChCosimManager(4),
+      m_vehicle(NULL),
+      m_powertrain(NULL),
+      m_driver(NULL),
+      m_terrain(NULL),
+      m_tire(NULL),
+      m_system(NULL) {
+    m_batch.offset.fill(0);
+    m_batch.received.fill(false);
+    m_batch.forces_valid = false;
+}
 
 MyCosimManager::~MyCosimManager() {
     delete m_vehicle;
@@ -214,12 +248,34 @@ void MyCosimManager::OnReceiveTireInfo(int which, unsigned int num_vert, unsigne
 
         m_proxies[which].push_back(ProxyBody(body, iv));
     }
+
+    // Rebuild the packed proxy list for the batched exchange
+    m_batch.proxies.clear();
+    for (int i = 0; i < 4; i++) {
+        m_batch.offset[i] = m_batch.proxies.size();
+        for (const auto& proxy : m_proxies[i])
+            m_batch.proxies.push_back(proxy.m_body.get());
+    }
+    m_batch.offset[4] = m_batch.proxies.size();
+    m_batch.vert_pos.resize(m_batch.proxies.size());
+    m_batch.vert_vel.resize(m_batch.proxies.size());
+    m_batch.vert_forces.resize(m_batch.proxies.size());
 }
 
 void MyCosimManager::OnReceiveTireData(int which,
                                        const std::vector<ChVector<>>& vert_pos,
                                        const std::vector<ChVector<>>& vert_vel,
                                        const std::vector<ChVector<int>>& triangles) {
+    if (batched_exchange) {
+        // Stage the tire data in the packed buffer; apply once data for all tires is available
+        std::copy(vert_pos.begin(), vert_pos.end(), m_batch.vert_pos.begin() + m_batch.offset[which]);
+        std::copy(vert_vel.begin(), vert_vel.end(), m_batch.vert_vel.begin() + m_batch.offset[which]);
+        m_batch.received[which] = true;
+        if (std::all_of(m_batch.received.begin(), m_batch.received.end(), [](bool r) { return r; }))
+            ApplyTireBatch();
+        return;
+    }
+
     // Update position and velocity of the proxy bodies
     for (size_t iv = 0; iv < vert_pos.size(); iv++) {
         m_proxies[which][iv].m_body->SetPos(vert_pos[iv]);
@@ -227,7 +283,29 @@ void MyCosimManager::OnReceiveTireData(int which,
     }
 }
 
+void MyCosimManager::ApplyTireBatch() {
+    // Update position and velocity of the proxy bodies of all tires
+    for (size_t i = 0; i < m_batch.proxies.size(); i++) {
+        m_batch.proxies[i]->SetPos(m_batch.vert_pos[i]);
+        m_batch.proxies[i]->SetPos_dt(m_batch.vert_vel[i]);
+    }
+    m_batch.received.fill(false);
+}
+
 void MyCosimManager::OnSendTireForces(int which, std::vector<ChVector<>>& vert_forces, std::vector<int> vert_indeces) {
+    if (batched_exchange) {
+        // Contact forces for all tires are calculated once per terrain step
+        if (!m_batch.forces_valid)
+            PackTireForces();
+        for (size_t i = m_batch.offset[which]; i < m_batch.offset[which + 1]; i++) {
+            if (!m_batch.vert_forces[i].IsNull()) {
+                vert_forces.push_back(m_batch.vert_forces[i]);
+                vert_indeces.push_back(static_cast<int>(i - m_batch.offset[which]));
+            }
+        }
+        return;
+    }
+
     // If needed, force a calculation of contact forces
     ChSystemParallel* system = static_cast<ChSystemParallel*>(m_system);
     if (auto systemDVI = dynamic_cast<ChSystemParallelDVI*>(m_system))
@@ -245,12 +323,27 @@ void MyCosimManager::OnSendTireForces(int which, std::vector<ChVector<>>& vert_f
     }
 }
 
+void MyCosimManager::PackTireForces() {
+    // If needed, force a calculation of contact forces
+    ChSystemParallel* system = static_cast<ChSystemParallel*>(m_system);
+    if (auto systemDVI = dynamic_cast<ChSystemParallelDVI*>(m_system))
+        systemDVI->CalculateContactForces();
+
+    // Extract contact forces from the proxy bodies of all tires
+    for (size_t i = 0; i < m_batch.proxies.size(); i++) {
+        real3 force = system->GetBodyContactForce(m_batch.proxies[i]->GetId());
+        m_batch.vert_forces[i] = ChVector<>(force.x, force.y, force.z);
+    }
+    m_batch.forces_valid = true;
+}
+
 void MyCosimManager::OnAdvanceVehicle() {
     ////printf("Vehicle advanced...\n");
 }
 
 void MyCosimManager::OnAdvanceTerrain() {
     ////printf("Terrain advanced...\n");
+    m_batch.forces_valid = false;
 }
 
 void MyCosimManager::OnAdvanceTire(WheelID which) {
@@ -18,11 +18,19 @@
 // bed of granular material, using either penalty or complementarity method for
 // frictional contact.
 //
+// With -sweep [num_workers [first_member num_members]], a sweep of ball
+// densities and drop heights is run in the settled bed instead, each member
+// stopping once the ball is at rest (see impact_sweep.h).
+//
 // The global reference frame has Z up.
 // All units SI.
 // =============================================================================
 
+#include <algorithm>
 #include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 #include <cmath>
 
@@ -46,6 +54,13 @@
 #endif
 
 #include "../utils.h"
+#include "../adaptive_step.h"
+#include "../binary_checkpoint.h"
+#include "../contact_history.h"
+#include "../ensemble_pool.h"
+#include "../impact_sweep.h"
+#include "../settled_bed_cache.h"
+#include "../timing_recorder.h"
 
 using namespace chrono;
 using namespace chrono::collision;
@@ -82,6 +97,15 @@ double time_dropping = 0.06;
 #ifdef USE_SMC
 double time_step = 1e-5;
 int max_iteration = 20;
+
+// Adaptive step size, between time_step / 2 and 10 * time_step (see adaptive_step.h); the
+// settling and quiet phases of the impact then run at much larger steps than the impact itself.
+bool adaptive_step = false;
+double step_min = time_step / 2;
+double step_max = 10 * time_step;
+
+// Compact the MultiStep contact history after each step and report history statistics (see contact_history.h)
+bool compact_history = true;
 #else
 double time_step = 1e-4;
 int max_iteration_normal = 0;
@@ -101,6 +125,9 @@ ChSystemSMC::TangentialDisplacementModel tangential_displ_mode = ChSystemSMC::Ta
 // Output
 bool povray_output = true;
 
+// Reuse settled granular beds from the shared cache
+bool use_bed_cache = true;
+
 #ifdef USE_SMC
 const std::string out_dir = "../CRATER_SMC";
 #else
@@ -161,6 +188,15 @@ double layerHeight = 1e-2;
 // Drop height (above surface of settled granular material)
 double h = 10e-2;
 
+// Sweep of ball densities and drop heights (the ball radius is part of the
+// settled bed)
+std::vector<double> sweep_rho = {700, 2500, 7800};
+std::vector<double> sweep_h = {5e-2, 10e-2, 20e-2};
+double sweep_stop_speed = 1e-3;  // the ball is at rest below this speed...
+double sweep_hold_time = 2e-3;   // ...for this long
+double sweep_min_time = 5e-3;    // minimum duration of a member
+const std::string sweep_bed_file = out_dir + "/sweep_bed";  // .bin and .dat
+
 // -----------------------------------------------------------------------------
 // Create the dynamic objects:
 // - granular material consisting of identical spheres with specified radius and
@@ -219,6 +255,48 @@ int CreateObjects(ChSystemMulticore* system) {
     return gen.getTotalNumBodies();
 }
 
+// -----------------------------------------------------------------------------
+// Create the cache key for the settled granular bed, from all parameters which
+// affect the settled state (granular material, container, fixed ball, settling).
+// -----------------------------------------------------------------------------
+SettledBedCache CreateBedCache(ChSystemMulticore* system) {
+    SettledBedCache cache("crater");
+#ifdef USE_SMC
+    cache.Add("contact_method", "SMC");
+    cache.AddContactSettings(system);
+    cache.Add("max_iteration", max_iteration);
+#else
+    cache.Add("contact_method", "NSC");
+    cache.Add("max_iteration_sliding", max_iteration_sliding);
+    cache.Add("contact_recovery_speed", contact_recovery_speed);
+#endif
+    cache.Add("time_step", time_step);
+    cache.Add("tolerance", tolerance);
+    cache.Add("gravity", gravity);
+    cache.Add("time_settling_min", time_settling_min);
+    cache.Add("time_settling_max", time_settling_max);
+    cache.Add("r_g", r_g);
+    cache.Add("rho_g", rho_g);
+    cache.Add("Y_g", Y_g);
+    cache.Add("mu_g", mu_g);
+    cache.Add("cr_g", cr_g);
+    cache.Add("R_b", R_b);
+    cache.Add("bin_dims", ChVector<>(hDimX, hDimY, hDimZ));
+    cache.Add("hThickness", hThickness);
+    cache.Add("Y_c", Y_c);
+    cache.Add("mu_c", mu_c);
+    cache.Add("cr_c", cr_c);
+    cache.Add("numLayers", numLayers);
+    cache.Add("layerHeight", layerHeight);
+#ifdef USE_SMC
+    if (adaptive_step) {
+        cache.Add("step_min", step_min);
+        cache.Add("step_max", step_max);
+    }
+#endif
+    return cache;
+}
+
 // -----------------------------------------------------------------------------
 // Create the falling ball such that its bottom point is at the specified height
 // and its downward initial velocity has the specified magnitude.
@@ -296,13 +374,13 @@ bool CheckSettled(ChSystem* sys, double threshold) {
 }
 
 // -----------------------------------------------------------------------------
-int main(int argc, char* argv[]) {
-// Create system
+// Create the multicore system with the given number of threads, and set the
+// solver and collision detection settings.
+// -----------------------------------------------------------------------------
+ChSystemMulticore* CreateSystem(int num_threads) {
 #ifdef USE_SMC
-    cout << "Create SMC system" << endl;
     ChSystemMulticoreSMC* msystem = new ChSystemMulticoreSMC();
 #else
-    cout << "Create NSC system" << endl;
     ChSystemMulticoreNSC* msystem = new ChSystemMulticoreNSC();
 #endif
 
@@ -311,11 +389,7 @@ int main(int argc, char* argv[]) {
     ////msystem->SetLoggingLevel(LOG_TRACE, true);
 
     // Set number of threads.
-    int max_threads = omp_get_num_procs();
-    if (threads > max_threads)
-        threads = max_threads;
-    msystem->SetNumThreads(threads);
-    cout << "Using " << threads << " threads" << endl;
+    msystem->SetNumThreads(num_threads);
 
     // Set gravitational acceleration
     msystem->Set_G_acc(ChVector<>(0, 0, -gravity));
@@ -343,6 +417,122 @@ int main(int argc, char* argv[]) {
 
     msystem->GetSettings()->collision.bins_per_axis = vec3(20, 20, 20);
 
+    return msystem;
+}
+
+// -----------------------------------------------------------------------------
+// Run the sweep of falling ball variants. The settled bed (from the cache or from the
+// checkpoint file) is written once to a binary checkpoint, which all members
+// read (memory-mapped). Each member runs single-threaded until the projectile
+// is at rest, or for at most time_dropping.
+// -----------------------------------------------------------------------------
+int RunSweep(ImpactSweepOptions& options) {
+    {
+        ChSystemMulticore* system = CreateSystem(1);
+        if (!use_bed_cache || !CreateBedCache(system).Load(system)) {
+            if (!filesystem::path(checkpoint_file).exists()) {
+                cout << "Checkpoint file " << checkpoint_file << " not found; run the SETTLING problem first" << endl;
+                delete system;
+                return 1;
+            }
+            utils::ReadCheckpoint(system, checkpoint_file);
+        }
+        WriteSystemCheckpoint(system, sweep_bed_file + ".bin", sweep_bed_file + ".dat");
+        delete system;
+    }
+
+    struct Member {
+        double rho;
+        double drop;
+        ImpactResult result;
+    };
+    std::vector<Member> members;
+    for (auto rho : sweep_rho)
+        for (auto drop : sweep_h)
+            members.push_back({rho, drop, ImpactResult()});
+
+    int num_members = options.Range((int)members.size());
+    EnsemblePool pool(options.num_workers);
+    cout << "Run sweep members " << options.first << " to " << options.first + num_members - 1 << " (of "
+         << members.size() << ") on " << pool.GetNumWorkers() << " workers" << endl;
+
+    double wall_time = pool.Run(num_members, [&](int i, int) {
+        Member& m = members[options.first + i];
+        std::unique_lock<std::mutex> lock(pool.GetSetupMutex());
+        ChSystemMulticore* system = CreateSystem(1);
+        ReadSystemCheckpoint(system, sweep_bed_file + ".bin", sweep_bed_file + ".dat");
+
+        // Move the falling ball (first body of the bed) just above the granular material
+        double mass = m.rho * vol_b;
+        double z = FindHighest(system);
+        auto ball = system->Get_bodylist().at(0);
+        ball->SetMass(mass);
+        ball->SetInertiaXX(0.4 * mass * R_b * R_b * ChVector<>(1, 1, 1));
+        ball->SetPos(ChVector<>(0, 0, z + r_g + R_b));
+        ball->SetRot(ChQuaternion<>(1, 0, 0, 0));
+        ball->SetPos_dt(ChVector<>(0, 0, -std::sqrt(2 * gravity * m.drop)));
+        ball->SetBodyFixed(false);
+        lock.unlock();
+
+        m.result = RunImpact(system, ball, time_step, sweep_min_time, time_dropping, sweep_stop_speed, sweep_hold_time);
+        delete system;
+    });
+
+    const auto& times = pool.GetMemberTimes();
+    utils::CSV_writer csv(",");
+    csv << "rho"
+        << "drop_height"
+        << "depth"
+        << "max_depth"
+        << "time"
+        << "at_rest"
+        << "wall_time" << endl;
+    double sim_time = 0;
+    for (int i = 0; i < num_members; i++) {
+        const Member& m = members[options.first + i];
+        csv << m.rho << m.drop << m.result.depth << m.result.max_depth << m.result.time << (int)m.result.stopped
+            << times[i] << endl;
+        sim_time += m.result.time;
+    }
+    std::string sweep_file = out_dir + "/sweep_" + std::to_string(options.first) + ".csv";
+    csv.write_to_file(sweep_file);
+
+    cout << "==================================" << endl;
+    cout << "Sweep members:     " << num_members << endl;
+    cout << "Simulated time:    " << sim_time << " (of " << num_members * time_dropping << " without early stop)"
+         << endl;
+    cout << "Wall-clock time:   " << wall_time << endl;
+    cout << "Results written to " << sweep_file << endl;
+
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+    // Sweep of ball variants in the settled bed
+    ImpactSweepOptions sweep;
+    if (sweep.Parse(argc, argv)) {
+        if (!filesystem::create_directory(filesystem::path(out_dir))) {
+            cout << "Error creating directory " << out_dir << endl;
+            return 1;
+        }
+        return RunSweep(sweep);
+    }
+
+// Create system
+#ifdef USE_SMC
+    cout << "Create SMC system" << endl;
+#else
+    cout << "Create NSC system" << endl;
+#endif
+
+    // Set number of threads.
+    int max_threads = omp_get_num_procs();
+    if (threads > max_threads)
+        threads = max_threads;
+    ChSystemMulticore* msystem = CreateSystem(threads);
+    cout << "Using " << threads << " threads" << endl;
+
     // Depending on problem type:
     // - Select end simulation time
     // - Select output FPS
@@ -352,24 +542,36 @@ int main(int argc, char* argv[]) {
     int out_fps;
     std::shared_ptr<ChBody> ball;
 
+    SettledBedCache bed_cache = CreateBedCache(msystem);
+    bool bed_cached = false;
+
     if (problem == SETTLING) {
         time_end = time_settling_max;
         out_fps = out_fps_settling;
 
-        cout << "Create granular material" << endl;
-        // Create the fixed falling ball just below the granular material
-        CreateFallingBall(msystem, -3 * R_b, 0);
-        ball = msystem->Get_bodylist().at(0);
-        ball->SetBodyFixed(true);
-        CreateObjects(msystem);
+        if (use_bed_cache && bed_cache.Load(msystem)) {
+            // The settled bed is available: skip the settling simulation
+            bed_cached = true;
+            time_end = 0;
+            ball = msystem->Get_bodylist().at(0);
+        } else {
+            cout << "Create granular material" << endl;
+            // Create the fixed falling ball just below the granular material
+            CreateFallingBall(msystem, -3 * R_b, 0);
+            ball = msystem->Get_bodylist().at(0);
+            ball->SetBodyFixed(true);
+            CreateObjects(msystem);
+        }
     } else {
         time_end = time_dropping;
         out_fps = out_fps_dropping;
 
-        // Create the granular material and the container from the checkpoint file.
-        cout << "Read checkpoint data from " << checkpoint_file;
-        utils::ReadCheckpoint(msystem, checkpoint_file);
-        cout << "  done.  Read " << msystem->Get_bodylist().size() << " bodies." << endl;
+        // Create the granular material and the container from the cache or from the checkpoint file.
+        if (!use_bed_cache || !bed_cache.Load(msystem)) {
+            cout << "Read checkpoint data from " << checkpoint_file;
+            utils::ReadCheckpoint(msystem, checkpoint_file);
+            cout << "  done.  Read " << msystem->Get_bodylist().size() << " bodies." << endl;
+        }
 
         // Move the falling ball just above the granular material with a velocity
         // given by free fall from the specified height and starting at rest.
@@ -412,6 +614,26 @@ int main(int argc, char* argv[]) {
     int num_contacts = 0;
     ChStreamOutAsciiFile sfile(stats_file.c_str());
     ChStreamOutAsciiFile hfile(height_file.c_str());
+    bool settled = false;
+
+    // Per-step timers (convert to CSV with test_MCORE_timing_csv)
+    TimingRecorder timing(out_dir + "/timing.bin");
+
+    // Adaptive step size controller (with rollback, since all state is carried by the bodies).
+    // Output frames are then triggered by the simulation time rather than by the step count.
+    std::unique_ptr<AdaptiveStepController> stepper;
+#ifdef USE_SMC
+    if (adaptive_step)
+        stepper = std::unique_ptr<AdaptiveStepController>(
+            new AdaptiveStepController(r_g, step_min, step_max, time_step));
+#endif
+    int frame_steps = 0;
+
+#ifdef USE_SMC
+    std::unique_ptr<ContactHistory> history;
+    if (compact_history && tangential_displ_mode == ChSystemSMC::TangentialDisplacementModel::MultiStep)
+        history = std::unique_ptr<ContactHistory>(new ContactHistory);
+#endif
 
 #ifdef CHRONO_OPENGL
     opengl::ChOpenGLWindow& gl_window = opengl::ChOpenGLWindow::getInstance();
@@ -421,16 +643,27 @@ int main(int argc, char* argv[]) {
 #endif
 
     while (time < time_end) {
-        if (sim_frame == next_out_frame) {
+        bool output = stepper ? (time >= out_frame / (double)out_fps) : (sim_frame == next_out_frame);
+        if (output) {
             cout << endl;
             cout << "---- Frame:          " << out_frame << endl;
             cout << "     Sim frame:      " << sim_frame << endl;
             cout << "     Time:           " << time << endl;
             cout << "     Lowest point:   " << FindLowest(msystem) << endl;
-            cout << "     Avg. contacts:  " << num_contacts / out_steps << endl;
+            cout << "     Avg. contacts:  " << num_contacts / std::max(frame_steps, 1) << endl;
             cout << "     Execution time: " << exec_time << endl;
+            if (stepper)
+                cout << "     Step size:      " << stepper->GetStep() << endl;
+#ifdef USE_SMC
+            if (history) {
+                cout << "     History:        " << history->GetNumEntries() << " entries, " << history->GetNumHits()
+                     << " hits, " << history->GetNumNew() << " new, " << history->GetNumStale() << " stale" << endl;
+                cout << "     History time:   " << history->GetTime() << " (hit rate " << history->GetHitRate() << ")"
+                     << endl;
+            }
+#endif
 
-            sfile << time << "  " << exec_time << "  " << num_contacts / out_steps << "\n";
+            sfile << time << "  " << exec_time << "  " << num_contacts / std::max(frame_steps, 1) << "\n";
 
             // If enabled, output data for PovRay postprocessing.
             if (povray_output) {
@@ -455,29 +688,43 @@ int main(int argc, char* argv[]) {
             out_frame++;
             next_out_frame += out_steps;
             num_contacts = 0;
+            frame_steps = 0;
         }
 
         if (problem == SETTLING && time > time_settling_min && CheckSettled(msystem, zero_v)) {
             cout << "Granular material settled...  time = " << time << endl;
+            settled = true;
             break;
         }
 
 // Advance simulation by one step
+        double step = time_step;
 #ifdef CHRONO_OPENGL
         if (gl_window.Active()) {
-            gl_window.DoStepDynamics(time_step);
+            if (stepper)
+                step = stepper->DoStep(msystem);
+            else
+                gl_window.DoStepDynamics(time_step);
             gl_window.Render();
         } else
             break;
 #else
-        msystem->DoStepDynamics(time_step);
+        if (stepper)
+            step = stepper->DoStep(msystem);
+        else
+            msystem->DoStepDynamics(time_step);
 #endif
 
         ////progressbar(out_steps + sim_frame - next_out_frame + 1, out_steps);
-        TimingOutput(msystem);
+        timing.Record(msystem);
+#ifdef USE_SMC
+        if (history)
+            history->Update(msystem);
+#endif
 
-        time += time_step;
+        time += step;
         sim_frame++;
+        frame_steps++;
         exec_time += msystem->GetTimerStep();
         num_contacts += msystem->GetNcontacts();
 
@@ -491,6 +738,10 @@ int main(int argc, char* argv[]) {
         cout << "Write checkpoint data to " << checkpoint_file;
         utils::WriteCheckpoint(msystem, checkpoint_file);
         cout << "  done.  Wrote " << msystem->Get_bodylist().size() << " bodies." << endl;
+
+        // Store the settled bed in the cache (unless the simulation was interrupted)
+        if (use_bed_cache && !bed_cached && (settled || time >= time_end))
+            bed_cache.Store(msystem);
     }
 
     // Final stats
@@ -500,5 +751,10 @@ int main(int argc, char* argv[]) {
     cout << "Simulation time:   " << exec_time << endl;
     cout << "Number of threads: " << threads << endl;
 
+    if (stepper) {
+        stepper->PrintSummary();
+        stepper->WriteHistory(out_dir + "/steps.csv");
+    }
+
     return 0;
 }
@@ -45,6 +45,8 @@
 #include "chrono_opengl/ChOpenGLWindow.h"
 #endif
 
+#include "../settled_bed_cache.h"
+
 using namespace chrono;
 using namespace chrono::collision;
 
@@ -109,6 +111,9 @@ int out_fps_dropping = 200;
 
 int timing_frame = -1;  // output detailed step timing at this frame
 
+// Reuse settled granular beds from the shared cache
+bool use_bed_cache = true;
+
 // Parameters for the granular material
 double r_g = 0.25e-3;
 double rho_g = 2500.0;
@@ -269,6 +274,44 @@ void CreateParticles(ChSystemMulticore* system) {
     std::cout << "Number of particles: " << gen.getTotalNumBodies() << std::endl;
 }
 
+// -----------------------------------------------------------------------------
+// Create the cache key for the settled granular material, from all parameters
+// which affect the settled state (granular material, mechanism, settling).
+// -----------------------------------------------------------------------------
+SettledBedCache CreateBedCache(ChSystemMulticore* system) {
+    SettledBedCache cache("massflow");
+#ifdef USE_SMC
+    cache.Add("contact_method", "SMC");
+    cache.AddContactSettings(system);
+    cache.Add("max_iteration", max_iteration);
+#else
+    cache.Add("contact_method", "NSC");
+    cache.Add("max_iteration_sliding", max_iteration_sliding);
+    cache.Add("contact_recovery_speed", contact_recovery_speed);
+#endif
+    cache.Add("time_step", time_step);
+    cache.Add("tolerance", tolerance);
+    cache.Add("gravity", gravity);
+    cache.Add("time_settling_min", time_settling_min);
+    cache.Add("time_settling_max", time_settling_max);
+    cache.Add("r_g", r_g);
+    cache.Add("rho_g", rho_g);
+    cache.Add("Y_g", Y_g);
+    cache.Add("cr_g", cr_g);
+    cache.Add("mu_g", mu_g);
+    cache.Add("desired_num_particles", (int)desired_num_particles);
+    cache.Add("Y_c", Y_c);
+    cache.Add("cr_c", cr_c);
+    cache.Add("mu_c", mu_c);
+    cache.Add("height", height);
+    cache.Add("width", width);
+    cache.Add("thickness", thickness);
+    cache.Add("pos_collector", pos_collector);
+    cache.Add("size_collector", size_collector);
+    cache.Add("height_collector", height_collector);
+    return cache;
+}
+
 // -----------------------------------------------------------------------------
 // Find and return the body with specified identifier.
 // -----------------------------------------------------------------------------
@@ -368,18 +411,29 @@ int main(int argc, char* argv[]) {
     int out_fps;
     ChBody* insert;
 
+    SettledBedCache bed_cache = CreateBedCache(msystem);
+    bool bed_cached = false;
+
     switch (problem) {
         case SETTLING:
             time_end = time_settling_max;
             out_fps = out_fps_settling;
-            insert = CreateMechanism(msystem);
-            CreateParticles(msystem);
+            if (use_bed_cache && bed_cache.Load(msystem)) {
+                // The settled material is available: skip the settling simulation
+                bed_cached = true;
+                time_end = 0;
+                insert = FindBodyById(msystem, 0);
+            } else {
+                insert = CreateMechanism(msystem);
+                CreateParticles(msystem);
+            }
             break;
 
         case DROPPING:
             time_end = time_dropping_max;
             out_fps = out_fps_dropping;
-            utils::ReadCheckpoint(msystem, checkpoint_file);
+            if (!use_bed_cache || !bed_cache.Load(msystem))
+                utils::ReadCheckpoint(msystem, checkpoint_file);
             insert = FindBodyById(msystem, 0);
             break;
     }
@@ -410,6 +464,7 @@ int main(int argc, char* argv[]) {
     int num_contacts = 0;
     ChStreamOutAsciiFile sfile(stats_file.c_str());
     ChStreamOutAsciiFile ffile(flow_file.c_str());
+    bool settled = false;
 
 #ifdef CHRONO_OPENGL
     opengl::ChOpenGLWindow& gl_window = opengl::ChOpenGLWindow::getInstance();
@@ -461,6 +516,7 @@ int main(int argc, char* argv[]) {
         // Check for early termination of settling phase.
         if (problem == SETTLING && time > time_settling_min && CheckSettled(msystem, zero_v)) {
             cout << "Granular material settled...  time = " << time << endl;
+            settled = true;
             break;
         }
 
@@ -504,6 +560,10 @@ int main(int argc, char* argv[]) {
         cout << "Write checkpoint data to " << checkpoint_file;
         utils::WriteCheckpoint(msystem, checkpoint_file);
         cout << "  done.  Wrote " << msystem->Get_bodylist().size() << " bodies." << endl;
+
+        // Store the settled material in the cache (unless the simulation was interrupted)
+        if (use_bed_cache && !bed_cached && (settled || time >= time_end))
+            bed_cache.Store(msystem);
     }
 
     // Final stats
@@ -18,11 +18,17 @@
 // bed of granular material, using either penalty or complementarity method for
 // frictional contact.
 //
+// With -sweep [num_workers [first_member num_members]], a sweep of penetrator
+// variants (shape, density, drop height) is run from the settled bed, each
+// member stopping once the penetrator is at rest (see impact_sweep.h).
+//
 // The global reference frame has Z up.
 // All units SI.
 // =============================================================================
 
 #include <cstdio>
+#include <mutex>
+#include <string>
 #include <vector>
 #include <cmath>
 
@@ -46,6 +52,10 @@
 #endif
 
 #include "../utils.h"
+#include "../binary_checkpoint.h"
+#include "../ensemble_pool.h"
+#include "../impact_sweep.h"
+#include "../settled_bed_cache.h"
 
 using namespace chrono;
 using namespace chrono::collision;
@@ -103,6 +113,9 @@ ChSystemSMC::TangentialDisplacementModel tangential_displ_mode = ChSystemSMC::Ta
 // Output
 bool povray_output = true;
 
+// Reuse settled granular beds from the shared cache
+bool use_bed_cache = true;
+
 #ifdef USE_SMC
 const std::string out_dir = "../PENETRATOR_SMC";
 #else
@@ -164,6 +177,15 @@ double layerHeight = 1e-2;
 // Drop height (above surface of settled granular material)
 double h = 10e-2;
 
+// Sweep of penetrator variants, all dropped in the same settled bed
+std::vector<PenetratorGeom> sweep_geom = {P_SPHERE, P_CONE1, P_CONE2};
+std::vector<double> sweep_rho = {700, 1500, 2500};
+std::vector<double> sweep_h = {5e-2, 10e-2, 20e-2};
+double sweep_stop_speed = 1e-3;  // the penetrator is at rest below this speed...
+double sweep_hold_time = 2e-3;   // ...for this long
+double sweep_min_time = 5e-3;    // minimum duration of a member
+const std::string sweep_bed_file = out_dir + "/sweep_bed";  // .bin and .dat
+
 // -----------------------------------------------------------------------------
 // Create the dynamic objects:
 // - granular material consisting of identical spheres with specified radius and
@@ -222,31 +244,66 @@ int CreateObjects(ChSystemMulticore* msystem) {
     return gen.getTotalNumBodies();
 }
 
+// -----------------------------------------------------------------------------
+// Create the cache key for the settled granular bed, from all parameters which
+// affect the settled state (granular material, container, settling).
+// -----------------------------------------------------------------------------
+SettledBedCache CreateBedCache(ChSystemMulticore* system) {
+    SettledBedCache cache("penetrometer");
+#ifdef USE_SMC
+    cache.Add("contact_method", "SMC");
+    cache.AddContactSettings(system);
+    cache.Add("max_iteration", max_iteration);
+#else
+    cache.Add("contact_method", "NSC");
+    cache.Add("max_iteration_sliding", max_iteration_sliding);
+    cache.Add("contact_recovery_speed", contact_recovery_speed);
+#endif
+    cache.Add("time_step", time_step);
+    cache.Add("tolerance", tolerance);
+    cache.Add("gravity", gravity);
+    cache.Add("time_settling_min", time_settling_min);
+    cache.Add("time_settling_max", time_settling_max);
+    cache.Add("r_g", r_g);
+    cache.Add("rho_g", rho_g);
+    cache.Add("Y_g", Y_g);
+    cache.Add("mu_g", mu_g);
+    cache.Add("cr_g", cr_g);
+    cache.Add("bin_dims", ChVector<>(hDimX, hDimY, hDimZ));
+    cache.Add("hThickness", hThickness);
+    cache.Add("Y_c", Y_c);
+    cache.Add("mu_c", mu_c);
+    cache.Add("cr_c", cr_c);
+    cache.Add("numLayers", numLayers);
+    cache.Add("layerHeight", layerHeight);
+    return cache;
+}
+
 // -----------------------------------------------------------------------------
 // Calculate intertia properties of the falling object
 // -----------------------------------------------------------------------------
-void CalculatePenetratorInertia(double & mass, ChVector<> & inertia) {
+void CalculatePenetratorInertia(PenetratorGeom geom, double rho, double& mass, ChVector<>& inertia) {
     ChVector<> gyr_b;  // components gyration
     double vol_b;      // components volume
-    switch (penetGeom) {
+    switch (geom) {
         case P_SPHERE:
             vol_b = utils::CalcSphereVolume(R_b);
             gyr_b = utils::CalcSphereGyration(R_b).diagonal();
-            mass = rho_b * vol_b;
+            mass = rho * vol_b;
             inertia = mass * gyr_b;
             break;
         case P_CONE1:
             // apex angle = 30 de
             vol_b = utils::CalcConeVolume(R_bc1, H_bc1);
             gyr_b = utils::CalcConeGyration(R_bc1, H_bc1).diagonal();
-            mass = rho_b * vol_b;
+            mass = rho * vol_b;
             inertia = mass * gyr_b;
             break;
         case P_CONE2:
             // apex angle = 60 deg
             vol_b = utils::CalcConeVolume(R_bc2, H_bc2);
             gyr_b = utils::CalcConeGyration(R_bc2, H_bc2).diagonal();
-            mass = rho_b * vol_b;
+            mass = rho * vol_b;
             inertia = mass * gyr_b;
             break;
 	}
@@ -255,9 +312,11 @@ void CalculatePenetratorInertia(double & mass, ChVector<> & inertia) {
 // -----------------------------------------------------------------------------
 // Create collision geometry of the falling object
 // -----------------------------------------------------------------------------
-void CreatePenetratorGeometry(std::shared_ptr<ChBody> obj, std::shared_ptr<ChMaterialSurface> mat) {
+void CreatePenetratorGeometry(std::shared_ptr<ChBody> obj,
+                              std::shared_ptr<ChMaterialSurface> mat,
+                              PenetratorGeom geom) {
     obj->GetCollisionModel()->ClearModel();
-    switch (penetGeom) {
+    switch (geom) {
         case P_SPHERE:
             utils::AddSphereGeometry(obj.get(), mat, R_b);
             break;
@@ -276,9 +335,9 @@ void CreatePenetratorGeometry(std::shared_ptr<ChBody> obj, std::shared_ptr<ChMat
 // -----------------------------------------------------------------------------
 // Calculate falling object height
 // -----------------------------------------------------------------------------
-double RecalcPenetratorLocation(double z) {
+double RecalcPenetratorLocation(double z, PenetratorGeom geom) {
     double locZ = 0;
-    switch (penetGeom) {
+    switch (geom) {
         case P_SPHERE:
             locZ = z + R_b + r_g;
             break;
@@ -318,14 +377,15 @@ double FindLowest(ChSystem* sys) {
 }
 
 // -----------------------------------------------------------------------------
-// Create the falling object such that its bottom point is at the specified height
-// and its downward initial velocity has the specified magnitude.
+// Create the falling object with given shape and density just above the
+// surface of the granular material, with a downward initial velocity given by
+// free fall from the specified drop height.
 // -----------------------------------------------------------------------------
-std::shared_ptr<ChBody> CreatePenetrator(ChSystemMulticore* msystem) {
+std::shared_ptr<ChBody> CreatePenetrator(ChSystemMulticore* msystem, PenetratorGeom geom, double rho, double drop) {
     // Estimate object initial location and velocity
     double z = FindHighest(msystem);
-    double vz = std::sqrt(2 * gravity * h);
-    double initLoc = RecalcPenetratorLocation(z);
+    double vz = std::sqrt(2 * gravity * drop);
+    double initLoc = RecalcPenetratorLocation(z, geom);
     cout << "creating object at " << initLoc << " and velocity " << vz << endl;
 
 // Create a material for the penetrator
@@ -344,7 +404,7 @@ std::shared_ptr<ChBody> CreatePenetrator(ChSystemMulticore* msystem) {
 
     double mass;
     ChVector<> inertia;
-    CalculatePenetratorInertia(mass, inertia);
+    CalculatePenetratorInertia(geom, rho, mass, inertia);
     obj->SetIdentifier(Id_b);
     obj->SetMass(mass);
     obj->SetInertiaXX(inertia);
@@ -354,7 +414,7 @@ std::shared_ptr<ChBody> CreatePenetrator(ChSystemMulticore* msystem) {
     obj->SetCollide(true);
     obj->SetBodyFixed(false);
 
-    CreatePenetratorGeometry(obj, mat);
+    CreatePenetratorGeometry(obj, mat, geom);
 
     msystem->AddBody(obj);
     return obj;
@@ -408,26 +468,13 @@ void SetArgumentsForMbdFromInput(int argc, char* argv[]) {
 }
 
 // -----------------------------------------------------------------------------
-int main(int argc, char* argv[]) {
-    // Create output directories.
-    if (!filesystem::create_directory(filesystem::path(out_dir))) {
-        cout << "Error creating directory " << out_dir << endl;
-        return 1;
-    }
-    if (!filesystem::create_directory(filesystem::path(pov_dir))) {
-        cout << "Error creating directory " << pov_dir << endl;
-        return 1;
-    }
-    
-    // Get problem parameters from arguments
-    SetArgumentsForMbdFromInput(argc, argv);
-
-// Create system
+// Create the multicore system with the given number of threads, and set the
+// solver and collision detection settings.
+// -----------------------------------------------------------------------------
+ChSystemMulticore* CreateSystem(int num_threads) {
 #ifdef USE_SMC
-    cout << "Create SMC system" << endl;
     ChSystemMulticoreSMC* msystem = new ChSystemMulticoreSMC();
 #else
-    cout << "Create NSC system" << endl;
     ChSystemMulticoreNSC* msystem = new ChSystemMulticoreNSC();
 #endif
 
@@ -436,11 +483,7 @@ int main(int argc, char* argv[]) {
     ////msystem->SetLoggingLevel(LOG_TRACE, true);
 
     // Set number of threads.
-    int max_threads = omp_get_num_procs();
-    if (threads > max_threads)
-        threads = max_threads;
-    msystem->SetNumThreads(threads);
-    cout << "Using " << threads << " threads" << endl;
+    msystem->SetNumThreads(num_threads);
 
     // Set gravitational acceleration
     msystem->Set_G_acc(ChVector<>(0, 0, -gravity));
@@ -468,6 +511,122 @@ int main(int argc, char* argv[]) {
 
     msystem->GetSettings()->collision.bins_per_axis = vec3(20, 20, 20);
 
+    return msystem;
+}
+
+// -----------------------------------------------------------------------------
+// Run the sweep of penetrator variants. The settled bed (from the cache or from the
+// checkpoint file) is written once to a binary checkpoint, which all members
+// read (memory-mapped). Each member runs single-threaded until the projectile
+// is at rest, or for at most time_dropping.
+// -----------------------------------------------------------------------------
+int RunSweep(ImpactSweepOptions& options) {
+    {
+        ChSystemMulticore* system = CreateSystem(1);
+        if (!use_bed_cache || !CreateBedCache(system).Load(system)) {
+            if (!filesystem::path(checkpoint_file).exists()) {
+                cout << "Checkpoint file " << checkpoint_file << " not found; run the SETTLING problem first" << endl;
+                delete system;
+                return 1;
+            }
+            utils::ReadCheckpoint(system, checkpoint_file);
+        }
+        WriteSystemCheckpoint(system, sweep_bed_file + ".bin", sweep_bed_file + ".dat");
+        delete system;
+    }
+
+    struct Member {
+        PenetratorGeom geom;
+        double rho;
+        double drop;
+        ImpactResult result;
+    };
+    std::vector<Member> members;
+    for (auto geom : sweep_geom)
+        for (auto rho : sweep_rho)
+            for (auto drop : sweep_h)
+                members.push_back({geom, rho, drop, ImpactResult()});
+
+    int num_members = options.Range((int)members.size());
+    EnsemblePool pool(options.num_workers);
+    cout << "Run sweep members " << options.first << " to " << options.first + num_members - 1 << " (of "
+         << members.size() << ") on " << pool.GetNumWorkers() << " workers" << endl;
+
+    double wall_time = pool.Run(num_members, [&](int i, int) {
+        Member& m = members[options.first + i];
+        std::unique_lock<std::mutex> lock(pool.GetSetupMutex());
+        ChSystemMulticore* system = CreateSystem(1);
+        ReadSystemCheckpoint(system, sweep_bed_file + ".bin", sweep_bed_file + ".dat");
+        auto obj = CreatePenetrator(system, m.geom, m.rho, m.drop);
+        lock.unlock();
+        m.result = RunImpact(system, obj, time_step, sweep_min_time, time_dropping, sweep_stop_speed, sweep_hold_time);
+        delete system;
+    });
+
+    const auto& times = pool.GetMemberTimes();
+    utils::CSV_writer csv(",");
+    csv << "shape"
+        << "rho"
+        << "drop_height"
+        << "depth"
+        << "max_depth"
+        << "time"
+        << "at_rest"
+        << "wall_time" << endl;
+    double sim_time = 0;
+    for (int i = 0; i < num_members; i++) {
+        const Member& m = members[options.first + i];
+        csv << (int)m.geom << m.rho << m.drop << m.result.depth << m.result.max_depth << m.result.time
+            << (int)m.result.stopped << times[i] << endl;
+        sim_time += m.result.time;
+    }
+    std::string sweep_file = out_dir + "/sweep_" + std::to_string(options.first) + ".csv";
+    csv.write_to_file(sweep_file);
+
+    cout << "==================================" << endl;
+    cout << "Sweep members:     " << num_members << endl;
+    cout << "Simulated time:    " << sim_time << " (of " << num_members * time_dropping << " without early stop)"
+         << endl;
+    cout << "Wall-clock time:   " << wall_time << endl;
+    cout << "Results written to " << sweep_file << endl;
+
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+    // Create output directories.
+    if (!filesystem::create_directory(filesystem::path(out_dir))) {
+        cout << "Error creating directory " << out_dir << endl;
+        return 1;
+    }
+    if (!filesystem::create_directory(filesystem::path(pov_dir))) {
+        cout << "Error creating directory " << pov_dir << endl;
+        return 1;
+    }
+
+    // Sweep of penetrator variants in the settled bed
+    ImpactSweepOptions sweep;
+    if (sweep.Parse(argc, argv))
+        return RunSweep(sweep);
+    
+    // Get problem parameters from arguments
+    SetArgumentsForMbdFromInput(argc, argv);
+
+// Create system
+#ifdef USE_SMC
+    cout << "Create SMC system" << endl;
+#else
+    cout << "Create NSC system" << endl;
+#endif
+
+    // Set number of threads.
+    int max_threads = omp_get_num_procs();
+    if (threads > max_threads)
+        threads = max_threads;
+    ChSystemMulticore* msystem = CreateSystem(threads);
+    cout << "Using " << threads << " threads" << endl;
+
     // Depending on problem type:
     // - Select end simulation time
     // - Select output FPS
@@ -477,23 +636,34 @@ int main(int argc, char* argv[]) {
     int out_fps;
     std::shared_ptr<ChBody> obj;
 
+    SettledBedCache bed_cache = CreateBedCache(msystem);
+    bool bed_cached = false;
+
     if (problem == SETTLING) {
         time_end = time_settling_max;
         out_fps = out_fps_settling;
 
-        cout << "Create granular material" << endl;
-        CreateObjects(msystem);
+        if (use_bed_cache && bed_cache.Load(msystem)) {
+            // The settled bed is available: skip the settling simulation
+            bed_cached = true;
+            time_end = 0;
+        } else {
+            cout << "Create granular material" << endl;
+            CreateObjects(msystem);
+        }
     }
 
     if (problem == DROPPING) {
         time_end = time_dropping;
         out_fps = out_fps_dropping;
 
-        // Create the granular material and the container from the checkpoint file.
-        cout << "Read checkpoint data from " << checkpoint_file;
-        utils::ReadCheckpoint(msystem, checkpoint_file);
-        cout << "  done.  Read " << msystem->Get_bodylist().size() << " bodies." << endl;
-        obj = CreatePenetrator(msystem);
+        // Create the granular material and the container from the cache or from the checkpoint file.
+        if (!use_bed_cache || !bed_cache.Load(msystem)) {
+            cout << "Read checkpoint data from " << checkpoint_file;
+            utils::ReadCheckpoint(msystem, checkpoint_file);
+            cout << "  done.  Read " << msystem->Get_bodylist().size() << " bodies." << endl;
+        }
+        obj = CreatePenetrator(msystem, penetGeom, rho_b, h);
     }
 
     // Number of steps
@@ -523,6 +693,7 @@ int main(int argc, char* argv[]) {
     int num_contacts = 0;
     ChStreamOutAsciiFile sfile(stats_file.c_str());
     std::ofstream hfile(height_file.c_str());
+    bool settled = false;
 
 #ifdef CHRONO_OPENGL
     opengl::ChOpenGLWindow& gl_window = opengl::ChOpenGLWindow::getInstance();
@@ -571,6 +742,7 @@ int main(int argc, char* argv[]) {
 
         if (problem == SETTLING && time > time_settling_min && CheckSettled(msystem, zero_v)) {
             cout << "Granular material settled...  time = " << time << endl;
+            settled = true;
             break;
         }
 
@@ -603,6 +775,10 @@ int main(int argc, char* argv[]) {
         cout << "Write checkpoint data to " << checkpoint_file;
         utils::WriteCheckpoint(msystem, checkpoint_file);
         cout << "  done.  Wrote " << msystem->Get_bodylist().size() << " bodies." << endl;
+
+        // Store the settled bed in the cache (unless the simulation was interrupted)
+        if (use_bed_cache && !bed_cached && (settled || time >= time_end))
+            bed_cache.Store(msystem);
     }
 
     // Final stats
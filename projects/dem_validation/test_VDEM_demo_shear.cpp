@@ -48,6 +48,7 @@
 #include "chrono_opengl/ChOpenGLWindow.h"
 #endif
 
+#include "../contact_warm_start.h"
 #include "../utils.h"
 
 using namespace chrono;
@@ -80,6 +81,9 @@ int max_iteration_sliding = 10000;
 int max_iteration_spinning = 0;
 int max_iteration_bilateral = 100;
 double contact_recovery_speed = 10e30;
+
+// Warm start the contact solver with the impulses of the previous step (see contact_warm_start.h)
+bool warm_start = true;
 #endif
 
 bool clamp_bilaterals = false;
@@ -246,6 +250,9 @@ int main(int argc, char* argv[]) {
     my_system->GetSettings()->solver.contact_recovery_speed = contact_recovery_speed;
     my_system->ChangeSolverType(SolverType::APGD);
 
+    ContactWarmStart* solver_warm_start = EnableContactWarmStart(my_system);
+    solver_warm_start->SetEnabled(warm_start);
+
     my_system->GetSettings()->collision.collision_envelope = 0.05 * radius;
 #endif
 
@@ -488,6 +495,10 @@ int main(int argc, char* argv[]) {
             cout << my_system->GetChTime() << "\t" << plate->GetPos().y() - bin->GetPos().y() << "\t" << bin->GetPos().x()
                  << "\t" << bin->GetPos().y() << "\t" << bin->GetPos().z() << "\t" << force.x << "\t" << force.y << "\t"
                  << force.z << "\n";
+#ifndef USE_SMC
+            cout << "Solver iterations: " << solver_warm_start->GetStepIterations()
+                 << "  (warm started contacts: " << solver_warm_start->GetNumWarmStarted() << ")\n";
+#endif
 
             //  Output to shear data file
 
@@ -515,5 +526,10 @@ int main(int argc, char* argv[]) {
         }
     }
 
+#ifndef USE_SMC
+    cout << "Average solver iterations per step: " << solver_warm_start->GetAverageIterations() << " (warm start "
+         << (warm_start ? "on" : "off") << ")" << endl;
+#endif
+
     return 0;
 }
@@ -51,6 +51,11 @@
 #endif
 
 #include "../utils.h"
+#include "../bulk_particles.h"
+#include "../frame_exporter.h"
+#include "../granular_queries.h"
+#include "../settled_bed_cache.h"
+#include "../timing_recorder.h"
 
 using namespace chrono;
 using namespace chrono::collision;
@@ -91,6 +96,13 @@ bool use_actuator = true;
 // Save PovRay post-processing data?
 bool write_povray_data = true;
 
+// Write the PovRay data as binary frames, asynchronously (convert with test_MCORE_frame_convert)?
+bool binary_frames = false;
+bool compress_frames = false;
+
+// Reuse settled granular beds from the shared cache
+bool use_bed_cache = true;
+
 // Simulation times
 double time_settling_min = 0.1;
 double time_settling_max = 1.0;
@@ -140,6 +152,8 @@ const std::string shear_file = out_dir + "/shear.dat";
 const std::string stats_file = out_dir + "/stats.dat";
 const std::string settled_ckpnt_file = out_dir + "/settled.dat";
 const std::string pressed_ckpnt_file = out_dir + "/pressed.dat";
+const std::string settled_binary_file = out_dir + "/settled.bin";
+const std::string pressed_binary_file = out_dir + "/pressed.bin";
 
 // Frequency for visualization output
 int out_fps_settling = 120;
@@ -370,37 +384,71 @@ int CreateGranularMaterial(ChSystemMulticore* system) {
     mat_g->SetFriction(mu_g);
 #endif
 
-    // ---------------------------------------------
-    // Create a mixture entirely made out of spheres
-    // ---------------------------------------------
+    // ------------------------------
+    // Sample the particle locations
+    // ------------------------------
 
-    // Create the particle generator with a mixture of 100% spheres
+    // Poisson Disk sampling, one layer at a time
     double r = 1.01 * r_g;
     utils::PDSampler<double> sampler(2 * r);
-    utils::Generator gen(system);
-
-    std::shared_ptr<utils::MixtureIngredient> m1 = gen.AddMixtureIngredient(utils::MixtureType::SPHERE, 1.0);
-    m1->setDefaultMaterial(mat_g);
-    m1->setDefaultDensity(rho_g);
-    m1->setDefaultSize(r_g);
-
-    // Ensure that all generated particle bodies will have positive IDs.
-    gen.setBodyIdentifier(Id_g);
-
-    // ----------------------
-    // Generate the particles
-    // ----------------------
 
     ChVector<> hdims(hdimX - r, hdimY - r, 0);
     ChVector<> center(0, 0, 2 * r);
 
+    std::vector<ChVector<>> points;
     while (center.z() < 2 * h_scaling * hdimZ) {
-        gen.CreateObjectsBox(sampler, center, hdims);
+        auto layer = sampler.SampleBox(center, hdims);
+        points.insert(points.end(), layer.begin(), layer.end());
         center.z() += 2 * r;
     }
 
+    // ----------------------
+    // Generate the particles
+    // ----------------------
+
+    // Insert all spheres at once, with positive IDs (starting at Id_g).
     // Return the number of generated particles.
-    return gen.getTotalNumBodies();
+    return AddSpheres(system, mat_g, points, r_g, rho_g, Id_g);
+}
+
+// =============================================================================
+// Create the cache key for the settled granular bed, from all parameters which
+// affect the settled state (granular material, mechanism bodies, settling).
+// =============================================================================
+
+SettledBedCache CreateBedCache(ChSystemMulticore* system) {
+    SettledBedCache cache("directShear");
+#ifdef USE_SMC
+    cache.Add("contact_method", "SMC");
+    cache.AddContactSettings(system);
+#else
+    cache.Add("contact_method", "NSC");
+    cache.Add("max_iteration_sliding", max_iteration_sliding);
+    cache.Add("contact_recovery_speed", contact_recovery_speed);
+#endif
+    cache.Add("time_step", time_step);
+    cache.Add("max_iteration_bilateral", max_iteration_bilateral);
+    cache.Add("tolerance", tolerance);
+    cache.Add("gravity", gravity);
+    cache.Add("time_settling_min", time_settling_min);
+    cache.Add("time_settling_max", time_settling_max);
+    cache.Add("settling_tol", settling_tol);
+    cache.Add("r_g", r_g);
+    cache.Add("rho_g", rho_g);
+    cache.Add("Y_g", Y_g);
+    cache.Add("cr_g", cr_g);
+    cache.Add("nu_g", nu_g);
+    cache.Add("mu_g", mu_g);
+    cache.Add("bin_dims", ChVector<>(hdimX, hdimY, hdimZ));
+    cache.Add("hthick", hthick);
+    cache.Add("h_scaling", h_scaling);
+    cache.Add("Y_walls", Y_walls);
+    cache.Add("cr_walls", cr_walls);
+    cache.Add("nu_walls", nu_walls);
+    cache.Add("mu_walls", mu_walls);
+    cache.Add("time_shearing", time_shearing);
+    cache.Add("desiredVelocity", desiredVelocity);
+    return cache;
 }
 
 // =============================================================================
@@ -447,18 +495,10 @@ void CreateBall(ChSystemMulticore* system) {
 // look at bodies whith positive identifiers (to exclude all other bodies).
 // =============================================================================
 
+GranularQueries granular_queries([](const ChBody& body) { return body.GetIdentifier() > 0; });
+
 void FindHeightRange(ChSystemMulticore* sys, double& lowest, double& highest) {
-    highest = -1000;
-    lowest = 1000;
-    for (auto body : sys->Get_bodylist()) {
-        if (body->GetIdentifier() <= 0)
-            continue;
-        double h = body->GetPos().z();
-        if (h < lowest)
-            lowest = h;
-        else if (h > highest)
-            highest = h;
-    }
+    granular_queries.GetHeightRange(sys, lowest, highest);
 }
 
 // =============================================================================
@@ -480,6 +520,7 @@ void setBulkDensity(ChSystem* sys, double bulkDensity) {
             body->SetMass(reqDensity * vol_g);
         }
     }
+    granular_queries.Refresh();
 
     cout << "N Bodies: " << sys->Get_bodylist().size() << endl;
     cout << "Box Volume: " << boxVolume << endl;
@@ -566,24 +607,33 @@ int main(int argc, char* argv[]) {
     std::shared_ptr<ChLinkLockPrismatic> prismatic_plate_ground;
     std::shared_ptr<ChLinkLinActuator> actuator;
 
+    SettledBedCache bed_cache = CreateBedCache(msystem);
+    bool bed_cached = false;
+
     switch (problem) {
         case SETTLING: {
             time_min = time_settling_min;
             time_end = time_settling_max;
             out_fps = out_fps_settling;
 
-            // Create the mechanism bodies (all fixed).
-            CreateMechanismBodies(msystem);
+            if (use_bed_cache && bed_cache.Load(msystem)) {
+                // The settled bed is available: skip the settling simulation
+                bed_cached = true;
+                time_end = 0;
+            } else {
+                // Create the mechanism bodies (all fixed).
+                CreateMechanismBodies(msystem);
+
+                // Create granular material.
+                int num_particles = CreateGranularMaterial(msystem);
+                cout << "Granular material:  " << num_particles << " particles" << endl;
+            }
 
             // Grab handles to mechanism bodies (must increase ref counts)
             ground = msystem->Get_bodylist().at(0);
             shearBox = msystem->Get_bodylist().at(1);
             loadPlate = msystem->Get_bodylist().at(2);
 
-            // Create granular material.
-            int num_particles = CreateGranularMaterial(msystem);
-            cout << "Granular material:  " << num_particles << " particles" << endl;
-
             break;
         }
 
@@ -592,10 +642,12 @@ int main(int argc, char* argv[]) {
             time_end = time_pressing_max;
             out_fps = out_fps_pressing;
 
-            // Create bodies from checkpoint file.
-            cout << "Read checkpoint data from " << settled_ckpnt_file;
-            utils::ReadCheckpoint(msystem, settled_ckpnt_file);
-            cout << "  done.  Read " << msystem->Get_bodylist().size() << " bodies." << endl;
+            // Create bodies from the cache or from the checkpoint file.
+            if (!use_bed_cache || !bed_cache.Load(msystem)) {
+                cout << "Read checkpoint data from " << settled_binary_file;
+                ReadSystemCheckpoint(msystem, settled_binary_file, settled_ckpnt_file);
+                cout << "  done.  Read " << msystem->Get_bodylist().size() << " bodies." << endl;
+            }
 
             // Grab handles to mechanism bodies (must increase ref counts)
             ground = msystem->Get_bodylist().at(0);
@@ -629,8 +681,8 @@ int main(int argc, char* argv[]) {
             out_fps = out_fps_shearing;
 
             // Create bodies from checkpoint file.
-            cout << "Read checkpoint data from " << pressed_ckpnt_file;
-            utils::ReadCheckpoint(msystem, pressed_ckpnt_file);
+            cout << "Read checkpoint data from " << pressed_binary_file;
+            ReadSystemCheckpoint(msystem, pressed_binary_file, pressed_ckpnt_file);
             cout << "  done.  Read " << msystem->Get_bodylist().size() << " bodies." << endl;
 
             // Grab handles to mechanism bodies (must increase ref counts)
@@ -731,6 +783,7 @@ int main(int argc, char* argv[]) {
     double exec_time = 0;
     int num_contacts = 0;
     double max_cnstr_viol[3] = {0, 0, 0};
+    bool settled = false;
 
     // Circular buffer with highest particle location
     // (only used for SETTLING or PRESSING)
@@ -743,6 +796,12 @@ int main(int argc, char* argv[]) {
 
     shearStream.SetNumFormat("%16.4e");
 
+    // Per-step timers (convert to CSV with test_MCORE_timing_csv)
+    TimingRecorder timing(out_dir + "/timing.bin");
+
+    // Binary frame output (written on a background thread)
+    FrameExporter frame_exporter(compress_frames);
+
 #ifdef CHRONO_OPENGL
     opengl::ChOpenGLWindow& gl_window = opengl::ChOpenGLWindow::getInstance();
     gl_window.Initialize(1280, 720, "Direct Shear Test", msystem);
@@ -769,22 +828,31 @@ int main(int argc, char* argv[]) {
             cout << "                       vel:    " << vel_old.x() << endl;
             cout << "             Particle lowest:  " << lowest << endl;
             cout << "                      highest: " << highest << endl;
+            cout << "             Bulk density:     "
+                 << granular_queries.GetBulkDensity(msystem, ChVector<>(-hdimX, -hdimY, 0),
+                                                    ChVector<>(hdimX, hdimY, highest + r_g))
+                 << endl;
             cout << "             Execution time:   " << exec_time << endl;
 
             // Save PovRay post-processing data.
             if (write_povray_data) {
                 char filename[100];
-                sprintf(filename, "%s/data_%03d.dat", pov_dir.c_str(), out_frame + 1);
-                utils::WriteShapesPovray(msystem, filename, false);
+                if (binary_frames) {
+                    sprintf(filename, "%s/data_%03d.bin", pov_dir.c_str(), out_frame + 1);
+                    frame_exporter.Write(msystem, filename);
+                } else {
+                    sprintf(filename, "%s/data_%03d.dat", pov_dir.c_str(), out_frame + 1);
+                    utils::WriteShapesPovray(msystem, filename, false);
+                }
             }
 
             // Create a checkpoint from the current state.
             if (problem == SETTLING || problem == PRESSING) {
                 cout << "             Write checkpoint data " << flush;
                 if (problem == SETTLING)
-                    utils::WriteCheckpoint(msystem, settled_ckpnt_file);
+                    WriteSystemCheckpoint(msystem, settled_binary_file, settled_ckpnt_file);
                 else
-                    utils::WriteCheckpoint(msystem, pressed_ckpnt_file);
+                    WriteSystemCheckpoint(msystem, pressed_binary_file, pressed_ckpnt_file);
                 cout << msystem->Get_bodylist().size() << " bodies" << endl;
             }
 
@@ -808,6 +876,7 @@ int main(int argc, char* argv[]) {
                 // specified fraction of a particle radius
                 if (var < settling_tol * r_g) {
                     cout << "Granular material settled...  time = " << time << endl;
+                    settled = true;
                     break;
                 }
             }
@@ -825,7 +894,7 @@ int main(int argc, char* argv[]) {
 #endif
 
         ////progressbar(out_steps + sim_frame - next_out_frame + 1, out_steps);
-        TimingOutput(msystem);
+        timing.Record(msystem);
 
         // Record stats about the simulation
         if (sim_frame % write_steps == 0) {
@@ -915,12 +984,16 @@ int main(int argc, char* argv[]) {
     if (problem == SETTLING || problem == PRESSING) {
         cout << "             Write checkpoint data " << flush;
         if (problem == SETTLING)
-            utils::WriteCheckpoint(msystem, settled_ckpnt_file);
+            WriteSystemCheckpoint(msystem, settled_binary_file, settled_ckpnt_file);
         else
-            utils::WriteCheckpoint(msystem, pressed_ckpnt_file);
+            WriteSystemCheckpoint(msystem, pressed_binary_file, pressed_ckpnt_file);
         cout << msystem->Get_bodylist().size() << " bodies" << endl;
     }
 
+    // Store the settled bed in the cache (unless the simulation was interrupted)
+    if (problem == SETTLING && use_bed_cache && !bed_cached && (settled || time >= time_end))
+        bed_cache.Store(msystem);
+
     // Final stats
     cout << "==================================" << endl;
     cout << "Number of bodies:  " << msystem->Get_bodylist().size() << endl;
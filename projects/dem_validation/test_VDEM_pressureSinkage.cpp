@@ -48,6 +48,10 @@
 #endif
 
 #include "../utils.h"
+#include "../frame_exporter.h"
+#include "../granular_queries.h"
+#include "../settled_bed_cache.h"
+#include "../timing_recorder.h"
 
 using namespace chrono;
 using namespace chrono::collision;
@@ -88,6 +92,13 @@ bool use_actuator = true;
 // Save PovRay post-processing data?
 bool write_povray_data = true;
 
+// Write the PovRay data as binary frames, asynchronously (convert with test_MCORE_frame_convert)?
+bool binary_frames = true;
+bool compress_frames = false;
+
+// Reuse settled granular beds from the shared cache
+bool use_bed_cache = true;
+
 // Simulation times
 double time_settling_min = 0.1;
 double time_settling_max = 1.0;
@@ -328,6 +339,41 @@ int CreateGranularMaterial(ChSystemMulticore* system) {
     return gen.getTotalNumBodies();
 }
 
+// =============================================================================
+// Create the cache key for the settled granular bed, from all parameters which
+// affect the settled state (granular material, mechanism bodies, settling).
+// =============================================================================
+
+SettledBedCache CreateBedCache(ChSystemMulticore* system) {
+    SettledBedCache cache("pressureSinkage");
+#ifdef USE_SMC
+    cache.Add("contact_method", "SMC");
+    cache.AddContactSettings(system);
+#else
+    cache.Add("contact_method", "NSC");
+    cache.Add("max_iteration_sliding", max_iteration_sliding);
+    cache.Add("contact_recovery_speed", contact_recovery_speed);
+#endif
+    cache.Add("time_step", time_step);
+    cache.Add("max_iteration_bilateral", max_iteration_bilateral);
+    cache.Add("tolerance", tolerance);
+    cache.Add("gravity", gravity);
+    cache.Add("time_settling_min", time_settling_min);
+    cache.Add("time_settling_max", time_settling_max);
+    cache.Add("settling_tol", settling_tol);
+    cache.Add("r_g", r_g);
+    cache.Add("rho_g", rho_g);
+    cache.Add("Y_g", Y_g);
+    cache.Add("cr_g", cr_g);
+    cache.Add("mu_g", mu_g);
+    cache.Add("bin_dims", ChVector<>(hdimX, hdimY, hdimZ));
+    cache.Add("hthick", hthick);
+    cache.Add("Y_walls", Y_walls);
+    cache.Add("cr_walls", cr_walls);
+    cache.Add("mu_walls", mu_walls);
+    return cache;
+}
+
 // =============================================================================
 // Create a single large sphere (for use in TESTING)
 // =============================================================================
@@ -371,21 +417,10 @@ void CreateBall(ChSystemMulticore* system) {
 // look at bodies whith positive identifiers (to exclude all other bodies).
 // =============================================================================
 
+GranularQueries granular_queries([](const ChBody& body) { return body.GetIdentifier() > 0; });
+
 void FindHeightRange(ChSystemMulticore* sys, double& lowest, double& highest) {
-    highest = -1000;
-    lowest = 1000;
-    for (auto body : sys->Get_bodylist()) {
-        if (body->GetIdentifier() <= 0)
-            continue;
-
-        if (fabs(body->GetPos().x()) <= hdimX_p && fabs(body->GetPos().y()) <= hdimY_p) {
-            double h = body->GetPos().z();
-            if (h < lowest)
-                lowest = h;
-            else if (h > highest)
-                highest = h;
-        }
-    }
+    granular_queries.GetHeightRange(sys, lowest, highest, -hdimX_p, hdimX_p, -hdimY_p, hdimY_p);
 }
 
 // =============================================================================
@@ -407,6 +442,7 @@ void setBulkDensity(ChSystem* sys, double bulkDensity) {
             body->SetMass(reqDensity * vol_g);
         }
     }
+    granular_queries.Refresh();
 
     cout << "N Bodies: " << sys->Get_bodylist().size() << endl;
     cout << "Box Volume: " << boxVolume << endl;
@@ -501,23 +537,32 @@ int main(int argc, char* argv[]) {
     std::shared_ptr<ChLinkLockPrismatic> prismatic;
     std::shared_ptr<ChLinkLinActuator> actuator;
 
+    SettledBedCache bed_cache = CreateBedCache(msystem);
+    bool bed_cached = false;
+
     switch (problem) {
         case SETTLING: {
             time_min = time_settling_min;
             time_end = time_settling_max;
             out_fps = out_fps_settling;
 
-            // Create the mechanism bodies (all fixed).
-            CreateMechanismBodies(msystem);
+            if (use_bed_cache && bed_cache.Load(msystem)) {
+                // The settled bed is available: skip the settling simulation
+                bed_cached = true;
+                time_end = 0;
+            } else {
+                // Create the mechanism bodies (all fixed).
+                CreateMechanismBodies(msystem);
+
+                // Create granular material.
+                int num_particles = CreateGranularMaterial(msystem);
+                cout << "Granular material:  " << num_particles << " particles" << endl;
+            }
 
             // Grab handles to mechanism bodies (must increase ref counts)
             ground = msystem->Get_bodylist().at(0);
             loadPlate = msystem->Get_bodylist().at(1);
 
-            // Create granular material.
-            int num_particles = CreateGranularMaterial(msystem);
-            cout << "Granular material:  " << num_particles << " particles" << endl;
-
             break;
         }
 
@@ -526,10 +571,12 @@ int main(int argc, char* argv[]) {
             time_end = time_pressing_max;
             out_fps = out_fps_pressing;
 
-            // Create bodies from checkpoint file.
-            cout << "Read checkpoint data from " << settled_ckpnt_file;
-            utils::ReadCheckpoint(msystem, settled_ckpnt_file);
-            cout << "  done.  Read " << msystem->Get_bodylist().size() << " bodies." << endl;
+            // Create bodies from the cache or from the checkpoint file.
+            if (!use_bed_cache || !bed_cache.Load(msystem)) {
+                cout << "Read checkpoint data from " << settled_ckpnt_file;
+                utils::ReadCheckpoint(msystem, settled_ckpnt_file);
+                cout << "  done.  Read " << msystem->Get_bodylist().size() << " bodies." << endl;
+            }
 
             // Grab handles to mechanism bodies (must increase ref counts)
             ground = msystem->Get_bodylist().at(0);
@@ -619,6 +666,7 @@ int main(int argc, char* argv[]) {
     double exec_time = 0;
     int num_contacts = 0;
     double max_cnstr_viol[2] = {0, 0};
+    bool settled = false;
 
     // Circular buffer with highest particle location
     // (only used for SETTLING or PRESSING)
@@ -630,6 +678,12 @@ int main(int argc, char* argv[]) {
     ChStreamOutAsciiFile sinkageStream(sinkage_file.c_str());
     sinkageStream.SetNumFormat("%16.4e");
 
+    // Per-step timers (convert to CSV with test_MCORE_timing_csv)
+    TimingRecorder timing(out_dir + "/timing.bin");
+
+    // Binary frame output (written on a background thread)
+    FrameExporter frame_exporter(compress_frames);
+
 #ifdef CHRONO_OPENGL
     opengl::ChOpenGLWindow& gl_window = opengl::ChOpenGLWindow::getInstance();
     gl_window.Initialize(1280, 720, "Pressure Sinkage Test", msystem);
@@ -660,8 +714,13 @@ int main(int argc, char* argv[]) {
             // Save PovRay post-processing data.
             if (write_povray_data) {
                 char filename[100];
-                sprintf(filename, "%s/data_%03d.dat", pov_dir.c_str(), out_frame + 1);
-                utils::WriteShapesPovray(msystem, filename, false);
+                if (binary_frames) {
+                    sprintf(filename, "%s/data_%03d.bin", pov_dir.c_str(), out_frame + 1);
+                    frame_exporter.Write(msystem, filename);
+                } else {
+                    sprintf(filename, "%s/data_%03d.dat", pov_dir.c_str(), out_frame + 1);
+                    utils::WriteShapesPovray(msystem, filename, false);
+                }
             }
 
             // Create a checkpoint from the current state.
@@ -694,6 +753,7 @@ int main(int argc, char* argv[]) {
                 // specified fraction of a particle radius
                 if (var < settling_tol * r_g) {
                     cout << "Granular material settled...  time = " << time << endl;
+                    settled = true;
                     break;
                 }
             }
@@ -710,7 +770,7 @@ int main(int argc, char* argv[]) {
         msystem->DoStepDynamics(time_step);
 #endif
 
-        TimingOutput(msystem);
+        timing.Record(msystem);
 
         // Record stats about the simulation
         if (sim_frame % write_steps == 0) {
@@ -782,6 +842,10 @@ int main(int argc, char* argv[]) {
         cout << msystem->Get_bodylist().size() << " bodies" << endl;
     }
 
+    // Store the settled bed in the cache (unless the simulation was interrupted)
+    if (problem == SETTLING && use_bed_cache && !bed_cached && (settled || time >= time_end))
+        bed_cache.Store(msystem);
+
     // Final stats
     cout << "==================================" << endl;
     cout << "Number of bodies:  " << msystem->Get_bodylist().size() << endl;
@@ -52,6 +52,11 @@
 #include "chrono_opengl/ChOpenGLWindow.h"
 #endif
 
+#include "../bulk_particles.h"
+#include "../frame_exporter.h"
+#include "../granular_queries.h"
+#include "../settled_bed_cache.h"
+
 using namespace chrono;
 using namespace chrono::collision;
 
@@ -96,6 +101,13 @@ int threads = 20;
 // Save PovRay post-processing data?
 bool write_povray_data = true;
 
+// Write the PovRay data as binary frames, asynchronously (convert with test_MCORE_frame_convert)?
+bool binary_frames = false;
+bool compress_frames = false;
+
+// Reuse settled granular beds from the shared cache
+bool use_bed_cache = true;
+
 // Simulation times
 double time_settling_min = 0.1;
 double time_settling_max = 1.0;
@@ -374,37 +386,67 @@ int CreateGranularMaterial(ChSystemMulticore* system) {
     mat_g->SetFriction(mu_g);
 #endif
 
-    // ---------------------------------------------
-    // Create a mixture entirely made out of spheres
-    // ---------------------------------------------
+    // ------------------------------
+    // Sample the particle locations
+    // ------------------------------
 
-    // Create the particle generator with a mixture of 100% spheres
+    // Poisson Disk sampling, one layer at a time
     double r = 1.01 * r_g;
     utils::PDSampler<double> sampler(2 * r);
-    utils::Generator gen(system);
-
-    std::shared_ptr<utils::MixtureIngredient> m1 = gen.AddMixtureIngredient(utils::MixtureType::SPHERE, 1.0);
-    m1->setDefaultMaterial(mat_g);
-    m1->setDefaultDensity(rho_g);
-    m1->setDefaultSize(r_g);
-
-    // Ensure that all generated particle bodies will have positive IDs.
-    gen.setBodyIdentifier(Id_g);
-
-    // ----------------------
-    // Generate the particles
-    // ----------------------
 
     ChVector<> hdims(hdimX - r, hdimY - r, 0);
     ChVector<> center(0, 0, 2 * r);
 
+    std::vector<ChVector<>> points;
     while (center.z() < 2 * hdimZ) {
-        gen.CreateObjectsBox(sampler, center, hdims);
+        auto layer = sampler.SampleBox(center, hdims);
+        points.insert(points.end(), layer.begin(), layer.end());
         center.z() += 2 * r;
     }
 
+    // ----------------------
+    // Generate the particles
+    // ----------------------
+
+    // Insert all spheres at once, with positive IDs (starting at Id_g).
     // Return the number of generated particles.
-    return gen.getTotalNumBodies();
+    return AddSpheres(system, mat_g, points, r_g, rho_g, Id_g);
+}
+
+// =============================================================================
+// Create the cache key for the settled granular bed, from all parameters which
+// affect the settled state (granular material, mechanism bodies, settling).
+// =============================================================================
+
+SettledBedCache CreateBedCache(ChSystemMulticore* system) {
+    SettledBedCache cache("singleWheel");
+#ifdef USE_SMC
+    cache.Add("contact_method", "SMC");
+    cache.AddContactSettings(system);
+#else
+    cache.Add("contact_method", "NSC");
+    cache.Add("max_iteration_sliding", max_iteration_sliding);
+    cache.Add("contact_recovery_speed", contact_recovery_speed);
+#endif
+    cache.Add("time_step", time_step);
+    cache.Add("max_iteration_bilateral", max_iteration_bilateral);
+    cache.Add("tolerance", tolerance);
+    cache.Add("gravity", gravity);
+    cache.Add("time_settling_min", time_settling_min);
+    cache.Add("time_settling_max", time_settling_max);
+    cache.Add("settling_tol", settling_tol);
+    cache.Add("r_g", r_g);
+    cache.Add("rho_g", rho_g);
+    cache.Add("Y_g", Y_g);
+    cache.Add("mu_g", mu_g);
+    cache.Add("bin_dims", ChVector<>(hdimX, hdimY, hdimZ));
+    cache.Add("hthick", hthick);
+    cache.Add("Y_walls", Y_walls);
+    cache.Add("mu_walls", mu_walls);
+    cache.Add("wheelRadius", wheelRadius);
+    cache.Add("wheelWidth", wheelWidth);
+    cache.Add("wheelWeight", wheelWeight);
+    return cache;
 }
 
 // =============================================================================
@@ -449,18 +491,10 @@ void CreateBall(ChSystemMulticore* system) {
 // look at bodies with positive identifiers (to exclude all other bodies).
 // =============================================================================
 
+GranularQueries granular_queries([](const ChBody& body) { return body.GetIdentifier() > 0; });
+
 void FindHeightRange(ChSystemMulticore* sys, double& lowest, double& highest) {
-    highest = -1000;
-    lowest = 1000;
-    for (auto body : sys->Get_bodylist()) {
-        if (body->GetIdentifier() <= 0)
-            continue;
-        double h = body->GetPos().z();
-        if (h < lowest)
-            lowest = h;
-        else if (h > highest)
-            highest = h;
-    }
+    granular_queries.GetHeightRange(sys, lowest, highest);
 }
 
 // =============================================================================
@@ -482,6 +516,7 @@ void setBulkDensity(ChSystem* sys, double bulkDensity) {
             body->SetMass(reqDensity * vol_g);
         }
     }
+    granular_queries.Refresh();
 
     cout << "N Bodies: " << sys->Get_bodylist().size() << endl;
     cout << "Box Volume: " << boxVolume << endl;
@@ -567,14 +602,27 @@ int main(int argc, char* argv[]) {
     std::shared_ptr<ChLinkLinActuator> actuator;
     std::shared_ptr<ChLinkMotorRotationAngle> engine_wheel_axle;
 
+    SettledBedCache bed_cache = CreateBedCache(msystem);
+    bool bed_cached = false;
+
     switch (problem) {
         case SETTLING: {
             time_min = time_settling_min;
             time_end = time_settling_max;
             out_fps = out_fps_settling;
 
-            // Create the mechanism bodies (all fixed).
-            CreateMechanismBodies(msystem);
+            if (use_bed_cache && bed_cache.Load(msystem)) {
+                // The settled bed is available: skip the settling simulation
+                bed_cached = true;
+                time_end = 0;
+            } else {
+                // Create the mechanism bodies (all fixed).
+                CreateMechanismBodies(msystem);
+
+                // Create granular material.
+                int num_particles = CreateGranularMaterial(msystem);
+                cout << "Granular material:  " << num_particles << " particles" << endl;
+            }
 
             // Grab handles to mechanism bodies (must increase ref counts)
             ground = msystem->Get_bodylist().at(0);
@@ -582,10 +630,6 @@ int main(int argc, char* argv[]) {
             chassis = msystem->Get_bodylist().at(2);
             axle = msystem->Get_bodylist().at(3);
 
-            // Create granular material.
-            int num_particles = CreateGranularMaterial(msystem);
-            cout << "Granular material:  " << num_particles << " particles" << endl;
-
             break;
         }
 
@@ -594,10 +638,12 @@ int main(int argc, char* argv[]) {
             time_end = time_pressing_max;
             out_fps = out_fps_pressing;
 
-            // Create bodies from checkpoint file.
-            cout << "Read checkpoint data from " << settled_ckpnt_file;
-            utils::ReadCheckpoint(msystem, settled_ckpnt_file);
-            cout << "  done.  Read " << msystem->Get_bodylist().size() << " bodies." << endl;
+            // Create bodies from the cache or from the checkpoint file.
+            if (!use_bed_cache || !bed_cache.Load(msystem)) {
+                cout << "Read checkpoint data from " << settled_ckpnt_file;
+                utils::ReadCheckpoint(msystem, settled_ckpnt_file);
+                cout << "  done.  Read " << msystem->Get_bodylist().size() << " bodies." << endl;
+            }
 
             // Grab handles to mechanism bodies (must increase ref counts)
             ground = msystem->Get_bodylist().at(0);
@@ -748,6 +794,7 @@ int main(int argc, char* argv[]) {
     double exec_time = 0;
     int num_contacts = 0;
     double max_cnstr_viol[3] = {0, 0, 0};
+    bool settled = false;
 
     // Circular buffer with highest particle location
     // (only used for SETTLING or PRESSING)
@@ -768,6 +815,9 @@ int main(int argc, char* argv[]) {
     gl_window.SetRenderMode(opengl::WIREFRAME);
 #endif
 
+    // Binary frame output (written on a background thread)
+    FrameExporter frame_exporter(compress_frames);
+
     // Loop until reaching the end time...
     while (time < time_end) {
         // Current position and velocity of the wheel
@@ -792,8 +842,13 @@ int main(int argc, char* argv[]) {
             // Save PovRay post-processing data.
             if (write_povray_data) {
                 char filename[100];
-                sprintf(filename, "%s/data_%03d.dat", pov_dir.c_str(), out_frame + 1);
-                utils::WriteShapesPovray(msystem, filename, false);
+                if (binary_frames) {
+                    sprintf(filename, "%s/data_%03d.bin", pov_dir.c_str(), out_frame + 1);
+                    frame_exporter.Write(msystem, filename);
+                } else {
+                    sprintf(filename, "%s/data_%03d.dat", pov_dir.c_str(), out_frame + 1);
+                    utils::WriteShapesPovray(msystem, filename, false);
+                }
             }
 
             // Create a checkpoint from the current state.
@@ -826,6 +881,7 @@ int main(int argc, char* argv[]) {
                 // specified fraction of a particle radius
                 if (var < settling_tol * r_g) {
                     cout << "Granular material settled...  time = " << time << endl;
+                    settled = true;
                     break;
                 }
             }
@@ -917,6 +973,10 @@ int main(int argc, char* argv[]) {
         cout << msystem->Get_bodylist().size() << " bodies" << endl;
     }
 
+    // Store the settled bed in the cache (unless the simulation was interrupted)
+    if (problem == SETTLING && use_bed_cache && !bed_cached && (settled || time >= time_end))
+        bed_cache.Store(msystem);
+
     // Final stats
     cout << "==================================" << endl;
     cout << "Number of bodies:  " << msystem->Get_bodylist().size() << endl;
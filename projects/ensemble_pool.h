@@ -0,0 +1,159 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Work-stealing task pool for ensembles of independent small simulations run
+// in a single process (e.g., parameter sweeps over a shared settled bed).
+//
+// EnsemblePool::Run executes task(i, worker) for all members i of the
+// ensemble on a fixed number of worker threads. The members are distributed
+// round-robin over per-worker queues; a worker takes its next member from the
+// back of its own queue and, once its queue is empty, steals from the front of
+// the other queues, so that members of very different cost still keep all
+// workers busy. Each worker runs with a single OpenMP thread (the task should
+// also call ChSystemMulticore::SetNumThreads(1) on its own system), since the
+// throughput of many single-threaded small systems is usually much higher than
+// that of the same systems run one after the other with all threads.
+//
+// Creating Chrono systems, bodies, and collision models is not guaranteed to
+// be thread-safe (see bulk_particles.h), so tasks build their system while
+// holding the lock returned by GetSetupMutex() and only step it concurrently
+// with the other members.
+//
+// An exception thrown by a task is reported after all workers have finished
+// (the remaining members are still run).
+//
+// =============================================================================
+
+#ifndef ENSEMBLE_POOL_H
+#define ENSEMBLE_POOL_H
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+class EnsemblePool {
+  public:
+    /// Create a pool with the given number of workers (by default, one per hardware thread).
+    EnsemblePool(int num_workers = 0) : m_num_workers(num_workers) {
+        if (m_num_workers <= 0)
+            m_num_workers = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+
+    /// Return the number of workers.
+    int GetNumWorkers() const { return m_num_workers; }
+
+    /// Run task(member, worker) for all members of an ensemble of given size. Return the wall-clock time (s).
+    double Run(int num_members, const std::function<void(int, int)>& task) {
+        m_queues = std::vector<Queue>(m_num_workers);
+        for (int i = 0; i < num_members; i++)
+            m_queues[i % m_num_workers].members.push_back(i);
+        m_member_time.assign(num_members, 0.0);
+        m_member_worker.assign(num_members, -1);
+        m_num_stolen = 0;
+        m_error = nullptr;
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (int w = 0; w < m_num_workers; w++)
+            workers.emplace_back(&EnsemblePool::Work, this, w, std::cref(task));
+        for (auto& worker : workers)
+            worker.join();
+        double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (m_error)
+            std::rethrow_exception(m_error);
+        return wall_time;
+    }
+
+    /// Return the wall-clock time (s) of each member in the last run.
+    const std::vector<double>& GetMemberTimes() const { return m_member_time; }
+
+    /// Return the worker which ran each member in the last run.
+    const std::vector<int>& GetMemberWorkers() const { return m_member_worker; }
+
+    /// Return the number of members stolen from another worker's queue in the last run.
+    int GetNumStolen() const { return m_num_stolen; }
+
+    /// Return the mutex serializing the construction of the members' systems.
+    std::mutex& GetSetupMutex() { return m_setup_mutex; }
+
+  private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<int> members;
+    };
+
+    // Take the next member for the given worker; return false if there is no member left in any queue.
+    bool Next(int worker, int& member) {
+        {
+            Queue& own = m_queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.members.empty()) {
+                member = own.members.back();
+                own.members.pop_back();
+                return true;
+            }
+        }
+        for (int k = 1; k < m_num_workers; k++) {
+            Queue& victim = m_queues[(worker + k) % m_num_workers];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.members.empty()) {
+                member = victim.members.front();
+                victim.members.pop_front();
+                std::lock_guard<std::mutex> stats_lock(m_stats_mutex);
+                m_num_stolen++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Work(int worker, const std::function<void(int, int)>& task) {
+#ifdef _OPENMP
+        omp_set_num_threads(1);
+#endif
+        int member;
+        while (Next(worker, member)) {
+            auto start = std::chrono::steady_clock::now();
+            try {
+                task(member, worker);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(m_stats_mutex);
+                if (!m_error)
+                    m_error = std::current_exception();
+            }
+            // Each member is run by exactly one worker, so its entries are not shared
+            m_member_time[member] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            m_member_worker[member] = worker;
+        }
+    }
+
+    int m_num_workers;
+    std::vector<Queue> m_queues;
+    std::vector<double> m_member_time;
+    std::vector<int> m_member_worker;
+    int m_num_stolen;
+    std::exception_ptr m_error;
+    std::mutex m_stats_mutex;
+    std::mutex m_setup_mutex;
+};
+
+#endif
@@ -0,0 +1,365 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Parsing and binary caching of the ANCF tire input decks (*.INP).
+//
+// The text deck is parsed once per process; further requests for the same file
+// (e.g., one per wheel) share the parsed tables. The parsed tables are also
+// written to a binary cache file (<deck>.cache) which, as long as the hash of
+// the text deck matches the one stored in the cache, is memory-mapped on the
+// next launch instead of parsing the deck. If the cache cannot be written (e.g.,
+// read-only data directory), the deck is simply parsed on every launch.
+//
+// =============================================================================
+
+#ifndef ANCF_TIRE_INPUT_H
+#define ANCF_TIRE_INPUT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <process.h>
+#define ANCF_TIRE_INPUT_GETPID _getpid
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ANCF_TIRE_INPUT_GETPID getpid
+#endif
+
+/// Tables read from an ANCF tire input deck.
+/// All tables are stored row-wise, in the order in which they appear in the deck.
+struct ANCFTireInputData {
+    int TotalNumElements = 0;
+    int NumElements_x = 0;
+    int NumElements_y = 0;
+    int TotalNumNodes = 0;
+    int MaxSectionNumber = 0;
+    int MaxMatID = 0;
+
+    std::vector<int> SectionID;         ///< section of each element
+    std::vector<int> ElementNodes;      ///< 4 node numbers per element (order as in the deck)
+    std::vector<double> ElementLength;  ///< 2 dimensions per element
+    std::vector<int> NDR;               ///< 6 entries per node
+    std::vector<double> COORDFlex;      ///< 6 coordinates per node (position and gradient)
+    std::vector<double> VELCYFlex;      ///< 6 velocities per node
+    std::vector<int> NumLayer;          ///< number of layers of each section
+    std::vector<double> LayerPROP;      ///< 2 properties (thickness, ply angle) per layer, over all sections
+    std::vector<int> LayerMatID;        ///< material of each layer, over all sections
+    std::vector<int> MTYPE;             ///< type of each material
+    std::vector<double> MPROP;          ///< 10 properties per material
+};
+
+namespace ancf_tire_input {
+
+const char kCacheMagic[4] = {'A', 'T', 'I', 'C'};
+const uint32_t kCacheVersion = 1;
+
+// 64-bit FNV-1a hash of a byte buffer.
+inline uint64_t HashBytes(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Read an entire file. Return false if the file cannot be read.
+inline bool ReadFile(const std::string& filename, std::vector<char>& contents) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (!file)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    contents.resize(size > 0 ? size : 0);
+    bool ok = fread(contents.data(), 1, contents.size(), file) == contents.size();
+    fclose(file);
+    return ok;
+}
+
+// Parse the text deck. The format is the one of IndataBiLinearShell_Tire(HMMWV50x24).INP.
+inline bool ParseDeck(const std::string& filename, ANCFTireInputData& data) {
+    FILE* inputfile = fopen(filename.c_str(), "r");
+    if (!inputfile)
+        return false;
+
+    char str1[100];
+    int MAXCOUNT = 100;
+    int numFlexBody = 0;
+    int count;
+    int dummy;
+
+    //!--------------------------------------!
+    //!-- Elememt data            -----------!
+    //!--------------------------------------!
+    fgets(str1, MAXCOUNT, inputfile);
+    fscanf(inputfile, "%d\n", &numFlexBody);
+    fgets(str1, MAXCOUNT, inputfile);
+    fscanf(inputfile, "%d %d %d %d\n", &data.TotalNumElements, &data.NumElements_x, &data.NumElements_y,
+           &data.TotalNumNodes);
+    fgets(str1, MAXCOUNT, inputfile);
+
+    data.SectionID.resize(data.TotalNumElements);
+    data.ElementNodes.resize(4 * data.TotalNumElements);
+    data.ElementLength.resize(2 * data.TotalNumElements);
+    data.MaxSectionNumber = 0;
+    for (int i = 0; i < data.TotalNumElements; i++) {
+        int* nodes = &data.ElementNodes[4 * i];
+        fscanf(inputfile, "%d %d %d %d %d %d %d\n", &count, &dummy, &data.SectionID[i], &nodes[0], &nodes[1], &nodes[2],
+               &nodes[3]);
+        fscanf(inputfile, " %lf %lf\n", &data.ElementLength[2 * i], &data.ElementLength[2 * i + 1]);
+        if (data.MaxSectionNumber < data.SectionID[i])
+            data.MaxSectionNumber = data.SectionID[i];
+    }
+
+    //!--------------------------------------!
+    //!-- NDR,COORDFlex,VELCYFlex -----------!
+    //!--------------------------------------!
+    fgets(str1, MAXCOUNT, inputfile);
+    data.NDR.resize(6 * data.TotalNumNodes);
+    data.COORDFlex.resize(6 * data.TotalNumNodes);
+    data.VELCYFlex.resize(6 * data.TotalNumNodes);
+    for (int i = 0; i < data.TotalNumNodes; i++) {
+        int* ndr = &data.NDR[6 * i];
+        double* pos = &data.COORDFlex[6 * i];
+        double* vel = &data.VELCYFlex[6 * i];
+        fscanf(inputfile, "%d %d %d %d %d %d %d\n", &count, &ndr[0], &ndr[1], &ndr[2], &ndr[3], &ndr[4], &ndr[5]);
+        fscanf(inputfile, "%lf %lf %lf %lf %lf %lf\n", &pos[0], &pos[1], &pos[2], &pos[3], &pos[4], &pos[5]);
+        fscanf(inputfile, "%lf %lf %lf %lf %lf %lf\n", &vel[0], &vel[1], &vel[2], &vel[3], &vel[4], &vel[5]);
+    }
+
+    //!--------------------------------------!
+    //!--- Read Layer Data ------------------!
+    //!--------------------------------------!
+    fgets(str1, MAXCOUNT, inputfile);
+    data.NumLayer.resize(data.MaxSectionNumber);
+    data.LayerPROP.clear();
+    data.LayerMatID.clear();
+    data.MaxMatID = 0;
+    for (int i = 0; i < data.MaxSectionNumber; i++) {
+        fscanf(inputfile, "%d %d\n", &count, &data.NumLayer[i]);
+        for (int j = 0; j < data.NumLayer[i]; j++) {
+            double thickness, angle;
+            int matID;
+            fscanf(inputfile, "%lf %lf %d\n", &thickness, &angle, &matID);
+            data.LayerPROP.push_back(thickness);
+            data.LayerPROP.push_back(angle);
+            data.LayerMatID.push_back(matID);
+            if (data.MaxMatID < matID)
+                data.MaxMatID = matID;
+        }
+    }
+
+    //!--------------------------------------!
+    //!--- Read Material Data ---------------!
+    //!--------------------------------------!
+    fgets(str1, MAXCOUNT, inputfile);
+    data.MTYPE.resize(data.MaxMatID);
+    data.MPROP.assign(10 * data.MaxMatID, 0.0);
+    for (int i = 0; i < data.MaxMatID; i++) {
+        double* prop = &data.MPROP[10 * i];
+        fscanf(inputfile, "%d %d\n", &count, &data.MTYPE[i]);
+        if (data.MTYPE[i] == 1) {
+            fscanf(inputfile, "%lf %lf %lf %lf\n", &prop[0], &prop[1], &prop[2], &prop[3]);
+        }
+        if (data.MTYPE[i] == 2) {
+            fscanf(inputfile, "%lf %lf %lf %lf\n", &prop[0], &prop[1], &prop[2], &prop[3]);
+            fscanf(inputfile, "%lf %lf %lf %lf %lf %lf\n", &prop[4], &prop[5], &prop[6], &prop[7], &prop[8], &prop[9]);
+        }
+    }
+
+    fclose(inputfile);
+    return true;
+}
+
+// Layout of the binary cache: header, followed by the tables of ANCFTireInputData (in declaration order).
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t source_hash;
+    int32_t counts[6];  // TotalNumElements, NumElements_x, NumElements_y, TotalNumNodes, MaxSectionNumber, MaxMatID
+    uint64_t table_size[11];  // number of entries of each table
+};
+
+inline void GetTables(ANCFTireInputData& data, std::vector<int>* itables[6], std::vector<double>* dtables[5]) {
+    itables[0] = &data.SectionID;
+    itables[1] = &data.ElementNodes;
+    itables[2] = &data.NDR;
+    itables[3] = &data.NumLayer;
+    itables[4] = &data.LayerMatID;
+    itables[5] = &data.MTYPE;
+    dtables[0] = &data.ElementLength;
+    dtables[1] = &data.COORDFlex;
+    dtables[2] = &data.VELCYFlex;
+    dtables[3] = &data.LayerPROP;
+    dtables[4] = &data.MPROP;
+}
+
+// Write the binary cache. The file is written under a temporary name and then renamed, so that concurrent jobs
+// never see a partially written cache.
+inline bool WriteCache(const std::string& filename, uint64_t source_hash, ANCFTireInputData& data) {
+    std::vector<int>* itables[6];
+    std::vector<double>* dtables[5];
+    GetTables(data, itables, dtables);
+
+    CacheHeader header;
+    std::memcpy(header.magic, kCacheMagic, 4);
+    header.version = kCacheVersion;
+    header.source_hash = source_hash;
+    header.counts[0] = data.TotalNumElements;
+    header.counts[1] = data.NumElements_x;
+    header.counts[2] = data.NumElements_y;
+    header.counts[3] = data.TotalNumNodes;
+    header.counts[4] = data.MaxSectionNumber;
+    header.counts[5] = data.MaxMatID;
+    for (int i = 0; i < 6; i++)
+        header.table_size[i] = itables[i]->size();
+    for (int i = 0; i < 5; i++)
+        header.table_size[6 + i] = dtables[i]->size();
+
+    std::string tmpname = filename + ".tmp" + std::to_string(ANCF_TIRE_INPUT_GETPID());
+    FILE* file = fopen(tmpname.c_str(), "wb");
+    if (!file)
+        return false;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (int i = 0; i < 6 && ok; i++)
+        ok = fwrite(itables[i]->data(), sizeof(int), itables[i]->size(), file) == itables[i]->size();
+    for (int i = 0; i < 5 && ok; i++)
+        ok = fwrite(dtables[i]->data(), sizeof(double), dtables[i]->size(), file) == dtables[i]->size();
+    ok = (fclose(file) == 0) && ok;
+#if defined(_WIN32)
+    remove(filename.c_str());
+#endif
+    if (!ok || rename(tmpname.c_str(), filename.c_str()) != 0) {
+        remove(tmpname.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Extract the tables from the contents of a binary cache. Return false if the cache is invalid or out of date.
+inline bool DecodeCache(const char* buffer, size_t size, uint64_t source_hash, ANCFTireInputData& data) {
+    CacheHeader header;
+    if (size < sizeof(header))
+        return false;
+    std::memcpy(&header, buffer, sizeof(header));
+    if (std::memcmp(header.magic, kCacheMagic, 4) != 0 || header.version != kCacheVersion ||
+        header.source_hash != source_hash)
+        return false;
+
+    size_t expected = sizeof(header);
+    for (int i = 0; i < 6; i++)
+        expected += header.table_size[i] * sizeof(int);
+    for (int i = 0; i < 5; i++)
+        expected += header.table_size[6 + i] * sizeof(double);
+    if (size != expected)
+        return false;
+
+    data.TotalNumElements = header.counts[0];
+    data.NumElements_x = header.counts[1];
+    data.NumElements_y = header.counts[2];
+    data.TotalNumNodes = header.counts[3];
+    data.MaxSectionNumber = header.counts[4];
+    data.MaxMatID = header.counts[5];
+
+    std::vector<int>* itables[6];
+    std::vector<double>* dtables[5];
+    GetTables(data, itables, dtables);
+    const char* ptr = buffer + sizeof(header);
+    for (int i = 0; i < 6; i++) {
+        itables[i]->resize(header.table_size[i]);
+        std::memcpy(itables[i]->data(), ptr, itables[i]->size() * sizeof(int));
+        ptr += itables[i]->size() * sizeof(int);
+    }
+    for (int i = 0; i < 5; i++) {
+        dtables[i]->resize(header.table_size[6 + i]);
+        std::memcpy(dtables[i]->data(), ptr, dtables[i]->size() * sizeof(double));
+        ptr += dtables[i]->size() * sizeof(double);
+    }
+    return true;
+}
+
+// Load the binary cache (memory-mapped where available).
+inline bool ReadCache(const std::string& filename, uint64_t source_hash, ANCFTireInputData& data) {
+#if defined(_WIN32)
+    std::vector<char> contents;
+    if (!ReadFile(filename, contents))
+        return false;
+    return DecodeCache(contents.data(), contents.size(), source_hash, data);
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* buffer = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (buffer == MAP_FAILED)
+        return false;
+    bool ok = DecodeCache(static_cast<const char*>(buffer), size, source_hash, data);
+    munmap(buffer, size);
+    return ok;
+#endif
+}
+
+}  // end namespace ancf_tire_input
+
+/// Return the tables of the specified ANCF tire input deck.
+/// The deck is read only once per process (subsequent calls return the same tables) and, across processes, from its
+/// binary cache when this is up to date. Return nullptr if the deck cannot be read.
+inline std::shared_ptr<const ANCFTireInputData> LoadANCFTireInput(const std::string& filename) {
+    using namespace ancf_tire_input;
+
+    static std::mutex mutex;
+    static std::map<std::string, std::shared_ptr<const ANCFTireInputData>> loaded;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = loaded.find(filename);
+    if (found != loaded.end())
+        return found->second;
+
+    std::vector<char> contents;
+    if (!ReadFile(filename, contents))
+        return nullptr;
+    uint64_t hash = HashBytes(contents.data(), contents.size());
+
+    auto data = std::make_shared<ANCFTireInputData>();
+    std::string cachename = filename + ".cache";
+    if (ReadCache(cachename, hash, *data)) {
+        printf("Read %s from binary cache\n", filename.c_str());
+    } else {
+        if (!ParseDeck(filename, *data))
+            return nullptr;
+        printf("Parsed %s\n", filename.c_str());
+        if (!WriteCache(cachename, hash, *data))
+            printf("Could not write binary cache %s\n", cachename.c_str());
+    }
+
+    loaded[filename] = data;
+    return data;
+}
+
+#endif
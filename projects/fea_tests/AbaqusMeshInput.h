@@ -0,0 +1,383 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Binary caching and node renumbering of Abaqus (*.INP) meshes.
+//
+// On a cache miss, the mesh is loaded with ChMeshFileLoader::FromAbaqusFile
+// (untransformed) and its topology is extracted: reference node coordinates,
+// element connectivity (in the node order used by the elements), and node
+// sets. The nodes are renumbered with the reverse Cuthill-McKee algorithm to
+// reduce the bandwidth (and the fill-in of direct solvers), and the result is
+// written to a binary cache file (<mesh>.cache) which is used on the next
+// launch as long as the hash of the text file matches the one stored in the
+// cache. Within a process, a mesh file is loaded only once.
+//
+// BuildAbaqusMesh() then creates the nodes and elements of a ChMesh, with the
+// given rigid transformation, in the renumbered order.
+//
+// =============================================================================
+
+#ifndef ABAQUS_MESH_INPUT_H
+#define ABAQUS_MESH_INPUT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "chrono/fea/ChElementHexa_8.h"
+#include "chrono/fea/ChElementTetra_4.h"
+#include "chrono/fea/ChMesh.h"
+#include "chrono/fea/ChMeshFileLoader.h"
+
+#include "ANCFTireInput.h"
+
+/// Topology and reference configuration of an Abaqus mesh, with renumbered nodes.
+struct AbaqusMeshData {
+    std::vector<double> NodePos;       // reference node coordinates (3 per node)
+    std::vector<int> ElementType;      // number of nodes of each element (4: ChElementTetra_4, 8: ChElementHexa_8)
+    std::vector<int> ElementNodes;     // element connectivity (node indices, in element node order)
+    std::vector<int> NodeSetSizes;     // number of nodes in each node set
+    std::vector<int> NodeSetNodes;     // node indices of all node sets (concatenated)
+    std::vector<char> NodeSetNames;    // names of the node sets ('\0'-terminated, concatenated)
+    int BandwidthOriginal = 0;         // node bandwidth in the order of the INP file
+    int BandwidthReordered = 0;        // node bandwidth after renumbering
+
+    unsigned int GetNumNodes() const { return (unsigned int)NodePos.size() / 3; }
+};
+
+namespace abaqus_mesh_input {
+
+const char kCacheMagic[4] = {'A', 'Q', 'M', 'C'};
+const uint32_t kCacheVersion = 1;
+
+// Largest difference between the indices of two nodes of the same element.
+inline int Bandwidth(const std::vector<int>& type, const std::vector<int>& nodes) {
+    int bandwidth = 0;
+    size_t start = 0;
+    for (auto n : type) {
+        auto first = nodes.begin() + start;
+        auto range = std::minmax_element(first, first + n);
+        bandwidth = std::max(bandwidth, *range.second - *range.first);
+        start += n;
+    }
+    return bandwidth;
+}
+
+// Reverse Cuthill-McKee ordering of the node graph defined by the element connectivity.
+// Return the permutation new index -> old index. Each connected component is started from a node of minimum degree.
+inline std::vector<int> ReverseCuthillMcKee(int num_nodes, const std::vector<int>& type, const std::vector<int>& nodes) {
+    std::vector<std::vector<int>> adjacency(num_nodes);
+    size_t start = 0;
+    for (auto n : type) {
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++)
+                if (i != j)
+                    adjacency[nodes[start + i]].push_back(nodes[start + j]);
+        start += n;
+    }
+    for (auto& adj : adjacency) {
+        std::sort(adj.begin(), adj.end());
+        adj.erase(std::unique(adj.begin(), adj.end()), adj.end());
+    }
+
+    std::vector<int> by_degree(num_nodes);
+    for (int i = 0; i < num_nodes; i++)
+        by_degree[i] = i;
+    std::stable_sort(by_degree.begin(), by_degree.end(),
+                     [&](int a, int b) { return adjacency[a].size() < adjacency[b].size(); });
+
+    std::vector<int> order;
+    order.reserve(num_nodes);
+    std::vector<bool> visited(num_nodes, false);
+    std::vector<int> neighbors;
+    for (auto root : by_degree) {
+        if (visited[root])
+            continue;
+        std::queue<int> queue;
+        queue.push(root);
+        visited[root] = true;
+        while (!queue.empty()) {
+            int node = queue.front();
+            queue.pop();
+            order.push_back(node);
+            neighbors.clear();
+            for (auto adj : adjacency[node]) {
+                if (!visited[adj]) {
+                    visited[adj] = true;
+                    neighbors.push_back(adj);
+                }
+            }
+            std::stable_sort(neighbors.begin(), neighbors.end(),
+                             [&](int a, int b) { return adjacency[a].size() < adjacency[b].size(); });
+            for (auto adj : neighbors)
+                queue.push(adj);
+        }
+    }
+
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+// Load the mesh with the Chrono mesh loader and extract its topology, in the node order of the INP file.
+inline bool LoadMesh(const std::string& filename, AbaqusMeshData& data) {
+    using namespace chrono;
+    using namespace chrono::fea;
+
+    auto mesh = chrono_types::make_shared<ChMesh>();
+    auto material = chrono_types::make_shared<ChContinuumElastic>();
+    std::map<std::string, std::vector<std::shared_ptr<ChNodeFEAbase>>> node_sets;
+    try {
+        ChMeshFileLoader::FromAbaqusFile(mesh, filename.c_str(), material, node_sets);
+    } catch (ChException& err) {
+        printf("%s\n", err.what());
+        return false;
+    }
+
+    std::unordered_map<ChNodeFEAbase*, int> index;
+    for (unsigned int i = 0; i < mesh->GetNnodes(); i++) {
+        auto node = std::dynamic_pointer_cast<ChNodeFEAxyz>(mesh->GetNode(i));
+        if (!node)
+            return false;
+        index[node.get()] = (int)i;
+        ChVector<> pos = node->GetPos();
+        data.NodePos.insert(data.NodePos.end(), {pos.x(), pos.y(), pos.z()});
+    }
+
+    for (unsigned int i = 0; i < mesh->GetNelements(); i++) {
+        auto element = mesh->GetElement(i);
+        if (!std::dynamic_pointer_cast<ChElementTetra_4>(element) &&
+            !std::dynamic_pointer_cast<ChElementHexa_8>(element)) {
+            printf("Unsupported element type in %s\n", filename.c_str());
+            return false;
+        }
+        data.ElementType.push_back(element->GetNnodes());
+        for (int j = 0; j < element->GetNnodes(); j++)
+            data.ElementNodes.push_back(index.at(element->GetNodeN(j).get()));
+    }
+
+    for (const auto& set : node_sets) {
+        data.NodeSetSizes.push_back((int)set.second.size());
+        for (const auto& node : set.second)
+            data.NodeSetNodes.push_back(index.at(node.get()));
+        data.NodeSetNames.insert(data.NodeSetNames.end(), set.first.begin(), set.first.end());
+        data.NodeSetNames.push_back('\0');
+    }
+
+    return true;
+}
+
+// Renumber the nodes with the reverse Cuthill-McKee algorithm.
+inline void Renumber(AbaqusMeshData& data) {
+    int num_nodes = (int)data.GetNumNodes();
+    data.BandwidthOriginal = Bandwidth(data.ElementType, data.ElementNodes);
+
+    auto order = ReverseCuthillMcKee(num_nodes, data.ElementType, data.ElementNodes);
+    std::vector<int> new_index(num_nodes);
+    std::vector<double> pos(data.NodePos.size());
+    for (int i = 0; i < num_nodes; i++) {
+        new_index[order[i]] = i;
+        std::memcpy(&pos[3 * i], &data.NodePos[3 * order[i]], 3 * sizeof(double));
+    }
+    data.NodePos.swap(pos);
+    for (auto& n : data.ElementNodes)
+        n = new_index[n];
+    for (auto& n : data.NodeSetNodes)
+        n = new_index[n];
+
+    data.BandwidthReordered = Bandwidth(data.ElementType, data.ElementNodes);
+}
+
+// Layout of the binary cache: header, followed by the tables of AbaqusMeshData (in declaration order).
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t source_hash;
+    int32_t bandwidth[2];    // BandwidthOriginal, BandwidthReordered
+    uint64_t table_size[6];  // number of entries of each table
+};
+
+inline void GetTables(AbaqusMeshData& data, std::vector<int>* itables[4]) {
+    itables[0] = &data.ElementType;
+    itables[1] = &data.ElementNodes;
+    itables[2] = &data.NodeSetSizes;
+    itables[3] = &data.NodeSetNodes;
+}
+
+// Write the binary cache (under a temporary name, then renamed).
+inline bool WriteCache(const std::string& filename, uint64_t source_hash, AbaqusMeshData& data) {
+    std::vector<int>* itables[4];
+    GetTables(data, itables);
+
+    CacheHeader header;
+    std::memcpy(header.magic, kCacheMagic, 4);
+    header.version = kCacheVersion;
+    header.source_hash = source_hash;
+    header.bandwidth[0] = data.BandwidthOriginal;
+    header.bandwidth[1] = data.BandwidthReordered;
+    header.table_size[0] = data.NodePos.size();
+    for (int i = 0; i < 4; i++)
+        header.table_size[1 + i] = itables[i]->size();
+    header.table_size[5] = data.NodeSetNames.size();
+
+    std::string tmpname = filename + ".tmp" + std::to_string(ANCF_TIRE_INPUT_GETPID());
+    FILE* file = fopen(tmpname.c_str(), "wb");
+    if (!file)
+        return false;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(data.NodePos.data(), sizeof(double), data.NodePos.size(), file) == data.NodePos.size();
+    for (int i = 0; i < 4 && ok; i++)
+        ok = fwrite(itables[i]->data(), sizeof(int), itables[i]->size(), file) == itables[i]->size();
+    ok = ok && fwrite(data.NodeSetNames.data(), 1, data.NodeSetNames.size(), file) == data.NodeSetNames.size();
+    ok = (fclose(file) == 0) && ok;
+#if defined(_WIN32)
+    remove(filename.c_str());
+#endif
+    if (!ok || rename(tmpname.c_str(), filename.c_str()) != 0) {
+        remove(tmpname.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Read the binary cache. Return false if the cache is missing, invalid, or out of date.
+inline bool ReadCache(const std::string& filename, uint64_t source_hash, AbaqusMeshData& data) {
+    std::vector<char> contents;
+    if (!ancf_tire_input::ReadFile(filename, contents))
+        return false;
+
+    CacheHeader header;
+    if (contents.size() < sizeof(header))
+        return false;
+    std::memcpy(&header, contents.data(), sizeof(header));
+    if (std::memcmp(header.magic, kCacheMagic, 4) != 0 || header.version != kCacheVersion ||
+        header.source_hash != source_hash)
+        return false;
+
+    size_t expected = sizeof(header) + header.table_size[0] * sizeof(double) + header.table_size[5];
+    for (int i = 0; i < 4; i++)
+        expected += header.table_size[1 + i] * sizeof(int);
+    if (contents.size() != expected)
+        return false;
+
+    data.BandwidthOriginal = header.bandwidth[0];
+    data.BandwidthReordered = header.bandwidth[1];
+
+    std::vector<int>* itables[4];
+    GetTables(data, itables);
+    const char* ptr = contents.data() + sizeof(header);
+    data.NodePos.resize(header.table_size[0]);
+    std::memcpy(data.NodePos.data(), ptr, data.NodePos.size() * sizeof(double));
+    ptr += data.NodePos.size() * sizeof(double);
+    for (int i = 0; i < 4; i++) {
+        itables[i]->resize(header.table_size[1 + i]);
+        std::memcpy(itables[i]->data(), ptr, itables[i]->size() * sizeof(int));
+        ptr += itables[i]->size() * sizeof(int);
+    }
+    data.NodeSetNames.assign(ptr, ptr + header.table_size[5]);
+    return true;
+}
+
+}  // end namespace abaqus_mesh_input
+
+/// Return the topology of the specified Abaqus mesh file, with nodes renumbered for bandwidth reduction.
+/// The mesh is loaded only once per process and, across processes, from its binary cache when this is up to date.
+/// Return nullptr if the mesh cannot be loaded or contains unsupported elements.
+inline std::shared_ptr<const AbaqusMeshData> LoadAbaqusMesh(const std::string& filename) {
+    using namespace abaqus_mesh_input;
+
+    static std::mutex mutex;
+    static std::map<std::string, std::shared_ptr<const AbaqusMeshData>> loaded;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = loaded.find(filename);
+    if (found != loaded.end())
+        return found->second;
+
+    std::vector<char> contents;
+    if (!ancf_tire_input::ReadFile(filename, contents))
+        return nullptr;
+    uint64_t hash = ancf_tire_input::HashBytes(contents.data(), contents.size());
+
+    auto data = std::make_shared<AbaqusMeshData>();
+    std::string cachename = filename + ".cache";
+    if (ReadCache(cachename, hash, *data)) {
+        printf("Read %s from binary cache\n", filename.c_str());
+    } else {
+        if (!LoadMesh(filename, *data))
+            return nullptr;
+        Renumber(*data);
+        printf("Loaded %s (node bandwidth %d, renumbered %d)\n", filename.c_str(), data->BandwidthOriginal,
+               data->BandwidthReordered);
+        if (!WriteCache(cachename, hash, *data))
+            printf("Could not write binary cache %s\n", cachename.c_str());
+    }
+
+    loaded[filename] = data;
+    return data;
+}
+
+/// Create the nodes and elements of the given mesh, placed with the specified transformation (as in
+/// ChMeshFileLoader::FromAbaqusFile), and fill the node sets.
+inline void BuildAbaqusMesh(const AbaqusMeshData& data,
+                            std::shared_ptr<chrono::fea::ChMesh> mesh,
+                            std::shared_ptr<chrono::fea::ChContinuumElastic> material,
+                            std::map<std::string, std::vector<std::shared_ptr<chrono::fea::ChNodeFEAbase>>>& node_sets,
+                            const chrono::ChVector<>& pos_transform = chrono::VNULL,
+                            const chrono::ChMatrix33<>& rot_transform = chrono::ChMatrix33<>(1)) {
+    using namespace chrono;
+    using namespace chrono::fea;
+
+    std::vector<std::shared_ptr<ChNodeFEAxyz>> nodes(data.GetNumNodes());
+    for (unsigned int i = 0; i < data.GetNumNodes(); i++) {
+        ChVector<> pos(data.NodePos[3 * i + 0], data.NodePos[3 * i + 1], data.NodePos[3 * i + 2]);
+        nodes[i] = chrono_types::make_shared<ChNodeFEAxyz>(rot_transform * pos + pos_transform);
+        mesh->AddNode(nodes[i]);
+    }
+
+    const int* n = data.ElementNodes.data();
+    for (auto type : data.ElementType) {
+        if (type == 4) {
+            auto element = chrono_types::make_shared<ChElementTetra_4>();
+            element->SetNodes(nodes[n[0]], nodes[n[1]], nodes[n[2]], nodes[n[3]]);
+            element->SetMaterial(material);
+            mesh->AddElement(element);
+        } else {
+            auto element = chrono_types::make_shared<ChElementHexa_8>();
+            element->SetNodes(nodes[n[0]], nodes[n[1]], nodes[n[2]], nodes[n[3]], nodes[n[4]], nodes[n[5]],
+                              nodes[n[6]], nodes[n[7]]);
+            element->SetMaterial(material);
+            mesh->AddElement(element);
+        }
+        n += type;
+    }
+
+    const int* set_node = data.NodeSetNodes.data();
+    const char* name = data.NodeSetNames.data();
+    for (auto size : data.NodeSetSizes) {
+        auto& set = node_sets[name];
+        for (int i = 0; i < size; i++)
+            set.push_back(nodes[set_node[i]]);
+        set_node += size;
+        name += std::strlen(name) + 1;
+    }
+}
+
+#endif
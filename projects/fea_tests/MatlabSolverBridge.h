@@ -0,0 +1,228 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Direct solver bridge to a persistent Matlab engine session, with reduced
+// data transfer.
+//
+// ChSolverMatlab sends, at every Solve, the mass, Jacobian and compliance
+// matrices as dense triplet arrays (through one engPutVariable per block),
+// assembles the KKT matrix in Matlab, solves it with mldivide, and clears the
+// workspace, paying the engine IPC latency several times per call.
+// ChSolverMatlabBridge keeps its data in the Matlab workspace of the engine
+// session (which lives as long as the ChMatlabEngine) between calls:
+//   - the KKT matrix is sent in CSR form (row pointers, column indices,
+//     values; i.e. the storage of ChSparseMatrix, without conversion), and only
+//     if it changed: the values only if the sparsity pattern is unchanged,
+//     nothing if the values are unchanged as well;
+//   - its factorization (a Matlab decomposition object, R2017b or later) is
+//     kept in the workspace, so an unchanged matrix is not refactorized;
+//   - each Solve is one round trip: put the right-hand side, one eval, get the
+//     solution;
+//   - SolveBatch solves a set of right-hand sides with one evaluation (plus
+//     one to update the matrix, if it changed).
+// The time spent in transfers (put/get) and in Matlab evaluations (assembly,
+// factorization, solve, and the latency of the calls) is accumulated.
+// The engine interface copies the data through the engine pipe; Matlab has no
+// shared-memory transfer in its C engine API.
+//
+// =============================================================================
+
+#ifndef MATLAB_SOLVER_BRIDGE_H
+#define MATLAB_SOLVER_BRIDGE_H
+
+#include <algorithm>
+#include <iostream>
+
+#include "chrono/core/ChSparseMatrix.h"
+#include "chrono/core/ChTimer.h"
+#include "chrono/solver/ChSolverLS.h"
+#include "chrono/solver/ChSystemDescriptor.h"
+
+#include "chrono_matlab/ChMatlabEngine.h"
+
+namespace chrono {
+
+class ChSolverMatlabBridge : public ChSolverLS {
+  public:
+    ChSolverMatlabBridge(ChMatlabEngine& engine) : m_engine(&engine) { Reset(); }
+
+    virtual bool IsIterative() const override { return false; }
+    virtual bool IsDirect() const override { return true; }
+    virtual bool SolveRequiresMatrix() const override { return true; }
+
+    /// Forget the matrix stored in the Matlab workspace (the next call sends and factorizes it again).
+    void Reset() {
+        m_stored = false;
+        m_num_pattern_transfers = 0;
+        m_num_value_transfers = 0;
+        m_num_solves = 0;
+        m_num_round_trips = 0;
+        m_timer_transfer.reset();
+        m_timer_eval.reset();
+    }
+
+    virtual bool Setup(ChSystemDescriptor& sysd) override {
+        sysd.UpdateCountsAndOffsets();
+        sysd.ConvertToMatrixForm(&m_mat, nullptr);
+        m_mat.makeCompressed();
+        return SendMatrix(m_mat);
+    }
+
+    virtual double Solve(ChSystemDescriptor& sysd) override {
+        if (!m_stored)
+            return -1;
+        sysd.ConvertToMatrixForm(nullptr, &m_rhs);
+        if (!SolveRHS(m_rhs, m_sol))
+            return -1;
+        sysd.FromVectorToUnknowns(m_sol.col(0));
+        return 0;
+    }
+
+    /// Solve Z X = B for all columns of B, in one round trip (Z is sent only if it changed).
+    bool SolveBatch(const ChSparseMatrix& Z, ChMatrixConstRef B, ChMatrixDynamic<>& X) {
+        if (!SendMatrix(Z))
+            return false;
+        if (!SolveRHS(B, X))
+            return false;
+        m_num_solves += (int)B.cols() - 1;
+        return true;
+    }
+
+    /// Return the number of right-hand sides solved.
+    int GetNumSolves() const { return m_num_solves; }
+
+    /// Return the number of transfers of the complete matrix (sparsity pattern changed).
+    int GetNumPatternTransfers() const { return m_num_pattern_transfers; }
+
+    /// Return the number of transfers of the matrix values only (same sparsity pattern).
+    int GetNumValueTransfers() const { return m_num_value_transfers; }
+
+    /// Return the number of Matlab evaluations.
+    int GetNumRoundTrips() const { return m_num_round_trips; }
+
+    /// Return the time spent in data transfers to and from the engine.
+    double GetTimeTransfer() const { return m_timer_transfer(); }
+
+    /// Return the time spent in Matlab evaluations.
+    double GetTimeEval() const { return m_timer_eval(); }
+
+    /// Print the statistics of the bridge.
+    void PrintStats() const {
+        std::cout << "Matlab bridge: " << m_num_solves << " solves in " << m_num_round_trips << " evaluations, "
+                  << m_num_pattern_transfers << " matrix transfers, " << m_num_value_transfers
+                  << " value transfers\n";
+        std::cout << "  transfer time: " << GetTimeTransfer() << " s   evaluation time: " << GetTimeEval() << " s"
+                  << std::endl;
+    }
+
+  private:
+    // Make the Matlab workspace hold the given matrix and its factorization.
+    bool SendMatrix(const ChSparseMatrix& Z) {
+        bool same_pattern = m_stored && SamePattern(Z, m_sent);
+        if (same_pattern && std::equal(Z.valuePtr(), Z.valuePtr() + Z.nonZeros(), m_sent.valuePtr()))
+            return true;
+
+        m_timer_transfer.start();
+        m_buf = Eigen::Map<const ChVectorDynamic<>>(Z.valuePtr(), Z.nonZeros());
+        bool ok = m_engine->PutVariable(m_buf, "chb_v");
+        if (!same_pattern) {
+            m_buf.resize(Z.outerSize() + 1);
+            std::copy(Z.outerIndexPtr(), Z.outerIndexPtr() + Z.outerSize() + 1, m_buf.data());
+            ok = ok && m_engine->PutVariable(m_buf, "chb_rp");
+            m_buf.resize(Z.nonZeros());
+            std::copy(Z.innerIndexPtr(), Z.innerIndexPtr() + Z.nonZeros(), m_buf.data());
+            ok = ok && m_engine->PutVariable(m_buf, "chb_ci");
+        }
+        m_timer_transfer.stop();
+        if (!ok)
+            return Fail("matrix transfer failed");
+
+        // Rebuild the matrix from CSR (the row and column index vectors are kept for value-only updates), and
+        // factorize it
+        m_timer_eval.start();
+        std::string cmd;
+        if (!same_pattern) {
+            cmd = "chb_n = " + std::to_string(Z.rows()) + "; chb_m = " + std::to_string(Z.cols()) +
+                  "; chb_i = repelem((1:chb_n)', diff(chb_rp)); chb_j = chb_ci + 1; clear chb_rp chb_ci; ";
+        }
+        cmd += "chb_Z = sparse(chb_i, chb_j, chb_v, chb_n, chb_m); chb_dZ = decomposition(chb_Z);";
+        ok = m_engine->Eval(cmd);
+        m_timer_eval.stop();
+        m_num_round_trips++;
+        if (!ok)
+            return Fail("matrix factorization failed");
+
+        m_sent = Z;
+        m_stored = true;
+        if (same_pattern)
+            m_num_value_transfers++;
+        else
+            m_num_pattern_transfers++;
+        return true;
+    }
+
+    // Solve with the stored factorization: one put, one evaluation, one get.
+    bool SolveRHS(ChMatrixConstRef B, ChMatrixDynamic<>& X) {
+        m_timer_transfer.start();
+        bool ok = m_engine->PutVariable(B, "chb_b");
+        m_timer_transfer.stop();
+        if (!ok)
+            return Fail("right-hand side transfer failed");
+
+        m_timer_eval.start();
+        ok = m_engine->Eval("chb_x = chb_dZ \\ chb_b;");
+        m_timer_eval.stop();
+        m_num_round_trips++;
+
+        m_timer_transfer.start();
+        ok = ok && m_engine->GetVariable(X, "chb_x");
+        m_timer_transfer.stop();
+        if (!ok || X.rows() != B.rows() || X.cols() != B.cols())
+            return Fail("solve failed");
+
+        m_num_solves++;
+        return true;
+    }
+
+    bool Fail(const char* msg) {
+        if (verbose)
+            std::cout << "ChSolverMatlabBridge: " << msg << std::endl;
+        m_stored = false;
+        return false;
+    }
+
+    static bool SamePattern(const ChSparseMatrix& A, const ChSparseMatrix& B) {
+        if (A.rows() != B.rows() || A.cols() != B.cols() || A.nonZeros() != B.nonZeros())
+            return false;
+        return std::equal(A.outerIndexPtr(), A.outerIndexPtr() + A.outerSize() + 1, B.outerIndexPtr()) &&
+               std::equal(A.innerIndexPtr(), A.innerIndexPtr() + A.nonZeros(), B.innerIndexPtr());
+    }
+
+    ChMatlabEngine* m_engine;
+    bool m_stored;          // the workspace holds m_sent and its factorization
+    ChSparseMatrix m_mat;   // matrix assembled at the last Setup
+    ChSparseMatrix m_sent;  // matrix in the Matlab workspace
+    ChVectorDynamic<> m_buf;
+    ChVectorDynamic<> m_rhs;
+    ChMatrixDynamic<> m_sol;
+
+    int m_num_pattern_transfers;
+    int m_num_value_transfers;
+    int m_num_solves;
+    int m_num_round_trips;
+    ChTimer<double> m_timer_transfer;
+    ChTimer<double> m_timer_eval;
+};
+
+}  // end namespace chrono
+
+#endif
@@ -0,0 +1,285 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Bulk constraint of a set of FEA nodes to a rigid body.
+//
+// ChLinkNodeSetFrame is equivalent to one ChLinkPointFrame per node (node
+// position fixed in the body frame) and, optionally, one ChLinkDirFrame per
+// ChNodeFEAxyzD node (node direction D fixed in the body frame), as used to
+// mount the bead nodes of a tire on its rim. Instead of hundreds of links, each
+// a separate physics item which the system updates, counts, and visits in
+// every state and descriptor operation, the set is one physics item:
+//   - its constraint rows (3 per node for the positions, then 2 per node for
+//     the directions) are stored in one array and occupy one contiguous block
+//     of Lagrange multipliers, in a fixed order, so that the sparsity pattern
+//     of the system matrix does not change from step to step;
+//   - the Jacobians and residuals of all rows are evaluated in one pass.
+// The constraint equations (in the body frame) are:
+//   position:  A^T (x_node - x_body) - p = 0                     (3 rows)
+//   direction: u . (A^T D) = 0,  w . (A^T D) = 0                  (2 rows)
+// with A the body rotation, p the initial node location in the body frame, and
+// u, w two unit vectors of the body frame orthogonal to the initial direction.
+//
+// =============================================================================
+
+#ifndef NODE_SET_CONSTRAINT_H
+#define NODE_SET_CONSTRAINT_H
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "chrono/physics/ChBodyFrame.h"
+#include "chrono/physics/ChPhysicsItem.h"
+#include "chrono/solver/ChConstraintTwoGeneric.h"
+#include "chrono/solver/ChSystemDescriptor.h"
+
+#include "chrono/fea/ChNodeFEAxyz.h"
+#include "chrono/fea/ChNodeFEAxyzD.h"
+
+namespace chrono {
+namespace fea {
+
+class ChLinkNodeSetFrame : public ChPhysicsItem {
+  public:
+    ChLinkNodeSetFrame() {}
+
+    virtual ChLinkNodeSetFrame* Clone() const override { return new ChLinkNodeSetFrame(*this); }
+
+    /// Constrain the given nodes to the body, in their current configuration. If constrain_dirs is true, the
+    /// direction of every ChNodeFEAxyzD node in the set is also constrained.
+    void Initialize(const std::vector<std::shared_ptr<ChNodeFEAxyz>>& nodes,
+                    std::shared_ptr<ChBodyFrame> body,
+                    bool constrain_dirs) {
+        m_body = body;
+        m_nodes = nodes;
+        m_dir_nodes.clear();
+        m_pos_loc.clear();
+        m_dir_u.clear();
+        m_dir_w.clear();
+
+        const ChMatrix33<>& A = body->GetA();
+        for (const auto& node : m_nodes) {
+            m_pos_loc.push_back(A.transpose() * (node->GetPos() - body->GetPos()));
+            if (!constrain_dirs)
+                continue;
+            auto dnode = std::dynamic_pointer_cast<ChNodeFEAxyzD>(node);
+            if (!dnode)
+                continue;
+            ChVector<> dir = A.transpose() * dnode->GetD();
+            dir.Normalize();
+            ChVector<> helper = std::abs(dir.x()) < 0.9 ? VECT_X : VECT_Y;
+            ChVector<> u = Vcross(dir, helper).GetNormalized();
+            m_dir_nodes.push_back(dnode);
+            m_dir_u.push_back(u);
+            m_dir_w.push_back(Vcross(dir, u));
+        }
+
+        // One array for all rows (never resized later: the descriptor keeps pointers to the rows)
+        size_t np = m_nodes.size();
+        m_rows.assign(3 * np + 2 * m_dir_nodes.size(), ChConstraintTwoGeneric());
+        for (size_t i = 0; i < np; i++)
+            for (int k = 0; k < 3; k++)
+                m_rows[3 * i + k].SetVariables(&m_nodes[i]->Variables(), &m_body->Variables());
+        for (size_t i = 0; i < m_dir_nodes.size(); i++)
+            for (int k = 0; k < 2; k++)
+                m_rows[3 * np + 2 * i + k].SetVariables(&m_dir_nodes[i]->Variables_D(), &m_body->Variables());
+        m_react.setZero(m_rows.size());
+
+        LoadJacobians();
+    }
+
+    /// Return the number of constrained nodes.
+    int GetNumNodes() const { return (int)m_nodes.size(); }
+
+    /// Return the number of nodes with a direction constraint.
+    int GetNumDirNodes() const { return (int)m_dir_nodes.size(); }
+
+    /// Return the reaction force on the body from the i-th node, in the body frame.
+    ChVector<> GetReactionOnBody(int i) const {
+        return -ChVector<>(m_react(3 * i), m_react(3 * i + 1), m_react(3 * i + 2));
+    }
+
+    /// Return the reaction torque on the body from the direction constraint of the i-th direction node, in the body
+    /// frame.
+    ChVector<> GetReactionTorqueOnBody(int i) const {
+        size_t r = 3 * m_nodes.size() + 2 * i;
+        ChVector<> g = m_body->GetA().transpose() * m_dir_nodes[i]->GetD();
+        return m_react(r) * Vcross(m_dir_u[i], g) + m_react(r + 1) * Vcross(m_dir_w[i], g);
+    }
+
+    // Physics item functions
+
+    virtual int GetDOC() override { return (int)m_rows.size(); }
+    virtual int GetDOC_c() override { return (int)m_rows.size(); }
+
+    virtual void Update(double mytime, bool update_assets = true) override {
+        ChPhysicsItem::Update(mytime, update_assets);
+        LoadJacobians();
+    }
+
+    // State functions
+
+    virtual void IntStateGatherReactions(const unsigned int off_L, ChVectorDynamic<>& L) override {
+        L.segment(off_L, m_react.size()) = m_react;
+    }
+
+    virtual void IntStateScatterReactions(const unsigned int off_L, const ChVectorDynamic<>& L) override {
+        m_react = L.segment(off_L, m_react.size());
+    }
+
+    virtual void IntLoadResidual_CqL(const unsigned int off_L,
+                                     ChVectorDynamic<>& R,
+                                     const ChVectorDynamic<>& L,
+                                     const double c) override {
+        for (size_t r = 0; r < m_rows.size(); r++)
+            m_rows[r].MultiplyTandAdd(R, L(off_L + r) * c);
+    }
+
+    virtual void IntLoadConstraint_C(const unsigned int off_L,
+                                     ChVectorDynamic<>& Qc,
+                                     const double c,
+                                     bool do_clamp,
+                                     double recovery_clamp) override {
+        m_C.resize(m_rows.size());
+        ComputeViolation(m_C);
+        for (size_t r = 0; r < m_rows.size(); r++) {
+            double res = c * m_C[r];
+            if (do_clamp)
+                res = std::min(std::max(res, -recovery_clamp), recovery_clamp);
+            Qc(off_L + r) += res;
+        }
+    }
+
+    virtual void IntToDescriptor(const unsigned int off_v,
+                                 const ChStateDelta& v,
+                                 const ChVectorDynamic<>& R,
+                                 const unsigned int off_L,
+                                 const ChVectorDynamic<>& L,
+                                 const ChVectorDynamic<>& Qc) override {
+        for (size_t r = 0; r < m_rows.size(); r++) {
+            m_rows[r].Set_l_i(L(off_L + r));
+            m_rows[r].Set_b_i(Qc(off_L + r));
+        }
+    }
+
+    virtual void IntFromDescriptor(const unsigned int off_v,
+                                   ChStateDelta& v,
+                                   const unsigned int off_L,
+                                   ChVectorDynamic<>& L) override {
+        for (size_t r = 0; r < m_rows.size(); r++)
+            L(off_L + r) = m_rows[r].Get_l_i();
+    }
+
+    // Solver functions
+
+    virtual void InjectConstraints(ChSystemDescriptor& mdescriptor) override {
+        for (auto& row : m_rows)
+            mdescriptor.InsertConstraint(&row);
+    }
+
+    virtual void ConstraintsBiReset() override {
+        for (auto& row : m_rows)
+            row.Set_b_i(0.);
+    }
+
+    virtual void ConstraintsBiLoad_C(double factor = 1, double recovery_clamp = 0.1, bool do_clamp = false) override {
+        m_C.resize(m_rows.size());
+        ComputeViolation(m_C);
+        for (size_t r = 0; r < m_rows.size(); r++) {
+            double res = factor * m_C[r];
+            if (do_clamp)
+                res = std::min(std::max(res, -recovery_clamp), recovery_clamp);
+            m_rows[r].Set_b_i(m_rows[r].Get_b_i() + res);
+        }
+    }
+
+    virtual void ConstraintsLoadJacobians() override { LoadJacobians(); }
+
+    virtual void ConstraintsFetch_react(double factor = 1) override {
+        for (size_t r = 0; r < m_rows.size(); r++)
+            m_react(r) = m_rows[r].Get_l_i() * factor;
+    }
+
+  private:
+    // Constraint violations of all rows.
+    void ComputeViolation(std::vector<double>& C) const {
+        const ChMatrix33<>& A = m_body->GetA();
+        size_t np = m_nodes.size();
+        for (size_t i = 0; i < np; i++) {
+            ChVector<> d = A.transpose() * (m_nodes[i]->GetPos() - m_body->GetPos()) - m_pos_loc[i];
+            C[3 * i + 0] = d.x();
+            C[3 * i + 1] = d.y();
+            C[3 * i + 2] = d.z();
+        }
+        for (size_t i = 0; i < m_dir_nodes.size(); i++) {
+            ChVector<> g = A.transpose() * m_dir_nodes[i]->GetD();
+            C[3 * np + 2 * i + 0] = Vdot(m_dir_u[i], g);
+            C[3 * np + 2 * i + 1] = Vdot(m_dir_w[i], g);
+        }
+    }
+
+    // Jacobians of all rows, with respect to the node variables (position or direction) and the body variables
+    // (absolute linear velocity, local angular velocity).
+    void LoadJacobians() {
+        if (!m_body)
+            return;
+        const ChMatrix33<>& A = m_body->GetA();
+        size_t np = m_nodes.size();
+        for (size_t i = 0; i < np; i++) {
+            // d(A^T (x_n - x_b)) = A^T dx_n - A^T dx_b + [d]x w_loc, with d the node location in the body frame
+            ChVector<> d = A.transpose() * (m_nodes[i]->GetPos() - m_body->GetPos());
+            ChVector<> rot[3] = {ChVector<>(0, -d.z(), d.y()), ChVector<>(d.z(), 0, -d.x()),
+                                 ChVector<>(-d.y(), d.x(), 0)};
+            for (int k = 0; k < 3; k++) {
+                auto& row = m_rows[3 * i + k];
+                for (int j = 0; j < 3; j++) {
+                    row.Get_Cq_a()(j) = A(j, k);
+                    row.Get_Cq_b()(j) = -A(j, k);
+                    row.Get_Cq_b()(3 + j) = rot[k][j];
+                }
+            }
+        }
+        for (size_t i = 0; i < m_dir_nodes.size(); i++) {
+            // d(u . A^T D) = (A u) . dD + (u x g) . w_loc, with g = A^T D
+            ChVector<> g = A.transpose() * m_dir_nodes[i]->GetD();
+            const ChVector<>* axes[2] = {&m_dir_u[i], &m_dir_w[i]};
+            for (int k = 0; k < 2; k++) {
+                auto& row = m_rows[3 * np + 2 * i + k];
+                ChVector<> Au = A * (*axes[k]);
+                ChVector<> uxg = Vcross(*axes[k], g);
+                for (int j = 0; j < 3; j++) {
+                    row.Get_Cq_a()(j) = Au[j];
+                    row.Get_Cq_b()(j) = 0;
+                    row.Get_Cq_b()(3 + j) = uxg[j];
+                }
+            }
+        }
+    }
+
+    std::shared_ptr<ChBodyFrame> m_body;
+    std::vector<std::shared_ptr<ChNodeFEAxyz>> m_nodes;       // constrained nodes
+    std::vector<std::shared_ptr<ChNodeFEAxyzD>> m_dir_nodes;  // nodes with a constrained direction
+    std::vector<ChVector<>> m_pos_loc;                        // node locations in the body frame
+    std::vector<ChVector<>> m_dir_u;                          // directions orthogonal to the node direction,
+    std::vector<ChVector<>> m_dir_w;                          // in the body frame
+
+    std::vector<ChConstraintTwoGeneric> m_rows;  // position rows, then direction rows
+    ChVectorDynamic<> m_react;                   // Lagrange multipliers
+    std::vector<double> m_C;                     // constraint violations (workspace)
+};
+
+}  // end namespace fea
+}  // end namespace chrono
+
+#endif
@@ -44,6 +44,8 @@
 #include <omp.h>
 #endif
 
+#include "ANCFTireInput.h"
+
 using namespace chrono;
 using namespace fea;
 
@@ -94,112 +96,63 @@ void ReadInputFile(ChMatrixDynamic<double>& COORDFlex,
                    ChMatrixNM<double, 7, 12>& MPROP,
                    ChMatrixDynamic<double>& ElementLength,
                    ChVectorN<int, 3>& NumLayPerSect) {
-    FILE* inputfile;
-    char str1[100];
-    int numFlexBody = 0;
-    int dummy;
-    int count;
-
-    int NDR[4000][6];
-    int NumLayer[10];
-    int MaxSectionNumber = 0;
-    int MaxMatID = 0;
-    int MTYPE = 0;
-
-    int MAXCOUNT = 100;
-    inputfile = fopen(GetChronoDataFile("fea/ANCFtire/IndataBiLinearShell_Tire(HMMWV50x24).INP").c_str(), "r");
-    printf("Open IndataBiLinearShell_Tire(HMMWV50x24).INP \n");
-    if (inputfile == NULL) {
+    // Tables of the deck (parsed once and shared by all tires, or read from the binary cache of the deck)
+    auto data = LoadANCFTireInput(GetChronoDataFile("fea/ANCFtire/IndataBiLinearShell_Tire(HMMWV50x24).INP"));
+    if (!data) {
         printf("Input data file not found!!\n");
         exit(1);
     }
 
-    TotalNumElements = 0;
-    NumElements_x = 0;
-    NumElements_y = 0;
-    TotalNumNodes = 0;
+    TotalNumElements = data->TotalNumElements;
+    NumElements_x = data->NumElements_x;
+    NumElements_y = data->NumElements_y;
+    TotalNumNodes = data->TotalNumNodes;
 
     //!--------------------------------------!
     //!-- Elememt data            -----------!
     //!--------------------------------------!
-
-    fgets(str1, MAXCOUNT, inputfile);
-    printf("%s\n", str1);
-    fscanf(inputfile, "%d\n", &numFlexBody);
-
-    fgets(str1, MAXCOUNT, inputfile);
-    printf("%s\n", str1);
-    fscanf(inputfile, "%d %d %d %d\n", &TotalNumElements, &NumElements_x, &NumElements_y, &TotalNumNodes);
-    fgets(str1, MAXCOUNT, inputfile);
-    printf("%s\n", str1);
     for (int i = 0; i < TotalNumElements; i++) {
-        fscanf(inputfile, "%d %d %d %d %d %d %d\n", &count, &dummy, &SectionID(i), &NodesPerElement(i, 0),
-               &NodesPerElement(i, 1), &NodesPerElement(i, 3), &NodesPerElement(i, 2));
-        // printf("SectionID[i] %d\n  ", SectionID(i));
-
-        fscanf(inputfile, " %lf %lf\n", &ElementLength(i, 0), &ElementLength(i, 1));
-        if (MaxSectionNumber < SectionID(i)) {
-            MaxSectionNumber = SectionID(i);
-        }
-        // if(TotalNumNodes<max(NumNodes[i][0],max(NumNodes[i][1],max(NumNodes[i][2],NumNodes[i][3]))))
-        //{TotalNumNodes=max(NumNodes[i][0],max(NumNodes[i][1],max(NumNodes[i][2],NumNodes[i][3])));}
-
-        // printf("MaxSectionNumber %lf, %lf \n ", ElemLengthXY[i][0],ElemLengthXY[i][1]);
+        SectionID(i) = data->SectionID[i];
+        NodesPerElement(i, 0) = data->ElementNodes[4 * i + 0];
+        NodesPerElement(i, 1) = data->ElementNodes[4 * i + 1];
+        NodesPerElement(i, 3) = data->ElementNodes[4 * i + 2];
+        NodesPerElement(i, 2) = data->ElementNodes[4 * i + 3];
+        ElementLength(i, 0) = data->ElementLength[2 * i];
+        ElementLength(i, 1) = data->ElementLength[2 * i + 1];
     }
 
     //!--------------------------------------!
-    //!-- NDR,COORDFlex,VELCYFlex -----------!
+    //!-- COORDFlex,VELCYFlex ---------------!
     //!--------------------------------------!
-    // fscanf(inputfile,"%s\n",str1);
-    fgets(str1, MAXCOUNT, inputfile);
-    printf("%s\n", str1);
     for (int i = 0; i < TotalNumNodes; i++) {
-        fscanf(inputfile, "%d %d %d %d %d %d %d\n", &count, &NDR[i][0], &NDR[i][1], &NDR[i][2], &NDR[i][3], &NDR[i][4],
-               &NDR[i][5]);
-        fscanf(inputfile, "%lf %lf %lf %lf %lf %lf\n", &COORDFlex(i, 0), &COORDFlex(i, 1), &COORDFlex(i, 2),
-               &COORDFlex(i, 3), &COORDFlex(i, 4), &COORDFlex(i, 5));
-        fscanf(inputfile, "%lf %lf %lf %lf %lf %lf\n", &VELCYFlex(i, 0), &VELCYFlex(i, 1), &VELCYFlex(i, 2),
-               &VELCYFlex(i, 3), &VELCYFlex(i, 4), &VELCYFlex(i, 5));
+        for (int j = 0; j < 6; j++) {
+            COORDFlex(i, j) = data->COORDFlex[6 * i + j];
+            VELCYFlex(i, j) = data->VELCYFlex[6 * i + j];
+        }
     }
 
     //!--------------------------------------!
-    //!--- Read Layer Data ------------------!
+    //!--- Layer Data -----------------------!
     //!--------------------------------------!
-    // fscanf(inputfile,"%s\n",str1);
-    fgets(str1, MAXCOUNT, inputfile);
-    printf("%s\n", str1);
     int counted = 0;
-    for (int i = 0; i < MaxSectionNumber; i++) {
-        fscanf(inputfile, "%d %d\n", &count, &NumLayer[i]);
-        for (int j = 0; j < NumLayer[i]; j++) {
-            fscanf(inputfile, "%lf %lf %d\n", &LayerPROP(counted + j, 0), &LayerPROP(counted + j, 1), &MatID(i, j));
-            if (MaxMatID < MatID(i, j)) {
-                MaxMatID = MatID(i, j);
-            }
-            NumLayPerSect(i) = NumLayer[i];
-            // printf("%lf %lf %d\n%d\n", LayerPROP(counted + j, 0), LayerPROP(counted + j, 1), MatID(i, j), counted +
-            // j);
+    for (int i = 0; i < data->MaxSectionNumber; i++) {
+        for (int j = 0; j < data->NumLayer[i]; j++) {
+            LayerPROP(counted + j, 0) = data->LayerPROP[2 * (counted + j)];
+            LayerPROP(counted + j, 1) = data->LayerPROP[2 * (counted + j) + 1];
+            MatID(i, j) = data->LayerMatID[counted + j];
+            NumLayPerSect(i) = data->NumLayer[i];
         }
         counted += NumLayPerSect(i);
     }
 
     //!--------------------------------------!
-    //!--- Read Material Data ---------------!
+    //!--- Material Data --------------------!
     //!--------------------------------------!
-    // fscanf(inputfile,"%s\n",str1);
-    fgets(str1, MAXCOUNT, inputfile);
-    printf("%s\n", str1);
-    for (int i = 0; i < MaxMatID; i++) {
-        fscanf(inputfile, "%d %d\n", &count, &MTYPE);
-        if (MTYPE == 1) {
-            fscanf(inputfile, "%lf %lf %lf %lf\n", &MPROP(i, 0), &MPROP(i, 1), &MPROP(i, 2), &MPROP(i, 3));
-        }
-        if (MTYPE == 2) {
-            fscanf(inputfile, "%lf %lf %lf %lf\n", &MPROP(i, 0), &MPROP(i, 1), &MPROP(i, 2), &MPROP(i, 3));
-            fscanf(inputfile, "%lf %lf %lf %lf %lf %lf\n", &MPROP(i, 4), &MPROP(i, 5), &MPROP(i, 6), &MPROP(i, 7),
-                   &MPROP(i, 8), &MPROP(i, 9));
+    for (int i = 0; i < data->MaxMatID; i++) {
+        int NumProp = (data->MTYPE[i] == 1) ? 4 : (data->MTYPE[i] == 2) ? 10 : 0;
+        for (int j = 0; j < NumProp; j++) {
+            MPROP(i, j) = data->MPROP[10 * i + j];
         }
-        // printf("%lf %lf %lf %lf\n",MPROP[i][0],MPROP[i][1],MPROP[i][2],MPROP[i][3]);
     }
 };
 
@@ -296,7 +249,133 @@ class MyLoadCustomMultiple : public ChLoadCustomMultiple {
     virtual bool IsStiff() { return false; }
 };
 
+// Template of the ANCF tire mesh.
+// The data common to all tires of the vehicle (reference configuration of the nodes, element connectivity and
+// dimensions, layer definitions, and material objects) is read and set up once. Each tire is then created from the
+// template and a rigid transform, with all tires sharing the same material objects.
+class ANCFTireTemplate {
+  public:
+    ANCFTireTemplate() {
+        ChMatrixDynamic<double> COORDFlex(3000, 6);
+        ChMatrixDynamic<double> VELCYFlex(3000, 6);
+        ChMatrixDynamic<int> NodesPerElement(2880, 4);  // Defines the connectivity between the elements and nodes
+        ChMatrixDynamic<double> ElemLength(2880, 2);    // X and Y dimensions of the shell elements
+        ChVectorN<int, 2880> SectionID;                 // Catagorizes which tire section the elements are a part of
+        ChMatrixNM<double, 15, 2> LayPROP;              // Thickness and ply angles of the layered elements
+        ChMatrixNM<int, 15, 7> MatID;                   // Catagorizes the material of each layer
+        ChMatrixNM<double, 7, 12> MPROP;                // Material properties
+        ChVectorN<int, 3> NumLayPerSection;
+
+        ReadInputFile(COORDFlex, VELCYFlex, NodesPerElement, m_num_elements, m_num_elements_x, m_num_elements_y,
+                      m_num_nodes, SectionID, LayPROP, MatID, MPROP, ElemLength, NumLayPerSection);
+
+        //// Material List (for HMMWV)
+        //// i=0: Carcass
+        //// i=1: Steel belt in rubber matrix
+        //// i=2: Rubber
+        m_materials.resize(MPROP.rows());
+        for (int i = 0; i < MPROP.rows(); i++) {
+            double rho = MPROP(i, 0);
+            ChVector<double> E(MPROP(i, 1), MPROP(i, 2), MPROP(i, 3));
+            ChVector<double> nu(MPROP(i, 4), MPROP(i, 5), MPROP(i, 6));
+            ChVector<double> G(MPROP(i, 7), MPROP(i, 8), MPROP(i, 9));
+            m_materials[i] = chrono_types::make_shared<ChMaterialShellANCF>(rho, E, nu, G);
+        }
+
+        // Layers of the bead, sidewall, and tread sections
+        int LayerHist = 0;  // Number of layers in the previous tire sections
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < NumLayPerSection(i); j++) {
+                Layer layer;
+                layer.thickness = LayPROP(LayerHist + j, 0);
+                layer.angle = LayPROP(LayerHist + j, 1) * CH_C_DEG_TO_RAD;
+                layer.material = m_materials[MatID(i, j) - 1];
+                m_section_layers[i].push_back(layer);
+            }
+            LayerHist += NumLayPerSection(i);
+        }
+
+        m_nodes.resize(m_num_nodes);
+        for (int i = 0; i < m_num_nodes; i++) {
+            m_nodes[i].pos = ChVector<>(COORDFlex(i, 0), COORDFlex(i, 1), COORDFlex(i, 2));
+            m_nodes[i].D = ChVector<>(COORDFlex(i, 3), COORDFlex(i, 4), COORDFlex(i, 5));
+            m_nodes[i].pos_dt = ChVector<>(VELCYFlex(i, 0), VELCYFlex(i, 1), VELCYFlex(i, 2));
+            m_nodes[i].D_dt = ChVector<>(VELCYFlex(i, 3), VELCYFlex(i, 4), VELCYFlex(i, 5));
+        }
+
+        m_elements.resize(m_num_elements);
+        for (int i = 0; i < m_num_elements; i++) {
+            for (int j = 0; j < 4; j++)
+                m_elements[i].nodes[j] = NodesPerElement(i, j) - 1;
+            m_elements[i].lenX = ElemLength(i, 0);
+            m_elements[i].lenY = ElemLength(i, 1);
+            m_elements[i].section = SectionID(i) - 1;
+        }
+    }
+
+    int GetNumNodes() const { return m_num_nodes; }
+    int GetNumElements() const { return m_num_elements; }
+    int GetNumElementsX() const { return m_num_elements_x; }
+    int GetNumElementsY() const { return m_num_elements_y; }
+
+    /// Create the nodes and elements of a tire in the specified mesh.
+    /// The tire is placed with the given transform of the reference configuration of the template.
+    void Instantiate(std::shared_ptr<ChMesh> mesh, const ChFrame<>& frame) const {
+        std::vector<std::shared_ptr<ChNodeFEAxyzD>> nodes(m_num_nodes);
+        for (int i = 0; i < m_num_nodes; i++) {
+            const Node& ref = m_nodes[i];
+            nodes[i] = chrono_types::make_shared<ChNodeFEAxyzD>(frame.TransformPointLocalToParent(ref.pos),
+                                                                frame.TransformDirectionLocalToParent(ref.D));
+            nodes[i]->SetPos_dt(frame.TransformDirectionLocalToParent(ref.pos_dt));
+            nodes[i]->SetD_dt(frame.TransformDirectionLocalToParent(ref.D_dt));
+            nodes[i]->SetMass(0.0);
+            mesh->AddNode(nodes[i]);
+        }
+
+        for (int i = 0; i < m_num_elements; i++) {
+            const Element& ref = m_elements[i];
+            auto element = chrono_types::make_shared<ChElementShellANCF>();
+            element->SetNodes(nodes[ref.nodes[0]], nodes[ref.nodes[1]], nodes[ref.nodes[2]], nodes[ref.nodes[3]]);
+            element->SetDimensions(ref.lenX, ref.lenY);
+            for (const auto& layer : m_section_layers[ref.section])
+                element->AddLayer(layer.thickness, layer.angle, layer.material);
+            element->SetAlphaDamp(0.01);  // 0.005
+            element->SetGravityOn(true);
+            mesh->AddElement(element);
+        }
+    }
+
+  private:
+    struct Node {
+        ChVector<> pos;     // reference position
+        ChVector<> D;       // reference position gradient
+        ChVector<> pos_dt;  // initial velocity
+        ChVector<> D_dt;    // initial velocity of the gradient
+    };
+    struct Element {
+        int nodes[4];  // node indices (0-based)
+        double lenX;   // element dimensions
+        double lenY;
+        int section;   // tire section (0: bead, 1: sidewall, 2: tread)
+    };
+    struct Layer {
+        double thickness;
+        double angle;  // ply angle (rad)
+        std::shared_ptr<ChMaterialShellANCF> material;
+    };
+
+    int m_num_nodes;
+    int m_num_elements;
+    int m_num_elements_x;
+    int m_num_elements_y;
+    std::vector<Node> m_nodes;
+    std::vector<Element> m_elements;
+    std::vector<Layer> m_section_layers[3];
+    std::vector<std::shared_ptr<ChMaterialShellANCF>> m_materials;
+};
+
 void MakeANCFHumveeWheel(ChSystem& my_system,
+                         const ANCFTireTemplate& TireTemplate,
                          std::shared_ptr<ChMesh>& TireMesh,
                          const ChVector<> rim_center,
                          std::shared_ptr<ChBody>& Hub_1,
@@ -315,80 +394,17 @@ void MakeANCFHumveeWheel(ChSystem& my_system,
     Hub_1->SetWvel_par(ChVector<>(0, ForVelocity / (HumveeVertPos),
                                   0));  // 0.3 to be substituted by an actual measure of the average radius.
 
-    //  Fixing constraints, initial coordinates and velocities
-    // READ INPUT DATA AND CREATE ARRAYS
-
-    // Creating arrays for inputting data
     GetLog() << "\n-------------------------------------------------\n";
     GetLog() << "TEST: ANCF Tire (Fixed),  implicit integration \n\n";
 
-    // Boolean variables to determine which output files are written
-    bool output = true;
-    bool output1 = true;
-    bool output2 = true;
-    bool output3 = true;
-    bool output4 = true;
-
-    int TotalNumNodes;
-    // Matricies to hold the state informatino for the nodes and rigid bodies
-    ChMatrixDynamic<double> COORDFlex(3000, 6);
-    ChMatrixDynamic<double> VELCYFlex(3000, 6);
-    ChMatrixDynamic<double> ACCELFlex(3000, 6);
-
-    ChMatrixNM<double, 2, 7> COORDRigid;
-    ChMatrixNM<double, 2, 7> VELCYRigid;
-    ChMatrixNM<double, 2, 7> ACCELRigid;
-
-    ChMatrixDynamic<int> NodesPerElement(2880, 4);  // Defines the connectivity between the elements and nodes
-    ChMatrixDynamic<double> ElemLength(2880, 2);    // X and Y dimensions of the shell elements
-
-    int TotalNumElements;
-    int NumElements_x;
-    int NumElements_y;
-    ChVectorN<int, 2880> SectionID;  // Catagorizes which tire section the elements are a part of
-    ChMatrixNM<double, 15, 2> LayPROP;   // Thickness and ply angles of the layered elements
-    ChMatrixNM<int, 15, 7> MatID;        // Catagorizes the material of each layer
-    ChMatrixNM<double, 7, 12> MPROP;     // Material properties
-    ChVectorN<int, 3> NumLayPerSection;
-    double ContactZ = 0.0;  // Vertical location of the flat ground
-    ChVector<> NetContact;  // Net contact forces
-
-    // End of declaration of arrays for inputting data
-
-    // Read actual data file
-    ReadInputFile(COORDFlex, VELCYFlex, NodesPerElement, TotalNumElements, NumElements_x, NumElements_y, TotalNumNodes,
-                  SectionID, LayPROP, MatID, MPROP, ElemLength, NumLayPerSection);
-
-    ///////////////////////////////////////////////////////////////////////////
-    // Assign the humvee mesh properties to our ChMesh
-    //// Material List (for HMMWV)
-    //// i=0: Carcass
-    //// i=1: Steel belt in rubber matrix
-    //// i=2: Rubber
-    ///////////////////////////////////////////////////////////////////////////
-
-    std::vector<std::shared_ptr<ChMaterialShellANCF>> MaterialList(MPROP.rows());
-    for (int i = 0; i < MPROP.rows(); i++) {
-        double rho = MPROP(i, 0);
-        ChVector<double> E(MPROP(i, 1), MPROP(i, 2), MPROP(i, 3));
-        ChVector<double> nu(MPROP(i, 4), MPROP(i, 5), MPROP(i, 6));
-        ChVector<double> G(MPROP(i, 7), MPROP(i, 8), MPROP(i, 9));
-        MaterialList[i] = chrono_types::make_shared<ChMaterialShellANCF>(rho, E, nu, G);
-    }
+    int TotalNumNodes = TireTemplate.GetNumNodes();
+    int TotalNumElements = TireTemplate.GetNumElements();
+    int NumElements_x = TireTemplate.GetNumElementsX();
+
+    // Create the nodes and elements of the tire from the template (the template mesh is centered at the origin in the
+    // horizontal plane)
+    TireTemplate.Instantiate(TireMesh, ChFrame<>(ChVector<>(rim_center.x(), rim_center.y(), 0.0)));
 
-    // Create a set of nodes for the tire based on the input data
-    for (int i = 0; i < TotalNumNodes; i++) {
-        auto node = chrono_types::make_shared<ChNodeFEAxyzD>(
-            ChVector<>(COORDFlex(i, 0) + rim_center.x(), COORDFlex(i, 1) + rim_center.y(), COORDFlex(i, 2)),
-            ChVector<>(COORDFlex(i, 3), COORDFlex(i, 4), COORDFlex(i, 5)));
-        node->SetPos_dt(ChVector<>(VELCYFlex(i, 0), VELCYFlex(i, 1), VELCYFlex(i, 2)));
-        node->SetD_dt(ChVector<>(VELCYFlex(i, 3), VELCYFlex(i, 4), VELCYFlex(i, 5)));
-        node->SetPos_dtdt(ChVector<>(ACCELFlex(i, 0), ACCELFlex(i, 1), ACCELFlex(i, 2)));
-        node->SetD_dtdt(ChVector<>(ACCELFlex(i, 3), ACCELFlex(i, 4), ACCELFlex(i, 5)));
-        node->SetMass(0.0);
-
-        TireMesh->AddNode(node);  // Add nodes to the system
-    }
     // Check position of the bottom node
     GetLog() << "TotalNumNodes: " << TotalNumNodes << "\n\n";
     auto nodetip = std::dynamic_pointer_cast<ChNodeFEAxyzD>(TireMesh->GetNode((TotalNumElements / 2)));
@@ -397,48 +413,6 @@ void MakeANCFHumveeWheel(ChSystem& my_system,
     GetLog() << "dX : " << nodetip->GetD().x() << " dY : " << nodetip->GetD().y() << " dZ : " << nodetip->GetD().z()
              << "\n\n";
 
-    int LayerHist = 0;  // Number of layers in the previous tire sections
-
-    // Create all elements of the tire
-    for (int i = 0; i < TotalNumElements; i++) {
-        auto element = chrono_types::make_shared<ChElementShellANCF>();
-        element->SetNodes(std::dynamic_pointer_cast<ChNodeFEAxyzD>(TireMesh->GetNode(NodesPerElement(i, 0) - 1)),
-                          std::dynamic_pointer_cast<ChNodeFEAxyzD>(TireMesh->GetNode(NodesPerElement(i, 1) - 1)),
-                          std::dynamic_pointer_cast<ChNodeFEAxyzD>(TireMesh->GetNode(NodesPerElement(i, 2) - 1)),
-                          std::dynamic_pointer_cast<ChNodeFEAxyzD>(TireMesh->GetNode(NodesPerElement(i, 3) - 1)));
-        element->SetDimensions(ElemLength(i, 0), ElemLength(i, 1));
-
-        // Determine the section in which the current element resides
-        switch (SectionID(i)) {
-            // Bead section
-            case 1: {
-                LayerHist = 0;
-                break;
-            }
-            // Sidewall section
-            case 2: {
-                LayerHist = NumLayPerSection(0);
-                break;
-            }
-            // Tread section
-            case 3: {
-                LayerHist = NumLayPerSection(0) + NumLayPerSection(1);
-                break;
-            }
-        }  // End of switch
-
-        // Give material properties to elements as a construction of layers
-        for (int j = 0; j < NumLayPerSection(SectionID(i) - 1); j++) {
-            element->AddLayer(LayPROP(LayerHist + j, 0), LayPROP(LayerHist + j, 1) * CH_C_DEG_TO_RAD,
-                              MaterialList[MatID(SectionID(i) - 1, j) - 1]);
-            // GetLog() << "Thickness: " << LayPROP(LayerHist + j, 0) << "  Ply: " << LayPROP(LayerHist + j, 1) << "
-            // Mat: " << MatID(SectionID(i) - 1, j) << "\n";
-            // GetLog() << "Index: " << LayerHist + j << "   PRev: " << LayerHist << "\n";
-        }
-        element->SetAlphaDamp(0.01);  // 0.005
-        element->SetGravityOn(true);
-        TireMesh->AddElement(element);
-    }
     // End of assigning properties to TireMesh (ChMesh)
     // Create constraints for the tire and rim
     // Constrain the flexible tire to the rigid rim body.
@@ -557,10 +531,13 @@ int main(int argc, char* argv[]) {
     auto TireMesh3 = chrono_types::make_shared<ChMesh>();
     auto TireMesh4 = chrono_types::make_shared<ChMesh>();
 
-    MakeANCFHumveeWheel(my_system, TireMesh1, rim_center_1, Hub_1, TirePressure, ForVelocity, 2);
-    MakeANCFHumveeWheel(my_system, TireMesh2, rim_center_2, Hub_2, TirePressure, ForVelocity, 3);
-    MakeANCFHumveeWheel(my_system, TireMesh3, rim_center_3, Hub_3, TirePressure, ForVelocity, 4);
-    MakeANCFHumveeWheel(my_system, TireMesh4, rim_center_4, Hub_4, TirePressure, ForVelocity, 5);
+    // The tire mesh data is read and set up once, and shared by the 4 tires
+    ANCFTireTemplate TireTemplate;
+
+    MakeANCFHumveeWheel(my_system, TireTemplate, TireMesh1, rim_center_1, Hub_1, TirePressure, ForVelocity, 2);
+    MakeANCFHumveeWheel(my_system, TireTemplate, TireMesh2, rim_center_2, Hub_2, TirePressure, ForVelocity, 3);
+    MakeANCFHumveeWheel(my_system, TireTemplate, TireMesh3, rim_center_3, Hub_3, TirePressure, ForVelocity, 4);
+    MakeANCFHumveeWheel(my_system, TireTemplate, TireMesh4, rim_center_4, Hub_4, TirePressure, ForVelocity, 5);
 
     auto mmaterial = chrono_types::make_shared<ChMaterialSurfaceNSC>();
     mmaterial->SetFriction(0.4f);
@@ -34,6 +34,8 @@
 #include "chrono_pardisomkl/ChSolverPardisoMKL.h"
 #include "chrono_irrlicht/ChIrrApp.h"
 
+#include "AbaqusMeshInput.h"
+
 using namespace chrono;
 using namespace chrono::fea;
 using namespace chrono::irrlicht;
@@ -61,14 +63,20 @@ void MakeWheel(ChSystemSMC& my_system,
     auto my_mesh = chrono_types::make_shared<ChMesh>();
 
     // Load an ABAQUS .INP tetahedron mesh file from disk, defining a tetahedron mesh.
+    // The mesh topology is read from its binary cache (if up to date), with nodes renumbered for bandwidth reduction.
     std::map<std::string, std::vector<std::shared_ptr<ChNodeFEAbase>>> node_sets;
 
-    try {
-        ChMeshFileLoader::FromAbaqusFile(my_mesh, GetChronoDataFile("fea/tractor_wheel_coarse.INP").c_str(), mmaterial,
-                                         node_sets, tire_center, mscale * malign);
-    } catch (ChException myerr) {
-        GetLog() << myerr.what();
-        return;
+    std::string mesh_file = GetChronoDataFile("fea/tractor_wheel_coarse.INP");
+    if (auto mesh_data = LoadAbaqusMesh(mesh_file)) {
+        BuildAbaqusMesh(*mesh_data, my_mesh, mmaterial, node_sets, tire_center, mscale * malign);
+    } else {
+        try {
+            ChMeshFileLoader::FromAbaqusFile(my_mesh, mesh_file.c_str(), mmaterial, node_sets, tire_center,
+                                             mscale * malign);
+        } catch (ChException myerr) {
+            GetLog() << myerr.what();
+            return;
+        }
     }
 
     // Create the contact surface(s).
@@ -32,6 +32,8 @@
 #include "chrono/fea/ChLoadsBeam.h"
 #include "chrono/fea/ChMesh.h"
 
+#include "NodeSetConstraint.h"
+
 ////#undef CHRONO_PARDISO_MKL
 #ifdef CHRONO_PARDISO_MKL
 #include "chrono_pardisomkl/ChSolverPardisoMKL.h"
@@ -49,16 +51,19 @@ using namespace chrono::fea;
 // The first node is at the origin and is constrained to ground using a ChLinkPointFrame
 // constraint and, optionally, a ChLinkDirFrame constraint (as specified through the
 // boolean argument 'constrain_dir').
+// If 'use_node_set' is true, the same constraints are imposed with a single ChLinkNodeSetFrame.
 // The argument 'dir' defines the initial beam configuration.
 void test_beam(const std::string& name,  /// test name
                const ChVector<>& dir,    /// initial beam orientation
                double alpha,             /// damping coefficient
                bool constrain_dir,       /// if true, include ChLinkFirFrame constraints
+               bool use_node_set,        /// if true, use a ChLinkNodeSetFrame constraint
                double duration           /// simulation length
                ) {
     std::cout << "=== Test " << name << " ===" << std::endl;
     std::cout << "Beam direction: " << dir.x() << " " << dir.y() << " " << dir.z() << std::endl;
     std::cout << "Constrain direction? " << constrain_dir << std::endl;
+    std::cout << "Node set constraint? " << use_node_set << std::endl;
 
     // Create the system
     ChSystemNSC my_system;
@@ -97,13 +102,21 @@ void test_beam(const std::string& name,  /// test name
     mesh->AddElement(beam_elem);
 
     // Create a hinge constraint
-    auto point_cnstr = chrono_types::make_shared<ChLinkPointFrame>();
-    point_cnstr->Initialize(node1, ground);
-    my_system.Add(point_cnstr);
+    std::shared_ptr<ChLinkPointFrame> point_cnstr;
+    std::shared_ptr<ChLinkNodeSetFrame> set_cnstr;
+    if (use_node_set) {
+        set_cnstr = chrono_types::make_shared<ChLinkNodeSetFrame>();
+        set_cnstr->Initialize({node1}, ground, constrain_dir);
+        my_system.Add(set_cnstr);
+    } else {
+        point_cnstr = chrono_types::make_shared<ChLinkPointFrame>();
+        point_cnstr->Initialize(node1, ground);
+        my_system.Add(point_cnstr);
+    }
 
     // Create a direction constraint
     std::shared_ptr<ChLinkDirFrame> dir_cnstr;
-    if (constrain_dir) {
+    if (constrain_dir && !use_node_set) {
         dir_cnstr = chrono_types::make_shared<ChLinkDirFrame>();
         dir_cnstr->Initialize(node1, ground);
         my_system.Add(dir_cnstr);
@@ -155,13 +168,17 @@ void test_beam(const std::string& name,  /// test name
 
         ChVector<> pos = node2->GetPos();
 
-        {
+        if (use_node_set) {
+            rforce = ground->TransformDirectionLocalToParent(set_cnstr->GetReactionOnBody(0));
+            if (constrain_dir)
+                rtorque = ground->TransformDirectionLocalToParent(set_cnstr->GetReactionTorqueOnBody(0));
+        } else {
             ChCoordsys<> csys = point_cnstr->GetLinkAbsoluteCoords();
             rforce = point_cnstr->GetReactionOnBody();
             rforce = csys.TransformDirectionLocalToParent(rforce);
         }
 
-        if (constrain_dir) {
+        if (constrain_dir && !use_node_set) {
             ChCoordsys<> csys = dir_cnstr->GetLinkAbsoluteCoords();
             rtorque = dir_cnstr->GetReactionOnBody();
             rtorque = csys.TransformDirectionLocalToParent(rtorque);
@@ -260,13 +277,20 @@ int main(int argc, char* argv[]) {
     // Set path to Chrono data directory
     SetChronoDataPath(CHRONO_DATA_DIR);
 
-    test_beam("hinge", ChVector<>(0, 0, -1), 0.005, false, 0.75);
+    test_beam("hinge", ChVector<>(0, 0, -1), 0.005, false, false, 0.75);
 
-    test_beam("cantilever1", ChVector<>(1, 0, 0), 0.1, true, 2.5);
+    test_beam("cantilever1", ChVector<>(1, 0, 0), 0.1, true, false, 2.5);
 
     ChVector<> dir(1, 0, -1);
     dir.Normalize();
-    test_beam("cantilever2", dir, 0.15, true, 2.5);
+    test_beam("cantilever2", dir, 0.15, true, false, 2.5);
+
+    // Same tests, with node set constraints (results must match the ChLinkPointFrame/ChLinkDirFrame ones)
+    test_beam("hinge_set", ChVector<>(0, 0, -1), 0.005, false, true, 0.75);
+
+    test_beam("cantilever1_set", ChVector<>(1, 0, 0), 0.1, true, true, 2.5);
+
+    test_beam("cantilever2_set", dir, 0.15, true, true, 2.5);
 
     return 0;
 }
@@ -16,6 +16,9 @@
 //
 // =============================================================================
 
+#include <cstring>
+
+#include "chrono/core/ChTimer.h"
 #include "chrono/physics/ChSystemNSC.h"
 #include "chrono/physics/ChLinkMate.h"
 #include "chrono/physics/ChLinkLock.h"
@@ -35,6 +38,8 @@
 #include "chrono_matlab/ChMatlabEngine.h"
 #include "chrono_matlab/ChSolverMatlab.h"
 
+#include "MatlabSolverBridge.h"
+
 using namespace chrono;
 using namespace chrono::fea;
 using namespace chrono::irrlicht;
@@ -330,9 +335,19 @@ int main(int argc, char* argv[]) {
     my_system.SetSolverForceTolerance(1e-12);
 
     //***TEST***
+    // Use the Matlab bridge (matrix and factorization kept in the engine workspace), or with '-reference' the
+    // ChSolverMatlab solver (all matrices sent and solved at each call)
+    bool reference = (argc > 1 && strcmp(argv[1], "-reference") == 0);
     ChMatlabEngine matlab_engine;
-    auto matlab_solver = chrono_types::make_shared<ChSolverMatlab>(matlab_engine);
-    my_system.SetSolver(matlab_solver);
+    std::shared_ptr<ChSolverMatlabBridge> bridge_solver;
+    ChTimer<double> timer_solver;
+    if (reference) {
+        auto matlab_solver = chrono_types::make_shared<ChSolverMatlab>(matlab_engine);
+        my_system.SetSolver(matlab_solver);
+    } else {
+        bridge_solver = chrono_types::make_shared<ChSolverMatlabBridge>(matlab_engine);
+        my_system.SetSolver(bridge_solver);
+    }
 
     my_system.Set_G_acc(ChVector<>(0, 0, 0));
 
@@ -362,10 +377,17 @@ int main(int argc, char* argv[]) {
         tools::drawGrid(application.GetVideoDriver(), 0.2, 0.2, 10, 10, ChCoordsys<>(VNULL, CH_C_PI_2, VECT_Z),
                         video::SColor(50, 90, 100, 100), true);
 
+        timer_solver.start();
         application.DoStep();
+        timer_solver.stop();
 
         application.EndScene();
     }
 
+    GetLog() << "Total step time (" << (reference ? "ChSolverMatlab" : "Matlab bridge") << "): " << timer_solver()
+             << " s\n";
+    if (bridge_solver)
+        bridge_solver->PrintStats();
+
     return 0;
 }
@@ -27,6 +27,8 @@
 
 #include "chrono_thirdparty/filesystem/path.h"
 
+#include "../MeshSnapshot.h"
+
 #ifdef CHRONO_PARDISO_MKL
 #include "chrono_pardisomkl/ChSolverPardisoMKL.h"
 #endif
@@ -60,6 +62,9 @@ std::string out_dir = "../TEST_SHELL_ANCF";  // name of output directory
 bool output = true;                         // generate output file?
 bool verbose = true;                         // verbose output?
 
+int snapshot_steps = 5;    // number of steps between restart snapshots (0: no snapshots)
+bool resume = false;       // continue interrupted runs from their last snapshot?
+
 // -----------------------------------------------------------------------------
 
 void RunModel(int nthreads,              // number of OpenMP threads
@@ -229,6 +234,18 @@ void RunModel(int nthreads,              // number of OpenMP threads
     mystepper->SetScaling(true);
     mystepper->SetVerbose(verbose);
 
+    // Continue from the last snapshot of this run, if requested
+    char snapshot_file[100];
+    std::sprintf(snapshot_file, "%s/snapshot_%s.bin", out_dir.c_str(), suffix.c_str());
+    int first_step = 0;
+    if (resume && ReadMeshSnapshot(my_system, first_step, snapshot_file)) {
+        cout << "Continue from step " << first_step << " (t = " << my_system.GetChTime() << ")" << endl;
+        if (first_step >= num_steps) {
+            cout << "Run already completed" << endl;
+            return;
+        }
+    }
+
     // Initialize the output stream and set precision.
     utils::CSV_writer out("\t");
     out.stream().setf(std::ios::scientific | std::ios::showpos);
@@ -256,7 +273,10 @@ void RunModel(int nthreads,              // number of OpenMP threads
     int num_force_calls = 0;
     int num_jacobian_calls = 0;
 
-    for (int istep = 0; istep < num_steps; istep++) {
+    int num_snapshots = 0;
+    double time_snapshot = 0;
+
+    for (int istep = first_step; istep < num_steps; istep++) {
         if (verbose) {
             cout << "-------------------------------------------------------------------" << endl;
             cout << "STEP: " << istep << endl;
@@ -365,12 +385,23 @@ void RunModel(int nthreads,              // number of OpenMP threads
         if (output) {
             out << my_system.GetChTime() << my_system.GetTimerStep() << nodetip->GetPos() << endl;
         }
+
+        if (snapshot_steps > 0 && (istep + 1) % snapshot_steps == 0) {
+            ChTimer<double> timer;
+            timer.start();
+            if (WriteMeshSnapshot(my_system, istep + 1, snapshot_file))
+                num_snapshots++;
+            else
+                cout << "Error writing snapshot " << snapshot_file << endl;
+            timer.stop();
+            time_snapshot += timer();
+        }
     }
 
     double time_other = time_total - time_setup - time_solve - time_update - time_force - time_jacobian;
 
     cout << "-------------------------------------------------------------------" << endl;
-    cout << "Total number of steps:        " << num_steps - skip_steps << endl;
+    cout << "Total number of steps:        " << num_steps - std::max(first_step, skip_steps) << endl;
     cout << "Total number of iterations:   " << num_iterations << endl;
     cout << "Total number of setup calls:  " << num_setup_calls << endl;
     cout << "Total number of solver calls: " << num_solver_calls << endl;
@@ -405,21 +436,32 @@ void RunModel(int nthreads,              // number of OpenMP threads
     cout << "  Other:    " << time_other << "\t (" << (time_other / time_total) * 100 << "%)" << endl;
     cout << endl;
     cout << "Time for skipped steps (" << skip_steps << "): " << time_skipped << endl;
+    cout << "Snapshots written: " << num_snapshots << " (" << time_snapshot << ")" << endl;
 
     if (output) {
         char name[100];
-        std::sprintf(name, "%s/out_%s_%d.txt", out_dir.c_str(), suffix.c_str(), num_threads);
+        if (first_step > 0)
+            std::sprintf(name, "%s/out_%s_%d_from%d.txt", out_dir.c_str(), suffix.c_str(), num_threads, first_step);
+        else
+            std::sprintf(name, "%s/out_%s_%d.txt", out_dir.c_str(), suffix.c_str(), num_threads);
         cout << "Write output to: " << name << endl;
         out.write_to_file(name);
     }
 }
 
 int main(int argc, char* argv[]) {
+    // Usage: test_FEA_shellANCF [num_threads] [-continue]
+    // With -continue, each run starts from its last snapshot (if any) in the output directory.
+    if (argc > 1 && std::string(argv[argc - 1]) == "-continue") {
+        resume = true;
+        argc--;
+    }
+
     // Set path to Chrono data directory
     SetChronoDataPath(CHRONO_DATA_DIR);
 
     // Create output directory (if it does not already exist).
-    if (output) {
+    if (output || snapshot_steps > 0) {
         if (!filesystem::create_directory(filesystem::path("../TEST_SHELL_ANCF"))) {
             GetLog() << "Error creating directory ../TEST_SHELL_ANCF\n";
             return 1;
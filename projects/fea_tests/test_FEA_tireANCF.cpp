@@ -44,6 +44,8 @@
 #include <omp.h>
 #endif
 
+#include "ANCFTireInput.h"
+
 using namespace chrono;
 using namespace fea;
 
@@ -94,112 +96,63 @@ void ReadInputFile(ChMatrixDynamic<double>& COORDFlex,
                    ChMatrixNM<double, 7, 12>& MPROP,
                    ChMatrixDynamic<double>& ElementLength,
                    ChVectorN<int, 3>& NumLayPerSect) {
-    FILE* inputfile;
-    char str1[100];
-    int numFlexBody = 0;
-    int dummy;
-    int count;
-
-    int NDR[4000][6];
-    int NumLayer[10];
-    int MaxSectionNumber = 0;
-    int MaxMatID = 0;
-    int MTYPE = 0;
-
-    int MAXCOUNT = 100;
-    inputfile = fopen(GetChronoDataFile("fea/ANCFtire/IndataBiLinearShell_Tire(HMMWV50x24).INP").c_str(), "r");
-    printf("Open IndataBiLinearShell_Tire(HMMWV50x24).INP \n");
-    if (inputfile == NULL) {
+    // Tables of the deck (parsed once and shared by all tires, or read from the binary cache of the deck)
+    auto data = LoadANCFTireInput(GetChronoDataFile("fea/ANCFtire/IndataBiLinearShell_Tire(HMMWV50x24).INP"));
+    if (!data) {
         printf("Input data file not found!!\n");
         exit(1);
     }
 
-    TotalNumElements = 0;
-    NumElements_x = 0;
-    NumElements_y = 0;
-    TotalNumNodes = 0;
+    TotalNumElements = data->TotalNumElements;
+    NumElements_x = data->NumElements_x;
+    NumElements_y = data->NumElements_y;
+    TotalNumNodes = data->TotalNumNodes;
 
     //!--------------------------------------!
     //!-- Elememt data            -----------!
     //!--------------------------------------!
-
-    fgets(str1, MAXCOUNT, inputfile);
-    printf("%s\n", str1);
-    fscanf(inputfile, "%d\n", &numFlexBody);
-
-    fgets(str1, MAXCOUNT, inputfile);
-    printf("%s\n", str1);
-    fscanf(inputfile, "%d %d %d %d\n", &TotalNumElements, &NumElements_x, &NumElements_y, &TotalNumNodes);
-    fgets(str1, MAXCOUNT, inputfile);
-    printf("%s\n", str1);
     for (int i = 0; i < TotalNumElements; i++) {
-        fscanf(inputfile, "%d %d %d %d %d %d %d\n", &count, &dummy, &SectionID(i, 0), &NodesPerElement(i, 0),
-               &NodesPerElement(i, 1), &NodesPerElement(i, 3), &NodesPerElement(i, 2));
-        // printf("SectionID[i] %d\n  ", SectionID(i, 0));
-
-        fscanf(inputfile, " %lf %lf\n", &ElementLength(i, 0), &ElementLength(i, 1));
-        if (MaxSectionNumber < SectionID(i, 0)) {
-            MaxSectionNumber = SectionID(i, 0);
-        }
-        // if(TotalNumNodes<max(NumNodes[i][0],max(NumNodes[i][1],max(NumNodes[i][2],NumNodes[i][3]))))
-        //{TotalNumNodes=max(NumNodes[i][0],max(NumNodes[i][1],max(NumNodes[i][2],NumNodes[i][3])));}
-
-        // printf("MaxSectionNumber %lf, %lf \n ", ElemLengthXY[i][0],ElemLengthXY[i][1]);
+        SectionID(i) = data->SectionID[i];
+        NodesPerElement(i, 0) = data->ElementNodes[4 * i + 0];
+        NodesPerElement(i, 1) = data->ElementNodes[4 * i + 1];
+        NodesPerElement(i, 3) = data->ElementNodes[4 * i + 2];
+        NodesPerElement(i, 2) = data->ElementNodes[4 * i + 3];
+        ElementLength(i, 0) = data->ElementLength[2 * i];
+        ElementLength(i, 1) = data->ElementLength[2 * i + 1];
     }
 
     //!--------------------------------------!
-    //!-- NDR,COORDFlex,VELCYFlex -----------!
+    //!-- COORDFlex,VELCYFlex ---------------!
     //!--------------------------------------!
-    // fscanf(inputfile,"%s\n",str1);
-    fgets(str1, MAXCOUNT, inputfile);
-    printf("%s\n", str1);
     for (int i = 0; i < TotalNumNodes; i++) {
-        fscanf(inputfile, "%d %d %d %d %d %d %d\n", &count, &NDR[i][0], &NDR[i][1], &NDR[i][2], &NDR[i][3], &NDR[i][4],
-               &NDR[i][5]);
-        fscanf(inputfile, "%lf %lf %lf %lf %lf %lf\n", &COORDFlex(i, 0), &COORDFlex(i, 1), &COORDFlex(i, 2),
-               &COORDFlex(i, 3), &COORDFlex(i, 4), &COORDFlex(i, 5));
-        fscanf(inputfile, "%lf %lf %lf %lf %lf %lf\n", &VELCYFlex(i, 0), &VELCYFlex(i, 1), &VELCYFlex(i, 2),
-               &VELCYFlex(i, 3), &VELCYFlex(i, 4), &VELCYFlex(i, 5));
+        for (int j = 0; j < 6; j++) {
+            COORDFlex(i, j) = data->COORDFlex[6 * i + j];
+            VELCYFlex(i, j) = data->VELCYFlex[6 * i + j];
+        }
     }
 
     //!--------------------------------------!
-    //!--- Read Layer Data ------------------!
+    //!--- Layer Data -----------------------!
     //!--------------------------------------!
-    // fscanf(inputfile,"%s\n",str1);
-    fgets(str1, MAXCOUNT, inputfile);
-    printf("%s\n", str1);
     int counted = 0;
-    for (int i = 0; i < MaxSectionNumber; i++) {
-        fscanf(inputfile, "%d %d\n", &count, &NumLayer[i]);
-        for (int j = 0; j < NumLayer[i]; j++) {
-            fscanf(inputfile, "%lf %lf %d\n", &LayerPROP(counted + j, 0), &LayerPROP(counted + j, 1), &MatID(i, j));
-            if (MaxMatID < MatID(i, j)) {
-                MaxMatID = MatID(i, j);
-            }
-            NumLayPerSect(i) = NumLayer[i];
-            // printf("%lf %lf %d\n%d\n", LayerPROP(counted + j, 0), LayerPROP(counted + j, 1), MatID(i, j), counted +
-            // j);
+    for (int i = 0; i < data->MaxSectionNumber; i++) {
+        for (int j = 0; j < data->NumLayer[i]; j++) {
+            LayerPROP(counted + j, 0) = data->LayerPROP[2 * (counted + j)];
+            LayerPROP(counted + j, 1) = data->LayerPROP[2 * (counted + j) + 1];
+            MatID(i, j) = data->LayerMatID[counted + j];
+            NumLayPerSect(i) = data->NumLayer[i];
         }
         counted += NumLayPerSect(i);
     }
 
     //!--------------------------------------!
-    //!--- Read Material Data ---------------!
+    //!--- Material Data --------------------!
     //!--------------------------------------!
-    // fscanf(inputfile,"%s\n",str1);
-    fgets(str1, MAXCOUNT, inputfile);
-    printf("%s\n", str1);
-    for (int i = 0; i < MaxMatID; i++) {
-        fscanf(inputfile, "%d %d\n", &count, &MTYPE);
-        if (MTYPE == 1) {
-            fscanf(inputfile, "%lf %lf %lf %lf\n", &MPROP(i, 0), &MPROP(i, 1), &MPROP(i, 2), &MPROP(i, 3));
-        }
-        if (MTYPE == 2) {
-            fscanf(inputfile, "%lf %lf %lf %lf\n", &MPROP(i, 0), &MPROP(i, 1), &MPROP(i, 2), &MPROP(i, 3));
-            fscanf(inputfile, "%lf %lf %lf %lf %lf %lf\n", &MPROP(i, 4), &MPROP(i, 5), &MPROP(i, 6), &MPROP(i, 7),
-                   &MPROP(i, 8), &MPROP(i, 9));
+    for (int i = 0; i < data->MaxMatID; i++) {
+        int NumProp = (data->MTYPE[i] == 1) ? 4 : (data->MTYPE[i] == 2) ? 10 : 0;
+        for (int j = 0; j < NumProp; j++) {
+            MPROP(i, j) = data->MPROP[10 * i + j];
         }
-        // printf("%lf %lf %lf %lf\n",MPROP[i][0],MPROP[i][1],MPROP[i][2],MPROP[i][3]);
     }
 };
 
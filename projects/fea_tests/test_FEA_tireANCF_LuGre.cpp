@@ -17,7 +17,12 @@
 // Global direction of rolling is assumed along the X axis
 // [LuGre contact formulation needs to be modified for other cases]
 
+#include <algorithm>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
 
 #include "chrono/physics/ChSystemNSC.h"
 #include "chrono/physics/ChBodyEasy.h"
@@ -36,6 +41,10 @@
 #include "chrono_irrlicht/ChIrrApp.h"
 #include "chrono_pardisomkl/ChSolverPardisoMKL.h"
 
+#include "ANCFTireInput.h"
+#include "NodeSetConstraint.h"
+#include "../pardiso_reuse.h"
+
 // Remember to use the namespace 'chrono' because all classes
 // of Chrono::Engine belong to this namespace and its children...
 
@@ -46,21 +55,47 @@ using namespace chrono::irrlicht;
 using namespace irr;
 using namespace irr::scene;
 
+// Evaluation of the Jacobians of the ground contact loads:
+//   NUMERIC:  finite differences of ComputeQ (one evaluation of Q per state coordinate)
+//   ANALYTIC: closed-form derivatives of the nodal contact forces (one evaluation of Q)
+//   CHECK:    evaluate both, report their relative difference, and use the analytic Jacobian
+enum class JacobianMode { NUMERIC, ANALYTIC, CHECK };
+
+// Report the relative difference between the analytic and numeric Jacobians of a load.
+void ReportJacobianCheck(const char* name,
+                         ChMatrixConstRef K,
+                         ChMatrixConstRef R,
+                         const ChMatrixDynamic<double>& Knum,
+                         const ChMatrixDynamic<double>& Rnum) {
+    double Knorm = Knum.norm();
+    double Rnorm = Rnum.norm();
+    double Kerr = (K - Knum).norm();
+    double Rerr = (R - Rnum).norm();
+    GetLog() << name << " Jacobian check:  K rel. diff = " << (Knorm > 0 ? Kerr / Knorm : Kerr)
+             << "  R rel. diff = " << (Rnorm > 0 ? Rerr / Rnorm : Rerr) << "\n";
+}
+
 class ChCoulombFriction : public ChLoadCustomMultiple {
   public:
-    ChCoulombFriction(std::vector<std::shared_ptr<ChLoadable>>& mloadables) : ChLoadCustomMultiple(mloadables){};
+    ChCoulombFriction(std::vector<std::shared_ptr<ChLoadable>>& mloadables)
+        : ChLoadCustomMultiple(mloadables),
+          FlexPos(6, (int)mloadables.size()),
+          FlexVel(6, (int)mloadables.size()){};
 
     int NumContact;
     const double Mu0 = 0.6;
     double ContactLine;
     ChVector<> NetContactForce;
     ChVector<> ContactForce;
+    JacobianMode jacobian_mode = JacobianMode::ANALYTIC;
+
+    // Workspace for ComputeQ (sized at construction, so that no allocation occurs during the simulation)
+    ChMatrixDynamic<double> FlexPos;  // Matrix of nodal coordinates
+    ChMatrixDynamic<double> FlexVel;  // Matrix of nodal velocities
 
     virtual void ComputeQ(ChState* state_x,      ///< state position to evaluate Q
                           ChStateDelta* state_w  ///< state speed to evaluate Q
                           ) {
-        ChMatrixDynamic<double> FlexPos(6, (int)loadables.size());
-        ChMatrixDynamic<double> FlexVel(6, (int)loadables.size());
         double Kg;
         double Cg;
         double DeltaDis;
@@ -146,6 +181,66 @@ class ChCoulombFriction : public ChLoadCustomMultiple {
 
     }  // end of Compute_Q
 
+    // Jacobians of the contact forces. The normal force of a node only depends on its own vertical position and
+    // velocity, and the Coulomb force in each direction on the normal force and the sliding velocity in that
+    // direction, so that K = -dQ/dx and R = -dQ/dv have at most 3 nonzero entries per contacting node.
+    virtual void ComputeJacobian(ChState* state_x,       ///< state position to evaluate jacobians
+                                 ChStateDelta* state_w,  ///< state speed to evaluate jacobians
+                                 ChMatrixRef mK,         ///< result dQ/dx
+                                 ChMatrixRef mR,         ///< result dQ/dv
+                                 ChMatrixRef mM          ///< result dQ/da
+                                 ) override {
+        if (jacobian_mode == JacobianMode::NUMERIC) {
+            ChLoadCustomMultiple::ComputeJacobian(state_x, state_w, mK, mR, mM);
+            return;
+        }
+
+        ChMatrixDynamic<double> Knum;
+        ChMatrixDynamic<double> Rnum;
+        if (jacobian_mode == JacobianMode::CHECK) {
+            Knum.setZero(mK.rows(), mK.cols());
+            Rnum.setZero(mR.rows(), mR.cols());
+            ChLoadCustomMultiple::ComputeJacobian(state_x, state_w, Knum, Rnum, mM);
+        }
+
+        mK.setZero();
+        mR.setZero();
+        ComputeQ(state_x, state_w);
+
+        double Kg = (NumContact == 0) ? 1.0e5 : 8.0e6 / double(NumContact);
+        double Cg = Kg * 0.001;
+
+        for (int ie = 0; ie < loadables.size(); ie++) {
+            if (FlexPos(2, ie) >= ContactLine)
+                continue;
+
+            // Fz = -Kg * DeltaDis + Cg * DeltaVel * DeltaDis (DeltaDis < 0)
+            double DeltaDis = FlexPos(2, ie) - ContactLine;
+            double Fz = -Kg * DeltaDis + Cg * FlexVel(2, ie) * DeltaDis;
+            double dFz_dz = -Kg + Cg * FlexVel(2, ie);
+            double dFz_dvz = Cg * DeltaDis;
+            int iz = 6 * ie + 2;
+            mK(iz, iz) = -dFz_dz;
+            mR(iz, iz) = -dFz_dvz;
+
+            // Fx = -Mu(vx) * Fz, Fy = -Mu(vy) * Fz
+            for (int dir = 0; dir < 2; dir++) {
+                double RelVel = FlexVel(dir, ie);
+                if (RelVel == 0.0)
+                    continue;
+                double Mu = Mu0 * atan(2.0 * RelVel) * 2.0 / CH_C_PI;
+                double dMu_dv = Mu0 * (2.0 / CH_C_PI) * 2.0 / (1.0 + 4.0 * RelVel * RelVel);
+                int id = 6 * ie + dir;
+                mK(id, iz) = Mu * dFz_dz;
+                mR(id, iz) = Mu * dFz_dvz;
+                mR(id, id) = dMu_dv * Fz;
+            }
+        }
+
+        if (jacobian_mode == JacobianMode::CHECK)
+            ReportJacobianCheck("Coulomb", mK, mR, Knum, Rnum);
+    }
+
     virtual bool IsStiff() { return true; }
 };
 
@@ -157,7 +252,15 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
   public:
-    ChLoaderLuGre(std::vector<std::shared_ptr<ChLoadable>>& mloadables) : ChLoadCustomMultiple(mloadables){};
+    ChLoaderLuGre(std::vector<std::shared_ptr<ChLoadable>>& mloadables)
+        : ChLoadCustomMultiple(mloadables),
+          FlexPos(6, (int)mloadables.size()),
+          FlexVel(6, (int)mloadables.size()),
+          RigidPos(7, 2),
+          RigidVel(7, 2),
+          TempCJN((int)mloadables.size(), 1),
+          TempContactFRCE(3, (int)mloadables.size()),
+          TempSlipVel(6, (int)mloadables.size()){};
 
     /// "Virtual" copy constructor (covariant return type).
     virtual ChLoaderLuGre* Clone() const override { return new ChLoaderLuGre(*this); }
@@ -171,6 +274,17 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
     double ContactLine;
     ChMatrixNM<double, 6, 120> NodeContactForce;
     ChVector<> NetContactForce;
+    JacobianMode jacobian_mode = JacobianMode::ANALYTIC;
+
+    // Workspace for ComputeQ (sized at construction from the number of loadables, so that the evaluation of the
+    // LuGre load does not allocate these during the simulation)
+    ChMatrixDynamic<double> FlexPos;          // Matrix of nodal coordinates
+    ChMatrixDynamic<double> FlexVel;          // Matrix of nodal velocities
+    ChMatrixDynamic<double> RigidPos;         // Matrix for rigid body positions (includes ground body)
+    ChMatrixDynamic<double> RigidVel;         // Matrix for rigid body velocities (includes ground body)
+    ChMatrixDynamic<int> TempCJN;             // Contact node numbers
+    ChMatrixDynamic<double> TempContactFRCE;  // Nodal contact forces
+    ChMatrixDynamic<double> TempSlipVel;      // Nodal slip velocities
 
     //////////Merge and Sort Function////////////
     // Identification/mapping of contacting nodes. Determines the nodes at the leading/trailing edge
@@ -276,14 +390,14 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
                            double& Length) {
         double TempR;
         double TempR1;
-        ChVectorDynamic<double> TempVecR(2);
+        double TempVecR[2];
 
-        TempVecR(0) = Vec2x - Vec1x;
-        TempVecR(1) = Vec2y - Vec1y;
-        TempR = sqrt(TempVecR(0) * TempVecR(0) + TempVecR(1) * TempVecR(1));
-        TempVecR(0) = Vec3x - Vec2x;
-        TempVecR(1) = Vec3y - Vec2y;
-        TempR1 = sqrt(TempVecR(0) * TempVecR(0) + TempVecR(1) * TempVecR(1));
+        TempVecR[0] = Vec2x - Vec1x;
+        TempVecR[1] = Vec2y - Vec1y;
+        TempR = sqrt(TempVecR[0] * TempVecR[0] + TempVecR[1] * TempVecR[1]);
+        TempVecR[0] = Vec3x - Vec2x;
+        TempVecR[1] = Vec3y - Vec2y;
+        TempR1 = sqrt(TempVecR[0] * TempVecR[0] + TempVecR[1] * TempVecR[1]);
 
         Length = (TempR + TempR1) * 0.5;
     }
@@ -292,7 +406,8 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
     // r83_np_fs is used to factor and solve an R83 System
     // n: Order of the linear system; a(3,n): tridiagonal matrix to be factored;
     // b(n): right hand side of the linear system; x(n): solution to the linear system.
-    void r83_np_fs(int n, ChMatrixDynamic<double>& a, ChVectorDynamic<double> b, ChVectorDynamic<double>& x) {
+    // b and x may refer to the same vector.
+    void r83_np_fs(int n, ChMatrixDynamic<double>& a, const ChVectorDynamic<double>& b, ChVectorDynamic<double>& x) {
         // ChVectorDynamic<double> x(n);
         double xmult;
         for (int i = 0; i < n; i++) {
@@ -317,7 +432,7 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
     // r8vec_bracket searches a sorted vector for successive brackets of a value
     // n: input vector dimension; x(n): vector to be sorted into ascending order;
     // xval: value to be bracketed; left/right: indices such that x(left) <= xval <= x(right).
-    void r8vec_bracket(int n, ChVectorDynamic<double> x, double xval, int& left, int& right) {
+    void r8vec_bracket(int n, const ChVectorDynamic<double>& x, double xval, int& left, int& right) {
         for (int i = 1; i < n - 1; i++) {
             if (xval < x(i)) {
                 left = i - 1;
@@ -338,8 +453,8 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
     //				= 2: second derivative at left/right endpoint = ybcbeg/ybcend;
     // ypp(n): second derivatives of cubic spline.
     void spline_cubic_set(int n,
-                          ChVectorDynamic<double> t,
-                          ChVectorDynamic<double> y,
+                          const ChVectorDynamic<double>& t,
+                          const ChVectorDynamic<double>& y,
                           int ibcbeg,
                           double ybcbeg,
                           int ibcend,
@@ -422,9 +537,9 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
     // tval: a point on the spline to be evaluated;
     // yval/ypval/yppval: The value of the spline, first derivative, and second derivative.
     void spline_cubic_val(int n,
-                          ChVectorDynamic<double> t,
-                          ChVectorDynamic<double> y,
-                          ChVectorDynamic<double> ypp,
+                          const ChVectorDynamic<double>& t,
+                          const ChVectorDynamic<double>& y,
+                          const ChVectorDynamic<double>& ypp,
                           double tval,
                           double& yval,
                           double& ypval,
@@ -446,6 +561,35 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
                 dt * (ypp(left) + dt * (0.5 * (ypp(right) - ypp(left)) / h));
         yppval = ypp(left) + dt * (ypp(right) - ypp(left)) / h;
     }
+
+    // Evaluates piecewise cubic spline at m points tval(m), given in increasing order.
+    // Same as spline_cubic_val for each point, but the bracketing interval is searched starting from the one of the
+    // previous point, so that the cost is O(n + m) instead of O(n * m).
+    // yval(m): The values of the spline at the specified points.
+    void spline_cubic_val(int n,
+                          const ChVectorDynamic<double>& t,
+                          const ChVectorDynamic<double>& y,
+                          const ChVectorDynamic<double>& ypp,
+                          int m,
+                          const ChVectorDynamic<double>& tval,
+                          ChVectorDynamic<double>& yval) {
+        int i = 1;
+        for (int j = 0; j < m; j++) {
+            // Bracket tval(j) as in r8vec_bracket (restart the search if the points are not in increasing order)
+            if (j > 0 && tval(j) < tval(j - 1))
+                i = 1;
+            while (i < n - 1 && tval(j) >= t(i))
+                i++;
+            int left = (i < n - 1) ? i - 1 : n - 2;
+            int right = left + 1;
+
+            double dt = tval(j) - t(left);
+            double h = t(right) - t(left);
+            yval(j) = y(left) +
+                      dt * ((y(right) - y(left)) / h - (ypp(right) / 6.0 + ypp(left) / 3.0) * h +
+                            dt * (0.5 * ypp(left) + dt * ((ypp(right) - ypp(left)) / (6.0 * h))));
+        }
+    }
     // Spline calculation Reference:
     // Carl deBoor,
     // A Practical Guide to Splines,
@@ -468,15 +612,13 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
 
     void CalculateNormalForce(int StartFlag,
                               int NumElemsX,
-                              ChMatrixDynamic<double> DisFlex,
-                              ChMatrixDynamic<double> VelFlex,
+                              const ChMatrixDynamic<double>& DisFlex,
+                              const ChMatrixDynamic<double>& VelFlex,
                               ChMatrixDynamic<double>& ContactFRC,
                               int& SequentialCheck,
                               int& NumContactNode) {
         double Kg;
         double Cg;
-        double DeltaDis;
-        double DeltaVel;
 
         // Kg: Penalty contact stiffness; Cg: Damping of ground contact
         if (NumContact == 0) {
@@ -486,37 +628,38 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
         }
         Cg = Kg * 0.001;
 
+        // Penalty force of all nodes (nodal coordinates are stored row-wise, i.e., contiguous over the nodes). Nodes
+        // that are not in contact have DeltaDis = 0 and therefore a zero normal force.
+        const double* PosZ = &DisFlex(2, 0);
+        const double* VelZ = &VelFlex(2, 0);
+        double* FrcZ = &ContactFRC(2, 0);
+#pragma omp simd
         for (int i = 0; i < NumElemsX; i++) {
-            if (StartFlag == 0) {
-                if (DisFlex(2, i) < ContactLine) {
-                    // GetLog() << i << "\n" << DisFlex(0, i) << "\n" << DisFlex(1, i) << "\n" << DisFlex(2, i) << "\n";
+            double DeltaDis = std::min(PosZ[i] - ContactLine, 0.0);
+            FrcZ[i] = -Kg * DeltaDis - Cg * VelZ[i] * std::abs(DeltaDis);
+        }
 
+        // Count the contacting nodes and detect discontinuities of the contact patch
+        for (int i = 0; i < NumElemsX; i++) {
+            if (StartFlag == 0) {
+                if (PosZ[i] < ContactLine) {
                     if (SequentialCheck == 2) {
                         SequentialCheck = 3;
                     } else if (SequentialCheck == 0) {
                         SequentialCheck = 1;
                     }
                     NumContactNode++;
-                    DeltaDis = DisFlex(2, i) - ContactLine;
-                    DeltaVel = VelFlex(2, i);
-                    ContactFRC(2, i) = -Kg * DeltaDis - Cg * DeltaVel * sqrt(DeltaDis * DeltaDis);
                 } else {
                     if (SequentialCheck == 1) {
                         SequentialCheck = 2;
                     }
                 }
             } else if (StartFlag == 1) {
-                if (DisFlex(2, i) < ContactLine) {
-                    // GetLog() << i << "\n" << DisFlex(0, i) << "\n" << DisFlex(1, i) << "\n" << DisFlex(2, i) << "\n";
-
+                if (PosZ[i] < ContactLine) {
                     if (SequentialCheck == 1) {
                         SequentialCheck = 2;
                     }
                     NumContactNode++;
-                    DeltaDis = DisFlex(2, i) - ContactLine;
-                    DeltaVel = VelFlex(2, i);
-                    ContactFRC(2, i) = -Kg * DeltaDis - Cg * DeltaVel * sqrt(DeltaDis * DeltaDis);
-
                 } else {
                     if (SequentialCheck == 0) {
                         SequentialCheck = 1;
@@ -530,10 +673,10 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
 
     void LuGre_SteadyState(int NumElemsX,
                            int NumElemsY,
-                           ChMatrixDynamic<double> DisRigid,
-                           ChMatrixDynamic<double> VelRigid,
-                           ChMatrixDynamic<double> DisFlex,
-                           ChMatrixDynamic<double> VelFlex,
+                           const ChMatrixDynamic<double>& DisRigid,
+                           const ChMatrixDynamic<double>& VelRigid,
+                           const ChMatrixDynamic<double>& DisFlex,
+                           const ChMatrixDynamic<double>& VelFlex,
                            ChMatrixDynamic<double>& ContactFRC,
                            ChMatrixDynamic<double>& StockSlipVel1,
                            double& StockROMG1) {
@@ -553,7 +696,6 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
         int NDC = 7;  // Rigid Body Dofs
         ChVectorDynamic<double> RearContactPoint(3);
         ChVectorDynamic<double> FrontContactPoint(3);
-        ChVectorDynamic<double> ypp(NumLuGreZ);
         double G_Func = 0.0;
         double Gx_Func = 0.0;
         double Gy_Func = 0.0;
@@ -630,6 +772,7 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
             ChMatrixDynamic<double> LuGreForce(NumContactNode, 3);
             ChMatrixDynamic<double> ZetaPos(NumLuGreZ, 2);
             ChVectorDynamic<double> ZetaPosX(NumLuGreZ);
+            ChVectorDynamic<double> ZetaPosY(NumLuGreZ);
             ChMatrixDynamic<double> ZetaVr(NumLuGreZ, 2);
             ChVectorDynamic<double> dLength(NumLuGreZ);
             ChVectorDynamic<double> dLength_Node(NumContactNode);
@@ -640,6 +783,16 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
             ChMatrixDynamic<double> ZLuGre(NumLuGreZ, 2);
             ChMatrixDynamic<double> dZLuGre(NumLuGreZ, 2);
             ChVectorDynamic<int> ContactNodeNum(NumContactNode);
+            ChVectorDynamic<double> NodeFX(NumContactNode);
+            ChVectorDynamic<double> NodeFY(NumContactNode);
+
+            // Second derivatives of the cubic splines (each spline is set up once per evaluation)
+            ChVectorDynamic<double> yppPosY(NumContactNode);      // lateral node position vs. X
+            ChVectorDynamic<double> yppFn(NumContactNode + 2);    // normal force vs. X (with rear/front points)
+            ChVectorDynamic<double> yppVelX(NumContactNode);      // longitudinal slip velocity vs. X
+            ChVectorDynamic<double> yppVelY(NumContactNode);      // lateral slip velocity vs. X
+            ChVectorDynamic<double> yppFX(NumLuGreZ);             // longitudinal LuGre force vs. X
+            ChVectorDynamic<double> yppFY(NumLuGreZ);             // lateral LuGre force vs. X
 
             Count = 0;
             for (int i = 0; i < NumElemsX; i++)  // NumElemsX: Number of nodes in the entire loop
@@ -723,10 +876,10 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
             }
 
             // In order to calculate ZetaPos
+            spline_cubic_set(NumContactNode, NodeTransPosX, NodeTransPosY, 2, 0.0, 2, 0.0, yppPosY);
+            spline_cubic_val(NumContactNode, NodeTransPosX, NodeTransPosY, yppPosY, NumLuGreZ, ZetaPosX, ZetaPosY);
             for (int i = 0; i < NumLuGreZ; i++) {
-                spline_cubic_set(NumContactNode, NodeTransPosX, NodeTransPosY, 2, 0.0, 2, 0.0, ypp);
-                spline_cubic_val(NumContactNode, NodeTransPosX, NodeTransPosY, ypp, ZetaPos(i, 0), ZetaPos(i, 1), Dummy,
-                                 Dummy);
+                ZetaPos(i, 1) = ZetaPosY(i);
             }
 
             // In order to calculate dLength(i)
@@ -792,24 +945,24 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
             TempNodeInfo(NumContactNode + 1, 2) = FrontContactPoint(2);
 
             //// Interpolation for Normal Contact Force at LuGre point *Size is NumContacNode+2 due to Rear and Front
+            spline_cubic_set(NumContactNode + 2, TempNodeInfo1, TempFn, 2, 0.0, 2, 0.0, yppFn);
             for (int i = 0; i < NumLuGreZ; i++) {
                 if (RearContactPoint(0) <= ZetaPos(i, 0) && ZetaPos(i, 0) <= FrontContactPoint(0)) {
-                    spline_cubic_set(NumContactNode + 2, TempNodeInfo1, TempFn, 2, 0.0, 2, 0.0, ypp);
-                    spline_cubic_val(NumContactNode + 2, TempNodeInfo1, TempFn, ypp, ZetaPos(i, 0), ZetaFn(i), Dummy,
+                    spline_cubic_val(NumContactNode + 2, TempNodeInfo1, TempFn, yppFn, ZetaPos(i, 0), ZetaFn(i), Dummy,
                                      Dummy);
                 }
             }
 
             //// Interpolation for Slip Velocity at LuGre point *Size is NumContactNode
+            spline_cubic_set(NumContactNode, NodeTransPosX, NodeTransVelX, 2, 0.0, 2, 0.0, yppVelX);
+            spline_cubic_set(NumContactNode, NodeTransPosX, NodeTransVelY, 2, 0.0, 2, 0.0, yppVelY);
             for (int i = 0; i < NumLuGreZ; i++) {
                 if (RearContactPoint(0) <= ZetaPos(i, 0) && ZetaPos(i, 0) <= FrontContactPoint(0)) {
                     // Slip in X-direction
-                    spline_cubic_set(NumContactNode, NodeTransPosX, NodeTransVelX, 2, 0.0, 2, 0.0, ypp);
-                    spline_cubic_val(NumContactNode, NodeTransPosX, NodeTransVelX, ypp, ZetaPos(i, 0), ZetaVr(i, 0),
+                    spline_cubic_val(NumContactNode, NodeTransPosX, NodeTransVelX, yppVelX, ZetaPos(i, 0), ZetaVr(i, 0),
                                      Dummy, Dummy);
                     // Slip in Y-direction
-                    spline_cubic_set(NumContactNode, NodeTransPosX, NodeTransVelY, 2, 0.0, 2, 0.0, ypp);
-                    spline_cubic_val(NumContactNode, NodeTransPosX, NodeTransVelY, ypp, ZetaPos(i, 0), ZetaVr(i, 1),
+                    spline_cubic_val(NumContactNode, NodeTransPosX, NodeTransVelY, yppVelY, ZetaPos(i, 0), ZetaVr(i, 1),
                                      Dummy, Dummy);
                 }
             }
@@ -877,19 +1030,16 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
                 // GetLog() << "ZLuGRe: " << ZLuGre(i,0) << "\n";
             }
 
-            TempR = 0.0;
-
-            // Evaluate LuGre friction force at node points
+            // Evaluate LuGre friction force at node points (sorted along X)
+            // Traveling direction
+            spline_cubic_set(NumLuGreZ, ZetaPosX, ZetaFX, 2, 0.0, 2, 0.0, yppFX);
+            spline_cubic_val(NumLuGreZ, ZetaPosX, ZetaFX, yppFX, NumContactNode, NodeTransPosX, NodeFX);
+            // Width direction
+            spline_cubic_set(NumLuGreZ, ZetaPosX, ZetaFY, 2, 0.0, 2, 0.0, yppFY);
+            spline_cubic_val(NumLuGreZ, ZetaPosX, ZetaFY, yppFY, NumContactNode, NodeTransPosX, NodeFY);
             for (int i = 0; i < NumContactNode; i++) {
-                // Traveling direction
-                spline_cubic_set(NumLuGreZ, ZetaPosX, ZetaFX, 2, 0.0, 2, 0.0, ypp);
-                spline_cubic_val(NumLuGreZ, ZetaPosX, ZetaFX, ypp, NodeTransPosX(i), TempR, Dummy, Dummy);
-                LocalLuGreForce(i, 0) = TempR * dLength_Node(i);
-
-                // Width direction
-                spline_cubic_set(NumLuGreZ, ZetaPosX, ZetaFY, 2, 0.0, 2, 0.0, ypp);
-                spline_cubic_val(NumLuGreZ, ZetaPosX, ZetaFY, ypp, NodeTransPosX(i), TempR, Dummy, Dummy);
-                LocalLuGreForce(i, 1) = TempR * dLength_Node(i);
+                LocalLuGreForce(i, 0) = NodeFX(i) * dLength_Node(i);
+                LocalLuGreForce(i, 1) = NodeFY(i) * dLength_Node(i);
             }
 
             for (int i = 0; i < NumContactNode; i++) {
@@ -902,14 +1052,9 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
     virtual void ComputeQ(ChState* state_x,      ///< state position to evaluate Q
                           ChStateDelta* state_w  ///< state speed to evaluate Q
                           ) {
-        ChMatrixDynamic<double> FlexPos(6, (int)loadables.size());  // Matrix of nodal coordinates
-        ChMatrixDynamic<double> FlexVel(6, (int)loadables.size());  // Matrix of nodal velocities
-        ChMatrixDynamic<double> RigidPos(7, 2);                // Matrix for rigid body positions (includes ground body)
-        ChMatrixDynamic<double> RigidVel(7, 2);  // Matrix for rigid body velocities (includes ground body)
-        ChMatrixDynamic<int> TempCJN((int)loadables.size(), 1);
-        ChMatrixDynamic<double> TempContactFRCE(3, (int)loadables.size());
-        ChMatrixDynamic<double> TempSlipVel(6, (int)loadables.size());
         double TempROMG = 0.0;
+        TempContactFRCE.setZero();
+        TempSlipVel.setZero();
 
         NetContactForce.x() = 0.0;
         NetContactForce.y() = 0.0;
@@ -947,49 +1092,40 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
         RigidVel(6, 1) = mRim->GetRot_dt().e3();
 
         if (state_x && state_w) {
-            for (int ie = 0; ie < loadables.size(); ie++)  // Loop over the nodes in the circumferential direction
-            {
-                ChVector<> P1 = state_x->segment(6 * ie, 3);
-                ChVector<> P1d = state_x->segment(6 * ie + 3, 3);
-                ChVector<> V1 = state_w->segment(6 * ie, 3);
-                ChVector<> V1d = state_w->segment(6 * ie + 3, 3);
-
-                // Set the position and velocty for the node in the entire loop
-                FlexPos(0, ie) = P1.x();
-                FlexPos(1, ie) = P1.y();
-                FlexPos(2, ie) = P1.z();
-                FlexPos(3, ie) = P1d.x();
-                FlexPos(4, ie) = P1d.y();
-                FlexPos(5, ie) = P1d.z();
-
-                FlexVel(0, ie) = V1.x();
-                FlexVel(1, ie) = V1.y();
-                FlexVel(2, ie) = V1.z();
-                FlexVel(3, ie) = V1d.x();
-                FlexVel(4, ie) = V1d.y();
-                FlexVel(5, ie) = V1d.z();
+            const int NumNodes = (int)loadables.size();
+
+            // Scatter the nodal states (6 coordinates per node) into the rows of FlexPos and FlexVel, so that each
+            // nodal coordinate is contiguous over the nodes of the loop
+            const double* StateX = state_x->data();
+            const double* StateW = state_w->data();
+            for (int k = 0; k < 6; k++) {
+                double* Pos = &FlexPos(k, 0);
+                double* Vel = &FlexVel(k, 0);
+#pragma omp simd
+                for (int ie = 0; ie < NumNodes; ie++) {
+                    Pos[ie] = StateX[6 * ie + k];
+                    Vel[ie] = StateW[6 * ie + k];
+                }
             }
 
             // Function for LuGre force calculation
-            LuGre_SteadyState((int)loadables.size(), 24, RigidPos, RigidVel, FlexPos, FlexVel, TempContactFRCE, TempSlipVel,
+            LuGre_SteadyState(NumNodes, 24, RigidPos, RigidVel, FlexPos, FlexVel, TempContactFRCE, TempSlipVel,
                               TempROMG);
 
-            for (int ie = 0; ie < loadables.size(); ie++)  // Loop over all nodes in the circumferential direction
-            {
-                // Load the contact force into the Q vector
-                this->load_Q(6 * ie + 0) = TempContactFRCE(0, ie);
-                this->load_Q(6 * ie + 1) = TempContactFRCE(1, ie);
-                this->load_Q(6 * ie + 2) = TempContactFRCE(2, ie);
-
-                // Load the contact force to be written to a file
-                NodeContactForce(0, ie) = TempContactFRCE(0, ie);
-                NodeContactForce(1, ie) = TempContactFRCE(1, ie); 
-                NodeContactForce(2, ie) = TempContactFRCE(2, ie);
-                NodeContactForce(3, ie) = 0.0;
-                NodeContactForce(4, ie) = 0.0;
-                NodeContactForce(5, ie) = 0.0;
-
-                // In order to monitor the net contact force
+            // Load the contact force into the Q vector and into the nodal forces written to a file
+            double* Q = this->load_Q.data();
+            for (int k = 0; k < 3; k++) {
+                const double* Frc = &TempContactFRCE(k, 0);
+#pragma omp simd
+                for (int ie = 0; ie < NumNodes; ie++) {
+                    Q[6 * ie + k] = Frc[ie];
+                    NodeContactForce(k, ie) = Frc[ie];
+                    NodeContactForce(k + 3, ie) = 0.0;
+                }
+            }
+
+            // In order to monitor the net contact force (summed in node order, so that the result is reproducible)
+            for (int ie = 0; ie < NumNodes; ie++) {
                 if (TempContactFRCE(2, ie) != 0.0) {
                     NetContactForce.x() += TempContactFRCE(0, ie);
                     NetContactForce.y() += TempContactFRCE(1, ie);
@@ -1000,11 +1136,82 @@ class ChLoaderLuGre : public ChLoadCustomMultiple {
 
     }  // end of Compute_Q
 
+    // Jacobians of the contact forces. The derivatives of the penalty normal force are exact. The LuGre friction
+    // force of a node is treated as proportional to its normal force, with the ratio Fx/Fz (Fy/Fz) frozen at the
+    // current state; the dependence of the friction forces on the neighboring nodes (through the splines of the
+    // contact patch) and on the sliding velocity is neglected.
+    virtual void ComputeJacobian(ChState* state_x,       ///< state position to evaluate jacobians
+                                 ChStateDelta* state_w,  ///< state speed to evaluate jacobians
+                                 ChMatrixRef mK,         ///< result dQ/dx
+                                 ChMatrixRef mR,         ///< result dQ/dv
+                                 ChMatrixRef mM          ///< result dQ/da
+                                 ) override {
+        if (jacobian_mode == JacobianMode::NUMERIC) {
+            ChLoadCustomMultiple::ComputeJacobian(state_x, state_w, mK, mR, mM);
+            return;
+        }
+
+        ChMatrixDynamic<double> Knum;
+        ChMatrixDynamic<double> Rnum;
+        if (jacobian_mode == JacobianMode::CHECK) {
+            Knum.setZero(mK.rows(), mK.cols());
+            Rnum.setZero(mR.rows(), mR.cols());
+            ChLoadCustomMultiple::ComputeJacobian(state_x, state_w, Knum, Rnum, mM);
+        }
+
+        mK.setZero();
+        mR.setZero();
+        ComputeQ(state_x, state_w);
+
+        double Kg = (NumContact == 0) ? 1.0e5 : 8.0e6 / double(NumContact);
+        double Cg = Kg * 0.001;
+
+        for (int ie = 0; ie < loadables.size(); ie++) {
+            double Fz = TempContactFRCE(2, ie);
+            if (FlexPos(2, ie) >= ContactLine || Fz == 0.0)
+                continue;
+
+            double DeltaDis = FlexPos(2, ie) - ContactLine;
+            double dFz_dz = -Kg + Cg * FlexVel(2, ie);
+            double dFz_dvz = Cg * DeltaDis;
+            int iz = 6 * ie + 2;
+            mK(iz, iz) = -dFz_dz;
+            mR(iz, iz) = -dFz_dvz;
+
+            for (int dir = 0; dir < 2; dir++) {
+                double ratio = TempContactFRCE(dir, ie) / Fz;
+                mK(6 * ie + dir, iz) = -ratio * dFz_dz;
+                mR(6 * ie + dir, iz) = -ratio * dFz_dvz;
+            }
+        }
+
+        if (jacobian_mode == JacobianMode::CHECK) {
+#pragma omp critical
+            ReportJacobianCheck("LuGre", mK, mR, Knum, Rnum);
+        }
+    }
+
     // Activate jacobian calculation
     virtual bool IsStiff() { return true; }
 
 };  // end of ChLoaderLuGre
 
+// Load container which updates its loads in parallel. The loads must be independent of each other: the LuGre
+// load of a loop only reads the states of its own nodes and of the rim, and only writes its own Q and Jacobians.
+// The loads are then assembled sequentially, so the results do not depend on the number of threads.
+class ChLoadContainerParallel : public ChLoadContainer {
+  public:
+    virtual ChLoadContainerParallel* Clone() const override { return new ChLoadContainerParallel(*this); }
+
+    virtual void Update(double mytime, bool update_assets = true) override {
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < (int)loadlist.size(); ++i) {
+            loadlist[i]->Update(mytime);
+        }
+        ChPhysicsItem::Update(mytime, update_assets);
+    }
+};
+
 // Reads the input file for creating the HMMWV tire.
 // Determines initial configuration and the properties
 // of the elements, layers, and materials.
@@ -1021,105 +1228,62 @@ void ReadInputFile(ChMatrixDynamic<double>& COORDFlex,
                    ChMatrixNM<double, 7, 12>& MPROP,
                    ChMatrixDynamic<double>& ElementLength,
                    ChVectorN<int, 3>& NumLayPerSect) {
-    FILE* inputfile;
-    char str1[100];
-    int numFlexBody = 0;
-    int dummy;
-    int count;
-
-    int NDR[4000][6];
-    int NumLayer[10];
-    int MaxSectionNumber = 0;
-    int MaxMatID = 0;
-    int MTYPE = 0;
-
-    int MAXCOUNT = 100;
-
-    inputfile = fopen(GetChronoDataFile("fea/ANCFtire/HMMWVBiLinearShell_Tire.INP").c_str(), "r");
-    printf("Open HMMWVBiLinearShell_Tire.INP\n");
-    if (inputfile == NULL) {
+    // Tables of the deck (parsed once and shared by all tires, or read from the binary cache of the deck)
+    auto data = LoadANCFTireInput(GetChronoDataFile("fea/ANCFtire/HMMWVBiLinearShell_Tire.INP"));
+    if (!data) {
         printf("Input data file not found!!\n");
         exit(1);
     }
 
-    TotalNumElements = 0;
-    NumElements_x = 0;
-    NumElements_y = 0;
-    TotalNumNodes = 0;
+    TotalNumElements = data->TotalNumElements;
+    NumElements_x = data->NumElements_x;
+    NumElements_y = data->NumElements_y;
+    TotalNumNodes = data->TotalNumNodes;
 
     //!--------------------------------------!
     //!-- Elememt data            -----------!
     //!--------------------------------------!
-
-    fgets(str1, MAXCOUNT, inputfile);
-    printf("%s\n", str1);
-    fscanf(inputfile, "%d\n", &numFlexBody);
-
-    fgets(str1, MAXCOUNT, inputfile);
-    printf("%s\n", str1);
-    fscanf(inputfile, "%d %d %d %d\n", &TotalNumElements, &NumElements_x, &NumElements_y, &TotalNumNodes);
-    fgets(str1, MAXCOUNT, inputfile);
-
-    printf("%s\n", str1);
     for (int i = 0; i < TotalNumElements; i++) {
-        fscanf(inputfile, "%d %d %d %d %d %d %d\n", &count, &dummy, &SectionID(i, 0), &NodesPerElement(i, 0),
-               &NodesPerElement(i, 1), &NodesPerElement(i, 2), &NodesPerElement(i, 3));
-        printf("SectionID[i] %d\n  ", SectionID(i, 0));
-
-        fscanf(inputfile, " %lf %lf\n", &ElementLength(i, 0), &ElementLength(i, 1));
-        if (MaxSectionNumber < SectionID(i, 0)) {
-            MaxSectionNumber = SectionID(i, 0);
-        }
+        SectionID(i) = data->SectionID[i];
+        NodesPerElement(i, 0) = data->ElementNodes[4 * i + 0];
+        NodesPerElement(i, 1) = data->ElementNodes[4 * i + 1];
+        NodesPerElement(i, 2) = data->ElementNodes[4 * i + 2];
+        NodesPerElement(i, 3) = data->ElementNodes[4 * i + 3];
+        ElementLength(i, 0) = data->ElementLength[2 * i];
+        ElementLength(i, 1) = data->ElementLength[2 * i + 1];
     }
 
     //!--------------------------------------!
-    //!-- NDR,COORDFlex,VELCYFlex -----------!
+    //!-- COORDFlex,VELCYFlex ---------------!
     //!--------------------------------------!
-    fgets(str1, MAXCOUNT, inputfile);
-    printf("%s\n", str1);
     for (int i = 0; i < TotalNumNodes; i++) {
-        fscanf(inputfile, "%d %d %d %d %d %d %d\n", &count, &NDR[i][0], &NDR[i][1], &NDR[i][2], &NDR[i][3], &NDR[i][4],
-               &NDR[i][5]);
-        fscanf(inputfile, "%lf %lf %lf %lf %lf %lf\n", &COORDFlex(i, 0), &COORDFlex(i, 1), &COORDFlex(i, 2),
-               &COORDFlex(i, 3), &COORDFlex(i, 4), &COORDFlex(i, 5));
-        fscanf(inputfile, "%lf %lf %lf %lf %lf %lf\n", &VELCYFlex(i, 0), &VELCYFlex(i, 1), &VELCYFlex(i, 2),
-               &VELCYFlex(i, 3), &VELCYFlex(i, 4), &VELCYFlex(i, 5));
+        for (int j = 0; j < 6; j++) {
+            COORDFlex(i, j) = data->COORDFlex[6 * i + j];
+            VELCYFlex(i, j) = data->VELCYFlex[6 * i + j];
+        }
     }
 
     //!--------------------------------------!
-    //!--- Read Layer Data ------------------!
+    //!--- Layer Data -----------------------!
     //!--------------------------------------!
-    // fscanf(inputfile,"%s\n",str1);
-    fgets(str1, MAXCOUNT, inputfile);
-    printf("%s\n", str1);
     int counted = 0;
-    for (int i = 0; i < MaxSectionNumber; i++) {
-        fscanf(inputfile, "%d %d\n", &count, &NumLayer[i]);
-        for (int j = 0; j < NumLayer[i]; j++) {
-            fscanf(inputfile, "%lf %lf %d\n", &LayerPROP(counted + j, 0), &LayerPROP(counted + j, 1), &MatID(i, j));
-            if (MaxMatID < MatID(i, j)) {
-                MaxMatID = MatID(i, j);
-            }
-            NumLayPerSect(i) = NumLayer[i];
+    for (int i = 0; i < data->MaxSectionNumber; i++) {
+        for (int j = 0; j < data->NumLayer[i]; j++) {
+            LayerPROP(counted + j, 0) = data->LayerPROP[2 * (counted + j)];
+            LayerPROP(counted + j, 1) = data->LayerPROP[2 * (counted + j) + 1];
+            MatID(i, j) = data->LayerMatID[counted + j];
+            NumLayPerSect(i) = data->NumLayer[i];
         }
         counted += NumLayPerSect(i);
     }
 
     //!--------------------------------------!
-    //!--- Read Material Data ---------------!
+    //!--- Material Data --------------------!
     //!--------------------------------------!
-    // fscanf(inputfile,"%s\n",str1);
-    fgets(str1, MAXCOUNT, inputfile);
-    printf("%s\n", str1);
-    for (int i = 0; i < MaxMatID; i++) {
-        fscanf(inputfile, "%d %d\n", &count, &MTYPE);
-        if (MTYPE == 1) {
-            fscanf(inputfile, "%lf %lf %lf %lf\n", &MPROP(i, 0), &MPROP(i, 1), &MPROP(i, 2), &MPROP(i, 3));
-        }
-        if (MTYPE == 2) {
-            fscanf(inputfile, "%lf %lf %lf %lf\n", &MPROP(i, 0), &MPROP(i, 1), &MPROP(i, 2), &MPROP(i, 3));
-            fscanf(inputfile, "%lf %lf %lf %lf %lf %lf\n", &MPROP(i, 4), &MPROP(i, 5), &MPROP(i, 6), &MPROP(i, 7),
-                   &MPROP(i, 8), &MPROP(i, 9));
+    for (int i = 0; i < data->MaxMatID; i++) {
+        int NumProp = (data->MTYPE[i] == 1) ? 4 : (data->MTYPE[i] == 2) ? 10 : 0;
+        for (int j = 0; j < NumProp; j++) {
+            MPROP(i, j) = data->MPROP[10 * i + j];
         }
     }
 };
@@ -1199,6 +1363,120 @@ void ReadRestartInput(ChMatrixNM<double, 2, 7>& COORDRigid,
     GetLog() << "Restart Complete!\n\n";
 };
 
+// Binary checkpoint of the complete state of the tire model:
+// - time, positions, velocities, and accelerations of all nodes and bodies, and constraint reactions (the HHT
+//   integrator restarts each step from these, so a resumed run continues without re-converging)
+// - state of the LuGre loads (contact line, number of contacts, and last contact forces)
+// The model must be constructed as for the run that wrote the checkpoint; the checkpoint then overrides its state.
+const char CheckpointMagic[4] = {'C', 'H', 'C', 'K'};
+const int CheckpointVersion = 1;
+
+bool WriteCheckpoint(const std::string& filename,
+                     ChSystem& my_system,
+                     const std::vector<std::shared_ptr<ChLoaderLuGre>>& LoadList) {
+    int sizes[4] = {my_system.GetNcoords_x(), my_system.GetNcoords_w(), my_system.GetNconstr(), (int)LoadList.size()};
+    ChState x(sizes[0], &my_system);
+    ChStateDelta v(sizes[1], &my_system);
+    ChStateDelta a(sizes[1], &my_system);
+    ChVectorDynamic<> L(sizes[2]);
+    double T;
+    my_system.StateGather(x, v, T);
+    my_system.StateGatherAcceleration(a);
+    my_system.StateGatherReactions(L);
+
+    // Write to a temporary file first, so that an interrupted run never leaves a corrupt checkpoint
+    std::string tmpname = filename + ".tmp";
+    FILE* file = fopen(tmpname.c_str(), "wb");
+    if (!file)
+        return false;
+    bool ok = fwrite(CheckpointMagic, 1, 4, file) == 4;
+    ok = ok && fwrite(&CheckpointVersion, sizeof(int), 1, file) == 1;
+    ok = ok && fwrite(sizes, sizeof(int), 4, file) == 4;
+    ok = ok && fwrite(&T, sizeof(double), 1, file) == 1;
+    ok = ok && fwrite(x.data(), sizeof(double), sizes[0], file) == (size_t)sizes[0];
+    ok = ok && fwrite(v.data(), sizeof(double), sizes[1], file) == (size_t)sizes[1];
+    ok = ok && fwrite(a.data(), sizeof(double), sizes[1], file) == (size_t)sizes[1];
+    ok = ok && fwrite(L.data(), sizeof(double), sizes[2], file) == (size_t)sizes[2];
+    for (const auto& load : LoadList) {
+        double net[3] = {load->NetContactForce.x(), load->NetContactForce.y(), load->NetContactForce.z()};
+        ok = ok && fwrite(&load->ContactLine, sizeof(double), 1, file) == 1;
+        ok = ok && fwrite(&load->NumContact, sizeof(int), 1, file) == 1;
+        ok = ok && fwrite(net, sizeof(double), 3, file) == 3;
+        ok = ok && fwrite(load->NodeContactForce.data(), sizeof(double), load->NodeContactForce.size(), file) ==
+                       (size_t)load->NodeContactForce.size();
+    }
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        remove(tmpname.c_str());
+        return false;
+    }
+#if defined(_WIN32)
+    remove(filename.c_str());  // rename does not replace an existing file
+#endif
+    if (rename(tmpname.c_str(), filename.c_str()) != 0) {
+        remove(tmpname.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ReadCheckpoint(const std::string& filename,
+                    ChSystem& my_system,
+                    const std::vector<std::shared_ptr<ChLoaderLuGre>>& LoadList) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (!file) {
+        printf("Checkpoint %s not found!\n", filename.c_str());
+        return false;
+    }
+
+    // Make sure that the offsets of all items in the system state are set
+    my_system.Setup();
+
+    char magic[4];
+    int version = 0;
+    int sizes[4];
+    bool ok = fread(magic, 1, 4, file) == 4 && std::memcmp(magic, CheckpointMagic, 4) == 0;
+    ok = ok && fread(&version, sizeof(int), 1, file) == 1 && version == CheckpointVersion;
+    ok = ok && fread(sizes, sizeof(int), 4, file) == 4;
+    if (!ok || sizes[0] != my_system.GetNcoords_x() || sizes[1] != my_system.GetNcoords_w() ||
+        sizes[2] != my_system.GetNconstr() || sizes[3] != (int)LoadList.size()) {
+        printf("Checkpoint %s does not match this model!\n", filename.c_str());
+        fclose(file);
+        return false;
+    }
+
+    ChState x(sizes[0], &my_system);
+    ChStateDelta v(sizes[1], &my_system);
+    ChStateDelta a(sizes[1], &my_system);
+    ChVectorDynamic<> L(sizes[2]);
+    double T;
+    ok = fread(&T, sizeof(double), 1, file) == 1;
+    ok = ok && fread(x.data(), sizeof(double), sizes[0], file) == (size_t)sizes[0];
+    ok = ok && fread(v.data(), sizeof(double), sizes[1], file) == (size_t)sizes[1];
+    ok = ok && fread(a.data(), sizeof(double), sizes[1], file) == (size_t)sizes[1];
+    ok = ok && fread(L.data(), sizeof(double), sizes[2], file) == (size_t)sizes[2];
+    for (const auto& load : LoadList) {
+        double net[3];
+        ok = ok && fread(&load->ContactLine, sizeof(double), 1, file) == 1;
+        ok = ok && fread(&load->NumContact, sizeof(int), 1, file) == 1;
+        ok = ok && fread(net, sizeof(double), 3, file) == 3;
+        ok = ok && fread(load->NodeContactForce.data(), sizeof(double), load->NodeContactForce.size(), file) ==
+                       (size_t)load->NodeContactForce.size();
+        load->NetContactForce = ChVector<>(net[0], net[1], net[2]);
+    }
+    fclose(file);
+    if (!ok) {
+        printf("Checkpoint %s is truncated!\n", filename.c_str());
+        return false;
+    }
+
+    my_system.StateScatter(x, v, T, true);
+    my_system.StateScatterAcceleration(a);
+    my_system.StateScatterReactions(L);
+    GetLog() << "Resumed from checkpoint " << filename.c_str() << " at t = " << T << "\n\n";
+    return true;
+}
+
 int main(int argc, char* argv[]) {
     // Set path to Chrono data directory
     SetChronoDataPath(CHRONO_DATA_DIR);
@@ -1219,6 +1497,42 @@ int main(int argc, char* argv[]) {
     bool output3 = true;
     bool output4 = true;
 
+    // Evaluation of the Jacobians of the LuGre ground contact loads
+    JacobianMode jacobian_mode = JacobianMode::ANALYTIC;
+
+    // Binary checkpoints: resume from CheckpointIn (if given) and write CheckpointOut (if given) every
+    // CheckpointSteps steps and at the end of the simulation
+    std::string CheckpointIn;
+    std::string CheckpointOut;
+    int CheckpointSteps = 1000;
+
+    // Reuse of the PardisoMKL factorization across steps (modified Newton), refactorizing after steps with more than
+    // ReuseMaxIterations Newton iterations (0: full Newton with a factorization at each iteration)
+    int ReuseMaxIterations = 0;
+
+    // Constrain the bead nodes to the rim with one ChLinkPointFrame and one ChLinkDirFrame per node, instead of a
+    // single node set constraint
+    bool IndividualLinks = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--resume" && i + 1 < argc) {
+            CheckpointIn = argv[++i];
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            CheckpointOut = argv[++i];
+        } else if (arg == "--checkpoint_steps" && i + 1 < argc) {
+            CheckpointSteps = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--reuse_factorization" && i + 1 < argc) {
+            ReuseMaxIterations = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--individual_links") {
+            IndividualLinks = true;
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--resume file] [--checkpoint file] [--checkpoint_steps n]"
+                      << " [--reuse_factorization max_iterations] [--individual_links]\n";
+            return 1;
+        }
+    }
+    int NumSteps = 0;
+
     // The physical system: it contains all physical objects.
     ChSystemNSC my_system;
 
@@ -1391,6 +1705,9 @@ int main(int argc, char* argv[]) {
     // and load containers must be added to your ChSystem
     auto Mloadcontainer = chrono_types::make_shared<ChLoadContainer>();
 
+    // The LuGre loads of the different loops are evaluated in parallel
+    auto LuGreLoadcontainer = chrono_types::make_shared<ChLoadContainerParallel>();
+
     ////// LuGre Load Class initialization
     std::vector<std::shared_ptr<ChLoaderLuGre>> LoadList(NumElements_y + 1);
     for (int i = 0; i < NumElements_y + 1; i++) {
@@ -1404,7 +1721,8 @@ int main(int argc, char* argv[]) {
         LoadList[i]->ContactLine = ContactZ;
         LoadList[i]->NumContact = NumCont;
         LoadList[i]->mRim = Rim;
-        Mloadcontainer->Add(LoadList[i]);
+        LoadList[i]->jacobian_mode = jacobian_mode;
+        LuGreLoadcontainer->Add(LoadList[i]);
     }
 
     class MyPressureLoad : public ChLoaderUVdistributed {
@@ -1507,6 +1825,7 @@ int main(int argc, char* argv[]) {
     }
 
     my_system.Add(Mloadcontainer);
+    my_system.Add(LuGreLoadcontainer);
     // Remember to add the mesh to the system!
     my_system.Add(my_mesh);
 
@@ -1518,11 +1837,16 @@ int main(int argc, char* argv[]) {
     std::shared_ptr<ChLinkLockPointPlane> constraintLateral;
 
     // Constrain the flexible tire to the rigid rim body.
+    std::vector<std::shared_ptr<ChNodeFEAxyz>> BeadNodes;
     for (int i = 0; i < TotalNumNodes; i++) {
         if (i < NumElements_x ||
             i >= TotalNumNodes - NumElements_x) {  // Only constrain the nodes at the ends of the bead section
 
             ConstrainedNode = std::dynamic_pointer_cast<ChNodeFEAxyzD>(my_mesh->GetNode(i));
+            if (!IndividualLinks) {
+                BeadNodes.push_back(ConstrainedNode);
+                continue;
+            }
 
             // Add position constraints
             constraint = chrono_types::make_shared<ChLinkPointFrame>(); 
@@ -1536,6 +1860,12 @@ int main(int argc, char* argv[]) {
             my_system.Add(constraintD);
         }
     }
+    if (!IndividualLinks) {
+        // Position and direction constraints of all bead nodes, in one physics item
+        auto BeadConstraint = chrono_types::make_shared<ChLinkNodeSetFrame>();
+        BeadConstraint->Initialize(BeadNodes, Rim, true);
+        my_system.Add(BeadConstraint);
+    }
 
     // Constrain only the lateral displacement of the Rim
     constraintLateral = chrono_types::make_shared<ChLinkLockPointPlane>(); 
@@ -1543,9 +1873,15 @@ int main(int argc, char* argv[]) {
     constraintLateral->Initialize(Rim, Ground, ChCoordsys<>(Rim->GetPos(), Q_from_AngX(CH_C_PI_2)));
 
     // Use the PardisoMKL Solver
-    auto mkl_solver = chrono_types::make_shared<ChSolverPardisoMKL>();
-    mkl_solver->LockSparsityPattern(true);
-    my_system.SetSolver(mkl_solver);
+    std::shared_ptr<ChSolverPardisoMKLReuse> reuse_solver;
+    if (ReuseMaxIterations > 0) {
+        reuse_solver = chrono_types::make_shared<ChSolverPardisoMKLReuse>(ReuseMaxIterations);
+        my_system.SetSolver(reuse_solver);
+    } else {
+        auto mkl_solver = chrono_types::make_shared<ChSolverPardisoMKL>();
+        mkl_solver->LockSparsityPattern(true);
+        my_system.SetSolver(mkl_solver);
+    }
     my_system.Update();
 
     // Set the time integrator parameters
@@ -1555,10 +1891,13 @@ int main(int argc, char* argv[]) {
     mystepper->SetMaxiters(20);
     mystepper->SetAbsTolerances(4e-4, 1e-1);
     mystepper->SetMode(ChTimestepperHHT::POSITION);
-    mystepper->SetModifiedNewton(false);
+    mystepper->SetModifiedNewton(reuse_solver != nullptr);
     mystepper->SetVerbose(true);
     mystepper->SetScaling(true);
 
+    if (!CheckpointIn.empty() && !ReadCheckpoint(CheckpointIn, my_system, LoadList))
+        return 1;
+
     // Visualization
     // auto mobjmesh = chrono_types::make_shared<ChObjShapeFile>();
     // mobjmesh->SetFilename(GetChronoDataFile("fea/tractor_wheel_rim.obj"));
@@ -1705,6 +2044,11 @@ int main(int argc, char* argv[]) {
             if (!application.GetPaused()) {
                 std::cout << "Time t = " << my_system.GetChTime() << "s \n";
                 AccuNoIterations += mystepper->GetNumIterations();
+                if (reuse_solver)
+                    reuse_solver->StepCompleted(mystepper->GetNumIterations());
+                if (!CheckpointOut.empty() && ++NumSteps % CheckpointSteps == 0 &&
+                    !WriteCheckpoint(CheckpointOut, my_system, LoadList))
+                    printf("Could not write checkpoint %s\n", CheckpointOut.c_str());
 
                 //==============================//
                 //== Output programs ===========//
@@ -1831,6 +2175,11 @@ int main(int argc, char* argv[]) {
             Rim->Accumulate_force(ChVector<>(0.0, 0.0, -5000.0), Rim->GetPos(), 0);
             //==Start analysis==//
             my_system.DoStepDynamics(timestep);
+            if (reuse_solver)
+                reuse_solver->StepCompleted(mystepper->GetNumIterations());
+            if (!CheckpointOut.empty() && ++NumSteps % CheckpointSteps == 0 &&
+                !WriteCheckpoint(CheckpointOut, my_system, LoadList))
+                printf("Could not write checkpoint %s\n", CheckpointOut.c_str());
 
             //==============================//
             //== Output programs ===========//
@@ -1949,9 +2298,17 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    if (!CheckpointOut.empty() && !WriteCheckpoint(CheckpointOut, my_system, LoadList))
+        printf("Could not write checkpoint %s\n", CheckpointOut.c_str());
+
     double duration = (std::clock() - start) / (double)CLOCKS_PER_SEC;
     auto mystepper1 = std::dynamic_pointer_cast<ChTimestepperHHT>(my_system.GetTimestepper());
     GetLog() << "Simulation Time: " << duration << "\n";
+    if (reuse_solver) {
+        GetLog() << "Factorizations: " << reuse_solver->GetNumFactorizations()
+                 << "  Reuses: " << reuse_solver->GetNumReuses()
+                 << "  Newton iterations per step: " << reuse_solver->GetIterationsPerStep() << "\n";
+    }
     fprintf(outputfile3, "%15.7e  ", duration);
     fprintf(outputfile3, "%d  ", mystepper1->GetNumIterations());
     fprintf(outputfile3, "\n  ");
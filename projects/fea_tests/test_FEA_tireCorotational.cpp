@@ -8,6 +8,20 @@
 // found in the LICENSE file at the top level of the distribution
 // and at http://projectchrono.org/license-chrono.txt.
 //
+// Benchmark of a corotational (tetrahedral) tire.
+//
+// Reports, per step, the cost of the corotation update (rotation extraction of
+// all elements), internal force evaluation, stiffness (Jacobian) update, and
+// linear solve, as well as the real-time factor. The corotation update can be
+// performed in parallel over the elements (default) or serially.
+//
+// Usage: test_FEA_tireCorotational [--threads n] [--steps n] [--serial_update] [--visualization]
+//
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
 
 #include "chrono/ChConfig.h"
 #include "chrono/assets/ChColorAsset.h"
@@ -49,6 +63,50 @@ using namespace chrono::irrlicht;
 using namespace irr;
 #endif
 
+// Mesh with optional parallel update of the element corotation frames.
+// Same as ChMesh::Update, except that the element loop (in which corotational elements extract their rotation from
+// the current node positions) is timed and, if enabled, distributed over the OpenMP threads. Element updates only
+// write element data, so they can be performed concurrently.
+class ChMeshCorotational : public ChMesh {
+  public:
+    ChMeshCorotational() : m_parallel_update(true), m_num_calls_update(0) {}
+
+    virtual ChMeshCorotational* Clone() const override { return new ChMeshCorotational(*this); }
+
+    void SetParallelUpdate(bool val) { m_parallel_update = val; }
+
+    void ResetTimers() {
+        ChMesh::ResetTimers();
+        m_timer_update.reset();
+        m_num_calls_update = 0;
+    }
+
+    double GetTimeRotationUpdate() const { return m_timer_update(); }
+    int GetNumCallsRotationUpdate() const { return m_num_calls_update; }
+
+    virtual void Update(double mytime, bool update_assets = true) override {
+        ChIndexedNodes::Update(mytime, update_assets);
+
+        m_timer_update.start();
+        int num_elements = (int)GetNelements();
+        if (m_parallel_update) {
+#pragma omp parallel for schedule(static)
+            for (int ie = 0; ie < num_elements; ie++)
+                GetElement(ie)->Update();
+        } else {
+            for (int ie = 0; ie < num_elements; ie++)
+                GetElement(ie)->Update();
+        }
+        m_timer_update.stop();
+        m_num_calls_update++;
+    }
+
+  private:
+    bool m_parallel_update;
+    ChTimer<double> m_timer_update;
+    int m_num_calls_update;
+};
+
 int main(int argc, char* argv[]) {
     // ---------------------------------
     // Set path to Chrono data directory
@@ -71,6 +129,24 @@ int main(int argc, char* argv[]) {
 
     bool visualization = false;
 
+    bool parallel_update = true;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            num_threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--steps" && i + 1 < argc) {
+            num_steps = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--serial_update") {
+            parallel_update = false;
+        } else if (arg == "--visualization") {
+            visualization = true;
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--threads n] [--steps n] [--serial_update] [--visualization]\n";
+            return 1;
+        }
+    }
+
     // --------------------------
     // Model parameters
     // --------------------------
@@ -121,7 +197,8 @@ int main(int argc, char* argv[]) {
     mesh_material->Set_density(1000);
 
     // Create tire mesh from ABAQUS input file
-    auto my_mesh = chrono_types::make_shared<ChMesh>();
+    auto my_mesh = chrono_types::make_shared<ChMeshCorotational>();
+    my_mesh->SetParallelUpdate(parallel_update);
     std::map<std::string, std::vector<std::shared_ptr<ChNodeFEAbase>>> node_sets;
 
     try {
@@ -325,21 +402,38 @@ int main(int argc, char* argv[]) {
 #endif
     } else {
         // Simulation loop
+        GetLog() << "Elements: " << my_mesh->GetNelements() << "  nodes: " << my_mesh->GetNnodes()
+                 << "  threads: " << num_threads << "  corotation update: " << (parallel_update ? "parallel" : "serial")
+                 << "\n";
+
         ChTimer<> timer;
-        timer.start();
+        double time_solve = 0;
+        my_mesh->ResetTimers();
         for (int istep = 0; istep < num_steps; istep++) {
+            timer.start();
             my_system.DoStepDynamics(step_size);
+            timer.stop();
+            time_solve += my_system.GetTimerLSsolve();
         }
-        timer.stop();
 
-        // Report run time.
-        GetLog() << "Simulation time:  " << timer() << "\n";
-        GetLog() << "Internal forces (" << my_mesh->GetNumCallsInternalForces()
-                 << "):  " << my_mesh->GetTimeInternalForces() << "\n";
-        GetLog() << "Jacobian (" << my_mesh->GetNumCallsJacobianLoad() << "):  " << my_mesh->GetTimeJacobianLoad()
+        // Report run time, in total and per step (in ms).
+        double time_rotation = my_mesh->GetTimeRotationUpdate();
+        double time_forces = my_mesh->GetTimeInternalForces();
+        double time_jacobian = my_mesh->GetTimeJacobianLoad();
+        double to_ms = 1000.0 / num_steps;
+        GetLog() << "Simulation time:  " << timer() << "  (real-time factor " << timer() / (num_steps * step_size)
+                 << ")\n";
+        GetLog() << "Per step [ms]\n";
+        GetLog() << "  total:              " << timer() * to_ms << "\n";
+        GetLog() << "  corotation update (" << my_mesh->GetNumCallsRotationUpdate() << "):  " << time_rotation * to_ms
+                 << "\n";
+        GetLog() << "  internal forces (" << my_mesh->GetNumCallsInternalForces() << "):  " << time_forces * to_ms
                  << "\n";
-        GetLog() << "Extra time:  " << timer() - my_mesh->GetTimeInternalForces() - my_mesh->GetTimeJacobianLoad()
+        GetLog() << "  stiffness update (" << my_mesh->GetNumCallsJacobianLoad() << "):  " << time_jacobian * to_ms
                  << "\n";
+        GetLog() << "  linear solve:       " << time_solve * to_ms << "\n";
+        GetLog() << "  other:              "
+                 << (timer() - time_rotation - time_forces - time_jacobian - time_solve) * to_ms << "\n";
     }
 
     return 0;
@@ -0,0 +1,482 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Asynchronous binary frame output for Chrono::Multicore systems, as a fast
+// alternative to utils::WriteShapesPovray.
+//
+// FrameExporter::Write only copies the body states (positions, orientations,
+// and active flags, from the multicore data manager) into a staging buffer on
+// the simulation thread. The staging buffers are written on a background
+// thread, optionally compressed with zlib (if FRAME_EXPORT_HAVE_ZLIB is
+// defined). The simulation thread blocks only if all staging buffers are
+// waiting to be written.
+//
+// The visualization shapes of the bodies (type, position and orientation
+// relative to the body, dimensions) are extracted once, then again only when
+// the number of bodies changes, and shared by all frames.
+//
+// Each file contains a header followed by the frame data:
+//   header: magic "CHPF", uint32 version, uint32 compressed flag, double time,
+//           uint32 number of bodies, uint32 number of shapes
+//   data:   one block per body field, in order (structure of arrays):
+//             identifiers (int32 per body), active flags (int32 per body),
+//             positions (3 doubles per body), orientations (4 doubles per
+//             body, e0..e3)
+//           followed by the array of shapes (FrameShape records: body index
+//           (int32), type (int32), position (3 doubles), orientation (4
+//           doubles), dimensions (7 doubles))
+// With compression, the data is a gzip stream (the header is not compressed).
+//
+// ReadFrame reads a frame file back; WriteFramePovray and WriteFrameCSV
+// produce the utils::WriteShapesPovray text format (without links) and a CSV
+// file of body states (see test_MCORE_frame_convert).
+//
+// =============================================================================
+
+#ifndef FRAME_EXPORTER_H
+#define FRAME_EXPORTER_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef FRAME_EXPORT_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "chrono/assets/ChBoxShape.h"
+#include "chrono/assets/ChCapsuleShape.h"
+#include "chrono/assets/ChConeShape.h"
+#include "chrono/assets/ChCylinderShape.h"
+#include "chrono/assets/ChEllipsoidShape.h"
+#include "chrono/assets/ChSphereShape.h"
+#include "chrono/collision/ChCollisionShape.h"
+
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+
+/// Visualization shape of a body, relative to the body frame.
+struct FrameShape {
+    int32_t body;    ///< body index
+    int32_t type;    ///< shape type (collision::ChCollisionShape::Type)
+    double pos[3];   ///< position
+    double rot[4];   ///< orientation
+    double dims[7];  ///< dimensions (as written by utils::WriteShapesPovray)
+};
+
+/// Contents of one output frame.
+struct FrameData {
+    double time;
+    std::vector<int32_t> body_id;
+    std::vector<int32_t> body_active;
+    std::vector<double> body_pos;  ///< 3 per body
+    std::vector<double> body_rot;  ///< 4 per body
+    std::shared_ptr<const std::vector<FrameShape>> shapes;
+};
+
+class FrameExporter {
+  public:
+    /// Start the writer thread, with the given number of staging buffers.
+    FrameExporter(bool compress = false, int num_buffers = 2)
+        : m_compress(compress), m_num_bodies(0), m_exit(false), m_num_frames(0) {
+#ifndef FRAME_EXPORT_HAVE_ZLIB
+        if (m_compress) {
+            std::cout << "Compressed output not available (no zlib), writing uncompressed frames" << std::endl;
+            m_compress = false;
+        }
+#endif
+        m_free.resize(std::max(num_buffers, 1));
+        for (auto& frame : m_free)
+            frame = std::unique_ptr<Frame>(new Frame);
+        m_thread = std::thread(&FrameExporter::Loop, this);
+    }
+
+    /// Write all pending frames and stop the writer thread.
+    ~FrameExporter() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_exit = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+
+    /// Take a snapshot of the system state and queue it for writing to the given file.
+    void Write(chrono::ChSystemMulticore* system, const std::string& filename) {
+        using namespace chrono;
+
+        if (system->Get_bodylist().size() != m_num_bodies)
+            ExtractShapes(system);
+
+        // Get a free staging buffer (waiting for the writer thread if none is available)
+        std::unique_ptr<Frame> frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return !m_free.empty(); });
+            frame = std::move(m_free.back());
+            m_free.pop_back();
+        }
+
+        frame->filename = filename;
+        frame->data.time = system->GetChTime();
+        frame->data.body_id = m_body_id;
+        frame->data.shapes = m_shapes;
+        frame->data.body_active.resize(m_num_bodies);
+        frame->data.body_pos.resize(3 * m_num_bodies);
+        frame->data.body_rot.resize(4 * m_num_bodies);
+
+        const auto& host = system->data_manager->host_data;
+        int num_bodies = (int)m_num_bodies;
+        if (host.pos_rigid.size() == m_num_bodies && host.rot_rigid.size() == m_num_bodies &&
+            host.active_rigid.size() == m_num_bodies) {
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < num_bodies; i++) {
+                frame->data.body_active[i] = host.active_rigid[i] ? 1 : 0;
+                frame->data.body_pos[3 * i + 0] = host.pos_rigid[i].x;
+                frame->data.body_pos[3 * i + 1] = host.pos_rigid[i].y;
+                frame->data.body_pos[3 * i + 2] = host.pos_rigid[i].z;
+                frame->data.body_rot[4 * i + 0] = host.rot_rigid[i].w;
+                frame->data.body_rot[4 * i + 1] = host.rot_rigid[i].x;
+                frame->data.body_rot[4 * i + 2] = host.rot_rigid[i].y;
+                frame->data.body_rot[4 * i + 3] = host.rot_rigid[i].z;
+            }
+        } else {
+            // Not set up yet (before the first step)
+            const auto& bodies = system->Get_bodylist();
+            for (int i = 0; i < num_bodies; i++) {
+                const ChVector<>& pos = bodies[i]->GetPos();
+                const ChQuaternion<>& rot = bodies[i]->GetRot();
+                frame->data.body_active[i] = bodies[i]->IsActive() ? 1 : 0;
+                for (int k = 0; k < 3; k++)
+                    frame->data.body_pos[3 * i + k] = pos[k];
+                for (int k = 0; k < 4; k++)
+                    frame->data.body_rot[4 * i + k] = rot[k];
+            }
+        }
+
+        // Hand the buffer over to the writer thread
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(std::move(frame));
+        }
+        m_cv.notify_all();
+        m_num_frames++;
+    }
+
+    /// Return the number of frames queued so far.
+    int GetNumFrames() const { return m_num_frames; }
+
+  private:
+    struct Frame {
+        std::string filename;
+        FrameData data;
+    };
+
+    // Extract the visualization shapes of all bodies (as utils::WriteShapesPovray).
+    void ExtractShapes(chrono::ChSystemMulticore* system) {
+        using namespace chrono;
+        using namespace chrono::collision;
+
+        const auto& bodies = system->Get_bodylist();
+        m_num_bodies = bodies.size();
+        m_body_id.resize(m_num_bodies);
+        auto shapes = std::make_shared<std::vector<FrameShape>>();
+        for (size_t ib = 0; ib < m_num_bodies; ib++) {
+            m_body_id[ib] = bodies[ib]->GetIdentifier();
+            for (const auto& asset : bodies[ib]->GetAssets()) {
+                auto visual = std::dynamic_pointer_cast<ChVisualization>(asset);
+                if (!visual)
+                    continue;
+                FrameShape shape;
+                std::memset(&shape, 0, sizeof(shape));
+                shape.body = (int32_t)ib;
+                double* dims = shape.dims;
+                if (auto sphere = std::dynamic_pointer_cast<ChSphereShape>(visual)) {
+                    shape.type = ChCollisionShape::Type::SPHERE;
+                    dims[0] = sphere->GetSphereGeometry().rad;
+                } else if (auto ellipsoid = std::dynamic_pointer_cast<ChEllipsoidShape>(visual)) {
+                    shape.type = ChCollisionShape::Type::ELLIPSOID;
+                    const ChVector<>& rad = ellipsoid->GetEllipsoidGeometry().rad;
+                    for (int k = 0; k < 3; k++)
+                        dims[k] = rad[k];
+                } else if (auto box = std::dynamic_pointer_cast<ChBoxShape>(visual)) {
+                    shape.type = ChCollisionShape::Type::BOX;
+                    const ChVector<>& size = box->GetBoxGeometry().Size;
+                    for (int k = 0; k < 3; k++)
+                        dims[k] = size[k];
+                } else if (auto capsule = std::dynamic_pointer_cast<ChCapsuleShape>(visual)) {
+                    shape.type = ChCollisionShape::Type::CAPSULE;
+                    dims[0] = capsule->GetCapsuleGeometry().rad;
+                    dims[1] = capsule->GetCapsuleGeometry().hlen;
+                } else if (auto cylinder = std::dynamic_pointer_cast<ChCylinderShape>(visual)) {
+                    shape.type = ChCollisionShape::Type::CYLINDER;
+                    const auto& geometry = cylinder->GetCylinderGeometry();
+                    dims[0] = geometry.rad;
+                    for (int k = 0; k < 3; k++) {
+                        dims[1 + k] = geometry.p1[k];
+                        dims[4 + k] = geometry.p2[k];
+                    }
+                } else if (auto cone = std::dynamic_pointer_cast<ChConeShape>(visual)) {
+                    shape.type = ChCollisionShape::Type::CONE;
+                    dims[0] = cone->GetConeGeometry().rad.x();
+                    dims[1] = cone->GetConeGeometry().rad.y();
+                } else {
+                    continue;
+                }
+                ChQuaternion<> rot = visual->Rot.Get_A_quaternion();
+                for (int k = 0; k < 3; k++)
+                    shape.pos[k] = visual->Pos[k];
+                for (int k = 0; k < 4; k++)
+                    shape.rot[k] = rot[k];
+                shapes->push_back(shape);
+            }
+        }
+        m_shapes = shapes;
+    }
+
+    void Loop() {
+        while (true) {
+            std::unique_ptr<Frame> frame;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]() { return !m_queue.empty() || m_exit; });
+                if (m_queue.empty())
+                    return;
+                frame = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            WriteFile(*frame);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_free.push_back(std::move(frame));
+            }
+            m_cv.notify_all();
+        }
+    }
+
+    void WriteFile(const Frame& frame) {
+        const FrameData& data = frame.data;
+        FILE* file = fopen(frame.filename.c_str(), "wb");
+        if (!file) {
+            std::cout << "Error opening output file " << frame.filename << std::endl;
+            return;
+        }
+        const uint32_t version = 1;
+        const uint32_t compressed = m_compress ? 1 : 0;
+        const uint32_t num_bodies = (uint32_t)data.body_id.size();
+        const uint32_t num_shapes = (uint32_t)data.shapes->size();
+        fwrite("CHPF", 1, 4, file);
+        fwrite(&version, sizeof(version), 1, file);
+        fwrite(&compressed, sizeof(compressed), 1, file);
+        fwrite(&data.time, sizeof(data.time), 1, file);
+        fwrite(&num_bodies, sizeof(num_bodies), 1, file);
+        fwrite(&num_shapes, sizeof(num_shapes), 1, file);
+
+        struct Block {
+            const void* ptr;
+            size_t size;
+        };
+        Block blocks[5] = {{data.body_id.data(), num_bodies * sizeof(int32_t)},
+                           {data.body_active.data(), num_bodies * sizeof(int32_t)},
+                           {data.body_pos.data(), 3 * num_bodies * sizeof(double)},
+                           {data.body_rot.data(), 4 * num_bodies * sizeof(double)},
+                           {data.shapes->data(), num_shapes * sizeof(FrameShape)}};
+
+        if (!m_compress) {
+            for (const auto& block : blocks)
+                fwrite(block.ptr, 1, block.size, file);
+            fclose(file);
+            return;
+        }
+
+        fclose(file);
+#ifdef FRAME_EXPORT_HAVE_ZLIB
+        gzFile gz_file = gzopen(frame.filename.c_str(), "ab1");
+        for (const auto& block : blocks)
+            gzwrite(gz_file, block.ptr, (unsigned int)block.size);
+        gzclose(gz_file);
+#endif
+    }
+
+    bool m_compress;
+
+    size_t m_num_bodies;                                      // number of bodies when the shapes were extracted
+    std::vector<int32_t> m_body_id;                           // body identifiers
+    std::shared_ptr<const std::vector<FrameShape>> m_shapes;  // visualization shapes
+
+    std::vector<std::unique_ptr<Frame>> m_free;  // staging buffers available to the simulation thread
+    std::deque<std::unique_ptr<Frame>> m_queue;  // staging buffers waiting to be written
+    bool m_exit;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+    int m_num_frames;
+};
+
+/// Read a frame file written by FrameExporter. Return false if the file cannot be read.
+inline bool ReadFrame(const std::string& filename, FrameData& data) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (!file)
+        return false;
+    char magic[4];
+    uint32_t version, compressed, num_bodies, num_shapes;
+    bool ok = fread(magic, 1, 4, file) == 4 && memcmp(magic, "CHPF", 4) == 0;
+    ok = ok && fread(&version, sizeof(version), 1, file) == 1 && version == 1;
+    ok = ok && fread(&compressed, sizeof(compressed), 1, file) == 1;
+    ok = ok && fread(&data.time, sizeof(data.time), 1, file) == 1;
+    ok = ok && fread(&num_bodies, sizeof(num_bodies), 1, file) == 1;
+    ok = ok && fread(&num_shapes, sizeof(num_shapes), 1, file) == 1;
+    if (!ok) {
+        fclose(file);
+        return false;
+    }
+
+    // Read (and decompress) the frame data
+    size_t size = num_bodies * (2 * sizeof(int32_t) + 7 * sizeof(double)) + num_shapes * sizeof(FrameShape);
+    std::vector<char> buffer(size);
+    if (!compressed) {
+        ok = fread(buffer.data(), 1, size, file) == size;
+        fclose(file);
+    } else {
+#ifdef FRAME_EXPORT_HAVE_ZLIB
+        std::vector<char> input;
+        char chunk[1 << 16];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+            input.insert(input.end(), chunk, chunk + n);
+        fclose(file);
+        z_stream strm;
+        std::memset(&strm, 0, sizeof(strm));
+        ok = inflateInit2(&strm, 16 + MAX_WBITS) == Z_OK;
+        if (ok) {
+            strm.next_in = (Bytef*)input.data();
+            strm.avail_in = (uInt)input.size();
+            strm.next_out = (Bytef*)buffer.data();
+            strm.avail_out = (uInt)size;
+            int ret = inflate(&strm, Z_FINISH);
+            ok = (ret == Z_STREAM_END || ret == Z_OK) && strm.avail_out == 0;
+            inflateEnd(&strm);
+        }
+#else
+        std::cout << "Compressed frames not supported (no zlib)" << std::endl;
+        fclose(file);
+        ok = false;
+#endif
+    }
+    if (!ok)
+        return false;
+
+    const char* p = buffer.data();
+    auto read = [&p](void* dst, size_t bytes) {
+        std::memcpy(dst, p, bytes);
+        p += bytes;
+    };
+    data.body_id.resize(num_bodies);
+    data.body_active.resize(num_bodies);
+    data.body_pos.resize(3 * num_bodies);
+    data.body_rot.resize(4 * num_bodies);
+    auto shapes = std::make_shared<std::vector<FrameShape>>(num_shapes);
+    read(data.body_id.data(), num_bodies * sizeof(int32_t));
+    read(data.body_active.data(), num_bodies * sizeof(int32_t));
+    read(data.body_pos.data(), 3 * num_bodies * sizeof(double));
+    read(data.body_rot.data(), 4 * num_bodies * sizeof(double));
+    read(shapes->data(), num_shapes * sizeof(FrameShape));
+    data.shapes = shapes;
+    return true;
+}
+
+/// Write a frame in the utils::WriteShapesPovray format (links are not included). Return false on failure.
+inline bool WriteFramePovray(const FrameData& data,
+                             const std::string& filename,
+                             bool body_info = true,
+                             const std::string& delim = ",") {
+    using namespace chrono;
+    using namespace chrono::collision;
+
+    FILE* file = fopen(filename.c_str(), "w");
+    if (!file)
+        return false;
+    const char* d = delim.c_str();
+    size_t num_bodies = data.body_id.size();
+    size_t num_shapes = data.shapes->size();
+    fprintf(file, "%d%s%d%s%d%s\n", body_info ? (int)num_bodies : 0, d, (int)num_shapes, d, 0, d);
+
+    if (body_info) {
+        for (size_t i = 0; i < num_bodies; i++) {
+            const double* p = &data.body_pos[3 * i];
+            const double* q = &data.body_rot[4 * i];
+            fprintf(file, "%d%s%d%s%g%s%g%s%g%s%g%s%g%s%g%s%g%s\n", data.body_id[i], d, data.body_active[i], d, p[0],
+                    d, p[1], d, p[2], d, q[0], d, q[1], d, q[2], d, q[3], d);
+        }
+    }
+
+    for (const auto& shape : *data.shapes) {
+        size_t i = shape.body;
+        ChVector<> body_pos(data.body_pos[3 * i], data.body_pos[3 * i + 1], data.body_pos[3 * i + 2]);
+        ChQuaternion<> body_rot(data.body_rot[4 * i], data.body_rot[4 * i + 1], data.body_rot[4 * i + 2],
+                                data.body_rot[4 * i + 3]);
+        ChVector<> pos = body_pos + body_rot.Rotate(ChVector<>(shape.pos[0], shape.pos[1], shape.pos[2]));
+        ChQuaternion<> rot = body_rot % ChQuaternion<>(shape.rot[0], shape.rot[1], shape.rot[2], shape.rot[3]);
+        fprintf(file, "%d%s%d%s%g%s%g%s%g%s%g%s%g%s%g%s%g%s%d", data.body_id[i], d, data.body_active[i], d, pos.x(), d,
+                pos.y(), d, pos.z(), d, rot.e0(), d, rot.e1(), d, rot.e2(), d, rot.e3(), d, shape.type);
+        int num_dims = 0;
+        switch (shape.type) {
+            case ChCollisionShape::Type::SPHERE:
+                num_dims = 1;
+                break;
+            case ChCollisionShape::Type::CAPSULE:
+            case ChCollisionShape::Type::CONE:
+                num_dims = 2;
+                break;
+            case ChCollisionShape::Type::CYLINDER:
+                num_dims = 7;
+                break;
+            default:
+                num_dims = 3;
+                break;
+        }
+        for (int k = 0; k < num_dims; k++)
+            fprintf(file, "%s%g", d, shape.dims[k]);
+        fprintf(file, "%s\n", d);
+    }
+
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+/// Write the body states of a frame to a CSV file. Return false on failure.
+inline bool WriteFrameCSV(const FrameData& data, const std::string& filename) {
+    FILE* file = fopen(filename.c_str(), "w");
+    if (!file)
+        return false;
+    fprintf(file, "id,active,x,y,z,e0,e1,e2,e3\n");
+    for (size_t i = 0; i < data.body_id.size(); i++) {
+        const double* p = &data.body_pos[3 * i];
+        const double* q = &data.body_rot[4 * i];
+        fprintf(file, "%d,%d,%.8g,%.8g,%.8g,%.8g,%.8g,%.8g,%.8g\n", data.body_id[i], data.body_active[i], p[0], p[1],
+                p[2], q[0], q[1], q[2], q[3]);
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+#endif
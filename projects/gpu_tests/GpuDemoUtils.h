@@ -1,11 +1,44 @@
 #pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
+#if defined(_WIN32)
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef GPU_PROJECTS_NVTX
+#include <nvtx3/nvToolsExt.h>
+#endif
+
+#include "chrono/core/ChQuaternion.h"
 #include "chrono/core/ChVector.h"
 
-void tokenizeCSVLine(std::ifstream& istream, std::vector<float> data) {
+void tokenizeCSVLine(std::ifstream& istream, std::vector<float>& data) {
     std::string line;
     std::getline(istream, line);  // load in current line
     std::stringstream lineStream(line);
@@ -17,22 +50,1295 @@ void tokenizeCSVLine(std::ifstream& istream, std::vector<float> data) {
     }
 }
 
-// load sphere positions from a checkpoint file
+// -----------------------------------------------------------------------------
+// Checkpoint files with sphere positions, either CSV (one header line, then one
+// line per sphere starting with x,y,z) or binary (see writePositionCheckpoint):
+//   "CHGP", uint32 version, uint32 scalar size (4 or 8), uint64 count, then
+//   count x (x, y, z) scalars.
+// The file is memory mapped and the CSV lines are parsed in parallel, in chunks
+// of lines, directly into the (preallocated) output vector.
+// -----------------------------------------------------------------------------
+
+// Read-only view of a whole file (memory mapped where available).
+class MappedCheckpointFile {
+  public:
+    MappedCheckpointFile(const std::string& filename) : m_data(nullptr), m_size(0), m_mapped(false) {
+#if defined(_WIN32)
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file.good())
+            return;
+        m_buffer.resize((size_t)file.tellg());
+        file.seekg(0);
+        file.read(m_buffer.data(), m_buffer.size());
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+#else
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* addr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                madvise(addr, (size_t)st.st_size, MADV_SEQUENTIAL);
+                m_data = (const char*)addr;
+                m_size = (size_t)st.st_size;
+                m_mapped = true;
+            }
+        }
+        close(fd);
+#endif
+    }
+
+    ~MappedCheckpointFile() {
+#if !defined(_WIN32)
+        if (m_mapped)
+            munmap((void*)m_data, m_size);
+#endif
+    }
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+  private:
+    const char* m_data;
+    size_t m_size;
+    bool m_mapped;
+    std::vector<char> m_buffer;
+};
+
+// Parse a decimal floating point number in [p, end), stopping at the first character which is not part of it.
+// Numbers with at most 19 significant digits are converted directly (within one ulp of strtod); others, and special
+// values, are converted with strtod.
+inline double parseCheckpointDouble(const char*& p, const char* end) {
+    static const double pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = (*p++ == '-');
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any = false;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (digits < 19) {
+            mantissa = 10 * mantissa + (*p - '0');
+            if (mantissa)
+                digits++;
+        } else {
+            exponent++;
+        }
+        p++;
+        any = true;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (digits < 19) {
+                mantissa = 10 * mantissa + (*p - '0');
+                if (mantissa)
+                    digits++;
+                exponent--;
+            }
+            p++;
+            any = true;
+        }
+    }
+    if (any && p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool exp_negative = false;
+        if (q < end && (*q == '-' || *q == '+'))
+            exp_negative = (*q++ == '-');
+        if (q < end && *q >= '0' && *q <= '9') {
+            int e = 0;
+            while (q < end && *q >= '0' && *q <= '9') {
+                if (e < 10000)
+                    e = 10 * e + (*q - '0');
+                q++;
+            }
+            exponent += exp_negative ? -e : e;
+            p = q;
+        }
+    }
+
+    if (!any || digits >= 19 || exponent < -22 || exponent > 22) {
+        // Fall back to strtod (on a bounded copy, since the mapped buffer is not null-terminated)
+        char buf[64];
+        size_t len = 0;
+        const char* q = start;
+        while (q < end && len < sizeof(buf) - 1 && *q != ',' && *q != '\n' && *q != '\r' && *q != ' ' && *q != '\t')
+            buf[len++] = *q++;
+        buf[len] = '\0';
+        char* stop;
+        double value = strtod(buf, &stop);
+        p = start + (stop - buf);
+        return value;
+    }
+
+    double value = (double)mantissa;
+    value = exponent < 0 ? value / pow10[-exponent] : value * pow10[exponent];
+    return negative ? -value : value;
+}
+
+// Parse the CSV line [p, end) as a position (first three values). Return false if the line has fewer values.
 template <typename T>
-std::vector<chrono::ChVector<T>> loadPositionCheckpoint(std::string infile) {
-    // file stream to load in
-    std::ifstream ptFile(infile);
+bool parseCheckpointLine(const char* p, const char* end, chrono::ChVector<T>& pos) {
+    T v[3];
+    for (int k = 0; k < 3; k++) {
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+        const char* q = p;
+        v[k] = (T)parseCheckpointDouble(p, end);
+        if (p == q)
+            return false;
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+        if (k < 2) {
+            if (p == end || *p != ',')
+                return false;
+            p++;
+        }
+    }
+    pos = chrono::ChVector<T>(v[0], v[1], v[2]);
+    return true;
+}
 
+// Load positions from a binary checkpoint. Return false if the buffer is not a valid binary checkpoint.
+template <typename T>
+bool loadBinaryPositions(const char* data, size_t size, std::vector<chrono::ChVector<T>>& positions) {
+    const size_t header_size = 4 + 4 + 4 + 8;
+    if (size < header_size || memcmp(data, "CHGP", 4) != 0)
+        return false;
+    uint32_t version, scalar_size;
+    uint64_t count;
+    memcpy(&version, data + 4, 4);
+    memcpy(&scalar_size, data + 8, 4);
+    memcpy(&count, data + 12, 8);
+    if (version != 1 || (scalar_size != 4 && scalar_size != 8) || size < header_size + count * 3 * scalar_size)
+        return false;
+
+    positions.resize((size_t)count);
+    const char* values = data + header_size;
+    long long n = (long long)count;
+#pragma omp parallel for schedule(static)
+    for (long long i = 0; i < n; i++) {
+        T v[3];
+        for (int k = 0; k < 3; k++) {
+            if (scalar_size == 4) {
+                float f;
+                memcpy(&f, values + (3 * i + k) * 4, 4);
+                v[k] = (T)f;
+            } else {
+                double d;
+                memcpy(&d, values + (3 * i + k) * 8, 8);
+                v[k] = (T)d;
+            }
+        }
+        positions[i] = chrono::ChVector<T>(v[0], v[1], v[2]);
+    }
+    return true;
+}
+
+// load sphere positions from a checkpoint file (CSV or binary)
+template <typename T>
+std::vector<chrono::ChVector<T>> loadPositionCheckpoint(std::string infile) {
     std::vector<chrono::ChVector<T>> sphere_positions;
-    std::string tmp_line;
-    std::getline(ptFile, tmp_line);  // skip first header line
-    // TODO look ahead and reserve space to avoid push_backs
-    while (ptFile.good()) {
-        std::vector<float> line_data;
-        tokenizeCSVLine(ptFile, line_data);
-        chrono::ChVector<> curr_pos(line_data.at(0), line_data.at(1), line_data.at(2));
-        sphere_positions.push_back(curr_pos);
+    MappedCheckpointFile file(infile);
+    const char* data = file.data();
+    size_t size = file.size();
+    if (!data)
+        return sphere_positions;
+
+    if (loadBinaryPositions(data, size, sphere_positions))
+        return sphere_positions;
+
+    // Skip the header line
+    const char* body = (const char*)memchr(data, '\n', size);
+    if (!body)
+        return sphere_positions;
+    body++;
+    const char* end = data + size;
+
+    // Split the file in chunks of whole lines and count the lines of each chunk
+    int num_chunks = 1;
+#ifdef _OPENMP
+    num_chunks = 4 * omp_get_max_threads();
+#endif
+    size_t chunk_size = (size_t)(end - body) / num_chunks + 1;
+    std::vector<const char*> begins(num_chunks + 1, end);
+    begins[0] = body;
+    for (int c = 1; c < num_chunks; c++) {
+        const char* p = std::max(begins[c - 1], body + std::min((size_t)(end - body), c * chunk_size));
+        const char* nl = p < end ? (const char*)memchr(p, '\n', end - p) : nullptr;
+        begins[c] = nl ? nl + 1 : end;
+    }
+    std::vector<size_t> counts(num_chunks + 1, 0);
+#pragma omp parallel for schedule(dynamic)
+    for (int c = 0; c < num_chunks; c++) {
+        size_t count = 0;
+        for (const char* p = begins[c]; p < begins[c + 1];) {
+            const char* nl = (const char*)memchr(p, '\n', begins[c + 1] - p);
+            const char* line_end = nl ? nl : begins[c + 1];
+            if (line_end > p && !(line_end - p == 1 && *p == '\r'))
+                count++;
+            p = line_end + 1;
+        }
+        counts[c + 1] = count;
+    }
+    for (int c = 0; c < num_chunks; c++)
+        counts[c + 1] += counts[c];
+
+    // Parse each chunk directly into its range of the output
+    sphere_positions.resize(counts[num_chunks]);
+    std::vector<size_t> parsed(num_chunks, 0);
+#pragma omp parallel for schedule(dynamic)
+    for (int c = 0; c < num_chunks; c++) {
+        size_t i = counts[c];
+        for (const char* p = begins[c]; p < begins[c + 1];) {
+            const char* nl = (const char*)memchr(p, '\n', begins[c + 1] - p);
+            const char* line_end = nl ? nl : begins[c + 1];
+            if (line_end > p && !(line_end - p == 1 && *p == '\r') &&
+                parseCheckpointLine(p, line_end, sphere_positions[i]))
+                i++;
+            p = line_end + 1;
+        }
+        parsed[c] = i - counts[c];
+    }
+
+    // Compact if some lines could not be parsed
+    size_t total = 0;
+    for (int c = 0; c < num_chunks; c++) {
+        if (total != counts[c])
+            std::copy(sphere_positions.begin() + counts[c], sphere_positions.begin() + counts[c] + parsed[c],
+                      sphere_positions.begin() + total);
+        total += parsed[c];
     }
+    sphere_positions.resize(total);
 
     return sphere_positions;
 }
+
+// write sphere positions to a binary checkpoint file
+template <typename T>
+bool writePositionCheckpoint(const std::vector<chrono::ChVector<T>>& positions, std::string outfile) {
+    FILE* file = fopen(outfile.c_str(), "wb");
+    if (!file)
+        return false;
+    uint32_t version = 1;
+    uint32_t scalar_size = (uint32_t)sizeof(T);
+    uint64_t count = positions.size();
+    fwrite("CHGP", 1, 4, file);
+    fwrite(&version, sizeof(version), 1, file);
+    fwrite(&scalar_size, sizeof(scalar_size), 1, file);
+    fwrite(&count, sizeof(count), 1, file);
+    for (const auto& pos : positions) {
+        T v[3] = {pos.x(), pos.y(), pos.z()};
+        fwrite(v, sizeof(T), 3, file);
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+// Asynchronous advance of a Chrono::Gpu system, for co-simulation loops in
+// which the Chrono multibody step of an interval only uses the mesh forces of
+// the previous interval: the granular step runs on a persistent host thread
+// (which drives the GPU kernels) while the calling thread advances the
+// multibody system. The mesh motion must be applied before the call, and the
+// mesh forces collected after completion of the returned handle.
+// -----------------------------------------------------------------------------
+
+template <typename GpuSystem>
+class GpuAsyncAdvance {
+  public:
+    GpuAsyncAdvance(GpuSystem& gpu_sys)
+        : m_gpu_sys(gpu_sys), m_duration(0), m_pending(false), m_exit(false), m_wait_time(0) {
+        m_thread = std::thread(&GpuAsyncAdvance::Work, this);
+    }
+
+    ~GpuAsyncAdvance() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_exit = true;
+        }
+        m_cv.notify_one();
+        m_thread.join();
+    }
+
+    /// Start advancing the granular system by the given duration and return immediately.
+    /// The returned handle completes (or rethrows the exception of the step) when the step is done; it must be waited
+    /// for before the next call and before any other access to the granular system.
+    std::future<void> AdvanceSimulationAsync(float duration) {
+        std::future<void> handle;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_promise = std::promise<void>();
+            handle = m_promise.get_future();
+            m_duration = duration;
+            m_pending = true;
+        }
+        m_cv.notify_one();
+        return handle;
+    }
+
+    /// Wait for the given handle, accumulating the time the caller was blocked.
+    void Wait(std::future<void>& handle) {
+        auto start = std::chrono::steady_clock::now();
+        handle.get();
+        m_wait_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /// Return the cumulative time (s) the caller was blocked in Wait.
+    double GetWaitTime() const { return m_wait_time; }
+
+  private:
+    void Work() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_cv.wait(lock, [this]() { return m_pending || m_exit; });
+            if (m_exit)
+                return;
+            m_pending = false;
+            float duration = m_duration;
+            lock.unlock();
+            try {
+                m_gpu_sys.AdvanceSimulation(duration);
+                m_promise.set_value();
+            } catch (...) {
+                m_promise.set_exception(std::current_exception());
+            }
+            lock.lock();
+        }
+    }
+
+    GpuSystem& m_gpu_sys;
+    float m_duration;
+    bool m_pending;
+    bool m_exit;
+    double m_wait_time;
+    std::promise<void> m_promise;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+};
+
+// -----------------------------------------------------------------------------
+// Batched mesh motion and force exchange for systems with several meshes (one
+// mesh per body, in order, starting at a given mesh index). The motions of all
+// meshes are gathered, then applied in one pass before the granular step, and
+// the forces and torques of all meshes are collected in one pass after it, so
+// that the mesh data is accessed once per step instead of interleaved with the
+// per-body force accumulation.
+// -----------------------------------------------------------------------------
+
+struct MeshMotion {
+    chrono::ChVector<> pos;
+    chrono::ChQuaternion<> rot;
+    chrono::ChVector<> lin_vel;
+    chrono::ChVector<> ang_vel;
+};
+
+// gather the motion of the mesh attached to each body
+template <typename BodyPtr>
+void gatherMeshMotions(const std::vector<BodyPtr>& bodies, std::vector<MeshMotion>& motions) {
+    motions.resize(bodies.size());
+    for (size_t i = 0; i < bodies.size(); i++)
+        motions[i] = {bodies[i]->GetPos(), bodies[i]->GetRot(), bodies[i]->GetPos_dt(), bodies[i]->GetWvel_par()};
+}
+
+// apply the motions of meshes first_mesh, first_mesh + 1, ...
+template <typename GpuSystem>
+void applyMeshMotions(GpuSystem& gpu_sys, const std::vector<MeshMotion>& motions, unsigned int first_mesh = 0) {
+    for (size_t i = 0; i < motions.size(); i++) {
+        const MeshMotion& m = motions[i];
+        gpu_sys.ApplyMeshMotion(first_mesh + (unsigned int)i, m.pos, m.rot, m.lin_vel, m.ang_vel);
+    }
+}
+
+// collect the contact forces and torques of count meshes, starting at first_mesh
+template <typename GpuSystem>
+void collectMeshContactForces(GpuSystem& gpu_sys,
+                              size_t count,
+                              std::vector<chrono::ChVector<>>& forces,
+                              std::vector<chrono::ChVector<>>& torques,
+                              unsigned int first_mesh = 0) {
+    forces.resize(count);
+    torques.resize(count);
+    for (size_t i = 0; i < count; i++)
+        gpu_sys.CollectMeshContactForces(first_mesh + (unsigned int)i, forces[i], torques[i]);
+}
+
+// -----------------------------------------------------------------------------
+// Append-only binary stream of mesh poses, one record per output frame for all
+// co-simulated meshes (instead of one text file of mesh frames per frame).
+//   header:  magic "CHMF", uint32 version, uint32 number of meshes, then per
+//            mesh: uint32 name length, name, scaling (3 doubles)
+//   records: int32 frame, double time, then per mesh: position (3 doubles)
+//            and orientation quaternion (4 doubles, e0..e3)
+// The header is written with the first record; meshes must be added before.
+// -----------------------------------------------------------------------------
+
+struct MeshPose {
+    chrono::ChVector<> pos;
+    chrono::ChQuaternion<> rot;
+};
+
+class GpuMeshStream {
+  public:
+    GpuMeshStream(const std::string& filename) : m_file(fopen(filename.c_str(), "wb")), m_started(false) {}
+
+    ~GpuMeshStream() {
+        if (m_file)
+            fclose(m_file);
+    }
+
+    /// Add a mesh to the mesh table. Return the mesh index (-1 once frames have been written).
+    int AddMesh(const std::string& name, const chrono::ChVector<>& scaling) {
+        if (m_started)
+            return -1;
+        m_names.push_back(name);
+        m_scalings.push_back(scaling);
+        return (int)m_names.size() - 1;
+    }
+
+    size_t GetNumMeshes() const { return m_names.size(); }
+
+    /// Append the poses of all meshes (in mesh table order) for the given frame.
+    bool WriteFrame(int frame, double time, const std::vector<MeshPose>& poses) {
+        if (!m_file || poses.size() != m_names.size())
+            return false;
+        if (!m_started) {
+            uint32_t version = 1;
+            uint32_t num_meshes = (uint32_t)m_names.size();
+            fwrite("CHMF", 1, 4, m_file);
+            fwrite(&version, sizeof(version), 1, m_file);
+            fwrite(&num_meshes, sizeof(num_meshes), 1, m_file);
+            for (size_t i = 0; i < m_names.size(); i++) {
+                uint32_t length = (uint32_t)m_names[i].size();
+                double scaling[3] = {m_scalings[i].x(), m_scalings[i].y(), m_scalings[i].z()};
+                fwrite(&length, sizeof(length), 1, m_file);
+                fwrite(m_names[i].data(), 1, length, m_file);
+                fwrite(scaling, sizeof(double), 3, m_file);
+            }
+            m_started = true;
+        }
+        int32_t index = frame;
+        fwrite(&index, sizeof(index), 1, m_file);
+        fwrite(&time, sizeof(time), 1, m_file);
+        for (const auto& pose : poses) {
+            double data[7] = {pose.pos.x(), pose.pos.y(), pose.pos.z(), pose.rot.e0(),
+                              pose.rot.e1(), pose.rot.e2(), pose.rot.e3()};
+            fwrite(data, sizeof(double), 7, m_file);
+        }
+        fflush(m_file);
+        return !ferror(m_file);
+    }
+
+  private:
+    FILE* m_file;
+    bool m_started;
+    std::vector<std::string> m_names;
+    std::vector<chrono::ChVector<>> m_scalings;
+};
+
+// -----------------------------------------------------------------------------
+// Asynchronous columnar binary particle output. The selected particle columns
+// are copied from the granular system into one of two host staging buffers
+// (in parallel chunks of particles) on the simulation thread; the buffer is
+// then written on a background thread while the simulation proceeds with the
+// other buffer. The simulation thread blocks only if the previous frame has
+// not been written yet.
+//
+// Each file (<filename>.chgf) contains a header followed by the columns:
+//   header:  magic "CHGF", uint32 version, uint32 column flags, uint64 count,
+//            double time
+//   columns: in the order of the flags below, for the selected ones:
+//            position, velocity, angular velocity (count x 3 floats each),
+//            fixity (count x uint8)
+// A frame with all columns is a full particle state checkpoint (see
+// writeStateCheckpoint and loadStateCheckpoint below). With a mesh stream, the
+// mesh poses given with a frame are appended to the stream by the writer
+// thread, with the same frame index.
+// -----------------------------------------------------------------------------
+
+enum GpuFrameColumns : uint32_t {
+    GPU_FRAME_POSITION = 1 << 0,
+    GPU_FRAME_VELOCITY = 1 << 1,
+    GPU_FRAME_ANG_VELOCITY = 1 << 2,
+    GPU_FRAME_FIXITY = 1 << 3,
+    GPU_FRAME_ALL = 0xF
+};
+
+template <typename GpuSystem>
+class GpuFrameWriter {
+  public:
+    GpuFrameWriter(uint32_t columns = GPU_FRAME_ALL)
+        : m_columns(columns),
+          m_mesh_stream(nullptr),
+          m_num_frames(0),
+          m_fill(0),
+          m_write(0),
+          m_pending(false),
+          m_exit(false),
+          m_ok(true) {
+        m_thread = std::thread(&GpuFrameWriter::Loop, this);
+    }
+
+    ~GpuFrameWriter() {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return !m_pending; });
+            m_exit = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+
+    /// Set the stream to which the mesh poses of the frames are appended (used only by the writer thread).
+    void SetMeshStream(GpuMeshStream* stream) { m_mesh_stream = stream; }
+
+    /// Take a snapshot of the selected particle columns (and of the given mesh poses) and queue it for writing to
+    /// <filename>.chgf (and to the mesh stream).
+    void WriteFrame(const GpuSystem& gpu_sys,
+                    const std::string& filename,
+                    double time,
+                    const std::vector<MeshPose>& mesh_poses = std::vector<MeshPose>()) {
+        // Fill the staging buffer not in use by the writer thread
+        Frame& buffer = m_buffers[m_fill];
+        buffer.filename = filename + ".chgf";
+        buffer.index = m_num_frames++;
+        buffer.time = time;
+        buffer.mesh_poses = mesh_poses;
+        long long n = (long long)gpu_sys.GetNumParticles();
+        buffer.count = (uint64_t)n;
+        buffer.position.resize((m_columns & GPU_FRAME_POSITION) ? 3 * n : 0);
+        buffer.velocity.resize((m_columns & GPU_FRAME_VELOCITY) ? 3 * n : 0);
+        buffer.ang_velocity.resize((m_columns & GPU_FRAME_ANG_VELOCITY) ? 3 * n : 0);
+        buffer.fixity.resize((m_columns & GPU_FRAME_FIXITY) ? n : 0);
+
+        auto store = [](std::vector<float>& column, long long i, const chrono::ChVector<float>& v) {
+            column[3 * i + 0] = v.x();
+            column[3 * i + 1] = v.y();
+            column[3 * i + 2] = v.z();
+        };
+#pragma omp parallel for schedule(static, 4096)
+        for (long long i = 0; i < n; i++) {
+            if (m_columns & GPU_FRAME_POSITION)
+                store(buffer.position, i, gpu_sys.GetParticlePosition((int)i));
+            if (m_columns & GPU_FRAME_VELOCITY)
+                store(buffer.velocity, i, gpu_sys.GetParticleVelocity((int)i));
+            if (m_columns & GPU_FRAME_ANG_VELOCITY)
+                store(buffer.ang_velocity, i, gpu_sys.GetParticleAngVelocity((int)i));
+            if (m_columns & GPU_FRAME_FIXITY)
+                buffer.fixity[i] = gpu_sys.IsFixed((int)i) ? 1 : 0;
+        }
+
+        // Hand the buffer over to the writer thread (once it finished the previous frame)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return !m_pending; });
+            m_write = m_fill;
+            m_pending = true;
+        }
+        m_cv.notify_all();
+        m_fill = 1 - m_fill;
+    }
+
+    /// Wait until the queued frame is written. Return false if writing any of the frames so far failed.
+    bool Flush() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]() { return !m_pending; });
+        return m_ok;
+    }
+
+    /// Return false if writing any of the frames so far failed.
+    bool IsOK() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_ok;
+    }
+
+  private:
+    struct Frame {
+        std::string filename;
+        int index;
+        double time;
+        uint64_t count;
+        std::vector<float> position;
+        std::vector<float> velocity;
+        std::vector<float> ang_velocity;
+        std::vector<uint8_t> fixity;
+        std::vector<MeshPose> mesh_poses;
+    };
+
+    void Loop() {
+        while (true) {
+            int write;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]() { return m_pending || m_exit; });
+                if (!m_pending)
+                    return;
+                write = m_write;
+            }
+            bool ok = Write(m_buffers[write]);
+            if (m_mesh_stream && !m_buffers[write].mesh_poses.empty())
+                ok = m_mesh_stream->WriteFrame(m_buffers[write].index, m_buffers[write].time,
+                                               m_buffers[write].mesh_poses) &&
+                     ok;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_ok = m_ok && ok;
+                m_pending = false;
+            }
+            m_cv.notify_all();
+        }
+    }
+
+    bool Write(const Frame& buffer) const {
+        FILE* file = fopen(buffer.filename.c_str(), "wb");
+        if (!file)
+            return false;
+        uint32_t version = 1;
+        fwrite("CHGF", 1, 4, file);
+        fwrite(&version, sizeof(version), 1, file);
+        fwrite(&m_columns, sizeof(m_columns), 1, file);
+        fwrite(&buffer.count, sizeof(buffer.count), 1, file);
+        fwrite(&buffer.time, sizeof(buffer.time), 1, file);
+        fwrite(buffer.position.data(), sizeof(float), buffer.position.size(), file);
+        fwrite(buffer.velocity.data(), sizeof(float), buffer.velocity.size(), file);
+        fwrite(buffer.ang_velocity.data(), sizeof(float), buffer.ang_velocity.size(), file);
+        fwrite(buffer.fixity.data(), sizeof(uint8_t), buffer.fixity.size(), file);
+        bool ok = !ferror(file);
+        fclose(file);
+        return ok;
+    }
+
+    uint32_t m_columns;
+    GpuMeshStream* m_mesh_stream;
+    int m_num_frames;
+    Frame m_buffers[2];
+    int m_fill;
+    int m_write;
+    bool m_pending;
+    bool m_exit;
+    bool m_ok;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+};
+
+// Full particle state, as stored in a frame with all columns
+struct GpuParticleState {
+    double time;
+    std::vector<chrono::ChVector<float>> position;
+    std::vector<chrono::ChVector<float>> velocity;
+    std::vector<chrono::ChVector<float>> ang_velocity;
+    std::vector<bool> fixity;
+};
+
+// write the full particle state of the granular system to <filename>.chgf
+template <typename GpuSystem>
+bool writeStateCheckpoint(const GpuSystem& gpu_sys, const std::string& filename, double time) {
+    GpuFrameWriter<GpuSystem> writer(GPU_FRAME_ALL);
+    writer.WriteFrame(gpu_sys, filename, time);
+    return writer.Flush();
+}
+
+// load the full particle state from a frame file. Return false if the file is not a frame with all columns.
+inline bool loadStateCheckpoint(const std::string& infile, GpuParticleState& state) {
+    MappedCheckpointFile file(infile);
+    const char* data = file.data();
+    size_t size = file.size();
+    const size_t header_size = 4 + 4 + 4 + 8 + 8;
+    if (!data || size < header_size || memcmp(data, "CHGF", 4) != 0)
+        return false;
+    uint32_t version, columns;
+    uint64_t count;
+    memcpy(&version, data + 4, 4);
+    memcpy(&columns, data + 8, 4);
+    memcpy(&count, data + 12, 8);
+    memcpy(&state.time, data + 20, 8);
+    if (version != 1 || (columns & GPU_FRAME_ALL) != GPU_FRAME_ALL || size < header_size + count * (3 * 3 * 4 + 1))
+        return false;
+
+    state.position.resize((size_t)count);
+    state.velocity.resize((size_t)count);
+    state.ang_velocity.resize((size_t)count);
+    state.fixity.resize((size_t)count);
+    const char* pos = data + header_size;
+    const char* vel = pos + count * 3 * 4;
+    const char* ang_vel = vel + count * 3 * 4;
+    const char* fixity = ang_vel + count * 3 * 4;
+    long long n = (long long)count;
+    auto load = [](const char* column, long long i) {
+        float v[3];
+        memcpy(v, column + 3 * 4 * i, 3 * 4);
+        return chrono::ChVector<float>(v[0], v[1], v[2]);
+    };
+#pragma omp parallel for schedule(static)
+    for (long long i = 0; i < n; i++) {
+        state.position[i] = load(pos, i);
+        state.velocity[i] = load(vel, i);
+        state.ang_velocity[i] = load(ang_vel, i);
+    }
+    // (std::vector<bool> elements cannot be written concurrently)
+    for (long long i = 0; i < n; i++)
+        state.fixity[i] = fixity[i] != 0;
+    return true;
+}
+
+// set the particles of the granular system (before Initialize) from a full particle state
+template <typename GpuSystem>
+void setParticleState(GpuSystem& gpu_sys, const GpuParticleState& state) {
+    gpu_sys.SetParticleFixed(state.fixity);
+    gpu_sys.SetParticles(state.position, state.velocity, state.ang_velocity);
+}
+
+// -----------------------------------------------------------------------------
+// Parallel samplers for large initial beds. The samplers compute the number of
+// points up front and fill the (preallocated) output in place, in parallel;
+// random numbers come from a counter-based generator keyed by the point or
+// cell index, so the result does not depend on the number of threads.
+//   - sampleGridBox / sampleHCPBox: cubic / hexagonal close packed lattice
+//     with the given spacing and an optional uniform jitter of each coordinate
+//     (a jitter up to (spacing - diameter) / 2 keeps the spheres apart);
+//   - samplePoissonDiskBox: points at least min_dist apart, by dart throwing
+//     on a background grid of cells of size min_dist / sqrt(3) (at most one
+//     point per cell). Each round visits the cells in 27 phases of cells three
+//     apart, which never conflict, so that all cells of a phase are processed
+//     in parallel.
+// -----------------------------------------------------------------------------
+
+// uniform random number in [0, 1) for the given key (splitmix64 hash)
+inline double sampleUniform(uint64_t key) {
+    uint64_t z = key + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z = z ^ (z >> 31);
+    return (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// lattice with nx x ny x nz points; position(ix, iy, iz) gives the unjittered lattice points
+template <typename T, typename Position>
+std::vector<chrono::ChVector<T>> sampleLattice(int nx, int ny, int nz, T jitter, uint64_t seed, Position position) {
+    long long n = (long long)nx * ny * nz;
+    std::vector<chrono::ChVector<T>> points((size_t)std::max(n, 0LL));
+#pragma omp parallel for schedule(static)
+    for (long long i = 0; i < n; i++) {
+        int ix = (int)(i % nx);
+        int iy = (int)((i / nx) % ny);
+        int iz = (int)(i / ((long long)nx * ny));
+        chrono::ChVector<T> p = position(ix, iy, iz);
+        if (jitter > 0) {
+            uint64_t key = seed ^ (3 * (uint64_t)i * 0xD6E8FEB86659FD93ull);
+            p += jitter * chrono::ChVector<T>((T)(2 * sampleUniform(key) - 1), (T)(2 * sampleUniform(key + 1) - 1),
+                                              (T)(2 * sampleUniform(key + 2) - 1));
+        }
+        points[i] = p;
+    }
+    return points;
+}
+
+// cubic lattice in the box [center - hdims, center + hdims]
+template <typename T>
+std::vector<chrono::ChVector<T>> sampleGridBox(const chrono::ChVector<T>& center,
+                                               const chrono::ChVector<T>& hdims,
+                                               T spacing,
+                                               T jitter = 0,
+                                               uint64_t seed = 0) {
+    int nx = (int)(2 * hdims.x() / spacing) + 1;
+    int ny = (int)(2 * hdims.y() / spacing) + 1;
+    int nz = (int)(2 * hdims.z() / spacing) + 1;
+    chrono::ChVector<T> corner = center - hdims;
+    return sampleLattice<T>(nx, ny, nz, jitter, seed, [=](int ix, int iy, int iz) {
+        return corner + spacing * chrono::ChVector<T>((T)ix, (T)iy, (T)iz);
+    });
+}
+
+// hexagonal close packed lattice (ABAB layers along Z) in the box [center - hdims, center + hdims]
+template <typename T>
+std::vector<chrono::ChVector<T>> sampleHCPBox(const chrono::ChVector<T>& center,
+                                              const chrono::ChVector<T>& hdims,
+                                              T spacing,
+                                              T jitter = 0,
+                                              uint64_t seed = 0) {
+    T dy = spacing * (T)std::sqrt(3.0) / 2;
+    T dz = spacing * (T)std::sqrt(2.0 / 3.0);
+    int nx = (int)((2 * hdims.x() - spacing / 2) / spacing) + 1;
+    int ny = (int)((2 * hdims.y() - dy / 3) / dy) + 1;
+    int nz = (int)(2 * hdims.z() / dz) + 1;
+    chrono::ChVector<T> corner = center - hdims;
+    return sampleLattice<T>(std::max(nx, 1), std::max(ny, 1), nz, jitter, seed, [=](int ix, int iy, int iz) {
+        T x = spacing * (ix + (T)(((iy + iz) % 2) / 2.0));
+        T y = dy * iy + (iz % 2) * dy / 3;
+        return corner + chrono::ChVector<T>(x, y, dz * iz);
+    });
+}
+
+// Poisson disk sampling of the box [center - hdims, center + hdims] with the given minimum distance
+template <typename T>
+std::vector<chrono::ChVector<T>> samplePoissonDiskBox(const chrono::ChVector<T>& center,
+                                                      const chrono::ChVector<T>& hdims,
+                                                      T min_dist,
+                                                      int num_rounds = 20,
+                                                      uint64_t seed = 0) {
+    double cell = min_dist / std::sqrt(3.0);
+    int n[3];
+    for (int k = 0; k < 3; k++)
+        n[k] = std::max(1, (int)std::ceil(2 * hdims[k] / cell));
+    long long num_cells = (long long)n[0] * n[1] * n[2];
+    chrono::ChVector<T> corner = center - hdims;
+
+    // One (optional) point per cell
+    std::vector<chrono::ChVector<T>> cell_point((size_t)num_cells);
+    std::vector<char> occupied((size_t)num_cells, 0);
+    auto index = [&](int ix, int iy, int iz) { return ((long long)iz * n[1] + iy) * n[0] + ix; };
+    double min_dist2 = (double)min_dist * min_dist;
+
+    for (int round = 0; round < num_rounds; round++) {
+        for (int phase = 0; phase < 27; phase++) {
+            int px = phase % 3, py = (phase / 3) % 3, pz = phase / 9;
+            int mx = (n[0] - px + 2) / 3, my = (n[1] - py + 2) / 3, mz = (n[2] - pz + 2) / 3;
+            long long m = (long long)mx * my * mz;
+#pragma omp parallel for schedule(static)
+            for (long long j = 0; j < m; j++) {
+                int ix = px + 3 * (int)(j % mx);
+                int iy = py + 3 * (int)((j / mx) % my);
+                int iz = pz + 3 * (int)(j / ((long long)mx * my));
+                long long c = index(ix, iy, iz);
+                if (occupied[c])
+                    continue;
+
+                // Candidate uniformly distributed in the part of the cell inside the box
+                uint64_t key = seed ^ ((3 * ((uint64_t)c * num_rounds + round)) * 0xD6E8FEB86659FD93ull);
+                int ic[3] = {ix, iy, iz};
+                double p[3];
+                for (int k = 0; k < 3; k++) {
+                    double lo = ic[k] * cell;
+                    double hi = std::min((ic[k] + 1) * cell, 2.0 * hdims[k]);
+                    p[k] = corner[k] + lo + (hi - lo) * sampleUniform(key + k);
+                }
+
+                // Reject the candidate if it is too close to a point in the neighboring cells
+                bool accept = true;
+                for (int kz = std::max(iz - 2, 0); accept && kz <= std::min(iz + 2, n[2] - 1); kz++) {
+                    for (int ky = std::max(iy - 2, 0); accept && ky <= std::min(iy + 2, n[1] - 1); ky++) {
+                        for (int kx = std::max(ix - 2, 0); accept && kx <= std::min(ix + 2, n[0] - 1); kx++) {
+                            long long c2 = index(kx, ky, kz);
+                            if (!occupied[c2])
+                                continue;
+                            const chrono::ChVector<T>& q = cell_point[c2];
+                            double dx = p[0] - q.x(), dy = p[1] - q.y(), dz = p[2] - q.z();
+                            accept = dx * dx + dy * dy + dz * dz >= min_dist2;
+                        }
+                    }
+                }
+                if (accept) {
+                    cell_point[c] = chrono::ChVector<T>((T)p[0], (T)p[1], (T)p[2]);
+                    occupied[c] = 1;
+                }
+            }
+        }
+    }
+
+    // Compact the occupied cells, in cell order
+    int num_chunks = 1;
+#ifdef _OPENMP
+    num_chunks = 4 * omp_get_max_threads();
+#endif
+    long long chunk_size = num_cells / num_chunks + 1;
+    std::vector<size_t> counts(num_chunks + 1, 0);
+#pragma omp parallel for schedule(static)
+    for (int k = 0; k < num_chunks; k++) {
+        size_t count = 0;
+        for (long long c = k * chunk_size; c < std::min((k + 1) * chunk_size, num_cells); c++)
+            count += occupied[c];
+        counts[k + 1] = count;
+    }
+    for (int k = 0; k < num_chunks; k++)
+        counts[k + 1] += counts[k];
+    std::vector<chrono::ChVector<T>> points(counts[num_chunks]);
+#pragma omp parallel for schedule(static)
+    for (int k = 0; k < num_chunks; k++) {
+        size_t i = counts[k];
+        for (long long c = k * chunk_size; c < std::min((k + 1) * chunk_size, num_cells); c++) {
+            if (occupied[c])
+                points[i++] = cell_point[c];
+        }
+    }
+    return points;
+}
+
+// -----------------------------------------------------------------------------
+// Timing of the granular steps of small systems, for which the step time is
+// dominated by the fixed per-step cost (kernel launches and synchronization)
+// rather than by the number of particles: reports the wall-clock time per
+// step and per particle-step.
+//
+// This is measurement only; it does not reduce the per-step cost. Capturing
+// the step into a CUDA graph and replaying it would have to be done inside
+// Chrono::Gpu, which launches the kernels itself and synchronizes with the
+// host between substeps (not allowed during stream capture). These timings are
+// the baseline against which such a library change can be checked.
+// -----------------------------------------------------------------------------
+
+class GpuStepStats {
+  public:
+    GpuStepStats(float step_size) : m_step_size(step_size), m_num_steps(0), m_time(0) {}
+
+    /// Advance the granular system by the given duration, timing the call. Return the result of AdvanceSimulation.
+    template <typename GpuSystem>
+    auto Advance(GpuSystem& gpu_sys, float duration) -> decltype(gpu_sys.AdvanceSimulation(duration)) {
+        auto start = std::chrono::steady_clock::now();
+        auto result = gpu_sys.AdvanceSimulation(duration);
+        m_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        m_num_steps += (long long)std::ceil(duration / m_step_size - 1e-3);
+        return result;
+    }
+
+    /// Print the step statistics for a system with the given number of particles.
+    void Print(std::ostream& os, size_t num_particles) const {
+        if (m_num_steps == 0)
+            return;
+        double step_time = m_time / m_num_steps;
+        os << "Granular steps: " << m_num_steps << " in " << m_time << " s (" << 1e6 * step_time << " us per step, "
+           << 1e9 * step_time / std::max(num_particles, (size_t)1) << " ns per particle-step)" << std::endl;
+    }
+
+  private:
+    float m_step_size;
+    long long m_num_steps;
+    double m_time;
+};
+
+// -----------------------------------------------------------------------------
+// Profiling of the phases of a co-simulation loop (granular advance, mesh
+// exchange, output, ...) and of occupancy-relevant particle counts.
+//
+// GpuProfiler::Range times a scoped phase on the host (AdvanceSimulation is
+// synchronous, so its host time includes all its kernels) and, when compiled
+// with GPU_PROJECTS_NVTX (CMake option of the GPU projects), also opens an NVTX
+// range with the phase name, so that the phases show up in Nsight Systems over
+// the library's kernels. The per-kernel breakdown of AdvanceSimulation itself
+// is available from Nsight within these ranges.
+//
+// SampleCounts computes, from the particle positions, the number of spheres
+// per cubic bin of given size (use the subdomain size reported by the library
+// in verbose mode to estimate the spheres per SD) and the number of contacts
+// (pairs closer than a diameter) per sphere.
+//
+// The phase timings and all count samples can be printed or written as JSON.
+// -----------------------------------------------------------------------------
+
+class GpuProfiler {
+  public:
+    /// Scoped timer of a named phase. A range with a null profiler does nothing.
+    class Range {
+      public:
+        Range(GpuProfiler* profiler, const char* name) : m_profiler(profiler) {
+            if (!m_profiler)
+                return;
+            m_phase = m_profiler->GetPhase(name);
+#ifdef GPU_PROJECTS_NVTX
+            nvtxRangePushA(name);
+#endif
+            m_start = std::chrono::steady_clock::now();
+        }
+
+        ~Range() {
+            if (!m_profiler)
+                return;
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+#ifdef GPU_PROJECTS_NVTX
+            nvtxRangePop();
+#endif
+            m_profiler->AddTime(m_phase, time);
+        }
+
+      private:
+        GpuProfiler* m_profiler;
+        int m_phase;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    /// Sample the spheres per bin and the contacts per sphere of a system with the given sphere radius.
+    template <typename GpuSystem>
+    void SampleCounts(const GpuSystem& gpu_sys, float sphere_radius, float bin_size, double time) {
+        int num_particles = (int)gpu_sys.GetNumParticles();
+        std::vector<chrono::ChVector<float>> pos(num_particles);
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_particles; i++)
+            pos[i] = gpu_sys.GetParticlePosition(i);
+
+        CountSample sample;
+        sample.time = time;
+        sample.num_particles = num_particles;
+
+        // Spheres per bin (occupied bins only)
+        std::vector<uint64_t> bins(num_particles);
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_particles; i++)
+            bins[i] = CellKey(pos[i], bin_size, 0, 0, 0);
+        std::sort(bins.begin(), bins.end());
+        for (int i = 0; i < num_particles;) {
+            int j = i;
+            while (j < num_particles && bins[j] == bins[i])
+                j++;
+            sample.num_bins++;
+            sample.max_per_bin = std::max(sample.max_per_bin, j - i);
+            i = j;
+        }
+        sample.mean_per_bin = sample.num_bins > 0 ? (double)num_particles / sample.num_bins : 0;
+
+        // Contacts per sphere, over a grid of cells of one diameter
+        float diam = 2 * sphere_radius;
+        std::vector<std::pair<uint64_t, int>> cells(num_particles);
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_particles; i++)
+            cells[i] = std::make_pair(CellKey(pos[i], diam, 0, 0, 0), i);
+        std::sort(cells.begin(), cells.end());
+        long long num_contacts = 0;
+        int max_contacts = 0;
+        int num_free = 0;
+#pragma omp parallel for schedule(static, 1024) reduction(+ : num_contacts, num_free) reduction(max : max_contacts)
+        for (int i = 0; i < num_particles; i++) {
+            int count = 0;
+            for (int dx = -1; dx <= 1; dx++) {
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dz = -1; dz <= 1; dz++) {
+                        auto key = std::make_pair(CellKey(pos[i], diam, dx, dy, dz), 0);
+                        for (auto it = std::lower_bound(cells.begin(), cells.end(), key);
+                             it != cells.end() && it->first == key.first; ++it) {
+                            chrono::ChVector<float> d = pos[it->second] - pos[i];
+                            if (it->second != i && d.x() * d.x() + d.y() * d.y() + d.z() * d.z() < diam * diam)
+                                count++;
+                        }
+                    }
+                }
+            }
+            num_contacts += count;
+            max_contacts = std::max(max_contacts, count);
+            if (count == 0)
+                num_free++;
+        }
+        sample.mean_contacts = num_particles > 0 ? (double)num_contacts / num_particles : 0;
+        sample.max_contacts = max_contacts;
+        sample.num_free = num_free;
+
+        m_samples.push_back(sample);
+    }
+
+    /// Return the total time (s) and number of calls of the named phase (0 if not recorded).
+    double GetTime(const std::string& name) const {
+        for (const auto& phase : m_phases) {
+            if (phase.name == name)
+                return phase.time;
+        }
+        return 0;
+    }
+    int GetNumCalls(const std::string& name) const {
+        for (const auto& phase : m_phases) {
+            if (phase.name == name)
+                return phase.calls;
+        }
+        return 0;
+    }
+
+    /// Print the phase timings and the last count sample.
+    void Print(std::ostream& os) const {
+        double total = 0;
+        for (const auto& phase : m_phases)
+            total += phase.time;
+        for (const auto& phase : m_phases) {
+            os << "  " << phase.name << ": " << phase.time << " s (" << phase.calls << " calls, "
+               << (total > 0 ? 100 * phase.time / total : 0) << "%, max " << 1e3 * phase.max_time << " ms)"
+               << std::endl;
+        }
+        if (!m_samples.empty()) {
+            const auto& sample = m_samples.back();
+            os << "  spheres per bin: " << sample.mean_per_bin << " (max " << sample.max_per_bin << ", "
+               << sample.num_bins << " bins), contacts per sphere: " << sample.mean_contacts << " (max "
+               << sample.max_contacts << ", " << sample.num_free << " free)" << std::endl;
+        }
+    }
+
+    /// Write the phase timings and all count samples as JSON.
+    bool WriteJSON(const std::string& filename) const {
+        std::ofstream file(filename);
+        if (!file.good())
+            return false;
+        file << "{\n  \"phases\": [";
+        for (size_t i = 0; i < m_phases.size(); i++) {
+            const auto& phase = m_phases[i];
+            file << (i > 0 ? "," : "") << "\n    {\"name\": \"" << phase.name << "\", \"time\": " << phase.time
+                 << ", \"calls\": " << phase.calls << ", \"max_time\": " << phase.max_time << "}";
+        }
+        file << "\n  ],\n  \"counts\": [";
+        for (size_t i = 0; i < m_samples.size(); i++) {
+            const auto& sample = m_samples[i];
+            file << (i > 0 ? "," : "") << "\n    {\"time\": " << sample.time
+                 << ", \"num_particles\": " << sample.num_particles << ", \"num_bins\": " << sample.num_bins
+                 << ", \"mean_per_bin\": " << sample.mean_per_bin << ", \"max_per_bin\": " << sample.max_per_bin
+                 << ", \"mean_contacts\": " << sample.mean_contacts << ", \"max_contacts\": " << sample.max_contacts
+                 << ", \"num_free\": " << sample.num_free << "}";
+        }
+        file << "\n  ]\n}\n";
+        return file.good();
+    }
+
+  private:
+    struct Phase {
+        std::string name;
+        double time;
+        double max_time;
+        int calls;
+    };
+
+    struct CountSample {
+        double time = 0;
+        int num_particles = 0;
+        int num_bins = 0;
+        double mean_per_bin = 0;
+        int max_per_bin = 0;
+        double mean_contacts = 0;
+        int max_contacts = 0;
+        int num_free = 0;
+    };
+
+    int GetPhase(const char* name) {
+        for (size_t i = 0; i < m_phases.size(); i++) {
+            if (m_phases[i].name == name)
+                return (int)i;
+        }
+        m_phases.push_back({name, 0, 0, 0});
+        return (int)m_phases.size() - 1;
+    }
+
+    void AddTime(int phase, double time) {
+        m_phases[phase].time += time;
+        m_phases[phase].max_time = std::max(m_phases[phase].max_time, time);
+        m_phases[phase].calls++;
+    }
+
+    // Key of the cell (offset by the given number of cells) containing a point, 21 bits per direction.
+    static uint64_t CellKey(const chrono::ChVector<float>& p, float cell_size, int dx, int dy, int dz) {
+        uint64_t ix = (uint64_t)((int64_t)std::floor(p.x() / cell_size) + dx + (1 << 20)) & 0x1FFFFF;
+        uint64_t iy = (uint64_t)((int64_t)std::floor(p.y() / cell_size) + dy + (1 << 20)) & 0x1FFFFF;
+        uint64_t iz = (uint64_t)((int64_t)std::floor(p.z() / cell_size) + dz + (1 << 20)) & 0x1FFFFF;
+        return (ix << 42) | (iy << 21) | iz;
+    }
+
+    std::vector<Phase> m_phases;
+    std::vector<CountSample> m_samples;
+};
+
+// -----------------------------------------------------------------------------
+// Detection of the steady state of a granular system, to end a run once the
+// material stopped moving.
+//
+// Sample computes the kinetic energy of the spheres and the mass flux into a
+// region (rate of change of the mass of the spheres in the region, e.g. the
+// outflow of a container); the state is steady once, over a window of the
+// given duration, the kinetic energy stayed below ke_tol times its peak value
+// (since the last Reset) and the mass in the region changed by less than
+// mass_tol times the total mass. The time to equilibrium is measured from the
+// last Reset to the end of the first steady window.
+// -----------------------------------------------------------------------------
+
+class GpuSteadyStateDetector {
+  public:
+    /// Sphere mass, window duration, and relative tolerances on the kinetic energy and on the region mass.
+    GpuSteadyStateDetector(double sphere_mass, double window, double ke_tol = 1e-3, double mass_tol = 1e-3)
+        : m_sphere_mass(sphere_mass), m_window(window), m_ke_tol(ke_tol), m_mass_tol(mass_tol) {
+        Reset(0);
+    }
+
+    /// Set the region of the mass flux, as an indicator function of the sphere position (default: none).
+    void SetFluxRegion(std::function<bool(const chrono::ChVector<float>&)> region) { m_region = region; }
+
+    /// Restart the detection at the given time (e.g. at the start of the phase expected to equilibrate).
+    void Reset(double time) {
+        m_start_time = time;
+        m_steady_time = -1;
+        m_peak_ke = 0;
+        m_samples.clear();
+    }
+
+    /// Sample the state of the granular system at the given time. Return true if the state is steady.
+    template <typename GpuSystem>
+    bool Sample(const GpuSystem& gpu_sys, double time) {
+        int num_particles = (int)gpu_sys.GetNumParticles();
+        double v2 = 0;
+        long long in_region = 0;
+#pragma omp parallel for schedule(static) reduction(+ : v2, in_region)
+        for (int i = 0; i < num_particles; i++) {
+            v2 += gpu_sys.GetParticleVelocity(i).Length2();
+            if (m_region && m_region(gpu_sys.GetParticlePosition(i)))
+                in_region++;
+        }
+
+        Record s = {time, 0.5 * m_sphere_mass * v2, m_sphere_mass * in_region};
+        m_total_mass = m_sphere_mass * num_particles;
+        m_flux = m_samples.empty() || time <= m_samples.back().time
+                     ? 0
+                     : (s.region_mass - m_samples.back().region_mass) / (time - m_samples.back().time);
+        m_peak_ke = std::max(m_peak_ke, s.ke);
+        m_samples.push_back(s);
+        while (m_samples.size() > 2 && m_samples[1].time <= time - m_window)
+            m_samples.pop_front();
+
+        if (m_steady_time < 0 && time - m_samples.front().time >= m_window && IsWindowSteady())
+            m_steady_time = time;
+        return IsSteady();
+    }
+
+    /// Return true if a steady window was detected since the last Reset.
+    bool IsSteady() const { return m_steady_time >= 0; }
+
+    /// Return the time to equilibrium (since the last Reset), or -1 if not steady.
+    double GetTimeToEquilibrium() const { return IsSteady() ? m_steady_time - m_start_time : -1; }
+
+    /// Return the kinetic energy at the last sample.
+    double GetKineticEnergy() const { return m_samples.empty() ? 0 : m_samples.back().ke; }
+
+    /// Return the mass flux into the region between the last two samples.
+    double GetMassFlux() const { return m_flux; }
+
+    /// Return the mass in the region at the last sample.
+    double GetRegionMass() const { return m_samples.empty() ? 0 : m_samples.back().region_mass; }
+
+  private:
+    struct Record {
+        double time;
+        double ke;
+        double region_mass;
+    };
+
+    bool IsWindowSteady() const {
+        double min_mass = m_samples.front().region_mass;
+        double max_mass = min_mass;
+        for (const auto& s : m_samples) {
+            if (s.ke > m_ke_tol * m_peak_ke)
+                return false;
+            min_mass = std::min(min_mass, s.region_mass);
+            max_mass = std::max(max_mass, s.region_mass);
+        }
+        return max_mass - min_mass <= m_mass_tol * m_total_mass;
+    }
+
+    double m_sphere_mass;
+    double m_window;
+    double m_ke_tol;
+    double m_mass_tol;
+    std::function<bool(const chrono::ChVector<float>&)> m_region;
+
+    double m_start_time;
+    double m_steady_time;
+    double m_peak_ke;
+    double m_total_mass = 0;
+    double m_flux = 0;
+    std::deque<Record> m_samples;
+};
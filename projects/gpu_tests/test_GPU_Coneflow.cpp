@@ -15,6 +15,7 @@
 // =============================================================================
 
 #include <iostream>
+#include <memory>
 #include <string>
 
 #include "chrono/core/ChGlobal.h"
@@ -26,12 +27,19 @@
 
 #include "chrono_thirdparty/filesystem/path.h"
 
+#include "GpuDemoUtils.h"
+
 using namespace chrono;
 using namespace chrono::gpu;
 
 // expected number of args for param sweep
 constexpr int num_args_full = 7;
 
+// Write the particle frames in the columnar binary format on a background thread (instead of WriteParticleFile),
+// with the selected columns only
+bool columnar_output = false;
+uint32_t output_columns = GPU_FRAME_POSITION | GPU_FRAME_VELOCITY;
+
 // -----------------------------------------------------------------------------
 // Show command line usage
 // -----------------------------------------------------------------------------
@@ -260,6 +268,10 @@ int main(int argc, char* argv[]) {
     int currcapture = 0;
     int currframe = 0;
 
+    std::unique_ptr<GpuFrameWriter<ChSystemGpu>> frame_writer;
+    if (columnar_output)
+        frame_writer = std::unique_ptr<GpuFrameWriter<ChSystemGpu>>(new GpuFrameWriter<ChSystemGpu>(output_columns));
+
     std::cout << "capture step is " << frame_step << std::endl;
 
     float t_remove_plane = .5;
@@ -297,7 +309,10 @@ int main(int argc, char* argv[]) {
         if (currcapture % captures_per_frame == 0) {
             printf("rendering frame %u\n", currframe);
             sprintf(filename, "%s/step%06d", params.output_dir.c_str(), currframe++);
-            gran_sys.WriteParticleFile(std::string(filename));
+            if (frame_writer)
+                frame_writer->WriteFrame(gran_sys, std::string(filename), curr_time);
+            else
+                gran_sys.WriteParticleFile(std::string(filename));
         }
         currcapture++;
     }
@@ -16,6 +16,7 @@
 // =============================================================================
 
 #include <iostream>
+#include <memory>
 #include <string>
 
 #include "chrono/core/ChGlobal.h"
@@ -27,6 +28,8 @@
 
 #include "chrono_thirdparty/filesystem/path.h"
 
+#include "GpuDemoUtils.h"
+
 using namespace chrono;
 using namespace chrono::gpu;
 
@@ -35,6 +38,15 @@ enum run_mode { FRICTIONLESS_NOCYL = 0, FRICTIONLESS_WITHCYL = 1, MULTI_STEP_NOC
 // whether or not to have a cylinder blocking the flow. Set by run_mode.
 bool use_cylinder = false;
 
+// Write the particle frames in the columnar binary format on a background thread (instead of WriteParticleFile),
+// with the selected columns only
+bool columnar_output = false;
+uint32_t output_columns = GPU_FRAME_POSITION | GPU_FRAME_VELOCITY;
+
+// Generate the initial bed with the parallel samplers of GpuDemoUtils.h instead of the Chrono samplers (different
+// particle spacing, so the bed differs from the reference runs)
+bool parallel_sampling = false;
+
 // expected number of args for param sweep
 constexpr int num_args_full = 7;
 
@@ -201,7 +213,8 @@ int main(int argc, char* argv[]) {
 
     // Fill box with bodies
     std::vector<ChVector<float>> body_points =
-        utils::PDLayerSampler_BOX<float>(center, hdims, 2. * params.sphere_radius, 1.02);
+        parallel_sampling ? samplePoissonDiskBox<float>(center, hdims, 1.02f * 2 * params.sphere_radius)
+                          : utils::PDLayerSampler_BOX<float>(center, hdims, 2. * params.sphere_radius, 1.02);
 
     std::vector<ChVector<float>> first_points;
 
@@ -237,6 +250,10 @@ int main(int argc, char* argv[]) {
     float curr_time = 0;
     int currframe = 0;
 
+    std::unique_ptr<GpuFrameWriter<ChSystemGpu>> frame_writer;
+    if (columnar_output)
+        frame_writer = std::unique_ptr<GpuFrameWriter<ChSystemGpu>>(new GpuFrameWriter<ChSystemGpu>(output_columns));
+
     std::cout << "frame step is " << frame_step << std::endl;
     bool plane_active = true;
     ChVector<float> reaction_forces(0, 0, 0);
@@ -295,7 +312,10 @@ int main(int argc, char* argv[]) {
         printf("rendering frame %u\n", currframe);
         char filename[100];
         sprintf(filename, "%s/step%06d", params.output_dir.c_str(), currframe++);
-        gran_sys.WriteParticleFile(std::string(filename));
+        if (frame_writer)
+            frame_writer->WriteFrame(gran_sys, std::string(filename), curr_time);
+        else
+            gran_sys.WriteParticleFile(std::string(filename));
     }
 
     return 0;
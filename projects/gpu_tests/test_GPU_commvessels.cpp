@@ -14,8 +14,12 @@
 // Chrono::Granular simulation in which a cylinder is filled with granular
 // material and then raised slightly, allowing material to flow out and around
 // the cylinder for comparison with the analytical hydrostatic result.
+// The run ends once the material equilibrates after the raise (steady kinetic
+// energy and outflow), reporting the time to equilibrium and the levels inside
+// and outside the cylinder (equal in the hydrostatic result).
 // =============================================================================
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <string>
@@ -30,12 +34,20 @@
 
 #include "chrono_thirdparty/filesystem/path.h"
 
+#include "GpuDemoUtils.h"
+
 using namespace chrono;
 using namespace chrono::gpu;
 
 // expected number of args for param sweep
 constexpr int num_args_full = 5;
 
+// End the sitting phase once the material is at rest
+const bool stop_at_steady_state = true;
+const double steady_window = 0.5;     // duration of the steady window
+const double steady_ke_tol = 1e-3;    // kinetic energy, relative to its peak after the raise
+const double steady_mass_tol = 1e-3;  // change of the mass outside the cylinder, relative to the total mass
+
 void ShowUsage(std::string name) {
     std::cout << "usage: " + name + " <json_file> <output_dir> <radius> <density>" << std::endl;
     std::cout << "must have either 1 or " << num_args_full - 1 << " arguments" << std::endl;
@@ -70,6 +82,22 @@ void writeMeshFrames(std::ostringstream& outstream,
     outstream << "\n";
 }
 
+// Level of the free surface of the spheres in a region (95th percentile of the heights), -1 if the region is empty
+template <typename Region>
+float freeSurfaceLevel(const ChSystemGpuMesh& gran_sys, Region region) {
+    std::vector<float> z;
+    for (int i = 0; i < (int)gran_sys.GetNumParticles(); i++) {
+        ChVector<float> pos = gran_sys.GetParticlePosition(i);
+        if (region(pos))
+            z.push_back(pos.z());
+    }
+    if (z.empty())
+        return -1;
+    auto nth = z.begin() + (size_t)(0.95 * (z.size() - 1));
+    std::nth_element(z.begin(), nth, z.end());
+    return *nth;
+}
+
 int main(int argc, char* argv[]) {
     gpu::SetDataPath(std::string(PROJECTS_DATA_DIR) + "gpu/");
 
@@ -183,6 +211,19 @@ int main(int argc, char* argv[]) {
     std::cout << "Time raising " << time_raising << std::endl;
     std::cout << "Time sitting " << time_sitting << std::endl;
 
+    // Steady state after the raise: kinetic energy and flow out of the cylinder
+    const double sphere_mass = 4.0 / 3.0 * CH_C_PI * std::pow(params.sphere_radius, 3) * params.sphere_density;
+    const float cyl_inner_radius = scaling.x();
+    const float cyl_outer_radius = 1.1f * scaling.x();
+    auto inside = [cyl_inner_radius](const ChVector<float>& pos) {
+        return pos.x() * pos.x() + pos.y() * pos.y() < cyl_inner_radius * cyl_inner_radius;
+    };
+    auto outside = [cyl_outer_radius](const ChVector<float>& pos) {
+        return pos.x() * pos.x() + pos.y() * pos.y() > cyl_outer_radius * cyl_outer_radius;
+    };
+    GpuSteadyStateDetector steady(sphere_mass, steady_window, steady_ke_tol, steady_mass_tol);
+    steady.SetFluxRegion(outside);
+
     double mesh_z = 0.0;
     double mesh_vz = raising_vel;
 
@@ -206,7 +247,8 @@ int main(int argc, char* argv[]) {
 //    ChVector<> pos_mesh(0, 0, mesh_z);
 
     std::cout << "Settling..." << std::endl;
-    for (float t = 0; t < time_settling + time_raising + time_sitting; t += iteration_step, step++) {
+    float t = 0;
+    for (; t < time_settling + time_raising + time_sitting; t += iteration_step, step++) {
         if (t >= time_settling && t <= time_settling + time_raising) {
             // Raising phase
             if (!settled) {
@@ -223,7 +265,9 @@ int main(int argc, char* argv[]) {
                 std::cout << "Raised." << std::endl;
                 raised = true;
                 mesh_lin_vel.z() = 0;
-            gran_sys.ApplyMeshMotion(0, mesh_pos, mesh_rot, mesh_lin_vel, mesh_ang_vel);            }
+                gran_sys.ApplyMeshMotion(0, mesh_pos, mesh_rot, mesh_lin_vel, mesh_ang_vel);
+                steady.Reset(t);
+            }
         }
 
         if (step % out_steps == 0) {
@@ -242,10 +286,31 @@ int main(int argc, char* argv[]) {
 
             meshfile << outstream.str();
             meshfile.close();
+
+            if (raised && steady.Sample(gran_sys, t) && stop_at_steady_state) {
+                std::cout << "Steady state at t = " << t << std::endl;
+                break;
+            }
         }
 
         gran_sys.AdvanceSimulation(iteration_step);
     }
 
+    // Time to equilibrium and hydrostatic check
+    std::cout << "Time to equilibrium after the raise: ";
+    if (steady.IsSteady())
+        std::cout << steady.GetTimeToEquilibrium() << " (of " << time_sitting << " allowed)" << std::endl;
+    else
+        std::cout << "not reached in " << time_sitting << std::endl;
+    std::cout << "Simulated time: " << t << std::endl;
+    std::cout << "Mass outside the cylinder: " << steady.GetRegionMass() << " (flux " << steady.GetMassFlux()
+              << ")" << std::endl;
+
+    float level_in = freeSurfaceLevel(gran_sys, inside);
+    float level_out = freeSurfaceLevel(gran_sys, outside);
+    std::cout << "Level inside the cylinder: " << level_in << "   outside: " << level_out
+              << "   difference: " << (level_in - level_out) / (2 * params.sphere_radius) << " diameters"
+              << std::endl;
+
     return 0;
 }
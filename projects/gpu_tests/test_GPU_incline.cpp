@@ -165,14 +165,17 @@ int main(int argc, char* argv[]) {
     sprintf(filename, "%s/step%06d", params.output_dir.c_str(), currframe++);
     gran_sys.WriteParticleFile(std::string(filename));
 
+    GpuStepStats step_stats(params.step_size);
     std::cout << "frame step is " << frame_step << std::endl;
     while (curr_time < params.time_end) {
-        gran_sys.AdvanceSimulation(frame_step);
+        step_stats.Advance(gran_sys, frame_step);
         curr_time += frame_step;
         printf("rendering frame %u\n", currframe);
         sprintf(filename, "%s/step%06d", params.output_dir.c_str(), currframe++);
         gran_sys.WriteParticleFile(std::string(filename));
     }
 
+    step_stats.Print(std::cout, gran_sys.GetNumParticles());
+
     return 0;
 }
@@ -13,11 +13,25 @@
 // =============================================================================
 // Chrono::Granular simulation of up to one million spherical particles
 // settling in a box in order to measure run time.
+//
+// With a number of devices, the test instead runs the box cut into slabs along
+// X as independent settling runs: each slab is a separate system with its own
+// walls, driven by its own host thread on device (slab % num_devices). There
+// is no exchange between slabs, so this is not a domain decomposition of one
+// bed and the times are not a scaling measure; they only show the cost of
+// running several independent beds concurrently on the devices.
 // =============================================================================
 
+#include <algorithm>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
+
+#include <cuda_runtime_api.h>
 
 #include "chrono/core/ChTimer.h"
 #include "chrono/utils/ChUtilsSamplers.h"
@@ -25,6 +39,8 @@
 #include "chrono_gpu/physics/ChSystemGpu.h"
 #include "chrono_thirdparty/filesystem/path.h"
 
+#include "GpuDemoUtils.h"
+
 using namespace chrono;
 using namespace chrono::gpu;
 
@@ -47,10 +63,14 @@ CHGPU_OUTPUT_MODE write_mode = CHGPU_OUTPUT_MODE::BINARY;
 CHGPU_VERBOSITY verbose = CHGPU_VERBOSITY::INFO;
 float cohesion_ratio = 0;
 
+// Generate the initial bed with the parallel samplers of GpuDemoUtils.h instead of the Chrono samplers (different
+// particle spacing, so the bed differs from the reference runs)
+bool parallel_sampling = false;
+
 // -----------------------------------------------------------------------------
 // Run a wavetank for a monodisperse collection of spheres in a rectangular box, undergoing a wave motion
 // -----------------------------------------------------------------------------
-double run_test(float box_size_X, float box_size_Y, float box_size_Z) {
+double run_test(float box_size_X, float box_size_Y, float box_size_Z, bool write_output = true) {
     // Setup simulation
     ChSystemGpu gpu_system(ballRadius, ballDensity, ChVector<float>(box_size_X, box_size_Y, box_size_Z));
     gpu_system.SetKn_SPH2SPH(normStiffness_S2S);
@@ -61,13 +81,14 @@ double run_test(float box_size_X, float box_size_Y, float box_size_Z) {
     gpu_system.SetCohesionRatio(cohesion_ratio);
     gpu_system.SetAdhesionRatio_SPH2WALL(adhesion_ratio_s2w);
     gpu_system.SetGravitationalAcceleration(ChVector<>(0.f, 0.f, grav_acceleration));
-    gpu_system.SetParticleOutputMode(write_mode);
+    gpu_system.SetParticleOutputMode(write_output ? write_mode : CHGPU_OUTPUT_MODE::NONE);
 
     // Fill the bottom half with material
     chrono::utils::HCPSampler<float> sampler(2.4f * ballRadius);  // Add epsilon
     ChVector<float> center(0, 0, -0.25f * box_size_Z);
-    ChVector<float> hdims(box_size_X / 2 - ballRadius, box_size_X / 2 - ballRadius, box_size_Z / 4 - ballRadius);
-    std::vector<ChVector<float>> body_points = sampler.SampleBox(center, hdims);
+    ChVector<float> hdims(box_size_X / 2 - ballRadius, box_size_Y / 2 - ballRadius, box_size_Z / 4 - ballRadius);
+    std::vector<ChVector<float>> body_points =
+        parallel_sampling ? sampleHCPBox(center, hdims, 2.4f * ballRadius) : sampler.SampleBox(center, hdims);
     gpu_system.SetParticles(body_points);
 
     filesystem::create_directory(filesystem::path(output_prefix));
@@ -93,6 +114,8 @@ double run_test(float box_size_X, float box_size_Y, float box_size_Z) {
     while (curr_time < timeEnd) {
         gpu_system.AdvanceSimulation(frame_step);
         curr_time += frame_step;
+        if (!write_output)
+            continue;
         printf("rendering frame %u\n", currframe);
         char filename[100];
         sprintf(filename, "%s/step%06d", output_prefix.c_str(), currframe++);
@@ -102,9 +125,56 @@ double run_test(float box_size_X, float box_size_Y, float box_size_Z) {
     return timer.GetTimeSeconds();
 }
 
+// -----------------------------------------------------------------------------
+// Run independent settling tests for the slabs of a box cut along X, one system per slab on num_devices devices.
+// Return the wall-clock time of the slowest slab.
+// -----------------------------------------------------------------------------
+double run_slab_test(float box_size_X, float box_size_Y, float box_size_Z, int num_slabs, int num_devices) {
+    std::vector<double> slab_time(num_slabs, 0);
+    std::vector<std::thread> workers;
+    for (int slab = 0; slab < num_slabs; slab++) {
+        workers.emplace_back([=, &slab_time]() {
+            cudaSetDevice(slab % num_devices);
+            slab_time[slab] = run_test(box_size_X / num_slabs, box_size_Y, box_size_Z, false);
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+    return *std::max_element(slab_time.begin(), slab_time.end());
+}
+
+// Independent slab runs for a fixed box and for a box growing with the number of devices
+void run_independent_slabs(int num_devices, std::ostream& os) {
+    int available = 0;
+    cudaGetDeviceCount(&available);
+    if (available < num_devices) {
+        os << "Only " << available << " devices available" << std::endl;
+        num_devices = std::max(available, 1);
+    }
+
+    os << "Running independent multi-GPU slab runs (no exchange between slabs, not a scaling test)!" << std::endl;
+    os << "devices,fixed_box_time,growing_box_time" << std::endl;
+    for (int d = 1; d <= num_devices; d++) {
+        double fixed_box = run_slab_test(280, 280, 280, d, d);
+        double growing_box = run_slab_test(100.f * d, 100, 100, d, d);
+        os << d << "," << fixed_box << "," << growing_box << std::endl;
+    }
+}
+
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cout << "usage: " + std::string(argv[0]) + " <results_log_file>" << std::endl;
+    if (argc != 2 && argc != 3) {
+        std::cout << "usage: " + std::string(argv[0]) + " <results_log_file> [num_devices]" << std::endl;
+        return 1;
+    }
+
+    if (argc == 3) {
+        int num_devices = std::max(std::atoi(argv[2]), 1);
+        std::ostringstream results;
+        run_independent_slabs(num_devices, results);
+        std::cout << results.str();
+        std::ofstream ofile(argv[1], std::ofstream::app);
+        ofile << results.str();
+        return 0;
     }
 
     // up to one million bodies
@@ -142,9 +142,10 @@ int main(int argc, char* argv[]) {
     sprintf(filename, "%s/step%06d", params.output_dir.c_str(), currframe++);
     gpu_sys.WriteParticleFile(std::string(filename));
 
+    GpuStepStats step_stats(params.step_size);
     std::cout << "frame step is " << frame_step << std::endl;
     while (curr_time < params.time_end) {
-        float real_dt = gpu_sys.AdvanceSimulation(frame_step);
+        float real_dt = step_stats.Advance(gpu_sys, frame_step);
 
         curr_time += frame_step;
         printf("rendering frame %u\n", currframe);
@@ -152,5 +153,7 @@ int main(int argc, char* argv[]) {
         gpu_sys.WriteParticleFile(std::string(filename));
     }
 
+    step_stats.Print(std::cout, gpu_sys.GetNumParticles());
+
     return 0;
 }
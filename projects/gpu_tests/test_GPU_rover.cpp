@@ -16,6 +16,7 @@
 // =============================================================================
 
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -34,6 +35,8 @@
 #include "chrono_gpu/utils/ChGpuJsonParser.h"
 #include "chrono_thirdparty/filesystem/path.h"
 
+#include "GpuDemoUtils.h"
+
 using namespace chrono;
 using namespace chrono::gpu;
 
@@ -78,6 +81,19 @@ constexpr double wheel_inertia_z = wheel_inertia_x;
 
 unsigned int out_fps = 50;
 
+// Advance the rover system while the granular step runs on the GPU (the rover step of an interval uses the wheel
+// forces of the previous interval in both modes)
+bool async_advance = true;
+
+// Write the particle frames in the columnar binary format on a background thread (instead of WriteParticleFile),
+// with the selected columns only
+bool columnar_output = false;
+uint32_t output_columns = GPU_FRAME_POSITION | GPU_FRAME_VELOCITY;
+
+// Profile the phases of the co-simulation loop and sample the particle counts at each output frame (written to
+// profile.json in the output directory)
+bool profile = false;
+
 double terrain_height_offset = 0;
 
 enum RUN_MODE { SETTLING = 0, TESTING = 1 };
@@ -237,14 +253,25 @@ int main(int argc, char* argv[]) {
     ChVector<> hdims(params.box_X / 2 - 2.0, params.box_Y / 2 - 2.0, std::abs((fill_bottom - fill_top) / 2.) - 2.0);
     ChVector<> center(0, 0, (fill_bottom + fill_top) / 2.);
 
+    // Restart from the full state checkpoint of the settled bed if available (positions, velocities, angular
+    // velocities, and fixity), otherwise from the CSV positions
     std::vector<ChVector<float>> body_points;
+    GpuParticleState settled_state;
+    bool full_state = false;
     if (run_mode == RUN_MODE::SETTLING) {
         body_points = utils::PDLayerSampler_BOX<float>(center, hdims, 2.0f * params.sphere_radius, 1.01f);
     } else if (run_mode == RUN_MODE::TESTING) {
-        body_points = loadCheckpointFile(checkpoint_file_base + ".csv");
+        full_state = loadStateCheckpoint(checkpoint_file_base + ".chgf", settled_state);
+        if (full_state)
+            std::cout << "Restarting from full state checkpoint" << std::endl;
+        else
+            body_points = loadCheckpointFile(checkpoint_file_base + ".csv");
     }
 
-    gpu_sys.SetParticles(body_points);
+    if (full_state)
+        setParticleState(gpu_sys, settled_state);
+    else
+        gpu_sys.SetParticles(body_points);
 
     gpu_sys.SetBDFixed(true);
 
@@ -347,7 +374,35 @@ int main(int argc, char* argv[]) {
     printf("Chassis mass: %f g, each wheel mass: %f g\n", chassis_mass, wheel_mass);
     printf("Total Chassis Mars weight in CGS: %f\n", std::abs((chassis_mass + 4 * wheel_mass) * mars_grav_mag));
 
-    clock_t start = std::clock();
+    GpuAsyncAdvance<ChSystemGpuMesh> gpu_advance(gpu_sys);
+
+    // With columnar output, the wheel and chassis poses of all frames go to a single binary mesh stream (declared
+    // first, so that it outlives the writer thread)
+    std::unique_ptr<GpuMeshStream> mesh_stream;
+    std::vector<MeshPose> mesh_poses;
+    std::unique_ptr<GpuFrameWriter<ChSystemGpuMesh>> frame_writer;
+    if (columnar_output) {
+        frame_writer = std::unique_ptr<GpuFrameWriter<ChSystemGpuMesh>>(
+            new GpuFrameWriter<ChSystemGpuMesh>(output_columns));
+        mesh_stream = std::unique_ptr<GpuMeshStream>(new GpuMeshStream(params.output_dir + "/meshframes.chmf"));
+        ChVector<> wheel_size(wheel_rad * 2, wheel_width, wheel_rad * 2);
+        for (unsigned int i = 0; i < wheel_bodies.size(); i++)
+            mesh_stream->AddMesh(wheel_filename, wheel_size);
+        mesh_stream->AddMesh(chassis_filename, ChVector<>(METERS_TO_CM, METERS_TO_CM, METERS_TO_CM));
+        frame_writer->SetMeshStream(mesh_stream.get());
+    }
+
+    // Mesh exchange buffers (one mesh per wheel, in order)
+    std::vector<MeshMotion> wheel_motions;
+    std::vector<ChVector<>> wheel_forces;
+    std::vector<ChVector<>> wheel_torques;
+
+    std::unique_ptr<GpuProfiler> profiler;
+    if (profile)
+        profiler = std::unique_ptr<GpuProfiler>(new GpuProfiler());
+
+    ChTimer<double> timer;
+    timer.start();
     for (float t = 0; t < params.time_end; t += iteration_step, curr_step++) {
         if (chassis_fixed && t >= 0.5) {
             printf("Setting wheel free!\n");
@@ -358,49 +413,80 @@ int main(int argc, char* argv[]) {
             // put terrain just below bottom of wheels
             terrain_height_offset = max_terrain_z + height_offset_chassis_to_bottom;
         }
-        for (unsigned int i = 0; i < wheel_bodies.size(); i++) {
-            auto curr_body = wheel_bodies.at(i);
-
-            gpu_sys.ApplyMeshMotion(i, curr_body->GetPos(), curr_body->GetRot(), 
-                                    curr_body->GetPos_dt(), curr_body->GetWvel_par() );
+        {
+            GpuProfiler::Range range(profiler.get(), "apply mesh motion");
+            gatherMeshMotions(wheel_bodies, wheel_motions);
+            applyMeshMotions(gpu_sys, wheel_motions);
         }
 
-        gpu_sys.AdvanceSimulation(iteration_step);
-        rover_sys.DoStepDynamics(iteration_step);
+        if (async_advance) {
+            auto gpu_step = gpu_advance.AdvanceSimulationAsync((float)iteration_step);
+            {
+                GpuProfiler::Range range(profiler.get(), "rover dynamics");
+                rover_sys.DoStepDynamics(iteration_step);
+            }
+            GpuProfiler::Range range(profiler.get(), "wait granular advance");
+            gpu_advance.Wait(gpu_step);
+        } else {
+            {
+                GpuProfiler::Range range(profiler.get(), "granular advance");
+                gpu_sys.AdvanceSimulation(iteration_step);
+            }
+            GpuProfiler::Range range(profiler.get(), "rover dynamics");
+            rover_sys.DoStepDynamics(iteration_step);
+        }
 
+        {
+            GpuProfiler::Range range(profiler.get(), "collect mesh forces");
+            collectMeshContactForces(gpu_sys, wheel_bodies.size(), wheel_forces, wheel_torques);
+        }
         ChVector<> wheel_force;
         ChVector<> wheel_torque;
         for (unsigned int i = 0; i < wheel_bodies.size(); i++) {
             auto curr_body = wheel_bodies.at(i);
+            wheel_force = wheel_forces[i];
+            wheel_torque = wheel_torques[i];
 
-            gpu_sys.CollectMeshContactForces(i, wheel_force, wheel_torque);
-            
             curr_body->Empty_forces_accumulators();
             curr_body->Accumulate_force(wheel_force, curr_body->GetPos(), false);
             curr_body->Accumulate_torque(wheel_torque, false);
         }
 
         if (curr_step % out_steps == 0) {
+            GpuProfiler::Range range(profiler.get(), "output");
+            if (profiler)
+                profiler->SampleCounts(gpu_sys, params.sphere_radius, 8 * params.sphere_radius, t);
             std::cout << "Rendering frame " << currframe << std::endl;
             printf("Wheel forces: %f, %f, %f\n", wheel_force.x(), wheel_force.y(), wheel_force.z());
             printf("Wheel torques: %f, %f, %f\n", wheel_torque.x(), wheel_torque.y(), wheel_torque.z());
             char filename[100];
             sprintf(filename, "%s/step%06d", params.output_dir.c_str(), currframe++);
-            gpu_sys.WriteParticleFile(std::string(filename));
-            std::string mesh_output = std::string(filename) + "_meshframes.csv";
-            std::ofstream meshfile(mesh_output);
-            std::ostringstream outstream;
-            outstream << "mesh_name,dx,dy,dz,x1,x2,x3,y1,y2,y3,z1,z2,z3,sx,sy,sz\n";
-            // if the wheel is free, output its mesh, otherwise leave file empty
-            // if (!wheel_fixed) {
-            for (unsigned int i = 0; i < wheel_bodies.size(); i++) {
-                writeMeshFrames(outstream, wheel_bodies.at(i), wheel_filename, wheel_scaling);
+            if (frame_writer) {
+                mesh_poses.clear();
+                for (unsigned int i = 0; i < wheel_bodies.size(); i++) {
+                    mesh_poses.push_back({wheel_bodies.at(i)->GetPos() + ChVector<>(0, 0, terrain_height_offset),
+                                          wheel_bodies.at(i)->GetRot()});
+                }
+                mesh_poses.push_back(
+                    {chassis_body->GetPos() + ChVector<>(0, 0, terrain_height_offset), chassis_body->GetRot()});
+                frame_writer->WriteFrame(gpu_sys, std::string(filename), t, mesh_poses);
+            } else {
+                gpu_sys.WriteParticleFile(std::string(filename));
+                std::string mesh_output = std::string(filename) + "_meshframes.csv";
+                std::ofstream meshfile(mesh_output);
+                std::ostringstream outstream;
+                outstream << "mesh_name,dx,dy,dz,x1,x2,x3,y1,y2,y3,z1,z2,z3,sx,sy,sz\n";
+                // if the wheel is free, output its mesh, otherwise leave file empty
+                // if (!wheel_fixed) {
+                for (unsigned int i = 0; i < wheel_bodies.size(); i++) {
+                    writeMeshFrames(outstream, wheel_bodies.at(i), wheel_filename, wheel_scaling);
+                }
+
+                writeMeshFrames(outstream, chassis_body, chassis_filename, {METERS_TO_CM, METERS_TO_CM, METERS_TO_CM});
+
+                meshfile << outstream.str();
+                // }
             }
-
-            writeMeshFrames(outstream, chassis_body, chassis_filename, {METERS_TO_CM, METERS_TO_CM, METERS_TO_CM});
-
-            meshfile << outstream.str();
-            // }
         }
     }
 
@@ -408,12 +494,19 @@ int main(int argc, char* argv[]) {
         gpu_sys.SetParticleOutputMode(CHGPU_OUTPUT_MODE::CSV);
 
         gpu_sys.WriteParticleFile(checkpoint_file_base);
+        if (!writeStateCheckpoint(gpu_sys, checkpoint_file_base, params.time_end))
+            std::cout << "ERROR writing full state checkpoint" << std::endl;
     }
 
-    clock_t end = std::clock();
-    double total_time = ((double)(end - start)) / CLOCKS_PER_SEC;
+    timer.stop();
 
-    std::cout << "Time: " << total_time << " seconds" << std::endl;
+    std::cout << "Time: " << timer() << " seconds" << std::endl;
+    if (async_advance)
+        std::cout << "Waiting for GPU: " << gpu_advance.GetWaitTime() << " seconds" << std::endl;
+    if (profiler) {
+        profiler->Print(std::cout);
+        profiler->WriteJSON(params.output_dir + "/profile.json");
+    }
 
     return 0;
 }
@@ -15,9 +15,12 @@
 // system.
 // =============================================================================
 
+#include <algorithm>
 #include <cmath>
+#include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "chrono/core/ChGlobal.h"
 #include "chrono/utils/ChUtilsSamplers.h"
@@ -78,13 +81,65 @@ float curr_time = 0;
 int currframe = 0;
 
 // Bowling ball starts on incline to accelerate
-enum TEST_TYPE { ROTF = 0, PYRAMID = 1, ROTF_MESH = 2, PYRAMID_MESH = 3, MESH_STEP = 4, MESH_FORCE = 5 };
+enum TEST_TYPE {
+    ROTF = 0,
+    PYRAMID = 1,
+    ROTF_MESH = 2,
+    PYRAMID_MESH = 3,
+    MESH_STEP = 4,
+    MESH_FORCE = 5,
+    PYRAMID_BATCH = 6
+};
 
 void ShowUsage(std::string name) {
-    std::cout << "usage: " + name + " <TEST_TYPE: 0:ROTF 1:PYRAMID 2:ROTF_MESH 3:PYRAMID_MESH 4:MESH_STEP 5:MESH_FORCE>"
+    std::cout << "usage: " + name +
+                     " <TEST_TYPE: 0:ROTF 1:PYRAMID 2:ROTF_MESH 3:PYRAMID_MESH 4:MESH_STEP 5:MESH_FORCE "
+                     "6:PYRAMID_BATCH> [num_systems]"
               << std::endl;
 }
 
+// Layout of a batch of independent small systems in one granular system: each system is placed in its own cell of
+// a grid in the XY plane (over the shared bottom plane), with a cell size much larger than the extent of a system,
+// so that the systems never interact. The particles of system i are those in [first[i], first[i + 1]).
+struct BatchLayout {
+    BatchLayout(int num_systems, float cell_size) : cell(cell_size) {
+        nx = std::max(1, (int)(box_X / cell));
+        ny = std::max(1, (int)(box_Y / cell));
+        num = std::min(num_systems, nx * ny);
+        first.push_back(0);
+    }
+
+    // center of the cell of system i
+    ChVector<float> Offset(int i) const {
+        return ChVector<float>(-box_X / 2 + cell * (i % nx + 0.5f), -box_Y / 2 + cell * (i / nx + 0.5f), 0);
+    }
+
+    // add the particles of the next system
+    void Add(std::vector<ChVector<float>>& points, const std::vector<ChVector<float>>& system_points) {
+        ChVector<float> offset = Offset((int)first.size() - 1);
+        for (const auto& p : system_points)
+            points.push_back(p + offset);
+        first.push_back(points.size());
+    }
+
+    // check that all particles of system i are still within its cell
+    bool Isolated(const ChSystemGpu& gpu_sys, int i) const {
+        ChVector<float> offset = Offset(i);
+        for (size_t k = first[i]; k < first[i + 1]; k++) {
+            ChVector<float> d = gpu_sys.GetParticlePosition((int)k) - offset;
+            if (std::abs(d.x()) > cell / 2 || std::abs(d.y()) > cell / 2)
+                return false;
+        }
+        return true;
+    }
+
+    float cell;
+    int nx;
+    int ny;
+    int num;
+    std::vector<size_t> first;
+};
+
 // Set common set of parameters for all tests
 void setCommonParameters(ChSystemGpu& gpu_sys) {
 
@@ -374,6 +429,61 @@ void run_PYRAMID_MESH() {
     }
 }
 
+// Batch of pyramids (see run_PYRAMID) with base sphere spacings varying over the batch, all run in one system.
+// Writes, for each pyramid, the spacing, the initial and final height of the top sphere, and the isolation check.
+void run_PYRAMID_BATCH(int num_systems) {
+    ChSystemGpuMesh gpu_sys(sphere_radius, sphere_density, ChVector<float>(box_X, box_Y, box_Z));
+    setCommonParameters(gpu_sys);
+
+    timeEnd = 1;
+    ChVector<> bot_plane_pos(0, 0, -1.02 * sphere_radius);
+    ChVector<> bot_plane_normal(0, 0, 1);
+    gpu_sys.CreateBCPlane(bot_plane_pos, bot_plane_normal, true);
+
+    gpu_sys.SetFrictionMode(CHGPU_FRICTION_MODE::MULTI_STEP);
+    gpu_sys.SetRollingMode(CHGPU_ROLLING_MODE::NO_RESISTANCE);
+
+    BatchLayout layout(num_systems, 12 * sphere_radius);
+    std::vector<ChVector<float>> points;
+    std::vector<float> diam_deltas;
+    std::vector<float> top_z0;
+    for (int i = 0; i < layout.num; i++) {
+        // base sphere spacing from 2.01 (as in PYRAMID) to 2.4 radii
+        float diam_delta = 2.01f + 0.39f * i / std::max(layout.num - 1, 1);
+        ChVector<float> base_1(0, 0, 0);
+        ChVector<float> base_2(diam_delta * sphere_radius, 0, 0);
+        ChVector<float> base_3(diam_delta * sphere_radius * (float)std::cos(CH_C_PI / 3),
+                               diam_delta * sphere_radius * (float)std::sin(CH_C_PI / 3), 0);
+        // top sphere resting on the three base spheres
+        ChVector<float> top((base_1 + base_2 + base_3) / 3);
+        float base_dist = diam_delta * sphere_radius / (float)std::sqrt(3.0);
+        top.z() = std::sqrt(std::max(4 * sphere_radius * sphere_radius - base_dist * base_dist, 0.f));
+        ChVector<float> center(top.x(), top.y(), 0);
+        layout.Add(points, {base_1 - center, base_2 - center, base_3 - center, top - center});
+        diam_deltas.push_back(diam_delta);
+        top_z0.push_back(top.z());
+    }
+    gpu_sys.SetParticles(points);
+    std::cout << "Created " << layout.num << " pyramids (" << points.size() << " spheres)" << std::endl;
+
+    gpu_sys.Initialize();
+
+    while (curr_time < timeEnd)
+        advanceGranSim(gpu_sys);
+    writeGranFile(gpu_sys);
+
+    std::ofstream csv(output_dir + "/pyramid_batch.csv");
+    csv << "system,diam_delta,top_z0,top_z,isolated" << std::endl;
+    int num_isolated = 0;
+    for (int i = 0; i < layout.num; i++) {
+        bool isolated = layout.Isolated(gpu_sys, i);
+        num_isolated += isolated;
+        float top_z = gpu_sys.GetParticlePosition((int)layout.first[i + 1] - 1).z();
+        csv << i << "," << diam_deltas[i] << "," << top_z0[i] << "," << top_z << "," << isolated << std::endl;
+    }
+    std::cout << num_isolated << " of " << layout.num << " pyramids stayed isolated" << std::endl;
+}
+
 void run_MESH_STEP() {
     ChSystemGpuMesh gpu_sys(sphere_radius, sphere_density, ChVector<float>(box_X, box_Y, box_Z));
     setCommonParameters(gpu_sys);
@@ -479,7 +589,7 @@ void run_MESH_FORCE() {
 
 int main(int argc, char* argv[]) {
     TEST_TYPE curr_test = ROTF;
-    if (argc != 2) {
+    if (argc != 2 && argc != 3) {
         ShowUsage(argv[0]);
         return 1;
     }
@@ -514,6 +624,10 @@ int main(int argc, char* argv[]) {
             run_MESH_FORCE();
             break;
         }
+        case PYRAMID_BATCH: {
+            run_PYRAMID_BATCH(argc == 3 ? std::atoi(argv[2]) : 200);
+            break;
+        }
         default: {
             std::cout << "Invalid test" << std::endl;
             return 1;
@@ -0,0 +1,202 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Parallel queries over the granular particles of a Chrono::Multicore system:
+// height range, bulk density in a box region, and height field over an XY
+// grid.
+//
+// The particles are selected once with a filter on the bodies (e.g., positive
+// identifiers); the selection is extended incrementally when bodies are added
+// to the system (only the new bodies are visited) and rebuilt if bodies are
+// removed. The queries then work on the index list and on the body positions
+// stored in the multicore data manager (host_data.pos_rigid, updated at each
+// step), with OpenMP reductions, so they are cheap enough to be called at every
+// step. Before the first step (e.g., right after reading a checkpoint), the
+// positions are taken from the bodies.
+//
+// Particle masses are cached with the selection; call Refresh after changing
+// them (e.g., when adjusting the bulk density).
+//
+// =============================================================================
+
+#ifndef GRANULAR_QUERIES_H
+#define GRANULAR_QUERIES_H
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+
+class GranularQueries {
+  public:
+    /// Create queries over the bodies accepted by the given filter (default: all non-fixed bodies).
+    GranularQueries(std::function<bool(const chrono::ChBody&)> filter = nullptr)
+        : m_filter(filter), m_system(nullptr), m_num_bodies(0) {}
+
+    /// Force a new selection of the particles (and a new reading of their masses) at the next query.
+    void Refresh() { m_system = nullptr; }
+
+    /// Return the number of selected particles.
+    int GetNumParticles(chrono::ChSystemMulticore* system) {
+        Select(system);
+        return (int)m_indices.size();
+    }
+
+    /// Find the lowest and highest particle centers, optionally only for particles within the given XY region.
+    /// If there is no such particle, lowest = 1000 and highest = -1000.
+    void GetHeightRange(chrono::ChSystemMulticore* system,
+                        double& lowest,
+                        double& highest,
+                        double xmin = -1e30,
+                        double xmax = 1e30,
+                        double ymin = -1e30,
+                        double ymax = 1e30) {
+        Select(system);
+        const auto& pos = Positions(system);
+        int n = (int)m_indices.size();
+        double lo = 1000;
+        double hi = -1000;
+#pragma omp parallel for schedule(static) reduction(min : lo) reduction(max : hi)
+        for (int k = 0; k < n; k++) {
+            const chrono::real3& p = pos[m_indices[k]];
+            if (p.x < xmin || p.x > xmax || p.y < ymin || p.y > ymax)
+                continue;
+            lo = std::min(lo, (double)p.z);
+            hi = std::max(hi, (double)p.z);
+        }
+        lowest = lo;
+        highest = hi;
+    }
+
+    /// Return the bulk density (total mass of the particles with center in the box, divided by the box volume).
+    double GetBulkDensity(chrono::ChSystemMulticore* system,
+                          const chrono::ChVector<>& min,
+                          const chrono::ChVector<>& max) {
+        Select(system);
+        const auto& pos = Positions(system);
+        int n = (int)m_indices.size();
+        double mass = 0;
+#pragma omp parallel for schedule(static) reduction(+ : mass)
+        for (int k = 0; k < n; k++) {
+            const chrono::real3& p = pos[m_indices[k]];
+            if (p.x >= min.x() && p.x <= max.x() && p.y >= min.y() && p.y <= max.y() && p.z >= min.z() &&
+                p.z <= max.z())
+                mass += m_mass[k];
+        }
+        double volume = (max.x() - min.x()) * (max.y() - min.y()) * (max.z() - min.z());
+        return volume > 0 ? mass / volume : 0;
+    }
+
+    /// Compute the height field of the particles over a regular XY grid of nx x ny cells covering the given region:
+    /// the height of the highest particle center in each cell (cell (i, j) at index i * ny + j), or the given empty
+    /// value for cells without particles. Optionally return the number of particles in each cell.
+    void GetHeightField(chrono::ChSystemMulticore* system,
+                        double xmin,
+                        double xmax,
+                        double ymin,
+                        double ymax,
+                        int nx,
+                        int ny,
+                        std::vector<double>& heights,
+                        std::vector<int>* counts = nullptr,
+                        double empty = 0) {
+        Select(system);
+        const auto& pos = Positions(system);
+        int n = (int)m_indices.size();
+        int num_cells = nx * ny;
+        double dx = (xmax - xmin) / nx;
+        double dy = (ymax - ymin) / ny;
+        heights.assign(num_cells, -1e30);
+        if (counts)
+            counts->assign(num_cells, 0);
+
+#pragma omp parallel
+        {
+            // Accumulate in per-thread grids, then merge
+            std::vector<double> local_heights(num_cells, -1e30);
+            std::vector<int> local_counts(counts ? num_cells : 0, 0);
+#pragma omp for schedule(static) nowait
+            for (int k = 0; k < n; k++) {
+                const chrono::real3& p = pos[m_indices[k]];
+                int i = (int)std::floor((p.x - xmin) / dx);
+                int j = (int)std::floor((p.y - ymin) / dy);
+                if (i < 0 || i >= nx || j < 0 || j >= ny)
+                    continue;
+                int c = i * ny + j;
+                local_heights[c] = std::max(local_heights[c], (double)p.z);
+                if (counts)
+                    local_counts[c]++;
+            }
+#pragma omp critical
+            {
+                for (int c = 0; c < num_cells; c++) {
+                    heights[c] = std::max(heights[c], local_heights[c]);
+                    if (counts)
+                        (*counts)[c] += local_counts[c];
+                }
+            }
+        }
+
+        for (int c = 0; c < num_cells; c++) {
+            if (heights[c] == -1e30)
+                heights[c] = empty;
+        }
+    }
+
+  private:
+    // Select the particles (incrementally if bodies were only appended since the last selection).
+    void Select(chrono::ChSystemMulticore* system) {
+        const auto& bodies = system->Get_bodylist();
+        size_t num_bodies = bodies.size();
+        if (system != m_system || num_bodies < m_num_bodies) {
+            m_system = system;
+            m_num_bodies = 0;
+            m_indices.clear();
+            m_mass.clear();
+        }
+        for (size_t i = m_num_bodies; i < num_bodies; i++) {
+            const auto& body = bodies[i];
+            if (m_filter ? m_filter(*body) : !body->GetBodyFixed()) {
+                m_indices.push_back((int)i);
+                m_mass.push_back(body->GetMass());
+            }
+        }
+        m_num_bodies = num_bodies;
+    }
+
+    // Current body positions (from the data manager, or from the bodies if not yet set up).
+    const std::vector<chrono::real3>& Positions(chrono::ChSystemMulticore* system) {
+        const auto& pos = system->data_manager->host_data.pos_rigid;
+        if (pos.size() == m_num_bodies)
+            return pos;
+        const auto& bodies = system->Get_bodylist();
+        m_pos.resize(m_num_bodies);
+        int n = (int)m_num_bodies;
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; i++) {
+            const auto& p = bodies[i]->GetPos();
+            m_pos[i] = chrono::real3(p.x(), p.y(), p.z());
+        }
+        return m_pos;
+    }
+
+    std::function<bool(const chrono::ChBody&)> m_filter;
+    chrono::ChSystemMulticore* m_system;  // system of the current selection
+    size_t m_num_bodies;                  // number of bodies visited by the current selection
+    std::vector<int> m_indices;           // indices of the selected particles
+    std::vector<double> m_mass;           // masses of the selected particles
+    std::vector<chrono::real3> m_pos;     // positions read from the bodies (before the first step)
+};
+
+#endif
@@ -0,0 +1,312 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Persistent cache of convex hulls and convex decompositions, for programs
+// which build collision models from point sets or concave meshes at startup.
+//
+// The key of a cache entry is the input geometry itself: the point set of a
+// hull, or the vertices and faces of a decomposed mesh together with the
+// decomposition parameters. Entries are kept in memory for the lifetime of the
+// cache object (so that bodies sharing a geometry compute it once) and stored
+// in a cache directory, in a binary file named after a 64-bit FNV-1a hash of
+// the key. The key is saved in the entry, so that a hash collision or a stale
+// entry is never used.
+//
+// Each hull is returned as its vertices (the input for AddConvexHull) and the
+// triangles of its surface (for visualization assets).
+//
+// Entry file (native endianness):
+//   header: magic "CHHC", uint32 version, uint64 key size (bytes), key
+//   hulls:  uint64 number of hulls; for each hull, uint64 number of
+//           vertices, vertices (3 doubles each), uint64 number of faces,
+//           faces (3 int32 each)
+//
+// Typical use:
+//   ConvexHullCache cache;
+//   auto hull = cache.GetHull(points);
+//   body->GetCollisionModel()->AddConvexHull(mat, hull->vertices);
+//
+// =============================================================================
+
+#ifndef HULL_CACHE_H
+#define HULL_CACHE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define HULL_CACHE_GETPID _getpid
+#else
+#include <unistd.h>
+#define HULL_CACHE_GETPID getpid
+#endif
+
+#include "chrono/collision/ChCollisionUtilsBullet.h"
+#include "chrono/collision/ChConvexDecomposition.h"
+#include "chrono/geometry/ChTriangleMeshConnected.h"
+#include "chrono_thirdparty/filesystem/path.h"
+
+/// Convex hull: vertices and surface triangles.
+struct ConvexHull {
+    std::vector<chrono::ChVector<>> vertices;
+    std::vector<chrono::ChVector<int>> faces;
+
+    /// Return the hull surface as a triangle mesh (e.g., for a ChTriangleMeshShape asset).
+    std::shared_ptr<chrono::geometry::ChTriangleMeshConnected> GetMesh() const {
+        auto mesh = chrono_types::make_shared<chrono::geometry::ChTriangleMeshConnected>();
+        mesh->getCoordsVertices() = vertices;
+        mesh->getIndicesVertexes() = faces;
+        return mesh;
+    }
+};
+
+typedef std::vector<std::shared_ptr<ConvexHull>> ConvexHullList;
+
+/// Parameters of the HACDv2 convex decomposition (see ChConvexDecompositionHACDv2::SetParameters).
+struct ConvexDecompositionParams {
+    unsigned int max_hull_count = 256;
+    unsigned int max_merge_hull_count = 256;
+    unsigned int max_hull_vertices = 64;
+    float concavity = 0.2f;
+    float small_cluster_threshold = 0.0f;
+    float fuse_tolerance = 1e-9f;
+};
+
+class ConvexHullCache {
+  public:
+    ConvexHullCache(const std::string& cache_dir = "../CONVEX_HULL_CACHE")
+        : m_dir(cache_dir), m_hits(0), m_misses(0) {}
+
+    /// Return the convex hull of the given points.
+    std::shared_ptr<ConvexHull> GetHull(const std::vector<chrono::ChVector<>>& points) {
+        std::string key;
+        Append(key, (uint32_t)1);
+        Append(key, points);
+
+        ConvexHullList hulls;
+        if (!Find(key, hulls)) {
+            hulls.push_back(ComputeHull(points));
+            Insert(key, hulls);
+        }
+        return hulls[0];
+    }
+
+    /// Return the convex decomposition (HACDv2) of the given triangle mesh.
+    ConvexHullList GetDecomposition(chrono::geometry::ChTriangleMeshConnected& mesh,
+                                    const ConvexDecompositionParams& params = ConvexDecompositionParams()) {
+        std::string key;
+        Append(key, (uint32_t)2);
+        Append(key, params.max_hull_count);
+        Append(key, params.max_merge_hull_count);
+        Append(key, params.max_hull_vertices);
+        Append(key, params.concavity);
+        Append(key, params.small_cluster_threshold);
+        Append(key, params.fuse_tolerance);
+        Append(key, mesh.getCoordsVertices());
+        Append(key, mesh.getIndicesVertexes());
+
+        ConvexHullList hulls;
+        if (!Find(key, hulls)) {
+            chrono::collision::ChConvexDecompositionHACDv2 decomposition;
+            decomposition.Reset();
+            decomposition.AddTriangleMesh(mesh);
+            decomposition.SetParameters(params.max_hull_count, params.max_merge_hull_count, params.max_hull_vertices,
+                                        params.concavity, params.small_cluster_threshold, params.fuse_tolerance);
+            decomposition.ComputeConvexDecomposition();
+            for (unsigned int i = 0; i < decomposition.GetHullCount(); i++) {
+                std::vector<chrono::ChVector<>> points;
+                if (decomposition.GetConvexHullResult(i, points))
+                    hulls.push_back(ComputeHull(points));
+            }
+            Insert(key, hulls);
+        }
+        return hulls;
+    }
+
+    /// Return the number of lookups found in memory or on disk.
+    int GetNumHits() const { return m_hits; }
+
+    /// Return the number of lookups which required computing the hulls.
+    int GetNumMisses() const { return m_misses; }
+
+  private:
+    static const uint32_t version = 1;
+
+    template <typename T>
+    static void Append(std::string& key, const T& value) {
+        key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static void Append(std::string& key, const std::vector<chrono::ChVector<T>>& values) {
+        Append(key, (uint64_t)values.size());
+        for (const auto& v : values) {
+            T c[3] = {v.x(), v.y(), v.z()};
+            key.append(reinterpret_cast<const char*>(c), sizeof(c));
+        }
+    }
+
+    static std::string GetHash(const std::string& key) {
+        // 64-bit FNV-1a
+        uint64_t hash = 14695981039346656037ULL;
+        for (unsigned char c : key) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        char buf[17];
+        sprintf(buf, "%016llx", (unsigned long long)hash);
+        return std::string(buf);
+    }
+
+    static std::shared_ptr<ConvexHull> ComputeHull(const std::vector<chrono::ChVector<>>& points) {
+        chrono::geometry::ChTriangleMeshConnected mesh;
+        chrono::collision::bt_utils::ChConvexHullLibraryWrapper lh;
+        lh.ComputeHull(points, mesh);
+        auto hull = chrono_types::make_shared<ConvexHull>();
+        hull->vertices = mesh.getCoordsVertices();
+        hull->faces = mesh.getIndicesVertexes();
+        return hull;
+    }
+
+    std::string GetEntryFile(const std::string& hash) const { return m_dir + "/" + hash + ".hull"; }
+
+    // Look up the key in memory, then on disk.
+    bool Find(const std::string& key, ConvexHullList& hulls) {
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            hulls = it->second;
+            m_hits++;
+            return true;
+        }
+        if (Read(GetEntryFile(GetHash(key)), key, hulls)) {
+            m_entries[key] = hulls;
+            m_hits++;
+            return true;
+        }
+        m_misses++;
+        return false;
+    }
+
+    // Add an entry in memory and on disk.
+    void Insert(const std::string& key, const ConvexHullList& hulls) {
+        m_entries[key] = hulls;
+        filesystem::create_directory(filesystem::path(m_dir));
+        std::string filename = GetEntryFile(GetHash(key));
+        if (!Write(filename, key, hulls))
+            std::cout << "Could not write convex hull cache entry " << filename << std::endl;
+    }
+
+    template <typename T>
+    static bool ReadValue(std::ifstream& file, T& value) {
+        return (bool)file.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+
+    static bool Read(const std::string& filename, const std::string& key, ConvexHullList& hulls) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.good())
+            return false;
+
+        char magic[4];
+        uint32_t file_version;
+        uint64_t key_size;
+        if (!file.read(magic, 4) || std::memcmp(magic, "CHHC", 4) != 0 || !ReadValue(file, file_version) ||
+            file_version != version || !ReadValue(file, key_size) || key_size != key.size()) {
+            std::cout << "Convex hull cache entry " << filename << " is stale; ignored" << std::endl;
+            return false;
+        }
+        std::string file_key(key_size, '\0');
+        if (!file.read(&file_key[0], key_size) || file_key != key) {
+            std::cout << "Convex hull cache entry " << filename << " does not match key; ignored" << std::endl;
+            return false;
+        }
+
+        uint64_t num_hulls;
+        if (!ReadValue(file, num_hulls))
+            return false;
+        hulls.clear();
+        for (uint64_t i = 0; i < num_hulls; i++) {
+            auto hull = chrono_types::make_shared<ConvexHull>();
+            uint64_t num_vertices, num_faces;
+            if (!ReadValue(file, num_vertices))
+                return false;
+            std::vector<double> v(3 * num_vertices);
+            if (!file.read(reinterpret_cast<char*>(v.data()), v.size() * sizeof(double)))
+                return false;
+            for (uint64_t k = 0; k < num_vertices; k++)
+                hull->vertices.push_back(chrono::ChVector<>(v[3 * k], v[3 * k + 1], v[3 * k + 2]));
+            if (!ReadValue(file, num_faces))
+                return false;
+            std::vector<int32_t> f(3 * num_faces);
+            if (!file.read(reinterpret_cast<char*>(f.data()), f.size() * sizeof(int32_t)))
+                return false;
+            for (uint64_t k = 0; k < num_faces; k++)
+                hull->faces.push_back(chrono::ChVector<int>(f[3 * k], f[3 * k + 1], f[3 * k + 2]));
+            hulls.push_back(hull);
+        }
+        return true;
+    }
+
+    // Write to a temporary file, renamed when complete, so that concurrent programs never read a partial entry.
+    static bool Write(const std::string& filename, const std::string& key, const ConvexHullList& hulls) {
+        std::string tmpname = filename + ".tmp" + std::to_string(HULL_CACHE_GETPID());
+        {
+            std::ofstream file(tmpname, std::ios::binary);
+            uint32_t file_version = version;
+            uint64_t key_size = key.size();
+            file.write("CHHC", 4);
+            file.write(reinterpret_cast<const char*>(&file_version), sizeof(file_version));
+            file.write(reinterpret_cast<const char*>(&key_size), sizeof(key_size));
+            file.write(key.data(), key.size());
+            uint64_t num_hulls = hulls.size();
+            file.write(reinterpret_cast<const char*>(&num_hulls), sizeof(num_hulls));
+            for (const auto& hull : hulls) {
+                uint64_t num_vertices = hull->vertices.size();
+                file.write(reinterpret_cast<const char*>(&num_vertices), sizeof(num_vertices));
+                for (const auto& v : hull->vertices) {
+                    double c[3] = {v.x(), v.y(), v.z()};
+                    file.write(reinterpret_cast<const char*>(c), sizeof(c));
+                }
+                uint64_t num_faces = hull->faces.size();
+                file.write(reinterpret_cast<const char*>(&num_faces), sizeof(num_faces));
+                for (const auto& f : hull->faces) {
+                    int32_t c[3] = {f.x(), f.y(), f.z()};
+                    file.write(reinterpret_cast<const char*>(c), sizeof(c));
+                }
+            }
+            if (!file.good()) {
+                file.close();
+                remove(tmpname.c_str());
+                return false;
+            }
+        }
+        if (rename(tmpname.c_str(), filename.c_str()) != 0) {
+            remove(tmpname.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    std::string m_dir;
+    std::map<std::string, ConvexHullList> m_entries;
+    int m_hits;
+    int m_misses;
+};
+
+#endif
@@ -0,0 +1,110 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Projectile impact runs with early stop, for sweeps of projectile variants
+// (mass, velocity, shape) dropped in the same settled granular bed.
+//
+// RunImpact advances a system from the moment the projectile touches the bed
+// until the projectile comes to rest: its speed must stay below a threshold
+// for a hold time (so that the momentary stop at the deepest point of a
+// rebound does not end the run), after a minimum time. The run stops at the
+// maximum time otherwise. The penetration depth (displacement of the projectile
+// since the start of the run, at the end and at the deepest point) is recorded.
+//
+// ImpactSweepOptions parses the sweep command line of the programs:
+//   -sweep [num_workers [first_member num_members]]
+// The members of the sweep are run on an EnsemblePool (see ensemble_pool.h);
+// a subset of the members can be given to split a sweep over several processes
+// started from the same settled bed.
+//
+// =============================================================================
+
+#ifndef IMPACT_SWEEP_H
+#define IMPACT_SWEEP_H
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+
+struct ImpactResult {
+    double time = 0;       // simulated time at the end of the run
+    double depth = 0;      // penetration depth at the end of the run
+    double max_depth = 0;  // deepest penetration
+    double speed = 0;      // projectile speed at the end of the run
+    int num_steps = 0;
+    bool stopped = false;  // the projectile came to rest before the maximum time
+};
+
+/// Run the impact of the given projectile until it comes to rest (speed below stop_speed for hold_time, after
+/// min_time) or until max_time.
+inline ImpactResult RunImpact(chrono::ChSystemMulticore* system,
+                              std::shared_ptr<chrono::ChBody> projectile,
+                              double time_step,
+                              double min_time,
+                              double max_time,
+                              double stop_speed,
+                              double hold_time) {
+    ImpactResult result;
+    double z0 = projectile->GetPos().z();
+    double rest_time = 0;
+    while (result.time < max_time) {
+        system->DoStepDynamics(time_step);
+        result.time += time_step;
+        result.num_steps++;
+
+        double depth = z0 - projectile->GetPos().z();
+        result.max_depth = std::max(result.max_depth, depth);
+        result.depth = depth;
+        result.speed = projectile->GetPos_dt().Length();
+
+        rest_time = result.speed < stop_speed ? rest_time + time_step : 0;
+        if (result.time >= min_time && rest_time >= hold_time) {
+            result.stopped = true;
+            break;
+        }
+    }
+    return result;
+}
+
+struct ImpactSweepOptions {
+    bool enabled = false;
+    int num_workers = 0;  // default: one per hardware thread
+    int first = 0;        // first member run by this process
+    int count = -1;       // number of members run by this process (default: all from first)
+
+    /// Parse "-sweep [num_workers [first_member num_members]]" at the start of the command line. Return false if the
+    /// command line does not select a sweep.
+    bool Parse(int argc, char* argv[]) {
+        if (argc < 2 || std::string(argv[1]) != "-sweep")
+            return false;
+        enabled = true;
+        if (argc > 2)
+            num_workers = std::stoi(argv[2]);
+        if (argc > 4) {
+            first = std::stoi(argv[3]);
+            count = std::stoi(argv[4]);
+        }
+        return true;
+    }
+
+    /// Clamp the member range to a sweep of the given size; return the number of members to run.
+    int Range(int num_members) {
+        first = std::min(std::max(first, 0), num_members);
+        int last = count < 0 ? num_members : std::min(num_members, first + count);
+        count = last - first;
+        return count;
+    }
+};
+
+#endif
@@ -0,0 +1,176 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Wall-clock instrumentation of the sections of a simulation loop (e.g. the
+// Synchronize and Advance calls of the driver, vehicle, terrain, and
+// visualization modules of a vehicle or SynChrono demo).
+//
+// Each section is timed with a scoped timer (LoopProfiler::Scope) and each
+// loop iteration with BeginStep/EndStep. Report summarizes the window since
+// the previous report: the real-time factor (wall time over simulated time),
+// the mean, 99th percentile, and maximum step latency, and the time spent in
+// each section. When compiled with LOOP_PROFILER_MPI, with MPI initialized and
+// SetGatherRanks(true), Report is collective: the summaries of all ranks are
+// gathered on the root rank, which prints the largest RTF and p99 latency with
+// their ranks and the section breakdown of the slowest rank. All ranks must then
+// call Report on the same iterations (a rank leaving the loop early would block
+// the others).
+//
+// Typical use:
+//   LoopProfiler profiler({"driver", "vehicle", "terrain"});
+//   while (...) {
+//       profiler.BeginStep();
+//       {
+//           LoopProfiler::Scope scope(profiler, 0);
+//           driver.Synchronize(time);
+//       }
+//       ...
+//       profiler.EndStep();
+//       if (step_number % 500 == 0)
+//           profiler.Report(time, std::cout);
+//   }
+//
+// =============================================================================
+
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef LOOP_PROFILER_MPI
+    #include <mpi.h>
+#endif
+
+class LoopProfiler {
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    /// Scoped timer adding its lifetime to the given section.
+    class Scope {
+      public:
+        Scope(LoopProfiler& profiler, int section)
+            : m_profiler(profiler), m_section(section), m_start(Clock::now()) {}
+        ~Scope() { m_profiler.m_section_times[m_section] += Seconds(Clock::now() - m_start); }
+
+      private:
+        LoopProfiler& m_profiler;
+        int m_section;
+        Clock::time_point m_start;
+    };
+
+    explicit LoopProfiler(const std::vector<std::string>& sections)
+        : m_sections(sections), m_section_times(sections.size(), 0.0), m_window_sim_start(0), m_gather(false) {
+        m_window_start = Clock::now();
+        m_step_start = m_window_start;
+    }
+
+    /// Gather the summaries of all MPI ranks on the root rank in Report (default: false).
+    void SetGatherRanks(bool gather) { m_gather = gather; }
+
+    /// Mark the start of a loop iteration.
+    void BeginStep() { m_step_start = Clock::now(); }
+
+    /// Mark the end of a loop iteration, recording its latency.
+    void EndStep() { m_step_times.push_back(Seconds(Clock::now() - m_step_start)); }
+
+    /// Report the statistics of the window since the last report, for the given current simulation time, and start a
+    /// new window. When gathering ranks, this must be called by all ranks and only the root rank prints.
+    void Report(double sim_time, std::ostream& out, bool print = true, int root = 0) {
+        // local summary: RTF, mean, p99 and max step latency, then the section times
+        std::vector<double> local(4 + m_sections.size(), 0.0);
+        double wall = Seconds(Clock::now() - m_window_start);
+        double sim = sim_time - m_window_sim_start;
+        local[0] = sim > 0 ? wall / sim : 0;
+        if (!m_step_times.empty()) {
+            double sum = 0;
+            for (double t : m_step_times)
+                sum += t;
+            local[1] = sum / m_step_times.size();
+            size_t k = std::min(m_step_times.size() - 1, (size_t)(0.99 * m_step_times.size()));
+            std::nth_element(m_step_times.begin(), m_step_times.begin() + k, m_step_times.end());
+            local[2] = m_step_times[k];
+            local[3] = *std::max_element(m_step_times.begin() + k, m_step_times.end());
+        }
+        std::copy(m_section_times.begin(), m_section_times.end(), local.begin() + 4);
+
+        int rank = root;
+        int num_ranks = 1;
+        std::vector<double> all = local;
+#ifdef LOOP_PROFILER_MPI
+        int initialized = 0;
+        MPI_Initialized(&initialized);
+        if (m_gather && initialized) {
+            MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+            MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+            all.resize(local.size() * num_ranks);
+            MPI_Gather(local.data(), (int)local.size(), MPI_DOUBLE, all.data(), (int)local.size(), MPI_DOUBLE, root,
+                       MPI_COMM_WORLD);
+        }
+#endif
+
+        if (print && rank == root)
+            Print(all, local.size(), num_ranks, out);
+
+        m_window_start = Clock::now();
+        m_window_sim_start = sim_time;
+        m_step_times.clear();
+        std::fill(m_section_times.begin(), m_section_times.end(), 0.0);
+    }
+
+  private:
+    static double Seconds(Clock::duration d) { return std::chrono::duration<double>(d).count(); }
+
+    void Print(const std::vector<double>& all, size_t stride, int num_ranks, std::ostream& out) const {
+        int slowest = 0;
+        int worst_p99 = 0;
+        for (int r = 1; r < num_ranks; r++) {
+            if (all[r * stride] > all[slowest * stride])
+                slowest = r;
+            if (all[r * stride + 2] > all[worst_p99 * stride + 2])
+                worst_p99 = r;
+        }
+
+        const double* s = &all[slowest * stride];
+        out << "RTF: " << s[0];
+        if (num_ranks > 1)
+            out << " (rank " << slowest << ")";
+        out << " | step mean " << 1e3 * s[1] << " ms, p99 " << 1e3 * all[worst_p99 * stride + 2] << " ms";
+        if (num_ranks > 1)
+            out << " (rank " << worst_p99 << ")";
+        out << ", max " << 1e3 * s[3] << " ms\n";
+
+        double total = 0;
+        for (size_t i = 0; i < m_sections.size(); i++)
+            total += s[4 + i];
+        out << "  sections:";
+        for (size_t i = 0; i < m_sections.size(); i++) {
+            out << " " << m_sections[i] << " " << 1e3 * s[4 + i] << " ms";
+            if (total > 0)
+                out << " (" << (int)(100 * s[4 + i] / total + 0.5) << "%)";
+        }
+        out << "\n";
+    }
+
+    std::vector<std::string> m_sections;
+    std::vector<double> m_section_times;
+    std::vector<double> m_step_times;
+    Clock::time_point m_window_start;
+    Clock::time_point m_step_start;
+    double m_window_sim_start;
+    bool m_gather;
+};
+
+#endif
@@ -0,0 +1,175 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Granular terrain patch following a tracked body (e.g., a vehicle chassis)
+// along the X axis, for Chrono::Multicore.
+//
+// The granular bed (of length L along X) is recorded in its settled state when
+// the patch is initialized. As the tracked body advances, the bed window
+// [s, s+L] is kept centered on the active region [x - behind, x + ahead]
+// around the tracked body position x:
+//   - particles left behind the window are recycled to the front, with the
+//     position and orientation they had in the settled bed, shifted by a
+//     multiple of L (so that the front of the bed is always undisturbed
+//     settled material);
+//   - particles outside the active region are frozen (fixed bodies) and only
+//     act as boundaries for the active particles;
+//   - the container (bottom and side walls) is moved along with the window.
+// The number of bodies, and hence memory and cost per step, are independent of
+// the course length.
+//
+// Frozen particles are only released when they enter the active region; the
+// window never moves backwards.
+//
+// =============================================================================
+
+#ifndef MOVING_PATCH_H
+#define MOVING_PATCH_H
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+
+class MovingPatch {
+  public:
+    /// Create a patch following the given body, for a bed of given length, with an active region extending the given
+    /// distances behind and ahead of the tracked body.
+    MovingPatch(std::shared_ptr<chrono::ChBody> tracked, double bed_length, double behind, double ahead)
+        : m_tracked(tracked),
+          m_length(bed_length),
+          m_behind(behind),
+          m_ahead(ahead),
+          m_start0(0),
+          m_start(0),
+          m_num_active(0),
+          m_num_frozen(0),
+          m_num_recycled(0) {}
+
+    /// Set a filter for the particle bodies (default: all non-fixed bodies at initialization).
+    void SetFilter(std::function<bool(const chrono::ChBody&)> filter) { m_filter = filter; }
+
+    /// Set the container body (moved along with the bed window).
+    void SetContainer(std::shared_ptr<chrono::ChBody> container) { m_container = container; }
+
+    /// Record the settled bed (the current particle states); the bed window starts at the lowest particle X.
+    void Initialize(chrono::ChSystemMulticore* system) {
+        using namespace chrono;
+
+        m_particles.clear();
+        for (auto body : system->Get_bodylist()) {
+            if (!body->GetBodyFixed() && (!m_filter || m_filter(*body)))
+                m_particles.push_back(body);
+        }
+        size_t num_particles = m_particles.size();
+        m_pos.resize(num_particles);
+        m_rot.resize(num_particles);
+        m_shift.assign(num_particles, 0);
+
+        m_start0 = num_particles > 0 ? m_particles[0]->GetPos().x() : 0;
+        for (size_t i = 0; i < num_particles; i++) {
+            m_pos[i] = m_particles[i]->GetPos();
+            m_rot[i] = m_particles[i]->GetRot();
+            m_start0 = std::min(m_start0, m_pos[i].x());
+        }
+        m_start = m_start0;
+        if (m_container)
+            m_container_pos = m_container->GetPos();
+
+        Update(system);
+    }
+
+    /// Move the bed window with the tracked body, recycle and freeze particles. Must be called after each step.
+    void Update(chrono::ChSystemMulticore* system) {
+        using namespace chrono;
+
+        // Center the bed window on the active region (never moving backwards)
+        double x = m_tracked->GetPos().x();
+        double start = x - m_behind - (m_length - m_behind - m_ahead) / 2;
+        if (start > m_start) {
+            m_start = start;
+            if (m_container)
+                m_container->SetPos(m_container_pos + ChVector<>(m_start - m_start0, 0, 0));
+        }
+
+        double active_min = x - m_behind;
+        double active_max = x + m_ahead;
+        int num_particles = (int)m_particles.size();
+        int num_active = 0;
+        int num_recycled = 0;
+#pragma omp parallel for schedule(static) reduction(+ : num_active, num_recycled)
+        for (int i = 0; i < num_particles; i++) {
+            auto& body = m_particles[i];
+
+            // Recycle particles left behind the bed window
+            if (m_pos[i].x() + m_shift[i] * m_length < m_start) {
+                while (m_pos[i].x() + m_shift[i] * m_length < m_start)
+                    m_shift[i]++;
+                body->SetPos(m_pos[i] + ChVector<>(m_shift[i] * m_length, 0, 0));
+                body->SetRot(m_rot[i]);
+                body->SetPos_dt(ChVector<>(0, 0, 0));
+                body->SetWvel_loc(ChVector<>(0, 0, 0));
+                num_recycled++;
+            }
+
+            // Freeze particles outside the active region
+            double px = body->GetPos().x();
+            bool active = px >= active_min && px <= active_max;
+            if (!active && !body->GetBodyFixed()) {
+                body->SetPos_dt(ChVector<>(0, 0, 0));
+                body->SetWvel_loc(ChVector<>(0, 0, 0));
+            }
+            body->SetBodyFixed(!active);
+            num_active += active ? 1 : 0;
+        }
+
+        m_num_active = num_active;
+        m_num_frozen = num_particles - num_active;
+        m_num_recycled += num_recycled;
+    }
+
+    /// Return the current start of the bed window.
+    double GetStart() const { return m_start; }
+
+    /// Return the number of active particles (after the last update).
+    int GetNumActive() const { return m_num_active; }
+
+    /// Return the number of frozen particles (after the last update).
+    int GetNumFrozen() const { return m_num_frozen; }
+
+    /// Return the total number of particle recycling events.
+    long GetNumRecycled() const { return m_num_recycled; }
+
+  private:
+    std::shared_ptr<chrono::ChBody> m_tracked;
+    std::shared_ptr<chrono::ChBody> m_container;
+    std::function<bool(const chrono::ChBody&)> m_filter;
+    double m_length;
+    double m_behind;
+    double m_ahead;
+
+    std::vector<std::shared_ptr<chrono::ChBody>> m_particles;
+    std::vector<chrono::ChVector<>> m_pos;      // settled particle positions
+    std::vector<chrono::ChQuaternion<>> m_rot;  // settled particle orientations
+    std::vector<int> m_shift;                   // number of bed lengths each particle was moved forward
+    chrono::ChVector<> m_container_pos;         // initial container position
+    double m_start0;                            // initial start of the bed window
+    double m_start;                             // current start of the bed window
+
+    int m_num_active;
+    int m_num_frozen;
+    long m_num_recycled;
+};
+
+#endif
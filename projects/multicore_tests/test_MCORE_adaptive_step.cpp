@@ -0,0 +1,138 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Test of the rollback of rejected steps in AdaptiveStepController
+// (adaptive_step.h).
+//
+// A sphere is shot at a fixed ground box from just above it. The initial step
+// is large enough for the sphere to sink well into the box in one step, so the
+// first attempts must be rejected and rolled back. The test checks that:
+//   - the first accepted step was preceded by rejected steps,
+//   - the accepted step was taken from the initial state (time and position),
+//   - the overlap measured by the controller after each step is that of the
+//     new state (computed from the sphere position) and stays below the
+//     rejection threshold.
+//
+// The global reference frame has Z up.
+// All units SI.
+// =============================================================================
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+#include "chrono/utils/ChUtilsCreators.h"
+
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+
+#include "../adaptive_step.h"
+
+using namespace chrono;
+
+// Sphere parameters
+double radius = 0.05;
+double density = 2500;
+double gap = 1e-3;  // initial distance to the ground
+double speed = 10;  // initial speed towards the ground
+
+// Controller parameters
+double step_init = 2e-3;
+double step_min = 1e-6;
+double step_max = 2e-3;
+double max_overlap = 0.1;  // rejection threshold, as a fraction of the radius
+
+double time_end = 0.02;
+
+int main(int argc, char* argv[]) {
+    ChSystemMulticoreSMC system;
+    system.Set_G_acc(ChVector<>(0, 0, -9.81));
+    system.GetSettings()->solver.contact_force_model = ChSystemSMC::Hertz;
+    system.GetSettings()->solver.tangential_displ_mode = ChSystemSMC::TangentialDisplacementModel::OneStep;
+    system.GetSettings()->collision.collision_envelope = 0;
+    system.GetSettings()->collision.bins_per_axis = vec3(1, 1, 1);
+    system.SetNumThreads(1);
+
+    auto material = chrono_types::make_shared<ChMaterialSurfaceSMC>();
+    material->SetYoungModulus(1e7f);
+    material->SetPoissonRatio(0.3f);
+    material->SetFriction(0.4f);
+    material->SetRestitution(0.1f);
+
+    // Ground box, with its top face at z = 0
+    auto ground = std::shared_ptr<ChBody>(system.NewBody());
+    system.AddBody(ground);
+    ground->SetIdentifier(-1);
+    ground->SetMass(1);
+    ground->SetBodyFixed(true);
+    ground->SetCollide(true);
+    ground->GetCollisionModel()->ClearModel();
+    utils::AddBoxGeometry(ground.get(), material, ChVector<>(0.5, 0.5, 0.1), ChVector<>(0, 0, -0.1));
+    ground->GetCollisionModel()->BuildModel();
+
+    // Sphere moving towards the ground
+    double mass = density * (4.0 / 3.0) * CH_C_PI * radius * radius * radius;
+    double z0 = radius + gap;
+    double vz0 = -speed;
+    auto sphere = std::shared_ptr<ChBody>(system.NewBody());
+    system.AddBody(sphere);
+    sphere->SetIdentifier(1);
+    sphere->SetMass(mass);
+    sphere->SetInertiaXX(0.4 * mass * radius * radius * ChVector<>(1, 1, 1));
+    sphere->SetPos(ChVector<>(0, 0, z0));
+    sphere->SetPos_dt(ChVector<>(0, 0, vz0));
+    sphere->SetCollide(true);
+    sphere->GetCollisionModel()->ClearModel();
+    utils::AddSphereGeometry(sphere.get(), material, radius);
+    sphere->GetCollisionModel()->BuildModel();
+
+    AdaptiveStepController stepper(radius, step_min, step_max, step_init);
+    stepper.SetOverlap(0.02, max_overlap);
+    stepper.EnableRollback(true);
+
+    bool passed = true;
+
+    // First step: the initial step makes the sphere sink into the ground and must be rejected
+    double step = stepper.DoStep(&system);
+    double z1 = z0 + (vz0 - 9.81 * step) * step;
+    std::cout << "First step: " << step << " (" << stepper.GetNumRejected() << " rejected)" << std::endl;
+    if (stepper.GetNumRejected() == 0 || step >= step_init) {
+        std::cout << "  FAILED: no step was rejected" << std::endl;
+        passed = false;
+    }
+    if (std::abs(system.GetChTime() - step) > 1e-12 || std::abs(sphere->GetPos().z() - z1) > 1e-9) {
+        std::cout << "  FAILED: accepted step not taken from the initial state (t = " << system.GetChTime()
+                  << ", z = " << sphere->GetPos().z() << ", expected z = " << z1 << ")" << std::endl;
+        passed = false;
+    }
+
+    // Continue the impact: the measured overlap must be that of the state after each step
+    while (passed && system.GetChTime() < time_end) {
+        step = stepper.DoStep(&system);
+        double overlap = std::max(0.0, radius - sphere->GetPos().z());
+        if (std::abs(stepper.GetMaxOverlap() - overlap) > 1e-3 * radius) {
+            std::cout << "  FAILED: measured overlap " << stepper.GetMaxOverlap() << " at t = " << system.GetChTime()
+                      << ", actual overlap " << overlap << std::endl;
+            passed = false;
+        }
+        if (step > step_min && overlap > max_overlap * radius) {
+            std::cout << "  FAILED: accepted step with overlap " << overlap / radius << " at t = "
+                      << system.GetChTime() << std::endl;
+            passed = false;
+        }
+    }
+
+    stepper.PrintSummary();
+    std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+
+    return passed ? 0 : 1;
+}
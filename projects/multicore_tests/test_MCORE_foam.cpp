@@ -42,6 +42,7 @@
 #endif
 
 #include "../utils.h"
+#include "../smc_force_kernels.h"
 
 using namespace chrono;
 using namespace chrono::collision;
@@ -62,6 +63,10 @@ double time_end = 5;
 
 int max_iteration = 20;
 
+// Use the contact force kernel specialized for the contact models of this test (Hertz, constant adhesion, and
+// one-step tangential displacements, the multicore SMC defaults)
+bool use_force_kernels = true;
+
 // Output
 const std::string out_dir = "../FOAM";
 const std::string pov_dir = out_dir + "/POVRAY";
@@ -137,6 +142,10 @@ int main(int argc, char* argv[]) {
 
     msystem->GetSettings()->collision.narrowphase_algorithm = ChNarrowphase::Algorithm::PRIMS;
 
+    std::shared_ptr<SMCForceKernelSolver> force_kernels;
+    if (use_force_kernels)
+        force_kernels = EnableSMCForceKernels(msystem);
+
     // Create a material for the granular material
     auto mat_g = chrono_types::make_shared<ChMaterialSurfaceSMC>();
     mat_g->SetYoungModulus(Y_g);
@@ -243,6 +252,11 @@ int main(int argc, char* argv[]) {
     cout << "Number of bodies: " << msystem->Get_bodylist().size() << endl;
     cout << "Simulation time: " << exec_time << endl;
     cout << "Number of threads: " << threads << endl;
+    if (force_kernels) {
+        cout << "Contact force kernel: " << force_kernels->GetKernelName() << " ("
+             << force_kernels->GetNumSpecializedSteps() << " steps, "
+             << force_kernels->GetNumFallbackSteps() << " with the library kernel)" << endl;
+    }
 
     return 0;
 }
@@ -0,0 +1,70 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Convert binary frame files written by FrameExporter (frame_exporter.h) to
+// the PovRay data format of utils::WriteShapesPovray, or to CSV body states.
+//
+// Usage: test_MCORE_frame_convert [-csv] [-bodies] <frame.bin> ...
+// (the output file name is obtained by replacing the extension with .dat, or
+// .csv with -csv; -bodies also writes the body states in the PovRay files)
+//
+// =============================================================================
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../frame_exporter.h"
+
+int main(int argc, char* argv[]) {
+    bool csv = false;
+    bool body_info = false;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "-csv")
+            csv = true;
+        else if (arg == "-bodies")
+            body_info = true;
+        else
+            files.push_back(arg);
+    }
+    if (files.empty()) {
+        std::cout << "Usage: " << argv[0] << " [-csv] [-bodies] <frame.bin> ..." << std::endl;
+        return 1;
+    }
+
+    int num_converted = 0;
+    for (const auto& bin_file : files) {
+        size_t dot = bin_file.find_last_of('.');
+        size_t slash = bin_file.find_last_of("/\\");
+        std::string out_file = (dot != std::string::npos && (slash == std::string::npos || dot > slash)
+                                    ? bin_file.substr(0, dot)
+                                    : bin_file) +
+                               (csv ? ".csv" : ".dat");
+
+        FrameData data;
+        if (!ReadFrame(bin_file, data)) {
+            std::cout << "Cannot read frame file " << bin_file << std::endl;
+            continue;
+        }
+        bool ok = csv ? WriteFrameCSV(data, out_file) : WriteFramePovray(data, out_file, body_info);
+        if (!ok) {
+            std::cout << "Cannot write " << out_file << std::endl;
+            continue;
+        }
+        num_converted++;
+    }
+
+    std::cout << "Converted " << num_converted << " of " << files.size() << " frames" << std::endl;
+    return num_converted == (int)files.size() ? 0 : 1;
+}
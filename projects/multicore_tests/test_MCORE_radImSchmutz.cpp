@@ -19,6 +19,7 @@
 #include <cstdio>
 #include <vector>
 #include <cmath>
+#include <fstream>
 
 #include "chrono/ChConfig.h"
 #include "chrono/core/ChStream.h"
@@ -35,6 +36,8 @@
 
 #include "chrono_thirdparty/filesystem/path.h"
 
+#include "../binary_checkpoint.h"
+
 // Control use of OpenGL run-time rendering
 // Note: CHRONO_OPENGL is defined in ChConfig.h
 //#undef CHRONO_OPENGL
@@ -101,8 +104,10 @@ const std::string out_dir = "../SCHMUTZ_NSC";
 #endif
 const std::string pov_dir = out_dir + "/POVRAY";
 const std::string checkpoint_file = out_dir + "/settled.dat";
+const std::string binary_checkpoint_file = out_dir + "/settled.bin";
 const std::string stats_file = out_dir + "/stats.dat";
 const std::string results_file = out_dir + "/results.dat";
+const std::string full_timing_file = out_dir + "/pushing_full_bed.dat";
 
 int out_fps_settling = 30;
 int out_fps_pushing = 60;
@@ -145,6 +150,18 @@ double d = L / 2 - 1.2 * w_w;
 double init_vel = 5;
 double init_angle = (CH_C_PI / 180) * 4;
 
+// -----------------------------------------------------------------------------
+// Rig-only restart (PUSHING phase)
+// -----------------------------------------------------------------------------
+
+// If true, only the particles in the volume swept by the wheel (over the pushing duration, at the initial rig
+// velocity), down to the given depth below the wheel, are simulated; all other particles of the settled bed are
+// fixed (they still collide with the simulated particles, but are excluded from the solver and their mutual contacts
+// are discarded).
+bool rig_only = false;
+double rig_only_depth = 20 * r_g;
+double rig_only_margin = 4 * r_g;
+
 // =============================================================================
 // This class encapsulates the rig's mechanism
 // =============================================================================
@@ -155,6 +172,9 @@ class Mechanism {
     const ChVector<>& GetSledVelocity() const { return m_sled->GetPos_dt(); }
     const ChVector<>& GetWheelVelocity() const { return m_wheel->GetPos_dt(); }
 
+    // Axis-aligned bounds of the wheel contact shape, in its current configuration.
+    void GetWheelBounds(ChVector<>& bmin, ChVector<>& bmax) const;
+
     void WriteResults(ChStreamOutAsciiFile& f, double time);
 
   private:
@@ -276,6 +296,17 @@ Mechanism::Mechanism(ChSystemMulticore* system, double h) {
     system->AddLink(m_revolute);
 }
 
+void Mechanism::GetWheelBounds(ChVector<>& bmin, ChVector<>& bmax) const {
+    // Cylinder (rounded or not) with its axis along the Y axis of the shape frame
+    ChVector<> center = m_wheel->TransformPointLocalToParent(ChVector<>(c, 0, -b));
+    ChVector<> axis = m_wheel->TransformDirectionLocalToParent(Q_from_AngZ(CH_C_PI_2).Rotate(VECT_Y));
+    ChVector<> hdims;
+    for (int i = 0; i < 3; i++)
+        hdims[i] = (w_w / 2) * std::abs(axis[i]) + r_w * std::sqrt(std::max(0.0, 1 - axis[i] * axis[i]));
+    bmin = center - hdims;
+    bmax = center + hdims;
+}
+
 void Mechanism::WriteResults(ChStreamOutAsciiFile& f, double time) {
     // Velocity of sled body (in absolute frame)
     ChVector<> sled_vel = m_sled->GetPos_dt();
@@ -379,6 +410,31 @@ void FindRange(ChSystem* sys, double& lowest, double& highest) {
     }
 }
 
+// =============================================================================
+// Fix all particles outside the given box (rig-only restart). Return the number
+// of particles left free.
+// =============================================================================
+int FreezeOutside(ChSystem* sys, const ChVector<>& bmin, const ChVector<>& bmax, int& num_particles) {
+    int num_free = 0;
+    num_particles = 0;
+    for (auto body : sys->Get_bodylist()) {
+        if (body->GetIdentifier() < 100)
+            continue;
+        num_particles++;
+        const ChVector<>& pos = body->GetPos();
+        bool inside = pos.x() > bmin.x() && pos.x() < bmax.x() && pos.y() > bmin.y() && pos.y() < bmax.y() &&
+                      pos.z() > bmin.z() && pos.z() < bmax.z();
+        if (inside) {
+            num_free++;
+        } else {
+            body->SetPos_dt(VNULL);
+            body->SetWvel_loc(VNULL);
+            body->SetBodyFixed(true);
+        }
+    }
+    return num_free;
+}
+
 // =============================================================================
 // =============================================================================
 int main(int argc, char* argv[]) {
@@ -454,6 +510,7 @@ int main(int argc, char* argv[]) {
     double time_end;
     int out_fps;
     Mechanism* mech = NULL;
+    int num_free_particles = -1;
 
     switch (problem) {
         case SETTLING:
@@ -471,8 +528,8 @@ int main(int argc, char* argv[]) {
             out_fps = out_fps_pushing;
 
             // Create the granular material and the container from the checkpoint file.
-            cout << "Read checkpoint data from " << checkpoint_file;
-            utils::ReadCheckpoint(msystem, checkpoint_file);
+            cout << "Read checkpoint data from " << binary_checkpoint_file;
+            ReadSystemCheckpoint(msystem, binary_checkpoint_file, checkpoint_file);
             cout << "  done.  Read " << msystem->Get_bodylist().size() << " bodies." << endl;
 
             // Create the mechanism with the wheel just above the granular material.
@@ -480,6 +537,20 @@ int main(int argc, char* argv[]) {
             FindRange(msystem, lowest, highest);
             cout << "Create mechanism above height " << highest + r_g << endl;
             mech = new Mechanism(msystem, highest + r_g);
+
+            // Keep only the particles which the wheel can reach
+            if (rig_only) {
+                ChVector<> bmin, bmax;
+                mech->GetWheelBounds(bmin, bmax);
+                bmax.x() += init_vel * time_pushing;
+                bmin.z() -= rig_only_depth;
+                bmin -= ChVector<>(rig_only_margin);
+                bmax += ChVector<>(rig_only_margin);
+                int num_particles;
+                num_free_particles = FreezeOutside(msystem, bmin, bmax, num_particles);
+                cout << "Rig-only restart: " << num_free_particles << " of " << num_particles
+                     << " particles simulated (" << (100.0 * num_free_particles) / num_particles << "%)" << endl;
+            }
         }
 
         break;
@@ -545,7 +616,7 @@ int main(int argc, char* argv[]) {
             // Create a checkpoint from the current state.
             if (problem == SETTLING) {
                 cout << "             Write checkpoint data " << flush;
-                utils::WriteCheckpoint(msystem, checkpoint_file);
+                WriteSystemCheckpoint(msystem, binary_checkpoint_file, checkpoint_file);
                 cout << msystem->Get_bodylist().size() << " bodies" << endl;
             }
 
@@ -580,8 +651,8 @@ int main(int argc, char* argv[]) {
 
     // Create a checkpoint from the last state
     if (problem == SETTLING) {
-        cout << "Write checkpoint data to " << checkpoint_file;
-        utils::WriteCheckpoint(msystem, checkpoint_file);
+        cout << "Write checkpoint data to " << binary_checkpoint_file;
+        WriteSystemCheckpoint(msystem, binary_checkpoint_file, checkpoint_file);
         cout << "  done.  Wrote " << msystem->Get_bodylist().size() << " bodies." << endl;
     }
 
@@ -591,5 +662,25 @@ int main(int argc, char* argv[]) {
     cout << "Simulation time:   " << exec_time << endl;
     cout << "Number of threads: " << threads << endl;
 
+    // Pushing trials: record the time per step of a full-bed trial, and compare a rig-only trial against it
+    if (problem == PUSHING && sim_frame > 0) {
+        double step_time = exec_time / sim_frame;
+        if (!rig_only) {
+            ChStreamOutAsciiFile tfile(full_timing_file.c_str());
+            tfile << step_time << "  " << sim_frame << "\n";
+        } else {
+            cout << "Simulated particles: " << num_free_particles << endl;
+            double full_step_time = 0;
+            std::ifstream tfile(full_timing_file);
+            if (tfile >> full_step_time && full_step_time > 0) {
+                cout << "Time per step:     " << step_time << " (full bed: " << full_step_time << ")" << endl;
+                cout << "Speedup:           " << full_step_time / step_time << endl;
+            } else {
+                cout << "Time per step:     " << step_time << " (no full-bed trial recorded in " << full_timing_file
+                     << ")" << endl;
+            }
+        }
+    }
+
     return 0;
 }
@@ -21,6 +21,7 @@
 
 #include <cmath>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <fstream>
 #include <string>
@@ -40,40 +41,13 @@
 #include "chrono_opengl/ChOpenGLWindow.h"
 #endif
 
-using namespace chrono;
-
-// --------------------------------------------------------------------------
-
-void TimingHeader() {
-    printf("    TIME    |");
-    printf("    STEP |");
-    printf("   BROAD |");
-    printf("  NARROW |");
-    printf("  SOLVER |");
-    printf("  UPDATE |");
-    printf("# BODIES |");
-    printf("# CONTACT|");
-    printf(" # ITERS |");
-    printf("\n\n");
-}
-
-void TimingOutput(chrono::ChSystem* mSys) {
-    double TIME = mSys->GetChTime();
-    double STEP = mSys->GetTimerStep();
-    double BROD = mSys->GetTimerCollisionBroad();
-    double NARR = mSys->GetTimerCollisionNarrow();
-    double SOLVER = mSys->GetTimerAdvance();
-    double UPDT = mSys->GetTimerUpdate();
-    int REQ_ITS = 0;
-    int BODS = mSys->GetNbodies();
-    int CNTC = mSys->GetNcontacts();
-    if (dynamic_cast<chrono::ChSystemMulticore*>(mSys)) {
-        REQ_ITS = std::static_pointer_cast<chrono::ChIterativeSolverMulticore>(mSys->GetSolver())->GetIterations();
-    }
+#include "../adaptive_step.h"
+#include "../numa_affinity.h"
+#include "../parallel_samplers.h"
+#include "../thread_autotuner.h"
+#include "../timing_recorder.h"
 
-    printf("   %8.5f | %7.4f | %7.4f | %7.4f | %7.4f | %7.4f | %7d | %7d | %7d |\n", TIME, STEP, BROD, NARR,
-           SOLVER, UPDT, BODS, CNTC, REQ_ITS);
-}
+using namespace chrono;
 
 // --------------------------------------------------------------------------
 
@@ -83,13 +57,26 @@ int main(int argc, char** argv) {
     bool use_mat_properties = true;
     bool render = false;
     bool track_granule = false;
+    bool tune_threads = false;
+    bool adaptive_step = false;  // adaptive step size (SMC only), between time_step / 4 and 4 * time_step
 
-    // Get number of threads from arguments (if specified)
+    // Get number of threads from arguments (if specified; "auto" to select it with the autotuner)
     if (argc > 1) {
-        num_threads = std::stoi(argv[1]);
+        if (std::string(argv[1]) == "auto")
+            tune_threads = true;
+        else
+            num_threads = std::stoi(argv[1]);
+    }
+
+    // Get thread pinning mode from arguments (if specified; none, compact, or scatter)
+    numa_affinity::Pinning pinning = numa_affinity::Pinning::NONE;
+    if (argc > 2) {
+        pinning = numa_affinity::ParsePinning(argv[2]);
     }
 
     std::cout << "Requested number of threads: " << num_threads << std::endl;
+    std::cout << "Thread pinning: " << numa_affinity::GetPinningName(pinning) << " (" << numa_affinity::GetNumNodes()
+              << " NUMA nodes)" << std::endl;
 
     // ----------------
     // Model parameters
@@ -244,8 +231,9 @@ int main(int argc, char** argv) {
     // ----------------
 
     // Create a particle generator and a mixture entirely made out of spheres
+    // (parallel Poisson-disk sampler, with a fixed seed for reproducible beds)
     double r = 1.01 * radius_g;
-    utils::PDSampler<double> sampler(2 * r);
+    ParallelPDSampler<double> sampler(2 * r, 1);
     utils::Generator gen(system);
     std::shared_ptr<utils::MixtureIngredient> m1 = gen.AddMixtureIngredient(utils::MixtureType::SPHERE, 1.0);
     m1->setDefaultMaterial(material_terrain);
@@ -259,13 +247,24 @@ int main(int argc, char** argv) {
     ChVector<> hdims(hdimX - r, hdimY - r, 0);
     ChVector<> center(0, 0, 2 * r);
 
+    ChTimer<double> timer_generate;
+    timer_generate.start();
     for (int il = 0; il < num_layers; il++) {
         gen.CreateObjectsBox(sampler, center, hdims);
         center.z() += 2 * r;
     }
+    timer_generate.stop();
 
     unsigned int num_particles = gen.getTotalNumBodies();
     std::cout << "Generated particles:  " << num_particles << std::endl;
+    std::cout << "Generation time [s]:  " << timer_generate.GetTimeSeconds() << std::endl;
+
+    // If requested, select the number of threads from measured step times (or from a previous run)
+    std::unique_ptr<ThreadAutotuner> tuner;
+    if (tune_threads) {
+        tuner = std::unique_ptr<ThreadAutotuner>(new ThreadAutotuner("MCORE_settling", num_particles));
+        tuner->Initialize(system);
+    }
 
     // If tracking a granule (roughly in the "middle of the pack"),
     // grab a pointer to the tracked body and open an output file.
@@ -312,12 +311,32 @@ int main(int argc, char** argv) {
     double cum_solver_time = 0;
     double cum_update_time = 0;
 
-    TimingHeader();
+    // With thread pinning, compare the step times over a window of steps before and after pinning
+    // (once the number of threads is final).
+    int pinning_window = 200;
+    int pinning_steps = 0;
+    double unpinned_time = 0;
+    double pinned_time = 0;
+
+    // Per-step timers (convert to CSV with test_MCORE_timing_csv)
+    TimingRecorder timing("../settling_timing.bin");
+
+    // Adaptive step size controller (the system has no state beyond the bodies, so rejected steps can be rolled back)
+    std::unique_ptr<AdaptiveStepController> stepper;
+    if (adaptive_step && method == ChContactMethod::SMC) {
+        stepper = std::unique_ptr<AdaptiveStepController>(
+            new AdaptiveStepController(radius_g, time_step / 4, 4 * time_step, time_step));
+    }
 
     while (system->GetChTime() < time_end) {
-        system->DoStepDynamics(time_step);
+        if (stepper)
+            stepper->DoStep(system);
+        else
+            system->DoStepDynamics(time_step);
+        if (tuner)
+            tuner->Advance(system);
 
-        TimingOutput(system);
+        timing.Record(system);
 
         cum_sim_time += system->GetTimerStep();
         cum_broad_time += system->GetTimerCollisionBroad();
@@ -325,6 +344,18 @@ int main(int argc, char** argv) {
         cum_solver_time += system->GetTimerAdvance();
         cum_update_time += system->GetTimerUpdate();
 
+        if (pinning != numa_affinity::Pinning::NONE && (!tuner || tuner->IsDone())) {
+            if (pinning_steps < pinning_window)
+                unpinned_time += system->GetTimerStep();
+            else if (pinning_steps < 2 * pinning_window)
+                pinned_time += system->GetTimerStep();
+            if (++pinning_steps == pinning_window) {
+                int threads = tuner ? tuner->GetNumThreads() : num_threads;
+                if (!SetNumThreadsNUMA(system, threads, pinning))
+                    std::cout << "Thread pinning not available" << std::endl;
+            }
+        }
+
         if (track_granule) {
             assert(outf.is_open());
             assert(granule);
@@ -357,5 +388,20 @@ int main(int argc, char** argv) {
     std::cout << "    Update:      " << cum_update_time << std::endl;
     std::cout << std::endl;
 
+    if (stepper) {
+        stepper->PrintSummary();
+        stepper->WriteHistory("../settling_steps.csv");
+        std::cout << std::endl;
+    }
+
+    if (pinning_steps >= 2 * pinning_window) {
+        std::cout << "Average step time over " << pinning_window << " steps" << std::endl;
+        std::cout << "    Unpinned:    " << 1e3 * unpinned_time / pinning_window << " ms" << std::endl;
+        std::cout << "    Pinned (" << numa_affinity::GetPinningName(pinning)
+                  << "): " << 1e3 * pinned_time / pinning_window << " ms" << std::endl;
+        std::cout << "    Speedup:     " << unpinned_time / pinned_time << std::endl;
+        std::cout << std::endl;
+    }
+
     return 0;
 }
\ No newline at end of file
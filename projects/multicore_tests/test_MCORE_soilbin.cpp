@@ -33,6 +33,12 @@
 
 #include "chrono_thirdparty/filesystem/path.h"
 
+#include "../binary_checkpoint.h"
+#include "../frame_exporter.h"
+#include "../parallel_samplers.h"
+#include "../particle_sleeping.h"
+#include "../thread_autotuner.h"
+
 using namespace chrono;
 using namespace chrono::collision;
 
@@ -61,9 +67,19 @@ ProblemType problem = DROPPING;
 // Desired number of OpenMP threads (will be clamped to maximum available)
 int threads = 100;
 
-// Perform dynamic tuning of number of threads?
+// Select the number of threads from measured step times (see thread_autotuner.h)?
 bool thread_tuning = true;
 
+// Put settled particles to sleep (see particle_sleeping.h)?
+bool particle_sleeping = true;
+double sleep_vel_threshold = 1e-3;      // linear speed [m/s]
+double sleep_ang_vel_threshold = 1e-1;  // angular speed [rad/s]
+double sleep_force_threshold = 0.05;    // contact force variation (fraction of particle weight)
+int sleep_steps = 100;                  // number of consecutive calm steps
+
+// Seed for the particle sampler (the generated bed depends only on the seed, not on the number of threads)
+unsigned int sampler_seed = 1;
+
 // Simulation duration.
 double time_settling = 5;
 double time_dropping = 2;
@@ -88,8 +104,13 @@ const std::string out_dir = "../SOILBIN_NSC";
 #endif
 const std::string pov_dir = out_dir + "/POVRAY";
 const std::string checkpoint_file = out_dir + "/settled.dat";
+const std::string binary_checkpoint_file = out_dir + "/settled.bin";
 const std::string stats_file = out_dir + "/stats.dat";
 
+// Write the PovRay data as binary frames, asynchronously (convert with test_MCORE_frame_convert)?
+bool binary_frames = true;
+bool compress_frames = false;
+
 int out_fps_settling = 30;
 int out_fps_dropping = 60;
 
@@ -155,9 +176,9 @@ void CreateParticles(ChSystemMulticore* system) {
     mat_g->SetFriction(0.4f);
 #endif
 
-    // Create a mixture entirely made out of spheres.
+    // Create a mixture entirely made out of spheres (parallel Poisson-disk sampler, seeded for reproducible beds).
     double r = 1.01 * r_g;
-    utils::PDSampler<double> sampler(2 * r);
+    ParallelPDSampler<double> sampler(2 * r, sampler_seed);
     utils::Generator gen(system);
 
     std::shared_ptr<utils::MixtureIngredient> m1 = gen.AddMixtureIngredient(utils::MixtureType::SPHERE, 1.0);
@@ -396,8 +417,8 @@ int main(int argc, char* argv[]) {
         out_fps = out_fps_dropping;
 
         // Create the granular material and the container from the checkpoint file.
-        cout << "Read checkpoint data from " << checkpoint_file;
-        utils::ReadCheckpoint(msystem, checkpoint_file);
+        cout << "Read checkpoint data from " << binary_checkpoint_file;
+        ReadSystemCheckpoint(msystem, binary_checkpoint_file, checkpoint_file);
         cout << "  done.  Read " << msystem->Get_bodylist().size() << " bodies." << endl;
 
         // Create the falling object just above the granular material.
@@ -406,6 +427,16 @@ int main(int argc, char* argv[]) {
         CreateObject(msystem, z + r_g);
     }
 
+    // Select the number of threads (from a previous run on this host or by sampling the first steps).
+    ThreadAutotuner tuner(problem == SETTLING ? "MCORE_soilbin_settling" : "MCORE_soilbin_dropping",
+                          msystem->Get_bodylist().size());
+    if (thread_tuning)
+        tuner.Initialize(msystem);
+
+    // Automatic sleeping of settled particles (the falling object has identifier 0 and is never put to sleep).
+    ParticleSleeping sleeping(sleep_vel_threshold, sleep_ang_vel_threshold, sleep_force_threshold, sleep_steps);
+    sleeping.SetFilter([](const ChBody& body) { return body.GetIdentifier() > 0; });
+
     // Number of steps.
     int num_steps = (int)std::ceil(time_end / time_step);
     int out_steps = (int)std::ceil((1.0 / time_step) / out_fps);
@@ -419,37 +450,56 @@ int main(int argc, char* argv[]) {
     int next_out_frame = 0;
     double exec_time = 0;
     int num_contacts = 0;
+    int num_sleeping = 0;
     ChStreamOutAsciiFile sfile(stats_file.c_str());
+    FrameExporter frame_exporter(compress_frames);
 
     while (time < time_end) {
         if (sim_frame == next_out_frame) {
             char filename[100];
-            sprintf(filename, "%s/data_%03d.dat", pov_dir.c_str(), out_frame + 1);
-            utils::WriteShapesPovray(msystem, filename);
+            if (binary_frames) {
+                sprintf(filename, "%s/data_%03d.bin", pov_dir.c_str(), out_frame + 1);
+                frame_exporter.Write(msystem, filename);
+            } else {
+                sprintf(filename, "%s/data_%03d.dat", pov_dir.c_str(), out_frame + 1);
+                utils::WriteShapesPovray(msystem, filename);
+            }
 
             cout << "------------ Output frame:   " << out_frame << endl;
             cout << "             Sim frame:      " << sim_frame << endl;
             cout << "             Time:           " << time << endl;
             cout << "             Lowest point:   " << FindLowest(msystem) << endl;
             cout << "             Avg. contacts:  " << num_contacts / out_steps << endl;
+            if (particle_sleeping) {
+                cout << "             Active bodies:  " << sleeping.GetNumActive() << endl;
+                cout << "             Avg. sleeping:  " << num_sleeping / out_steps << endl;
+            }
             cout << "             Execution time: " << exec_time << endl;
 
-            sfile << time << "  " << exec_time << "  " << num_contacts / out_steps << "\n";
+            sfile << time << "  " << exec_time << "  " << num_contacts / out_steps << "  " << num_sleeping / out_steps
+                  << "\n";
 
             // Create a checkpoint from the current state.
             if (problem == SETTLING) {
                 cout << "             Write checkpoint data " << flush;
-                utils::WriteCheckpoint(msystem, checkpoint_file);
+                WriteSystemCheckpoint(msystem, binary_checkpoint_file, checkpoint_file);
                 cout << msystem->Get_bodylist().size() << " bodies" << endl;
             }
 
             out_frame++;
             next_out_frame += out_steps;
             num_contacts = 0;
+            num_sleeping = 0;
         }
 
         // Advance dynamics.
         msystem->DoStepDynamics(time_step);
+        if (thread_tuning)
+            tuner.Advance(msystem);
+        if (particle_sleeping) {
+            sleeping.Update(msystem);
+            num_sleeping += sleeping.GetNumSleeping();
+        }
 
         time += time_step;
         sim_frame++;
@@ -459,8 +509,8 @@ int main(int argc, char* argv[]) {
 
     // Create a checkpoint from the last state
     if (problem == SETTLING) {
-        cout << "Write checkpoint data to " << checkpoint_file;
-        utils::WriteCheckpoint(msystem, checkpoint_file);
+        cout << "Write checkpoint data to " << binary_checkpoint_file;
+        WriteSystemCheckpoint(msystem, binary_checkpoint_file, checkpoint_file);
         cout << "  done.  Wrote " << msystem->Get_bodylist().size() << " bodies." << endl;
     }
 
@@ -19,11 +19,18 @@
 // If available, OpenGL is used for run-time rendering. Otherwise, the
 // simulation is carried out for a pre-defined duration and output files are
 // generated for post-processing with POV-Ray.
+//
+// With the command line argument -ensemble [num_workers], a sweep of spring
+// stiffness and wheel speed is run instead, as an ensemble of single-threaded
+// systems in this process (no rendering or POV-Ray output).
 // =============================================================================
 
+#include <algorithm>
 #include <cstdio>
+#include <mutex>
 #include <vector>
 #include <cmath>
+#include <string>
 
 #include "chrono/ChConfig.h"
 #include "chrono/physics/ChLinkMotorRotationAngle.h"
@@ -34,6 +41,10 @@
 #include "chrono_multicore/physics/ChSystemMulticore.h"
 #include "chrono_multicore/solver/ChSystemDescriptorMulticore.h"
 
+#include "chrono_thirdparty/filesystem/path.h"
+
+#include "../ensemble_pool.h"
+
 // Control use of OpenGL run-time rendering
 // Note: CHRONO_OPENGL is defined in ChConfig.h
 //#undef CHRONO_OPENGL
@@ -46,6 +57,16 @@ using namespace chrono;
 using namespace chrono::collision;
 
 const char* out_folder = "../DEMO_SUSPENSION/POVRAY";
+const char* ensemble_folder = "../DEMO_SUSPENSION";
+const char* ensemble_file = "../DEMO_SUSPENSION/ensemble.csv";
+
+// Ensemble of car runs (command line argument -ensemble [num_workers]): all
+// combinations of suspension spring stiffness (scaling of the nominal spring
+// coefficients) and wheel angular speed, each member simulated with a single
+// thread in a single process.
+std::vector<double> ensemble_stiffness = {0.5, 0.75, 1.0, 1.5, 2.0};
+std::vector<double> ensemble_speed = {5, 10, 20, 40};
+double time_ensemble = 2;
 
 // =============================================================================
 // Generate postprocessing output with current system state.
@@ -124,7 +145,7 @@ class MySimpleCar {
     // Build and initialize the car, creating all bodies corresponding to
     // the various parts and adding them to the physical system - also creating
     // and adding constraints to the system.
-    MySimpleCar(ChSystemMulticoreNSC* my_system) {
+    MySimpleCar(ChSystemMulticoreNSC* my_system, double stiffness = 1, double angularSpeed = 20) {
         throttle = 0;  // initially, gas throttle is 0.
         conic_tau = 0.2;
         gear_tau = 0.3;
@@ -133,7 +154,6 @@ class MySimpleCar {
         double frontDamping = .1;
         double rearDamping = .1;
         bool useSpheres = true;
-        double angularSpeed = 20;
 
         // Create the wheel material
         auto mat = chrono_types::make_shared<ChMaterialSurfaceNSC>();
@@ -217,7 +237,7 @@ class MySimpleCar {
         link_springRF = chrono_types::make_shared<ChLinkTSDA>();
         link_springRF->Initialize(truss, spindleRF, false, ChVector<>(0.498, 0.323, 1.792965),
                                   ChVector<>(0.543, -0.047, 1.785965));
-        link_springRF->SetSpringCoefficient(167062.000);
+        link_springRF->SetSpringCoefficient(stiffness * 167062.000);
         link_springRF->SetDampingCoefficient(frontDamping);
         link_springRF->SetRestLength(0.339);
         my_system->AddLink(link_springRF);
@@ -291,7 +311,7 @@ class MySimpleCar {
         link_springLF = chrono_types::make_shared<ChLinkTSDA>();
         link_springLF->Initialize(truss, spindleLF, false, ChVector<>(-0.498, 0.323, 1.792965),
                                   ChVector<>(-0.543, -0.047, 1.785965));
-        link_springLF->SetSpringCoefficient(167062.000);
+        link_springLF->SetSpringCoefficient(stiffness * 167062.000);
         link_springLF->SetDampingCoefficient(frontDamping);
         link_springLF->SetRestLength(0.339);
         my_system->AddLink(link_springLF);
@@ -373,7 +393,7 @@ class MySimpleCar {
         link_springRB = chrono_types::make_shared<ChLinkTSDA>();
         link_springRB->Initialize(truss, spindleRB, false, ChVector<>(0.498, 0.323, -1.79297),
                                   ChVector<>(0.544, -0.038, -1.78597));
-        link_springRB->SetSpringCoefficient(369149.000);
+        link_springRB->SetSpringCoefficient(stiffness * 369149.000);
         link_springRB->SetDampingCoefficient(rearDamping);
         link_springRB->SetRestLength(0.382);
         my_system->AddLink(link_springRB);
@@ -455,7 +475,7 @@ class MySimpleCar {
         link_springLB = chrono_types::make_shared<ChLinkTSDA>();
         link_springLB->Initialize(truss, spindleLB, false, ChVector<>(-0.498, 0.323, -1.79297),
                                   ChVector<>(-0.544, -0.038, -1.78597));
-        link_springLB->SetSpringCoefficient(369149.000);
+        link_springLB->SetSpringCoefficient(stiffness * 369149.000);
         link_springLB->SetDampingCoefficient(rearDamping);
         link_springLB->SetRestLength(0.382);
         my_system->AddLink(link_springLB);
@@ -647,20 +667,9 @@ void AddGround(ChSystemMulticoreNSC* sys) {
 }
 
 // -----------------------------------------------------------------------------
-// Create the system, specify simulation parameters, and run simulation loop.
+// Specify the solver settings and the number of threads.
 // -----------------------------------------------------------------------------
-int main(int argc, char* argv[]) {
-    int threads = 16;
-
-    // Simulation parameters
-    // ---------------------
-
-    double gravity = 9.81;
-    double time_step = 1e-3;
-    double time_end = 10;
-
-    double out_fps = 60;
-
+void SetupSystem(ChSystemMulticoreNSC& msystem, int threads) {
     // Solver settings
     int max_iteration_normal = 0;
     int max_iteration_sliding = 10000;
@@ -671,20 +680,13 @@ int main(int argc, char* argv[]) {
     double bilateral_clamp_speed = 10e30;
     double tolerance = 1e-2;
 
-    // Create system
-    // -------------
-
-    ChSystemMulticoreNSC msystem;
+    double gravity = 9.81;
 
     // Set gravitational acceleration
     msystem.Set_G_acc(ChVector<>(0, -gravity, 0));
 
     // Set number of threads.
-    int max_threads = omp_get_num_procs();
-    if (threads > max_threads)
-        threads = max_threads;
     msystem.SetNumThreads(threads);
-    std::cout << "Using " << threads << " threads" << std::endl;
 
     // Edit system settings
     msystem.GetSettings()->solver.tolerance = tolerance;
@@ -702,6 +704,104 @@ int main(int argc, char* argv[]) {
 
     msystem.GetSettings()->collision.collision_envelope = 0.01;
     msystem.GetSettings()->collision.bins_per_axis = vec3(10, 10, 10);
+}
+
+// -----------------------------------------------------------------------------
+// Run the ensemble of car simulations.
+// -----------------------------------------------------------------------------
+int RunEnsemble(int num_workers, double time_step) {
+    struct Member {
+        double stiffness;
+        double speed;
+        double travel;      // final forward position of the truss
+        double height;      // final height of the truss
+        double min_height;  // minimum height of the truss
+    };
+    std::vector<Member> members;
+    for (auto stiffness : ensemble_stiffness)
+        for (auto speed : ensemble_speed)
+            members.push_back({stiffness, speed, 0, 0, 0});
+
+    int num_steps = (int)std::ceil(time_ensemble / time_step);
+
+    if (!filesystem::create_directory(filesystem::path(ensemble_folder))) {
+        std::cout << "Error creating directory " << ensemble_folder << std::endl;
+        return 1;
+    }
+
+    EnsemblePool pool(num_workers);
+    std::cout << "Run " << members.size() << " ensemble members on " << pool.GetNumWorkers() << " workers"
+              << std::endl;
+
+    double wall_time = pool.Run((int)members.size(), [&](int i, int) {
+        Member& m = members[i];
+        std::unique_lock<std::mutex> lock(pool.GetSetupMutex());
+        ChSystemMulticoreNSC msystem;
+        SetupSystem(msystem, 1);
+        AddGround(&msystem);
+        MySimpleCar car(&msystem, m.stiffness, m.speed);
+        lock.unlock();
+
+        m.min_height = car.truss->GetPos().y();
+        for (int is = 0; is < num_steps; is++) {
+            msystem.DoStepDynamics(time_step);
+            m.min_height = std::min(m.min_height, car.truss->GetPos().y());
+        }
+        m.travel = car.truss->GetPos().z();
+        m.height = car.truss->GetPos().y();
+    });
+
+    const auto& times = pool.GetMemberTimes();
+    utils::CSV_writer csv(",");
+    csv << "stiffness"
+        << "speed"
+        << "travel"
+        << "height"
+        << "min_height"
+        << "wall_time" << std::endl;
+    for (size_t i = 0; i < members.size(); i++) {
+        const Member& m = members[i];
+        csv << m.stiffness << m.speed << m.travel << m.height << m.min_height << times[i] << std::endl;
+    }
+    csv.write_to_file(ensemble_file);
+
+    std::cout << "Ensemble members: " << members.size() << std::endl;
+    std::cout << "Stolen members: " << pool.GetNumStolen() << std::endl;
+    std::cout << "Wall-clock time: " << wall_time << std::endl;
+    std::cout << "Steps per second: " << (members.size() * num_steps) / wall_time << std::endl;
+    std::cout << "Results written to " << ensemble_file << std::endl;
+
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+// Create the system, specify simulation parameters, and run simulation loop.
+// -----------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+    int threads = 16;
+
+    // Simulation parameters
+    // ---------------------
+
+    double time_step = 1e-3;
+    double time_end = 10;
+
+    double out_fps = 60;
+
+    if (argc > 1 && std::string(argv[1]) == "-ensemble")
+        return RunEnsemble(argc > 2 ? std::stoi(argv[2]) : 0, time_step);
+
+    // Create system
+    // -------------
+
+    ChSystemMulticoreNSC msystem;
+
+    // Set number of threads.
+    int max_threads = omp_get_num_procs();
+    if (threads > max_threads)
+        threads = max_threads;
+    SetupSystem(msystem, threads);
+    std::cout << "Using " << threads << " threads" << std::endl;
 
     // Create the fixed and moving bodies
     // ----------------------------------
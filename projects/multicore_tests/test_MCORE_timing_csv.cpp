@@ -0,0 +1,57 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Convert a binary timing file written by TimingRecorder (timing_recorder.h)
+// to CSV.
+//
+// Usage: test_MCORE_timing_csv <timing.bin> [<timing.csv>]
+// (by default, the CSV file name is obtained by replacing the extension)
+//
+// =============================================================================
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../timing_recorder.h"
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " <timing.bin> [<timing.csv>]" << std::endl;
+        return 1;
+    }
+
+    std::string bin_file(argv[1]);
+    std::string csv_file;
+    if (argc > 2) {
+        csv_file = argv[2];
+    } else {
+        size_t dot = bin_file.find_last_of('.');
+        size_t slash = bin_file.find_last_of("/\\");
+        csv_file = (dot != std::string::npos && (slash == std::string::npos || dot > slash) ? bin_file.substr(0, dot)
+                                                                                            : bin_file) +
+                   ".csv";
+    }
+
+    std::vector<TimingRecord> records;
+    if (!ReadTimingFile(bin_file, records)) {
+        std::cout << "Cannot read timing file " << bin_file << std::endl;
+        return 1;
+    }
+    if (!WriteTimingCSV(records, csv_file)) {
+        std::cout << "Cannot write " << csv_file << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << records.size() << " records to " << csv_file << std::endl;
+    return 0;
+}
@@ -13,12 +13,15 @@
 // =============================================================================
 //
 // Chrono::Multicore demo program for testing contact of a wheel shape.
+// In ENSEMBLE mode, a sweep of wheel stiffness and slip is run as an ensemble
+// of single-threaded systems in one process, all starting from the settled bed.
 //
 // The global reference frame has Z up.
 // All units SI.
 // =============================================================================
 
 #include <cstdio>
+#include <mutex>
 #include <vector>
 #include <cmath>
 
@@ -32,6 +35,8 @@
 
 #include "chrono_thirdparty/filesystem/path.h"
 
+#include "../binary_checkpoint.h"
+#include "../ensemble_pool.h"
 #include "../utils.h"
 
 using namespace chrono;
@@ -42,9 +47,11 @@ using std::endl;
 
 // =======================================================================
 // Note: Run first SETTLING phase, which generates checkpoint file
-// SIMULATION phase assumes a checkpoint file exists.
+// SIMULATION and ENSEMBLE phases assume a checkpoint file exists.
+// ENSEMBLE runs a parameter sweep of the wheel (see below) in a single process;
+// select it with the command line argument -ensemble [num_workers].
 
-enum ProblemType { SETTLING, SIMULATION };
+enum ProblemType { SETTLING, SIMULATION, ENSEMBLE };
 ProblemType problem = SETTLING;
 
 // =======================================================================
@@ -68,8 +75,21 @@ int max_iteration = 20;
 const std::string out_dir = "../WHEEL";
 const std::string pov_dir = out_dir + "/POVRAY";
 const std::string checkpoint_file = out_dir + "/settled.dat";
+const std::string binary_checkpoint_file = out_dir + "/settled.bin";
+const std::string ensemble_file = out_dir + "/ensemble.csv";
 double out_fps = 60;
 
+// Ensemble of wheel runs (ENSEMBLE problem): all combinations of wheel Young's
+// modulus and slip, each member simulated with a single thread from the
+// settled checkpoint. The wheel is released with a forward speed and with the
+// angular velocity corresponding to the prescribed slip for a nominal radius.
+std::vector<float> ensemble_Y_w = {1e7f, 3e7f, 1e8f, 3e8f};
+std::vector<double> ensemble_slip = {0.0, 0.1, 0.2, 0.3, 0.4, 0.5};
+double ensemble_speed = 1.0;
+double ensemble_r_w = 0.3;
+double time_ensemble = 1;
+int ensemble_workers = 0;  // 0: one worker per hardware thread
+
 // Contact method
 ChContactMethod method = ChContactMethod::SMC;
 
@@ -182,7 +202,7 @@ int CreateObjects(ChSystemMulticore* system) {
 // =======================================================================
 // Create the wheel body at the specified height.
 
-std::shared_ptr<ChBody> CreateWheel(ChSystemMulticore* system, double z) {
+std::shared_ptr<ChBody> CreateWheel(ChSystemMulticore* system, double z, float Y = Y_w, bool write_mesh = true) {
     // Mesh input file
     std::string obj_mesh_file = GetChronoDataFile("models/bulldozer/wheel_view.obj");
     std::string mesh_name("wheel");
@@ -193,7 +213,7 @@ std::shared_ptr<ChBody> CreateWheel(ChSystemMulticore* system, double z) {
     switch (method) {
         case ChContactMethod::SMC: {
             auto mat_w = chrono_types::make_shared<ChMaterialSurfaceSMC>();
-            mat_w->SetYoungModulus(Y_w);
+            mat_w->SetYoungModulus(Y);
             mat_w->SetFriction(mu_w);
             mat_w->SetRestitution(cr_w);
             mat_w->SetAdhesion(cohesion_w);
@@ -235,7 +255,8 @@ std::shared_ptr<ChBody> CreateWheel(ChSystemMulticore* system, double z) {
     system->AddBody(wheel);
 
     // Write POV-Ray mesh model.
-    utils::WriteMeshPovray(obj_mesh_file, mesh_name, out_dir);
+    if (write_mesh)
+        utils::WriteMeshPovray(obj_mesh_file, mesh_name, out_dir);
 
     return wheel;
 }
@@ -281,10 +302,9 @@ double FindLowest(ChSystem* sys) {
 }
 
 // ========================================================================
-int main(int argc, char* argv[]) {
-    // Set path to Chrono data
-    SetChronoDataPath(CHRONO_DATA_DIR);
+// Create the system and set the solver settings.
 
+ChSystemMulticore* CreateSystem() {
     // Create system and set method-specific solver settings
     ChSystemMulticore* system;
     switch (method) {
@@ -321,6 +341,116 @@ int main(int argc, char* argv[]) {
     system->GetSettings()->collision.bins_per_axis = vec3(50, 50, 50);
     system->GetSettings()->collision.narrowphase_algorithm = ChNarrowphase::Algorithm::HYBRID;
 
+    return system;
+}
+
+double GetTimeStep() {
+    switch (method) {
+        case ChContactMethod::SMC:
+            return time_step_penalty;
+        case ChContactMethod::NSC:
+        default:
+            return time_step_complementarity;
+    }
+}
+
+// ========================================================================
+// Run the ensemble of wheel simulations. The settled checkpoint is converted
+// once to a binary checkpoint, which all members read (memory-mapped).
+
+int RunEnsemble() {
+    if (!filesystem::path(checkpoint_file).exists()) {
+        cout << "Checkpoint file " << checkpoint_file << " not found; run the SETTLING phase first" << endl;
+        return 1;
+    }
+    {
+        ChSystemMulticore* system = CreateSystem();
+        utils::ReadCheckpoint(system, checkpoint_file);
+        WriteBinaryCheckpoint(system, binary_checkpoint_file);
+        delete system;
+    }
+
+    struct Member {
+        float Y;
+        double slip;
+        double x;      // final wheel forward position
+        double z;      // final wheel height
+        double omega;  // final wheel angular velocity
+    };
+    std::vector<Member> members;
+    for (auto Y : ensemble_Y_w)
+        for (auto slip : ensemble_slip)
+            members.push_back({Y, slip, 0, 0, 0});
+
+    double time_step = GetTimeStep();
+    int num_steps = (int)std::ceil(time_ensemble / time_step);
+
+    EnsemblePool pool(ensemble_workers);
+    cout << "Run " << members.size() << " ensemble members on " << pool.GetNumWorkers() << " workers" << endl;
+
+    double wall_time = pool.Run((int)members.size(), [&](int i, int) {
+        Member& m = members[i];
+        std::unique_lock<std::mutex> lock(pool.GetSetupMutex());
+        ChSystemMulticore* system = CreateSystem();
+        system->SetNumThreads(1);
+        ReadSystemCheckpoint(system, binary_checkpoint_file, checkpoint_file);
+
+        double z = FindHighest(system);
+        auto wheel = CreateWheel(system, z + r_g + ensemble_r_w, m.Y, false);
+        wheel->SetPos_dt(ChVector<>(ensemble_speed, 0, 0));
+        wheel->SetWvel_par(ChVector<>(0, ensemble_speed / (ensemble_r_w * (1 - m.slip)), 0));
+        lock.unlock();
+
+        system->SetStep(time_step);
+        for (int is = 0; is < num_steps; is++)
+            system->DoStepDynamics(time_step);
+
+        m.x = wheel->GetPos().x();
+        m.z = wheel->GetPos().z();
+        m.omega = wheel->GetWvel_par().y();
+        delete system;
+    });
+
+    const auto& times = pool.GetMemberTimes();
+    utils::CSV_writer csv(",");
+    csv << "Y_w"
+        << "slip"
+        << "x"
+        << "z"
+        << "omega"
+        << "wall_time" << endl;
+    double member_time = 0;
+    for (size_t i = 0; i < members.size(); i++) {
+        const Member& m = members[i];
+        csv << m.Y << m.slip << m.x << m.z << m.omega << times[i] << endl;
+        member_time += times[i];
+    }
+    csv.write_to_file(ensemble_file);
+
+    cout << "==================================" << endl;
+    cout << "Ensemble members: " << members.size() << endl;
+    cout << "Stolen members: " << pool.GetNumStolen() << endl;
+    cout << "Wall-clock time: " << wall_time << endl;
+    cout << "Member time (sum): " << member_time << endl;
+    cout << "Steps per second: " << (members.size() * num_steps) / wall_time << endl;
+    cout << "Results written to " << ensemble_file << endl;
+
+    return 0;
+}
+
+// ========================================================================
+int main(int argc, char* argv[]) {
+    // Set path to Chrono data
+    SetChronoDataPath(CHRONO_DATA_DIR);
+
+    if (argc > 1 && std::string(argv[1]) == "-ensemble") {
+        problem = ENSEMBLE;
+        if (argc > 2)
+            ensemble_workers = std::stoi(argv[2]);
+    }
+
+    ChSystemMulticore* system = CreateSystem();
+
     // Set number of threads.
     int max_threads = omp_get_num_procs();
     if (threads > max_threads)
@@ -337,6 +467,11 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    if (problem == ENSEMBLE) {
+        delete system;
+        return RunEnsemble();
+    }
+
     // Depending on problem type:
     // - Select end simulation times
     // - Create granular material and container
@@ -369,15 +504,7 @@ int main(int argc, char* argv[]) {
     }
 
     // Set integration step size
-    double time_step;
-    switch (method) {
-        case ChContactMethod::SMC:
-            time_step = time_step_penalty;
-            break;
-        case ChContactMethod::NSC:
-            time_step = time_step_complementarity;
-            break;
-    }
+    double time_step = GetTimeStep();
     system->SetStep(time_step);
 
     // Number of steps
@@ -0,0 +1,296 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// NUMA-aware thread pinning and data placement for Chrono::Multicore systems.
+//
+// ChSystemMulticore::SetNumThreads leaves the OpenMP threads unpinned, and the
+// body and contact arrays are first touched by the thread which creates the
+// bodies (i.e., all pages end up on one socket). Here:
+//   - the OpenMP threads can be pinned to the available CPUs, either compactly
+//     (filling one NUMA node before the next) or scattered (round robin over
+//     the NUMA nodes);
+//   - the pages of the large body, shape, and contact arrays are distributed
+//     over the NUMA nodes following a static partition over the threads (the
+//     same as the one of the multicore loops), i.e., as if the arrays had been
+//     first touched in parallel. Since the arrays are already populated, the
+//     pages are migrated (move_pages) rather than touched.
+//
+// The NUMA topology is read from /sys/devices/system/node. Pinning and page
+// placement are only available on Linux; elsewhere, the functions are no-ops.
+// Pinning holds as long as OpenMP reuses its thread pool, so it must be applied
+// after each change of the number of threads.
+//
+// =============================================================================
+
+#ifndef NUMA_AFFINITY_H
+#define NUMA_AFFINITY_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE (1 << 1)
+#endif
+#endif
+
+#include "chrono/parallel/ChOpenMP.h"
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+
+namespace numa_affinity {
+
+enum class Pinning {
+    NONE,     ///< threads are not pinned
+    COMPACT,  ///< fill the CPUs of one NUMA node before moving to the next
+    SCATTER   ///< distribute consecutive threads round robin over the NUMA nodes
+};
+
+inline Pinning ParsePinning(const std::string& name) {
+    if (name == "compact")
+        return Pinning::COMPACT;
+    if (name == "scatter")
+        return Pinning::SCATTER;
+    return Pinning::NONE;
+}
+
+inline const char* GetPinningName(Pinning mode) {
+    switch (mode) {
+        case Pinning::COMPACT:
+            return "compact";
+        case Pinning::SCATTER:
+            return "scatter";
+        default:
+            return "none";
+    }
+}
+
+/// NUMA topology: the CPUs (usable by this process) of each node.
+struct Topology {
+    std::vector<std::vector<int>> node_cpus;
+    std::vector<int> cpu_node;  // node of each CPU (-1 if not usable)
+};
+
+// Parse a sysfs CPU list (e.g. "0-11,24-35").
+inline std::vector<int> ParseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos)
+            end = list.size();
+        std::string range = list.substr(pos, end - pos);
+        int first, last;
+        if (sscanf(range.c_str(), "%d-%d", &first, &last) == 2) {
+            for (int c = first; c <= last; c++)
+                cpus.push_back(c);
+        } else if (sscanf(range.c_str(), "%d", &first) == 1) {
+            cpus.push_back(first);
+        }
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+inline const Topology& GetTopology() {
+    static Topology topology = []() {
+        Topology t;
+#if defined(__linux__)
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        sched_getaffinity(0, sizeof(allowed), &allowed);
+
+        for (int node = 0; node < 1024; node++) {
+            std::string filename = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+            FILE* file = fopen(filename.c_str(), "r");
+            if (!file)
+                continue;
+            char buf[4096] = {0};
+            if (!fgets(buf, sizeof(buf), file))
+                buf[0] = '\0';
+            fclose(file);
+            std::vector<int> cpus;
+            for (int c : ParseCpuList(buf)) {
+                if (c >= 0 && c < CPU_SETSIZE && CPU_ISSET(c, &allowed))
+                    cpus.push_back(c);
+            }
+            if (cpus.empty())
+                continue;
+            for (int c : cpus) {
+                if (c >= (int)t.cpu_node.size())
+                    t.cpu_node.resize(c + 1, -1);
+                t.cpu_node[c] = node;
+            }
+            t.node_cpus.push_back(cpus);
+        }
+
+        // No NUMA information: a single node with all usable CPUs
+        if (t.node_cpus.empty()) {
+            std::vector<int> cpus;
+            for (int c = 0; c < CPU_SETSIZE; c++) {
+                if (CPU_ISSET(c, &allowed))
+                    cpus.push_back(c);
+            }
+            t.cpu_node.assign(cpus.empty() ? 0 : cpus.back() + 1, -1);
+            for (int c : cpus)
+                t.cpu_node[c] = 0;
+            t.node_cpus.push_back(cpus);
+        }
+#endif
+        return t;
+    }();
+    return topology;
+}
+
+/// Return the number of NUMA nodes with CPUs usable by this process.
+inline int GetNumNodes() {
+    return (int)GetTopology().node_cpus.size();
+}
+
+/// Return the CPU assigned to each thread for the given pinning mode.
+inline std::vector<int> GetCpuOrder(Pinning mode) {
+    const auto& nodes = GetTopology().node_cpus;
+    std::vector<int> order;
+    if (mode == Pinning::COMPACT) {
+        for (const auto& cpus : nodes)
+            order.insert(order.end(), cpus.begin(), cpus.end());
+    } else if (mode == Pinning::SCATTER) {
+        for (size_t i = 0;; i++) {
+            bool any = false;
+            for (const auto& cpus : nodes) {
+                if (i < cpus.size()) {
+                    order.push_back(cpus[i]);
+                    any = true;
+                }
+            }
+            if (!any)
+                break;
+        }
+    }
+    return order;
+}
+
+/// Pin each thread of the current OpenMP thread pool (with the given number of threads) to a CPU.
+/// Return false if pinning is not available.
+inline bool PinThreads(int num_threads, Pinning mode) {
+#if defined(__linux__)
+    std::vector<int> order = GetCpuOrder(mode == Pinning::NONE ? Pinning::COMPACT : mode);
+    if (order.empty())
+        return false;
+    bool ok = true;
+#pragma omp parallel num_threads(num_threads) reduction(&& : ok)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (mode == Pinning::NONE) {
+            // Release: allow all usable CPUs
+            for (int c : order)
+                CPU_SET(c, &set);
+        } else {
+            CPU_SET(order[chrono::ChOMP::GetThreadNum() % order.size()], &set);
+        }
+        ok = sched_setaffinity(0, sizeof(set), &set) == 0;
+    }
+    return ok;
+#else
+    return false;
+#endif
+}
+
+/// Distribute the pages of an array over the NUMA nodes, following a static partition over the OpenMP threads
+/// (each thread moves the pages of its chunk to the node it is running on).
+inline void DistributeArray(const void* data, size_t bytes) {
+#if defined(__linux__) && defined(SYS_move_pages)
+    if (GetNumNodes() < 2 || !data || bytes == 0)
+        return;
+    const auto& cpu_node = GetTopology().cpu_node;
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    char* begin = (char*)((size_t)data & ~(page - 1));
+    const char* end = (const char*)data + bytes;
+    long num_pages = (long)((end - begin + page - 1) / page);
+
+#pragma omp parallel
+    {
+        int cpu = sched_getcpu();
+        int node = (cpu >= 0 && cpu < (int)cpu_node.size()) ? cpu_node[cpu] : -1;
+        std::vector<void*> pages;
+#pragma omp for schedule(static)
+        for (long ip = 0; ip < num_pages; ip++)
+            pages.push_back(begin + ip * page);
+        if (node >= 0 && !pages.empty()) {
+            std::vector<int> nodes(pages.size(), node);
+            std::vector<int> status(pages.size());
+            syscall(SYS_move_pages, 0, (unsigned long)pages.size(), pages.data(), nodes.data(), status.data(),
+                    MPOL_MF_MOVE);
+        }
+    }
+#else
+    (void)data;
+    (void)bytes;
+#endif
+}
+
+template <typename V>
+void DistributeVector(const V& v) {
+    if (!v.empty())
+        DistributeArray(v.data(), v.size() * sizeof(v[0]));
+}
+
+/// Distribute the body, collision shape, and contact arrays of a multicore system over the NUMA nodes.
+inline void DistributeMulticoreData(chrono::ChSystemMulticore* system) {
+    auto& host = system->data_manager->host_data;
+    DistributeVector(host.pos_rigid);
+    DistributeVector(host.rot_rigid);
+    DistributeVector(host.active_rigid);
+    DistributeVector(host.collide_rigid);
+    DistributeVector(host.mass_rigid);
+    DistributeVector(host.shear_neigh);
+    DistributeVector(host.shear_disp);
+    DistributeVector(host.contact_relvel_init);
+    DistributeVector(host.contact_duration);
+
+    auto& shapes = system->data_manager->cd_data->shape_data;
+    DistributeVector(shapes.id_rigid);
+    DistributeVector(shapes.typ_rigid);
+    DistributeVector(shapes.start_rigid);
+    DistributeVector(shapes.length_rigid);
+    DistributeVector(shapes.ObA_rigid);
+    DistributeVector(shapes.ObR_rigid);
+    DistributeVector(shapes.sphere_rigid);
+    DistributeVector(shapes.fam_rigid);
+
+    auto& cd = *system->data_manager->cd_data;
+    DistributeVector(cd.norm_rigid_rigid);
+    DistributeVector(cd.cpta_rigid_rigid);
+    DistributeVector(cd.cptb_rigid_rigid);
+    DistributeVector(cd.dpth_rigid_rigid);
+    DistributeVector(cd.erad_rigid_rigid);
+    DistributeVector(cd.bids_rigid_rigid);
+}
+
+}  // end namespace numa_affinity
+
+/// Set the number of threads of a multicore system, pin the threads with the given mode, and distribute the system
+/// data over the NUMA nodes. Return false if pinning was requested but is not available.
+inline bool SetNumThreadsNUMA(chrono::ChSystemMulticore* system, int num_threads, numa_affinity::Pinning mode) {
+    system->SetNumThreads(num_threads);
+    if (mode == numa_affinity::Pinning::NONE)
+        return true;
+    bool ok = numa_affinity::PinThreads(num_threads, mode);
+    numa_affinity::DistributeMulticoreData(system);
+    return ok;
+}
+
+#endif
@@ -0,0 +1,321 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Parallel point samplers for the generation of large granular beds. Both are
+// drop-in replacements for utils::PDSampler and utils::HCPSampler (and can be
+// passed to utils::Generator).
+//
+// ParallelPDSampler: Poisson-disk sampling on a background grid (cell size
+// separation/sqrt(d), at most one point per cell, d the number of non-zero
+// dimensions of the sampling volume). The grid is divided in tiles, large
+// enough that the neighbor search from one tile never reaches the tiles of the
+// same color (tile coordinates with the same parities); the colors are
+// processed in sequence and the tiles of one color in parallel. Within a tile,
+// points are generated by dart throwing followed by Bridson's algorithm, with a
+// random number generator seeded from the sampler seed, the call count, and the
+// tile index. The result is therefore deterministic for a given seed,
+// independently of the number of threads.
+//
+// ParallelHCPSampler: hexagonal close packing lattice, generated in parallel
+// over the lattice rows.
+//
+// In both cases, points are collected in per-tile (per-row) chunks which are
+// then concatenated in order into the output PointVector.
+//
+// =============================================================================
+
+#ifndef PARALLEL_SAMPLERS_H
+#define PARALLEL_SAMPLERS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "chrono/utils/ChUtilsSamplers.h"
+
+template <typename T = double>
+class ParallelPDSampler : public chrono::utils::Sampler<T> {
+  public:
+    typedef typename chrono::utils::Sampler<T>::PointVector PointVector;
+    typedef typename chrono::utils::Sampler<T>::VolumeType VolumeType;
+
+    /// Create a sampler with given minimum separation, seed, and number of attempts per active point.
+    ParallelPDSampler(T separation, unsigned int seed = 0, int attempts = 30)
+        : chrono::utils::Sampler<T>(separation), m_seed(seed), m_attempts(attempts), m_num_calls(0) {}
+
+    /// Reset the seed (and the call count; successive calls with the same seed return different point sets).
+    void SetSeed(unsigned int seed) {
+        m_seed = seed;
+        m_num_calls = 0;
+    }
+
+  private:
+    struct Domain {
+        VolumeType type;
+        T r2;                    // squared separation
+        T lo[3];                 // lower corner
+        T ext[3];                // extent
+        bool active[3];          // axes with non-zero extent
+        int dim;                 // number of active axes
+        T h;                     // cell size
+        int n[3];                // number of cells
+        int tile_cells;          // tile size (in cells)
+        int nt[3];               // number of tiles
+        int reach;               // neighbor search range (in cells)
+        std::vector<int32_t> grid;            // index of the point in each cell (in its tile), or -1
+        std::vector<PointVector> tile_points;  // points of each tile
+    };
+
+    virtual PointVector Sample(VolumeType t) override {
+        Domain d;
+        d.type = t;
+        T r = this->m_separation;
+        d.r2 = r * r;
+        d.dim = 0;
+        for (int k = 0; k < 3; k++) {
+            d.lo[k] = this->m_center[k] - this->m_size[k];
+            d.ext[k] = 2 * this->m_size[k];
+            d.active[k] = d.ext[k] > 0;
+            d.dim += d.active[k] ? 1 : 0;
+        }
+
+        PointVector out_points;
+        if (d.dim == 0) {
+            if (this->accept(t, this->m_center))
+                out_points.push_back(this->m_center);
+            return out_points;
+        }
+
+        d.h = r / std::sqrt((T)d.dim);
+        d.reach = (int)std::ceil(r / d.h);
+        d.tile_cells = std::max(2 * d.reach, 8);
+        size_t num_cells = 1;
+        size_t num_tiles = 1;
+        for (int k = 0; k < 3; k++) {
+            d.n[k] = d.active[k] ? std::max(1, (int)std::ceil(d.ext[k] / d.h)) : 1;
+            d.nt[k] = (d.n[k] + d.tile_cells - 1) / d.tile_cells;
+            num_cells *= d.n[k];
+            num_tiles *= d.nt[k];
+        }
+        d.grid.assign(num_cells, -1);
+        d.tile_points.resize(num_tiles);
+
+        // Process the tiles of each color in turn (tiles of one color in parallel)
+        uint64_t call = m_num_calls++;
+        for (int color = 0; color < 8; color++) {
+            std::vector<int> tiles;
+            for (int tz = 0; tz < d.nt[2]; tz++) {
+                for (int ty = 0; ty < d.nt[1]; ty++) {
+                    for (int tx = 0; tx < d.nt[0]; tx++) {
+                        if ((tx % 2) + 2 * (ty % 2) + 4 * (tz % 2) == color)
+                            tiles.push_back(tx + d.nt[0] * (ty + d.nt[1] * tz));
+                    }
+                }
+            }
+            int num_color_tiles = (int)tiles.size();
+#pragma omp parallel for schedule(dynamic)
+            for (int i = 0; i < num_color_tiles; i++)
+                ProcessTile(d, tiles[i], call);
+        }
+
+        // Concatenate the tile chunks in order
+        std::vector<size_t> offsets(num_tiles + 1, 0);
+        for (size_t it = 0; it < num_tiles; it++)
+            offsets[it + 1] = offsets[it] + d.tile_points[it].size();
+        out_points.resize(offsets[num_tiles]);
+        int num_tiles_i = (int)num_tiles;
+#pragma omp parallel for schedule(static)
+        for (int it = 0; it < num_tiles_i; it++)
+            std::copy(d.tile_points[it].begin(), d.tile_points[it].end(), out_points.begin() + offsets[it]);
+
+        return out_points;
+    }
+
+    static uint64_t Mix(uint64_t x) {
+        // splitmix64 finalizer
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    // Cell coordinates of a point (false if outside the grid).
+    static bool GetCell(const Domain& d, const chrono::ChVector<T>& p, int* c) {
+        for (int k = 0; k < 3; k++) {
+            if (!d.active[k]) {
+                c[k] = 0;
+                continue;
+            }
+            T x = p[k] - d.lo[k];
+            if (x < 0 || x > d.ext[k])
+                return false;
+            c[k] = std::min((int)(x / d.h), d.n[k] - 1);
+        }
+        return true;
+    }
+
+    static size_t CellIndex(const Domain& d, const int* c) {
+        return (size_t)c[0] + (size_t)d.n[0] * ((size_t)c[1] + (size_t)d.n[1] * (size_t)c[2]);
+    }
+
+    static int TileIndex(const Domain& d, const int* c) {
+        return c[0] / d.tile_cells + d.nt[0] * (c[1] / d.tile_cells + d.nt[1] * (c[2] / d.tile_cells));
+    }
+
+    // Check if a point is at least the separation distance away from all points in neighboring cells.
+    static bool IsFree(const Domain& d, const chrono::ChVector<T>& p, const int* c) {
+        int lo[3], hi[3];
+        for (int k = 0; k < 3; k++) {
+            lo[k] = std::max(c[k] - d.reach, 0);
+            hi[k] = std::min(c[k] + d.reach, d.n[k] - 1);
+        }
+        int q[3];
+        for (q[2] = lo[2]; q[2] <= hi[2]; q[2]++) {
+            for (q[1] = lo[1]; q[1] <= hi[1]; q[1]++) {
+                for (q[0] = lo[0]; q[0] <= hi[0]; q[0]++) {
+                    int32_t index = d.grid[CellIndex(d, q)];
+                    if (index < 0)
+                        continue;
+                    const chrono::ChVector<T>& other = d.tile_points[TileIndex(d, q)][index];
+                    if ((other - p).Length2() < d.r2)
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void ProcessTile(Domain& d, int tile, uint64_t call) const {
+        int tc[3] = {tile % d.nt[0], (tile / d.nt[0]) % d.nt[1], tile / (d.nt[0] * d.nt[1])};
+        int cell_lo[3], cell_hi[3];
+        T box_lo[3], box_hi[3];
+        for (int k = 0; k < 3; k++) {
+            cell_lo[k] = tc[k] * d.tile_cells;
+            cell_hi[k] = std::min(cell_lo[k] + d.tile_cells, d.n[k]) - 1;
+            box_lo[k] = d.active[k] ? d.lo[k] + cell_lo[k] * d.h : d.lo[k];
+            box_hi[k] = d.active[k] ? std::min(d.lo[k] + (cell_hi[k] + 1) * d.h, d.lo[k] + d.ext[k]) : d.lo[k];
+        }
+
+        std::mt19937_64 rng(Mix(Mix(Mix(m_seed) ^ call) ^ (uint64_t)tile));
+        std::uniform_real_distribution<T> uniform(0, 1);
+        std::normal_distribution<T> normal(0, 1);
+
+        PointVector& points = d.tile_points[tile];
+        std::vector<int> active;
+
+        auto insert = [&](const chrono::ChVector<T>& p) {
+            int c[3];
+            if (!GetCell(d, p, c))
+                return;
+            for (int k = 0; k < 3; k++) {
+                if (c[k] < cell_lo[k] || c[k] > cell_hi[k])
+                    return;
+            }
+            if (d.grid[CellIndex(d, c)] >= 0 || !this->accept(d.type, p) || !IsFree(d, p, c))
+                return;
+            d.grid[CellIndex(d, c)] = (int32_t)points.size();
+            active.push_back((int)points.size());
+            points.push_back(p);
+        };
+
+        // Initial darts, uniformly distributed in the tile
+        for (int i = 0; i < m_attempts; i++) {
+            chrono::ChVector<T> p;
+            for (int k = 0; k < 3; k++)
+                p[k] = box_lo[k] + uniform(rng) * (box_hi[k] - box_lo[k]);
+            insert(p);
+        }
+
+        // Bridson's algorithm: candidates in the annulus [r, 2r] around active points
+        T r = this->m_separation;
+        while (!active.empty()) {
+            size_t ia = (size_t)(uniform(rng) * active.size()) % active.size();
+            chrono::ChVector<T> center = points[active[ia]];
+            size_t num_points = points.size();
+            for (int i = 0; i < m_attempts; i++) {
+                chrono::ChVector<T> dir(0, 0, 0);
+                T len2 = 0;
+                for (int k = 0; k < 3; k++) {
+                    if (d.active[k]) {
+                        dir[k] = normal(rng);
+                        len2 += dir[k] * dir[k];
+                    }
+                }
+                if (len2 == 0)
+                    continue;
+                insert(center + dir * (r * (1 + uniform(rng)) / std::sqrt(len2)));
+            }
+            if (points.size() == num_points) {
+                active[ia] = active.back();
+                active.pop_back();
+            }
+        }
+    }
+
+    unsigned int m_seed;
+    int m_attempts;
+    uint64_t m_num_calls;
+};
+
+template <typename T = double>
+class ParallelHCPSampler : public chrono::utils::Sampler<T> {
+  public:
+    typedef typename chrono::utils::Sampler<T>::PointVector PointVector;
+    typedef typename chrono::utils::Sampler<T>::VolumeType VolumeType;
+
+    ParallelHCPSampler(T separation) : chrono::utils::Sampler<T>(separation) {}
+
+  private:
+    virtual PointVector Sample(VolumeType t) override {
+        T dx = this->m_separation;
+        T dy = dx * std::sqrt((T)3) / 2;
+        T dz = dx * std::sqrt((T)2 / 3);
+        chrono::ChVector<T> lo = this->m_center - this->m_size;
+
+        int nx = (int)(2 * this->m_size.x() / dx) + 1;
+        int ny = (int)(2 * this->m_size.y() / dy) + 1;
+        int nz = (int)(2 * this->m_size.z() / dz) + 1;
+
+        // Lattice rows (k, j)
+        int num_rows = ny * nz;
+        std::vector<PointVector> rows(num_rows);
+#pragma omp parallel for schedule(static)
+        for (int row = 0; row < num_rows; row++) {
+            int j = row % ny;
+            int k = row / ny;
+            // Alternate layers are shifted to the centers of the triangles of the previous layer
+            T x0 = (k % 2) * dx / 2 + (j % 2) * dx / 2;
+            T y0 = (k % 2) * dy / 3;
+            PointVector& points = rows[row];
+            points.reserve(nx);
+            for (int i = 0; i < nx; i++) {
+                chrono::ChVector<T> p = lo + chrono::ChVector<T>(x0 + i * dx, y0 + j * dy, k * dz);
+                if (this->accept(t, p))
+                    points.push_back(p);
+            }
+        }
+
+        std::vector<size_t> offsets(num_rows + 1, 0);
+        for (int row = 0; row < num_rows; row++)
+            offsets[row + 1] = offsets[row] + rows[row].size();
+        PointVector out_points(offsets[num_rows]);
+#pragma omp parallel for schedule(static)
+        for (int row = 0; row < num_rows; row++)
+            std::copy(rows[row].begin(), rows[row].end(), out_points.begin() + offsets[row]);
+
+        return out_points;
+    }
+};
+
+#endif
@@ -0,0 +1,107 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// PardisoMKL solver with reuse of the matrix factorization across integration
+// steps.
+//
+// Intended for use with ChTimestepperHHT in modified Newton mode, which calls
+// the solver Setup() once at the beginning of each step (and again if the step
+// is retried). The factorization of a previous step is kept for as long as the
+// Newton iterations converge quickly; the matrix is assembled and refactorized
+// only when:
+//   - no factorization is available, or the problem size changed,
+//   - the previous step needed more than a given number of Newton iterations,
+//   - the integrator calls Setup() again within the same step (retry).
+// The sparsity pattern is locked, so that refactorizations reuse it.
+//
+// StepCompleted() must be called after each integration step.
+//
+// =============================================================================
+
+#ifndef PARDISO_REUSE_H
+#define PARDISO_REUSE_H
+
+#include "chrono/solver/ChSystemDescriptor.h"
+#include "chrono_pardisomkl/ChSolverPardisoMKL.h"
+
+class ChSolverPardisoMKLReuse : public chrono::ChSolverPardisoMKL {
+  public:
+    /// Create the solver. A refactorization is triggered by steps with more than max_iterations Newton iterations.
+    ChSolverPardisoMKLReuse(int max_iterations = 3)
+        : m_max_iterations(max_iterations),
+          m_have_factorization(false),
+          m_refactor(true),
+          m_dim(0),
+          m_setups_this_step(0),
+          m_num_factorizations(0),
+          m_num_reuses(0),
+          m_num_steps(0),
+          m_num_iterations(0) {
+        LockSparsityPattern(true);
+    }
+
+    /// Set the number of Newton iterations per step above which the matrix is refactorized.
+    void SetMaxIterations(int max_iterations) { m_max_iterations = max_iterations; }
+
+    /// Force a refactorization at the next call to Setup().
+    void ForceRefactorization() { m_refactor = true; }
+
+    /// Notify the end of an integration step, with the number of Newton iterations it required.
+    void StepCompleted(int num_iterations) {
+        if (num_iterations > m_max_iterations)
+            m_refactor = true;
+        m_setups_this_step = 0;
+        m_num_steps++;
+        m_num_iterations += num_iterations;
+    }
+
+    virtual bool Setup(chrono::ChSystemDescriptor& sysd) override {
+        int dim = sysd.CountActiveVariables() + sysd.CountActiveConstraints();
+        bool reuse = m_have_factorization && !m_refactor && m_setups_this_step == 0 && dim == m_dim;
+        m_setups_this_step++;
+        if (reuse) {
+            m_num_reuses++;
+            return true;
+        }
+
+        m_num_factorizations++;
+        m_have_factorization = chrono::ChSolverPardisoMKL::Setup(sysd);
+        m_refactor = false;
+        m_dim = dim;
+        return m_have_factorization;
+    }
+
+    /// Number of matrix factorizations.
+    int GetNumFactorizations() const { return m_num_factorizations; }
+
+    /// Number of calls to Setup() which reused the current factorization.
+    int GetNumReuses() const { return m_num_reuses; }
+
+    /// Number of completed integration steps.
+    int GetNumSteps() const { return m_num_steps; }
+
+    /// Average number of Newton iterations per step.
+    double GetIterationsPerStep() const { return m_num_steps > 0 ? m_num_iterations / (double)m_num_steps : 0; }
+
+  private:
+    int m_max_iterations;
+    bool m_have_factorization;
+    bool m_refactor;
+    int m_dim;
+    int m_setups_this_step;
+    int m_num_factorizations;
+    int m_num_reuses;
+    int m_num_steps;
+    int m_num_iterations;
+};
+
+#endif
@@ -0,0 +1,162 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Automatic sleeping of settled particles in Chrono::Multicore DEM simulations.
+//
+// After each step, a particle is counted as calm if its linear and angular
+// speeds are below given thresholds and its contact force changed by less than
+// a given fraction of its weight since the previous step. A particle remaining
+// calm for a given number of consecutive steps is put to sleep: its velocity is
+// zeroed and it is flagged as sleeping, which makes it inactive for the
+// multicore system (excluded from the solver like a fixed body, and contacts
+// between two inactive bodies are discarded in the broadphase).
+//
+// A sleeping particle is woken up as soon as it is in contact with an awake
+// body which is not calm (i.e., a moving neighbor); waking propagates through
+// the bed over successive steps.
+//
+// Only non-fixed bodies accepted by an optional filter (e.g., particles with
+// positive identifiers) are considered. Fixed bodies and mechanism bodies are
+// never put to sleep.
+//
+// =============================================================================
+
+#ifndef PARTICLE_SLEEPING_H
+#define PARTICLE_SLEEPING_H
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+
+class ParticleSleeping {
+  public:
+    /// Create a sleep manager with given linear speed, angular speed, and relative contact force variation thresholds,
+    /// and the number of consecutive calm steps after which a particle goes to sleep.
+    ParticleSleeping(double vel_threshold, double ang_vel_threshold, double force_threshold, int num_steps)
+        : m_vel2(vel_threshold * vel_threshold),
+          m_ang_vel2(ang_vel_threshold * ang_vel_threshold),
+          m_force(force_threshold),
+          m_num_steps(num_steps),
+          m_num_sleeping(0),
+          m_num_active(0),
+          m_num_asleep(0),
+          m_num_woken(0) {}
+
+    /// Set a filter for the bodies which can be put to sleep (default: all non-fixed bodies).
+    void SetFilter(std::function<bool(const chrono::ChBody&)> filter) { m_filter = filter; }
+
+    /// Update the sleeping states. Must be called after each step.
+    void Update(chrono::ChSystemMulticore* system) {
+        using namespace chrono;
+
+        const auto& bodies = system->Get_bodylist();
+        int num_bodies = (int)bodies.size();
+        if ((int)m_calm_steps.size() != num_bodies) {
+            m_calm_steps.assign(num_bodies, 0);
+            m_force_prev.assign(num_bodies, ChVector<>(0, 0, 0));
+            m_candidate.assign(num_bodies, 0);
+            m_calm.assign(num_bodies, 0);
+            for (int i = 0; i < num_bodies; i++)
+                m_candidate[i] = !bodies[i]->GetBodyFixed() && (!m_filter || m_filter(*bodies[i]));
+        }
+
+        system->CalculateContactForces();
+        double g = system->Get_G_acc().Length();
+
+        // Calm state of all bodies (fixed bodies are calm, awake non-candidates are not)
+        int num_sleeping = 0;
+        int num_asleep = 0;
+#pragma omp parallel for schedule(static) reduction(+ : num_sleeping, num_asleep)
+        for (int i = 0; i < num_bodies; i++) {
+            const auto& body = bodies[i];
+            if (!m_candidate[i]) {
+                m_calm[i] = body->GetBodyFixed();
+                continue;
+            }
+            if (body->GetSleeping()) {
+                m_calm[i] = 1;
+                num_sleeping++;
+                continue;
+            }
+            real3 f = system->GetBodyContactForce(i);
+            ChVector<> force(f.x, f.y, f.z);
+            bool calm = body->GetPos_dt().Length2() < m_vel2 && body->GetWvel_loc().Length2() < m_ang_vel2 &&
+                        (force - m_force_prev[i]).Length() < m_force * body->GetMass() * g;
+            m_force_prev[i] = force;
+            m_calm[i] = calm;
+            m_calm_steps[i] = calm ? m_calm_steps[i] + 1 : 0;
+            if (m_calm_steps[i] >= m_num_steps) {
+                body->SetSleeping(true);
+                body->SetPos_dt(ChVector<>(0, 0, 0));
+                body->SetWvel_loc(ChVector<>(0, 0, 0));
+                num_asleep++;
+                num_sleeping++;
+            }
+        }
+
+        // Wake up sleeping bodies in contact with a moving body
+        int num_woken = 0;
+        const auto& bids = system->data_manager->cd_data->bids_rigid_rigid;
+        int num_contacts = (int)system->data_manager->cd_data->num_rigid_contacts;
+        for (int ic = 0; ic < num_contacts; ic++) {
+            int a = bids[ic].x;
+            int b = bids[ic].y;
+            for (int k = 0; k < 2; k++) {
+                if (m_candidate[a] && bodies[a]->GetSleeping() && !m_calm[b]) {
+                    bodies[a]->SetSleeping(false);
+                    m_calm_steps[a] = 0;
+                    m_force_prev[a] = ChVector<>(0, 0, 0);
+                    num_woken++;
+                }
+                std::swap(a, b);
+            }
+        }
+
+        m_num_sleeping = num_sleeping - num_woken;
+        m_num_active = num_bodies - m_num_sleeping;
+        m_num_asleep = num_asleep;
+        m_num_woken = num_woken;
+    }
+
+    /// Return the number of sleeping bodies (after the last update).
+    int GetNumSleeping() const { return m_num_sleeping; }
+
+    /// Return the number of bodies not sleeping (including fixed bodies).
+    int GetNumActive() const { return m_num_active; }
+
+    /// Return the number of bodies put to sleep in the last update.
+    int GetNumPutToSleep() const { return m_num_asleep; }
+
+    /// Return the number of bodies woken up in the last update.
+    int GetNumWoken() const { return m_num_woken; }
+
+  private:
+    double m_vel2;
+    double m_ang_vel2;
+    double m_force;
+    int m_num_steps;
+    std::function<bool(const chrono::ChBody&)> m_filter;
+
+    std::vector<int> m_calm_steps;                 // consecutive calm steps of each body
+    std::vector<chrono::ChVector<>> m_force_prev;  // contact force at previous step
+    std::vector<char> m_candidate;                 // body can be put to sleep
+    std::vector<char> m_calm;                      // body is calm at current step
+
+    int m_num_sleeping;
+    int m_num_active;
+    int m_num_asleep;
+    int m_num_woken;
+};
+
+#endif
@@ -14,15 +14,34 @@
 //
 // Test program for collision with contact hulls
 //
+// The container is built from boxes, meshes, convex hulls, or the convex
+// decomposition of its (concave) mesh. Hulls and decompositions are obtained
+// through a persistent cache (see hull_cache.h).
+//
+// Usage:
+//   test_CH_contact_hulls [boxes|meshes|hulls|decomposition]
+//       interactive run with the given container (default: hulls)
+//   test_CH_contact_hulls -benchmark [num_steps]
+//       collision throughput of all container representations, without
+//       visualization
+//
 // =============================================================================
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+
 #include "chrono/ChConfig.h"
+#include "chrono/core/ChTimer.h"
 #include "chrono/physics/ChSystemSMC.h"
 #include "chrono/collision/ChCollisionUtils.h"
 #include "chrono/collision/ChCollisionUtilsBullet.h"
 
 #include "chrono_irrlicht/ChIrrApp.h"
 
+#include "hull_cache.h"
+
 using namespace chrono;
 using namespace chrono::irrlicht;
 
@@ -113,7 +132,8 @@ void AddWallMesh(std::shared_ptr<ChBody> body,
 void AddWallHull(std::shared_ptr<ChBody> body,
                  std::shared_ptr<ChMaterialSurface> mat,
                  const ChVector<>& dim,
-                 const ChVector<>& loc) {
+                 const ChVector<>& loc,
+                 ConvexHullCache& cache) {
     std::vector<ChVector<>> points;
 
     points.push_back(ChVector<>(-dim.x(), -dim.y(), -dim.z()) + loc);
@@ -125,16 +145,51 @@ void AddWallHull(std::shared_ptr<ChBody> body,
     points.push_back(ChVector<>(+dim.x(), +dim.y(), +dim.z()) + loc);
     points.push_back(ChVector<>(+dim.x(), -dim.y(), +dim.z()) + loc);
 
-    body->GetCollisionModel()->AddConvexHull(mat, points);
+    auto hull = cache.GetHull(points);
+    body->GetCollisionModel()->AddConvexHull(mat, hull->vertices);
 
     auto shape = chrono_types::make_shared<ChTriangleMeshShape>();
-    collision::bt_utils::ChConvexHullLibraryWrapper lh;
-    lh.ComputeHull(points, *shape->GetMesh());
+    shape->SetMesh(hull->GetMesh());
     body->AddAsset(shape);
 
     body->AddAsset(chrono_types::make_shared<ChColorAsset>(0.5f, 0.0f, 0.0f));
 }
 
+// Watertight mesh of the container (bottom and side walls, as one L-shaped prism extruded along Z)
+std::shared_ptr<geometry::ChTriangleMeshConnected> CreateContainerMesh(double hdimX,
+                                                                       double hdimY,
+                                                                       double hdimZ,
+                                                                       double hthick) {
+    auto trimesh = chrono_types::make_shared<geometry::ChTriangleMeshConnected>();
+    std::vector<ChVector<> >& vertices = trimesh->getCoordsVertices();
+    std::vector<ChVector<int> >& idx_vertices = trimesh->getIndicesVertexes();
+
+    // L-shaped section in the XY plane (counter-clockwise)
+    double px[6] = {-hdimX, hdimX, hdimX, hdimX - 2 * hthick, hdimX - 2 * hthick, -hdimX};
+    double py[6] = {-hthick, -hthick, 2 * hdimZ, 2 * hdimZ, hthick, hthick};
+    for (int i = 0; i < 6; i++)
+        vertices.push_back(ChVector<>(px[i], py[i], -hdimY));
+    for (int i = 0; i < 6; i++)
+        vertices.push_back(ChVector<>(px[i], py[i], +hdimY));
+
+    // End caps (fans from the reflex vertex 4)
+    for (int i = 0; i < 4; i++) {
+        int a = (5 + i) % 6;
+        int b = (6 + i) % 6;
+        idx_vertices.push_back(ChVector<int>(4, b, a));
+        idx_vertices.push_back(ChVector<int>(10, 6 + a, 6 + b));
+    }
+
+    // Sides
+    for (int i = 0; i < 6; i++) {
+        int j = (i + 1) % 6;
+        idx_vertices.push_back(ChVector<int>(i, j, 6 + j));
+        idx_vertices.push_back(ChVector<int>(i, 6 + j, 6 + i));
+    }
+
+    return trimesh;
+}
+
 void BuildContainerBoxes(std::shared_ptr<ChBody> body,
                          std::shared_ptr<ChMaterialSurface> mat,
                          double hdimX,
@@ -178,27 +233,59 @@ void BuildContainerHulls(std::shared_ptr<ChBody> body,
                          double hdimX,
                          double hdimY,
                          double hdimZ,
-                         double hthick) {
+                         double hthick,
+                         ConvexHullCache& cache) {
   std::cout << "Using convex hulls for container" << std::endl;
 
   body->GetCollisionModel()->ClearModel();
 
   // Bottom hull
-  AddWallHull(body, mat, ChVector<>(hdimX, hthick, hdimY), ChVector<>(0, 0, 0));
+  AddWallHull(body, mat, ChVector<>(hdimX, hthick, hdimY), ChVector<>(0, 0, 0), cache);
 
   // Side hull
-  AddWallHull(body, mat, ChVector<>(hthick, hdimZ, hdimY), ChVector<>(hdimX - hthick, hdimZ, 0));
+  AddWallHull(body, mat, ChVector<>(hthick, hdimZ, hdimY), ChVector<>(hdimX - hthick, hdimZ, 0), cache);
 
   body->GetCollisionModel()->BuildModel();
 }
 
+void BuildContainerDecomposition(std::shared_ptr<ChBody> body,
+                                 std::shared_ptr<ChMaterialSurface> mat,
+                                 double hdimX,
+                                 double hdimY,
+                                 double hdimZ,
+                                 double hthick,
+                                 ConvexHullCache& cache) {
+  std::cout << "Using convex decomposition for container" << std::endl;
 
-int main(int argc, char* argv[]) {
-  SetChronoDataPath(CHRONO_DATA_DIR);
-  
-  // Simulation parameters
+  body->GetCollisionModel()->ClearModel();
+
+  auto trimesh = CreateContainerMesh(hdimX, hdimY, hdimZ, hthick);
+  ConvexDecompositionParams params;
+  params.max_hull_count = 8;
+  params.concavity = 0.01f;
+  auto hulls = cache.GetDecomposition(*trimesh, params);
+  std::cout << "  " << hulls.size() << " convex hulls" << std::endl;
+
+  for (const auto& hull : hulls) {
+    body->GetCollisionModel()->AddConvexHull(mat, hull->vertices);
+
+    auto shape = chrono_types::make_shared<ChTriangleMeshShape>();
+    shape->SetMesh(hull->GetMesh());
+    body->AddAsset(shape);
+  }
+  body->AddAsset(chrono_types::make_shared<ChColorAsset>(0.0f, 0.5f, 0.0f));
+
+  body->GetCollisionModel()->BuildModel();
+}
+
+// =============================================================================
+
+enum class ContainerType { BOXES, MESHES, HULLS, DECOMPOSITION };
+const char* container_names[] = {"boxes", "meshes", "hulls", "decomposition"};
+
+// Create the falling ball(s) and the container. Additional (smaller) balls are placed in a grid above the bottom.
+void CreateModel(ChSystemSMC& msystem, ContainerType type, ConvexHullCache& cache, int num_extra_balls) {
     double gravity = -9.81;
-    double time_step = 1e-4;
 
     // Parameters for the falling ball
     int ballId = 100;
@@ -215,14 +302,12 @@ int main(int argc, char* argv[]) {
     double hdimZ = 1;
     double hthick = 0.2;
 
-    // Create the system (Y up)
-    ChSystemSMC msystem;
     msystem.Set_G_acc(ChVector<>(0, gravity, 0));
 
     msystem.SetContactForceModel(ChSystemSMC::ContactForceModel::Hertz);
     msystem.SetAdhesionForceModel(ChSystemSMC::AdhesionForceModel::Constant);
 
-    // Create a material (will be used by both objects)
+    // Create a material (will be used by all objects)
     auto material = chrono_types::make_shared<ChMaterialSurfaceSMC>();
     material->SetYoungModulus(1.0e7f);
     material->SetRestitution(0.1f);
@@ -255,6 +340,30 @@ int main(int argc, char* argv[]) {
 
     msystem.AddBody(ball);
 
+    // Additional balls
+    double r_extra = 0.15;
+    double m_extra = 10;
+    int nx = (int)std::ceil(std::sqrt((double)num_extra_balls));
+    for (int i = 0; i < num_extra_balls; i++) {
+        auto extra = chrono_types::make_shared<ChBody>();
+        extra->SetIdentifier(ballId + 1 + i);
+        extra->SetMass(m_extra);
+        extra->SetInertiaXX(0.4 * m_extra * r_extra * r_extra * ChVector<>(1, 1, 1));
+        double x = -hdimX + 3 * r_extra + (i % nx) * (2 * hdimX - 2 * hthick - 6 * r_extra) / std::max(nx - 1, 1);
+        double z = -hdimY + 3 * r_extra + (i / nx) * (2 * hdimY - 6 * r_extra) / std::max(nx - 1, 1);
+        extra->SetPos(ChVector<>(x, hthick + 2 * r_extra, z));
+        extra->SetCollide(true);
+        extra->GetCollisionModel()->ClearModel();
+        extra->GetCollisionModel()->AddSphere(material, r_extra);
+        extra->GetCollisionModel()->BuildModel();
+
+        auto extra_sphere = chrono_types::make_shared<ChSphereShape>();
+        extra_sphere->GetSphereGeometry().rad = r_extra;
+        extra->AddAsset(extra_sphere);
+
+        msystem.AddBody(extra);
+    }
+
     // Create container
     auto bin = chrono_types::make_shared<ChBody>();
 
@@ -265,11 +374,98 @@ int main(int argc, char* argv[]) {
     bin->SetCollide(true);
     bin->SetBodyFixed(true);
 
-    //BuildContainerBoxes(bin, material, hdimX, hdimY, hdimZ, hthick);
-    //BuildContainerMeshes(bin, material, hdimX, hdimY, hdimZ, hthick);
-    BuildContainerHulls(bin, material, hdimX, hdimY, hdimZ, hthick);
+    switch (type) {
+        case ContainerType::BOXES:
+            BuildContainerBoxes(bin, material, hdimX, hdimY, hdimZ, hthick);
+            break;
+        case ContainerType::MESHES:
+            BuildContainerMeshes(bin, material, hdimX, hdimY, hdimZ, hthick);
+            break;
+        case ContainerType::HULLS:
+            BuildContainerHulls(bin, material, hdimX, hdimY, hdimZ, hthick, cache);
+            break;
+        case ContainerType::DECOMPOSITION:
+            BuildContainerDecomposition(bin, material, hdimX, hdimY, hdimZ, hthick, cache);
+            break;
+    }
 
     msystem.AddBody(bin);
+}
+
+// Collision throughput of all container representations (same bodies, same number of steps).
+void Benchmark(int num_steps, ConvexHullCache& cache) {
+    double time_step = 1e-4;
+    int num_extra_balls = 50;
+
+    struct Result {
+        double build;
+        double collision;
+        double step;
+        int contacts;
+    };
+    std::vector<Result> results;
+
+    for (int t = 0; t < 4; t++) {
+        ChSystemSMC msystem;
+        ChTimer<double> timer;
+        timer.start();
+        CreateModel(msystem, static_cast<ContainerType>(t), cache, num_extra_balls);
+        timer.stop();
+
+        Result res = {timer(), 0, 0, 0};
+        timer.reset();
+        timer.start();
+        for (int i = 0; i < num_steps; i++) {
+            msystem.DoStepDynamics(time_step);
+            res.collision += msystem.GetTimerCollision();
+        }
+        timer.stop();
+        res.step = timer();
+        res.contacts = msystem.GetNcontacts();
+        results.push_back(res);
+    }
+
+    printf("\n%d bodies, %d steps\n", 2 + num_extra_balls, num_steps);
+    printf("%-14s %10s %16s %14s %10s\n", "container", "build [ms]", "collision us/step", "step us/step",
+           "contacts");
+    for (int t = 0; t < 4; t++) {
+        const Result& res = results[t];
+        printf("%-14s %10.3f %16.2f %14.2f %10d\n", container_names[t], 1e3 * res.build,
+               1e6 * res.collision / num_steps, 1e6 * res.step / num_steps, res.contacts);
+    }
+    printf("\nHull cache: %d hits, %d misses\n", cache.GetNumHits(), cache.GetNumMisses());
+}
+
+
+int main(int argc, char* argv[]) {
+    SetChronoDataPath(CHRONO_DATA_DIR);
+
+    ConvexHullCache cache;
+
+    if (argc > 1 && std::string(argv[1]) == "-benchmark") {
+        int num_steps = (argc > 2) ? std::stoi(argv[2]) : 20000;
+        Benchmark(num_steps, cache);
+        return 0;
+    }
+
+    // Container type
+    ContainerType type = ContainerType::HULLS;
+    if (argc > 1) {
+        std::string name(argv[1]);
+        if (name == "boxes")
+            type = ContainerType::BOXES;
+        else if (name == "meshes")
+            type = ContainerType::MESHES;
+        else if (name == "decomposition")
+            type = ContainerType::DECOMPOSITION;
+    }
+
+    // Simulation parameters
+    double time_step = 1e-4;
+
+    // Create the system (Y up)
+    ChSystemSMC msystem;
+    CreateModel(msystem, type, cache, 0);
 
     // Create the Irrlicht visualization
     ChIrrApp application(&msystem, L"Collision test", irr::core::dimension2d<irr::u32>(800, 600));
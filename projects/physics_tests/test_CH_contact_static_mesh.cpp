@@ -0,0 +1,247 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Benchmark of sphere contact on static triangle meshes (terrain patches of
+// increasing size, with a fixed triangle size).
+//
+// A mesh added with is_static = true is stored in a btBvhTriangleMeshShape,
+// whose (quantized) bounding volume hierarchy is built once in BuildModel and
+// never refitted. With is_static = false, the same mesh becomes a
+// btGImpactMeshShape, meant for moving meshes: its box tree must be refitted
+// whenever the mesh changes. A fixed terrain or container should always be
+// added as static.
+//
+// For each mesh size, the benchmark reports:
+//   - the BVH build time and the GImpact refit time;
+//   - the number of triangles returned per sphere query (the narrow phase
+//     candidates) by each tree, versus all triangles for a brute-force test,
+//     and the time per query;
+//   - the collision detection time per step of a ChSystemSMC with spheres
+//     resting on the mesh, for the static and the non-static mesh.
+//
+// =============================================================================
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "chrono/ChConfig.h"
+#include "chrono/core/ChTimer.h"
+#include "chrono/geometry/ChTriangleMeshConnected.h"
+#include "chrono/physics/ChSystemSMC.h"
+
+#include "chrono/collision/bullet/BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
+#include "chrono/collision/bullet/BulletCollision/CollisionShapes/btTriangleCallback.h"
+#include "chrono/collision/bullet/BulletCollision/CollisionShapes/btTriangleIndexVertexArray.h"
+#include "chrono/collision/bullet/BulletCollision/Gimpact/btGImpactShape.h"
+
+using namespace chrono;
+
+// =============================================================================
+
+// Terrain mesh cells per side, and cell size
+std::vector<int> mesh_cells = {16, 32, 64, 128, 256, 512};
+double cell_size = 0.05;
+
+// Query spheres
+double radius = 0.1;
+int num_queries = 100000;
+
+// System-level test
+int num_spheres = 100;
+int num_steps = 1000;
+double time_step = 1e-4;
+
+// =============================================================================
+
+// Height of the terrain surface
+double Height(double x, double y) {
+    return 0.05 * std::sin(2 * x) * std::cos(3 * y);
+}
+
+// Regular grid mesh of n x n cells, centered at the origin
+std::shared_ptr<geometry::ChTriangleMeshConnected> CreateTerrainMesh(int n) {
+    auto trimesh = chrono_types::make_shared<geometry::ChTriangleMeshConnected>();
+    auto& vertices = trimesh->getCoordsVertices();
+    auto& faces = trimesh->getIndicesVertexes();
+    double half = n * cell_size / 2;
+    for (int j = 0; j <= n; j++) {
+        for (int i = 0; i <= n; i++) {
+            double x = -half + i * cell_size;
+            double y = -half + j * cell_size;
+            vertices.push_back(ChVector<>(x, y, Height(x, y)));
+        }
+    }
+    for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++) {
+            int v0 = j * (n + 1) + i;
+            int v1 = v0 + 1;
+            int v2 = v0 + n + 1;
+            int v3 = v2 + 1;
+            faces.push_back(ChVector<int>(v0, v1, v3));
+            faces.push_back(ChVector<int>(v0, v3, v2));
+        }
+    }
+    return trimesh;
+}
+
+// Triangle callback counting the candidates of a query
+class CountingCallback : public btTriangleCallback {
+  public:
+    CountingCallback() : count(0) {}
+    virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex) override { count++; }
+    long long count;
+};
+
+// Random sphere centers just above the surface, over the whole mesh
+void QueryPoints(int n, std::vector<btVector3>& centers) {
+    std::mt19937 gen(7);
+    double half = n * cell_size / 2 - radius;
+    std::uniform_real_distribution<double> pos(-half, half);
+    std::uniform_real_distribution<double> gap(-0.5 * radius, 0.5 * radius);
+    centers.resize(num_queries);
+    for (auto& c : centers) {
+        double x = pos(gen);
+        double y = pos(gen);
+        c = btVector3((btScalar)x, (btScalar)y, (btScalar)(Height(x, y) + radius + gap(gen)));
+    }
+}
+
+// Time the queries on the given shape; return the mean number of candidate triangles per query
+template <typename Shape>
+double Query(const Shape& shape, const std::vector<btVector3>& centers, double& time) {
+    btVector3 extent((btScalar)radius, (btScalar)radius, (btScalar)radius);
+    CountingCallback callback;
+    ChTimer<double> timer;
+    timer.start();
+    for (const auto& c : centers)
+        shape.processAllTriangles(&callback, c - extent, c + extent);
+    timer.stop();
+    time = timer();
+    return callback.count / (double)centers.size();
+}
+
+// Mean collision detection time per step with spheres resting on the mesh (on a grid of at most num_spheres over the
+// central region of the patch). Return the number of spheres in nb.
+double SystemTest(std::shared_ptr<geometry::ChTriangleMeshConnected> trimesh, int n, bool is_static, int& nb) {
+    ChSystemSMC system;
+    system.Set_G_acc(ChVector<>(0, 0, -9.81));
+
+    auto mat = chrono_types::make_shared<ChMaterialSurfaceSMC>();
+    mat->SetYoungModulus(1e7f);
+    mat->SetFriction(0.4f);
+    mat->SetRestitution(0.1f);
+
+    auto ground = chrono_types::make_shared<ChBody>();
+    ground->SetBodyFixed(true);
+    ground->SetCollide(true);
+    ground->GetCollisionModel()->ClearModel();
+    ground->GetCollisionModel()->AddTriangleMesh(mat, trimesh, is_static, false, ChVector<>(0), ChMatrix33<>(1),
+                                                 0.005);
+    ground->GetCollisionModel()->BuildModel();
+    system.AddBody(ground);
+
+    double spacing = 3 * radius;
+    int nx = std::min((int)std::sqrt((double)num_spheres), (int)(n * cell_size / spacing));
+    nb = nx * nx;
+    for (int i = 0; i < nb; i++) {
+        double x = ((i % nx) - (nx - 1) / 2.0) * spacing;
+        double y = ((i / nx) - (nx - 1) / 2.0) * spacing;
+        double mass = 1;
+        auto ball = chrono_types::make_shared<ChBody>();
+        ball->SetMass(mass);
+        ball->SetInertiaXX(0.4 * mass * radius * radius * ChVector<>(1, 1, 1));
+        ball->SetPos(ChVector<>(x, y, Height(x, y) + radius));
+        ball->SetCollide(true);
+        ball->GetCollisionModel()->ClearModel();
+        ball->GetCollisionModel()->AddSphere(mat, radius);
+        ball->GetCollisionModel()->BuildModel();
+        system.AddBody(ball);
+    }
+
+    double time = 0;
+    for (int i = 0; i < num_steps; i++) {
+        system.DoStepDynamics(time_step);
+        time += system.GetTimerCollision();
+    }
+    return time / num_steps;
+}
+
+// =============================================================================
+
+int main(int argc, char* argv[]) {
+    SetChronoDataPath(CHRONO_DATA_DIR);
+
+    printf("Query sphere radius %g, cell size %g, %d queries; up to %d spheres, %d steps\n", radius, cell_size,
+           num_queries, num_spheres, num_steps);
+    printf("Triangles: candidates per query; times: per query (BVH, GImpact) and collision time per step\n\n");
+    printf("%8s | %10s %10s | %10s %10s %10s | %10s %10s | %8s %12s %12s\n", "tris", "build [ms]", "refit [ms]",
+           "BVH tris", "GImpact", "all tris", "BVH us", "GImpact us", "spheres", "static us", "dynamic us");
+
+    for (int n : mesh_cells) {
+        auto trimesh = CreateTerrainMesh(n);
+        int num_tris = trimesh->getNumTriangles();
+
+        // Bullet mesh interface on the mesh arrays
+        std::vector<btScalar> vertices;
+        for (const auto& v : trimesh->getCoordsVertices()) {
+            vertices.push_back((btScalar)v.x());
+            vertices.push_back((btScalar)v.y());
+            vertices.push_back((btScalar)v.z());
+        }
+        std::vector<int> indices;
+        for (const auto& f : trimesh->getIndicesVertexes()) {
+            indices.push_back(f.x());
+            indices.push_back(f.y());
+            indices.push_back(f.z());
+        }
+        btTriangleIndexVertexArray mesh_interface(num_tris, indices.data(), 3 * sizeof(int),
+                                                  (int)trimesh->getCoordsVertices().size(), vertices.data(),
+                                                  3 * sizeof(btScalar));
+
+        // Static mesh shape: the BVH is built once
+        ChTimer<double> timer;
+        timer.start();
+        btBvhTriangleMeshShape bvh_shape(&mesh_interface, true);
+        timer.stop();
+        double time_build = timer();
+
+        // Dynamic mesh shape: the box tree is refitted at each update
+        btGImpactMeshShape gimpact_shape(&mesh_interface);
+        gimpact_shape.updateBound();
+        timer.reset();
+        timer.start();
+        gimpact_shape.postUpdate();
+        gimpact_shape.updateBound();
+        timer.stop();
+        double time_refit = timer();
+
+        std::vector<btVector3> centers;
+        QueryPoints(n, centers);
+        double time_bvh, time_gimpact;
+        double tris_bvh = Query(bvh_shape, centers, time_bvh);
+        double tris_gimpact = Query(gimpact_shape, centers, time_gimpact);
+
+        int nb;
+        double step_static = SystemTest(trimesh, n, true, nb);
+        double step_dynamic = SystemTest(trimesh, n, false, nb);
+
+        printf("%8d | %10.3f %10.3f | %10.2f %10.2f %10d | %10.3f %10.3f | %8d %12.2f %12.2f\n", num_tris,
+               1e3 * time_build, 1e3 * time_refit, tris_bvh, tris_gimpact, num_tris, 1e6 * time_bvh / num_queries,
+               1e6 * time_gimpact / num_queries, nb, 1e6 * step_static, 1e6 * step_dynamic);
+    }
+
+    return 0;
+}
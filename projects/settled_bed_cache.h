@@ -0,0 +1,158 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Content-addressed cache of settled granular beds, shared by the programs
+// which settle a granular bed before running an experiment.
+//
+// The cache entry for a bed is identified by a description of all parameters
+// which determine the settled state (a setup name for the container and fixed
+// bodies, particle radius and density, container dimensions, material
+// properties, settling criteria, ...). Entries are stored in a common cache
+// directory as binary checkpoints (see binary_checkpoint.h) named after a
+// 64-bit hash of this description; the full description is saved alongside, so
+// that a hash collision or a stale entry is never used.
+//
+// Typical use:
+//   SettledBedCache cache("crater");
+//   cache.Add("radius", r_g);
+//   ...
+//   if (!cache.Load(system)) {
+//       // create and settle the granular bed
+//       cache.Store(system);
+//   }
+//
+// =============================================================================
+
+#ifndef SETTLED_BED_CACHE_H
+#define SETTLED_BED_CACHE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "chrono/core/ChVector.h"
+#include "chrono_thirdparty/filesystem/path.h"
+
+#include "binary_checkpoint.h"
+
+class SettledBedCache {
+  public:
+    /// Create a cache key for the given setup (which must identify the container and all non-granular bodies).
+    SettledBedCache(const std::string& setup, const std::string& cache_dir = "../SETTLED_BED_CACHE")
+        : m_dir(cache_dir) {
+        Add("setup", setup);
+    }
+
+    /// Add a parameter of the granular bed to the key.
+    void Add(const std::string& name, const std::string& value) { m_description += name + " = " + value + "\n"; }
+    void Add(const std::string& name, int value) { Add(name, std::to_string(value)); }
+    void Add(const std::string& name, double value) {
+        char buf[32];
+        sprintf(buf, "%.17g", value);
+        Add(name, std::string(buf));
+    }
+    void Add(const std::string& name, const chrono::ChVector<>& value) {
+        Add(name + ".x", value.x());
+        Add(name + ".y", value.y());
+        Add(name + ".z", value.z());
+    }
+
+    /// Add the SMC contact model settings of the system (normal force, adhesion, and tangential displacement models)
+    /// to the key. Nothing is added for an NSC system.
+    void AddContactSettings(chrono::ChSystemMulticore* system) {
+        if (system->GetContactMethod() != chrono::ChContactMethod::SMC)
+            return;
+        const auto& solver = system->GetSettings()->solver;
+        Add("contact_force_model", (int)solver.contact_force_model);
+        Add("adhesion_force_model", (int)solver.adhesion_force_model);
+        Add("tangential_displ_mode", (int)solver.tangential_displ_mode);
+        Add("use_material_properties", solver.use_material_properties ? 1 : 0);
+    }
+
+    /// Return the full description of the key.
+    const std::string& GetDescription() const { return m_description; }
+
+    /// Return the hash of the key (hexadecimal).
+    std::string GetHash() const {
+        // 64-bit FNV-1a
+        uint64_t hash = 14695981039346656037ULL;
+        for (unsigned char c : m_description) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        char buf[17];
+        sprintf(buf, "%016llx", (unsigned long long)hash);
+        return std::string(buf);
+    }
+
+    /// Return the base name (without extension) of the cache entry files.
+    std::string GetEntryName() const { return m_dir + "/" + GetHash(); }
+
+    /// Add the bodies of the cached bed to the system. Return false (without modifying the system) if there is no
+    /// valid cache entry for this key.
+    bool Load(chrono::ChSystemMulticore* system) const {
+        std::string entry = GetEntryName();
+        std::ifstream key_file(entry + ".key");
+        if (!key_file.good())
+            return false;
+        std::stringstream description;
+        description << key_file.rdbuf();
+        if (description.str() != m_description) {
+            std::cout << "Settled bed cache entry " << entry << " does not match key; ignored" << std::endl;
+            return false;
+        }
+
+        if (ReadBinaryCheckpoint(system, entry + ".bin")) {
+            std::cout << "Read settled bed from cache " << entry << ".bin" << std::endl;
+            return true;
+        }
+        if (filesystem::path(entry + ".dat").exists()) {
+            chrono::utils::ReadCheckpoint(system, entry + ".dat");
+            std::cout << "Read settled bed from cache " << entry << ".dat" << std::endl;
+            return true;
+        }
+        return false;
+    }
+
+    /// Store the current state of the system as the settled bed for this key. Return false on failure.
+    bool Store(chrono::ChSystemMulticore* system) const {
+        filesystem::create_directory(filesystem::path(m_dir));
+        std::string entry = GetEntryName();
+
+        // Write the checkpoint first; the entry is valid only once the key file is in place
+        remove((entry + ".key").c_str());
+        WriteSystemCheckpoint(system, entry + ".bin", entry + ".dat");
+
+        std::string tmpname = entry + ".key.tmp" + std::to_string(BINARY_CHECKPOINT_GETPID());
+        {
+            std::ofstream key_file(tmpname);
+            key_file << m_description;
+            if (!key_file.good())
+                return false;
+        }
+        if (rename(tmpname.c_str(), (entry + ".key").c_str()) != 0) {
+            remove(tmpname.c_str());
+            return false;
+        }
+        std::cout << "Stored settled bed in cache " << entry << std::endl;
+        return true;
+    }
+
+  private:
+    std::string m_dir;
+    std::string m_description;
+};
+
+#endif
@@ -0,0 +1,412 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Compile-time specialized contact force kernels for Chrono::Multicore SMC.
+//
+// The multicore SMC solver evaluates the contact forces with one function for
+// all models, which tests the normal force model, the adhesion model, and the
+// tangential displacement model for every contact. SMCForceKernelSolver
+// replaces the contact force stage of the solver: once per step, it selects a
+// kernel instantiated for the current combination of models,
+//   normal force:   Hooke, Hertz
+//   adhesion:       Constant, DMT
+//   tangential:     None, OneStep
+// so that the per-contact loop has no model branches. The kernel evaluates the
+// contact forces (with the material-based coefficients and the default
+// composition of the material properties of the two bodies), adds them to the
+// body forces, and fills the body contact forces reported by the system; the
+// rest of the step (bilateral constraints, velocity update) is the one of the
+// multicore SMC solver.
+//
+// Other combinations (Flores or PlainCoulomb force models, Perko adhesion,
+// MultiStep tangential displacements, user-specified coefficients, rolling or
+// spinning friction, a non-default material composition strategy) fall back to
+// the library kernel for the step.
+//
+// Typical use:
+//   auto kernels = EnableSMCForceKernels(system);   // after setting the models
+//   ...
+//   kernels->GetNumSpecializedSteps(), kernels->GetKernelName()
+//
+// =============================================================================
+
+#ifndef SMC_FORCE_KERNELS_H
+#define SMC_FORCE_KERNELS_H
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+#include "chrono_multicore/solver/ChIterativeSolverMulticore.h"
+
+namespace smc_kernels {
+
+using chrono::real;
+using chrono::real3;
+
+// Composite material of a contact.
+struct Material {
+    real E_eff;     // effective Young's modulus
+    real G_eff;     // effective shear modulus
+    real cr_eff;    // coefficient of restitution
+    real mu_eff;    // coefficient of friction
+    real adhesion;  // constant adhesion force
+    real adh_DMT;   // DMT adhesion multiplier
+};
+
+// Normal force models: contact stiffness and damping coefficients.
+struct Hooke {
+    static const char* Name() { return "Hooke"; }
+    static void Coefficients(const Material& mat,
+                             real R_eff,
+                             real delta_n,
+                             real m_eff,
+                             real char_vel,
+                             real& kn,
+                             real& kt,
+                             real& gn,
+                             real& gt) {
+        real tmp_k = (16.0 / 15) * std::sqrt(R_eff) * mat.E_eff;
+        real v2 = char_vel * char_vel;
+        real loge = std::log(std::min(std::max(mat.cr_eff, (real)1e-10), (real)(1 - 1e-10)));
+        real tmp_g = 1 + (CH_C_PI / loge) * (CH_C_PI / loge);
+        kn = tmp_k * std::pow(m_eff * v2 / tmp_k, 1.0 / 5);
+        kt = kn;
+        gn = std::sqrt(4 * m_eff * kn / tmp_g);
+        gt = gn;
+    }
+};
+
+struct Hertz {
+    static const char* Name() { return "Hertz"; }
+    static void Coefficients(const Material& mat,
+                             real R_eff,
+                             real delta_n,
+                             real m_eff,
+                             real char_vel,
+                             real& kn,
+                             real& kt,
+                             real& gn,
+                             real& gt) {
+        real sqrt_Rd = std::sqrt(R_eff * delta_n);
+        real Sn = 2 * mat.E_eff * sqrt_Rd;
+        real St = 8 * mat.G_eff * sqrt_Rd;
+        real loge = std::log(std::min(std::max(mat.cr_eff, (real)1e-10), (real)(1 - 1e-10)));
+        real beta = loge / std::sqrt(loge * loge + CH_C_PI * CH_C_PI);
+        kn = (2.0 / 3) * Sn;
+        kt = St;
+        gn = -2 * std::sqrt(5.0 / 6) * beta * std::sqrt(Sn * m_eff);
+        gt = -2 * std::sqrt(5.0 / 6) * beta * std::sqrt(St * m_eff);
+    }
+};
+
+// Adhesion models: adhesion force (reducing the normal force).
+struct ConstantAdhesion {
+    static const char* Name() { return "Constant"; }
+    static real Force(const Material& mat, real R_eff) { return mat.adhesion; }
+};
+
+struct DMTAdhesion {
+    static const char* Name() { return "DMT"; }
+    static real Force(const Material& mat, real R_eff) { return mat.adh_DMT * std::sqrt(R_eff); }
+};
+
+// Tangential displacement models: tangential displacement over the step.
+struct NoTangentDispl {
+    static const char* Name() { return "None"; }
+    static real3 Displacement(const real3& relvel_t, real dT) { return real3(0); }
+};
+
+struct OneStepTangentDispl {
+    static const char* Name() { return "OneStep"; }
+    static real3 Displacement(const real3& relvel_t, real dT) { return relvel_t * dT; }
+};
+
+// Contact forces on the two bodies of each contact (forces in the absolute frame, torques in the body frames).
+template <class ForceModel, class AdhesionModel, class TangentModel>
+void CalcContactForces(chrono::ChMulticoreDataManager* data_manager,
+                       const std::vector<Material>& materials,
+                       std::vector<real3>& ct_force,
+                       std::vector<real3>& ct_torque) {
+    const auto& cd = *data_manager->cd_data;
+    const auto& host = data_manager->host_data;
+    const real dT = data_manager->settings.step_size;
+    const real char_vel = data_manager->settings.solver.characteristic_vel;
+    int num_contacts = (int)cd.num_rigid_contacts;
+
+#pragma omp parallel for schedule(static)
+    for (int index = 0; index < num_contacts; index++) {
+        int b1 = cd.bids_rigid_rigid[index].x;
+        int b2 = cd.bids_rigid_rigid[index].y;
+        ct_force[2 * index] = real3(0);
+        ct_force[2 * index + 1] = real3(0);
+        ct_torque[2 * index] = real3(0);
+        ct_torque[2 * index + 1] = real3(0);
+        if (!host.active_rigid[b1] && !host.active_rigid[b2])
+            continue;
+
+        // No force if the two shapes are actually separated
+        if (cd.dpth_rigid_rigid[index] >= 0)
+            continue;
+
+        const Material& mat = materials[index];
+        const real3& normal = cd.norm_rigid_rigid[index];
+        real3 pt1_loc = chrono::RotateT(cd.cpta_rigid_rigid[index] - host.pos_rigid[b1], host.rot_rigid[b1]);
+        real3 pt2_loc = chrono::RotateT(cd.cptb_rigid_rigid[index] - host.pos_rigid[b2], host.rot_rigid[b2]);
+
+        // Relative velocity at the contact point
+        real3 v1(host.v[b1 * 6 + 0], host.v[b1 * 6 + 1], host.v[b1 * 6 + 2]);
+        real3 o1(host.v[b1 * 6 + 3], host.v[b1 * 6 + 4], host.v[b1 * 6 + 5]);
+        real3 v2(host.v[b2 * 6 + 0], host.v[b2 * 6 + 1], host.v[b2 * 6 + 2]);
+        real3 o2(host.v[b2 * 6 + 3], host.v[b2 * 6 + 4], host.v[b2 * 6 + 5]);
+        real3 relvel = v2 + chrono::Rotate(chrono::Cross(o2, pt2_loc), host.rot_rigid[b2]) -
+                       (v1 + chrono::Rotate(chrono::Cross(o1, pt1_loc), host.rot_rigid[b1]));
+        real relvel_n_mag = chrono::Dot(relvel, normal);
+        real3 relvel_t = relvel - relvel_n_mag * normal;
+
+        real m1 = host.mass_rigid[b1];
+        real m2 = host.mass_rigid[b2];
+        real m_eff = m1 * m2 / (m1 + m2);
+        real R_eff = cd.erad_rigid_rigid[index];
+        real delta_n = -cd.dpth_rigid_rigid[index];
+        real3 delta_t = TangentModel::Displacement(relvel_t, dT);
+
+        real kn, kt, gn, gt;
+        ForceModel::Coefficients(mat, R_eff, delta_n, m_eff, char_vel, kn, kt, gn, gt);
+
+        // Normal force (no force if the shapes separate fast enough), reduced by adhesion
+        real forceN = kn * delta_n - gn * relvel_n_mag;
+        real3 forceT = -kt * delta_t - gt * relvel_t;
+        if (forceN < 0) {
+            forceN = 0;
+            forceT = real3(0);
+        }
+        forceN -= AdhesionModel::Force(mat, R_eff);
+
+        // Coulomb law
+        real forceT_mag = chrono::Length(forceT);
+        real forceT_slide = mat.mu_eff * std::abs(forceN);
+        if (forceT_mag > forceT_slide)
+            forceT = forceT * (forceT_slide / forceT_mag);
+
+        real3 force = forceN * normal + forceT;
+        ct_force[2 * index] = -force;
+        ct_force[2 * index + 1] = force;
+        ct_torque[2 * index] = -chrono::Cross(pt1_loc, chrono::RotateT(force, host.rot_rigid[b1]));
+        ct_torque[2 * index + 1] = chrono::Cross(pt2_loc, chrono::RotateT(force, host.rot_rigid[b2]));
+    }
+}
+
+}  // end namespace smc_kernels
+
+class SMCForceKernelSolver : public chrono::ChIterativeSolverMulticoreSMC {
+  public:
+    SMCForceKernelSolver(chrono::ChMulticoreDataManager* dc)
+        : chrono::ChIterativeSolverMulticoreSMC(dc),
+          m_kernel(nullptr),
+          m_kernel_name("library"),
+          m_num_specialized(0),
+          m_num_fallback(0) {}
+
+    virtual void RunTimeStep() override {
+        using namespace chrono;
+
+        auto& cd = *data_manager->cd_data;
+        auto& host = data_manager->host_data;
+        uint num_contacts = cd.num_rigid_contacts;
+
+        SelectKernel();
+        if (!m_kernel || num_contacts == 0 || !DefaultComposition() || !GatherMaterials()) {
+            m_num_fallback++;
+            ChIterativeSolverMulticoreSMC::RunTimeStep();
+            return;
+        }
+        m_num_specialized++;
+
+        // Contact forces, accumulated per body and added to the body force impulses
+        data_manager->system_timer.start("ChIterativeSolverMulticoreSMC_ProcessContact");
+        m_ct_force.resize(2 * num_contacts);
+        m_ct_torque.resize(2 * num_contacts);
+        m_kernel(data_manager, m_materials, m_ct_force, m_ct_torque);
+
+        uint num_bodies = data_manager->num_rigid_bodies;
+        m_body_force.assign(num_bodies, real3(0));
+        m_body_torque.assign(num_bodies, real3(0));
+        m_body_touched.assign(num_bodies, 0);
+        for (uint index = 0; index < num_contacts; index++) {
+            int b[2] = {cd.bids_rigid_rigid[index].x, cd.bids_rigid_rigid[index].y};
+            for (int k = 0; k < 2; k++) {
+                m_body_force[b[k]] += m_ct_force[2 * index + k];
+                m_body_torque[b[k]] += m_ct_torque[2 * index + k];
+                m_body_touched[b[k]] = 1;
+            }
+        }
+        real dT = data_manager->settings.step_size;
+        for (uint ib = 0; ib < num_bodies; ib++) {
+            if (!m_body_touched[ib])
+                continue;
+            for (int j = 0; j < 3; j++) {
+                host.hf[ib * 6 + j] += dT * m_body_force[ib][j];
+                host.hf[ib * 6 + 3 + j] += dT * m_body_torque[ib][j];
+            }
+        }
+        data_manager->system_timer.stop("ChIterativeSolverMulticoreSMC_ProcessContact");
+
+        // Rest of the step, with the library contact force stage disabled
+        cd.num_rigid_contacts = 0;
+        ChIterativeSolverMulticoreSMC::RunTimeStep();
+        cd.num_rigid_contacts = num_contacts;
+
+        // Body contact forces reported by the system
+        host.ct_body_map.resize(num_bodies);
+        host.ct_body_force.clear();
+        host.ct_body_torque.clear();
+        for (uint ib = 0; ib < num_bodies; ib++) {
+            host.ct_body_map[ib] = m_body_touched[ib] ? (int)host.ct_body_force.size() : -1;
+            if (m_body_touched[ib]) {
+                host.ct_body_force.push_back(m_body_force[ib]);
+                host.ct_body_torque.push_back(m_body_torque[ib]);
+            }
+        }
+    }
+
+    /// Return the name of the kernel used at the last step ("library" if the library kernel was used).
+    const std::string& GetKernelName() const { return m_kernel_name; }
+
+    /// Return the number of steps with a specialized kernel.
+    int GetNumSpecializedSteps() const { return m_num_specialized; }
+
+    /// Return the number of steps with the library kernel.
+    int GetNumFallbackSteps() const { return m_num_fallback; }
+
+  private:
+    typedef void (*Kernel)(chrono::ChMulticoreDataManager*,
+                           const std::vector<smc_kernels::Material>&,
+                           std::vector<chrono::real3>&,
+                           std::vector<chrono::real3>&);
+
+    template <class F, class A, class T>
+    void SetKernel() {
+        m_kernel = &smc_kernels::CalcContactForces<F, A, T>;
+        m_kernel_name = std::string(F::Name()) + "/" + A::Name() + "/" + T::Name();
+    }
+
+    template <class F, class A>
+    void SelectTangent(chrono::ChSystemSMC::TangentialDisplacementModel model) {
+        using chrono::ChSystemSMC;
+        switch (model) {
+            case ChSystemSMC::TangentialDisplacementModel::None:
+                SetKernel<F, A, smc_kernels::NoTangentDispl>();
+                break;
+            case ChSystemSMC::TangentialDisplacementModel::OneStep:
+                SetKernel<F, A, smc_kernels::OneStepTangentDispl>();
+                break;
+            default:
+                break;
+        }
+    }
+
+    template <class F>
+    void SelectAdhesion(chrono::ChSystemSMC::AdhesionForceModel adhesion,
+                        chrono::ChSystemSMC::TangentialDisplacementModel tangent) {
+        using chrono::ChSystemSMC;
+        switch (adhesion) {
+            case ChSystemSMC::AdhesionForceModel::Constant:
+                SelectTangent<F, smc_kernels::ConstantAdhesion>(tangent);
+                break;
+            case ChSystemSMC::AdhesionForceModel::DMT:
+                SelectTangent<F, smc_kernels::DMTAdhesion>(tangent);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Select the kernel for the current models (once per step).
+    void SelectKernel() {
+        using chrono::ChSystemSMC;
+        const auto& settings = data_manager->settings.solver;
+        m_kernel = nullptr;
+        m_kernel_name = "library";
+        if (!settings.use_material_properties)
+            return;
+        switch (settings.contact_force_model) {
+            case ChSystemSMC::ContactForceModel::Hooke:
+                SelectAdhesion<smc_kernels::Hooke>(settings.adhesion_force_model, settings.tangential_displ_mode);
+                break;
+            case ChSystemSMC::ContactForceModel::Hertz:
+                SelectAdhesion<smc_kernels::Hertz>(settings.adhesion_force_model, settings.tangential_displ_mode);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // True if the system uses the default material composition laws, the only ones implemented by GatherMaterials.
+    bool DefaultComposition() const {
+        const auto& strategy = data_manager->composition_strategy;
+        return !strategy || typeid(*strategy) == typeid(chrono::ChMaterialCompositionStrategy);
+    }
+
+    // Composite materials of the contacts (default composition laws). Return false if a contact has rolling or
+    // spinning friction, which the specialized kernels do not model.
+    bool GatherMaterials() {
+        using namespace chrono;
+        const auto& cd = *data_manager->cd_data;
+        const auto& host = data_manager->host_data;
+        int num_contacts = (int)cd.num_rigid_contacts;
+        m_materials.resize(num_contacts);
+        bool ok = true;
+#pragma omp parallel for schedule(static) reduction(&& : ok)
+        for (int index = 0; index < num_contacts; index++) {
+            int b1 = cd.bids_rigid_rigid[index].x;
+            int b2 = cd.bids_rigid_rigid[index].y;
+            real Y1 = host.elastic_moduli[b1].x, nu1 = host.elastic_moduli[b1].y;
+            real Y2 = host.elastic_moduli[b2].x, nu2 = host.elastic_moduli[b2].y;
+            auto& mat = m_materials[index];
+            mat.E_eff = 1 / ((1 - nu1 * nu1) / Y1 + (1 - nu2 * nu2) / Y2);
+            mat.G_eff = 1 / (2 * (2 - nu1) * (1 + nu1) / Y1 + 2 * (2 - nu2) * (1 + nu2) / Y2);
+            mat.cr_eff = std::min(host.cr[b1], host.cr[b2]);
+            mat.mu_eff = std::min(host.mu[b1], host.mu[b2]);
+            mat.adhesion = std::min(host.cohesion_data[b1], host.cohesion_data[b2]);
+            mat.adh_DMT = std::min(host.adhesionMultDMT_data[b1], host.adhesionMultDMT_data[b2]);
+            ok = ok && std::min(host.muRoll[b1], host.muRoll[b2]) == 0 &&
+                 std::min(host.muSpin[b1], host.muSpin[b2]) == 0;
+        }
+        return ok;
+    }
+
+    Kernel m_kernel;
+    std::string m_kernel_name;
+    int m_num_specialized;
+    int m_num_fallback;
+
+    std::vector<smc_kernels::Material> m_materials;  // composite materials, per contact
+    std::vector<chrono::real3> m_ct_force;           // contact forces, 2 per contact
+    std::vector<chrono::real3> m_ct_torque;          // contact torques, 2 per contact
+    std::vector<chrono::real3> m_body_force;         // contact force, per body
+    std::vector<chrono::real3> m_body_torque;        // contact torque, per body
+    std::vector<char> m_body_touched;                // body in contact
+};
+
+/// Replace the solver of a multicore SMC system with one using the specialized contact force kernels.
+inline std::shared_ptr<SMCForceKernelSolver> EnableSMCForceKernels(chrono::ChSystemMulticoreSMC* system) {
+    auto solver = chrono_types::make_shared<SMCForceKernelSolver>(system->data_manager);
+    system->SetSolver(solver);
+    return solver;
+}
+
+#endif
@@ -0,0 +1,155 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Recorder function (piecewise linear interpolation of recorded points) for
+// large tables, such as road profiles and driver input sequences.
+//
+// ChFunction_SortedRecorder evaluates like ChFunction_Recorder (linear
+// interpolation between points, constant extrapolation beyond the first and
+// last points), but stores the points in two contiguous arrays sorted by x.
+// A query first checks the interval of the previous query and the next one,
+// which makes monotone queries O(1), and falls back to a binary search
+// otherwise. The interval hint kept by the function itself is not safe for
+// concurrent queries; threads sharing one table should pass their own hint
+// (see the Get_y overloads taking a hint, and the batch Get_y).
+//
+// Points can be appended in increasing order in O(1), or loaded in bulk with
+// SetPoints (one sort). AddPoint out of order inserts in O(n).
+//
+// =============================================================================
+
+#ifndef SORTED_RECORDER_H
+#define SORTED_RECORDER_H
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+#include "chrono/motion_functions/ChFunction_Base.h"
+
+namespace chrono {
+
+class ChFunction_SortedRecorder : public ChFunction {
+  public:
+    ChFunction_SortedRecorder() : m_hint(0) {}
+
+    virtual ChFunction_SortedRecorder* Clone() const override { return new ChFunction_SortedRecorder(*this); }
+
+    /// Add a point. A point at the same x (within 1e-10) as an existing one replaces it.
+    void AddPoint(double x, double y) {
+        if (m_x.empty() || x > m_x.back() + tolerance) {
+            m_x.push_back(x);
+            m_y.push_back(y);
+            return;
+        }
+        size_t i = std::lower_bound(m_x.begin(), m_x.end(), x - tolerance) - m_x.begin();
+        if (i < m_x.size() && std::abs(m_x[i] - x) <= tolerance) {
+            m_y[i] = y;
+            return;
+        }
+        m_x.insert(m_x.begin() + i, x);
+        m_y.insert(m_y.begin() + i, y);
+    }
+
+    /// Replace all points with the given ones (in any order). For points at the same x, the last one is kept.
+    void SetPoints(const std::vector<double>& x, const std::vector<double>& y) {
+        size_t n = std::min(x.size(), y.size());
+        std::vector<size_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&x](size_t a, size_t b) { return x[a] < x[b]; });
+        m_x.clear();
+        m_y.clear();
+        m_x.reserve(n);
+        m_y.reserve(n);
+        for (size_t i : order) {
+            if (!m_x.empty() && x[i] <= m_x.back() + tolerance) {
+                m_y.back() = y[i];
+                continue;
+            }
+            m_x.push_back(x[i]);
+            m_y.push_back(y[i]);
+        }
+        m_hint = 0;
+    }
+
+    void Reset() {
+        m_x.clear();
+        m_y.clear();
+        m_hint = 0;
+    }
+
+    size_t GetNumPoints() const { return m_x.size(); }
+    const std::vector<double>& GetX() const { return m_x; }
+    const std::vector<double>& GetY() const { return m_y; }
+
+    virtual double Get_y(double x) const override { return Get_y(x, m_hint); }
+
+    virtual double Get_y_dx(double x) const override { return Get_y_dx(x, m_hint); }
+
+    /// Evaluate with a caller-owned interval hint (updated by the query).
+    double Get_y(double x, size_t& hint) const {
+        if (m_x.empty())
+            return 0;
+        if (x <= m_x.front())
+            return m_y.front();
+        if (x >= m_x.back())
+            return m_y.back();
+        size_t i = FindInterval(x, hint);
+        return m_y[i] + (m_y[i + 1] - m_y[i]) * (x - m_x[i]) / (m_x[i + 1] - m_x[i]);
+    }
+
+    /// Evaluate the derivative with a caller-owned interval hint (updated by the query).
+    double Get_y_dx(double x, size_t& hint) const {
+        if (m_x.size() < 2 || x <= m_x.front() || x >= m_x.back())
+            return 0;
+        size_t i = FindInterval(x, hint);
+        return (m_y[i + 1] - m_y[i]) / (m_x[i + 1] - m_x[i]);
+    }
+
+    /// Evaluate at n abscissas (fastest when they are sorted). The hint is carried from one query to the next.
+    void Get_y(const double* x, double* y, size_t n, size_t& hint) const {
+        for (size_t k = 0; k < n; k++)
+            y[k] = Get_y(x[k], hint);
+    }
+
+    void Get_y(const std::vector<double>& x, std::vector<double>& y) const {
+        y.resize(x.size());
+        size_t hint = m_hint;
+        Get_y(x.data(), y.data(), x.size(), hint);
+        m_hint = hint;
+    }
+
+  private:
+    static constexpr double tolerance = 1e-10;
+
+    // Return the index i of the interval [x_i, x_i+1] containing x, for x strictly inside the range.
+    size_t FindInterval(double x, size_t& hint) const {
+        size_t i = hint;
+        if (i + 1 < m_x.size() && m_x[i] <= x) {
+            if (x <= m_x[i + 1])
+                return i;
+            if (i + 2 < m_x.size() && x <= m_x[i + 2])
+                return hint = i + 1;
+        }
+        i = std::upper_bound(m_x.begin(), m_x.end(), x) - m_x.begin() - 1;
+        return hint = std::min(i, m_x.size() - 2);
+    }
+
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+    mutable size_t m_hint;
+};
+
+}  // end namespace chrono
+
+#endif
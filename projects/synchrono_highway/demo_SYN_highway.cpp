@@ -56,9 +56,18 @@
 
 #include "chrono_thirdparty/cxxopts/ChCLI.h"
 
+#include "../loop_profiler.h"
+
+#include "extras/comm/ChCompactStateCodec.h"
+#include "extras/comm/ChInterestManager.h"
 #include "extras/driver/ChCSLDriver.h"
 #include "extras/driver/ChLidarWaypointDriver.h"
 #include "extras/filters/ChFilterFullScreenVisualize.h"
+#include "extras/filters/ChFilterLidarROIMin.h"
+#include "extras/scene/ChSceneStreamer.h"
+#include "extras/utils/ChSensorScheduler.h"
+#include "extras/utils/ChTaskPool.h"
+#include "extras/utils/ChTelemetryRecorder.h"
 
 // =============================================================================
 
@@ -122,11 +131,15 @@ bool save = false;
 bool use_fullscreen = false;
 bool no_sensing = false;
 
-ChVector<> simulation_center = {826.734, -37.97, -64.8};
-
 double loading_radius = 1000;
 bool load_roads_only = false;
 
+bool compact_state = false;
+double interest_radius = 150;
+int agents_per_node = 1;
+bool schedule_sensors = false;
+bool path_table = false;
+
 // Resolution of the CSL 3-monitor setup
 const int FS_WIDTH = 3840;
 const int FS_HEIGHT = 720;
@@ -142,6 +155,15 @@ struct PathVehicleSetup {
     double speed_gain_p;
 };
 
+// Additional path-following vehicle hosted by a node, in the system of the node vehicle
+struct HostedVehicle {
+    int config;  // index in demo_config
+    std::unique_ptr<WheeledVehicle> vehicle;
+    std::shared_ptr<SynWheeledVehicleAgent> agent;
+    std::shared_ptr<ChLidarWaypointDriver> driver;
+    ChTelemetryRecorder::Channel* telemetry = nullptr;  // input recording (not owned)
+};
+
 double suv_lookahead = 5.0;
 double audi_tight_lookahead = 6.0;
 double suv_pgain = .5;
@@ -212,12 +234,16 @@ void GetVehicleModelFiles(VehicleType type,
                           ChVector<>& lidar_pos,
                           double& cam_distance);
 
-void AddSceneMeshes(ChSystem* chsystem, RigidTerrain* terrain);
-
 void VehicleProcessMessageCallback(std::shared_ptr<SynMessage> message,
                                    WheeledVehicle& vehicle,
                                    std::shared_ptr<SynWheeledVehicleAgent> agent,
-                                   std::shared_ptr<ChLidarWaypointDriver> driver);
+                                   std::shared_ptr<ChLidarWaypointDriver> driver,
+                                   std::shared_ptr<ChInterestManager> interest);
+
+// Set the distance to the vehicle at the given position if it is in front of the vehicle of the given driver
+void UpdateFollowingDistance(const ChVector<>& other_pos,
+                             WheeledVehicle& vehicle,
+                             std::shared_ptr<ChLidarWaypointDriver> driver);
 
 class IrrAppWrapper {
   public:
@@ -325,6 +351,11 @@ int main(int argc, char* argv[]) {
     bool replay_inputs = cli.GetAsType<bool>("replay");
     loading_radius = cli.GetAsType<double>("load_radius");
     load_roads_only = cli.GetAsType<bool>("roads_only");
+    compact_state = cli.GetAsType<bool>("compact_state");
+    interest_radius = cli.GetAsType<double>("interest_radius");
+    agents_per_node = cli.GetAsType<int>("agents_per_node");
+    schedule_sensors = cli.GetAsType<bool>("schedule_sensors");
+    path_table = cli.GetAsType<bool>("path_table");
 
     // Change SynChronoManager settings
     syn_manager.SetHeartbeat(heartbeat);
@@ -383,10 +414,52 @@ int main(int argc, char* argv[]) {
     // Add vehicle as an agent and initialize SynChronoManager
     auto agent = chrono_types::make_shared<SynWheeledVehicleAgent>(&vehicle, zombie_filename);
     syn_manager.AddAgent(agent);
+
+    // Create the additional vehicles hosted by this node in the same system, using the entries of demo_config past
+    // the node vehicles. Each one is a separate agent for the other nodes.
+    std::vector<HostedVehicle> hosted;
+    for (int i = 1; i < agents_per_node; i++) {
+        int config = num_nodes + node_id * (agents_per_node - 1) + (i - 1);
+        if (config < 0 || config >= (int)demo_config.size())
+            break;
+
+        double hosted_cam_distance;
+        std::string hosted_vehicle_filename, hosted_powertrain_filename, hosted_tire_filename, hosted_zombie_filename;
+        ChVector<> hosted_lidar_pos;
+        GetVehicleModelFiles(demo_config[config].vehicle_type, hosted_vehicle_filename, hosted_powertrain_filename,
+                             hosted_tire_filename, hosted_zombie_filename, hosted_lidar_pos, hosted_cam_distance);
+
+        HostedVehicle h;
+        h.config = config;
+        h.vehicle = std::unique_ptr<WheeledVehicle>(new WheeledVehicle(vehicle.GetSystem(), hosted_vehicle_filename));
+        h.vehicle->Initialize(ChCoordsys<>(demo_config[config].pos, demo_config[config].rot));
+        h.vehicle->GetChassis()->SetFixed(false);
+        h.vehicle->SetChassisVisualizationType(chassis_vis_type);
+        h.vehicle->SetSuspensionVisualizationType(suspension_vis_type);
+        h.vehicle->SetSteeringVisualizationType(steering_vis_type);
+        h.vehicle->SetWheelVisualizationType(wheel_vis_type);
+        h.vehicle->InitializePowertrain(ReadPowertrainJSON(hosted_powertrain_filename));
+        for (auto& axle : h.vehicle->GetAxles()) {
+            for (auto& wheel : axle->GetWheels())
+                h.vehicle->InitializeTire(ReadTireJSON(hosted_tire_filename), wheel, tire_vis_type);
+        }
+
+        h.agent = chrono_types::make_shared<SynWheeledVehicleAgent>(h.vehicle.get(), hosted_zombie_filename);
+        syn_manager.AddAgent(h.agent);
+        hosted.push_back(std::move(h));
+    }
     syn_manager.Initialize(vehicle.GetSystem());
 
     RigidTerrain terrain(vehicle.GetSystem());
-    AddSceneMeshes(vehicle.GetSystem(), &terrain);
+
+    // Stream the scene meshes around the vehicle
+    ChSceneStreamer scene(vehicle.GetSystem(), GetChronoDataFile("/Environments/SanFrancisco/components_new/"),
+                          "instance_map_03.csv");
+    scene.SetLoadRadius(loading_radius);
+    scene.SetRoadsOnly(load_roads_only);
+    scene.Update({vehicle.GetVehiclePos()}, true);
+    std::cout << "Scene meshes: " << scene.GetNumAttachedInstances() << " in " << scene.GetNumAttachedTiles()
+              << " tiles" << std::endl;
 
     MaterialInfo minfo;  // values from RigidPlane.json
     minfo.mu = 0.9;      // coefficient of friction
@@ -403,6 +476,7 @@ int main(int argc, char* argv[]) {
     terrain.Initialize();
 
     std::shared_ptr<ChLidarSensor> lidar;
+    std::shared_ptr<ChFilterLidarROIMin> lidar_roi;
     std::shared_ptr<ChCameraSensor> camera;
     std::shared_ptr<ChSensorManager> manager;
     if (node_id == leader || !no_sensing) {
@@ -525,19 +599,34 @@ int main(int argc, char* argv[]) {
             lidar->PushFilter(chrono_types::make_shared<ChFilterPCfromDepth>());
             lidar->PushFilter(chrono_types::make_shared<ChFilterLidarNoiseXYZI>(0.01f, 0.001f, 0.001f, 0.01f));
             lidar->PushFilter(chrono_types::make_shared<ChFilterVisualizePointCloud>(640, 480, 2, "Lidar Point Cloud"));
-            lidar->PushFilter(chrono_types::make_shared<ChFilterXYZIAccess>());
+            // minimum distance in the driver's box of interest, computed on the device
+            lidar_roi = chrono_types::make_shared<ChFilterLidarROIMin>(ChVector<float>(0.1f, -2.0f, -0.1f),
+                                                                       ChVector<float>(100.f, 2.0f, 1.5f));
+            lidar->PushFilter(lidar_roi);
             if (save)
                 lidar->PushFilter(chrono_types::make_shared<ChFilterSavePtCloud>("DEMO_OUTPUT/lidar/"));
             manager->AddSensor(lidar);
         }
     }
 
-    // Create the vehicle Irrlicht interface
+    // Telemetry of the agents of this node (driver inputs and chassis state), drained to file in the background
     std::string driver_file = "driver_inputs.txt";
-    utils::CSV_writer driver_csv(" ");
+    std::string telemetry_file = "telemetry_" + std::to_string(node_id) + ".chtl";
+    std::unique_ptr<ChTelemetryRecorder> telemetry;
+    ChTelemetryRecorder::Channel* vehicle_telemetry = nullptr;
+    uint64_t telemetry_dropped = 0;  // dropped records already reported
+    if (record_inputs) {
+        telemetry = std::unique_ptr<ChTelemetryRecorder>(new ChTelemetryRecorder(telemetry_file));
+        vehicle_telemetry = telemetry->AddChannel(node_id);
+        for (auto& h : hosted)
+            h.telemetry = telemetry->AddChannel(h.config);
+    }
+
+    // Create the vehicle Irrlicht interface
 
     IrrAppWrapper app;
     std::shared_ptr<ChDriver> driver;
+    std::shared_ptr<ChLidarWaypointDriver> callback_driver;  // path driver following the zombies through messages
     if (node_id == leader && replay_inputs) {
         auto data_driver = chrono_types::make_shared<ChDataDriver>(vehicle, driver_file, true);
         data_driver->Initialize();
@@ -573,6 +662,8 @@ int main(int argc, char* argv[]) {
     } else if (node_id == leader && cli.GetAsType<bool>("console")) {
         // Use custom CSL driver instead of irr driver
         auto csl_driver = chrono_types::make_shared<ChCSLDriver>(vehicle);
+        csl_driver->SetTelemetryChannel(vehicle_telemetry);
+        vehicle_telemetry = nullptr;  // recorded by the driver
         driver = csl_driver;
     } else {
         auto path = ChBezierCurve::read(GetChronoDataFile(demo_config[node_id].path_file));
@@ -587,35 +678,74 @@ int main(int argc, char* argv[]) {
                                                              following_distance, current_distance, isPathClosed);
         path_driver->SetGains(demo_config[node_id].lookahead, 0.5, 0.0, 0.0, demo_config[node_id].speed_gain_p, 0.01,
                               0.0);
+        path_driver->SetLidarROIFilter(lidar_roi);
+        if (path_table)
+            path_driver->UsePathTable();
         path_driver->Initialize();
 
         if (no_sensing) {
-            // Set the callback so that we can check the state of other vehicles
-            auto callback =
-                std::bind(&VehicleProcessMessageCallback, std::placeholders::_1, std::ref(vehicle), agent, path_driver);
+            // Set the callback so that we can check the state of other vehicles (throttling the far ones)
+            auto interest = chrono_types::make_shared<ChInterestManager>(interest_radius);
+            auto callback = std::bind(&VehicleProcessMessageCallback, std::placeholders::_1, std::ref(vehicle), agent,
+                                      path_driver, interest);
             agent->SetProcessMessageCallback(callback);
+            callback_driver = path_driver;
         }
 
         driver = path_driver;
     }
 
+    // Path-following drivers of the hosted vehicles, stepped in parallel. The distances between the vehicles of this
+    // node are computed in memory, those to the zombies from the received messages.
+    for (auto& h : hosted) {
+        auto path = ChBezierCurve::read(GetChronoDataFile(demo_config[h.config].path_file));
+        h.driver = chrono_types::make_shared<ChLidarWaypointDriver>(*h.vehicle, nullptr, path, "NSF", 11.2, 4.0, 10,
+                                                                      100, true);
+        h.driver->SetGains(demo_config[h.config].lookahead, 0.5, 0.0, 0.0, demo_config[h.config].speed_gain_p, 0.01,
+                           0.0);
+        if (path_table)
+            h.driver->UsePathTable();
+        h.driver->Initialize();
+
+        auto interest = chrono_types::make_shared<ChInterestManager>(interest_radius);
+        h.agent->SetProcessMessageCallback(std::bind(&VehicleProcessMessageCallback, std::placeholders::_1,
+                                                     std::ref(*h.vehicle), h.agent, h.driver, interest));
+    }
+    ChTaskPool task_pool(std::max(1, std::min((int)hosted.size() - 1, (int)std::thread::hardware_concurrency() - 1)));
+
     // ---------------
     // Simulation loop
     // ---------------
     // Number of simulation steps between miscellaneous events
     int render_steps = (int)std::ceil(render_step_size / step_size);
+    int heartbeat_steps = std::max(1, (int)std::round(heartbeat / step_size));
 
     // Initialize simulation frame counters
     int step_number = 0;
 
-    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
-    double last_time = 0;
+    // Update the sensors only on the steps where one of them is due
+    std::unique_ptr<ChSensorScheduler> sensor_scheduler;
+    if (manager && schedule_sensors)
+        sensor_scheduler = std::unique_ptr<ChSensorScheduler>(new ChSensorScheduler(manager, step_size));
+
+    // Wall-clock profile of the loop sections, reported with the clock time (for the slowest rank with --profile_ranks)
+    enum { SYNC_SECTION, DRIVER_SECTION, VEHICLE_SECTION, TERRAIN_SECTION, APP_SECTION, SCENE_SECTION, SENSOR_SECTION };
+    LoopProfiler profiler({"sync", "driver", "vehicle", "terrain", "app", "scene", "sensors"});
+    profiler.SetGatherRanks(cli.GetAsType<bool>("profile_ranks"));
+
+    // Compact encoding of the state of this vehicle, decoded locally to report its size and error
+    ChCompactStateEncoder state_encoder;
+    ChCompactStateDecoder state_decoder;
+    state_encoder.SetAutoAcknowledge(true);  // MPI delivers every message
+    double state_error = 0;
+    size_t state_frames = 0;
 
     float orbit_radius = 10.f;
     float orbit_rate = .25;
     double time = 0;
     while (app.IsOk() && syn_manager.IsOk() && time < end_time) {
         time = vehicle.GetSystem()->GetChTime();
+        profiler.BeginStep();
 
         // Render scene
         // if (step_number % render_steps == 0)
@@ -624,50 +754,149 @@ int main(int argc, char* argv[]) {
         // Get driver inputs
         ChDriver::Inputs driver_inputs = driver->GetInputs();
 
-        if (node_id == leader && record_inputs) {
-            driver_csv << time << driver_inputs.m_steering << driver_inputs.m_throttle << driver_inputs.m_braking
-                       << std::endl;
-        }
+        if (vehicle_telemetry)
+            vehicle_telemetry->Record(time, vehicle, driver_inputs);
 
         // Update modules (process inputs from other modules)
-        syn_manager.Synchronize(time);  // Synchronize between nodes
-        driver->Synchronize(time);
-        vehicle.Synchronize(time, driver_inputs, terrain);
-        terrain.Synchronize(time);
-        app.Synchronize("", driver_inputs);
+        // The heartbeat exchange blocks; the sync section only measures it (instrumentation only). Overlapping it
+        // with the vehicle step needs a split-phase exchange in SynChronoManager, which cannot be done from here.
+        {
+            LoopProfiler::Scope scope(profiler, SYNC_SECTION);
+            syn_manager.Synchronize(time);  // Synchronize between nodes
+        }
+        if (!hosted.empty() && step_number % heartbeat_steps == 0) {
+            // Vehicles of this node see each other directly
+            for (auto& h : hosted) {
+                UpdateFollowingDistance(vehicle.GetVehicleCOMPos(), *h.vehicle, h.driver);
+                if (callback_driver)
+                    UpdateFollowingDistance(h.vehicle->GetVehicleCOMPos(), vehicle, callback_driver);
+                for (auto& other : hosted) {
+                    if (&other != &h)
+                        UpdateFollowingDistance(other.vehicle->GetVehicleCOMPos(), *h.vehicle, h.driver);
+                }
+            }
+        }
+        {
+            LoopProfiler::Scope scope(profiler, DRIVER_SECTION);
+            driver->Synchronize(time);
+        }
+        {
+            LoopProfiler::Scope scope(profiler, VEHICLE_SECTION);
+            vehicle.Synchronize(time, driver_inputs, terrain);
+            task_pool.ParallelFor(hosted.size(), [&](size_t i) {
+                ChDriver::Inputs hosted_inputs = hosted[i].driver->GetInputs();
+                if (hosted[i].telemetry)
+                    hosted[i].telemetry->Record(time, *hosted[i].vehicle, hosted_inputs);
+                hosted[i].driver->Synchronize(time);
+                hosted[i].vehicle->Synchronize(time, hosted_inputs, terrain);
+            });
+        }
+        {
+            LoopProfiler::Scope scope(profiler, TERRAIN_SECTION);
+            terrain.Synchronize(time);
+        }
+        {
+            LoopProfiler::Scope scope(profiler, APP_SECTION);
+            app.Synchronize("", driver_inputs);
+        }
 
         // Advance simulation for one timestep for all modules
-        driver->Advance(step_size);
-        vehicle.Advance(step_size);
-        terrain.Advance(step_size);
-        app.Advance(step_size);
+        {
+            LoopProfiler::Scope scope(profiler, DRIVER_SECTION);
+            driver->Advance(step_size);
+        }
+        {
+            LoopProfiler::Scope scope(profiler, VEHICLE_SECTION);
+            task_pool.ParallelFor(hosted.size(), [&](size_t i) {
+                hosted[i].driver->Advance(step_size);
+                hosted[i].vehicle->Advance(step_size);
+            });
+            vehicle.Advance(step_size);  // also advances the system, with the hosted vehicles
+        }
+        {
+            LoopProfiler::Scope scope(profiler, TERRAIN_SECTION);
+            terrain.Advance(step_size);
+        }
+        {
+            LoopProfiler::Scope scope(profiler, APP_SECTION);
+            app.Advance(step_size);
+        }
+
+        // Load and release the scene tiles as the vehicle moves
+        if (step_number % render_steps == 0) {
+            LoopProfiler::Scope scope(profiler, SCENE_SECTION);
+            if (scene.Update({vehicle.GetVehiclePos()}) && manager)
+                manager->ReconstructScenes();
+        }
 
         if (manager) {
+            LoopProfiler::Scope scope(profiler, SENSOR_SECTION);
             // if (camera) {
             //     camera->SetOffsetPose(chrono::ChFrame<double>(
             //         {-orbit_radius * cos(time * orbit_rate), -orbit_radius * sin(time * orbit_rate), 1},
             //         Q_from_AngAxis(time * orbit_rate, {0, 0, 1})));
             // }
-            manager->Update();
+            if (sensor_scheduler)
+                sensor_scheduler->Update(time);
+            else
+                manager->Update();
+        }
+
+        if (compact_state && step_number % heartbeat_steps == 0) {
+            std::vector<ChFrame<>> frames = {vehicle.GetChassisBody()->GetFrame_REF_to_abs()};
+            for (auto& axle : vehicle.GetAxles()) {
+                for (auto& wheel : axle->GetWheels()) {
+                    auto state = wheel->GetState();
+                    frames.push_back(ChFrame<>(state.pos, state.rot));
+                }
+            }
+
+            state_frames = frames.size();
+            double state_time;
+            std::vector<ChFrame<>> decoded;
+            if (state_decoder.Decode(state_encoder.Encode(time, frames), state_time, decoded)) {
+                for (size_t i = 0; i < frames.size(); i++)
+                    state_error = std::max(state_error, (decoded[i].GetPos() - frames[i].GetPos()).Length());
+            }
         }
 
         // Increment frame number
         step_number++;
+        profiler.EndStep();
 
         // Log clock time
+        if (step_number % 500 == 0)
+            profiler.Report(time, node_id == leader ? SynLog() : std::cout, node_id == leader, leader);
+        if (telemetry && step_number % 500 == 0) {
+            uint64_t dropped = telemetry->GetNumDropped();
+            if (dropped > telemetry_dropped) {
+                (node_id == leader ? SynLog() : std::cout)
+                    << "Telemetry: " << dropped - telemetry_dropped << " records dropped (ring buffer full), "
+                    << dropped << " in total\n";
+                telemetry_dropped = dropped;
+            }
+        }
         if (step_number % 500 == 0 && node_id == leader) {
-            std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
-            // auto time_span = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()*1000;
-            std::chrono::duration<double> wall_time =
-                std::chrono::duration_cast<std::chrono::duration<double>>(end - start);
-
-            SynLog() << (wall_time.count()) / (time - last_time) << "\n";
-            last_time = time;
-            start = std::chrono::high_resolution_clock::now();
+            if (compact_state) {
+                SynLog() << "Compact state: " << state_encoder.GetBytesPerHeartbeat() << " bytes per heartbeat ("
+                         << ChCompactStateEncoder::GetRawSize(state_frames)
+                         << " as doubles), max position error " << state_error << "\n";
+            }
+            if (sensor_scheduler) {
+                SynLog() << "Sensors: updated on " << sensor_scheduler->GetNumUpdates() << " of "
+                         << sensor_scheduler->GetNumSteps() << " steps, "
+                         << 1e3 * sensor_scheduler->GetUpdateTime() / std::max(1u, sensor_scheduler->GetNumUpdates())
+                         << " ms per update\n";
+                sensor_scheduler->ResetStats();
+            }
         }
     }
-    if (node_id == leader && record_inputs) {
-        driver_csv.write_to_file(driver_file);
+    if (telemetry) {
+        // Convert the inputs of the leader vehicle to the file replayed with --replay
+        telemetry->Close();
+        std::vector<ChTelemetryRecord> records;
+        if (node_id == leader && ReadTelemetryFile(telemetry_file, records))
+            WriteDriverInputs(records, driver_file, node_id);
     }
 
     // Properly shuts down other ranks when one rank ends early
@@ -697,6 +926,10 @@ void AddCommandLineOptions(ChCLI& cli) {
     cli.AddOption<double>("Simulation", "load_radius", "Radius around simulation center to load meshes",
                           std::to_string(loading_radius));
     cli.AddOption<bool>("Simulation", "roads_only", "only load road meshes", std::to_string(load_roads_only));
+    cli.AddOption<bool>("Simulation", "compact_state", "Report the size of the compact state encoding",
+                        std::to_string(compact_state));
+    cli.AddOption<double>("Simulation", "interest_radius", "Radius of the zombies updated on every heartbeat",
+                          std::to_string(interest_radius));
 
     // Irrlicht options
     cli.AddOption<bool>("Irrlicht", "i,irr", "Use irrlicht on rank 0", "false");
@@ -704,11 +937,17 @@ void AddCommandLineOptions(ChCLI& cli) {
 
     // options for human driver
     cli.AddOption<bool>("Simulation", "fullscreen", "Use full screen camera display", std::to_string(use_fullscreen));
-    cli.AddOption<bool>("Simulation", "record", "Record human driver inputs to file", "false");
+    cli.AddOption<bool>("Simulation", "record", "Record driver inputs and telemetry of all agents to file", "false");
     cli.AddOption<bool>("Simulation", "replay", "Replay human driver inputs from file", "false");
 
     // disable sensing for additional vehicles (not rank 0)
     cli.AddOption<bool>("Simulation", "nosensing", "Disable sensing on non-human vehicles", std::to_string(no_sensing));
+    cli.AddOption<bool>("Simulation", "profile_ranks", "Report the loop profile of the slowest rank (collective)",
+                        "false");
+    cli.AddOption<bool>("Simulation", "schedule_sensors", "Update the sensor manager only when a sensor is due",
+                        std::to_string(schedule_sensors));
+    cli.AddOption<bool>("Simulation", "path_table", "Follow the paths on precomputed path tables (no ACC driver)",
+                        std::to_string(path_table));
 
 // SynChrono/DDS options
 #ifdef USE_FAST_DDS
@@ -719,6 +958,8 @@ void AddCommandLineOptions(ChCLI& cli) {
 
     // Other options
     cli.AddOption<int>("Demo", "v,vehicle", "Vehicle Options [0-4]: Sedan, Audi, SUV, Van, Truck, CityBus", "1");
+    cli.AddOption<int>("Demo", "agents_per_node", "Number of vehicles hosted by each node",
+                       std::to_string(agents_per_node));
 }
 
 void GetVehicleModelFiles(VehicleType type,
@@ -780,131 +1021,52 @@ void GetVehicleModelFiles(VehicleType type,
     }
 }
 
-void AddSceneMeshes(ChSystem* chsystem, RigidTerrain* terrain) {
-    // load all meshes in input file, using instancing where possible
-    std::string base_path = GetChronoDataFile("/Environments/SanFrancisco/components_new/");
-    std::string input_file = base_path + "instance_map_03.csv";
-    // std::string input_file = base_path + "instance_map_roads_only.csv";
-
-    std::ifstream infile(input_file);
-    if (!infile.is_open())
-        throw std::runtime_error("Could not open file " + input_file);
-    std::string line, col;
-    std::vector<std::string> result;
-
-    std::unordered_map<std::string, std::shared_ptr<ChTriangleMeshConnected>> mesh_map;
-
-    auto mesh_body = chrono_types::make_shared<ChBody>();
-    mesh_body->SetBodyFixed(true);
-    mesh_body->SetCollide(false);
-    chsystem->Add(mesh_body);
-
-    int meshes_added = 0;
-    int mesh_offset = 0;
-    int num_meshes = 20000;
-
-    if (infile.good()) {
-        int mesh_count = 0;
-        int mesh_limit = mesh_offset + num_meshes;
-        while (std::getline(infile, line) && mesh_count < mesh_limit) {
-            if (mesh_count < mesh_offset) {
-                mesh_count++;
-            } else {
-                mesh_count++;
-                result.clear();
-                std::stringstream ss(line);
-                while (std::getline(ss, col, ',')) {
-                    result.push_back(col);
-                }
-                // std::cout << "Name: " << result[0] << ", mesh: " << result[1] << std::endl;
-                std::string mesh_name = result[0];
-                std::string mesh_obj = base_path + result[1] + ".obj";
-
-                // std::cout << mesh_name << std::endl;
-                if (mesh_name.find("EmissionOn") == std::string::npos) {  // exlude items with
-                                                                          // emission on
-
-                    if (!load_roads_only || mesh_name.find("Road") != std::string::npos) {
-                        ChVector<double> pos = {std::stod(result[2]), std::stod(result[3]), std::stod(result[4])};
-
-                        if ((pos - simulation_center).Length() < loading_radius) {
-                            // check if mesh is in map
-                            bool instance_found = false;
-                            std::shared_ptr<ChTriangleMeshConnected> mmesh;
-                            if (mesh_map.find(mesh_obj) != mesh_map.end()) {
-                                mmesh = mesh_map[mesh_obj];
-                                instance_found = true;
-                            } else {
-                                mmesh = chrono_types::make_shared<ChTriangleMeshConnected>();
-                                mmesh->LoadWavefrontMesh(mesh_obj, false, true);
-                                mesh_map[mesh_obj] = mmesh;
-                            }
-
-                            ChQuaternion<double> rot = {std::stod(result[5]), std::stod(result[6]),
-                                                        std::stod(result[7]), std::stod(result[8])};
-                            ChVector<double> scale = {std::stod(result[9]), std::stod(result[10]),
-                                                      std::stod(result[11])};
-
-                            // if not road, only add visualization with new pos,rot,scale
-                            auto trimesh_shape = chrono_types::make_shared<ChTriangleMeshShape>();
-                            trimesh_shape->SetMesh(mmesh);
-                            trimesh_shape->SetName(mesh_name);
-                            trimesh_shape->SetStatic(true);
-                            trimesh_shape->SetScale(scale);
-                            trimesh_shape->Pos = pos;
-                            trimesh_shape->Rot = ChMatrix33<>(rot);
-
-                            mesh_body->AddAsset(trimesh_shape);
-
-                            meshes_added++;
-                        }
-                    }
-                }
-            }
-        }
-        std::cout << "Total meshes: " << meshes_added << " | Unique meshes: " << mesh_map.size() << std::endl;
-    }
-}
-
 void VehicleProcessMessageCallback(std::shared_ptr<SynMessage> message,
                                    WheeledVehicle& vehicle,
                                    std::shared_ptr<SynWheeledVehicleAgent> agent,
-                                   std::shared_ptr<ChLidarWaypointDriver> driver) {
-    if (auto vehicle_message = std::dynamic_pointer_cast<SynWheeledVehicleStateMessage>(message)) {
-        // The IsInsideBox function will determine whether the a passsed point is inside a box defined by a
-        // front position, back position and the width of the box. Rotation of the vectors are taken into account.
-        // The positions must be in the same reference, i.e. local OR global, not both.
-
-        // First calculate the box
-        // We'll do everything in the local frame
-        double width = 4;
-        double x_min = 0;
-        double x_max = 100;
-        double offset_for_chassis_size = 10;
-
-        double max_angle = vehicle.GetMaxSteeringAngle();
-        double curr_steering = driver->GetSteering();
-
-        ChQuaternion<> q = Q_from_AngZ(max_angle * curr_steering);
-
-        // Get the zombies position relative to this vehicle
-        auto zombie_pos = vehicle_message->chassis.GetFrame().GetPos() - vehicle.GetVehicleCOMPos();
-        zombie_pos = q.RotateBack(vehicle.GetVehicleRot().RotateBack(zombie_pos));
-        // zombie_pos = vehicle.GetVehicleRot().RotateBack(zombie_pos);
-
-        // std::cout<<"Zombie loc: "<<zombie_pos.x()<<", "<<zombie_pos.y()<<", "<<zombie_pos.z()<<std::endl;
-
-        if (zombie_pos.x() < x_max && zombie_pos.x() > x_min && abs(zombie_pos.y()) < width / 2) {
-            driver->SetCurrentDistance(zombie_pos.Length() - offset_for_chassis_size);
-            // std::cout << "Zombie dist: " << zombie_pos.Length() - offset_for_chassis_size << std::endl;
-        }
+                                   std::shared_ptr<ChLidarWaypointDriver> driver,
+                                   std::shared_ptr<ChInterestManager> interest) {
+    interest->SetCenter(vehicle.GetVehicleCOMPos());
+    if (auto vehicle_message = interest->Filter(message))
+        UpdateFollowingDistance(vehicle_message->chassis.GetFrame().GetPos(), vehicle, driver);
+}
 
-        // if (zombie_pos.x() < x_max && zombie_pos.x() > x_min) {
-        //     std::cout << "Zombie loc: " << zombie_pos.x() << ", " << zombie_pos.y() << ", " << zombie_pos.z()
-        //               << std::endl;
+void UpdateFollowingDistance(const ChVector<>& other_pos,
+                             WheeledVehicle& vehicle,
+                             std::shared_ptr<ChLidarWaypointDriver> driver) {
+    // The IsInsideBox function will determine whether the a passsed point is inside a box defined by a
+    // front position, back position and the width of the box. Rotation of the vectors are taken into account.
+    // The positions must be in the same reference, i.e. local OR global, not both.
 
-        //     // driver->SetCurrentDistance(zombie_pos.Length() - offset_for_chassis_size);
-        //     // std::cout << "Zombie dist: " << zombie_pos.Length() - offset_for_chassis_size << std::endl;
-        // }
+    // First calculate the box
+    // We'll do everything in the local frame
+    double width = 4;
+    double x_min = 0;
+    double x_max = 100;
+    double offset_for_chassis_size = 10;
+
+    double max_angle = vehicle.GetMaxSteeringAngle();
+    double curr_steering = driver->GetSteering();
+
+    ChQuaternion<> q = Q_from_AngZ(max_angle * curr_steering);
+
+    // Get the zombies position relative to this vehicle
+    auto zombie_pos = other_pos - vehicle.GetVehicleCOMPos();
+    zombie_pos = q.RotateBack(vehicle.GetVehicleRot().RotateBack(zombie_pos));
+    // zombie_pos = vehicle.GetVehicleRot().RotateBack(zombie_pos);
+
+    // std::cout<<"Zombie loc: "<<zombie_pos.x()<<", "<<zombie_pos.y()<<", "<<zombie_pos.z()<<std::endl;
+
+    if (zombie_pos.x() < x_max && zombie_pos.x() > x_min && abs(zombie_pos.y()) < width / 2) {
+        driver->SetCurrentDistance(zombie_pos.Length() - offset_for_chassis_size);
+        // std::cout << "Zombie dist: " << zombie_pos.Length() - offset_for_chassis_size << std::endl;
     }
+
+    // if (zombie_pos.x() < x_max && zombie_pos.x() > x_min) {
+    //     std::cout << "Zombie loc: " << zombie_pos.x() << ", " << zombie_pos.y() << ", " << zombie_pos.z()
+    //               << std::endl;
+
+    //     // driver->SetCurrentDistance(zombie_pos.Length() - offset_for_chassis_size);
+    //     // std::cout << "Zombie dist: " << zombie_pos.Length() - offset_for_chassis_size << std::endl;
+    // }
 }
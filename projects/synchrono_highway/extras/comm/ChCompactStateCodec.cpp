@@ -0,0 +1,260 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+
+#include "ChCompactStateCodec.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace chrono {
+namespace synchrono {
+
+enum MessageType : uint8_t { KEY_STATE = 0, DELTA_STATE = 1 };
+
+static const double kRotScale = 32767;
+
+// -----------------------------------------------------------------------------
+
+static void WriteVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+static void WriteZigzag(std::vector<uint8_t>& out, int64_t value) {
+    WriteVarint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static void WriteDouble(std::vector<uint8_t>& out, double value) {
+    uint8_t bytes[sizeof(double)];
+    std::memcpy(bytes, &value, sizeof(double));
+    out.insert(out.end(), bytes, bytes + sizeof(double));
+}
+
+// Sequential reader of a message, which fails (and stays failed) on truncated or malformed data
+class MessageReader {
+  public:
+    explicit MessageReader(const std::vector<uint8_t>& message) : m_data(message), m_pos(0), m_ok(true) {}
+
+    bool IsOk() const { return m_ok; }
+
+    uint8_t ReadByte() {
+        if (m_pos >= m_data.size()) {
+            m_ok = false;
+            return 0;
+        }
+        return m_data[m_pos++];
+    }
+
+    uint64_t ReadVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = ReadByte();
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+        m_ok = false;
+        return 0;
+    }
+
+    int64_t ReadZigzag() {
+        uint64_t value = ReadVarint();
+        return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+    }
+
+    double ReadDouble() {
+        double value = 0;
+        if (m_pos + sizeof(double) > m_data.size()) {
+            m_ok = false;
+            return value;
+        }
+        std::memcpy(&value, &m_data[m_pos], sizeof(double));
+        m_pos += sizeof(double);
+        return value;
+    }
+
+  private:
+    const std::vector<uint8_t>& m_data;
+    size_t m_pos;
+    bool m_ok;
+};
+
+// -----------------------------------------------------------------------------
+
+ChCompactStateEncoder::ChCompactStateEncoder(double pos_resolution, int keyframe_interval, int history)
+    : m_pos_resolution(pos_resolution),
+      m_keyframe_interval(keyframe_interval),
+      m_history_size(history),
+      m_auto_ack(false),
+      m_interest_radius(0),
+      m_far_interval(1),
+      m_seq(0),
+      m_last_key(0),
+      m_last_ack(0),
+      m_has_ack(false),
+      m_num_heartbeats(0),
+      m_num_messages(0),
+      m_num_keys(0),
+      m_num_bytes(0) {}
+
+void ChCompactStateEncoder::SetInterestRadius(double radius, int far_interval) {
+    m_interest_radius = radius;
+    m_far_interval = far_interval > 0 ? far_interval : 1;
+}
+
+bool ChCompactStateEncoder::IsOfInterest(const ChVector<>& position, const std::vector<ChVector<>>& receivers) const {
+    if (m_interest_radius <= 0 || m_num_heartbeats % m_far_interval == 0)
+        return true;
+    for (const auto& receiver : receivers) {
+        if ((receiver - position).Length2() < m_interest_radius * m_interest_radius)
+            return true;
+    }
+    return false;
+}
+
+std::vector<uint8_t> ChCompactStateEncoder::Encode(double time, const std::vector<ChFrame<>>& frames) {
+    m_seq++;
+
+    // base state: the last acknowledged state, if still in the history and not due for a key state
+    const ChQuantizedState* base = nullptr;
+    if (m_has_ack && (int)(m_seq - m_last_key) < m_keyframe_interval) {
+        for (const auto& state : m_history) {
+            if (state.seq == m_last_ack && state.values.size() == frames.size())
+                base = &state;
+        }
+    }
+
+    ChQuantizedState state;
+    state.seq = m_seq;
+    if (base) {
+        state.reference = base->reference;
+    } else {
+        // round the reference point to the resolution so that it is exact on both sides
+        ChVector<> ref = frames.empty() ? ChVector<>() : frames[0].GetPos();
+        for (int i = 0; i < 3; i++)
+            state.reference[i] = std::round(ref[i] / m_pos_resolution) * m_pos_resolution;
+        m_last_key = m_seq;
+    }
+
+    state.values.resize(frames.size());
+    for (size_t i = 0; i < frames.size(); i++) {
+        const ChVector<>& pos = frames[i].GetPos();
+        ChQuaternion<> rot = frames[i].GetRot();
+        if (rot.e0() < 0)
+            rot = -rot;
+        auto& values = state.values[i];
+        for (int j = 0; j < 3; j++)
+            values[j] = (int64_t)std::llround((pos[j] - state.reference[j]) / m_pos_resolution);
+        for (int j = 0; j < 4; j++)
+            values[3 + j] = (int64_t)std::llround(rot[j] * kRotScale);
+    }
+
+    std::vector<uint8_t> message;
+    message.push_back(base ? DELTA_STATE : KEY_STATE);
+    WriteVarint(message, state.seq);
+    if (base)
+        WriteVarint(message, state.seq - base->seq);
+    WriteDouble(message, time);
+    WriteVarint(message, frames.size());
+    if (!base) {
+        for (int i = 0; i < 3; i++)
+            WriteDouble(message, state.reference[i]);
+    }
+    for (size_t i = 0; i < frames.size(); i++) {
+        for (int j = 0; j < 7; j++)
+            WriteZigzag(message, state.values[i][j] - (base ? base->values[i][j] : 0));
+    }
+
+    m_history.push_back(std::move(state));
+    while (m_history.size() > m_history_size)
+        m_history.pop_front();
+    if (m_auto_ack)
+        Acknowledge(m_seq);
+
+    m_num_heartbeats++;
+    m_num_messages++;
+    m_num_keys += base ? 0 : 1;
+    m_num_bytes += message.size();
+    return message;
+}
+
+void ChCompactStateEncoder::Acknowledge(uint32_t seq) {
+    if (!m_has_ack || (int32_t)(seq - m_last_ack) > 0) {
+        m_last_ack = seq;
+        m_has_ack = true;
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+ChCompactStateDecoder::ChCompactStateDecoder(double pos_resolution, int history)
+    : m_pos_resolution(pos_resolution), m_history_size(history), m_last_seq(0) {}
+
+bool ChCompactStateDecoder::Decode(const std::vector<uint8_t>& message, double& time, std::vector<ChFrame<>>& frames) {
+    MessageReader reader(message);
+    uint8_t type = reader.ReadByte();
+    if (type != KEY_STATE && type != DELTA_STATE)
+        return false;
+
+    ChQuantizedState state;
+    state.seq = (uint32_t)reader.ReadVarint();
+    const ChQuantizedState* base = nullptr;
+    if (type == DELTA_STATE) {
+        auto found = m_history.find(state.seq - (uint32_t)reader.ReadVarint());
+        if (found == m_history.end())
+            return false;
+        base = &found->second;
+    }
+    double msg_time = reader.ReadDouble();
+    uint64_t num_frames = reader.ReadVarint();
+    if (!reader.IsOk() || num_frames > message.size() || (base && base->values.size() != num_frames))
+        return false;
+
+    if (base) {
+        state.reference = base->reference;
+    } else {
+        for (int i = 0; i < 3; i++)
+            state.reference[i] = reader.ReadDouble();
+    }
+    state.values.resize(num_frames);
+    for (size_t i = 0; i < num_frames; i++) {
+        for (int j = 0; j < 7; j++)
+            state.values[i][j] = reader.ReadZigzag() + (base ? base->values[i][j] : 0);
+    }
+    if (!reader.IsOk())
+        return false;
+
+    time = msg_time;
+    frames.resize(num_frames);
+    for (size_t i = 0; i < num_frames; i++) {
+        const auto& values = state.values[i];
+        ChVector<> pos;
+        for (int j = 0; j < 3; j++)
+            pos[j] = state.reference[j] + values[j] * m_pos_resolution;
+        ChQuaternion<> rot(values[3] / kRotScale, values[4] / kRotScale, values[5] / kRotScale,
+                           values[6] / kRotScale);
+        rot.Normalize();
+        frames[i] = ChFrame<>(pos, rot);
+    }
+
+    m_last_seq = state.seq;
+    m_history[state.seq] = std::move(state);
+    while (m_history.size() > m_history_size)
+        m_history.erase(m_history.begin());
+    return true;
+}
+
+}  // namespace synchrono
+}  // namespace chrono
@@ -0,0 +1,138 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Compact encoding of the state of an agent (chassis and wheel frames).
+//
+// Positions are quantized (default 1 mm) relative to a per-agent reference
+// point, set to the chassis position at each key state; rotations are
+// quantized as the four quaternion components (scale 32767, w >= 0). A state
+// is sent as a key state or as the difference of its quantized values with the
+// last acknowledged state still in the encoder history, all integers written
+// as zigzag varints, so a vehicle moving smoothly costs about one byte per
+// component. Key states are forced periodically so late receivers can join.
+//
+// With a reliable transport (e.g. MPI), every encoded state can be considered
+// acknowledged (SetAutoAcknowledge). Interest management skips the states on
+// heartbeats where no receiver is within the interest radius, except every
+// far interval.
+//
+// Message layout:
+//   uint8  type (0: key, 1: delta)
+//   varint sequence number
+//   varint sequence offset of the base state (delta only)
+//   double time
+//   varint number of frames
+//   double reference point x, y, z (key only)
+//   per frame: zigzag varints of the 3 position and 4 rotation values (or of
+//   their differences with the base state)
+//
+// =============================================================================
+
+#ifndef CH_COMPACT_STATE_CODEC_H
+#define CH_COMPACT_STATE_CODEC_H
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "chrono/core/ChFrame.h"
+
+namespace chrono {
+namespace synchrono {
+
+/// Quantized state of an agent, shared by the encoder and the decoder.
+struct ChQuantizedState {
+    uint32_t seq = 0;                                ///< sequence number
+    std::array<double, 3> reference;                 ///< reference point of the positions
+    std::vector<std::array<int64_t, 7>> values;      ///< quantized position and rotation of each frame
+};
+
+class ChCompactStateEncoder {
+  public:
+    ChCompactStateEncoder(double pos_resolution = 1e-3,  ///< position quantization step
+                          int keyframe_interval = 100,   ///< maximum number of states between key states
+                          int history = 16               ///< number of sent states kept as delta bases
+    );
+
+    /// Consider every encoded state acknowledged (reliable transports, default: false).
+    void SetAutoAcknowledge(bool auto_ack) { m_auto_ack = auto_ack; }
+
+    /// Send the states only to receivers within the given radius, and to all receivers every far_interval heartbeats.
+    void SetInterestRadius(double radius, int far_interval = 10);
+
+    /// Return true if the state should be sent on this heartbeat, given the positions of the receivers.
+    bool IsOfInterest(const ChVector<>& position, const std::vector<ChVector<>>& receivers) const;
+
+    /// Encode the given frames; the first frame is the chassis and sets the reference point of key states.
+    std::vector<uint8_t> Encode(double time, const std::vector<ChFrame<>>& frames);
+
+    /// Record that the receivers have the state with the given sequence number.
+    void Acknowledge(uint32_t seq);
+
+    /// Count a heartbeat on which no state was sent (e.g. no receiver of interest).
+    void Skip() { m_num_heartbeats++; }
+
+    /// Return the message statistics.
+    unsigned int GetNumHeartbeats() const { return m_num_heartbeats; }
+    unsigned int GetNumMessages() const { return m_num_messages; }
+    unsigned int GetNumKeyStates() const { return m_num_keys; }
+    double GetBytesPerHeartbeat() const { return m_num_heartbeats ? (double)m_num_bytes / m_num_heartbeats : 0; }
+
+    /// Size of the same frames sent as doubles (time, positions, and quaternions), for comparison.
+    static size_t GetRawSize(size_t num_frames) { return sizeof(double) * (1 + 7 * num_frames); }
+
+  private:
+    double m_pos_resolution;
+    int m_keyframe_interval;
+    size_t m_history_size;
+    bool m_auto_ack;
+    double m_interest_radius;
+    int m_far_interval;
+
+    uint32_t m_seq;
+    uint32_t m_last_key;
+    uint32_t m_last_ack;
+    bool m_has_ack;
+    std::deque<ChQuantizedState> m_history;
+
+    unsigned int m_num_heartbeats;
+    unsigned int m_num_messages;
+    unsigned int m_num_keys;
+    uint64_t m_num_bytes;
+};
+
+class ChCompactStateDecoder {
+  public:
+    ChCompactStateDecoder(double pos_resolution = 1e-3,  ///< position quantization step (as in the encoder)
+                          int history = 64               ///< number of decoded states kept as delta bases
+    );
+
+    /// Decode a message. Return false if it is malformed or if its base state was not received (wait for the next
+    /// key state).
+    bool Decode(const std::vector<uint8_t>& message, double& time, std::vector<ChFrame<>>& frames);
+
+    /// Return the sequence number of the last decoded state (to acknowledge).
+    uint32_t GetLastSequence() const { return m_last_seq; }
+
+  private:
+    double m_pos_resolution;
+    size_t m_history_size;
+    uint32_t m_last_seq;
+    std::map<uint32_t, ChQuantizedState> m_history;
+};
+
+}  // namespace synchrono
+}  // namespace chrono
+
+#endif
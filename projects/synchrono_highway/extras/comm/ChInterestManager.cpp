@@ -0,0 +1,50 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+
+#include "ChInterestManager.h"
+
+namespace chrono {
+namespace synchrono {
+
+ChInterestManager::ChInterestManager(double radius, int far_interval)
+    : m_radius(radius),
+      m_far_interval(far_interval > 0 ? far_interval : 1),
+      m_num_delivered(0),
+      m_num_refreshed(0),
+      m_num_throttled(0) {}
+
+std::shared_ptr<SynWheeledVehicleStateMessage> ChInterestManager::Filter(std::shared_ptr<SynMessage> message) {
+    Source& source = m_sources[message->GetSourceKey()];
+
+    // far agents: only look at one message in far_interval
+    if (source.known && !source.inside && ++source.skipped < m_far_interval) {
+        m_num_throttled++;
+        return nullptr;
+    }
+
+    auto vehicle_message = std::dynamic_pointer_cast<SynWheeledVehicleStateMessage>(message);
+    if (!vehicle_message)
+        return nullptr;
+
+    source.known = true;
+    source.inside = (vehicle_message->chassis.GetFrame().GetPos() - m_center).Length2() < m_radius * m_radius;
+    source.skipped = 0;
+    if (!source.inside) {
+        m_num_refreshed++;
+        return nullptr;
+    }
+    m_num_delivered++;
+    return vehicle_message;
+}
+
+}  // namespace synchrono
+}  // namespace chrono
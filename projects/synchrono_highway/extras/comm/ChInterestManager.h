@@ -0,0 +1,73 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Distance-based interest management of the zombie states received by an
+// agent.
+//
+// The agent declares an interest region (a radius around a point, e.g. its
+// own position). State messages of agents inside the region are delivered on
+// every heartbeat. Agents last seen outside of it are throttled: their
+// messages are dropped by source key, without being decoded, except every far
+// interval, when their position is refreshed (so an agent entering the region
+// is picked up within far_interval heartbeats).
+//
+// =============================================================================
+
+#ifndef CH_INTEREST_MANAGER_H
+#define CH_INTEREST_MANAGER_H
+
+#include <map>
+#include <memory>
+
+#include "chrono_synchrono/agent/SynWheeledVehicleAgent.h"
+
+namespace chrono {
+namespace synchrono {
+
+class ChInterestManager {
+  public:
+    ChInterestManager(double radius = 150,   ///< radius of the interest region
+                      int far_interval = 10  ///< heartbeats between the updates of the agents outside of the region
+    );
+
+    /// Set the center of the interest region (e.g. the position of the agent, on every step).
+    void SetCenter(const ChVector<>& center) { m_center = center; }
+
+    /// Return the state message if it comes from an agent inside the interest region, a null pointer otherwise.
+    std::shared_ptr<SynWheeledVehicleStateMessage> Filter(std::shared_ptr<SynMessage> message);
+
+    /// Return the number of state messages delivered, refreshing a far agent, and dropped without decoding.
+    unsigned int GetNumDelivered() const { return m_num_delivered; }
+    unsigned int GetNumRefreshed() const { return m_num_refreshed; }
+    unsigned int GetNumThrottled() const { return m_num_throttled; }
+
+  private:
+    struct Source {
+        bool known = false;  ///< a state of this agent was received
+        bool inside = false; ///< the agent was inside the region at its last received state
+        int skipped = 0;     ///< messages dropped since the last received state
+    };
+
+    double m_radius;
+    int m_far_interval;
+    ChVector<> m_center;
+    std::map<AgentKey, Source> m_sources;
+
+    unsigned int m_num_delivered;
+    unsigned int m_num_refreshed;
+    unsigned int m_num_throttled;
+};
+
+}  // namespace synchrono
+}  // namespace chrono
+
+#endif
@@ -0,0 +1,153 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+
+#include "ChBezierPathTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace chrono {
+namespace synchrono {
+
+// Number of samples per segment used to bound the segments
+static const int kBoxSamples = 8;
+
+ChBezierPathTracker::ChBezierPathTracker(std::shared_ptr<ChBezierCurve> path,
+                                         bool closed,
+                                         int window,
+                                         double jump_distance)
+    : m_path(path),
+      m_closed(closed),
+      m_window(std::max(window, 1)),
+      m_jump_distance(jump_distance),
+      m_valid(false),
+      m_segment(0),
+      m_t(0),
+      m_num_projections(0) {
+    m_num_segments = m_path->getNumPoints() > 1 ? m_path->getNumPoints() - 1 : 0;
+
+    // Bounding box of each segment, from samples along the segment, padded by the largest chord between samples
+    // (which bounds the deviation of the curve from the sampled polyline for these smooth segments)
+    m_boxes.resize(m_num_segments);
+    for (size_t i = 0; i < m_num_segments; i++) {
+        ChVector<> prev = m_path->eval(i, 0.0);
+        Box box = {prev, prev};
+        double pad = 0;
+        for (int k = 1; k <= kBoxSamples; k++) {
+            ChVector<> p = m_path->eval(i, (double)k / kBoxSamples);
+            for (int j = 0; j < 3; j++) {
+                box.min[j] = std::min(box.min[j], p[j]);
+                box.max[j] = std::max(box.max[j], p[j]);
+            }
+            pad = std::max(pad, (p - prev).Length());
+            prev = p;
+        }
+        box.min -= ChVector<>(pad);
+        box.max += ChVector<>(pad);
+        m_boxes[i] = box;
+    }
+}
+
+ChVector<> ChBezierPathTracker::FindClosestPoint(const ChVector<>& loc, size_t& segment, double& t) {
+    m_num_projections = 0;
+    ChVector<> point = m_path->getNumPoints() > 0 ? m_path->getPoint(0) : loc;
+    if (m_num_segments == 0) {
+        segment = 0;
+        t = 0;
+        return point;
+    }
+
+    double dist = m_valid ? SearchWindow(loc, point) : std::numeric_limits<double>::max();
+    if (dist > m_jump_distance)
+        SearchAll(loc, point);
+
+    m_valid = true;
+    segment = m_segment;
+    t = m_t;
+    return point;
+}
+
+double ChBezierPathTracker::SearchWindow(const ChVector<>& loc, ChVector<>& point) {
+    double best = std::numeric_limits<double>::max();
+    long long center = (long long)m_segment;
+
+    // Slide the window while the minimum is at the outer end of one of its end segments (the best distance only
+    // decreases, so the window cannot move back and forth)
+    for (size_t moves = 0; moves <= m_num_segments; moves++) {
+        long long first = center - m_window;
+        long long last = center + m_window;
+        if (!m_closed) {
+            first = std::max(first, 0LL);
+            last = std::min(last, (long long)m_num_segments - 1);
+        }
+        for (long long i = first; i <= last; i++)
+            Project(loc, Wrap(i), best, point);
+
+        long long next = center;
+        if (m_segment == Wrap(first) && m_t <= 0 && (m_closed || first > 0))
+            next = first;
+        else if (m_segment == Wrap(last) && m_t >= 1 && (m_closed || last < (long long)m_num_segments - 1))
+            next = last;
+        if (next == center)
+            break;
+        center = next;
+    }
+
+    return best;
+}
+
+double ChBezierPathTracker::SearchAll(const ChVector<>& loc, ChVector<>& point) {
+    // Distance from the location to each segment box (zero inside)
+    std::vector<std::pair<double, size_t>> order(m_num_segments);
+    for (size_t i = 0; i < m_num_segments; i++) {
+        const Box& box = m_boxes[i];
+        double d2 = 0;
+        for (int j = 0; j < 3; j++) {
+            double e = std::max(std::max(box.min[j] - loc[j], loc[j] - box.max[j]), 0.0);
+            d2 += e * e;
+        }
+        order[i] = std::make_pair(std::sqrt(d2), i);
+    }
+    std::sort(order.begin(), order.end());
+
+    double best = std::numeric_limits<double>::max();
+    for (const auto& entry : order) {
+        if (entry.first > best)
+            break;
+        Project(loc, entry.second, best, point);
+    }
+    return best;
+}
+
+double ChBezierPathTracker::Project(const ChVector<>& loc, size_t segment, double& best, ChVector<>& point) {
+    double t;
+    ChVector<> p = m_path->calcClosestPoint(loc, segment, t);
+    m_num_projections++;
+    double d = (p - loc).Length();
+    if (d < best) {
+        best = d;
+        point = p;
+        m_segment = segment;
+        m_t = t;
+    }
+    return d;
+}
+
+size_t ChBezierPathTracker::Wrap(long long segment) const {
+    long long n = (long long)m_num_segments;
+    return (size_t)(((segment % n) + n) % n);
+}
+
+}  // namespace synchrono
+}  // namespace chrono
@@ -0,0 +1,88 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Incremental closest-point tracker on a Bezier path.
+//
+// The tracker remembers the segment of the last closest point and searches a
+// small window of segments around it, sliding the window while the minimum
+// lies at one of its ends. If there is no previous segment, or the closest
+// point found is farther than a jump distance (e.g., the query point moved to
+// another part of the path), all segments are searched in order of increasing
+// distance to precomputed segment bounding boxes, stopping as soon as the box
+// distance exceeds the best distance found.
+//
+// =============================================================================
+
+#ifndef CH_BEZIER_PATH_TRACKER_H
+#define CH_BEZIER_PATH_TRACKER_H
+
+#include <memory>
+#include <vector>
+
+#include "chrono/core/ChBezierCurve.h"
+#include "chrono/core/ChVector.h"
+
+namespace chrono {
+namespace synchrono {
+
+class ChBezierPathTracker {
+  public:
+    /// Construct a tracker for the given path.
+    ChBezierPathTracker(std::shared_ptr<ChBezierCurve> path,  ///< tracked path
+                        bool closed,                          ///< treat the path as a closed loop
+                        int window = 2,                       ///< segments searched on each side of the last one
+                        double jump_distance = 10             ///< distance beyond which a full search is done
+    );
+
+    /// Return the closest point on the path to the given location, as well as its segment and curve parameter.
+    ChVector<> FindClosestPoint(const ChVector<>& loc, size_t& segment, double& t);
+
+    /// Forget the last segment (the next query does a full search).
+    void Reset() { m_valid = false; }
+
+    /// Return the number of segments projected on (calls to calcClosestPoint) by the last query.
+    int GetNumProjections() const { return m_num_projections; }
+
+  private:
+    struct Box {
+        ChVector<> min;
+        ChVector<> max;
+    };
+
+    /// Search the segments of the window around the last segment.
+    double SearchWindow(const ChVector<>& loc, ChVector<>& point);
+
+    /// Search all segments, in order of increasing bounding box distance.
+    double SearchAll(const ChVector<>& loc, ChVector<>& point);
+
+    /// Project on one segment; update the best point if closer. Return the distance.
+    double Project(const ChVector<>& loc, size_t segment, double& best, ChVector<>& point);
+
+    size_t Wrap(long long segment) const;
+
+    std::shared_ptr<ChBezierCurve> m_path;
+    bool m_closed;
+    int m_window;
+    double m_jump_distance;
+    size_t m_num_segments;
+    std::vector<Box> m_boxes;
+
+    bool m_valid;
+    size_t m_segment;
+    double m_t;
+    int m_num_projections;
+};
+
+}  // namespace synchrono
+}  // namespace chrono
+
+#endif
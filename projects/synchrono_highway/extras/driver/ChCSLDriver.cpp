@@ -219,6 +219,10 @@ void ChCSLDriver::SetInputMode(InputMode mode) {
 // -----------------------------------------------------------------------------
 // -----------------------------------------------------------------------------
 void ChCSLDriver::Synchronize(double time) {
+    // Record the inputs used by the vehicle for this step.
+    if (m_telemetry)
+        m_telemetry->Record(time, m_vehicle, GetInputs());
+
     // Do nothing if no embedded DataDriver.
     if (m_mode != DATAFILE || !m_data_driver)
         return;
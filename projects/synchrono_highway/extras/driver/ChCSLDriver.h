@@ -28,6 +28,8 @@
 #include "chrono_vehicle/ChDriver.h"
 #include "chrono_vehicle/driver/ChDataDriver.h"
 
+#include "../utils/ChTelemetryRecorder.h"
+
 using namespace chrono::vehicle;
 
 class Joystick;
@@ -92,6 +94,9 @@ class CH_VEHICLE_API ChCSLDriver : public ChDriver {
 
     void SetReverse(bool reverse) { is_reverse = reverse; }
 
+    /// Record the driver inputs at each synchronization in the given telemetry channel (nullptr: no recording).
+    void SetTelemetryChannel(ChTelemetryRecorder::Channel* channel) { m_telemetry = channel; }
+
   protected:
 		std::shared_ptr<Joystick> m_joystick;
     bool is_reverse = false;
@@ -119,6 +124,8 @@ class CH_VEHICLE_API ChCSLDriver : public ChDriver {
     // Variables for mode=DATAFILE
     double m_time_shift;                          ///< time at which mode was switched to DATAFILE
     std::shared_ptr<ChDataDriver> m_data_driver;  ///< embedded data driver (for playback)
+
+    ChTelemetryRecorder::Channel* m_telemetry = nullptr;  ///< channel recording the inputs (not owned)
 };
 
 }  // namespace synchrono
@@ -24,6 +24,7 @@
 
 #include <algorithm>
 #include <climits>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -43,7 +44,14 @@ ChLidarWaypointDriver::ChLidarWaypointDriver(ChVehicle& vehicle,
                                              double current_distance,  ///< current distance to the vehicle in front
                                              bool isClosedPath         ///< Treat the path as a closed loop
                                              )
-    : ChDriver(vehicle), m_lidar(lidar), m_target_speed(target_speed), m_path(path), m_current_distance(100.0) {
+    : ChDriver(vehicle),
+      m_lidar(lidar),
+      m_target_speed(target_speed),
+      m_target_following_time(target_following_time),
+      m_target_min_distance(target_min_distance),
+      m_closed_path(isClosedPath),
+      m_path(path),
+      m_current_distance(100.0) {
     m_acc_driver = chrono_types::make_shared<ChPathFollowerACCDriver>(vehicle, path, path_name, target_speed,
                                                                       target_following_time, target_min_distance,
                                                                       current_distance, isClosedPath);
@@ -52,6 +60,8 @@ ChLidarWaypointDriver::ChLidarWaypointDriver(ChVehicle& vehicle,
     m_acc_driver->GetSteeringController().SetLookAheadDistance(8.0);
     m_acc_driver->Initialize();
     m_acc_driver->Reset();
+
+    m_path_tracker = std::unique_ptr<ChBezierPathTracker>(new ChBezierPathTracker(path, isClosedPath));
 }
 
 // -----------------------------------------------------------------------------
@@ -67,6 +77,22 @@ void ChLidarWaypointDriver::SetGains(double lookahead,
     m_acc_driver->GetSpeedController().SetGains(p_acc, i_acc, d_acc);
     m_acc_driver->GetSteeringController().SetGains(p_steer, i_steer, d_steer);
     m_acc_driver->GetSteeringController().SetLookAheadDistance(lookahead);
+
+    double gains[7] = {lookahead, p_steer, i_steer, d_steer, p_acc, i_acc, d_acc};
+    std::copy(gains, gains + 7, m_gains);
+    if (m_table_follower) {
+        m_table_follower->SetLookAheadDistance(lookahead);
+        m_table_follower->SetSteeringGains(p_steer, i_steer, d_steer);
+        m_table_follower->SetSpeedGains(p_acc, i_acc, d_acc);
+    }
+}
+
+void ChLidarWaypointDriver::UsePathTable(double spacing) {
+    m_table_follower = std::unique_ptr<ChPathTableFollower>(new ChPathTableFollower(
+        m_path, m_closed_path, m_target_speed, m_target_following_time, m_target_min_distance, spacing));
+    m_table_follower->SetLookAheadDistance(m_gains[0]);
+    m_table_follower->SetSteeringGains(m_gains[1], m_gains[2], m_gains[3]);
+    m_table_follower->SetSpeedGains(m_gains[4], m_gains[5], m_gains[6]);
 }
 
 // -----------------------------------------------------------------------------
@@ -99,6 +125,18 @@ void ChLidarWaypointDriver::MinDistFromLidar() {
     double curr_steering = m_steering;
     ChQuaternion<> q = Q_from_AngZ(max_angle * curr_steering);
 
+    // box test and reduction done in the lidar filter graph
+    if (m_roi_filter) {
+        m_roi_filter->SetYaw((float)(max_angle * curr_steering));
+        float time_stamp;
+        float dist = m_roi_filter->GetMinDistance(time_stamp);
+        if (time_stamp > m_last_lidar_time + update_period) {
+            m_last_lidar_time = time_stamp;
+            m_current_distance = std::min((double)dist, min_distance);
+        }
+        return;
+    }
+
     UserXYZIBufferPtr xyzi_buffer = m_lidar->GetMostRecentBuffer<UserXYZIBufferPtr>();
     if (xyzi_buffer->TimeStamp > m_last_lidar_time + update_period) {
         m_last_lidar_time = xyzi_buffer->TimeStamp;
@@ -135,38 +173,51 @@ void ChLidarWaypointDriver::Advance(double step) {
     // calculate a new current speed using the path curvature
     double curve_location_const = 4.0;
 
+    const ChVector<>& target_location = m_table_follower ? m_table_follower->GetTargetLocation()
+                                                         : m_acc_driver->GetSteeringController().GetTargetLocation();
     ChVector<double> curvature_location =
-        m_vehicle.GetVehiclePos() +
-        curve_location_const * (m_acc_driver->GetSteeringController().GetTargetLocation() - m_vehicle.GetVehiclePos());
-
-    double t;
-    double t_actual;
-    double min_dist = 1e6;
-    int segment = 0;
-    for (int i = 0; i < m_path->getNumPoints()-1; i++) {
-        ChVector<> loc = m_path->calcClosestPoint(curvature_location, i, t);
-        double tmp_min_dist = (loc - curvature_location).Length();
-        if (tmp_min_dist < min_dist) {
-            min_dist = tmp_min_dist;
-            segment = i;
-            t_actual = t;
-        }
+        m_vehicle.GetVehiclePos() + curve_location_const * (target_location - m_vehicle.GetVehiclePos());
+
+    ChVector<> d;
+    double curvature = 0;
+    if (m_table_follower) {
+        d = m_table_follower->GetPathTangent(curvature_location, curvature);
+    } else {
+        size_t segment;
+        double t_actual;
+        m_path_tracker->FindClosestPoint(curvature_location, segment, t_actual);
+        d = m_path->evalD(segment, t_actual);
+        d.Normalize();
     }
-
-    ChVector<> d = m_path->evalD(segment, t_actual);
-    d.Normalize();
     ChVector<> heading = m_vehicle.GetVehicleRot().Rotate({1, 0, 0});
     double dotangle = d.Dot(heading);
 
-    m_acc_driver->SetDesiredSpeed(m_target_speed * std::max(0.3, dotangle * 1.5 - .5));
+    double desired_speed = m_target_speed * std::max(0.3, dotangle * 1.5 - .5);
+    if (m_max_lat_acc > 0 && curvature > 0)
+        desired_speed = std::min(desired_speed, std::sqrt(m_max_lat_acc / curvature));
     // std::cout << "Speed: " << m_target_speed * std::max(0.3, dotangle * 2.0 - 1.0) << std::endl;
-    m_acc_driver->SetCurrentDistance(m_current_distance);
-    m_acc_driver->Advance(step);
+
+    double throttle, steering, braking;
+    if (m_table_follower) {
+        m_table_follower->SetDesiredSpeed(desired_speed);
+        m_table_follower->SetCurrentDistance(m_current_distance);
+        m_table_follower->Advance(m_vehicle, step);
+        throttle = m_table_follower->GetThrottle();
+        steering = m_table_follower->GetSteering();
+        braking = m_table_follower->GetBraking();
+    } else {
+        m_acc_driver->SetDesiredSpeed(desired_speed);
+        m_acc_driver->SetCurrentDistance(m_current_distance);
+        m_acc_driver->Advance(step);
+        throttle = m_acc_driver->GetThrottle();
+        steering = m_acc_driver->GetSteering();
+        braking = m_acc_driver->GetBraking();
+    }
 
     double max_dt = 0.01;
-    m_throttle = ChClamp(m_acc_driver->GetThrottle(), m_throttle - max_dt, m_throttle + max_dt);
-    m_steering = ChClamp(m_acc_driver->GetSteering(), m_steering - max_dt, m_steering + max_dt);
-    m_braking = ChClamp(m_acc_driver->GetBraking(), m_braking - max_dt, m_braking + max_dt);
+    m_throttle = ChClamp(throttle, m_throttle - max_dt, m_throttle + max_dt);
+    m_steering = ChClamp(steering, m_steering - max_dt, m_steering + max_dt);
+    m_braking = ChClamp(braking, m_braking - max_dt, m_braking + max_dt);
 }
 
 }  // namespace synchrono
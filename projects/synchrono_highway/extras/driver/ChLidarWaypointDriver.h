@@ -30,6 +30,10 @@
 #include "chrono_vehicle/driver/ChDataDriver.h"
 #include "chrono_vehicle/driver/ChPathFollowerACCDriver.h"
 
+#include "../filters/ChFilterLidarROIMin.h"
+#include "ChBezierPathTracker.h"
+#include "ChPathTableFollower.h"
+
 using namespace chrono::vehicle;
 using namespace chrono::sensor;
 
@@ -68,6 +72,10 @@ class CH_VEHICLE_API ChLidarWaypointDriver : public ChDriver {
         last_dist_update_time = m_current_time;
     }
 
+    /// Use the minimum distance computed on the device by the given filter (attached to the lidar, with the box of
+    /// interest of the driver), instead of reducing the full point cloud on the host.
+    void SetLidarROIFilter(std::shared_ptr<ChFilterLidarROIMin> filter) { m_roi_filter = filter; }
+
     /// Set gains for internal dynamics.
     void SetGains(double lookahead,
                   double p_steer,
@@ -77,19 +85,36 @@ class CH_VEHICLE_API ChLidarWaypointDriver : public ChDriver {
                   double i_acc,
                   double d_acc);
 
+    /// Follow the path with the controls of ChPathFollowerACCDriver evaluated on a table of the path sampled at the
+    /// given arc-length spacing (see ChPathTableFollower.h), instead of the ACC driver and the Bezier closest-point
+    /// searches. The current gains are kept.
+    void UsePathTable(double spacing = 0.5);
+
+    /// Limit the desired speed by the lateral acceleration in the upcoming curve (path table only; default: 0, no
+    /// limit).
+    void SetMaxLateralAcceleration(double acc) { m_max_lat_acc = acc; }
+
   private:
     void MinDistFromLidar();
 
     std::shared_ptr<ChLidarSensor> m_lidar;
+    std::shared_ptr<ChFilterLidarROIMin> m_roi_filter;
     double m_current_distance;
     double m_last_lidar_time = 0;
     double next_dist_reset_time = 0;
     double last_dist_update_time = 0;
     double m_target_speed;
+    double m_target_following_time;
+    double m_target_min_distance;
+    bool m_closed_path;
     double m_current_time = 0;
+    double m_max_lat_acc = 0;
+    double m_gains[7] = {8.0, 0.5, 0, 0, 0.5, 0, 0};  ///< lookahead, steering and speed PID gains
     std::shared_ptr<ChBezierCurve> m_path;
+    std::unique_ptr<ChBezierPathTracker> m_path_tracker;  ///< closest point search for the curvature location
 
     std::shared_ptr<ChPathFollowerACCDriver> m_acc_driver;  ///< underlying acc driver
+    std::unique_ptr<ChPathTableFollower> m_table_follower;  ///< path table follower (replaces the acc driver if set)
 };
 
 }  // namespace synchrono
@@ -0,0 +1,254 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+
+#include "ChPathTableFollower.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "chrono/core/ChMathematics.h"
+
+namespace chrono {
+namespace synchrono {
+
+// Number of samples per Bezier segment used to compute the arc length
+static const int kArcSamples = 32;
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+ChPathTable::ChPathTable(std::shared_ptr<ChBezierCurve> path, bool closed, double spacing, double jump_distance)
+    : m_closed(closed), m_jump_distance(jump_distance), m_length(0) {
+    size_t num_points = path->getNumPoints();
+    size_t num_segments = num_points > 1 ? num_points - 1 : 0;
+    if (num_segments == 0) {
+        if (num_points == 1)
+            m_samples.push_back({path->getPoint(0), ChVector<>(1, 0, 0), 0, 0});
+        return;
+    }
+
+    // Arc length at dense samples along the path
+    std::vector<double> arc(num_segments * kArcSamples + 1);
+    arc[0] = 0;
+    ChVector<> prev = path->eval(0, 0.0);
+    for (size_t i = 0; i < num_segments; i++) {
+        for (int k = 1; k <= kArcSamples; k++) {
+            ChVector<> p = path->eval(i, (double)k / kArcSamples);
+            arc[i * kArcSamples + k] = arc[i * kArcSamples + k - 1] + (p - prev).Length();
+            prev = p;
+        }
+    }
+    m_length = arc.back();
+
+    // Samples at uniform arc length (for a closed path, the chord from the last sample to the first closes the loop)
+    size_t num_chords = std::max((size_t)2, (size_t)std::ceil(m_length / std::max(spacing, 1e-6)));
+    size_t num_samples = closed ? num_chords : num_chords + 1;
+    double ds = m_length / num_chords;
+    m_samples.resize(num_samples);
+    size_t q = 0;
+    ChVector<> tangent(1, 0, 0);
+    for (size_t j = 0; j < num_samples; j++) {
+        double s = j * ds;
+        while (q + 2 < arc.size() && arc[q + 1] < s)
+            q++;
+        double h = arc[q + 1] - arc[q];
+        double u = (q + (h > 0 ? ChClamp((s - arc[q]) / h, 0.0, 1.0) : 0.0)) / kArcSamples;
+        size_t segment = std::min((size_t)u, num_segments - 1);
+        double t = u - segment;
+
+        ChVector<> d = path->evalD(segment, t);
+        ChVector<> dd = path->evalDD(segment, t);
+        double speed = d.Length();
+        if (speed > 0)
+            tangent = d / speed;
+        double curvature = speed > 0 ? Vcross(d, dd).Length() / (speed * speed * speed) : 0;
+        m_samples[j] = {path->eval(segment, t), tangent, s, curvature};
+    }
+}
+
+ChVector<> ChPathTable::FindClosestPoint(const ChVector<>& loc, size_t& index, double& frac) const {
+    size_t n = m_samples.size();
+    frac = 0;
+    if (n < 2) {
+        index = 0;
+        return n == 1 ? m_samples[0].pos : loc;
+    }
+
+    // Walk from the previous sample while the distance decreases
+    size_t i = index;
+    bool full_search = i >= n;
+    if (!full_search) {
+        double d2 = Distance2(loc, i);
+        for (size_t moves = 0; moves < n; moves++) {
+            size_t next = Next(i);
+            size_t prev = Prev(i);
+            double d2_next = Distance2(loc, next);
+            double d2_prev = Distance2(loc, prev);
+            if (d2_next < d2 && d2_next <= d2_prev) {
+                i = next;
+                d2 = d2_next;
+            } else if (d2_prev < d2) {
+                i = prev;
+                d2 = d2_prev;
+            } else {
+                break;
+            }
+        }
+        full_search = d2 > m_jump_distance * m_jump_distance;
+    }
+    if (full_search) {
+        double d2 = std::numeric_limits<double>::max();
+        for (size_t k = 0; k < n; k++) {
+            double d2_k = Distance2(loc, k);
+            if (d2_k < d2) {
+                d2 = d2_k;
+                i = k;
+            }
+        }
+    }
+
+    // Project on the chords on each side of the closest sample
+    ChVector<> point = m_samples[i].pos;
+    index = i;
+    double best = std::numeric_limits<double>::max();
+    size_t chords[2] = {Prev(i), i};
+    for (size_t c : chords) {
+        if (Next(c) == c)
+            continue;  // no chord after the last sample of an open path
+        double f;
+        ChVector<> p;
+        double d2 = ProjectChord(loc, c, f, p);
+        if (d2 < best) {
+            best = d2;
+            point = p;
+            index = c;
+            frac = f;
+        }
+    }
+    return point;
+}
+
+ChVector<> ChPathTable::GetTangent(size_t index, double frac, double& curvature) const {
+    if (m_samples.empty()) {
+        curvature = 0;
+        return ChVector<>(1, 0, 0);
+    }
+    const Sample& a = m_samples[index];
+    const Sample& b = m_samples[Next(index)];
+    curvature = a.curvature + frac * (b.curvature - a.curvature);
+    ChVector<> tangent = a.tangent + frac * (b.tangent - a.tangent);
+    double length = tangent.Length();
+    return length > 0 ? tangent / length : a.tangent;
+}
+
+size_t ChPathTable::Next(size_t i) const {
+    if (i + 1 < m_samples.size())
+        return i + 1;
+    return m_closed ? 0 : i;
+}
+
+size_t ChPathTable::Prev(size_t i) const {
+    if (i > 0)
+        return i - 1;
+    return m_closed ? m_samples.size() - 1 : 0;
+}
+
+double ChPathTable::ProjectChord(const ChVector<>& loc, size_t i, double& frac, ChVector<>& point) const {
+    const ChVector<>& a = m_samples[i].pos;
+    ChVector<> chord = m_samples[Next(i)].pos - a;
+    double len2 = chord.Length2();
+    frac = len2 > 0 ? ChClamp((loc - a).Dot(chord) / len2, 0.0, 1.0) : 0.0;
+    point = a + frac * chord;
+    return (point - loc).Length2();
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+ChPathTableFollower::ChPathTableFollower(std::shared_ptr<ChBezierCurve> path,
+                                         bool closed,
+                                         double target_speed,
+                                         double following_time,
+                                         double min_distance,
+                                         double spacing)
+    : m_table(path, closed, spacing),
+      m_lookahead(5.0),
+      m_target_speed(target_speed),
+      m_following_time(following_time),
+      m_min_distance(min_distance),
+      m_current_distance(100.0) {
+    Reset();
+}
+
+void ChPathTableFollower::SetSteeringGains(double Kp, double Ki, double Kd) {
+    m_steering_pid.Kp = Kp;
+    m_steering_pid.Ki = Ki;
+    m_steering_pid.Kd = Kd;
+}
+
+void ChPathTableFollower::SetSpeedGains(double Kp, double Ki, double Kd) {
+    m_speed_pid.Kp = Kp;
+    m_speed_pid.Ki = Ki;
+    m_speed_pid.Kd = Kd;
+}
+
+void ChPathTableFollower::Reset() {
+    m_target_index = m_table.GetNumSamples();
+    m_tangent_index = m_table.GetNumSamples();
+    m_steering_pid.err = m_steering_pid.erri = m_steering_pid.errd = 0;
+    m_speed_pid.err = m_speed_pid.erri = m_speed_pid.errd = 0;
+    m_sentinel = ChVector<>(0, 0, 0);
+    m_target = ChVector<>(0, 0, 0);
+    m_throttle = 0;
+    m_steering = 0;
+    m_braking = 0;
+}
+
+void ChPathTableFollower::Advance(const vehicle::ChVehicle& vehicle, double step) {
+    // Steering: signed horizontal distance from the sentinel to the target (positive if the target is to the left)
+    ChVector<> pos = vehicle.GetVehiclePos();
+    m_sentinel = pos + vehicle.GetVehicleRot().Rotate(ChVector<>(m_lookahead, 0, 0));
+    double frac;
+    m_target = m_table.FindClosestPoint(m_sentinel, m_target_index, frac);
+
+    ChVector<> err_vec = m_target - m_sentinel;
+    ChVector<> sentinel_vec = m_sentinel - pos;
+    ChVector<> target_vec = m_target - pos;
+    err_vec.z() = 0;
+    sentinel_vec.z() = 0;
+    target_vec.z() = 0;
+    double err = ChSignum(Vcross(sentinel_vec, target_vec).z()) * err_vec.Length();
+    m_steering = ChClamp(m_steering_pid.Advance(err, step), -1.0, 1.0);
+
+    // Speed: desired speed, limited by the time-gap policy
+    double speed_cmd = m_target_speed;
+    if (m_following_time > 0)
+        speed_cmd = std::min(speed_cmd, std::max(0.0, (m_current_distance - m_min_distance) / m_following_time));
+    double out = ChClamp(m_speed_pid.Advance(speed_cmd - vehicle.GetVehicleSpeed(), step), -1.0, 1.0);
+    m_throttle = std::max(out, 0.0);
+    m_braking = std::max(-out, 0.0);
+}
+
+ChVector<> ChPathTableFollower::GetPathTangent(const ChVector<>& loc, double& curvature) {
+    double frac;
+    m_table.FindClosestPoint(loc, m_tangent_index, frac);
+    return m_table.GetTangent(m_tangent_index, frac, curvature);
+}
+
+double ChPathTableFollower::PID::Advance(double e, double step) {
+    errd = step > 0 ? (e - err) / step : 0;
+    erri += (e + err) * step / 2;
+    err = e;
+    return Kp * err + Ki * erri + Kd * errd;
+}
+
+}  // namespace synchrono
+}  // namespace chrono
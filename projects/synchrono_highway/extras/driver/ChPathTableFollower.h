@@ -0,0 +1,179 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Path follower with adaptive cruise control, on a precomputed table of the
+// path.
+//
+// ChPathTable samples a Bezier path at a uniform arc-length spacing (position,
+// unit tangent, and curvature at each sample) at construction. Closest points
+// are found on the sampled polyline, by walking from the sample found by the
+// previous query (with a full scan only if the location jumped farther than a
+// given distance), and projecting on the two adjacent chords.
+//
+// ChPathTableFollower implements the controls of ChPathFollowerACCDriver on
+// the table:
+//   - steering: PID on the signed distance between the sentinel point (at the
+//     look-ahead distance in front of the vehicle) and the target point
+//     (closest path point to the sentinel), in the horizontal plane;
+//   - speed: PID on the difference between the commanded speed and the vehicle
+//     speed, where the commanded speed is the desired speed, limited by the
+//     constant time-gap policy (the gap to the vehicle in front should be the
+//     minimum distance plus the following time times the speed).
+// Once constructed, a step of the follower is a fixed amount of arithmetic,
+// with no allocation and no Bezier projection.
+//
+// =============================================================================
+
+#ifndef CH_PATH_TABLE_FOLLOWER_H
+#define CH_PATH_TABLE_FOLLOWER_H
+
+#include <memory>
+#include <vector>
+
+#include "chrono/core/ChBezierCurve.h"
+#include "chrono/core/ChVector.h"
+#include "chrono_vehicle/ChVehicle.h"
+
+namespace chrono {
+namespace synchrono {
+
+class ChPathTable {
+  public:
+    struct Sample {
+        ChVector<> pos;      ///< position on the path
+        ChVector<> tangent;  ///< unit tangent
+        double s;            ///< arc length from the start of the path
+        double curvature;    ///< curvature (inverse of the radius)
+    };
+
+    /// Construct the table of the given path, with the given arc-length spacing between samples.
+    ChPathTable(std::shared_ptr<ChBezierCurve> path,  ///< sampled path
+                bool closed,                          ///< treat the path as a closed loop
+                double spacing = 0.5,                 ///< arc length between samples
+                double jump_distance = 10             ///< distance beyond which a full search is done
+    );
+
+    /// Return the number of samples.
+    size_t GetNumSamples() const { return m_samples.size(); }
+
+    /// Return the given sample.
+    const Sample& GetSample(size_t i) const { return m_samples[i]; }
+
+    /// Return the length of the path.
+    double GetLength() const { return m_length; }
+
+    /// Return the closest point to the given location on the sampled path. On input, index is the sample found by the
+    /// previous query (or a value past the last sample for a full search); on output, the closest point lies on the
+    /// chord from sample index to the next one, at the given fraction of the chord.
+    ChVector<> FindClosestPoint(const ChVector<>& loc, size_t& index, double& frac) const;
+
+    /// Return the unit tangent and the curvature at the given point on a chord (as returned by FindClosestPoint).
+    ChVector<> GetTangent(size_t index, double frac, double& curvature) const;
+
+  private:
+    size_t Next(size_t i) const;
+    size_t Prev(size_t i) const;
+    double Distance2(const ChVector<>& loc, size_t i) const { return (m_samples[i].pos - loc).Length2(); }
+
+    /// Project on the chord from sample i to the next one; return the squared distance.
+    double ProjectChord(const ChVector<>& loc, size_t i, double& frac, ChVector<>& point) const;
+
+    bool m_closed;
+    double m_jump_distance;
+    double m_length;
+    std::vector<Sample> m_samples;
+};
+
+class ChPathTableFollower {
+  public:
+    /// Construct a follower of the given path.
+    ChPathTableFollower(std::shared_ptr<ChBezierCurve> path,  ///< followed path
+                        bool closed,                          ///< treat the path as a closed loop
+                        double target_speed,                  ///< desired speed
+                        double following_time,                ///< seconds of following time
+                        double min_distance,                  ///< min following distance
+                        double spacing = 0.5                  ///< arc length between table samples
+    );
+
+    /// Set the gains of the steering controller.
+    void SetSteeringGains(double Kp, double Ki, double Kd);
+
+    /// Set the gains of the speed controller.
+    void SetSpeedGains(double Kp, double Ki, double Kd);
+
+    /// Set the look-ahead distance of the sentinel point.
+    void SetLookAheadDistance(double dist) { m_lookahead = dist; }
+
+    /// Set the desired speed.
+    void SetDesiredSpeed(double speed) { m_target_speed = speed; }
+
+    /// Set the current distance to the vehicle in front.
+    void SetCurrentDistance(double dist) { m_current_distance = dist; }
+
+    /// Reset the controller states (errors, integrals, and last path samples).
+    void Reset();
+
+    /// Advance the controllers of the given vehicle by the specified time step.
+    void Advance(const vehicle::ChVehicle& vehicle, double step);
+
+    /// Return the unit path tangent at the closest path point to the given location, and the path curvature there.
+    /// (The search starts from the sample found by the previous call.)
+    ChVector<> GetPathTangent(const ChVector<>& loc, double& curvature);
+
+    double GetThrottle() const { return m_throttle; }
+    double GetSteering() const { return m_steering; }
+    double GetBraking() const { return m_braking; }
+
+    /// Return the current target point (closest path point to the sentinel).
+    const ChVector<>& GetTargetLocation() const { return m_target; }
+
+    /// Return the current sentinel point.
+    const ChVector<>& GetSentinelLocation() const { return m_sentinel; }
+
+    /// Return the path table.
+    const ChPathTable& GetTable() const { return m_table; }
+
+  private:
+    struct PID {
+        double Kp = 0;
+        double Ki = 0;
+        double Kd = 0;
+        double err = 0;
+        double erri = 0;
+        double errd = 0;
+        double Advance(double e, double step);
+    };
+
+    ChPathTable m_table;
+    size_t m_target_index;
+    size_t m_tangent_index;
+
+    double m_lookahead;
+    double m_target_speed;
+    double m_following_time;
+    double m_min_distance;
+    double m_current_distance;
+
+    PID m_steering_pid;
+    PID m_speed_pid;
+    ChVector<> m_sentinel;
+    ChVector<> m_target;
+
+    double m_throttle;
+    double m_steering;
+    double m_braking;
+};
+
+}  // namespace synchrono
+}  // namespace chrono
+
+#endif
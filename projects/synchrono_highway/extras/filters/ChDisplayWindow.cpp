@@ -0,0 +1,253 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "ChDisplayWindow.h"
+#include "chrono_sensor/utils/CudaMallocHelper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include <cuda_runtime_api.h>
+#include <cuda_gl_interop.h>
+
+namespace chrono {
+namespace sensor {
+
+int ChDisplayWindow::s_windowCount = 0;
+std::mutex ChDisplayWindow::s_glfwMutex;
+
+ChDisplayWindow::ChDisplayWindow(int w, int h, const std::string& name, bool is_fullscreen, bool use_interop)
+    : m_w(w),
+      m_h(h),
+      m_name(name),
+      m_is_fullscreen(is_fullscreen),
+      m_use_interop(use_interop),
+      m_mailbox(1),
+      m_exit(false),
+      m_disabled(false) {
+    for (int i = 0; i < kNumSlots; i++)
+        m_ready[i] = NULL;
+}
+
+ChDisplayWindow::~ChDisplayWindow() {
+    m_exit = true;
+    if (m_thread.joinable())
+        m_thread.join();
+    for (int i = 0; i < kNumSlots; i++) {
+        if (m_ready[i])
+            cudaEventDestroy(m_ready[i]);
+    }
+}
+
+void ChDisplayWindow::Initialize(size_t bytes,
+                                 int width,
+                                 int height,
+                                 int internal_format,
+                                 unsigned int format,
+                                 unsigned int type) {
+    if (m_thread.joinable())
+        return;
+
+    m_bytes = bytes;
+    m_width = width;
+    m_height = height;
+    m_internal_format = internal_format;
+    m_format = format;
+    m_type = type;
+    cudaGetDevice(&m_device);
+
+    for (int i = 0; i < kNumSlots; i++) {
+        m_slots[i] = std::shared_ptr<char>(cudaMallocHelper<char>(bytes), cudaFreeHelper<char>);
+        cudaEventCreateWithFlags(&m_ready[i], cudaEventDisableTiming);
+    }
+
+    m_thread = std::thread(&ChDisplayWindow::Run, this);
+}
+
+void ChDisplayWindow::Submit(const void* device_data, CUstream stream) {
+    if (m_disabled || !m_thread.joinable())
+        return;
+
+    // the slot owned by this thread is not read by the render thread, which synchronizes its copies before giving a
+    // slot back through the mailbox
+    cudaMemcpyAsync(m_slots[m_write].get(), device_data, m_bytes, cudaMemcpyDeviceToDevice, stream);
+    cudaEventRecord(m_ready[m_write], stream);
+    m_write = m_mailbox.exchange(m_write | kFresh) & ~kFresh;
+}
+
+void ChDisplayWindow::Run() {
+    cudaSetDevice(m_device);
+    OnNewWindow();
+    {
+        std::lock_guard<std::mutex> lck(s_glfwMutex);
+        if (m_is_fullscreen)
+            m_window = glfwCreateWindow(m_w, m_h, m_name.c_str(), glfwGetPrimaryMonitor(), NULL);
+        else
+            m_window = glfwCreateWindow(m_w, m_h, m_name.c_str(), NULL, NULL);
+    }
+    if (!m_window) {
+        std::cerr << "WARNING: requested window could not be created by GLFW. Will proceed with no window.\n";
+        m_disabled = true;
+        OnCloseWindow();
+        return;
+    }
+
+    // the context stays current on this thread for the lifetime of the window
+    glfwMakeContextCurrent(m_window);
+    glfwSwapInterval(0);  // disable vsync as we are "fast as possible"
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(0, 1, 0, 1, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glViewport(0, 0, m_w, m_h);
+
+    glGenTextures(1, &m_gl_tex_id);
+    glBindTexture(GL_TEXTURE_2D, m_gl_tex_id);
+    // Change these to GL_LINEAR for super- or sub-sampling
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    // GL_CLAMP_TO_EDGE for linear filtering, not relevant for nearest.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    cudaStreamCreateWithFlags(&m_stream, cudaStreamNonBlocking);
+    if (!m_use_interop || !CreateInterop()) {
+        m_host_frame = std::shared_ptr<char>(cudaHostMallocHelper<char>(m_bytes), cudaHostFreeHelper<char>);
+    }
+
+    while (!m_exit) {
+        if (m_mailbox.load() & kFresh) {
+            m_read = m_mailbox.exchange(m_read) & ~kFresh;
+            Present(m_read);
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        std::lock_guard<std::mutex> lck(s_glfwMutex);
+        glfwPollEvents();
+    }
+
+    DestroyInterop();
+    glDeleteTextures(1, &m_gl_tex_id);
+    m_host_frame.reset();
+    cudaStreamDestroy(m_stream);
+    {
+        std::lock_guard<std::mutex> lck(s_glfwMutex);
+        glfwDestroyWindow(m_window);
+        m_window = NULL;
+    }
+    OnCloseWindow();
+}
+
+void ChDisplayWindow::Present(int slot) {
+    // wait (on the device) for the copy into the slot, then copy into the pixel buffer or the host frame; the slot is
+    // free again once the stream is synchronized
+    cudaStreamWaitEvent(m_stream, m_ready[slot], 0);
+    if (m_cuda_pbo) {
+        void* pbo_data;
+        size_t pbo_bytes;
+        cudaGraphicsMapResources(1, &m_cuda_pbo, m_stream);
+        cudaGraphicsResourceGetMappedPointer(&pbo_data, &pbo_bytes, m_cuda_pbo);
+        cudaMemcpyAsync(pbo_data, m_slots[slot].get(), std::min(m_bytes, pbo_bytes), cudaMemcpyDeviceToDevice,
+                        m_stream);
+        cudaGraphicsUnmapResources(1, &m_cuda_pbo, m_stream);
+        cudaStreamSynchronize(m_stream);
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_gl_pbo_id);
+        glTexImage2D(GL_TEXTURE_2D, 0, m_internal_format, m_width, m_height, 0, m_format, m_type, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    } else {
+        cudaMemcpyAsync(m_host_frame.get(), m_slots[slot].get(), m_bytes, cudaMemcpyDeviceToHost, m_stream);
+        cudaStreamSynchronize(m_stream);
+        glTexImage2D(GL_TEXTURE_2D, 0, m_internal_format, m_width, m_height, 0, m_format, m_type,
+                     m_host_frame.get());
+    }
+
+    // Set Viewport to window dimensions
+    int window_w, window_h;
+    glfwGetWindowSize(m_window, &window_w, &window_h);
+    glViewport(0, 0, window_w, window_h);
+
+    // 1:1 texel to pixel mapping with glOrtho(0, 1, 0, 1, -1, 1) setup:
+    // The quad coordinates go from lower left corner of the lower left pixel
+    // to the upper right corner of the upper right pixel.
+    // Same for the texel coordinates.
+    glEnable(GL_TEXTURE_2D);
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, 0.0f);
+    glVertex2f(0.0f, 0.0f);
+    glTexCoord2f(1.0f, 0.0f);
+    glVertex2f(1.0f, 0.0f);
+    glTexCoord2f(1.0f, 1.0f);
+    glVertex2f(1.0f, 1.0f);
+    glTexCoord2f(0.0f, 1.0f);
+    glVertex2f(0.0f, 1.0f);
+    glEnd();
+    glDisable(GL_TEXTURE_2D);
+
+    glfwSwapBuffers(m_window);
+}
+
+bool ChDisplayWindow::CreateInterop() {
+    // pixel buffers need the GL 2.1 entry points
+    if (glewInit() != GLEW_OK || !GLEW_VERSION_2_1) {
+        std::cerr << "WARNING: OpenGL pixel buffers not available. Will copy the sensor data through the host.\n";
+        return false;
+    }
+
+    glGenBuffers(1, &m_gl_pbo_id);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_gl_pbo_id);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, m_bytes, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (cudaGraphicsGLRegisterBuffer(&m_cuda_pbo, m_gl_pbo_id, cudaGraphicsRegisterFlagsWriteDiscard) !=
+        cudaSuccess) {
+        std::cerr << "WARNING: CUDA-OpenGL interop not available. Will copy the sensor data through the host.\n";
+        m_cuda_pbo = NULL;
+        DestroyInterop();
+        return false;
+    }
+    return true;
+}
+
+void ChDisplayWindow::DestroyInterop() {
+    if (m_cuda_pbo) {
+        cudaGraphicsUnregisterResource(m_cuda_pbo);
+        m_cuda_pbo = NULL;
+    }
+    if (m_gl_pbo_id) {
+        glDeleteBuffers(1, &m_gl_pbo_id);
+        m_gl_pbo_id = 0;
+    }
+}
+
+void ChDisplayWindow::OnNewWindow() {
+    std::lock_guard<std::mutex> l(s_glfwMutex);
+    if (s_windowCount++ == 0) {
+        glfwInit();
+    }
+}
+
+void ChDisplayWindow::OnCloseWindow() {
+    std::lock_guard<std::mutex> l(s_glfwMutex);
+    if (--s_windowCount == 0) {
+        glfwTerminate();
+    }
+}
+
+}  // namespace sensor
+}  // namespace chrono
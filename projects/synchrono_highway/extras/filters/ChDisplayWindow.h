@@ -0,0 +1,129 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Display window with its own render thread and GL context.
+//
+// Frames are submitted from a sensor filter thread as device buffers: Submit
+// copies the frame into a device slot on the sensor stream and publishes the
+// slot through a lock-free single-slot mailbox (triple buffering, the latest
+// frame wins). The render thread takes the latest frame, copies it into the
+// window texture (through a CUDA-registered GL pixel buffer when interop is
+// available, through the host otherwise), and presents it. The submitting
+// thread never waits for the upload or the buffer swap; only window creation
+// and event processing are serialized between windows.
+//
+// =============================================================================
+
+#ifndef CHDISPLAYWINDOW_H
+#define CHDISPLAYWINDOW_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <cuda.h>
+
+struct CUevent_st;
+struct cudaGraphicsResource;
+struct GLFWwindow;
+
+namespace chrono {
+namespace sensor {
+
+/// @addtogroup sensor_filters
+/// @{
+
+/// A window presenting image frames submitted from device memory on its own render thread.
+class ChDisplayWindow {
+  public:
+    /// Class constructor
+    /// @param w Width of the window to create
+    /// @param h Height of the window to create
+    /// @param name Title of the window
+    /// @param is_fullscreen Create a full screen window
+    /// @param use_interop Use CUDA-OpenGL interop for the texture upload when available
+    ChDisplayWindow(int w, int h, const std::string& name, bool is_fullscreen, bool use_interop);
+
+    /// Class destructor. Stops the render thread and closes the window.
+    ~ChDisplayWindow();
+
+    /// Allocate the frame slots and start the render thread, for frames of the given size and GL texture formats.
+    void Initialize(size_t bytes, int width, int height, int internal_format, unsigned int format, unsigned int type);
+
+    /// Copy a frame from device memory on the given stream and publish it for display. Does not wait for the copy.
+    void Submit(const void* device_data, CUstream stream);
+
+    /// Return true if the window could not be created (frames are then dropped)
+    bool IsDisabled() const { return m_disabled; }
+
+  private:
+    /// Render thread: creates the window and presents the latest frames until the window is closed.
+    void Run();
+
+    /// Creates the GL pixel buffer and registers it with CUDA (render thread). Returns false on failure.
+    bool CreateInterop();
+
+    /// Releases the pixel buffer and its CUDA registration (render thread)
+    void DestroyInterop();
+
+    /// Uploads the frame in the given slot to the window texture and presents it (render thread)
+    void Present(int slot);
+
+    static const int kNumSlots = 3;
+    static const int kFresh = 4;  ///< mailbox flag of a slot published and not yet taken
+
+    int m_w;                      ///< width of the window
+    int m_h;                      ///< height of the window
+    std::string m_name;           ///< window title
+    bool m_is_fullscreen;         ///< for creating a full screen window
+    bool m_use_interop;           ///< use the CUDA-OpenGL interop path when available
+
+    size_t m_bytes = 0;                  ///< size of a frame
+    int m_width = 0;                     ///< frame width
+    int m_height = 0;                    ///< frame height
+    int m_internal_format = 0;           ///< GL internal format of the texture
+    unsigned int m_format = 0;           ///< GL format of the frame data
+    unsigned int m_type = 0;             ///< GL type of the frame data
+    int m_device = 0;                    ///< CUDA device of the submitted frames
+
+    std::shared_ptr<char> m_slots[kNumSlots];     ///< device frame slots
+    CUevent_st* m_ready[kNumSlots];               ///< events recorded after the copy into each slot
+    int m_write = 0;                              ///< slot written by the submitting thread
+    std::atomic<int> m_mailbox;                   ///< published slot (with kFresh if not yet taken)
+    int m_read = 2;                               ///< slot read by the render thread
+
+    std::thread m_thread;                 ///< render thread
+    std::atomic<bool> m_exit;             ///< request to stop the render thread
+    std::atomic<bool> m_disabled;         ///< window not available (e.g. headless rendering)
+
+    // render thread state
+    GLFWwindow* m_window = NULL;                ///< window and GL context
+    CUstream m_stream = NULL;                   ///< stream for the copies into the texture
+    unsigned int m_gl_tex_id = 0;               ///< window texture
+    unsigned int m_gl_pbo_id = 0;               ///< GL pixel buffer written by CUDA
+    cudaGraphicsResource* m_cuda_pbo = NULL;    ///< CUDA registration of the pixel buffer
+    std::shared_ptr<char> m_host_frame;         ///< pinned host frame when interop is not available
+
+    static void OnNewWindow();
+    static void OnCloseWindow();
+    static int s_windowCount;       ///< keeps track of the window count
+    static std::mutex s_glfwMutex;  ///< serializes GLFW initialization, window creation, and event processing
+};
+
+/// @}
+
+}  // namespace sensor
+}  // namespace chrono
+
+#endif
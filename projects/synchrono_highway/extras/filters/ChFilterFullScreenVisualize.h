@@ -17,14 +17,12 @@
 #ifndef CHFILTERFULLSCREENVISUALIZE_H
 #define CHFILTERFULLSCREENVISUALIZE_H
 
-// #include "glad.h"
-#include <GL/glew.h>
-#include <GLFW/glfw3.h>
-
 #include "chrono_sensor/filters/ChFilter.h"
 
+#include "ChDisplayWindow.h"
+
 #include <iostream>
-#include <mutex>
+#include <memory>
 
 #include <cuda.h>
 
@@ -39,7 +37,8 @@ class ChOptixSensor;
 /// @{
 
 /// A filter that, when applied to a sensor, creates a GUI window to visualize the sensor (using GLFW). This visualizes
-/// data as an image. Will only work on data that can be interpreted as image data.
+/// data as an image. Will only work on data that can be interpreted as image data. The window is presented by its own
+/// render thread (see ChDisplayWindow), so the filter only queues a device copy of each frame.
 class CH_SENSOR_API ChFilterFullScreenVisualize : public ChFilter {
   public:
     /// Class constructor
@@ -60,41 +59,33 @@ class CH_SENSOR_API ChFilterFullScreenVisualize : public ChFilter {
     /// @param bufferInOut A buffer that is passed into the filter.
     virtual void Initialize(std::shared_ptr<ChSensor> pSensor, std::shared_ptr<SensorBuffer>& bufferInOut);
 
-  protected:
-    /// Creates a GLFW window for this filter
-    void CreateGlfwWindow(std::string m_name);
+    /// Enable or disable the CUDA-OpenGL interop path (default: enabled). With interop, the frames are copied on the
+    /// device into a GL pixel buffer registered with CUDA, instead of going through host memory. The window falls
+    /// back to the host copy if the pixel buffer cannot be created or registered. Must be called before the filter
+    /// is initialized.
+    void SetInterop(bool use_interop) { m_use_interop = use_interop; }
 
-    /// Helper to allow GLFWwindow to be in a unique_ptr
-    struct DestroyglfwWin {
-        void operator()(GLFWwindow* ptr) { glfwDestroyWindow(ptr); }
-    };
+  protected:
+    /// Returns the device data, size in bytes, dimensions, and GL texture formats of the incoming buffer
+    void* GetDeviceData(size_t& bytes,
+                        int& width,
+                        int& height,
+                        int& internal_format,
+                        unsigned int& format,
+                        unsigned int& type);
 
     std::shared_ptr<SensorDeviceR8Buffer> m_bufferR8;
     std::shared_ptr<SensorDeviceRGBA8Buffer> m_bufferRGBA8;
     std::shared_ptr<SensorDeviceDIBuffer> m_bufferDI;
     std::shared_ptr<SensorDeviceRangeRcsBuffer> m_bufferRangeRcs;
 
-    std::shared_ptr<SensorHostR8Buffer> m_hostR8;
-    std::shared_ptr<SensorHostRGBA8Buffer> m_hostRGBA8;
-    std::shared_ptr<SensorHostDIBuffer> m_hostDI;
-    std::shared_ptr<SensorHostRangeRcsBuffer> m_hostRangeRcs;
-
     CUstream m_cuda_stream;  ///< reference to the cuda stream
 
-    std::unique_ptr<GLFWwindow, DestroyglfwWin> m_window;  ///< pointer to the window
-    unsigned int m_gl_tex_id = 0;                          ///< reference data for the GL context and texture
-
-    /// Helper function for when new window is created
-    static void OnNewWindow();
-
-    /// Helper function for when window is closed.
-    static void OnCloseWindow();
-    static int s_windowCount;       ///< keeps track of the window count
-    static std::mutex s_glfwMutex;  ///< mutex to prevent us making two windows at the exact same time
+    std::unique_ptr<ChDisplayWindow> m_display;  ///< window and render thread
 
-    bool m_window_disabled = false;  ///< for checking if window is not allowed on sysmtem (e.g. headless rendering)
-    int m_w;                         ///< width of the window
-    int m_h;                         ///< height of the window
+    bool m_use_interop = true;  ///< use the CUDA-OpenGL interop path when available
+    int m_w;                    ///< width of the window
+    int m_h;                    ///< height of the window
 
 		bool m_is_fullscreen = false; ///< for creating a full screen window
 };
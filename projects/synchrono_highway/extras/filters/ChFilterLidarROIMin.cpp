@@ -0,0 +1,109 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+
+#include "ChFilterLidarROIMin.h"
+#include "lidar_roi_min.cuh"
+#include "chrono_sensor/ChOptixSensor.h"
+#include "chrono_sensor/utils/CudaMallocHelper.h"
+
+#include <cstring>
+
+#include <cuda_runtime_api.h>
+
+namespace chrono {
+namespace sensor {
+
+// Order-preserving encoding of a float as an unsigned int, as used by the kernel (see lidar_roi_min.cuh)
+static unsigned int EncodeDistance(float dist) {
+    unsigned int bits;
+    std::memcpy(&bits, &dist, sizeof(float));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+static float DecodeDistance(unsigned int key) {
+    unsigned int bits = (key & 0x80000000u) ? (key & 0x7fffffffu) : ~key;
+    float dist;
+    std::memcpy(&dist, &bits, sizeof(float));
+    return dist;
+}
+
+CH_SENSOR_API ChFilterLidarROIMin::ChFilterLidarROIMin(const ChVector<float>& box_min,
+                                                      const ChVector<float>& box_max,
+                                                      std::string name)
+    : m_box_min(box_min),
+      m_box_max(box_max),
+      m_yaw(0),
+      m_min_dist(box_max.x()),
+      m_time_stamp(0),
+      ChFilter(name) {}
+
+CH_SENSOR_API void ChFilterLidarROIMin::Apply() {
+    float yaw;
+    {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        yaw = m_yaw;
+    }
+
+    // start from the distance reported when there is no return in the box
+    *m_host_min = EncodeDistance(m_box_max.x());
+    cudaMemcpyAsync(m_device_min.get(), m_host_min.get(), sizeof(unsigned int), cudaMemcpyHostToDevice,
+                    m_cuda_stream);
+
+    float box_min[3] = {m_box_min.x(), m_box_min.y(), m_box_min.z()};
+    float box_max[3] = {m_box_max.x(), m_box_max.y(), m_box_max.z()};
+    cuda_lidar_roi_min(m_buffer_in->Buffer.get(), m_buffer_in->Width * m_buffer_in->Height, yaw, box_min, box_max,
+                       m_device_min.get(), m_cuda_stream);
+
+    cudaMemcpyAsync(m_host_min.get(), m_device_min.get(), sizeof(unsigned int), cudaMemcpyDeviceToHost,
+                    m_cuda_stream);
+    cudaStreamSynchronize(m_cuda_stream);
+
+    float min_dist = DecodeDistance(*m_host_min);
+    std::lock_guard<std::mutex> lck(m_mutex);
+    m_min_dist = min_dist;
+    m_time_stamp = m_buffer_in->TimeStamp;
+}
+
+CH_SENSOR_API void ChFilterLidarROIMin::Initialize(std::shared_ptr<ChSensor> pSensor,
+                                                   std::shared_ptr<SensorBuffer>& bufferInOut) {
+    if (!bufferInOut)
+        InvalidFilterGraphNullBuffer(pSensor);
+
+    auto pOptixSen = std::dynamic_pointer_cast<ChOptixSensor>(pSensor);
+    if (!pOptixSen) {
+        InvalidFilterGraphSensorTypeMismatch(pSensor);
+    }
+    m_cuda_stream = pOptixSen->GetCudaStream();
+
+    m_buffer_in = std::dynamic_pointer_cast<SensorDeviceXYZIBuffer>(bufferInOut);
+    if (!m_buffer_in) {
+        InvalidFilterGraphBufferTypeMismatch(pSensor);
+    }
+
+    m_device_min = std::shared_ptr<unsigned int>(cudaMallocHelper<unsigned int>(1), cudaFreeHelper<unsigned int>);
+    m_host_min =
+        std::shared_ptr<unsigned int>(cudaHostMallocHelper<unsigned int>(1), cudaHostFreeHelper<unsigned int>);
+}
+
+CH_SENSOR_API void ChFilterLidarROIMin::SetYaw(float yaw) {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    m_yaw = yaw;
+}
+
+CH_SENSOR_API float ChFilterLidarROIMin::GetMinDistance(float& time_stamp) {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    time_stamp = m_time_stamp;
+    return m_min_dist;
+}
+
+}  // namespace sensor
+}  // namespace chrono
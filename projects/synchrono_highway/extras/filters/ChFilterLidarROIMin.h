@@ -0,0 +1,89 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Lidar filter computing, on the device, the minimum forward distance of the
+// returns inside a box of interest, rotated about the sensor Z axis by a yaw
+// angle set by the user (e.g. the current steering angle). Only the resulting
+// distance is copied back to the host; the point cloud is passed through
+// unchanged to the next filters.
+//
+// =============================================================================
+
+#ifndef CHFILTERLIDARROIMIN_H
+#define CHFILTERLIDARROIMIN_H
+
+#include "chrono/core/ChVector.h"
+#include "chrono_sensor/filters/ChFilter.h"
+
+#include <memory>
+#include <mutex>
+
+#include <cuda.h>
+
+namespace chrono {
+namespace sensor {
+
+// forward declaration
+class ChSensor;
+
+/// @addtogroup sensor_filters
+/// @{
+
+/// A filter that reduces an XYZI point cloud to the minimum x coordinate of the returns (with positive intensity)
+/// inside a box of interest, expressed in a frame rotated by a yaw angle about the sensor Z axis. The distance is
+/// the box x_max if there is no return in the box.
+class CH_SENSOR_API ChFilterLidarROIMin : public ChFilter {
+  public:
+    /// Class constructor
+    /// @param box_min Lower corner of the box of interest
+    /// @param box_max Upper corner of the box of interest
+    /// @param name String name of the filter
+    ChFilterLidarROIMin(const ChVector<float>& box_min,
+                        const ChVector<float>& box_max,
+                        std::string name = "ChFilterLidarROIMin");
+
+    /// Apply function. Computes the minimum distance of the returns in the box.
+    virtual void Apply();
+
+    /// Initializes all data needed by the filter access apply function.
+    /// @param pSensor A pointer to the sensor on which the filter is attached.
+    /// @param bufferInOut A buffer that is passed into the filter.
+    virtual void Initialize(std::shared_ptr<ChSensor> pSensor, std::shared_ptr<SensorBuffer>& bufferInOut);
+
+    /// Set the yaw angle (rad) of the box about the sensor Z axis, used from the next point cloud on.
+    void SetYaw(float yaw);
+
+    /// Return the minimum distance in the most recent point cloud and the time stamp of that point cloud (0 before
+    /// the first point cloud).
+    float GetMinDistance(float& time_stamp);
+
+  private:
+    ChVector<float> m_box_min;  ///< lower corner of the box of interest
+    ChVector<float> m_box_max;  ///< upper corner of the box of interest
+
+    std::shared_ptr<SensorDeviceXYZIBuffer> m_buffer_in;  ///< input point cloud (passed through)
+    std::shared_ptr<unsigned int> m_device_min;           ///< device result (ordered encoding of the distance)
+    std::shared_ptr<unsigned int> m_host_min;             ///< pinned host copy of the result
+    CUstream m_cuda_stream;                               ///< reference to the cuda stream
+
+    std::mutex m_mutex;   ///< protects the values below, shared with the user thread
+    float m_yaw;          ///< yaw angle of the box
+    float m_min_dist;     ///< minimum distance in the most recent point cloud
+    float m_time_stamp;   ///< time stamp of the most recent point cloud
+};
+
+/// @}
+
+}  // namespace sensor
+}  // namespace chrono
+
+#endif
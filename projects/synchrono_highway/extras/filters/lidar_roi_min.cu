@@ -0,0 +1,68 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+
+#include <cuda.h>
+#include "lidar_roi_min.cuh"
+
+namespace chrono {
+namespace sensor {
+
+// Order-preserving map of a float to an unsigned int (sign-flip encoding): the bits of non-negative floats get the
+// sign bit set, those of negative floats are inverted. The minimum of floats of any sign is then an integer minimum.
+__device__ inline unsigned int float_as_ordered_uint(float f) {
+    unsigned int bits = __float_as_uint(f);
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+// One point per thread, warp reduction, then one atomic per warp on the ordered encoding of the distance.
+__global__ void lidar_roi_min_kernel(const float4* points,
+                                     int num_points,
+                                     float c,
+                                     float s,
+                                     float3 box_min,
+                                     float3 box_max,
+                                     unsigned int* d_min) {
+    int index = blockDim.x * blockIdx.x + threadIdx.x;
+    float dist = box_max.x;
+    if (index < num_points) {
+        float4 p = points[index];
+        // rotate back into the frame of the box
+        float x = c * p.x + s * p.y;
+        float y = -s * p.x + c * p.y;
+        if (p.w > 0 && x > box_min.x && x < box_max.x && y > box_min.y && y < box_max.y && p.z > box_min.z &&
+            p.z < box_max.z)
+            dist = x;
+    }
+    for (int offset = 16; offset > 0; offset /= 2)
+        dist = fminf(dist, __shfl_down_sync(0xffffffff, dist, offset));
+    if ((threadIdx.x & 31) == 0 && dist < box_max.x)
+        atomicMin(d_min, float_as_ordered_uint(dist));
+}
+
+void cuda_lidar_roi_min(void* bufPtr,
+                        int num_points,
+                        float yaw,
+                        const float* box_min,
+                        const float* box_max,
+                        unsigned int* d_min,
+                        CUstream& stream) {
+    const int nThreads = 512;
+    int nBlocks = (num_points + nThreads - 1) / nThreads;
+    if (nBlocks == 0)
+        return;
+    lidar_roi_min_kernel<<<nBlocks, nThreads, 0, stream>>>(
+        (float4*)bufPtr, num_points, cosf(yaw), sinf(yaw), make_float3(box_min[0], box_min[1], box_min[2]),
+        make_float3(box_max[0], box_max[1], box_max[2]), d_min);
+}
+
+}  // namespace sensor
+}  // namespace chrono
@@ -0,0 +1,38 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+
+#include <cuda.h>
+
+namespace chrono {
+namespace sensor {
+
+/// Minimum x coordinate of the XYZI points (with positive intensity) inside a box, in a frame rotated by the given
+/// yaw angle about Z. The result is written to d_min in the order-preserving encoding of floats (bits of
+/// non-negative floats with the sign bit set, bits of negative floats inverted), so that boxes may extend to negative
+/// x. d_min must hold the encoding of the initial (no return) distance before the launch.
+/// @param bufPtr A device pointer to the XYZI point cloud (4 floats per point)
+/// @param num_points The number of points
+/// @param yaw The rotation angle of the box about Z
+/// @param box_min The lower corner of the box (3 floats, host memory)
+/// @param box_max The upper corner of the box (3 floats, host memory)
+/// @param d_min A device pointer to the result
+/// @param stream The cuda stream for the kernel
+void cuda_lidar_roi_min(void* bufPtr,
+                        int num_points,
+                        float yaw,
+                        const float* box_min,
+                        const float* box_max,
+                        unsigned int* d_min,
+                        CUstream& stream);
+
+}  // namespace sensor
+}  // namespace chrono
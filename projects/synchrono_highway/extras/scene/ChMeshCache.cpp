@@ -0,0 +1,242 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+
+#include "ChMeshCache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+    #include <process.h>
+    #define getpid _getpid
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace chrono {
+namespace synchrono {
+
+static const uint32_t kCacheVersion = 1;
+
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t padding;
+    uint64_t obj_size;
+    uint64_t obj_hash;
+    uint64_t num_vertices;
+    uint64_t num_normals;
+    uint64_t num_uv;
+    uint64_t num_v_indices;
+    uint64_t num_n_indices;
+    uint64_t num_uv_indices;
+    uint64_t num_mat_indices;
+};
+
+static_assert(sizeof(ChVector<double>) == 3 * sizeof(double), "unexpected ChVector layout");
+static_assert(sizeof(ChVector2<double>) == 2 * sizeof(double), "unexpected ChVector2 layout");
+static_assert(sizeof(ChVector<int>) == 3 * sizeof(int32_t), "unexpected ChVector layout");
+
+// Read-only view of a whole file, shared with the other processes mapping it (read into memory on Windows)
+class MappedFile {
+  public:
+    explicit MappedFile(const std::string& filename) {
+#ifdef _WIN32
+        FILE* file = fopen(filename.c_str(), "rb");
+        if (!file)
+            return;
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        if (size > 0) {
+            m_buffer.resize(size);
+            if (fread(m_buffer.data(), 1, size, file) == (size_t)size) {
+                m_data = m_buffer.data();
+                m_size = size;
+            }
+        }
+        fclose(file);
+#else
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (data != MAP_FAILED) {
+                m_data = static_cast<const char*>(data);
+                m_size = st.st_size;
+            }
+        }
+        close(fd);
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (m_data)
+            munmap(const_cast<char*>(m_data), m_size);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* GetData() const { return m_data; }
+    size_t GetSize() const { return m_size; }
+
+  private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    std::vector<char> m_buffer;
+#endif
+};
+
+static uint64_t HashFNV1a(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template <typename T>
+static const char* ReadArray(const char* src, uint64_t count, std::vector<T>& dst) {
+    dst.resize(count);
+    std::memcpy(dst.data(), src, count * sizeof(T));
+    return src + count * sizeof(T);
+}
+
+template <typename T>
+static void WriteArray(FILE* file, const std::vector<T>& src) {
+    fwrite(src.data(), sizeof(T), src.size(), file);
+}
+
+// Fill the mesh from the cache file if it is valid for the given OBJ file and load flags
+static bool ReadCache(const std::string& cache_file,
+                      uint32_t flags,
+                      uint64_t obj_size,
+                      uint64_t obj_hash,
+                      geometry::ChTriangleMeshConnected& mesh) {
+    MappedFile cache(cache_file);
+    if (cache.GetSize() < sizeof(CacheHeader))
+        return false;
+
+    CacheHeader header;
+    std::memcpy(&header, cache.GetData(), sizeof(header));
+    if (std::memcmp(header.magic, "CHMC", 4) != 0 || header.version != kCacheVersion || header.flags != flags ||
+        header.obj_size != obj_size || header.obj_hash != obj_hash)
+        return false;
+
+    uint64_t bytes = sizeof(CacheHeader) + (header.num_vertices + header.num_normals) * sizeof(ChVector<double>) +
+                     header.num_uv * sizeof(ChVector2<double>) +
+                     (header.num_v_indices + header.num_n_indices + header.num_uv_indices) * sizeof(ChVector<int>) +
+                     header.num_mat_indices * sizeof(int);
+    if (cache.GetSize() != bytes)
+        return false;
+
+    const char* src = cache.GetData() + sizeof(CacheHeader);
+    src = ReadArray(src, header.num_vertices, mesh.m_vertices);
+    src = ReadArray(src, header.num_normals, mesh.m_normals);
+    src = ReadArray(src, header.num_uv, mesh.m_UV);
+    src = ReadArray(src, header.num_v_indices, mesh.m_face_v_indices);
+    src = ReadArray(src, header.num_n_indices, mesh.m_face_n_indices);
+    src = ReadArray(src, header.num_uv_indices, mesh.m_face_uv_indices);
+    src = ReadArray(src, header.num_mat_indices, mesh.m_face_mat_indices);
+    return true;
+}
+
+static void WriteCache(const std::string& cache_file,
+                       uint32_t flags,
+                       uint64_t obj_size,
+                       uint64_t obj_hash,
+                       const geometry::ChTriangleMeshConnected& mesh) {
+    CacheHeader header;
+    std::memcpy(header.magic, "CHMC", 4);
+    header.version = kCacheVersion;
+    header.flags = flags;
+    header.padding = 0;
+    header.obj_size = obj_size;
+    header.obj_hash = obj_hash;
+    header.num_vertices = mesh.m_vertices.size();
+    header.num_normals = mesh.m_normals.size();
+    header.num_uv = mesh.m_UV.size();
+    header.num_v_indices = mesh.m_face_v_indices.size();
+    header.num_n_indices = mesh.m_face_n_indices.size();
+    header.num_uv_indices = mesh.m_face_uv_indices.size();
+    header.num_mat_indices = mesh.m_face_mat_indices.size();
+
+    // write to a file private to this process and thread, then publish it atomically
+    std::string tmp_file = cache_file + ".tmp" + std::to_string(getpid()) + "_" +
+                           std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    FILE* file = fopen(tmp_file.c_str(), "wb");
+    if (!file)
+        return;
+    fwrite(&header, sizeof(header), 1, file);
+    WriteArray(file, mesh.m_vertices);
+    WriteArray(file, mesh.m_normals);
+    WriteArray(file, mesh.m_UV);
+    WriteArray(file, mesh.m_face_v_indices);
+    WriteArray(file, mesh.m_face_n_indices);
+    WriteArray(file, mesh.m_face_uv_indices);
+    WriteArray(file, mesh.m_face_mat_indices);
+    bool ok = !ferror(file);
+    ok = fclose(file) == 0 && ok;
+
+#ifdef _WIN32
+    std::remove(cache_file.c_str());
+#endif
+    if (!ok || std::rename(tmp_file.c_str(), cache_file.c_str()) != 0)
+        std::remove(tmp_file.c_str());
+}
+
+std::shared_ptr<geometry::ChTriangleMeshConnected> ChMeshCache::LoadWavefrontMesh(const std::string& obj_file,
+                                                                                 bool load_normals,
+                                                                                 bool load_uv) {
+    auto mesh = chrono_types::make_shared<geometry::ChTriangleMeshConnected>();
+    uint32_t flags = (load_normals ? 1 : 0) | (load_uv ? 2 : 0);
+
+    uint64_t obj_size = 0;
+    uint64_t obj_hash = 0;
+    {
+        MappedFile obj(obj_file);
+        if (!obj.GetData()) {
+            mesh->LoadWavefrontMesh(obj_file, load_normals, load_uv);
+            return mesh;
+        }
+        obj_size = obj.GetSize();
+        obj_hash = HashFNV1a(obj.GetData(), obj.GetSize());
+    }
+
+    std::string cache_file = GetCacheFile(obj_file);
+    if (ReadCache(cache_file, flags, obj_size, obj_hash, *mesh)) {
+        mesh->m_filename = obj_file;
+        return mesh;
+    }
+
+    mesh->LoadWavefrontMesh(obj_file, load_normals, load_uv);
+    WriteCache(cache_file, flags, obj_size, obj_hash, *mesh);
+    return mesh;
+}
+
+}  // namespace synchrono
+}  // namespace chrono
@@ -0,0 +1,60 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Binary cache of preprocessed Wavefront OBJ meshes.
+//
+// The first load of an OBJ parses the text file with LoadWavefrontMesh and
+// writes the mesh arrays next to it ("<file>.obj.chmc"). Later loads, by any
+// process, map the cache file read-only and copy the arrays into the mesh; the
+// cache is validated against the size and the FNV-1a hash of the OBJ file and
+// rewritten if stale. Processes on one node share the page cache of both files
+// instead of each parsing the text. The cache is written to a temporary file
+// and renamed, so concurrent ranks never read a partial cache.
+//
+// Cache file (all little endian):
+//   header: magic "CHMC", uint32 version, uint32 load flags (1: normals,
+//           2: UVs), uint32 padding, uint64 OBJ size, uint64 OBJ hash,
+//           uint64 counts of the vertices, normals, UVs, vertex indices,
+//           normal indices, UV indices and material indices
+//   arrays: vertices and normals (3 doubles each), UVs (2 doubles each),
+//           vertex, normal and UV indices (3 int32 each), material indices
+//           (int32 each)
+//
+// =============================================================================
+
+#ifndef CH_MESH_CACHE_H
+#define CH_MESH_CACHE_H
+
+#include <memory>
+#include <string>
+
+#include "chrono/geometry/ChTriangleMeshConnected.h"
+
+namespace chrono {
+namespace synchrono {
+
+class ChMeshCache {
+  public:
+    /// Load the given OBJ file through its binary cache (creating or refreshing the cache if needed).
+    /// Falls back to parsing the OBJ file if it cannot be mapped or the cache cannot be written.
+    static std::shared_ptr<geometry::ChTriangleMeshConnected> LoadWavefrontMesh(const std::string& obj_file,
+                                                                               bool load_normals = true,
+                                                                               bool load_uv = false);
+
+    /// Return the cache file name of the given OBJ file.
+    static std::string GetCacheFile(const std::string& obj_file) { return obj_file + ".chmc"; }
+};
+
+}  // namespace synchrono
+}  // namespace chrono
+
+#endif
@@ -0,0 +1,445 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+
+#include "ChSceneStreamer.h"
+#include "ChMeshCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+    #include <process.h>
+    #define getpid _getpid
+#else
+    #include <unistd.h>
+#endif
+
+#include "chrono/assets/ChTriangleMeshShape.h"
+
+namespace chrono {
+namespace synchrono {
+
+static const uint32_t kDatabaseVersion = 2;
+
+// Size and FNV-1a hash of the contents of a file, to detect a database built from another instance map
+static bool HashFile(const std::string& filename, uint64_t& size, uint64_t& hash) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (!file)
+        return false;
+    size = 0;
+    hash = 14695981039346656037ull;
+    char buffer[65536];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            hash ^= (unsigned char)buffer[i];
+            hash *= 1099511628211ull;
+        }
+        size += count;
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+ChSceneStreamer::ChSceneStreamer(ChSystem* system,
+                                 const std::string& base_path,
+                                 const std::string& instance_map,
+                                 double tile_size)
+    : m_system(system),
+      m_base_path(base_path),
+      m_tile_size(tile_size),
+      m_load_radius(1000),
+      m_lod_distance(300),
+      m_roads_only(false),
+      m_max_pending(4),
+      m_num_attached(0) {
+    std::string csv_file = base_path + instance_map;
+    std::string db_file = csv_file.substr(0, csv_file.find_last_of('.')) + ".chsi";
+    uint64_t csv_size = 0;
+    uint64_t csv_hash = 0;
+    if (!HashFile(csv_file, csv_size, csv_hash))
+        throw std::runtime_error("Could not open file " + csv_file);
+    if (!ReadDatabase(db_file, csv_size, csv_hash)) {
+        if (!BuildDatabase(csv_file))
+            throw std::runtime_error("Could not open file " + csv_file);
+        if (!WriteDatabase(db_file, csv_size, csv_hash))
+            std::cout << "Could not write scene database " << db_file << std::endl;
+    }
+    std::cout << "Scene database: " << m_instances.size() << " instances in " << m_tiles.size() << " tiles, "
+              << m_mesh_names.size() << " unique meshes" << std::endl;
+}
+
+ChSceneStreamer::~ChSceneStreamer() {
+    for (auto& entry : m_states) {
+        if (entry.second.pending.valid())
+            entry.second.pending.wait();
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+bool ChSceneStreamer::BuildDatabase(const std::string& csv_file) {
+    std::ifstream infile(csv_file);
+    if (!infile.is_open())
+        return false;
+
+    std::map<std::pair<int32_t, int32_t>, std::vector<Instance>> tiles;
+    std::unordered_map<std::string, uint32_t> mesh_index;
+    std::string line, col;
+    std::vector<std::string> result;
+    while (std::getline(infile, line)) {
+        result.clear();
+        std::stringstream ss(line);
+        while (std::getline(ss, col, ','))
+            result.push_back(col);
+        if (result.size() < 12)
+            continue;
+
+        // exclude items with emission on
+        const std::string& mesh_name = result[0];
+        if (mesh_name.find("EmissionOn") != std::string::npos)
+            continue;
+
+        Instance instance;
+        auto found = mesh_index.find(result[1]);
+        if (found == mesh_index.end()) {
+            found = mesh_index.insert(std::make_pair(result[1], (uint32_t)m_mesh_names.size())).first;
+            m_mesh_names.push_back(result[1]);
+        }
+        instance.mesh = found->second;
+        instance.name = (uint32_t)m_instance_names.size();
+        m_instance_names.push_back(mesh_name);
+        instance.flags = mesh_name.find("Road") != std::string::npos ? ROAD : 0;
+        instance.padding = 0;
+        for (int i = 0; i < 3; i++)
+            instance.pos[i] = std::stod(result[2 + i]);
+        for (int i = 0; i < 4; i++)
+            instance.rot[i] = std::stod(result[5 + i]);
+        for (int i = 0; i < 3; i++)
+            instance.scale[i] = std::stod(result[9 + i]);
+
+        int32_t ix = (int32_t)std::floor(instance.pos[0] / m_tile_size);
+        int32_t iy = (int32_t)std::floor(instance.pos[1] / m_tile_size);
+        tiles[std::make_pair(ix, iy)].push_back(instance);
+    }
+
+    for (const auto& entry : tiles) {
+        Tile tile = {entry.first.first, entry.first.second, (uint32_t)m_instances.size(),
+                     (uint32_t)entry.second.size()};
+        m_tiles.push_back(tile);
+        m_instances.insert(m_instances.end(), entry.second.begin(), entry.second.end());
+    }
+    return true;
+}
+
+static void WriteString(FILE* file, const std::string& str) {
+    uint32_t length = (uint32_t)str.size();
+    fwrite(&length, sizeof(length), 1, file);
+    fwrite(str.data(), 1, length, file);
+}
+
+static bool ReadString(FILE* file, std::string& str) {
+    uint32_t length;
+    if (fread(&length, sizeof(length), 1, file) != 1)
+        return false;
+    str.resize(length);
+    return length == 0 || fread(&str[0], 1, length, file) == length;
+}
+
+bool ChSceneStreamer::WriteDatabase(const std::string& db_file, uint64_t csv_size, uint64_t csv_hash) const {
+    // write to a file private to this process, then publish it atomically
+    std::string tmp_file = db_file + ".tmp" + std::to_string(getpid());
+    FILE* file = fopen(tmp_file.c_str(), "wb");
+    if (!file)
+        return false;
+
+    fwrite("CHSI", 1, 4, file);
+    fwrite(&kDatabaseVersion, sizeof(kDatabaseVersion), 1, file);
+    fwrite(&m_tile_size, sizeof(m_tile_size), 1, file);
+    fwrite(&csv_size, sizeof(csv_size), 1, file);
+    fwrite(&csv_hash, sizeof(csv_hash), 1, file);
+
+    uint32_t num_meshes = (uint32_t)m_mesh_names.size();
+    uint32_t num_strings = num_meshes + (uint32_t)m_instance_names.size();
+    fwrite(&num_strings, sizeof(num_strings), 1, file);
+    for (const auto& name : m_mesh_names)
+        WriteString(file, name);
+    for (const auto& name : m_instance_names)
+        WriteString(file, name);
+    fwrite(&num_meshes, sizeof(num_meshes), 1, file);
+
+    uint32_t num_tiles = (uint32_t)m_tiles.size();
+    fwrite(&num_tiles, sizeof(num_tiles), 1, file);
+    fwrite(m_tiles.data(), sizeof(Tile), m_tiles.size(), file);
+
+    uint32_t num_instances = (uint32_t)m_instances.size();
+    fwrite(&num_instances, sizeof(num_instances), 1, file);
+    fwrite(m_instances.data(), sizeof(Instance), m_instances.size(), file);
+
+    bool ok = !ferror(file);
+    ok = fclose(file) == 0 && ok;
+
+#ifdef _WIN32
+    std::remove(db_file.c_str());
+#endif
+    if (!ok || std::rename(tmp_file.c_str(), db_file.c_str()) != 0) {
+        std::remove(tmp_file.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ChSceneStreamer::ReadDatabase(const std::string& db_file, uint64_t csv_size, uint64_t csv_hash) {
+    FILE* file = fopen(db_file.c_str(), "rb");
+    if (!file)
+        return false;
+
+    char magic[4];
+    uint32_t version;
+    double tile_size;
+    uint64_t size;
+    uint64_t hash;
+    bool ok = fread(magic, 1, 4, file) == 4 && std::memcmp(magic, "CHSI", 4) == 0 &&
+              fread(&version, sizeof(version), 1, file) == 1 && version == kDatabaseVersion &&
+              fread(&tile_size, sizeof(tile_size), 1, file) == 1 && tile_size == m_tile_size &&
+              fread(&size, sizeof(size), 1, file) == 1 && size == csv_size &&
+              fread(&hash, sizeof(hash), 1, file) == 1 && hash == csv_hash;
+
+    uint32_t num_strings = 0;
+    std::vector<std::string> strings;
+    ok = ok && fread(&num_strings, sizeof(num_strings), 1, file) == 1;
+    if (ok) {
+        strings.resize(num_strings);
+        for (uint32_t i = 0; ok && i < num_strings; i++)
+            ok = ReadString(file, strings[i]);
+    }
+
+    uint32_t num_meshes = 0;
+    uint32_t num_tiles = 0;
+    uint32_t num_instances = 0;
+    ok = ok && fread(&num_meshes, sizeof(num_meshes), 1, file) == 1 && num_meshes <= num_strings;
+    ok = ok && fread(&num_tiles, sizeof(num_tiles), 1, file) == 1;
+    if (ok) {
+        m_tiles.resize(num_tiles);
+        ok = fread(m_tiles.data(), sizeof(Tile), num_tiles, file) == num_tiles;
+    }
+    ok = ok && fread(&num_instances, sizeof(num_instances), 1, file) == 1;
+    if (ok) {
+        m_instances.resize(num_instances);
+        ok = fread(m_instances.data(), sizeof(Instance), num_instances, file) == num_instances;
+    }
+    fclose(file);
+
+    if (!ok) {
+        m_tiles.clear();
+        m_instances.clear();
+        return false;
+    }
+    m_mesh_names.assign(strings.begin(), strings.begin() + num_meshes);
+    m_instance_names.assign(strings.begin() + num_meshes, strings.end());
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+double ChSceneStreamer::DistanceToTile(const ChVector<>& loc, const Tile& tile) const {
+    double x_min = tile.ix * m_tile_size;
+    double y_min = tile.iy * m_tile_size;
+    double dx = std::max(std::max(x_min - loc.x(), loc.x() - (x_min + m_tile_size)), 0.0);
+    double dy = std::max(std::max(y_min - loc.y(), loc.y() - (y_min + m_tile_size)), 0.0);
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+bool ChSceneStreamer::Update(const std::vector<ChVector<>>& locations, bool wait) {
+    bool changed = false;
+
+    // Level of detail wanted for each tile in range (hysteresis of one tile for the tiles already loaded)
+    for (auto& entry : m_states)
+        entry.second.wanted = false;
+    std::vector<std::pair<double, size_t>> requests;
+    for (size_t i = 0; i < m_tiles.size(); i++) {
+        double dist = std::numeric_limits<double>::max();
+        for (const auto& loc : locations)
+            dist = std::min(dist, DistanceToTile(loc, m_tiles[i]));
+        auto state = m_states.find(i);
+        double radius = m_load_radius + (state != m_states.end() ? m_tile_size : 0);
+        if (dist > radius)
+            continue;
+        int lod = dist > m_lod_distance ? 1 : 0;
+        TileState& tile_state = m_states[i];
+        tile_state.wanted = true;
+        if (tile_state.lod != lod && tile_state.pending_lod != lod)
+            requests.push_back(std::make_pair(dist, i));
+    }
+
+    // Start the loads of the closest tiles first
+    std::sort(requests.begin(), requests.end());
+    size_t next_request = 0;
+
+    while (true) {
+        int num_pending = 0;
+        for (auto& entry : m_states) {
+            TileState& state = entry.second;
+            if (!state.pending.valid())
+                continue;
+            if (state.pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                num_pending++;
+                continue;
+            }
+            TileMeshes meshes = state.pending.get();
+            int lod = state.pending_lod;
+            state.pending_lod = -1;
+            if (!state.wanted)
+                continue;
+            Detach(state);
+            state.body = CreateTileBody(entry.first, meshes);
+            state.lod = lod;
+            if (state.body) {
+                m_system->AddBody(state.body);
+                m_num_attached += (int)state.body->GetAssets().size();
+            }
+            changed = true;
+        }
+
+        while (next_request < requests.size() && num_pending < m_max_pending) {
+            size_t tile = requests[next_request].second;
+            TileState& state = m_states[tile];
+            next_request++;
+            if (state.pending.valid())
+                continue;
+            int lod = requests[next_request - 1].first > m_lod_distance ? 1 : 0;
+            state.pending_lod = lod;
+            state.pending = std::async(std::launch::async, &ChSceneStreamer::LoadTile, this, tile, lod);
+            num_pending++;
+        }
+
+        if (!wait || (num_pending == 0 && next_request >= requests.size()))
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // Remove the tiles out of range (keeping the states of pending loads until they complete)
+    for (auto it = m_states.begin(); it != m_states.end();) {
+        TileState& state = it->second;
+        if (!state.wanted) {
+            if (state.body)
+                changed = true;
+            Detach(state);
+            if (!state.pending.valid()) {
+                it = m_states.erase(it);
+                continue;
+            }
+        }
+        ++it;
+    }
+
+    return changed;
+}
+
+int ChSceneStreamer::GetNumAttachedTiles() const {
+    int count = 0;
+    for (const auto& entry : m_states)
+        count += entry.second.body ? 1 : 0;
+    return count;
+}
+
+void ChSceneStreamer::Detach(TileState& state) {
+    if (state.body) {
+        m_num_attached -= (int)state.body->GetAssets().size();
+        m_system->RemoveBody(state.body);
+        state.body.reset();
+    }
+    state.lod = -1;
+}
+
+// -----------------------------------------------------------------------------
+
+ChSceneStreamer::TileMeshes ChSceneStreamer::LoadTile(size_t tile, int lod) {
+    const Tile& t = m_tiles[tile];
+    TileMeshes meshes(t.count);
+    for (uint32_t i = 0; i < t.count; i++) {
+        const Instance& instance = m_instances[t.first + i];
+        if (m_roads_only && !(instance.flags & ROAD))
+            continue;
+        meshes[i] = LoadMesh(instance.mesh, lod);
+    }
+    return meshes;
+}
+
+std::shared_ptr<geometry::ChTriangleMeshConnected> ChSceneStreamer::LoadMesh(uint32_t mesh, int lod) {
+    // use the low detail mesh when available
+    std::string obj_file = m_base_path + m_mesh_names[mesh] + ".obj";
+    if (lod > 0) {
+        std::string lod_file = m_base_path + m_mesh_names[mesh] + "_lod1.obj";
+        if (std::ifstream(lod_file).good())
+            obj_file = lod_file;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_cache_mutex);
+        auto found = m_mesh_cache.find(obj_file);
+        if (found != m_mesh_cache.end()) {
+            if (auto cached = found->second.lock())
+                return cached;
+        }
+    }
+
+    // load outside of the lock; if another tile loaded the same mesh meanwhile, use the cached one
+    auto loaded = ChMeshCache::LoadWavefrontMesh(obj_file, false, true);
+
+    std::lock_guard<std::mutex> lock(m_cache_mutex);
+    auto& entry = m_mesh_cache[obj_file];
+    if (auto cached = entry.lock())
+        return cached;
+    entry = loaded;
+    return loaded;
+}
+
+std::shared_ptr<ChBody> ChSceneStreamer::CreateTileBody(size_t tile, const TileMeshes& meshes) const {
+    const Tile& t = m_tiles[tile];
+    auto body = chrono_types::make_shared<ChBody>();
+    body->SetBodyFixed(true);
+    body->SetCollide(false);
+
+    int num_shapes = 0;
+    for (uint32_t i = 0; i < t.count; i++) {
+        if (!meshes[i])
+            continue;
+        const Instance& instance = m_instances[t.first + i];
+        auto trimesh_shape = chrono_types::make_shared<ChTriangleMeshShape>();
+        trimesh_shape->SetMesh(meshes[i]);
+        trimesh_shape->SetName(m_instance_names[instance.name]);
+        trimesh_shape->SetStatic(true);
+        trimesh_shape->SetScale(ChVector<>(instance.scale[0], instance.scale[1], instance.scale[2]));
+        trimesh_shape->Pos = ChVector<>(instance.pos[0], instance.pos[1], instance.pos[2]);
+        trimesh_shape->Rot =
+            ChMatrix33<>(ChQuaternion<>(instance.rot[0], instance.rot[1], instance.rot[2], instance.rot[3]));
+        body->AddAsset(trimesh_shape);
+        num_shapes++;
+    }
+    return num_shapes > 0 ? body : nullptr;
+}
+
+}  // namespace synchrono
+}  // namespace chrono
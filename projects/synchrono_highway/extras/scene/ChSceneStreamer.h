@@ -0,0 +1,160 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Proximity-streamed loading of the scene mesh instances of the highway world.
+//
+// The instance map (CSV: name, mesh, position, rotation, scale) is converted
+// once into a binary database of instances grouped by square tiles in the XY
+// plane (written next to the CSV with the extension ".chsi", rebuilt if
+// missing, built with another tile size, or built from another version of the
+// CSV, as identified by its size and hash). Update loads, on worker threads,
+// the meshes of the tiles within the load radius of any of the given
+// locations, attaches each tile as a static body once its meshes are loaded,
+// and removes the tiles which moved out of range (with a hysteresis of one
+// tile). Tiles farther than the LOD distance use the "<mesh>_lod1.obj" meshes
+// when available. Meshes are loaded through their binary cache (see
+// ChMeshCache), shared between instances and tiles, and released when no
+// loaded tile uses them.
+//
+// Binary database (all little endian):
+//   header:    magic "CHSI", uint32 version, double tile size, uint64 CSV
+//              size, uint64 CSV hash (FNV-1a)
+//   strings:   uint32 count, then per string uint32 length and characters, for
+//              the mesh names and then the instance names
+//   tiles:     uint32 count, then per tile int32 ix, int32 iy, uint32 first
+//              instance, uint32 number of instances
+//   instances: uint32 count, then per instance uint32 mesh, uint32 name,
+//              uint32 flags, uint32 padding, position (3 doubles), rotation
+//              quaternion (4 doubles), scale (3 doubles)
+//
+// =============================================================================
+
+#ifndef CH_SCENE_STREAMER_H
+#define CH_SCENE_STREAMER_H
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "chrono/geometry/ChTriangleMeshConnected.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChSystem.h"
+
+namespace chrono {
+namespace synchrono {
+
+class ChSceneStreamer {
+  public:
+    /// Open the tiled database of the given instance map in the given directory (building it if needed).
+    ChSceneStreamer(ChSystem* system,
+                    const std::string& base_path,     ///< directory of the instance map and of the meshes
+                    const std::string& instance_map,  ///< instance map file name (CSV)
+                    double tile_size = 100            ///< edge length of the tiles
+    );
+
+    /// Wait for the pending tile loads.
+    ~ChSceneStreamer();
+
+    /// Set the distance from the locations within which tiles are loaded (default: 1000).
+    void SetLoadRadius(double radius) { m_load_radius = radius; }
+
+    /// Set the distance beyond which the low detail meshes are used when available (default: 300).
+    void SetLODDistance(double distance) { m_lod_distance = distance; }
+
+    /// Only load the road instances (default: false).
+    void SetRoadsOnly(bool roads_only) { m_roads_only = roads_only; }
+
+    /// Set the maximum number of tiles loaded concurrently (default: 4).
+    void SetMaxPendingLoads(int num_loads) { m_max_pending = num_loads; }
+
+    /// Update the loaded tiles for the given locations (e.g., the vehicle positions). If wait is true, return only
+    /// once all tiles in range are attached. Return true if tiles were attached or removed.
+    bool Update(const std::vector<ChVector<>>& locations, bool wait = false);
+
+    /// Return the number of tiles and instances in the database.
+    size_t GetNumTiles() const { return m_tiles.size(); }
+    size_t GetNumInstances() const { return m_instances.size(); }
+
+    /// Return the number of attached tiles and instances.
+    int GetNumAttachedTiles() const;
+    int GetNumAttachedInstances() const { return m_num_attached; }
+
+  private:
+    enum InstanceFlags { ROAD = 1 };
+
+    struct Instance {
+        uint32_t mesh;
+        uint32_t name;
+        uint32_t flags;
+        uint32_t padding;
+        double pos[3];
+        double rot[4];
+        double scale[3];
+    };
+
+    struct Tile {
+        int32_t ix;
+        int32_t iy;
+        uint32_t first;
+        uint32_t count;
+    };
+
+    // Meshes of the instances of a tile (null for skipped instances)
+    typedef std::vector<std::shared_ptr<geometry::ChTriangleMeshConnected>> TileMeshes;
+
+    struct TileState {
+        int lod = -1;                        ///< level of detail of the attached body
+        std::shared_ptr<ChBody> body;        ///< attached body (if any)
+        int pending_lod = -1;                ///< level of detail being loaded
+        std::future<TileMeshes> pending;     ///< pending load (if any)
+        bool wanted = false;                 ///< in range at the last update
+    };
+
+    bool BuildDatabase(const std::string& csv_file);
+    bool ReadDatabase(const std::string& db_file, uint64_t csv_size, uint64_t csv_hash);
+    bool WriteDatabase(const std::string& db_file, uint64_t csv_size, uint64_t csv_hash) const;
+
+    TileMeshes LoadTile(size_t tile, int lod);
+    std::shared_ptr<geometry::ChTriangleMeshConnected> LoadMesh(uint32_t mesh, int lod);
+    std::shared_ptr<ChBody> CreateTileBody(size_t tile, const TileMeshes& meshes) const;
+    void Detach(TileState& state);
+
+    double DistanceToTile(const ChVector<>& loc, const Tile& tile) const;
+
+    ChSystem* m_system;
+    std::string m_base_path;
+    double m_tile_size;
+    double m_load_radius;
+    double m_lod_distance;
+    bool m_roads_only;
+    int m_max_pending;
+
+    std::vector<std::string> m_mesh_names;
+    std::vector<std::string> m_instance_names;
+    std::vector<Tile> m_tiles;
+    std::vector<Instance> m_instances;
+
+    std::unordered_map<size_t, TileState> m_states;
+    int m_num_attached;
+
+    std::mutex m_cache_mutex;
+    std::unordered_map<std::string, std::weak_ptr<geometry::ChTriangleMeshConnected>> m_mesh_cache;
+};
+
+}  // namespace synchrono
+}  // namespace chrono
+
+#endif
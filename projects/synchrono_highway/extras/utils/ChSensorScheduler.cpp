@@ -0,0 +1,58 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+
+#include "ChSensorScheduler.h"
+
+#include <chrono>
+#include <cmath>
+
+namespace chrono {
+namespace sensor {
+
+ChSensorScheduler::ChSensorScheduler(std::shared_ptr<ChSensorManager> manager, double step_size)
+    : m_manager(manager), m_step_size(step_size), m_num_steps(0), m_num_updates(0), m_update_time(0) {}
+
+bool ChSensorScheduler::IsDue(double time) const {
+    for (auto& sensor : m_manager->GetSensorList()) {
+        if (sensor->GetUpdateRate() <= 0)
+            return true;
+
+        // the first step at or after the start of an update, and the steps of its collection window
+        double period = 1.0 / sensor->GetUpdateRate();
+        double start = std::floor(time / period + 1e-6) * period;
+        if (time - start < m_step_size + sensor->GetCollectionWindow())
+            return true;
+    }
+    return false;
+}
+
+bool ChSensorScheduler::Update(double time) {
+    m_num_steps++;
+    if (!IsDue(time))
+        return false;
+
+    auto update_start = std::chrono::high_resolution_clock::now();
+    m_manager->Update();
+    m_update_time +=
+        std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - update_start).count();
+    m_num_updates++;
+    return true;
+}
+
+void ChSensorScheduler::ResetStats() {
+    m_num_steps = 0;
+    m_num_updates = 0;
+    m_update_time = 0;
+}
+
+}  // namespace sensor
+}  // namespace chrono
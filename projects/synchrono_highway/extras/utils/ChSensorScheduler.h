@@ -0,0 +1,60 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Schedules the updates of a sensor manager at the rates of its sensors.
+//
+// Calling ChSensorManager::Update on every physics step refreshes the scene
+// description on the physics critical path even when no sensor is due.
+// Update returns true only on the steps where a sensor starts an update or
+// collects data (its collection window), and times the updates.
+//
+// =============================================================================
+
+#ifndef CH_SENSOR_SCHEDULER_H
+#define CH_SENSOR_SCHEDULER_H
+
+#include <memory>
+
+#include "chrono_sensor/ChSensorManager.h"
+
+namespace chrono {
+namespace sensor {
+
+class ChSensorScheduler {
+  public:
+    /// Schedule the updates of the given manager, for a physics loop with the given step size.
+    ChSensorScheduler(std::shared_ptr<ChSensorManager> manager, double step_size);
+
+    /// Update the sensor manager if a sensor is due at the given time. Return true if it was updated.
+    bool Update(double time);
+
+    /// Return true if a sensor starts an update or collects data at the given time.
+    bool IsDue(double time) const;
+
+    /// Return the number of steps, of manager updates, and the wall time spent in the updates since the last reset.
+    unsigned int GetNumSteps() const { return m_num_steps; }
+    unsigned int GetNumUpdates() const { return m_num_updates; }
+    double GetUpdateTime() const { return m_update_time; }
+    void ResetStats();
+
+  private:
+    std::shared_ptr<ChSensorManager> m_manager;
+    double m_step_size;
+    unsigned int m_num_steps;
+    unsigned int m_num_updates;
+    double m_update_time;
+};
+
+}  // namespace sensor
+}  // namespace chrono
+
+#endif
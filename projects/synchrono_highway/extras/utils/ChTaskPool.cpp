@@ -0,0 +1,89 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+
+#include "ChTaskPool.h"
+
+#include <algorithm>
+
+namespace chrono {
+namespace synchrono {
+
+ChTaskPool::ChTaskPool(int num_threads)
+    : m_generation(0), m_num_busy(0), m_exit(false), m_func(nullptr), m_n(0), m_next(0) {
+    if (num_threads <= 0)
+        num_threads = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+    for (int i = 0; i < num_threads; i++)
+        m_threads.emplace_back(&ChTaskPool::Work, this);
+}
+
+ChTaskPool::~ChTaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_exit = true;
+    }
+    m_start.notify_all();
+    for (auto& thread : m_threads)
+        thread.join();
+}
+
+void ChTaskPool::ParallelFor(size_t n, const std::function<void(size_t)>& func) {
+    if (n == 0)
+        return;
+    if (n == 1 || m_threads.empty()) {
+        for (size_t i = 0; i < n; i++)
+            func(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_func = &func;
+        m_n = n;
+        m_next = 0;
+        m_num_busy = (int)m_threads.size();
+        m_generation++;
+    }
+    m_start.notify_all();
+
+    RunIterations();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_num_busy == 0; });
+    m_func = nullptr;
+}
+
+void ChTaskPool::Work() {
+    unsigned int generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [&] { return m_exit || m_generation != generation; });
+            if (m_exit)
+                return;
+            generation = m_generation;
+        }
+
+        RunIterations();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_num_busy == 0)
+            m_done.notify_one();
+    }
+}
+
+void ChTaskPool::RunIterations() {
+    for (size_t i = m_next++; i < m_n; i = m_next++)
+        (*m_func)(i);
+}
+
+}  // namespace synchrono
+}  // namespace chrono
@@ -0,0 +1,66 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Fixed pool of worker threads running the iterations of parallel loops (e.g.
+// the per-vehicle work of the agents hosted by one node). The calling thread
+// takes part in the loop and returns once all the iterations are complete.
+//
+// =============================================================================
+
+#ifndef CH_TASK_POOL_H
+#define CH_TASK_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace chrono {
+namespace synchrono {
+
+class ChTaskPool {
+  public:
+    /// Start the given number of worker threads (0: one less than the hardware threads).
+    explicit ChTaskPool(int num_threads = 0);
+
+    /// Stop the worker threads.
+    ~ChTaskPool();
+
+    /// Run func(i) for i in [0, n) on the workers and the calling thread, and wait for all of them.
+    void ParallelFor(size_t n, const std::function<void(size_t)>& func);
+
+    /// Return the number of worker threads.
+    int GetNumThreads() const { return (int)m_threads.size(); }
+
+  private:
+    void Work();
+    void RunIterations();
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_start;     ///< signals a new loop (or the exit) to the workers
+    std::condition_variable m_done;      ///< signals the completion of the loop to the caller
+    unsigned int m_generation;           ///< number of loops started
+    int m_num_busy;                      ///< workers in the current loop
+    bool m_exit;
+
+    const std::function<void(size_t)>* m_func;
+    size_t m_n;
+    std::atomic<size_t> m_next;          ///< next iteration to run
+};
+
+}  // namespace synchrono
+}  // namespace chrono
+
+#endif
@@ -0,0 +1,215 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+
+#include "ChTelemetryRecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace chrono {
+namespace synchrono {
+
+static const uint32_t kTelemetryVersion = 1;
+
+// -----------------------------------------------------------------------------
+
+ChTelemetryRecorder::Channel::Channel(ChTelemetryRecorder& recorder, unsigned int agent, size_t capacity)
+    : m_recorder(recorder), m_agent(agent), m_head(0), m_tail(0), m_dropped(0) {
+    size_t cap = 2;
+    while (cap < capacity)
+        cap *= 2;
+    m_ring.resize(cap);
+    m_mask = cap - 1;
+}
+
+bool ChTelemetryRecorder::Channel::Record(const ChTelemetryRecord& record) {
+    uint64_t head = m_head.load(std::memory_order_relaxed);
+    uint64_t tail = m_tail.load(std::memory_order_acquire);
+    if (head - tail > m_mask) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    m_ring[head & m_mask] = record;
+    m_ring[head & m_mask].agent = m_agent;
+
+    m_head.store(head + 1, std::memory_order_release);
+    if (head + 1 - tail == (m_mask + 1) / 2)
+        m_recorder.m_cv.notify_one();
+    return true;
+}
+
+bool ChTelemetryRecorder::Channel::Record(double time,
+                                          const vehicle::ChVehicle& vehicle,
+                                          const vehicle::ChDriver::Inputs& inputs) {
+    ChTelemetryRecord r;
+    r.time = time;
+    const ChVector<>& pos = vehicle.GetVehiclePos();
+    for (int i = 0; i < 3; i++)
+        r.pos[i] = pos[i];
+    r.steering = (float)inputs.m_steering;
+    r.throttle = (float)inputs.m_throttle;
+    r.braking = (float)inputs.m_braking;
+    r.speed = (float)vehicle.GetVehicleSpeed();
+    r.padding = 0;
+    return Record(r);
+}
+
+// -----------------------------------------------------------------------------
+
+ChTelemetryRecorder::ChTelemetryRecorder(const std::string& filename, size_t capacity, double flush_interval)
+    : m_filename(filename), m_capacity(capacity), m_flush_interval(flush_interval), m_stop(false) {
+    m_file = fopen(filename.c_str(), "wb");
+    if (!m_file) {
+        std::cout << "ChTelemetryRecorder: cannot open " << filename << std::endl;
+        return;
+    }
+    uint32_t header[3];
+    std::memcpy(&header[0], "CHTL", 4);
+    header[1] = kTelemetryVersion;
+    header[2] = (uint32_t)sizeof(ChTelemetryRecord);
+    fwrite(header, sizeof(header), 1, m_file);
+
+    m_writer = std::thread(&ChTelemetryRecorder::Drain, this);
+}
+
+ChTelemetryRecorder::~ChTelemetryRecorder() {
+    Close();
+}
+
+ChTelemetryRecorder::Channel* ChTelemetryRecorder::AddChannel(unsigned int agent) {
+    if (!m_file)
+        return nullptr;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_channels.emplace_back(new Channel(*this, agent, m_capacity));
+    return m_channels.back().get();
+}
+
+void ChTelemetryRecorder::Close() {
+    if (!m_file)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_one();
+    m_writer.join();
+    fclose(m_file);
+    m_file = nullptr;
+
+    uint64_t dropped = GetNumDropped();
+    if (dropped > 0)
+        std::cout << "ChTelemetryRecorder: dropped " << dropped << " records in " << m_filename << std::endl;
+}
+
+uint64_t ChTelemetryRecorder::GetNumDropped() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t dropped = 0;
+    for (const auto& channel : m_channels)
+        dropped += channel->GetNumDropped();
+    return dropped;
+}
+
+void ChTelemetryRecorder::Drain() {
+    auto half_full = [this]() {
+        for (const auto& c : m_channels) {
+            if (c->m_head.load(std::memory_order_acquire) - c->m_tail.load(std::memory_order_relaxed) >=
+                (c->m_mask + 1) / 2)
+                return true;
+        }
+        return false;
+    };
+
+    auto last_flush = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cv.wait_for(lock, std::chrono::milliseconds(100), [&]() { return m_stop || half_full(); });
+        bool stop = m_stop;
+        for (auto& c : m_channels) {
+            uint64_t head = c->m_head.load(std::memory_order_acquire);
+            uint64_t tail = c->m_tail.load(std::memory_order_relaxed);
+            while (tail < head) {
+                size_t begin = tail & c->m_mask;
+                size_t count = std::min((size_t)(head - tail), c->m_ring.size() - begin);
+                fwrite(&c->m_ring[begin], sizeof(ChTelemetryRecord), count, m_file);
+                tail += count;
+            }
+            c->m_tail.store(tail, std::memory_order_release);
+        }
+        if (stop)
+            break;
+
+        auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration<double>(now - last_flush).count() >= m_flush_interval) {
+            fflush(m_file);
+            last_flush = now;
+        }
+    }
+    fflush(m_file);
+}
+
+// -----------------------------------------------------------------------------
+
+bool ReadTelemetryFile(const std::string& filename, std::vector<ChTelemetryRecord>& records) {
+    records.clear();
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (!file)
+        return false;
+    uint32_t header[3];
+    bool ok = fread(header, sizeof(header), 1, file) == 1 && std::memcmp(&header[0], "CHTL", 4) == 0 &&
+              header[1] == kTelemetryVersion && header[2] == sizeof(ChTelemetryRecord);
+    ChTelemetryRecord r;
+    while (ok && fread(&r, sizeof(r), 1, file) == 1)
+        records.push_back(r);
+    fclose(file);
+    return ok;
+}
+
+bool WriteTelemetryCSV(const std::vector<ChTelemetryRecord>& records, const std::string& filename, int agent) {
+    FILE* file = fopen(filename.c_str(), "w");
+    if (!file)
+        return false;
+    fprintf(file, "agent,time,x,y,z,speed,steering,throttle,braking\n");
+    for (const auto& r : records) {
+        if (agent >= 0 && r.agent != (uint32_t)agent)
+            continue;
+        fprintf(file, "%u,%.8g,%.10g,%.10g,%.10g,%.6g,%.6g,%.6g,%.6g\n", r.agent, r.time, r.pos[0], r.pos[1],
+                r.pos[2], r.speed, r.steering, r.throttle, r.braking);
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+bool WriteDriverInputs(const std::vector<ChTelemetryRecord>& records, const std::string& filename, unsigned int agent) {
+    std::vector<ChTelemetryRecord> inputs;
+    for (const auto& r : records) {
+        if (r.agent == agent)
+            inputs.push_back(r);
+    }
+    std::stable_sort(inputs.begin(), inputs.end(),
+                     [](const ChTelemetryRecord& a, const ChTelemetryRecord& b) { return a.time < b.time; });
+
+    FILE* file = fopen(filename.c_str(), "w");
+    if (!file)
+        return false;
+    for (const auto& r : inputs)
+        fprintf(file, "%.8g %.6g %.6g %.6g\n", r.time, r.steering, r.throttle, r.braking);
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+}  // namespace synchrono
+}  // namespace chrono
@@ -0,0 +1,145 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Binary telemetry channel of the agents of one node (driver inputs, chassis
+// position and speed at each step).
+//
+// Each agent records into its own channel, a fixed-size ring buffer of fixed
+// records with a single producer, so the agents stepped on different threads
+// never contend. A background thread drains all the channels to one binary
+// file whenever one of them is half full (or at least every 100 ms) and
+// flushes the file periodically, so a crashed run keeps its telemetry up to
+// the last flush. If the writer falls behind, records are dropped rather than
+// blocking the simulation; they are counted per channel (GetNumDropped, which
+// the highway demo reports with its periodic log) and the total is reported
+// when closing.
+//
+// The file (header "CHTL", version, record size, then raw records of all the
+// channels, in drain order) can be read back with ReadTelemetryFile and
+// converted to CSV with WriteTelemetryCSV, or to the driver input file read by
+// ChDataDriver with WriteDriverInputs.
+//
+// =============================================================================
+
+#ifndef CH_TELEMETRY_RECORDER_H
+#define CH_TELEMETRY_RECORDER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chrono_vehicle/ChDriver.h"
+#include "chrono_vehicle/ChVehicle.h"
+
+namespace chrono {
+namespace synchrono {
+
+/// Telemetry of one agent at one step.
+struct ChTelemetryRecord {
+    double time;        ///< simulation time
+    double pos[3];      ///< chassis position
+    float steering;     ///< steering input
+    float throttle;     ///< throttle input
+    float braking;      ///< braking input
+    float speed;        ///< chassis speed
+    uint32_t agent;     ///< agent identifier of the channel
+    uint32_t padding;
+};
+
+class ChTelemetryRecorder {
+  public:
+    /// Ring buffer of the records of one agent. Record must always be called from the same thread.
+    class Channel {
+      public:
+        /// Record the given telemetry. Return false if the ring buffer is full (the record is dropped).
+        bool Record(const ChTelemetryRecord& record);
+
+        /// Record the driver inputs and the chassis state of the given vehicle.
+        bool Record(double time, const vehicle::ChVehicle& vehicle, const vehicle::ChDriver::Inputs& inputs);
+
+        /// Return the agent identifier of this channel.
+        unsigned int GetAgent() const { return m_agent; }
+
+        /// Return the number of records dropped so far (ring buffer full).
+        uint64_t GetNumDropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+      private:
+        Channel(ChTelemetryRecorder& recorder, unsigned int agent, size_t capacity);
+
+        ChTelemetryRecorder& m_recorder;
+        unsigned int m_agent;
+        std::vector<ChTelemetryRecord> m_ring;
+        size_t m_mask;
+        std::atomic<uint64_t> m_head;     ///< next record to write (producer thread)
+        std::atomic<uint64_t> m_tail;     ///< next record to drain (writer thread)
+        std::atomic<uint64_t> m_dropped;
+
+        friend class ChTelemetryRecorder;
+    };
+
+    /// Open the telemetry file and start the writer thread. The capacity of the ring buffer of each channel is rounded
+    /// up to a power of 2.
+    ChTelemetryRecorder(const std::string& filename,
+                        size_t capacity = 1 << 14,    ///< records per channel
+                        double flush_interval = 1.0   ///< wall time between flushes of the file (in seconds)
+    );
+
+    /// Write all pending records and close the file.
+    ~ChTelemetryRecorder();
+
+    /// Add the channel of the given agent. The channel is owned by the recorder and remains valid until it is
+    /// destroyed. Return nullptr if the file could not be opened.
+    Channel* AddChannel(unsigned int agent);
+
+    /// Write all pending records, stop the writer thread, and close the file.
+    void Close();
+
+    /// Return the number of records dropped so far over all channels.
+    uint64_t GetNumDropped() const;
+
+  private:
+    void Drain();
+
+    std::string m_filename;
+    size_t m_capacity;
+    double m_flush_interval;
+    std::vector<std::unique_ptr<Channel>> m_channels;
+
+    FILE* m_file;
+    std::thread m_writer;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop;
+};
+
+/// Read a telemetry file written by ChTelemetryRecorder. Return false if the file cannot be read or has an invalid
+/// header.
+bool ReadTelemetryFile(const std::string& filename, std::vector<ChTelemetryRecord>& records);
+
+/// Write the telemetry records of the given agent (or of all agents if negative) to a CSV file. Return false on
+/// failure.
+bool WriteTelemetryCSV(const std::vector<ChTelemetryRecord>& records, const std::string& filename, int agent = -1);
+
+/// Write the driver inputs of the given agent, in time order, to a file that can be replayed with ChDataDriver.
+/// Return false on failure.
+bool WriteDriverInputs(const std::vector<ChTelemetryRecord>& records, const std::string& filename, unsigned int agent);
+
+}  // namespace synchrono
+}  // namespace chrono
+
+#endif
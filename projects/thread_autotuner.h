@@ -0,0 +1,268 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Measured selection of the number of OpenMP threads for a Chrono system.
+//
+// During the first steps of a simulation, each candidate thread count is used
+// for a given number of steps (after one warm-up step) and the average times
+// of the whole step and of its phases (collision broadphase and narrowphase,
+// solver, update) are recorded. Once all candidates have been sampled, the
+// thread count with the smallest step time is selected for the rest of the
+// simulation. The result, including the best thread count for each phase, is
+// saved in a per-host profile, keyed by the problem name and size (rounded to
+// a power of 2); later runs of the same problem on the same machine start
+// directly with the tuned thread count.
+//
+// Note that the number of threads is set for the whole system, so the per-phase
+// optima are recorded for information only.
+//
+// Typical use:
+//   ThreadAutotuner tuner("settling", num_bodies);
+//   tuner.Initialize(system);
+//   while (...) {
+//       system->DoStepDynamics(step);
+//       tuner.Advance(system);
+//   }
+//
+// =============================================================================
+
+#ifndef THREAD_AUTOTUNER_H
+#define THREAD_AUTOTUNER_H
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <process.h>
+#define THREAD_AUTOTUNER_GETPID _getpid
+#else
+#include <unistd.h>
+#define THREAD_AUTOTUNER_GETPID getpid
+#endif
+
+#include "chrono/parallel/ChOpenMP.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono_thirdparty/filesystem/path.h"
+
+class ThreadAutotuner {
+  public:
+    enum Phase { STEP, BROADPHASE, NARROWPHASE, SOLVER, UPDATE, NUM_PHASES };
+
+    /// Create an autotuner for the given problem, of given size (e.g., number of bodies).
+    /// The candidate thread counts are 1, 2, 4, ... up to the number of processors (included).
+    ThreadAutotuner(const std::string& problem,
+                    size_t problem_size,
+                    int steps_per_candidate = 20,
+                    const std::string& profile_dir = "../THREAD_PROFILES")
+        : m_problem(problem),
+          m_steps(steps_per_candidate),
+          m_dir(profile_dir),
+          m_current(0),
+          m_step(0),
+          m_done(false),
+          m_best(1) {
+        m_size_bucket = problem_size > 1 ? (int)std::ceil(std::log2((double)problem_size)) : 0;
+        int num_procs = chrono::ChOMP::GetNumProcs();
+        for (int n = 1; n < num_procs; n *= 2)
+            m_candidates.push_back(n);
+        m_candidates.push_back(num_procs);
+        for (int p = 0; p < NUM_PHASES; p++)
+            m_best_phase[p] = 1;
+    }
+
+    /// Set the list of candidate thread counts (must be called before Initialize).
+    void SetCandidates(const std::vector<int>& candidates) { m_candidates = candidates; }
+
+    /// Set the number of threads for the first step: the tuned value if a profile entry exists for this problem on
+    /// this host, otherwise the first candidate (in which case the sampling starts).
+    void Initialize(chrono::ChSystem* system) {
+        m_done = ReadProfile();
+        if (m_done) {
+            std::cout << "Thread autotuner: using " << m_best << " threads from " << GetProfileFilename() << std::endl;
+            system->SetNumThreads(m_best);
+            return;
+        }
+        m_times.assign(m_candidates.size() * NUM_PHASES, 0.0);
+        m_current = 0;
+        m_step = 0;
+        system->SetNumThreads(m_candidates[0]);
+    }
+
+    /// Record the timers of the last step and, if needed, switch to the next candidate or to the selected number of
+    /// threads. Must be called after each step.
+    void Advance(chrono::ChSystem* system) {
+        if (m_done)
+            return;
+
+        // Skip the first step with each candidate (warm-up)
+        if (m_step++ == 0)
+            return;
+
+        double* times = &m_times[m_current * NUM_PHASES];
+        times[STEP] += system->GetTimerStep();
+        times[BROADPHASE] += system->GetTimerCollisionBroad();
+        times[NARROWPHASE] += system->GetTimerCollisionNarrow();
+        times[SOLVER] += system->GetTimerAdvance();
+        times[UPDATE] += system->GetTimerUpdate();
+
+        if (m_step <= m_steps)
+            return;
+
+        // Move to the next candidate
+        m_current++;
+        m_step = 0;
+        if (m_current < m_candidates.size()) {
+            system->SetNumThreads(m_candidates[m_current]);
+            return;
+        }
+
+        // All candidates sampled: select the best and save the profile
+        for (int p = 0; p < NUM_PHASES; p++) {
+            size_t best = 0;
+            for (size_t ic = 1; ic < m_candidates.size(); ic++) {
+                if (m_times[ic * NUM_PHASES + p] < m_times[best * NUM_PHASES + p])
+                    best = ic;
+            }
+            m_best_phase[p] = m_candidates[best];
+        }
+        m_best = m_best_phase[STEP];
+        m_done = true;
+        system->SetNumThreads(m_best);
+
+        std::cout << "Thread autotuner: selected " << m_best << " threads" << std::endl;
+        for (size_t ic = 0; ic < m_candidates.size(); ic++) {
+            printf("   %4d threads: step %8.3f ms  (broad %7.3f  narrow %7.3f  solver %7.3f  update %7.3f)\n",
+                   m_candidates[ic], 1e3 * m_times[ic * NUM_PHASES + STEP] / m_steps,
+                   1e3 * m_times[ic * NUM_PHASES + BROADPHASE] / m_steps,
+                   1e3 * m_times[ic * NUM_PHASES + NARROWPHASE] / m_steps,
+                   1e3 * m_times[ic * NUM_PHASES + SOLVER] / m_steps,
+                   1e3 * m_times[ic * NUM_PHASES + UPDATE] / m_steps);
+        }
+        if (!WriteProfile())
+            std::cout << "Thread autotuner: cannot write " << GetProfileFilename() << std::endl;
+    }
+
+    /// Return true once the number of threads was selected.
+    bool IsDone() const { return m_done; }
+
+    /// Return the selected number of threads (valid once IsDone() is true).
+    int GetNumThreads() const { return m_best; }
+
+    /// Return the number of threads with the smallest time for the given phase (valid once IsDone() is true).
+    int GetNumThreads(Phase phase) const { return m_best_phase[phase]; }
+
+    /// Return the name of the profile file for this host.
+    std::string GetProfileFilename() const { return m_dir + "/threads_" + GetHostName() + ".txt"; }
+
+  private:
+    static std::string GetHostName() {
+#if defined(_WIN32)
+        const char* name = std::getenv("COMPUTERNAME");
+        return name ? std::string(name) : std::string("localhost");
+#else
+        char name[256];
+        if (gethostname(name, sizeof(name)) != 0)
+            return "localhost";
+        name[sizeof(name) - 1] = '\0';
+        return std::string(name);
+#endif
+    }
+
+    // Profile lines: problem size_bucket step broadphase narrowphase solver update (best number of threads)
+    bool ReadProfile() {
+        std::ifstream file(GetProfileFilename());
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream iss(line);
+            std::string problem;
+            int bucket;
+            int best[NUM_PHASES];
+            if (!(iss >> problem >> bucket))
+                continue;
+            if (problem != m_problem || bucket != m_size_bucket)
+                continue;
+            bool ok = true;
+            for (int p = 0; p < NUM_PHASES && ok; p++)
+                ok = (iss >> best[p]) && best[p] > 0;
+            if (!ok)
+                continue;
+            for (int p = 0; p < NUM_PHASES; p++)
+                m_best_phase[p] = best[p];
+            m_best = best[STEP];
+            return true;
+        }
+        return false;
+    }
+
+    bool WriteProfile() const {
+        filesystem::create_directory(filesystem::path(m_dir));
+        std::string filename = GetProfileFilename();
+
+        // Keep the entries for other problems
+        std::vector<std::string> lines;
+        {
+            std::ifstream file(filename);
+            std::string line;
+            while (std::getline(file, line)) {
+                std::istringstream iss(line);
+                std::string problem;
+                int bucket;
+                if ((iss >> problem >> bucket) && problem == m_problem && bucket == m_size_bucket)
+                    continue;
+                if (!line.empty())
+                    lines.push_back(line);
+            }
+        }
+        std::ostringstream entry;
+        entry << m_problem << " " << m_size_bucket;
+        for (int p = 0; p < NUM_PHASES; p++)
+            entry << " " << m_best_phase[p];
+        lines.push_back(entry.str());
+
+        std::string tmpname = filename + ".tmp" + std::to_string(THREAD_AUTOTUNER_GETPID());
+        {
+            std::ofstream file(tmpname);
+            for (const auto& line : lines)
+                file << line << "\n";
+            if (!file.good())
+                return false;
+        }
+#if defined(_WIN32)
+        remove(filename.c_str());
+#endif
+        if (rename(tmpname.c_str(), filename.c_str()) != 0) {
+            remove(tmpname.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    std::string m_problem;
+    int m_size_bucket;
+    int m_steps;
+    std::string m_dir;
+    std::vector<int> m_candidates;
+    std::vector<double> m_times;  // accumulated phase times for each candidate
+    size_t m_current;             // index of current candidate
+    int m_step;                   // steps with current candidate
+    bool m_done;
+    int m_best;
+    int m_best_phase[NUM_PHASES];
+};
+
+#endif
@@ -0,0 +1,216 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Low-overhead recorder of per-step timing statistics.
+//
+// Unlike TimingOutput (utils.h), which formats and prints the timers at every
+// step, TimingRecorder::Record only copies the step, collision (broad and
+// narrow phase), solver (advance), and update timers, the solver residual and
+// number of iterations, and the numbers of bodies and contacts into a
+// fixed-size ring buffer (the multicore solver is looked up once). A background
+// thread drains the ring buffer to a compact binary file whenever it is half
+// full (or at least every 100 ms). If the writer falls behind, records are
+// dropped rather than blocking the simulation (the count is reported when
+// closing).
+//
+// The binary file (header "CHTR", version, record size, then raw records) can
+// be read back with ReadTimingFile and converted to CSV with WriteTimingCSV
+// (see test_MCORE_timing_csv).
+//
+// =============================================================================
+
+#ifndef TIMING_RECORDER_H
+#define TIMING_RECORDER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chrono/physics/ChSystem.h"
+#include "chrono_multicore/physics/ChSystemMulticore.h"
+#include "chrono_multicore/solver/ChIterativeSolverMulticore.h"
+
+/// Timing statistics of one step.
+struct TimingRecord {
+    double time;         ///< simulation time at the end of the step
+    float step;          ///< step time
+    float broad;         ///< collision detection, broad phase
+    float narrow;        ///< collision detection, narrow phase
+    float solver;        ///< solver (GetTimerAdvance, as in the multicore metrics)
+    float update;        ///< update
+    float residual;      ///< solver residual
+    int32_t iterations;  ///< solver iterations
+    int32_t bodies;      ///< number of bodies
+    int32_t contacts;    ///< number of contacts
+};
+
+class TimingRecorder {
+  public:
+    /// Open the timing file and start the writer thread. The capacity of the ring buffer is rounded up to a power of 2.
+    TimingRecorder(const std::string& filename, size_t capacity = 1 << 16)
+        : m_head(0), m_tail(0), m_dropped(0), m_stop(false), m_system(nullptr) {
+        size_t cap = 2;
+        while (cap < capacity)
+            cap *= 2;
+        m_ring.resize(cap);
+        m_mask = cap - 1;
+
+        m_file = fopen(filename.c_str(), "wb");
+        if (!m_file) {
+            std::cout << "TimingRecorder: cannot open " << filename << std::endl;
+            return;
+        }
+        uint32_t header[3];
+        memcpy(&header[0], "CHTR", 4);
+        header[1] = 1;
+        header[2] = (uint32_t)sizeof(TimingRecord);
+        fwrite(header, sizeof(header), 1, m_file);
+
+        m_writer = std::thread(&TimingRecorder::Drain, this);
+    }
+
+    ~TimingRecorder() { Close(); }
+
+    /// Record the timers of the last step of the given system.
+    void Record(chrono::ChSystem* system) {
+        if (system != m_system) {
+            m_system = system;
+            m_solver.reset();
+            if (dynamic_cast<chrono::ChSystemMulticore*>(system))
+                m_solver = std::static_pointer_cast<chrono::ChIterativeSolverMulticore>(system->GetSolver());
+        }
+
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        uint64_t tail = m_tail.load(std::memory_order_acquire);
+        if (head - tail > m_mask) {
+            m_dropped++;
+            return;
+        }
+
+        TimingRecord& r = m_ring[head & m_mask];
+        r.time = system->GetChTime();
+        r.step = (float)system->GetTimerStep();
+        r.broad = (float)system->GetTimerCollisionBroad();
+        r.narrow = (float)system->GetTimerCollisionNarrow();
+        r.solver = (float)system->GetTimerAdvance();
+        r.update = (float)system->GetTimerUpdate();
+        r.residual = m_solver ? (float)m_solver->GetResidual() : 0.0f;
+        r.iterations = m_solver ? (int32_t)m_solver->GetIterations() : 0;
+        r.bodies = (int32_t)system->GetNbodies();
+        r.contacts = (int32_t)system->GetNcontacts();
+
+        m_head.store(head + 1, std::memory_order_release);
+        if (head + 1 - tail == (m_mask + 1) / 2)
+            m_cv.notify_one();
+    }
+
+    /// Write all pending records, stop the writer thread, and close the file.
+    void Close() {
+        if (!m_file)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        m_writer.join();
+        fclose(m_file);
+        m_file = nullptr;
+        if (m_dropped > 0)
+            std::cout << "TimingRecorder: dropped " << m_dropped << " records" << std::endl;
+    }
+
+    /// Return the number of records dropped so far (ring buffer full).
+    uint64_t GetNumDropped() const { return m_dropped; }
+
+  private:
+    void Drain() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_cv.wait_for(lock, std::chrono::milliseconds(100), [this]() {
+                return m_stop || m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_relaxed) >=
+                                     (m_mask + 1) / 2;
+            });
+            bool stop = m_stop;
+            uint64_t head = m_head.load(std::memory_order_acquire);
+            uint64_t tail = m_tail.load(std::memory_order_relaxed);
+            while (tail < head) {
+                size_t begin = tail & m_mask;
+                size_t count = std::min((size_t)(head - tail), m_ring.size() - begin);
+                fwrite(&m_ring[begin], sizeof(TimingRecord), count, m_file);
+                tail += count;
+            }
+            m_tail.store(tail, std::memory_order_release);
+            if (stop)
+                break;
+        }
+        fflush(m_file);
+    }
+
+    std::vector<TimingRecord> m_ring;
+    size_t m_mask;
+    std::atomic<uint64_t> m_head;  // next record to write (simulation thread)
+    std::atomic<uint64_t> m_tail;  // next record to drain (writer thread)
+    uint64_t m_dropped;
+
+    FILE* m_file;
+    std::thread m_writer;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop;
+
+    chrono::ChSystem* m_system;
+    std::shared_ptr<chrono::ChIterativeSolverMulticore> m_solver;
+};
+
+/// Read a timing file written by TimingRecorder. Return false if the file cannot be read or has an invalid header.
+inline bool ReadTimingFile(const std::string& filename, std::vector<TimingRecord>& records) {
+    records.clear();
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (!file)
+        return false;
+    uint32_t header[3];
+    bool ok = fread(header, sizeof(header), 1, file) == 1 && memcmp(&header[0], "CHTR", 4) == 0 && header[1] == 1 &&
+              header[2] == sizeof(TimingRecord);
+    TimingRecord r;
+    while (ok && fread(&r, sizeof(r), 1, file) == 1)
+        records.push_back(r);
+    fclose(file);
+    return ok;
+}
+
+/// Write timing records to a CSV file. Return false on failure.
+inline bool WriteTimingCSV(const std::vector<TimingRecord>& records, const std::string& filename) {
+    FILE* file = fopen(filename.c_str(), "w");
+    if (!file)
+        return false;
+    fprintf(file, "time,step,broad,narrow,solver,update,bodies,contacts,iterations,residual\n");
+    for (const auto& r : records) {
+        fprintf(file, "%.8g,%.6g,%.6g,%.6g,%.6g,%.6g,%d,%d,%d,%.6g\n", r.time, r.step, r.broad, r.narrow, r.solver,
+                r.update, r.bodies, r.contacts, r.iterations, r.residual);
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+#endif
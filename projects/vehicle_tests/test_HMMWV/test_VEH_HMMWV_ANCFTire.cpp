@@ -14,6 +14,10 @@
 //
 // HMMWV full model using ANCF, RIGID, or RIGID_MESH tires on rigid terrain.
 //
+// Run with a list of throttle levels (e.g. "test_VEH_HMMWV_ANCFTire 0.4 0.8")
+// to fork acceleration variants, without visualization, from a single state
+// taken once the vehicle has settled on the terrain (at the driver delay).
+//
 // The vehicle reference frame has Z up, X towards the front of the vehicle, and
 // Y pointing to the left.
 //
@@ -22,7 +26,13 @@
 ////#include <float.h>
 ////unsigned int fp_control_state = _controlfp(_EM_INEXACT, _MCW_EM);
 
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
 #include "chrono/core/ChStream.h"
+#include "chrono/core/ChTimer.h"
 #include "chrono/physics/ChSystem.h"
 #include "chrono/utils/ChUtilsInputOutput.h"
 #include "chrono/parallel/ChOpenMP.h"
@@ -44,6 +54,8 @@
 
 #include "chrono_thirdparty/filesystem/path.h"
 
+#include "vehicle_snapshot.h"
+
 using namespace chrono;
 using namespace chrono::vehicle;
 using namespace chrono::vehicle::hmmwv;
@@ -94,6 +106,10 @@ double t_end = 5;
 // Verbose solver output
 bool verbose = false;
 
+// Driver delay (settling time) and throttle level
+double driver_delay = 0.5;
+double driver_throttle = 0.8;
+
 // Time interval between two render frames (1/FPS)
 double render_step_size = 1.0 / 50;
 
@@ -113,7 +129,8 @@ bool povray_output = false;
 
 class MyDriver : public ChDriver {
 public:
-    MyDriver(ChVehicle& vehicle, double delay) : ChDriver(vehicle), m_delay(delay) {}
+    MyDriver(ChVehicle& vehicle, double delay, double throttle)
+        : ChDriver(vehicle), m_delay(delay), m_max_throttle(throttle) {}
     ~MyDriver() {}
 
     virtual void Synchronize(double time) override {
@@ -128,27 +145,34 @@ public:
             return;
 
         if (eff_time > 0.2)
-            m_throttle = 0.8;
+            m_throttle = m_max_throttle;
         else
-            m_throttle = 4 * eff_time;
+            m_throttle = 5 * m_max_throttle * eff_time;
     }
 
 private:
     double m_delay;
+    double m_max_throttle;
 };
 
 // =============================================================================
 
-int main(int argc, char* argv[]) {
-    // Set path to Chrono and Chrono::Vehicle data directories
-    SetChronoDataPath(CHRONO_DATA_DIR);
-    vehicle::SetDataPath(CHRONO_VEHICLE_DATA_DIR);
+struct Model {
+    std::unique_ptr<ChSystemSMC> system;
+    std::unique_ptr<HMMWV_Full> hmmwv;
+    std::unique_ptr<RigidTerrain> terrain;
+    std::unique_ptr<MyDriver> driver;
+};
 
+// Create the system, vehicle, terrain, and driver. Forks of a snapshot must be created exactly as the model the
+// snapshot was taken from.
+void CreateModel(double throttle, Model& model) {
     // ----------------------------------
     // Create the (sequential) SMC system
     // ----------------------------------
 
-    ChSystemSMC* system = new ChSystemSMC(use_mat_properties);
+    model.system = std::unique_ptr<ChSystemSMC>(new ChSystemSMC(use_mat_properties));
+    ChSystemSMC* system = model.system.get();
     system->Set_G_acc(ChVector<>(0, 0, -9.81));
 
     // Set number threads
@@ -186,7 +210,8 @@ int main(int argc, char* argv[]) {
     // --------------
 
     // Create the HMMWV vehicle, set parameters, and initialize
-    HMMWV_Full my_hmmwv(system);
+    model.hmmwv = std::unique_ptr<HMMWV_Full>(new HMMWV_Full(system));
+    HMMWV_Full& my_hmmwv = *model.hmmwv;
     my_hmmwv.SetChassisFixed(false);
     my_hmmwv.SetInitPosition(ChCoordsys<>(initLoc, initRot));
     my_hmmwv.SetPowertrainType(powertrain_model);
@@ -222,7 +247,8 @@ int main(int argc, char* argv[]) {
     patch_mat->SetFriction(0.9f);
     patch_mat->SetRestitution(0.01f);
 
-    RigidTerrain terrain(my_hmmwv.GetSystem());
+    model.terrain = std::unique_ptr<RigidTerrain>(new RigidTerrain(my_hmmwv.GetSystem()));
+    RigidTerrain& terrain = *model.terrain;
     std::shared_ptr<RigidTerrain::Patch> patch;
     switch (terrain_model) {
         case RigidTerrain::PatchType::BOX:
@@ -243,6 +269,92 @@ int main(int argc, char* argv[]) {
     patch->SetColor(ChColor(0.8f, 0.8f, 0.5f));
     terrain.Initialize();
 
+    // Create the driver system
+    model.driver = std::unique_ptr<MyDriver>(new MyDriver(my_hmmwv.GetVehicle(), driver_delay, throttle));
+    model.driver->Initialize();
+}
+
+// Advance all modules of the model by one step.
+void Advance(Model& model) {
+    double time = model.system->GetChTime();
+    ChDriver::Inputs driver_inputs = model.driver->GetInputs();
+
+    model.driver->Synchronize(time);
+    model.terrain->Synchronize(time);
+    model.hmmwv->Synchronize(time, driver_inputs, *model.terrain);
+
+    model.driver->Advance(step_size);
+    model.terrain->Advance(step_size);
+    model.hmmwv->Advance(step_size);
+}
+
+// =============================================================================
+
+// Settle the vehicle once, then run one variant per throttle level, each forked from the settled state.
+// The variants run one after the other, as each system already uses num_threads threads.
+int RunVariants(const std::vector<double>& throttles) {
+    ChTimer<double> timer;
+
+    // Settle and take the snapshot
+    VehicleSnapshot snapshot;
+    timer.start();
+    {
+        Model base;
+        CreateModel(0, base);
+        while (base.system->GetChTime() < driver_delay)
+            Advance(base);
+        snapshot.Take(base.hmmwv->GetVehicle());
+    }
+    timer.stop();
+    double settle_time = timer();
+    std::cout << "Settled in " << settle_time << " s (simulated " << snapshot.GetTime() << " s)" << std::endl;
+
+    std::cout << "\nthrottle   final speed   wall time" << std::endl;
+    timer.reset();
+    timer.start();
+    for (double throttle : throttles) {
+        ChTimer<double> variant_timer;
+        variant_timer.start();
+        Model model;
+        CreateModel(throttle, model);
+        snapshot.Restore(model.hmmwv->GetVehicle());
+        while (model.system->GetChTime() < t_end)
+            Advance(model);
+        variant_timer.stop();
+        printf("%8.2f %13.3f %11.2f\n", throttle, model.hmmwv->GetVehicle().GetVehicleSpeed(), variant_timer());
+    }
+    timer.stop();
+    std::cout << "\n" << throttles.size() << " variants in " << timer() << " s (settling done once, " << settle_time
+              << " s)" << std::endl;
+
+    return 0;
+}
+
+// =============================================================================
+
+int main(int argc, char* argv[]) {
+    // Set path to Chrono and Chrono::Vehicle data directories
+    SetChronoDataPath(CHRONO_DATA_DIR);
+    vehicle::SetDataPath(CHRONO_VEHICLE_DATA_DIR);
+
+    // Forked variants (no visualization)
+    if (argc > 1) {
+        std::vector<double> throttles;
+        for (int i = 1; i < argc; i++)
+            throttles.push_back(std::atof(argv[i]));
+        return RunVariants(throttles);
+    }
+
+    // ----------------------------------------------
+    // Create the system, vehicle, terrain and driver
+    // ----------------------------------------------
+
+    Model model;
+    CreateModel(driver_throttle, model);
+    HMMWV_Full& my_hmmwv = *model.hmmwv;
+    RigidTerrain& terrain = *model.terrain;
+    MyDriver& driver = *model.driver;
+
     // Create the vehicle Irrlicht interface
     ChWheeledVehicleIrrApp app(&my_hmmwv.GetVehicle(), L"HMMWV ANCF tires Test");
     app.SetSkyBox();
@@ -268,13 +380,6 @@ int main(int argc, char* argv[]) {
         terrain.ExportMeshPovray(out_dir);
     }
 
-    // ------------------------
-    // Create the driver system
-    // ------------------------
-
-    MyDriver driver(my_hmmwv.GetVehicle(), 0.5);
-    driver.Initialize();
-
     // ---------------
     // Simulation loop
     // ---------------
@@ -323,15 +428,10 @@ int main(int argc, char* argv[]) {
         ChDriver::Inputs driver_inputs = driver.GetInputs();
 
         // Update modules (process inputs from other modules)
-        driver.Synchronize(time);
-        terrain.Synchronize(time);
-        my_hmmwv.Synchronize(time, driver_inputs, terrain);
         app.Synchronize("", driver_inputs);
 
         // Advance simulation for one timestep for all modules
-        driver.Advance(step_size);
-        terrain.Advance(step_size);
-        my_hmmwv.Advance(step_size);
+        Advance(model);
         app.Advance(step_size);
 
         // Increment frame number
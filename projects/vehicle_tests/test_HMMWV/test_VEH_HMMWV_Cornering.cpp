@@ -15,13 +15,29 @@
 // HMMWV constant radius turn test.
 // This test uses a parameterized circular Bezier path.
 //
+// Run with a list of target speeds (e.g. "test_VEH_HMMWV_Cornering 10 12 14")
+// to fork maneuver variants, without visualization, from a single settled
+// state: the vehicle settles once, a snapshot of its state is taken, and each
+// variant restores the snapshot in its own copy of the vehicle. The copies are
+// built one at a time, and the variants are then simulated in parallel.
+//
 // The vehicle reference frame has Z up, X towards the front of the vehicle, and
 // Y pointing to the left.
 //
 // =============================================================================
 
-#include <cmath>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "chrono/core/ChTimer.h"
 
 #include "chrono_vehicle/ChVehicleModelData.h"
 #include "chrono_vehicle/terrain/RigidTerrain.h"
@@ -30,6 +46,8 @@
 
 #include "chrono_models/vehicle/hmmwv/HMMWV.h"
 
+#include "vehicle_snapshot.h"
+
 using namespace chrono;
 using namespace chrono::geometry;
 using namespace chrono::vehicle;
@@ -37,6 +55,51 @@ using namespace chrono::vehicle::hmmwv;
 
 // =============================================================================
 
+// Parameters for the Bezier curve
+double radius = 20;
+double offset = 1;
+double run = 30;
+int nturns = 4;
+
+// Terrain dimensions
+double terrainHeight = 0;
+double terrainLength = 20 + 2 * std::max(run, 2 * radius + offset);
+double terrainWidth = 20 + 2 * radius;
+
+// Initial vehicle location
+ChVector<> initLoc(-run, -radius, 0.5);
+
+// Parameters for steering and speed controllers
+double look_ahead_dist = 5;
+double Kp_steering = 0.5;
+double Ki_steering = 0;
+double Kd_steering = 0;
+
+double target_speed = 12;
+double Kp_speed = 0.4;
+double Ki_speed = 0;
+double Kd_speed = 0;
+
+// Simulation step size
+double step_size = 1e-3;
+
+// Simulation end time
+double t_end = 100;
+
+// Render FPS
+double fps = 60;
+
+// Forked variants: settling time before the snapshot, duration of each variant,
+// and length of the final interval over which the lateral acceleration is averaged
+double t_settle = 2;
+double t_variant = 20;
+double t_average = 5;
+
+// Serializes the construction of the variants' vehicles, terrains and drivers
+std::mutex setup_mutex;
+
+// =============================================================================
+
 void CalcControlPoints(double run,
                        double radius,
                        double offset,
@@ -96,61 +159,20 @@ void CalcControlPoints(double run,
 
 // =============================================================================
 
-int main(int argc, char* argv[]) {
-    // Set path to Chrono and Chrono::Vehicle data directories
-    SetChronoDataPath(CHRONO_DATA_DIR);
-    vehicle::SetDataPath(CHRONO_VEHICLE_DATA_DIR);
-
-    // -------------------------------
-    // Parameters for the Bezier curve
-    // -------------------------------
-
-    double radius = 20;
-    double offset = 1;
-    double run = 30;
-    int nturns = 4;
-
-    // Terrain dimensions
-    double terrainHeight = 0;
-    double terrainLength = 20 + 2 * std::max(run, 2 * radius + offset);
-    double terrainWidth = 20 + 2 * radius;
-
-    // Initial vehicle location
-    ChVector<> initLoc(-run, -radius, 0.5);
-
-    // ---------------------------------------------
-    // Parameters for steering and speed controllers
-    // ---------------------------------------------
-
-    double look_ahead_dist = 5;
-    double Kp_steering = 0.5;
-    double Ki_steering = 0;
-    double Kd_steering = 0;
-
-    double target_speed = 12;
-    double Kp_speed = 0.4;
-    double Ki_speed = 0;
-    double Kd_speed = 0;
-
-    // ---------------------
-    // Simulation parameters
-    // ---------------------
-
-    // Simulation step size
-    double step_size = 1e-3;
-
-    // Simulation end time
-    double t_end = 100;
-
-    // Render FPS
-    double fps = 60;
+// =============================================================================
 
-    // ------------------------------
-    // Create the vehicle and terrain
-    // ------------------------------
+struct Model {
+    std::unique_ptr<HMMWV_Full> hmmwv;
+    std::unique_ptr<RigidTerrain> terrain;
+    std::unique_ptr<SnapshotPathFollowerDriver> driver;
+};
 
+// Create the vehicle, terrain, and path-follower driver (num_threads <= 0 keeps the default number of threads).
+// Forks of a snapshot must be created exactly as the model the snapshot was taken from.
+void CreateModel(std::shared_ptr<ChBezierCurve> path, int num_threads, Model& model) {
     // Create the HMMWV vehicle, set parameters, and initialize
-    HMMWV_Full my_hmmwv;
+    model.hmmwv = std::unique_ptr<HMMWV_Full>(new HMMWV_Full());
+    HMMWV_Full& my_hmmwv = *model.hmmwv;
     my_hmmwv.SetContactMethod(ChContactMethod::SMC);
     my_hmmwv.SetChassisFixed(false);
     my_hmmwv.SetInitPosition(ChCoordsys<>(initLoc));
@@ -160,6 +182,8 @@ int main(int argc, char* argv[]) {
     my_hmmwv.SetTireType(TireModelType::RIGID);
     my_hmmwv.SetTireStepSize(step_size);
     my_hmmwv.Initialize();
+    if (num_threads > 0)
+        my_hmmwv.GetSystem()->SetNumThreads(num_threads);
 
     my_hmmwv.SetChassisVisualizationType(VisualizationType::PRIMITIVES);
     my_hmmwv.SetSuspensionVisualizationType(VisualizationType::PRIMITIVES);
@@ -173,16 +197,131 @@ int main(int argc, char* argv[]) {
     patch_mat->SetRestitution(0.01f);
     patch_mat->SetYoungModulus(2e7f);
     patch_mat->SetPoissonRatio(0.3f);
-    RigidTerrain terrain(my_hmmwv.GetSystem());
-    auto patch =
-        terrain.AddPatch(patch_mat, ChVector<>(0, 0, terrainHeight), ChVector<>(0, 0, 1), terrainLength, terrainWidth);
+    model.terrain = std::unique_ptr<RigidTerrain>(new RigidTerrain(my_hmmwv.GetSystem()));
+    auto patch = model.terrain->AddPatch(patch_mat, ChVector<>(0, 0, terrainHeight), ChVector<>(0, 0, 1),
+                                         terrainLength, terrainWidth);
     patch->SetColor(ChColor(1, 1, 1));
     patch->SetTexture(vehicle::GetDataFile("terrain/textures/tile4.jpg"), 100, 50);
-    terrain.Initialize();
+    model.terrain->Initialize();
+
+    // Create the path-follower driver system
+    model.driver = std::unique_ptr<SnapshotPathFollowerDriver>(
+        new SnapshotPathFollowerDriver(my_hmmwv.GetVehicle(), path, "my_path", target_speed));
+    model.driver->GetSteeringController().SetLookAheadDistance(look_ahead_dist);
+    model.driver->GetSteeringController().SetGains(Kp_steering, Ki_steering, Kd_steering);
+    model.driver->GetSpeedController().SetGains(Kp_speed, Ki_speed, Kd_speed);
+    model.driver->Initialize();
+}
 
-    // ----------------------------------------------------------
-    // Create the Bezier path and the path-follower driver system
-    // ----------------------------------------------------------
+// Advance all modules of the model by one step.
+void Advance(Model& model) {
+    double time = model.hmmwv->GetSystem()->GetChTime();
+    ChDriver::Inputs driver_inputs = model.driver->GetInputs();
+
+    model.driver->Synchronize(time);
+    model.terrain->Synchronize(time);
+    model.hmmwv->Synchronize(time, driver_inputs, *model.terrain);
+
+    model.driver->Advance(step_size);
+    model.terrain->Advance(step_size);
+    model.hmmwv->Advance(step_size);
+}
+
+// =============================================================================
+
+// Settle the vehicle once, then run one variant per target speed, each forked from the settled state.
+int RunVariants(std::shared_ptr<ChBezierCurve> path, const std::vector<double>& speeds) {
+    ChTimer<double> timer;
+
+    // Settle and take the snapshot
+    timer.start();
+    Model base;
+    CreateModel(path, 1, base);
+    while (base.hmmwv->GetSystem()->GetChTime() < t_settle)
+        Advance(base);
+    VehicleSnapshot snapshot;
+    snapshot.Take(base.hmmwv->GetVehicle());
+    auto driver_state = base.driver->CreateState();
+    base.driver->SaveState(*driver_state);
+    timer.stop();
+    double settle_time = timer();
+    std::cout << "Settled in " << settle_time << " s (simulated " << snapshot.GetTime() << " s)" << std::endl;
+
+    // Fork the variants
+    struct Result {
+        double lat_acc;
+        double speed;
+        double wall_time;
+    };
+    std::vector<Result> results(speeds.size());
+    std::atomic<size_t> next(0);
+
+    auto worker = [&]() {
+        for (size_t i = next++; i < speeds.size(); i = next++) {
+            ChTimer<double> variant_timer;
+            variant_timer.start();
+
+            std::unique_lock<std::mutex> lock(setup_mutex);
+            Model model;
+            CreateModel(path, 1, model);
+            snapshot.Restore(model.hmmwv->GetVehicle());
+            model.driver->RestoreState(*driver_state);
+            model.driver->SetDesiredSpeed(speeds[i]);
+            lock.unlock();
+
+            ChVector<> driver_pos = model.hmmwv->GetChassis()->GetLocalDriverCoordsys().pos;
+            double t_stop = snapshot.GetTime() + t_variant;
+            double lat_acc = 0;
+            double speed = 0;
+            int num_samples = 0;
+            while (model.hmmwv->GetSystem()->GetChTime() < t_stop) {
+                Advance(model);
+                if (model.hmmwv->GetSystem()->GetChTime() >= t_stop - t_average) {
+                    lat_acc += model.hmmwv->GetVehicle().GetVehiclePointAcceleration(driver_pos).y();
+                    speed += model.hmmwv->GetVehicle().GetVehicleSpeed();
+                    num_samples++;
+                }
+            }
+
+            variant_timer.stop();
+            results[i].lat_acc = num_samples > 0 ? lat_acc / num_samples : 0;
+            results[i].speed = num_samples > 0 ? speed / num_samples : 0;
+            results[i].wall_time = variant_timer();
+        }
+    };
+
+    timer.reset();
+    timer.start();
+    unsigned int num_workers = std::max(1u, std::thread::hardware_concurrency());
+    num_workers = std::min(num_workers, (unsigned int)speeds.size());
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < num_workers; i++)
+        workers.push_back(std::thread(worker));
+    for (auto& w : workers)
+        w.join();
+    timer.stop();
+
+    std::cout << "\ntarget speed   mean speed   lateral acc.   wall time" << std::endl;
+    for (size_t i = 0; i < speeds.size(); i++) {
+        printf("%12.2f %12.2f %14.3f %11.2f\n", speeds[i], results[i].speed, results[i].lat_acc,
+               results[i].wall_time);
+    }
+    std::cout << "\n" << speeds.size() << " variants on " << num_workers << " threads in " << timer() << " s"
+              << " (settling done once, " << settle_time << " s)" << std::endl;
+
+    return 0;
+}
+
+// =============================================================================
+
+int main(int argc, char* argv[]) {
+    // Set path to Chrono and Chrono::Vehicle data directories
+    SetChronoDataPath(CHRONO_DATA_DIR);
+    vehicle::SetDataPath(CHRONO_VEHICLE_DATA_DIR);
+
+    // ---------------------
+    // Create the Bezier path
+    // ---------------------
 
     std::vector<ChVector<>> points;
     std::vector<ChVector<>> inCV;
@@ -190,12 +329,22 @@ int main(int argc, char* argv[]) {
     CalcControlPoints(run, radius, offset, nturns, points, inCV, outCV);
     auto path = chrono_types::make_shared<ChBezierCurve>(points, inCV, outCV);
 
-    ChPathFollowerDriver driver(my_hmmwv.GetVehicle(), path, "my_path", target_speed);
-    driver.GetSteeringController().SetLookAheadDistance(look_ahead_dist);
-    driver.GetSteeringController().SetGains(Kp_steering, Ki_steering, Kd_steering);
-    driver.GetSpeedController().SetGains(Kp_speed, Ki_speed, Kd_speed);
+    // Forked variants (no visualization)
+    if (argc > 1) {
+        std::vector<double> speeds;
+        for (int i = 1; i < argc; i++)
+            speeds.push_back(std::atof(argv[i]));
+        return RunVariants(path, speeds);
+    }
+
+    // ------------------------------------------
+    // Create the vehicle, terrain and the driver
+    // ------------------------------------------
 
-    driver.Initialize();
+    Model model;
+    CreateModel(path, 0, model);
+    HMMWV_Full& my_hmmwv = *model.hmmwv;
+    SnapshotPathFollowerDriver& driver = *model.driver;
 
     // ---------------------------------------
     // Create the vehicle Irrlicht application
@@ -268,15 +417,10 @@ int main(int argc, char* argv[]) {
         }
 
         // Update modules (process inputs from other modules)
-        driver.Synchronize(time);
-        terrain.Synchronize(time);
-        my_hmmwv.Synchronize(time, driver_inputs, terrain);
         app.Synchronize("Follower driver", driver_inputs);
 
         // Advance simulation for one timestep for all modules
-        driver.Advance(step_size);
-        terrain.Advance(step_size);
-        my_hmmwv.Advance(step_size);
+        Advance(model);
         app.Advance(step_size);
 
         // Increment simulation frame number
@@ -0,0 +1,161 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// In-memory snapshot of a vehicle simulation, used to fork maneuver variants
+// from a common (settled) state without repeating the settling phase.
+//
+// VehicleSnapshot captures the state vectors of the Chrono system containing
+// the vehicle: positions, velocities, accelerations and constraint reactions of
+// all bodies, shafts, links and FEA meshes. This covers the chassis, suspension
+// and steering mechanisms, the shafts of the powertrain and driveline, and the
+// nodes of deformable (e.g. ANCF) tires; the accelerations and reactions let an
+// implicit integrator (HHT) restart as if the simulation had not been
+// interrupted. The current transmission gear is captured separately.
+// SnapshotPathFollowerDriver adds the state of the path-follower controllers.
+//
+// A snapshot is meant to be restored into a freshly constructed vehicle, built
+// exactly as the one the snapshot was taken from (same models, same order), so
+// that the state vectors have the same layout. Forks are then independent and
+// may run sequentially or in parallel, each in its own system. Data kept by the
+// subsystems outside the system state (e.g. the time of the last gear shift,
+// the internal states of handling tire models such as Pacejka) is not captured,
+// which is why a snapshot should not be restored into a vehicle that already
+// advanced past it.
+//
+// =============================================================================
+
+#ifndef VEHICLE_SNAPSHOT_H
+#define VEHICLE_SNAPSHOT_H
+
+#include <memory>
+
+#include "chrono/core/ChException.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono_vehicle/ChVehicle.h"
+#include "chrono_vehicle/ChPowertrain.h"
+#include "chrono_vehicle/driver/ChPathFollowerDriver.h"
+
+namespace chrono {
+namespace vehicle {
+
+class VehicleSnapshot {
+  public:
+    VehicleSnapshot() : m_time(0), m_gear(0), m_valid(false) {}
+
+    /// Capture the current state of the given vehicle (and of everything else in its system).
+    void Take(ChVehicle& vehicle) {
+        ChSystem* system = vehicle.GetSystem();
+        system->Setup();
+        system->StateSetup(m_x, m_v, m_a);
+        system->StateGather(m_x, m_v, m_time);
+        system->StateGatherAcceleration(m_a);
+        m_L.setZero(system->GetNconstr());
+        system->StateGatherReactions(m_L);
+        auto powertrain = vehicle.GetPowertrain();
+        m_gear = powertrain ? powertrain->GetCurrentTransmissionGear() : 0;
+        m_valid = true;
+    }
+
+    /// Set the given vehicle to the captured state. The vehicle must be built the same way as the one the
+    /// snapshot was taken from; a mismatch in the size of the state vectors throws a ChException.
+    void Restore(ChVehicle& vehicle) const {
+        if (!m_valid)
+            throw ChException("VehicleSnapshot: no state captured");
+        ChSystem* system = vehicle.GetSystem();
+        system->Setup();
+        if (system->GetNcoords_x() != m_x.size() || system->GetNcoords_w() != m_v.size() ||
+            system->GetNconstr() != m_L.size())
+            throw ChException("VehicleSnapshot: the system does not match the captured state");
+        system->StateScatter(m_x, m_v, m_time, true);
+        system->StateScatterAcceleration(m_a);
+        system->StateScatterReactions(m_L);
+
+        // Shift to the captured gear (shifting is only allowed in manual mode)
+        auto powertrain = vehicle.GetPowertrain();
+        if (powertrain && powertrain->GetDriveMode() == ChPowertrain::DriveMode::FORWARD) {
+            auto mode = powertrain->GetTransmissionMode();
+            powertrain->SetTransmissionMode(ChPowertrain::TransmissionMode::MANUAL);
+            while (powertrain->GetCurrentTransmissionGear() < m_gear)
+                powertrain->ShiftUp();
+            while (powertrain->GetCurrentTransmissionGear() > m_gear)
+                powertrain->ShiftDown();
+            powertrain->SetTransmissionMode(mode);
+        }
+    }
+
+    bool IsValid() const { return m_valid; }
+    double GetTime() const { return m_time; }
+
+  private:
+    ChState m_x;
+    ChStateDelta m_v;
+    ChStateDelta m_a;
+    ChVectorDynamic<> m_L;
+    double m_time;
+    int m_gear;
+    bool m_valid;
+};
+
+/// Path-follower driver whose inputs and controller states can be saved and restored.
+/// The target speed is not part of the state; forks set it as a maneuver parameter.
+class SnapshotPathFollowerDriver : public ChPathFollowerDriver {
+  public:
+    class State {
+      public:
+        State(std::shared_ptr<ChBezierCurve> path, bool isClosedPath) : m_steeringPID(path, isClosedPath) {}
+
+      private:
+        Inputs m_inputs;
+        ChPathSteeringController m_steeringPID;  // only the ChSteeringController part is used
+        ChSpeedController m_speedPID;
+        friend class SnapshotPathFollowerDriver;
+    };
+
+    SnapshotPathFollowerDriver(ChVehicle& vehicle,
+                               std::shared_ptr<ChBezierCurve> path,
+                               const std::string& path_name,
+                               double target_speed,
+                               bool isClosedPath = false)
+        : ChPathFollowerDriver(vehicle, path, path_name, target_speed, isClosedPath),
+          m_path(path),
+          m_isClosedPath(isClosedPath) {}
+
+    /// Return a new state object for this driver.
+    std::unique_ptr<State> CreateState() const { return std::unique_ptr<State>(new State(m_path, m_isClosedPath)); }
+
+    /// Save the current inputs and the states of the steering and speed controllers.
+    void SaveState(State& state) {
+        state.m_inputs = GetInputs();
+        static_cast<ChSteeringController&>(state.m_steeringPID) = GetSteeringController();
+        state.m_speedPID = GetSpeedController();
+    }
+
+    /// Restore a saved state. Call after the vehicle state was restored, as the path tracker is re-initialized
+    /// from the current sentinel location.
+    void RestoreState(const State& state) {
+        Reset();
+        static_cast<ChSteeringController&>(GetSteeringController()) = state.m_steeringPID;
+        GetSpeedController() = state.m_speedPID;
+        m_steering = state.m_inputs.m_steering;
+        m_throttle = state.m_inputs.m_throttle;
+        m_braking = state.m_inputs.m_braking;
+    }
+
+  private:
+    std::shared_ptr<ChBezierCurve> m_path;
+    bool m_isClosedPath;
+};
+
+}  // end namespace vehicle
+}  // end namespace chrono
+
+#endif
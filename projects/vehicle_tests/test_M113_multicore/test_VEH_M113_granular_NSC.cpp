@@ -17,6 +17,7 @@
 
 #include <iostream>
 #include <memory>
+#include <string>
 
 // Chrono::Engine header files
 #include "chrono/ChConfig.h"
@@ -53,6 +54,8 @@
 
 // Utilities
 #include "../../utils.h"
+#include "../../moving_patch.h"
+#include "../../contact_warm_start.h"
 
 using namespace chrono;
 using namespace chrono::collision;
@@ -82,6 +85,13 @@ double hdimZ = 0.5;
 double hthick = 0.25;
 double numLayers = 8;
 
+// Moving patch: keep an active region of granular material around the vehicle, recycling particles from behind the
+// vehicle to the front and freezing particles outside the active region (see moving_patch.h). The front and rear bin
+// walls are removed once the vehicle is released. Disabled by default (enable with -moving_patch).
+bool moving_patch = false;
+double patch_behind = 3.0;
+double patch_ahead = 3.0;
+
 // Parameters for granular material
 int Id_g = 100;
 double r_g = 18e-3;
@@ -132,6 +142,9 @@ int max_iteration_spinning = 0;
 
 float contact_recovery_speed = 12;
 
+// Warm start the contact solver with the impulses of the previous step (see contact_warm_start.h)
+bool warm_start = true;
+
 // Periodically monitor maximum bilateral constraint violation
 bool monitor_bilaterals = false;
 int bilateral_frame_interval = 100;
@@ -215,6 +228,11 @@ double CreateParticles(ChSystem* system) {
 
 // =============================================================================
 int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "-moving_patch")
+            moving_patch = true;
+    }
+
     // -------------------------------------------------------
     // Set path to Chrono and Chrono::Vehicle data directories
     // -------------------------------------------------------
@@ -247,6 +265,9 @@ int main(int argc, char* argv[]) {
     system.GetSettings()->solver.bilateral_clamp_speed = 1e8;
     system.ChangeSolverType(SolverType::BB);
 
+    ContactWarmStart* solver_warm_start = EnableContactWarmStart(&system);
+    solver_warm_start->SetEnabled(warm_start);
+
     system.GetSettings()->collision.narrowphase_algorithm = ChNarrowphase::Algorithm::HYBRID;
     system.GetSettings()->collision.collision_envelope = 0.001;
 
@@ -278,12 +299,22 @@ int main(int argc, char* argv[]) {
     // Bottom box
     utils::AddBoxGeometry(ground.get(), mat_g, ChVector<>(hdimX, hdimY, hthick), ChVector<>(0, 0, -hthick),
                           ChQuaternion<>(1, 0, 0, 0), true);
+    // Front and rear walls (on a separate body if using a moving patch)
+    auto end_walls = ground;
+    if (terrain_type == GRANULAR_TERRAIN && moving_patch) {
+        end_walls = std::shared_ptr<ChBody>(system.NewBody());
+        end_walls->SetIdentifier(-2);
+        end_walls->SetBodyFixed(true);
+        end_walls->SetCollide(true);
+        end_walls->GetCollisionModel()->ClearModel();
+    }
+
     if (terrain_type == GRANULAR_TERRAIN) {
         // Front box
-        utils::AddBoxGeometry(ground.get(), mat_g, ChVector<>(hthick, hdimY, hdimZ + hthick),
+        utils::AddBoxGeometry(end_walls.get(), mat_g, ChVector<>(hthick, hdimY, hdimZ + hthick),
                               ChVector<>(hdimX + hthick, 0, hdimZ - hthick), ChQuaternion<>(1, 0, 0, 0), visible_walls);
         // Rear box
-        utils::AddBoxGeometry(ground.get(), mat_g, ChVector<>(hthick, hdimY, hdimZ + hthick),
+        utils::AddBoxGeometry(end_walls.get(), mat_g, ChVector<>(hthick, hdimY, hdimZ + hthick),
                               ChVector<>(-hdimX - hthick, 0, hdimZ - hthick), ChQuaternion<>(1, 0, 0, 0),
                               visible_walls);
         // Left box
@@ -299,6 +330,11 @@ int main(int argc, char* argv[]) {
 
     system.AddBody(ground);
 
+    if (end_walls != ground) {
+        end_walls->GetCollisionModel()->BuildModel();
+        system.AddBody(end_walls);
+    }
+
     // Create the granular material.
     double vertical_offset = 0;
 
@@ -341,6 +377,12 @@ int main(int argc, char* argv[]) {
                                 vehicle::GetDataFile(speed_controller_file), path, "my_path", 0.0);
     driver_steering.Initialize();
 	
+    // Moving patch following the vehicle chassis
+    MovingPatch patch(vehicle->GetChassisBody(), 2 * hdimX, patch_behind, patch_ahead);
+    patch.SetFilter([](const ChBody& body) { return body.GetIdentifier() >= Id_g; });
+    patch.SetContainer(ground);
+    bool patch_enabled = false;
+
     // ------------------------------------
     // Prepare output directories and files
     // ------------------------------------
@@ -422,6 +464,13 @@ int main(int argc, char* argv[]) {
             std::cout << "     Sim frame:      " << sim_frame << std::endl;
             std::cout << "     Time:           " << time << std::endl;
             std::cout << "     Avg. contacts:  " << num_contacts / out_steps << std::endl;
+            std::cout << "     Avg. iterations: " << solver_warm_start->GetAverageIterations() << std::endl;
+            if (patch_enabled) {
+                std::cout << "     Patch start:    " << patch.GetStart() << std::endl;
+                std::cout << "     Active / frozen particles: " << patch.GetNumActive() << " / "
+                          << patch.GetNumFrozen() << std::endl;
+                std::cout << "     Recycled:       " << patch.GetNumRecycled() << std::endl;
+            }
             std::cout << "     Throttle input: " << driver_inputs.m_throttle << std::endl;
             std::cout << "     Braking input:  " << driver_inputs.m_braking << std::endl;
             std::cout << "     Steering input: " << driver_inputs.m_steering << std::endl;
@@ -444,6 +493,13 @@ int main(int argc, char* argv[]) {
         if (vehicle->GetChassis()->IsFixed() && time > time_hold) {
             std::cout << std::endl << "Release vehicle t = " << time << std::endl;
             vehicle->GetChassisBody()->SetBodyFixed(false);
+
+            // Switch to the moving patch (the frozen particles now bound the active region)
+            if (terrain_type == GRANULAR_TERRAIN && moving_patch) {
+                end_walls->SetCollide(false);
+                patch.Initialize(&system);
+                patch_enabled = true;
+            }
         }
 
         // Update modules (process inputs from other modules)
@@ -470,6 +526,9 @@ int main(int argc, char* argv[]) {
             vehicle->LogConstraintViolations();
         }
 
+        if (patch_enabled)
+            patch.Update(&system);
+
         // Update counters.
         time += time_step;
         sim_frame++;
@@ -481,6 +540,8 @@ int main(int argc, char* argv[]) {
     std::cout << "==================================" << std::endl;
     std::cout << "Simulation time:   " << exec_time << std::endl;
     std::cout << "Number of threads: " << threads << std::endl;
+    std::cout << "Avg. iterations:   " << solver_warm_start->GetAverageIterations() << " (warm start "
+              << (warm_start ? "on" : "off") << ")" << std::endl;
 
     csv.write_to_file(out_dir + "/output.dat");
 
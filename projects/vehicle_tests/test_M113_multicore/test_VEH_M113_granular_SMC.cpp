@@ -15,8 +15,10 @@
 //
 // =============================================================================
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
+#include <string>
 
 // Chrono::Engine header files
 #include "chrono/ChConfig.h"
@@ -52,6 +54,8 @@
 
 // Utilities
 #include "../../utils.h"
+#include "../../adaptive_step.h"
+#include "../../moving_patch.h"
 
 using namespace chrono;
 using namespace chrono::collision;
@@ -81,6 +85,13 @@ double hdimZ = 0.5;
 double hthick = 0.25;
 double numLayers = 8;
 
+// Moving patch: keep an active region of granular material around the vehicle, recycling particles from behind the
+// vehicle to the front and freezing particles outside the active region (see moving_patch.h). The front and rear bin
+// walls are removed once the vehicle is released. Disabled by default (enable with -moving_patch).
+bool moving_patch = false;
+double patch_behind = 3.0;
+double patch_ahead = 3.0;
+
 // Parameters for granular material
 int Id_g = 100;
 double r_g = 18e-3;
@@ -119,6 +130,10 @@ double time_hold = 0.2;
 double time_step = 5e-5;
 double tolerance = 1e-5;
 
+// Adaptive step size, between time_step / 2 and 4 * time_step (see adaptive_step.h). The driveline and the driver
+// carry state beyond the bodies, so steps are never rolled back: the step size is only adapted predictively.
+bool adaptive_step = false;
+
 int max_iteration_bilateral = 1000;
 
 // Periodically monitor maximum bilateral constraint violation
@@ -210,6 +225,11 @@ double CreateParticles(ChSystem* system) {
 
 // =============================================================================
 int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "-moving_patch")
+            moving_patch = true;
+    }
+
     // -------------------------------------------------------
     // Set path to Chrono and Chrono::Vehicle data directories
     // -------------------------------------------------------
@@ -269,12 +289,22 @@ int main(int argc, char* argv[]) {
     // Bottom box
     utils::AddBoxGeometry(ground.get(), mat_g, ChVector<>(hdimX, hdimY, hthick), ChVector<>(0, 0, -hthick),
                           ChQuaternion<>(1, 0, 0, 0), true);
+    // Front and rear walls (on a separate body if using a moving patch)
+    auto end_walls = ground;
+    if (terrain_type == GRANULAR_TERRAIN && moving_patch) {
+        end_walls = std::shared_ptr<ChBody>(system.NewBody());
+        end_walls->SetIdentifier(-2);
+        end_walls->SetBodyFixed(true);
+        end_walls->SetCollide(true);
+        end_walls->GetCollisionModel()->ClearModel();
+    }
+
     if (terrain_type == GRANULAR_TERRAIN) {
         // Front box
-        utils::AddBoxGeometry(ground.get(), mat_g, ChVector<>(hthick, hdimY, hdimZ + hthick),
+        utils::AddBoxGeometry(end_walls.get(), mat_g, ChVector<>(hthick, hdimY, hdimZ + hthick),
                               ChVector<>(hdimX + hthick, 0, hdimZ - hthick), ChQuaternion<>(1, 0, 0, 0), visible_walls);
         // Rear box
-        utils::AddBoxGeometry(ground.get(), mat_g, ChVector<>(hthick, hdimY, hdimZ + hthick),
+        utils::AddBoxGeometry(end_walls.get(), mat_g, ChVector<>(hthick, hdimY, hdimZ + hthick),
                               ChVector<>(-hdimX - hthick, 0, hdimZ - hthick), ChQuaternion<>(1, 0, 0, 0),
                               visible_walls);
         // Left box
@@ -290,6 +320,11 @@ int main(int argc, char* argv[]) {
 
     system.AddBody(ground);
 
+    if (end_walls != ground) {
+        end_walls->GetCollisionModel()->BuildModel();
+        system.AddBody(end_walls);
+    }
+
     // Create the granular material.
     double vertical_offset = 0;
 
@@ -326,6 +361,12 @@ int main(int argc, char* argv[]) {
     MyDriver driver(*vehicle, 0.5);
     driver.Initialize();
 
+    // Moving patch following the vehicle chassis
+    MovingPatch patch(vehicle->GetChassisBody(), 2 * hdimX, patch_behind, patch_ahead);
+    patch.SetFilter([](const ChBody& body) { return body.GetIdentifier() >= Id_g; });
+    patch.SetContainer(ground);
+    bool patch_enabled = false;
+
     // ------------------------------------
     // Prepare output directories and files
     // ------------------------------------
@@ -369,6 +410,14 @@ int main(int argc, char* argv[]) {
     int next_out_frame = 0;
     double exec_time = 0;
     int num_contacts = 0;
+    int frame_steps = 0;
+
+    std::unique_ptr<AdaptiveStepController> stepper;
+    if (adaptive_step) {
+        stepper = std::unique_ptr<AdaptiveStepController>(
+            new AdaptiveStepController(r_g, time_step / 2, 4 * time_step, time_step));
+        stepper->EnableRollback(false);
+    }
 
     // Inter-module communication data
     BodyStates shoe_states_left(vehicle->GetNumTrackShoes(LEFT));
@@ -398,12 +447,21 @@ int main(int argc, char* argv[]) {
         csv << std::endl;
 
         // Output
-        if (sim_frame == next_out_frame) {
+        bool output = stepper ? (time >= out_frame / (double)out_fps) : (sim_frame == next_out_frame);
+        if (output) {
             std::cout << std::endl;
             std::cout << "---- Frame:          " << out_frame + 1 << std::endl;
             std::cout << "     Sim frame:      " << sim_frame << std::endl;
             std::cout << "     Time:           " << time << std::endl;
-            std::cout << "     Avg. contacts:  " << num_contacts / out_steps << std::endl;
+            std::cout << "     Avg. contacts:  " << num_contacts / std::max(frame_steps, 1) << std::endl;
+            if (stepper)
+                std::cout << "     Step size:      " << stepper->GetStep() << std::endl;
+            if (patch_enabled) {
+                std::cout << "     Patch start:    " << patch.GetStart() << std::endl;
+                std::cout << "     Active / frozen particles: " << patch.GetNumActive() << " / "
+                          << patch.GetNumFrozen() << std::endl;
+                std::cout << "     Recycled:       " << patch.GetNumRecycled() << std::endl;
+            }
             std::cout << "     Throttle input: " << driver_inputs.m_throttle << std::endl;
             std::cout << "     Braking input:  " << driver_inputs.m_braking << std::endl;
             std::cout << "     Steering input: " << driver_inputs.m_steering << std::endl;
@@ -418,6 +476,7 @@ int main(int argc, char* argv[]) {
             out_frame++;
             next_out_frame += out_steps;
             num_contacts = 0;
+            frame_steps = 0;
 
             csv.write_to_file(out_dir + "/output.dat");
         }
@@ -426,6 +485,13 @@ int main(int argc, char* argv[]) {
         if (vehicle->GetChassis()->IsFixed() && time > time_hold) {
             std::cout << std::endl << "Release vehicle t = " << time << std::endl;
             vehicle->GetChassisBody()->SetBodyFixed(false);
+
+            // Switch to the moving patch (the frozen particles now bound the active region)
+            if (terrain_type == GRANULAR_TERRAIN && moving_patch) {
+                end_walls->SetCollide(false);
+                patch.Initialize(&system);
+                patch_enabled = true;
+            }
         }
 
         // Update modules (process inputs from other modules)
@@ -433,8 +499,11 @@ int main(int argc, char* argv[]) {
         vehicle->Synchronize(time, driver_inputs, shoe_forces_left, shoe_forces_right);
 
         // Advance simulation for one timestep for all modules
-        driver.Advance(time_step);
-        vehicle->Advance(time_step);
+        double step = stepper ? stepper->GetStep() : time_step;
+        driver.Advance(step);
+        vehicle->Advance(step);
+        if (stepper)
+            stepper->Update(&system, step);
 
 #ifdef CHRONO_OPENGL
         if (gl_window.Active())
@@ -443,16 +512,20 @@ int main(int argc, char* argv[]) {
             break;
 #endif
 
-        progressbar(out_steps + sim_frame - next_out_frame + 1, out_steps);
+        progressbar(std::min(frame_steps + 1, out_steps), out_steps);
 
         // Periodically display maximum constraint violation
         if (monitor_bilaterals && sim_frame % bilateral_frame_interval == 0) {
             vehicle->LogConstraintViolations();
         }
 
+        if (patch_enabled)
+            patch.Update(&system);
+
         // Update counters.
-        time += time_step;
+        time += step;
         sim_frame++;
+        frame_steps++;
         exec_time += system.GetTimerStep();
         num_contacts += system.GetNcontacts();
     }
@@ -462,6 +535,11 @@ int main(int argc, char* argv[]) {
     std::cout << "Simulation time:   " << exec_time << std::endl;
     std::cout << "Number of threads: " << threads << std::endl;
 
+    if (stepper) {
+        stepper->PrintSummary();
+        stepper->WriteHistory(out_dir + "/steps.csv");
+    }
+
     csv.write_to_file(out_dir + "/output.dat");
 
     return 0;
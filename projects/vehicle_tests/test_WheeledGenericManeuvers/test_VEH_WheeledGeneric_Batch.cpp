@@ -0,0 +1,426 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Batch runner for the generic vehicle maneuvers (straight line acceleration,
+// ISO double lane change, constant radius cornering with a speed ramp).
+//
+// Each maneuver builds its own vehicle, terrain and driver (and therefore its
+// own ChSystem) and runs without visualization; the maneuvers are distributed
+// over a pool of worker threads. The vehicles are built one at a time (creating
+// Chrono systems and bodies is not guaranteed to be thread-safe), and only the
+// simulations run concurrently. The vehicle states of all maneuvers are
+// written, once all are done, to a single tab-separated table (one row per
+// maneuver and output frame, with the maneuver parameters as leading columns).
+//
+// Usage: test_VEH_WheeledGeneric_Batch [maneuver_file] [num_threads]
+// Each line of the maneuver file is
+//     type init_speed final_speed radius tend
+// with type ACCEL, LANE_CHANGE or CRC, speeds in m/s, radius in m (negative for
+// counterclockwise turns) and tend in s; fields not used by a maneuver type are
+// ignored, and lines starting with '#' are skipped. Without a maneuver file, a
+// default sweep of cornering speeds and radii plus lane changes is run.
+//
+// The vehicle reference frame has Z up, X towards the front of the vehicle, and
+// Y pointing to the left.
+//
+// =============================================================================
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "chrono/core/ChTimer.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/utils/ChFilters.h"
+#include "chrono/utils/ChUtilsInputOutput.h"
+
+#include "chrono_vehicle/ChConfigVehicle.h"
+#include "chrono_vehicle/ChVehicleModelData.h"
+#include "chrono_vehicle/terrain/RigidTerrain.h"
+
+#include "chrono_models/vehicle/generic/Generic_Vehicle.h"
+#include "chrono_models/vehicle/generic/Generic_SimpleMapPowertrain.h"
+#include "chrono_models/vehicle/generic/Generic_FialaTire.h"
+#include "chrono_vehicle/driver/ChPathFollowerDriver.h"
+
+#include "chrono_thirdparty/filesystem/path.h"
+
+using namespace chrono;
+using namespace chrono::vehicle;
+using namespace chrono::vehicle::generic;
+
+// =============================================================================
+
+// Simulation step size
+double step_size = 1e-4;
+
+// Time interval between two output frames
+double output_step_size = 1.0 / 50;
+
+int filter_window_size = 20;
+
+// Output directory
+const std::string out_dir = "../GENERIC_VEHICLE_BATCH";
+
+// Serializes the construction of the maneuvers' vehicles, terrains and drivers
+std::mutex setup_mutex;
+
+enum class ManeuverType { ACCEL, LANE_CHANGE, CRC };
+
+struct Maneuver {
+    ManeuverType type;
+    double init_speed;   // initial (and, except for CRC, target) speed
+    double final_speed;  // CRC: target speed at tend
+    double radius;       // CRC: turn radius (negative for counterclockwise)
+    double tend;
+};
+
+// Output columns (after the maneuver columns)
+const char* state_columns[] = {"time",        "steering",  "throttle", "braking",  "motor_speed",
+                               "motor_torque", "x",         "y",        "z",        "fwd_speed",
+                               "lat_speed",    "fwd_acc",   "lat_acc",  "vert_acc", "yaw_rate"};
+const int num_state_columns = sizeof(state_columns) / sizeof(state_columns[0]);
+
+struct ManeuverResult {
+    std::vector<double> rows;  // num_state_columns values per output frame
+    double wall_time = 0;
+    bool ok = false;
+    std::string error;
+};
+
+// =============================================================================
+
+const char* ManeuverName(ManeuverType type) {
+    switch (type) {
+        case ManeuverType::ACCEL:
+            return "ACCEL";
+        case ManeuverType::LANE_CHANGE:
+            return "LANE_CHANGE";
+        default:
+            return "CRC";
+    }
+}
+
+bool ReadManeuvers(const std::string& filename, std::vector<Maneuver>& maneuvers) {
+    std::ifstream file(filename);
+    if (!file.is_open())
+        return false;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream iss(line);
+        std::string type;
+        Maneuver m;
+        if (!(iss >> type >> m.init_speed >> m.final_speed >> m.radius >> m.tend))
+            continue;
+        if (type == "ACCEL")
+            m.type = ManeuverType::ACCEL;
+        else if (type == "LANE_CHANGE")
+            m.type = ManeuverType::LANE_CHANGE;
+        else if (type == "CRC")
+            m.type = ManeuverType::CRC;
+        else
+            continue;
+        maneuvers.push_back(m);
+    }
+    return true;
+}
+
+std::vector<Maneuver> DefaultManeuvers() {
+    std::vector<Maneuver> maneuvers;
+    maneuvers.push_back({ManeuverType::ACCEL, 30.0 / 3.6, 0, 0, 20});
+    double lane_change_speeds[] = {40, 60, 80};
+    for (double speed : lane_change_speeds)
+        maneuvers.push_back({ManeuverType::LANE_CHANGE, speed / 3.6, 0, 0, 15});
+    double final_speeds[] = {60, 80, 100};
+    double radii[] = {100, 200, -200};
+    for (double radius : radii) {
+        for (double speed : final_speeds)
+            maneuvers.push_back({ManeuverType::CRC, 30.0 / 3.6, speed / 3.6, radius, 30});
+    }
+    return maneuvers;
+}
+
+// Bezier control points of a constant radius path (see test_VEH_WheeledGeneric_CRC)
+void CalcControlPoints(double run,
+                       double radius,
+                       int nturns,
+                       std::vector<ChVector<>>& points,
+                       std::vector<ChVector<>>& inCV,
+                       std::vector<ChVector<>>& outCV) {
+    // Height of path
+    double z = 0.1;
+
+    // Approximate circular path using 4 points
+    double direction = radius > 0 ? 1 : -1;
+    radius = std::abs(radius);
+    double factor = radius * 0.55191502449;
+
+    ChVector<> P1(0, direction * radius, z);
+    ChVector<> P2(radius, 0, z);
+    ChVector<> P3(0, -direction * radius, z);
+    ChVector<> P4(-radius, 0, z);
+    ChVector<> P0(-run, direction * radius, z);
+
+    points.push_back(P0);
+    inCV.push_back(P0 - ChVector<>(run / 2., 0, 0));
+    outCV.push_back(P0 + ChVector<>(run / 2., 0, 0));
+
+    for (int i = 0; i < nturns; i++) {
+        points.push_back(P1);
+        inCV.push_back(P1 - ChVector<>(factor, 0, 0));
+        outCV.push_back(P1 + ChVector<>(factor, 0, 0));
+
+        points.push_back(P2);
+        inCV.push_back(P2 + ChVector<>(0, direction * factor, 0));
+        outCV.push_back(P2 - ChVector<>(0, direction * factor, 0));
+
+        points.push_back(P3);
+        inCV.push_back(P3 + ChVector<>(factor, 0, 0));
+        outCV.push_back(P3 - ChVector<>(factor, 0, 0));
+
+        points.push_back(P4);
+        inCV.push_back(P4 - ChVector<>(0, direction * factor, 0));
+        outCV.push_back(P4 + ChVector<>(0, direction * factor, 0));
+    }
+
+    points.push_back(P1);
+    inCV.push_back(P1 - ChVector<>(factor, 0, 0));
+    outCV.push_back(P1 + ChVector<>(factor, 0, 0));
+}
+
+// Run one maneuver on the calling thread
+void RunManeuver(const Maneuver& m, ManeuverResult& result) {
+    ChTimer<double> timer;
+    timer.start();
+
+    // Maneuver setup (as in the single maneuver tests)
+    ChVector<> initLoc(0, 0, 0.6);
+    double terrain_size = 500.0;
+    std::string steering_controller_file("generic/driver/SteeringController.json");
+    std::string speed_controller_file("generic/driver/SpeedController.json");
+    std::shared_ptr<ChBezierCurve> path;
+    double target_speed = m.init_speed;
+    switch (m.type) {
+        case ManeuverType::ACCEL:
+            terrain_size = 100.0;
+            target_speed = 10000;  // full throttle
+            path = ChBezierCurve::read(vehicle::GetDataFile("paths/straight10km.txt"));
+            break;
+        case ManeuverType::LANE_CHANGE:
+            initLoc = ChVector<>(0, 0, 0.5);
+            steering_controller_file = "generic/driver/SteeringController_ISO_double_lane_change.json";
+            speed_controller_file = "generic/driver/SpeedController_ISO_double_lane_change.json";
+            path = ChBezierCurve::read(vehicle::GetDataFile("paths/ISO_double_lane_change2.txt"));
+            break;
+        case ManeuverType::CRC: {
+            double run = 10;
+            int nturns = 1 + int(std::ceil(((m.final_speed + m.init_speed) / 2 * m.tend) /
+                                           (std::abs(m.radius) * CH_C_2PI)));
+            initLoc = ChVector<>(-run - 5, m.radius, 0.6);
+            std::vector<ChVector<>> points;
+            std::vector<ChVector<>> inCV;
+            std::vector<ChVector<>> outCV;
+            CalcControlPoints(run, m.radius, nturns, points, inCV, outCV);
+            path = chrono_types::make_shared<ChBezierCurve>(points, inCV, outCV);
+            break;
+        }
+    }
+
+    // Vehicle, terrain, powertrain and tires, without visualization assets
+    std::unique_lock<std::mutex> lock(setup_mutex);
+    Generic_Vehicle vehicle(false, SuspensionTypeWV::DOUBLE_WISHBONE);
+    vehicle.Initialize(ChCoordsys<>(initLoc, QUNIT), m.init_speed);
+    vehicle.GetSystem()->SetNumThreads(1);
+
+    auto patch_mat = chrono_types::make_shared<ChMaterialSurfaceNSC>();
+    patch_mat->SetFriction(0.9f);
+    patch_mat->SetRestitution(0.01f);
+    RigidTerrain terrain(vehicle.GetSystem());
+    terrain.AddPatch(patch_mat, ChVector<>(0, 0, 0), ChVector<>(0, 0, 1), terrain_size, terrain_size);
+    terrain.Initialize();
+
+    auto powertrain = chrono_types::make_shared<Generic_SimpleMapPowertrain>("Powertrain");
+    vehicle.InitializePowertrain(powertrain);
+
+    auto tire_FL = chrono_types::make_shared<Generic_FialaTire>("FL");
+    auto tire_FR = chrono_types::make_shared<Generic_FialaTire>("FR");
+    auto tire_RL = chrono_types::make_shared<Generic_FialaTire>("RL");
+    auto tire_RR = chrono_types::make_shared<Generic_FialaTire>("RR");
+    vehicle.InitializeTire(tire_FL, vehicle.GetWheel(0, LEFT), VisualizationType::NONE);
+    vehicle.InitializeTire(tire_FR, vehicle.GetWheel(0, RIGHT), VisualizationType::NONE);
+    vehicle.InitializeTire(tire_RL, vehicle.GetWheel(1, LEFT), VisualizationType::NONE);
+    vehicle.InitializeTire(tire_RR, vehicle.GetWheel(1, RIGHT), VisualizationType::NONE);
+
+    ChPathFollowerDriver driver(vehicle, vehicle::GetDataFile(steering_controller_file),
+                                vehicle::GetDataFile(speed_controller_file), path, "my_path", target_speed, false);
+    driver.Initialize();
+    lock.unlock();
+
+    utils::ChRunningAverage fwd_acc_filter(filter_window_size);
+    utils::ChRunningAverage lat_acc_filter(filter_window_size);
+    utils::ChRunningAverage vert_acc_filter(filter_window_size);
+
+    int output_steps = (int)std::ceil(output_step_size / step_size);
+    int step_number = 0;
+    double time = 0;
+
+    while (time <= m.tend) {
+        time = vehicle.GetChTime();
+
+        ChVector<> acc_CG = vehicle.GetChassisBody()->GetPos_dtdt();
+        acc_CG = vehicle.GetChassisBody()->GetCoord().TransformDirectionParentToLocal(acc_CG);
+        double fwd_acc = fwd_acc_filter.Add(acc_CG.x());
+        double lat_acc = lat_acc_filter.Add(acc_CG.y());
+        double vert_acc = vert_acc_filter.Add(acc_CG.z());
+
+        ChDriver::Inputs driver_inputs = driver.GetInputs();
+
+        if (step_number % output_steps == 0) {
+            ChVector<> vel_CG = vehicle.GetChassisBody()->GetPos_dt();
+            vel_CG = vehicle.GetChassisBody()->GetCoord().TransformDirectionParentToLocal(vel_CG);
+            ChVector<> pos = vehicle.GetChassis()->GetPos();
+            double values[num_state_columns] = {time,
+                                                driver_inputs.m_steering,
+                                                driver_inputs.m_throttle,
+                                                driver_inputs.m_braking,
+                                                powertrain->GetMotorSpeed(),
+                                                powertrain->GetMotorTorque(),
+                                                pos.x(),
+                                                pos.y(),
+                                                pos.z(),
+                                                vel_CG.x(),
+                                                vel_CG.y(),
+                                                fwd_acc,
+                                                lat_acc,
+                                                vert_acc,
+                                                vehicle.GetChassisBody()->GetWvel_loc().z()};
+            result.rows.insert(result.rows.end(), values, values + num_state_columns);
+        }
+
+        driver.Synchronize(time);
+        terrain.Synchronize(time);
+        vehicle.Synchronize(time, driver_inputs, terrain);
+
+        // Speed ramp of the cornering maneuver
+        if (m.type == ManeuverType::CRC)
+            driver.SetDesiredSpeed((m.final_speed - m.init_speed) / m.tend * time + m.init_speed);
+
+        driver.Advance(step_size);
+        terrain.Advance(step_size);
+        vehicle.Advance(step_size);
+
+        step_number++;
+    }
+
+    timer.stop();
+    result.wall_time = timer.GetTimeSeconds();
+    result.ok = true;
+}
+
+// =============================================================================
+
+int main(int argc, char* argv[]) {
+    // Set path to Chrono and Chrono::Vehicle data directories
+    SetChronoDataPath(CHRONO_DATA_DIR);
+    vehicle::SetDataPath(CHRONO_VEHICLE_DATA_DIR);
+
+    std::vector<Maneuver> maneuvers;
+    if (argc > 1) {
+        if (!ReadManeuvers(argv[1], maneuvers)) {
+            std::cout << "Error reading maneuver file " << argv[1] << std::endl;
+            return 1;
+        }
+    } else {
+        maneuvers = DefaultManeuvers();
+    }
+    int num_threads = (int)std::thread::hardware_concurrency();
+    if (argc > 2)
+        num_threads = std::atoi(argv[2]);
+    num_threads = std::max(1, std::min(num_threads, (int)maneuvers.size()));
+
+    if (!filesystem::create_directory(filesystem::path(out_dir))) {
+        std::cout << "Error creating directory " << out_dir << std::endl;
+        return 1;
+    }
+
+    std::cout << "Running " << maneuvers.size() << " maneuvers on " << num_threads << " threads" << std::endl;
+
+    // Worker threads take the next maneuver until all are done
+    std::vector<ManeuverResult> results(maneuvers.size());
+    std::atomic<int> next(0);
+    std::mutex log_mutex;
+    ChTimer<double> timer;
+    timer.start();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < num_threads; t++) {
+        workers.emplace_back([&]() {
+            for (int i = next++; i < (int)maneuvers.size(); i = next++) {
+                try {
+                    RunManeuver(maneuvers[i], results[i]);
+                } catch (std::exception& e) {
+                    results[i].error = e.what();
+                }
+                std::lock_guard<std::mutex> lock(log_mutex);
+                std::cout << "Maneuver " << i << " (" << ManeuverName(maneuvers[i].type) << ") "
+                          << (results[i].ok ? "done" : "FAILED: " + results[i].error) << " in "
+                          << results[i].wall_time << " s" << std::endl;
+            }
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+    timer.stop();
+
+    // Single table with the results of all maneuvers
+    utils::CSV_writer csv("\t");
+    csv.stream().setf(std::ios::scientific | std::ios::showpos);
+    csv.stream().precision(6);
+    csv << "maneuver"
+        << "type"
+        << "init_speed"
+        << "final_speed"
+        << "radius";
+    for (int c = 0; c < num_state_columns; c++)
+        csv << state_columns[c];
+    csv << std::endl;
+    int num_ok = 0;
+    double busy_time = 0;
+    for (size_t i = 0; i < maneuvers.size(); i++) {
+        const Maneuver& m = maneuvers[i];
+        const ManeuverResult& r = results[i];
+        num_ok += r.ok ? 1 : 0;
+        busy_time += r.wall_time;
+        for (size_t row = 0; row < r.rows.size(); row += num_state_columns) {
+            csv << (int)i << ManeuverName(m.type) << m.init_speed << m.final_speed << m.radius;
+            for (int c = 0; c < num_state_columns; c++)
+                csv << r.rows[row + c];
+            csv << std::endl;
+        }
+    }
+    csv.write_to_file(out_dir + "/results.dat");
+
+    double wall_time = timer.GetTimeSeconds();
+    std::cout << "==================================" << std::endl;
+    std::cout << "Maneuvers:        " << num_ok << " of " << maneuvers.size() << " completed" << std::endl;
+    std::cout << "Wall time:        " << wall_time << " s (" << busy_time / std::max(wall_time, 1e-9)
+              << " maneuvers in flight on average)" << std::endl;
+    std::cout << "Throughput:       " << num_ok * 3600.0 / std::max(wall_time, 1e-9) << " maneuvers/hour on this node"
+              << std::endl;
+
+    return num_ok == (int)maneuvers.size() ? 0 : 1;
+}
@@ -0,0 +1,398 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Batch evaluation of the steady-state Pacejka (MF-Tyre 2002) Magic Formula.
+//
+// PacejkaBatch reads the coefficients of a TNO .tir parameter file and
+// evaluates the longitudinal and lateral forces and the aligning moment for
+// arrays of slip states (kappa, alpha, gamma, Fz), in the tire contact frame
+// and with the ISO sign convention of the Magic Formula. The state arrays and
+// the results are stored as separate arrays (structure of arrays) and the
+// evaluation is one branch-free loop over the points, so that the compiler can
+// vectorize it (with a vector math library, e.g. -O3 -ffast-math on gcc).
+//
+// Unlike ChPacejkaTire, there is no wheel state, terrain query, or transient
+// slip model: this is meant for fitting and characterization sweeps, or for the
+// force evaluation of many tires at once once their slips are known.
+//
+// =============================================================================
+
+#ifndef PACEJKA_BATCH_H
+#define PACEJKA_BATCH_H
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "chrono/core/ChException.h"
+
+namespace chrono {
+namespace vehicle {
+
+/// Slip states of a batch (structure of arrays, all of the same size).
+struct PacejkaSlips {
+    std::vector<double> kappa;  ///< longitudinal slip
+    std::vector<double> alpha;  ///< slip angle [rad]
+    std::vector<double> gamma;  ///< camber angle [rad]
+    std::vector<double> Fz;     ///< vertical load [N]
+
+    size_t size() const { return kappa.size(); }
+    void resize(size_t n) {
+        kappa.resize(n);
+        alpha.resize(n);
+        gamma.resize(n);
+        Fz.resize(n);
+    }
+};
+
+/// Forces and moments of a batch (structure of arrays).
+struct PacejkaForces {
+    std::vector<double> Fx;  ///< longitudinal force, combined slip [N]
+    std::vector<double> Fy;  ///< lateral force, combined slip [N]
+    std::vector<double> Mz;  ///< aligning moment, combined slip [Nm]
+    std::vector<double> Fx0;  ///< longitudinal force, pure slip [N]
+    std::vector<double> Fy0;  ///< lateral force, pure slip [N]
+    std::vector<double> Mz0;  ///< aligning moment, pure slip [Nm]
+
+    void resize(size_t n) {
+        Fx.resize(n);
+        Fy.resize(n);
+        Mz.resize(n);
+        Fx0.resize(n);
+        Fy0.resize(n);
+        Mz0.resize(n);
+    }
+};
+
+class PacejkaBatch {
+  public:
+    /// Load the coefficients from the given .tir file.
+    /// Coefficients missing from the file are zero, and scaling factors missing from the file are one.
+    PacejkaBatch(const std::string& tir_filename) {
+        std::ifstream file(tir_filename);
+        if (!file.is_open())
+            throw ChException("PacejkaBatch: cannot open " + tir_filename);
+        std::string line;
+        while (std::getline(file, line)) {
+            // key = value $comment
+            size_t end = line.find_first_of("$!");
+            if (end != std::string::npos)
+                line.erase(end);
+            size_t eq = line.find('=');
+            if (eq == std::string::npos)
+                continue;
+            std::string key = Trim(line.substr(0, eq));
+            std::string value = Trim(line.substr(eq + 1));
+            char* stop;
+            double x = std::strtod(value.c_str(), &stop);
+            if (!key.empty() && stop != value.c_str())
+                m_values[key] = x;
+        }
+        if (Get("FNOMIN") <= 0)
+            throw ChException("PacejkaBatch: no nominal load (FNOMIN) in " + tir_filename);
+
+        LoadCoefficients();
+    }
+
+    /// Return the value of a coefficient of the parameter file (def if not present).
+    double Get(const std::string& key, double def = 0) const {
+        auto it = m_values.find(key);
+        return it == m_values.end() ? def : it->second;
+    }
+
+    double GetNominalLoad() const { return m_Fz0; }
+    double GetUnloadedRadius() const { return m_R0; }
+
+    /// Evaluate the forces and moments at all the given slip states.
+    void Evaluate(const PacejkaSlips& slips, PacejkaForces& forces) const {
+        size_t n = slips.size();
+        forces.resize(n);
+        Evaluate(n, slips.kappa.data(), slips.alpha.data(), slips.gamma.data(), slips.Fz.data(), forces.Fx.data(),
+                 forces.Fy.data(), forces.Mz.data(), forces.Fx0.data(), forces.Fy0.data(), forces.Mz0.data());
+    }
+
+    /// Evaluate the forces and moments at n slip states (raw array version).
+    void Evaluate(size_t n,
+                  const double* kappa,
+                  const double* alpha,
+                  const double* gamma,
+                  const double* Fz,
+                  double* Fx,
+                  double* Fy,
+                  double* Mz,
+                  double* Fx0,
+                  double* Fy0,
+                  double* Mz0) const {
+        const Coefficients& c = m_c;
+        const double eps = 1e-6;
+        for (size_t i = 0; i < n; i++) {
+            double k = kappa[i];
+            double a = std::tan(alpha[i]);
+            double g = gamma[i];
+            double fz = Fz[i];
+            double dfz = (fz - c.Fz0s) / c.Fz0s;
+            double dfz2 = dfz * dfz;
+
+            // Pure longitudinal slip
+            double SHx = (c.PHX1 + c.PHX2 * dfz) * c.LHX;
+            double kx = k + SHx;
+            double mux = (c.PDX1 + c.PDX2 * dfz) * (1 - c.PDX3 * g * g) * c.LMUX;
+            double Dx = mux * fz;
+            double Ex = (c.PEX1 + c.PEX2 * dfz + c.PEX3 * dfz2) * (1 - c.PEX4 * Sign(kx)) * c.LEX;
+            Ex = std::fmin(Ex, 1.0);
+            double Kx = fz * (c.PKX1 + c.PKX2 * dfz) * std::exp(c.PKX3 * dfz) * c.LKX;
+            double Bx = Kx / (c.Cx * Dx + eps);
+            double SVx = fz * (c.PVX1 + c.PVX2 * dfz) * c.LVX * c.LMUX;
+            double fx0 = Dx * MagicSin(Bx, c.Cx, Ex, kx) + SVx;
+
+            // Pure lateral slip
+            double gy = g * c.LGAY;
+            double SHy = (c.PHY1 + c.PHY2 * dfz) * c.LHY + c.PHY3 * gy;
+            double ay = a + SHy;
+            double muy = (c.PDY1 + c.PDY2 * dfz) * (1 - c.PDY3 * gy * gy) * c.LMUY;
+            double Dy = muy * fz;
+            double Ey = (c.PEY1 + c.PEY2 * dfz) * (1 - (c.PEY3 + c.PEY4 * gy) * Sign(ay)) * c.LEY;
+            Ey = std::fmin(Ey, 1.0);
+            double Ky =
+                c.PKY1 * c.Fz0s * std::sin(2 * std::atan(fz / (c.PKY2 * c.Fz0s))) * (1 - c.PKY3 * std::fabs(gy)) * c.LKY;
+            double By = Ky / (c.Cy * Dy + eps);
+            double SVy = fz * ((c.PVY1 + c.PVY2 * dfz) * c.LVY + (c.PVY3 + c.PVY4 * dfz) * gy) * c.LMUY;
+            double fy0 = Dy * MagicSin(By, c.Cy, Ey, ay) + SVy;
+
+            // Pure slip aligning moment (pneumatic trail and residual moment)
+            double gz = g * c.LGAZ;
+            double cos_a = std::cos(alpha[i]);
+            double SHt = c.QHZ1 + c.QHZ2 * dfz + (c.QHZ3 + c.QHZ4 * dfz) * gz;
+            double at = a + SHt;
+            double Bt = (c.QBZ1 + c.QBZ2 * dfz + c.QBZ3 * dfz2) * (1 + c.QBZ4 * gz + c.QBZ5 * std::fabs(gz)) * c.LKY /
+                        c.LMUY;
+            double Dt = fz * (c.QDZ1 + c.QDZ2 * dfz) * (1 + c.QDZ3 * gz + c.QDZ4 * gz * gz) * (c.R0 / c.Fz0s) * c.LTR;
+            double Et0 = c.QEZ1 + c.QEZ2 * dfz + c.QEZ3 * dfz2;
+            double Et1 = c.QEZ4 + c.QEZ5 * gz;
+            double SHf = SHy + SVy / (Ky + eps);
+            double ar = a + SHf;
+            double Br = c.QBZ9 * c.LKY / c.LMUY + c.QBZ10 * By * c.Cy;
+            double Dr = fz * ((c.QDZ6 + c.QDZ7 * dfz) * c.LRES + (c.QDZ8 + c.QDZ9 * dfz) * gz) * c.R0 * c.LMUY;
+            double t0 = Trail(Bt, c.QCZ1, Et0, Et1, Dt, at) * cos_a;
+            double Mzr0 = Dr * std::cos(std::atan(Br * ar)) * cos_a;
+            double mz0 = -t0 * fy0 + Mzr0;
+
+            // Combined slip longitudinal force
+            double Bxa = c.RBX1 * std::cos(std::atan(c.RBX2 * k)) * c.LXAL;
+            double Exa = std::fmin(c.REX1 + c.REX2 * dfz, 1.0);
+            double Gxa = MagicCos(Bxa, c.RCX1, Exa, a + c.RHX1) / MagicCos(Bxa, c.RCX1, Exa, c.RHX1);
+            double fx = Gxa * fx0;
+
+            // Combined slip lateral force
+            double SHyk = c.RHY1 + c.RHY2 * dfz;
+            double Byk = c.RBY1 * std::cos(std::atan(c.RBY2 * (a - c.RBY3))) * c.LYKA;
+            double Eyk = std::fmin(c.REY1 + c.REY2 * dfz, 1.0);
+            double Gyk = MagicCos(Byk, c.RCY1, Eyk, k + SHyk) / MagicCos(Byk, c.RCY1, Eyk, SHyk);
+            double DVyk = muy * fz * (c.RVY1 + c.RVY2 * dfz + c.RVY3 * g) * std::cos(std::atan(c.RVY4 * a));
+            double SVyk = DVyk * std::sin(c.RVY5 * std::atan(c.RVY6 * k)) * c.LVYKA;
+            double fy = Gyk * fy0 + SVyk;
+
+            // Combined slip aligning moment (equivalent slip angles)
+            double kr = Kx / (Ky + eps) * k;
+            double at_eq = std::copysign(std::sqrt(at * at + kr * kr), at);
+            double ar_eq = std::copysign(std::sqrt(ar * ar + kr * kr), ar);
+            double t = Trail(Bt, c.QCZ1, Et0, Et1, Dt, at_eq) * cos_a;
+            double Mzr = Dr * std::cos(std::atan(Br * ar_eq)) * cos_a;
+            double s = (c.SSZ1 + c.SSZ2 * (fy / c.Fz0s) + (c.SSZ3 + c.SSZ4 * dfz) * g) * c.R0 * c.LS;
+            double mz = -t * (fy - SVyk) + Mzr + s * fx;
+
+            Fx[i] = fx;
+            Fy[i] = fy;
+            Mz[i] = mz;
+            Fx0[i] = fx0;
+            Fy0[i] = fy0;
+            Mz0[i] = mz0;
+        }
+    }
+
+  private:
+    struct Coefficients {
+        double Fz0s, R0;
+        double PCX1, PDX1, PDX2, PDX3, PEX1, PEX2, PEX3, PEX4, PKX1, PKX2, PKX3, PHX1, PHX2, PVX1, PVX2, Cx;
+        double PCY1, PDY1, PDY2, PDY3, PEY1, PEY2, PEY3, PEY4, PKY1, PKY2, PKY3, PHY1, PHY2, PHY3;
+        double PVY1, PVY2, PVY3, PVY4, Cy;
+        double QBZ1, QBZ2, QBZ3, QBZ4, QBZ5, QBZ9, QBZ10, QCZ1, QDZ1, QDZ2, QDZ3, QDZ4, QDZ6, QDZ7, QDZ8, QDZ9;
+        double QEZ1, QEZ2, QEZ3, QEZ4, QEZ5, QHZ1, QHZ2, QHZ3, QHZ4;
+        double SSZ1, SSZ2, SSZ3, SSZ4;
+        double RBX1, RBX2, RCX1, REX1, REX2, RHX1;
+        double RBY1, RBY2, RBY3, RCY1, REY1, REY2, RHY1, RHY2, RVY1, RVY2, RVY3, RVY4, RVY5, RVY6;
+        double LFZO, LCX, LMUX, LEX, LKX, LHX, LVX, LCY, LMUY, LEY, LKY, LHY, LVY, LGAY, LTR, LRES, LGAZ;
+        double LXAL, LYKA, LVYKA, LS;
+    };
+
+    void LoadCoefficients() {
+        Coefficients& c = m_c;
+#define PACEJKA_COEFFICIENT(name) c.name = Get(#name)
+#define PACEJKA_SCALING(name) c.name = Get(#name, 1.0)
+        PACEJKA_SCALING(LFZO);
+        PACEJKA_SCALING(LCX);
+        PACEJKA_SCALING(LMUX);
+        PACEJKA_SCALING(LEX);
+        PACEJKA_SCALING(LKX);
+        PACEJKA_SCALING(LHX);
+        PACEJKA_SCALING(LVX);
+        PACEJKA_SCALING(LCY);
+        PACEJKA_SCALING(LMUY);
+        PACEJKA_SCALING(LEY);
+        PACEJKA_SCALING(LKY);
+        PACEJKA_SCALING(LHY);
+        PACEJKA_SCALING(LVY);
+        PACEJKA_SCALING(LGAY);
+        PACEJKA_SCALING(LTR);
+        PACEJKA_SCALING(LRES);
+        PACEJKA_SCALING(LGAZ);
+        PACEJKA_SCALING(LXAL);
+        PACEJKA_SCALING(LYKA);
+        PACEJKA_SCALING(LVYKA);
+        PACEJKA_SCALING(LS);
+
+        PACEJKA_COEFFICIENT(PCX1);
+        PACEJKA_COEFFICIENT(PDX1);
+        PACEJKA_COEFFICIENT(PDX2);
+        PACEJKA_COEFFICIENT(PDX3);
+        PACEJKA_COEFFICIENT(PEX1);
+        PACEJKA_COEFFICIENT(PEX2);
+        PACEJKA_COEFFICIENT(PEX3);
+        PACEJKA_COEFFICIENT(PEX4);
+        PACEJKA_COEFFICIENT(PKX1);
+        PACEJKA_COEFFICIENT(PKX2);
+        PACEJKA_COEFFICIENT(PKX3);
+        PACEJKA_COEFFICIENT(PHX1);
+        PACEJKA_COEFFICIENT(PHX2);
+        PACEJKA_COEFFICIENT(PVX1);
+        PACEJKA_COEFFICIENT(PVX2);
+
+        PACEJKA_COEFFICIENT(PCY1);
+        PACEJKA_COEFFICIENT(PDY1);
+        PACEJKA_COEFFICIENT(PDY2);
+        PACEJKA_COEFFICIENT(PDY3);
+        PACEJKA_COEFFICIENT(PEY1);
+        PACEJKA_COEFFICIENT(PEY2);
+        PACEJKA_COEFFICIENT(PEY3);
+        PACEJKA_COEFFICIENT(PEY4);
+        PACEJKA_COEFFICIENT(PKY1);
+        PACEJKA_COEFFICIENT(PKY2);
+        PACEJKA_COEFFICIENT(PKY3);
+        PACEJKA_COEFFICIENT(PHY1);
+        PACEJKA_COEFFICIENT(PHY2);
+        PACEJKA_COEFFICIENT(PHY3);
+        PACEJKA_COEFFICIENT(PVY1);
+        PACEJKA_COEFFICIENT(PVY2);
+        PACEJKA_COEFFICIENT(PVY3);
+        PACEJKA_COEFFICIENT(PVY4);
+
+        PACEJKA_COEFFICIENT(QBZ1);
+        PACEJKA_COEFFICIENT(QBZ2);
+        PACEJKA_COEFFICIENT(QBZ3);
+        PACEJKA_COEFFICIENT(QBZ4);
+        PACEJKA_COEFFICIENT(QBZ5);
+        PACEJKA_COEFFICIENT(QBZ9);
+        PACEJKA_COEFFICIENT(QBZ10);
+        PACEJKA_COEFFICIENT(QCZ1);
+        PACEJKA_COEFFICIENT(QDZ1);
+        PACEJKA_COEFFICIENT(QDZ2);
+        PACEJKA_COEFFICIENT(QDZ3);
+        PACEJKA_COEFFICIENT(QDZ4);
+        PACEJKA_COEFFICIENT(QDZ6);
+        PACEJKA_COEFFICIENT(QDZ7);
+        PACEJKA_COEFFICIENT(QDZ8);
+        PACEJKA_COEFFICIENT(QDZ9);
+        PACEJKA_COEFFICIENT(QEZ1);
+        PACEJKA_COEFFICIENT(QEZ2);
+        PACEJKA_COEFFICIENT(QEZ3);
+        PACEJKA_COEFFICIENT(QEZ4);
+        PACEJKA_COEFFICIENT(QEZ5);
+        PACEJKA_COEFFICIENT(QHZ1);
+        PACEJKA_COEFFICIENT(QHZ2);
+        PACEJKA_COEFFICIENT(QHZ3);
+        PACEJKA_COEFFICIENT(QHZ4);
+        PACEJKA_COEFFICIENT(SSZ1);
+        PACEJKA_COEFFICIENT(SSZ2);
+        PACEJKA_COEFFICIENT(SSZ3);
+        PACEJKA_COEFFICIENT(SSZ4);
+
+        PACEJKA_COEFFICIENT(RBX1);
+        PACEJKA_COEFFICIENT(RBX2);
+        PACEJKA_COEFFICIENT(RCX1);
+        PACEJKA_COEFFICIENT(REX1);
+        PACEJKA_COEFFICIENT(REX2);
+        PACEJKA_COEFFICIENT(RHX1);
+        PACEJKA_COEFFICIENT(RBY1);
+        PACEJKA_COEFFICIENT(RBY2);
+        PACEJKA_COEFFICIENT(RBY3);
+        PACEJKA_COEFFICIENT(RCY1);
+        PACEJKA_COEFFICIENT(REY1);
+        PACEJKA_COEFFICIENT(REY2);
+        PACEJKA_COEFFICIENT(RHY1);
+        PACEJKA_COEFFICIENT(RHY2);
+        PACEJKA_COEFFICIENT(RVY1);
+        PACEJKA_COEFFICIENT(RVY2);
+        PACEJKA_COEFFICIENT(RVY3);
+        PACEJKA_COEFFICIENT(RVY4);
+        PACEJKA_COEFFICIENT(RVY5);
+        PACEJKA_COEFFICIENT(RVY6);
+#undef PACEJKA_COEFFICIENT
+#undef PACEJKA_SCALING
+
+        m_Fz0 = Get("FNOMIN");
+        m_R0 = Get("UNLOADED_RADIUS");
+        c.Fz0s = m_Fz0 * c.LFZO;
+        c.R0 = m_R0;
+        c.Cx = c.PCX1 * c.LCX;
+        c.Cy = c.PCY1 * c.LCY;
+    }
+
+    static std::string Trim(const std::string& s) {
+        size_t b = s.find_first_not_of(" \t\r\n");
+        if (b == std::string::npos)
+            return "";
+        size_t e = s.find_last_not_of(" \t\r\n");
+        return s.substr(b, e - b + 1);
+    }
+
+    static double Sign(double x) { return (x > 0) - (x < 0); }
+
+    // The Magic Formula sin(C atan(B x - E (B x - atan(B x)))) and its cosine version.
+    static double MagicSin(double B, double C, double E, double x) {
+        double Bx = B * x;
+        return std::sin(C * std::atan(Bx - E * (Bx - std::atan(Bx))));
+    }
+    static double MagicCos(double B, double C, double E, double x) {
+        double Bx = B * x;
+        return std::cos(C * std::atan(Bx - E * (Bx - std::atan(Bx))));
+    }
+
+    // Pneumatic trail (without the cos(alpha) factor).
+    static double Trail(double Bt, double Ct, double Et0, double Et1, double Dt, double at) {
+        double Bat = Bt * at;
+        double Et = std::fmin(Et0 * (1 + Et1 * (2 / 3.14159265358979323846) * std::atan(Bt * Ct * at)), 1.0);
+        return Dt * std::cos(Ct * std::atan(Bat - Et * (Bat - std::atan(Bat))));
+    }
+
+    std::map<std::string, double> m_values;
+    Coefficients m_c;
+    double m_Fz0;
+    double m_R0;
+};
+
+}  // end namespace vehicle
+}  // end namespace chrono
+
+#endif
@@ -0,0 +1,154 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Lookup table of the Pacejka Magic Formula for real-time use.
+//
+// PacejkaTable tabulates the combined slip Fx, Fy, and Mz of a PacejkaBatch
+// tire on a regular grid over (kappa, alpha, gamma, Fz), at construction, and
+// evaluates them by multilinear interpolation between the 16 surrounding grid
+// nodes. Queries outside the grid are clamped to its boundary. The three
+// values of a node are stored together, so one query touches 16 contiguous
+// triples. The accuracy depends on the grid resolution, mostly in kappa and
+// alpha around the force peaks (see test_VEH_PacejkaTable).
+//
+// =============================================================================
+
+#ifndef PACEJKA_TABLE_H
+#define PACEJKA_TABLE_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "pacejka_batch.h"
+
+namespace chrono {
+namespace vehicle {
+
+class PacejkaTable {
+  public:
+    /// Range and number of grid nodes of one table dimension.
+    /// An axis with max <= min (e.g., a table for a single load) is constant: all queries use the value at min.
+    struct Axis {
+        double min;
+        double max;
+        int num;  ///< number of nodes (at least 2)
+    };
+
+    /// Tabulate the given tire over the given ranges of kappa, alpha [rad], gamma [rad], and Fz [N].
+    PacejkaTable(const PacejkaBatch& tire, const Axis& kappa, const Axis& alpha, const Axis& gamma, const Axis& Fz) {
+        m_axes[0] = kappa;
+        m_axes[1] = alpha;
+        m_axes[2] = gamma;
+        m_axes[3] = Fz;
+        for (int d = 0; d < 4; d++) {
+            m_axes[d].num = std::max(m_axes[d].num, 2);
+            if (m_axes[d].max > m_axes[d].min) {
+                m_inv_delta[d] = (m_axes[d].num - 1) / (m_axes[d].max - m_axes[d].min);
+            } else {
+                // degenerate axis: two coincident nodes, every query at the first one
+                m_axes[d].num = 2;
+                m_axes[d].max = m_axes[d].min;
+                m_inv_delta[d] = 0;
+            }
+        }
+        m_stride[3] = 1;
+        for (int d = 2; d >= 0; d--)
+            m_stride[d] = m_stride[d + 1] * m_axes[d + 1].num;
+        size_t n = m_stride[0] * m_axes[0].num;
+
+        // Evaluate all the nodes in one batch
+        PacejkaSlips slips;
+        slips.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            size_t r = i;
+            double x[4];
+            for (int d = 0; d < 4; d++) {
+                size_t j = r / m_stride[d];
+                r -= j * m_stride[d];
+                x[d] = m_axes[d].min + j * (m_axes[d].max - m_axes[d].min) / (m_axes[d].num - 1);
+            }
+            slips.kappa[i] = x[0];
+            slips.alpha[i] = x[1];
+            slips.gamma[i] = x[2];
+            slips.Fz[i] = x[3];
+        }
+        PacejkaForces forces;
+        tire.Evaluate(slips, forces);
+
+        m_values.resize(3 * n);
+        for (size_t i = 0; i < n; i++) {
+            m_values[3 * i + 0] = forces.Fx[i];
+            m_values[3 * i + 1] = forces.Fy[i];
+            m_values[3 * i + 2] = forces.Mz[i];
+        }
+    }
+
+    /// Return the number of grid nodes and the memory used by the table (in bytes).
+    size_t GetNumNodes() const { return m_values.size() / 3; }
+    size_t GetMemorySize() const { return m_values.size() * sizeof(double); }
+
+    /// Interpolate the combined slip forces and moment at the given slip state.
+    void Evaluate(double kappa, double alpha, double gamma, double Fz, double& Fx, double& Fy, double& Mz) const {
+        double x[4] = {kappa, alpha, gamma, Fz};
+        size_t base = 0;
+        double w[4];
+        for (int d = 0; d < 4; d++) {
+            double u = (x[d] - m_axes[d].min) * m_inv_delta[d];
+            u = std::min(std::max(u, 0.0), (double)(m_axes[d].num - 1));
+            int j = std::min((int)u, m_axes[d].num - 2);
+            w[d] = u - j;
+            base += j * m_stride[d];
+        }
+
+        double f[3] = {0, 0, 0};
+        for (int c = 0; c < 16; c++) {
+            double weight = 1;
+            size_t node = base;
+            for (int d = 0; d < 4; d++) {
+                int bit = (c >> (3 - d)) & 1;
+                weight *= bit ? w[d] : 1 - w[d];
+                node += bit * m_stride[d];
+            }
+            const double* v = &m_values[3 * node];
+            f[0] += weight * v[0];
+            f[1] += weight * v[1];
+            f[2] += weight * v[2];
+        }
+        Fx = f[0];
+        Fy = f[1];
+        Mz = f[2];
+    }
+
+    /// Interpolate the combined slip forces and moments at all the given slip states.
+    void Evaluate(const PacejkaSlips& slips, PacejkaForces& forces) const {
+        size_t n = slips.size();
+        forces.Fx.resize(n);
+        forces.Fy.resize(n);
+        forces.Mz.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            Evaluate(slips.kappa[i], slips.alpha[i], slips.gamma[i], slips.Fz[i], forces.Fx[i], forces.Fy[i],
+                     forces.Mz[i]);
+        }
+    }
+
+  private:
+    Axis m_axes[4];
+    double m_inv_delta[4];
+    size_t m_stride[4];
+    std::vector<double> m_values;  // Fx, Fy, Mz per node
+};
+
+}  // end namespace vehicle
+}  // end namespace chrono
+
+#endif
@@ -0,0 +1,127 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Slip sweeps of the Pacejka Magic Formula, evaluated in batch.
+// The four slip cases of test_VEH_tirePacejka (pure longitudinal slip, pure
+// lateral slip, pure lateral slip with camber, combined slip) are evaluated
+// in a single call for all sweep points, for a list of vertical loads, and
+// written to one file per case. The batch evaluation is then repeated to
+// measure its throughput.
+//
+// =============================================================================
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "chrono/core/ChGlobal.h"
+#include "chrono/core/ChTimer.h"
+#include "chrono/utils/ChUtilsInputOutput.h"
+
+#include "chrono_vehicle/ChVehicleModelData.h"
+
+#include "chrono_thirdparty/filesystem/path.h"
+
+#include "pacejka_batch.h"
+
+using namespace chrono;
+using namespace chrono::vehicle;
+
+// =============================================================================
+
+const std::string out_dir = "../PACTEST_BATCH";
+
+const int num_pts = 801;                      // # of data points in the slip ranges
+const double alpha_lim = CH_C_PI_4 / 3.0;     // slip angle in range [-lim,lim]
+const double kappa_lim = 1;                   // slip rate in range [-lim,lim]
+const double gamma = 10.0 * CH_C_PI / 180.0;  // camber angle for the LATERAL_GAMMA case
+
+// Vertical loads for each sweep [N]
+const std::vector<double> loads = {2000, 4000, 8000, 12000};
+
+// Number of repetitions of the batch for the throughput measurement
+const int num_reps = 200;
+
+// =============================================================================
+
+enum SlipCase { LONGITUDINAL, LATERAL, LATERAL_GAMMA, COMBINED, NUM_CASES };
+const char* case_names[] = {"pureLongSlip", "pureLatSlip", "pureLatSlipGamma", "combinedSlip"};
+
+int main(int argc, char* argv[]) {
+    // Set path to Chrono and Chrono::Vehicle data directories
+    SetChronoDataPath(CHRONO_DATA_DIR);
+    vehicle::SetDataPath(CHRONO_VEHICLE_DATA_DIR);
+
+    std::string tir_file = vehicle::GetDataFile("hmmwv/pactest.tir");
+    if (argc > 1)
+        tir_file = argv[1];
+
+    PacejkaBatch tire(tir_file);
+    std::cout << "Tire " << tir_file << ": nominal load " << tire.GetNominalLoad() << " N, radius "
+              << tire.GetUnloadedRadius() << " m" << std::endl;
+
+    // Fill the slip states of all cases and loads, one sweep after the other
+    size_t sweep = num_pts;
+    size_t n = NUM_CASES * loads.size() * sweep;
+    PacejkaSlips slips;
+    slips.resize(n);
+    for (int sc = 0; sc < NUM_CASES; sc++) {
+        for (size_t l = 0; l < loads.size(); l++) {
+            size_t offset = (sc * loads.size() + l) * sweep;
+            for (size_t i = 0; i < sweep; i++) {
+                double s = -1 + 2.0 * i / (sweep - 1);
+                double kappa = s * kappa_lim;
+                double alpha = s * alpha_lim;
+                slips.kappa[offset + i] = (sc == LONGITUDINAL || sc == COMBINED) ? kappa : 0;
+                slips.alpha[offset + i] = (sc == LONGITUDINAL) ? 0 : alpha;
+                slips.gamma[offset + i] = (sc == LATERAL_GAMMA) ? gamma : (sc == COMBINED ? 0.1 * alpha : 0);
+                slips.Fz[offset + i] = loads[l];
+            }
+        }
+    }
+
+    PacejkaForces forces;
+    tire.Evaluate(slips, forces);
+
+    // Output one table per case
+    if (!filesystem::create_directory(filesystem::path(out_dir))) {
+        std::cout << "Error creating directory " << out_dir << std::endl;
+        return 1;
+    }
+    for (int sc = 0; sc < NUM_CASES; sc++) {
+        utils::CSV_writer csv(",");
+        csv << "Fz,kappa,alpha,gamma,Fx0,Fy0,Mz0,Fx,Fy,Mz" << std::endl;
+        for (size_t l = 0; l < loads.size(); l++) {
+            size_t offset = (sc * loads.size() + l) * sweep;
+            for (size_t i = offset; i < offset + sweep; i++) {
+                csv << slips.Fz[i] << slips.kappa[i] << slips.alpha[i] << slips.gamma[i];
+                csv << forces.Fx0[i] << forces.Fy0[i] << forces.Mz0[i];
+                csv << forces.Fx[i] << forces.Fy[i] << forces.Mz[i] << std::endl;
+            }
+        }
+        csv.write_to_file(out_dir + "/test_pacBatch_" + case_names[sc] + ".csv");
+    }
+
+    // Throughput
+    ChTimer<double> timer;
+    timer.start();
+    for (int r = 0; r < num_reps; r++)
+        tire.Evaluate(slips, forces);
+    timer.stop();
+    double rate = num_reps * n / timer();
+    printf("%d x %d points in %.3f s: %.3g evaluations/s (%.1f ns per point)\n", num_reps, (int)n, timer(), rate,
+           1e9 / rate);
+
+    return 0;
+}
@@ -0,0 +1,162 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Accuracy and speed of tabulated Pacejka forces.
+// For a few table resolutions, the Magic Formula of a .tir file is tabulated
+// over (kappa, alpha, gamma, Fz). The interpolated Fx, Fy, and Mz are compared
+// to the analytic values along the slip sweeps of test_VEH_tirePacejka and at
+// random slip states, and the evaluation times of both are compared.
+//
+// =============================================================================
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "chrono/core/ChGlobal.h"
+#include "chrono/core/ChTimer.h"
+
+#include "chrono_vehicle/ChVehicleModelData.h"
+
+#include "pacejka_table.h"
+
+using namespace chrono;
+using namespace chrono::vehicle;
+
+// =============================================================================
+
+const int num_pts = 801;                          // # of data points in the slip sweeps
+const double alpha_lim = CH_C_PI_4 / 3.0;         // slip angle in range [-lim,lim]
+const double kappa_lim = 1;                       // slip rate in range [-lim,lim]
+const double gamma_lim = 10.0 * CH_C_PI / 180.0;  // camber angle in range [-lim,lim]
+const double Fz_min = 1000;                       // vertical load range [N]
+const double Fz_max = 12000;
+const double F_z = 8000;  // vertical load of the sweeps [N]
+
+// Number of random slip states for the accuracy and timing tests
+const int num_random = 1000000;
+
+// Table resolutions (number of nodes in kappa, alpha, gamma, Fz)
+struct Resolution {
+    int kappa, alpha, gamma, Fz;
+};
+const std::vector<Resolution> resolutions = {{41, 21, 5, 5}, {81, 41, 7, 7}, {161, 81, 9, 9}, {321, 161, 11, 12}};
+
+// =============================================================================
+
+// Maximum errors of the table on Fx, Fy, and Mz, relative to the largest magnitude of the analytic values.
+void CompareForces(const PacejkaForces& exact, const PacejkaForces& table, double err[3]) {
+    const std::vector<double>* e[3] = {&exact.Fx, &exact.Fy, &exact.Mz};
+    const std::vector<double>* t[3] = {&table.Fx, &table.Fy, &table.Mz};
+    for (int k = 0; k < 3; k++) {
+        double scale = 0;
+        double max_err = 0;
+        for (size_t i = 0; i < e[k]->size(); i++) {
+            scale = std::max(scale, std::abs((*e[k])[i]));
+            max_err = std::max(max_err, std::abs((*e[k])[i] - (*t[k])[i]));
+        }
+        err[k] = scale > 0 ? max_err / scale : 0;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // Set path to Chrono and Chrono::Vehicle data directories
+    SetChronoDataPath(CHRONO_DATA_DIR);
+    vehicle::SetDataPath(CHRONO_VEHICLE_DATA_DIR);
+
+    std::string tir_file = vehicle::GetDataFile("hmmwv/pactest.tir");
+    if (argc > 1)
+        tir_file = argv[1];
+
+    PacejkaBatch tire(tir_file);
+
+    // Slip sweeps (pure longitudinal, pure lateral, lateral with camber, combined)
+    PacejkaSlips sweeps;
+    sweeps.resize(4 * num_pts);
+    for (int i = 0; i < num_pts; i++) {
+        double s = -1 + 2.0 * i / (num_pts - 1);
+        double kappa = s * kappa_lim;
+        double alpha = s * alpha_lim;
+        double k[4] = {kappa, 0, 0, kappa};
+        double a[4] = {0, alpha, alpha, alpha};
+        double g[4] = {0, 0, gamma_lim, 0.1 * alpha};
+        for (int sc = 0; sc < 4; sc++) {
+            sweeps.kappa[sc * num_pts + i] = k[sc];
+            sweeps.alpha[sc * num_pts + i] = a[sc];
+            sweeps.gamma[sc * num_pts + i] = g[sc];
+            sweeps.Fz[sc * num_pts + i] = F_z;
+        }
+    }
+
+    // Random slip states
+    PacejkaSlips random;
+    random.resize(num_random);
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> unit(-1, 1);
+    for (int i = 0; i < num_random; i++) {
+        random.kappa[i] = unit(gen) * kappa_lim;
+        random.alpha[i] = unit(gen) * alpha_lim;
+        random.gamma[i] = unit(gen) * gamma_lim;
+        random.Fz[i] = Fz_min + (unit(gen) + 1) / 2 * (Fz_max - Fz_min);
+    }
+
+    // Analytic values and timing
+    PacejkaForces sweeps_exact;
+    PacejkaForces random_exact;
+    tire.Evaluate(sweeps, sweeps_exact);
+    ChTimer<double> timer;
+    timer.start();
+    tire.Evaluate(random, random_exact);
+    timer.stop();
+    double time_exact = timer();
+
+    std::cout << "Tire " << tir_file << std::endl;
+    printf("Analytic: %.1f ns per point\n\n", 1e9 * time_exact / num_random);
+    printf("%-18s %8s %8s %9s | %26s | %26s | %8s %8s\n", "resolution", "nodes", "MB", "build [s]",
+           "sweep error Fx / Fy / Mz", "random error Fx / Fy / Mz", "ns/point", "speedup");
+
+    for (const auto& res : resolutions) {
+        timer.reset();
+        timer.start();
+        PacejkaTable table(tire, {-kappa_lim, kappa_lim, res.kappa}, {-alpha_lim, alpha_lim, res.alpha},
+                           {-gamma_lim, gamma_lim, res.gamma}, {Fz_min, Fz_max, res.Fz});
+        timer.stop();
+        double time_build = timer();
+
+        PacejkaForces sweeps_table;
+        table.Evaluate(sweeps, sweeps_table);
+        double sweep_err[3];
+        CompareForces(sweeps_exact, sweeps_table, sweep_err);
+
+        PacejkaForces random_table;
+        timer.reset();
+        timer.start();
+        table.Evaluate(random, random_table);
+        timer.stop();
+        double time_table = timer();
+        double random_err[3];
+        CompareForces(random_exact, random_table, random_err);
+
+        char name[32];
+        sprintf(name, "%dx%dx%dx%d", res.kappa, res.alpha, res.gamma, res.Fz);
+        printf("%-18s %8d %8.1f %9.3f | %7.2f%% %7.2f%% %7.2f%% | %7.2f%% %7.2f%% %7.2f%% | %8.1f %8.2f\n", name,
+               (int)table.GetNumNodes(), table.GetMemorySize() / 1048576.0, time_build, 100 * sweep_err[0],
+               100 * sweep_err[1], 100 * sweep_err[2], 100 * random_err[0], 100 * random_err[1], 100 * random_err[2],
+               1e9 * time_table / num_random, time_exact / time_table);
+    }
+
+    return 0;
+}
@@ -0,0 +1,291 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// 2D sprocket gear profile and its precomputed signed distance field.
+//
+// CreateProfile builds the gear profile (one segment, arc, segment triplet
+// per tooth) as a ChLinePath in the gear frame (profile in the XY plane).
+//
+// ProfileDistance is the segment-by-segment distance query: it visits every
+// sub-line of the path (segments and circular arcs, identified from three
+// points on each) and returns the closest point on the profile.
+//
+// SprocketProfileSDF samples the signed distance to the profile (positive
+// outside the gear, negative inside) on a regular grid over the profile box,
+// at construction. A query is then a constant-time bilinear interpolation,
+// and its gradient (the contact normal) is the analytic gradient of the
+// interpolant. The error is of the order of the cell size squared times the
+// curvature of the distance field (largest at the tooth corners).
+//
+// =============================================================================
+
+#ifndef SPROCKET_PROFILE_H
+#define SPROCKET_PROFILE_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "chrono/core/ChMatrix33.h"
+#include "chrono/core/ChQuaternion.h"
+#include "chrono/geometry/ChLinePath.h"
+#include "chrono/geometry/ChLineSegment.h"
+#include "chrono/geometry/ChLineArc.h"
+
+// -----------------------------------------------------------------------------
+inline std::shared_ptr<chrono::geometry::ChLinePath> CreateProfile(int num_teeth, double R_T, double R_C, double R) {
+    using namespace chrono;
+
+    auto profile = chrono_types::make_shared<geometry::ChLinePath>();
+
+    double beta = CH_C_2PI / num_teeth;
+    double sbeta = std::sin(beta / 2);
+    double cbeta = std::cos(beta / 2);
+    double y = (R_T * R_T + R_C * R_C - R * R) / (2 * R_C);
+    double x = std::sqrt(R_T * R_T - y * y);
+    double gamma = std::asin(x / R);
+
+    for (int i = 0; i < num_teeth; ++i) {
+        double alpha = -i * beta;
+        ChVector<> p0(0, R_C, 0);
+        ChVector<> p1(-R_T * sbeta, R_T * cbeta, 0);
+        ChVector<> p2(-x, y, 0);
+        ChVector<> p3(x, y, 0);
+        ChVector<> p4(R_T * sbeta, R_T * cbeta, 0);
+        ChQuaternion<> quat;
+        quat.Q_from_AngZ(alpha);
+        ChMatrix33<> rot(quat);
+        p0 = rot * p0;
+        p1 = rot * p1;
+        p2 = rot * p2;
+        p3 = rot * p3;
+        p4 = rot * p4;
+        geometry::ChLineSegment seg1(p1, p2);
+        double angle1 = alpha + 1.5 * CH_C_PI - gamma;
+        double angle2 = alpha + 1.5 * CH_C_PI + gamma;
+        geometry::ChLineArc arc(ChCoordsys<>(p0), R, angle1, angle2, true);
+        geometry::ChLineSegment seg2(p3, p4);
+        profile->AddSubLine(seg1);
+        profile->AddSubLine(arc);
+        profile->AddSubLine(seg2);
+    }
+
+    return profile;
+}
+
+// -----------------------------------------------------------------------------
+// Segment-by-segment distance to a planar path made of segments and circular arcs.
+
+class ProfileDistance {
+  public:
+    ProfileDistance(const chrono::geometry::ChLinePath& profile) {
+        for (size_t i = 0; i < profile.GetSubLinesCount(); i++) {
+            auto line = profile.GetSubLineN(i);
+            chrono::ChVector<> a, m, b;
+            line->Evaluate(a, 0.0);
+            line->Evaluate(m, 0.5);
+            line->Evaluate(b, 1.0);
+            Feature f;
+            f.ax = a.x();
+            f.ay = a.y();
+            f.bx = b.x();
+            f.by = b.y();
+            // Circumcircle of the three points (a segment if they are collinear)
+            double d = 2 * (a.x() * (m.y() - b.y()) + m.x() * (b.y() - a.y()) + b.x() * (a.y() - m.y()));
+            double len2 = (b - a).Length2();
+            f.arc = std::abs(d) > 1e-9 * len2;
+            if (f.arc) {
+                double a2 = a.x() * a.x() + a.y() * a.y();
+                double m2 = m.x() * m.x() + m.y() * m.y();
+                double b2 = b.x() * b.x() + b.y() * b.y();
+                f.cx = (a2 * (m.y() - b.y()) + m2 * (b.y() - a.y()) + b2 * (a.y() - m.y())) / d;
+                f.cy = (a2 * (b.x() - m.x()) + m2 * (a.x() - b.x()) + b2 * (m.x() - a.x())) / d;
+                f.r = std::hypot(a.x() - f.cx, a.y() - f.cy);
+                // Arc span: from the start angle, ccw by span (negative for cw arcs)
+                f.a0 = std::atan2(a.y() - f.cy, a.x() - f.cx);
+                double am = Wrap(std::atan2(m.y() - f.cy, m.x() - f.cx) - f.a0);
+                double ab = Wrap(std::atan2(b.y() - f.cy, b.x() - f.cx) - f.a0);
+                f.span = (am <= ab) ? ab : ab - chrono::CH_C_2PI;
+            }
+            m_features.push_back(f);
+        }
+    }
+
+    /// Return the (unsigned) distance from the point (x,y) to the profile, and the closest point on the profile.
+    double Distance(double x, double y, double& qx, double& qy) const {
+        double best = std::numeric_limits<double>::max();
+        for (const auto& f : m_features) {
+            double px, py;
+            if (f.arc)
+                ClosestOnArc(f, x, y, px, py);
+            else
+                ClosestOnSegment(f.ax, f.ay, f.bx, f.by, x, y, px, py);
+            double d2 = (x - px) * (x - px) + (y - py) * (y - py);
+            if (d2 < best) {
+                best = d2;
+                qx = px;
+                qy = py;
+            }
+        }
+        return std::sqrt(best);
+    }
+
+    size_t GetNumFeatures() const { return m_features.size(); }
+
+  private:
+    struct Feature {
+        bool arc;
+        double ax, ay, bx, by;  // end points
+        double cx, cy, r;       // arc center and radius
+        double a0, span;        // arc start angle and signed angular span
+    };
+
+    static double Wrap(double a) {
+        a = std::fmod(a, chrono::CH_C_2PI);
+        return a < 0 ? a + chrono::CH_C_2PI : a;
+    }
+
+    static void ClosestOnSegment(double ax, double ay, double bx, double by, double x, double y, double& px,
+                                 double& py) {
+        double ux = bx - ax;
+        double uy = by - ay;
+        double len2 = ux * ux + uy * uy;
+        double t = len2 > 0 ? ((x - ax) * ux + (y - ay) * uy) / len2 : 0;
+        t = std::min(std::max(t, 0.0), 1.0);
+        px = ax + t * ux;
+        py = ay + t * uy;
+    }
+
+    static void ClosestOnArc(const Feature& f, double x, double y, double& px, double& py) {
+        double rel = Wrap(std::atan2(y - f.cy, x - f.cx) - f.a0);
+        bool inside = f.span >= 0 ? rel <= f.span : rel >= chrono::CH_C_2PI + f.span;
+        if (inside) {
+            double dx = x - f.cx;
+            double dy = y - f.cy;
+            double len = std::hypot(dx, dy);
+            if (len > 0) {
+                px = f.cx + f.r * dx / len;
+                py = f.cy + f.r * dy / len;
+                return;
+            }
+        }
+        // Closest end point
+        double da = (x - f.ax) * (x - f.ax) + (y - f.ay) * (y - f.ay);
+        double db = (x - f.bx) * (x - f.bx) + (y - f.by) * (y - f.by);
+        px = da < db ? f.ax : f.bx;
+        py = da < db ? f.ay : f.by;
+    }
+
+    std::vector<Feature> m_features;
+};
+
+// -----------------------------------------------------------------------------
+// Signed distance field of a closed planar profile, on a regular grid.
+
+class SprocketProfileSDF {
+  public:
+    /// Sample the signed distance to the given closed profile with the given cell size, over the box of the profile
+    /// enlarged by the given margin (the largest distance at which queries are needed, e.g. pin radius + envelope).
+    SprocketProfileSDF(const chrono::geometry::ChLinePath& profile, double cell, double margin) : m_h(cell) {
+        ProfileDistance exact(profile);
+
+        // Polygon approximation of the profile, for the inside/outside classification
+        size_t num_samples = 64 * profile.GetSubLinesCount();
+        std::vector<double> px(num_samples), py(num_samples);
+        double xmin = std::numeric_limits<double>::max(), ymin = xmin;
+        double xmax = -xmin, ymax = -xmin;
+        for (size_t i = 0; i < num_samples; i++) {
+            chrono::ChVector<> p;
+            profile.Evaluate(p, (double)i / num_samples);
+            px[i] = p.x();
+            py[i] = p.y();
+            xmin = std::min(xmin, p.x());
+            xmax = std::max(xmax, p.x());
+            ymin = std::min(ymin, p.y());
+            ymax = std::max(ymax, p.y());
+        }
+
+        m_x0 = xmin - margin;
+        m_y0 = ymin - margin;
+        m_nx = (int)std::ceil((xmax - xmin + 2 * margin) / cell) + 1;
+        m_ny = (int)std::ceil((ymax - ymin + 2 * margin) / cell) + 1;
+        m_dist.resize((size_t)m_nx * m_ny);
+        for (int j = 0; j < m_ny; j++) {
+            for (int i = 0; i < m_nx; i++) {
+                double x = m_x0 + i * cell;
+                double y = m_y0 + j * cell;
+                double qx, qy;
+                double d = exact.Distance(x, y, qx, qy);
+                m_dist[(size_t)j * m_nx + i] = Inside(px, py, x, y) ? -d : d;
+            }
+        }
+    }
+
+    /// Return the signed distance at the point (x,y) of the gear frame, and its gradient (gx,gy).
+    /// Outside the grid, the distance is extrapolated from the boundary (and overestimated).
+    double Distance(double x, double y, double& gx, double& gy) const {
+        double u = (x - m_x0) / m_h;
+        double v = (y - m_y0) / m_h;
+        double cu = std::min(std::max(u, 0.0), m_nx - 1.0);
+        double cv = std::min(std::max(v, 0.0), m_ny - 1.0);
+        int i = std::min((int)cu, m_nx - 2);
+        int j = std::min((int)cv, m_ny - 2);
+        double wu = cu - i;
+        double wv = cv - j;
+        const double* d0 = &m_dist[(size_t)j * m_nx + i];
+        const double* d1 = d0 + m_nx;
+        double d = (1 - wv) * ((1 - wu) * d0[0] + wu * d0[1]) + wv * ((1 - wu) * d1[0] + wu * d1[1]);
+        gx = ((1 - wv) * (d0[1] - d0[0]) + wv * (d1[1] - d1[0])) / m_h;
+        gy = ((1 - wu) * (d1[0] - d0[0]) + wu * (d1[1] - d0[1])) / m_h;
+        return d + std::hypot((u - cu) * m_h, (v - cv) * m_h);
+    }
+
+    /// Check a circular pin of given radius, centered at (x,y) in the gear frame, against the profile.
+    /// If they overlap, return true with the penetration depth and the unit normal (pointing out of the gear).
+    bool PinContact(double x, double y, double radius, double& depth, double& nx, double& ny) const {
+        double gx, gy;
+        double d = Distance(x, y, gx, gy);
+        if (d >= radius)
+            return false;
+        double len = std::hypot(gx, gy);
+        if (len == 0)
+            return false;
+        depth = radius - d;
+        nx = gx / len;
+        ny = gy / len;
+        return true;
+    }
+
+    int GetNumNodesX() const { return m_nx; }
+    int GetNumNodesY() const { return m_ny; }
+    size_t GetMemorySize() const { return m_dist.size() * sizeof(double); }
+
+  private:
+    // Crossing number test of the point (x,y) against the closed polygon (px,py).
+    static bool Inside(const std::vector<double>& px, const std::vector<double>& py, double x, double y) {
+        bool inside = false;
+        for (size_t i = 0, k = px.size() - 1; i < px.size(); k = i++) {
+            if ((py[i] > y) != (py[k] > y) && x < (px[k] - px[i]) * (y - py[i]) / (py[k] - py[i]) + px[i])
+                inside = !inside;
+        }
+        return inside;
+    }
+
+    double m_h;
+    double m_x0, m_y0;
+    int m_nx, m_ny;
+    std::vector<double> m_dist;  // row-major, x fastest
+};
+
+#endif
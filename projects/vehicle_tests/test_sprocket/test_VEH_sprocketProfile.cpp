@@ -9,6 +9,8 @@
 
 #include "chrono_irrlicht/ChIrrApp.h"
 
+#include "sprocket_profile.h"
+
 using namespace chrono;
 using namespace chrono::geometry;
 using namespace chrono::irrlicht;
@@ -21,43 +23,13 @@ using namespace irr::io;
 using namespace irr::gui;
 
 // -----------------------------------------------------------------------------
-std::shared_ptr<geometry::ChLinePath> CreateProfile(int num_teeth, double R_T, double R_C, double R) {
-    auto profile = chrono_types::make_shared<geometry::ChLinePath>();
-
-    double beta = CH_C_2PI / num_teeth;
-    double sbeta = std::sin(beta / 2);
-    double cbeta = std::cos(beta / 2);
-    double y = (R_T * R_T + R_C * R_C - R * R) / (2 * R_C);
-    double x = std::sqrt(R_T * R_T - y * y);
-    double gamma = std::asin(x / R);
-
-    for (int i = 0; i < num_teeth; ++i) {
-        double alpha = -i * beta;
-        ChVector<> p0(0, R_C, 0);
-        ChVector<> p1(-R_T * sbeta, R_T * cbeta, 0);
-        ChVector<> p2(-x, y, 0);
-        ChVector<> p3(x, y, 0);
-        ChVector<> p4(R_T * sbeta, R_T * cbeta, 0);
-        ChQuaternion<> quat;
-        quat.Q_from_AngZ(alpha);
-        ChMatrix33<> rot(quat);
-        p0 = rot * p0;
-        p1 = rot * p1;
-        p2 = rot * p2;
-        p3 = rot * p3;
-        p4 = rot * p4;
-        geometry::ChLineSegment seg1(p1, p2);
-        double angle1 = alpha + 1.5 * CH_C_PI - gamma;
-        double angle2 = alpha + 1.5 * CH_C_PI + gamma;
-        geometry::ChLineArc arc(ChCoordsys<>(p0), R, angle1, angle2, true);
-        geometry::ChLineSegment seg2(p3, p4);
-        profile->AddSubLine(seg1);
-        profile->AddSubLine(arc);
-        profile->AddSubLine(seg2);
-    }
 
-    return profile;
-}
+// Resolve the pin-gear contact with a lookup in the signed distance field of the gear profile (with penalty forces)
+// instead of the collision system
+bool use_sdf_contact = false;
+double sdf_cell = 0.002;
+double sdf_stiffness = 2e3;
+double sdf_damping = 50;
 
 // -----------------------------------------------------------------------------
 int main(int argc, char* argv[]) {
@@ -166,6 +138,11 @@ int main(int argc, char* argv[]) {
     pin->GetCollisionModel()->Add2Dpath(mat, pin_profile, ChVector<>(0, 0, -separation / 2));
     //pin->GetCollisionModel()->AddCylinder(pin_radius, pin_radius, pin_hlen);
     pin->GetCollisionModel()->BuildModel();
+    if (use_sdf_contact)
+        pin->SetCollide(false);
+
+    // Signed distance field of the gear profile
+    SprocketProfileSDF gear_sdf(*gear_profile, sdf_cell, pin_radius + 0.02);
 
     // Add pin visualization
     auto pin_cyl = chrono_types::make_shared<ChCylinderShape>();
@@ -189,6 +166,21 @@ int main(int argc, char* argv[]) {
     while (application.GetDevice()->run()) {
         application.BeginScene();
         application.DrawAll();
+        if (use_sdf_contact) {
+            // Pin-profile contact force, in the gear frame (one contact on each side of the gear)
+            gear->Empty_forces_accumulators();
+            pin->Empty_forces_accumulators();
+            ChVector<> c = gear->TransformPointParentToLocal(pin->GetPos());
+            double depth, nx, ny;
+            if (gear_sdf.PinContact(c.x(), c.y(), pin_radius, depth, nx, ny)) {
+                ChVector<> n = gear->TransformDirectionLocalToParent(ChVector<>(nx, ny, 0));
+                ChVector<> point = pin->GetPos() - n * pin_radius;
+                double vn = (pin->GetPos_dt() - gear->PointSpeedLocalToParent(c)) ^ n;
+                double fn = std::max(2 * (sdf_stiffness * depth - sdf_damping * vn), 0.0);
+                pin->Accumulate_force(fn * n, point, false);
+                gear->Accumulate_force(-fn * n, point, false);
+            }
+        }
         application.DoStep();
         application.EndScene();
     }
@@ -0,0 +1,157 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Benchmark of the pin-sprocket profile contact queries: segment by segment
+// against the gear profile path, and by lookup in its signed distance field,
+// for a few grid resolutions.
+//
+// The query set mimics one step of an M113 vehicle: two sprockets, each
+// checked against all the track pins of its side (63 shoes, one pin per shoe),
+// on both gear profiles. The pins are scattered outside the gear, within the
+// distance of the profile where contacts are possible.
+//
+// =============================================================================
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "chrono/core/ChTimer.h"
+
+#include "sprocket_profile.h"
+
+using namespace chrono;
+
+// =============================================================================
+
+// Gear profile (as in test_VEH_sprocketProfile)
+int n_teeth = 10;
+double R_T = 0.2605;
+double R_C = 0.3;
+double R = 0.089;
+double pin_radius = 0.3 * R;
+
+// M113 track
+int num_shoes = 63;
+int num_sprockets = 2;
+int num_profiles = 2;
+
+// Number of benchmark steps
+int num_steps = 20000;
+
+// SDF cell sizes
+std::vector<double> cells = {0.004, 0.002, 0.001, 0.0005};
+
+// =============================================================================
+
+int main(int argc, char* argv[]) {
+    auto profile = CreateProfile(n_teeth, R_T, R_C, R);
+    ProfileDistance exact(*profile);
+    double margin = pin_radius + 0.02;
+
+    // Pin locations (gear frame) for all steps: random points on the profile, moved out of the gear by a random
+    // distance up to the margin
+    int queries_per_step = num_sprockets * num_shoes * num_profiles;
+    size_t num_queries = (size_t)queries_per_step * num_steps;
+    std::vector<double> x(num_queries), y(num_queries);
+    double area = 0;
+    for (int i = 0; i < 1000; i++) {
+        ChVector<> p0, p1;
+        profile->Evaluate(p0, i / 1000.0);
+        profile->Evaluate(p1, (i + 1) / 1000.0);
+        area += p0.x() * p1.y() - p1.x() * p0.y();
+    }
+    double side = area > 0 ? 1 : -1;  // outward normal on the right of a ccw profile
+    std::mt19937 gen(17);
+    std::uniform_real_distribution<double> param(0, 1);
+    std::uniform_real_distribution<double> offset(0, margin);
+    for (size_t i = 0; i < num_queries; i++) {
+        double u = param(gen);
+        ChVector<> p, p_next;
+        profile->Evaluate(p, u);
+        profile->Evaluate(p_next, std::min(u + 1e-6, 1.0));
+        double tx = p_next.x() - p.x();
+        double ty = p_next.y() - p.y();
+        double len = std::hypot(tx, ty);
+        double s = offset(gen);
+        x[i] = p.x() + side * s * ty / len;
+        y[i] = p.y() - side * s * tx / len;
+    }
+
+    // Segment-by-segment queries
+    ChTimer<double> timer;
+    std::vector<double> d_exact(num_queries), nx_exact(num_queries), ny_exact(num_queries);
+    int num_contacts = 0;
+    timer.start();
+    for (size_t i = 0; i < num_queries; i++) {
+        double qx, qy;
+        double d = exact.Distance(x[i], y[i], qx, qy);
+        d_exact[i] = d;
+        nx_exact[i] = (x[i] - qx) / d;
+        ny_exact[i] = (y[i] - qy) / d;
+        num_contacts += d < pin_radius;
+    }
+    timer.stop();
+    double time_exact = timer();
+
+    printf("Profile with %d features; %d queries per step, %d steps (%.1f%% in contact)\n",
+           (int)exact.GetNumFeatures(), queries_per_step, num_steps, 100.0 * num_contacts / num_queries);
+    printf("segment by segment: %8.2f us per step\n\n", 1e6 * time_exact / num_steps);
+    printf("%8s %10s %8s %10s %10s %12s %22s %8s\n", "cell", "nodes", "MB", "build [s]", "us/step", "max dist err",
+           "normal err mean / max", "speedup");
+
+    for (double cell : cells) {
+        timer.reset();
+        timer.start();
+        SprocketProfileSDF sdf(*profile, cell, margin);
+        timer.stop();
+        double time_build = timer();
+
+        // Timed lookups (as contact queries)
+        int num_sdf_contacts = 0;
+        timer.reset();
+        timer.start();
+        for (size_t i = 0; i < num_queries; i++) {
+            double depth, nx, ny;
+            num_sdf_contacts += sdf.PinContact(x[i], y[i], pin_radius, depth, nx, ny);
+        }
+        timer.stop();
+        double time_sdf = timer();
+
+        // Accuracy, for the queries in contact
+        double max_err = 0;
+        double max_angle = 0;
+        double sum_angle = 0;
+        for (size_t i = 0; i < num_queries; i++) {
+            if (d_exact[i] >= pin_radius)
+                continue;
+            double gx, gy;
+            double d = sdf.Distance(x[i], y[i], gx, gy);
+            double len = std::hypot(gx, gy);
+            max_err = std::max(max_err, std::abs(d - d_exact[i]));
+            if (len > 0) {
+                double c = (gx * nx_exact[i] + gy * ny_exact[i]) / len;
+                double angle = std::acos(std::min(std::max(c, -1.0), 1.0));
+                max_angle = std::max(max_angle, angle);
+                sum_angle += angle;
+            }
+        }
+
+        printf("%8.4f %10d %8.2f %10.3f %10.2f %12.2e %8.3f / %6.2f deg %8.1f   (%d contacts vs %d)\n", cell,
+               sdf.GetNumNodesX() * sdf.GetNumNodesY(), sdf.GetMemorySize() / 1048576.0, time_build,
+               1e6 * time_sdf / num_steps, max_err, sum_angle / num_contacts * 180 / CH_C_PI,
+               max_angle * 180 / CH_C_PI, time_exact / time_sdf, num_sdf_contacts, num_contacts);
+    }
+
+    return 0;
+}
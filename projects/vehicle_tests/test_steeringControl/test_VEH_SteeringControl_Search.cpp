@@ -0,0 +1,314 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2021 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+// Parameter search for the PID steering controller of the path-follower
+// driver, on the vehicle and path of test_VEH_SteeringControl.
+//
+// Each candidate (Kp, Ki, Kd, look-ahead distance) is evaluated in its own
+// vehicle system, without visualization, on worker threads. A run stops early
+// if the vehicle diverges from the path. The path error norms of all runs are
+// written to a table, sorted by RMS location error.
+//
+// Usage:
+//   test_VEH_SteeringControl_Search              (grid search)
+//   test_VEH_SteeringControl_Search random N     (N random samples)
+//
+// =============================================================================
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chrono/core/ChTimer.h"
+#include "chrono/utils/ChUtilsInputOutput.h"
+
+#include "chrono_vehicle/ChVehicleModelData.h"
+#include "chrono_vehicle/wheeled_vehicle/vehicle/WheeledVehicle.h"
+#include "chrono_vehicle/wheeled_vehicle/tire/RigidTire.h"
+#include "chrono_vehicle/powertrain/SimplePowertrain.h"
+#include "chrono_vehicle/terrain/RigidTerrain.h"
+
+#include "chrono_vehicle/driver/ChPathFollowerDriver.h"
+
+using namespace chrono;
+using namespace chrono::vehicle;
+
+// =============================================================================
+// Global definitions (vehicle, path, and simulation as in test_VEH_SteeringControl)
+
+// Input file names for the path-follower driver model
+std::string steering_controller_file("generic/driver/SteeringController.json");
+std::string speed_controller_file("generic/driver/SpeedController.json");
+std::string path_file("paths/curve.txt");
+
+// Output file name
+std::string out_file("search_results.out");
+
+// JSON file names for vehicle model, tire models, (simple) powertrain, and (rigid) terrain
+std::string vehicle_file("generic/vehicle/Vehicle_DoubleWishbones.json");
+std::string rigidtire_file("generic/tire/RigidTire.json");
+std::string simplepowertrain_file("generic/powertrain/SimplePowertrain.json");
+std::string rigidterrain_file("terrain/RigidPlane.json");
+
+// Initial vehicle position and orientation
+ChVector<> initLoc(-125, -125, 0.6);
+ChQuaternion<> initRot(1, 0, 0, 0);
+
+// Desired vehicle speed (m/s)
+double target_speed = 10;
+
+// Simulation step size and simulation length
+double step_size = 2e-3;        // integration step size
+int num_steps_settling = 3000;  // number of steps for settling
+int num_steps = 5000;           // number of steps for data colection
+
+// Divergence threshold on the vehicle location error (m)
+double max_location_err = 4;
+
+// Search ranges: Kp, Ki, Kd, look-ahead distance
+double Kp_range[2] = {0.1, 1.0};
+double Ki_range[2] = {0.0, 0.5};
+double Kd_range[2] = {0.0, 0.3};
+double lookahead_range[2] = {2, 10};
+
+// Grid search resolution (number of values in each range)
+int grid_num[4] = {4, 3, 3, 4};
+
+// =============================================================================
+
+struct Candidate {
+    double Kp, Ki, Kd, lookahead;
+};
+
+struct Result {
+    bool diverged;
+    double end_time;  // time at the end of the run (earlier than the full run if diverged)
+    double loc_RMS;
+    double loc_INF;
+    double speed_RMS;
+    double wall_time;
+};
+
+// Evaluate one candidate in its own vehicle system.
+Result Evaluate(const Candidate& c) {
+    ChTimer<double> timer;
+    timer.start();
+
+    // Create and initialize the vehicle system
+    WheeledVehicle vehicle(vehicle::GetDataFile(vehicle_file));
+    vehicle.Initialize(ChCoordsys<>(initLoc, initRot));
+    vehicle.GetSystem()->SetNumThreads(1);
+    vehicle.SetChassisVisualizationType(VisualizationType::NONE);
+    vehicle.SetSuspensionVisualizationType(VisualizationType::NONE);
+    vehicle.SetSteeringVisualizationType(VisualizationType::NONE);
+    vehicle.SetWheelVisualizationType(VisualizationType::NONE);
+
+    // Create the terrain
+    RigidTerrain terrain(vehicle.GetSystem(), vehicle::GetDataFile(rigidterrain_file));
+
+    // Create and initialize the powertrain system
+    auto powertrain = chrono_types::make_shared<SimplePowertrain>(vehicle::GetDataFile(simplepowertrain_file));
+    vehicle.InitializePowertrain(powertrain);
+
+    // Create and initialize the tires
+    for (auto& axle : vehicle.GetAxles()) {
+        auto tireL = chrono_types::make_shared<RigidTire>(vehicle::GetDataFile(rigidtire_file));
+        auto tireR = chrono_types::make_shared<RigidTire>(vehicle::GetDataFile(rigidtire_file));
+        vehicle.InitializeTire(tireL, axle->m_wheels[0], VisualizationType::NONE);
+        vehicle.InitializeTire(tireR, axle->m_wheels[1], VisualizationType::NONE);
+    }
+
+    // Create the driver system, with the candidate steering parameters
+    auto path = ChBezierCurve::read(vehicle::GetDataFile(path_file));
+    ChPathFollowerDriver driver(vehicle, vehicle::GetDataFile(steering_controller_file),
+                                vehicle::GetDataFile(speed_controller_file), path, "my_path", target_speed);
+    driver.GetSteeringController().SetGains(c.Kp, c.Ki, c.Kd);
+    driver.GetSteeringController().SetLookAheadDistance(c.lookahead);
+    driver.Initialize();
+
+    // Path tracker for the error in vehicle location
+    ChBezierCurveTracker tracker(path);
+
+    Result result;
+    result.diverged = false;
+    double loc_err2_sum = 0;
+    double loc_err2_max = 0;
+    double speed_err2_sum = 0;
+    int num_samples = 0;
+
+    for (int it = 0; it < num_steps_settling + num_steps; it++) {
+        bool settling = (it < num_steps_settling);
+
+        // Collect data, stop on divergence
+        if (!settling) {
+            ChVector<> vehicle_location = vehicle.GetVehiclePos();
+            ChVector<> vehicle_target;
+            tracker.calcClosestPoint(vehicle_location, vehicle_target);
+            double loc_err2 = (vehicle_target - vehicle_location).Length2();
+            double speed_err = target_speed - vehicle.GetVehicleSpeed();
+            if (!(loc_err2 <= max_location_err * max_location_err)) {
+                result.diverged = true;
+                break;
+            }
+            loc_err2_sum += loc_err2;
+            loc_err2_max = std::max(loc_err2_max, loc_err2);
+            speed_err2_sum += speed_err * speed_err;
+            num_samples++;
+        }
+
+        // Collect output data from modules (for inter-module communication)
+        ChDriver::Inputs driver_inputs = driver.GetInputs();
+        if (settling) {
+            driver_inputs.m_throttle = 0;
+            driver_inputs.m_steering = 0;
+            driver_inputs.m_braking = 0;
+        }
+
+        // Update modules (process inputs from other modules)
+        double time = vehicle.GetChTime();
+        driver.Synchronize(time);
+        vehicle.Synchronize(time, driver_inputs, terrain);
+        terrain.Synchronize(time);
+
+        // Advance simulation for one timestep for all modules
+        driver.Advance(step_size);
+        vehicle.Advance(step_size);
+        terrain.Advance(step_size);
+    }
+
+    result.end_time = vehicle.GetChTime();
+    result.loc_RMS = num_samples > 0 ? std::sqrt(loc_err2_sum / num_samples) : 0;
+    result.loc_INF = std::sqrt(loc_err2_max);
+    result.speed_RMS = num_samples > 0 ? std::sqrt(speed_err2_sum / num_samples) : 0;
+    timer.stop();
+    result.wall_time = timer();
+    return result;
+}
+
+// =============================================================================
+
+double GridValue(const double range[2], int num, int i) {
+    return num > 1 ? range[0] + (range[1] - range[0]) * i / (num - 1) : range[0];
+}
+
+int main(int argc, char* argv[]) {
+    // Set path to Chrono and Chrono::Vehicle data directories
+    SetChronoDataPath(CHRONO_DATA_DIR);
+    vehicle::SetDataPath(CHRONO_VEHICLE_DATA_DIR);
+
+    // Candidates: grid or random search
+    std::vector<Candidate> candidates;
+    if (argc > 2 && std::string(argv[1]) == "random") {
+        int num_samples = std::atoi(argv[2]);
+        std::mt19937 gen(1);
+        std::uniform_real_distribution<double> unit(0, 1);
+        for (int i = 0; i < num_samples; i++) {
+            Candidate c;
+            c.Kp = Kp_range[0] + (Kp_range[1] - Kp_range[0]) * unit(gen);
+            c.Ki = Ki_range[0] + (Ki_range[1] - Ki_range[0]) * unit(gen);
+            c.Kd = Kd_range[0] + (Kd_range[1] - Kd_range[0]) * unit(gen);
+            c.lookahead = lookahead_range[0] + (lookahead_range[1] - lookahead_range[0]) * unit(gen);
+            candidates.push_back(c);
+        }
+    } else {
+        for (int ip = 0; ip < grid_num[0]; ip++)
+            for (int ii = 0; ii < grid_num[1]; ii++)
+                for (int id = 0; id < grid_num[2]; id++)
+                    for (int il = 0; il < grid_num[3]; il++) {
+                        Candidate c;
+                        c.Kp = GridValue(Kp_range, grid_num[0], ip);
+                        c.Ki = GridValue(Ki_range, grid_num[1], ii);
+                        c.Kd = GridValue(Kd_range, grid_num[2], id);
+                        c.lookahead = GridValue(lookahead_range, grid_num[3], il);
+                        candidates.push_back(c);
+                    }
+    }
+
+    // Evaluate all candidates in parallel
+    unsigned int num_workers = std::max(1u, std::thread::hardware_concurrency());
+    num_workers = std::min(num_workers, (unsigned int)candidates.size());
+    std::cout << "Evaluating " << candidates.size() << " candidates on " << num_workers << " threads" << std::endl;
+
+    std::vector<Result> results(candidates.size());
+    std::atomic<size_t> next(0);
+    std::atomic<int> num_done(0);
+
+    ChTimer<double> timer;
+    timer.start();
+    std::vector<std::thread> workers;
+    for (unsigned int w = 0; w < num_workers; w++) {
+        workers.push_back(std::thread([&]() {
+            for (size_t i = next++; i < candidates.size(); i = next++) {
+                results[i] = Evaluate(candidates[i]);
+                std::cout << '\r' << ++num_done << " / " << candidates.size() << std::flush;
+            }
+        }));
+    }
+    for (auto& w : workers)
+        w.join();
+    timer.stop();
+    std::cout << std::endl;
+
+    // Sort by RMS location error (diverged runs last) and write out the results
+    std::vector<size_t> order(candidates.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&results](size_t a, size_t b) {
+        if (results[a].diverged != results[b].diverged)
+            return !results[a].diverged;
+        return results[a].diverged ? results[a].end_time > results[b].end_time
+                                   : results[a].loc_RMS < results[b].loc_RMS;
+    });
+
+    utils::CSV_writer csv("\t");
+    csv << "Kp"
+        << "Ki"
+        << "Kd"
+        << "lookahead"
+        << "diverged"
+        << "end_time"
+        << "loc_RMS"
+        << "loc_INF"
+        << "speed_RMS"
+        << "wall_time" << std::endl;
+    int num_diverged = 0;
+    double sim_time = 0;
+    for (size_t i : order) {
+        const Candidate& c = candidates[i];
+        const Result& r = results[i];
+        csv << c.Kp << c.Ki << c.Kd << c.lookahead << r.diverged << r.end_time << r.loc_RMS << r.loc_INF
+            << r.speed_RMS << r.wall_time << std::endl;
+        num_diverged += r.diverged;
+        sim_time += r.end_time;
+    }
+    csv.write_to_file(out_file);
+
+    const Candidate& best = candidates[order[0]];
+    const Result& best_result = results[order[0]];
+    std::cout << "Best: Kp = " << best.Kp << "  Ki = " << best.Ki << "  Kd = " << best.Kd
+              << "  look-ahead = " << best.lookahead << std::endl;
+    std::cout << "      |location err|_RMS = " << best_result.loc_RMS
+              << "  |location err|_INF = " << best_result.loc_INF << "  |speed err|_RMS = " << best_result.speed_RMS
+              << std::endl;
+    std::cout << num_diverged << " runs diverged (stopped early)" << std::endl;
+    printf("%d runs in %.2f s: %.2f runs/s, %.1f x real time\n", (int)candidates.size(), timer(),
+           candidates.size() / timer(), sim_time / timer());
+
+    return 0;
+}